@@ -291,6 +291,12 @@ typedef enum libvlc_media_parse_flag_t
      * when the input is asking for credentials.
      */
     libvlc_media_do_interact    = 0x08,
+    /**
+     * Parse this media (and fetch its art) before the media already queued
+     * for parsing, for instance because it is visible to the user while a
+     * whole library is being scanned. \version LibVLC 4.0.0 and later.
+     */
+    libvlc_media_parse_priority = 0x10,
 } libvlc_media_parse_flag_t;
 
 /**
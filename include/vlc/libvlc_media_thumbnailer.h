@@ -0,0 +1,148 @@
+/*****************************************************************************
+ * libvlc_media_thumbnailer.h:  libvlc external API
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_LIBVLC_MEDIA_THUMBNAILER_H
+#define VLC_LIBVLC_MEDIA_THUMBNAILER_H 1
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/** \defgroup libvlc_media_thumbnailer LibVLC media thumbnailer
+ * \ingroup libvlc
+ * LibVLC media thumbnailer extracts pictures from many media at once,
+ * without playing them: no clock, no video output. Only the video track is
+ * demuxed and, where possible, only key frames are decoded.
+ * @{
+ * \file
+ * LibVLC media thumbnailer external API
+ */
+
+typedef struct libvlc_media_thumbnailer_t libvlc_media_thumbnailer_t;
+
+/**
+ * Format of the thumbnails
+ */
+typedef enum libvlc_thumbnail_type_t {
+    /** PNG image */
+    libvlc_thumbnail_png,
+    /** JPEG image */
+    libvlc_thumbnail_jpg,
+    /** Raw RGBA pixels, 4 bytes per pixel, without padding */
+    libvlc_thumbnail_rgba,
+} libvlc_thumbnail_type_t;
+
+/**
+ * Callback prototype for thumbnails.
+ *
+ * This is called from a thumbnailer thread, exactly once per requested
+ * thumbnail, in increasing time order.
+ *
+ * \param opaque private pointer as passed to
+ *               libvlc_media_thumbnailer_request() [IN]
+ * \param p_md media [IN]
+ * \param i_index index of the requested thumbnail [IN]
+ * \param i_time time of the extracted picture in ms, or -1 [IN]
+ * \param p_data thumbnail data, or NULL on error or cancellation;
+ *               valid during the callback only [IN]
+ * \param i_size size of the data in bytes [IN]
+ * \param i_width width of the thumbnail [IN]
+ * \param i_height height of the thumbnail [IN]
+ */
+typedef void (*libvlc_thumbnail_cb)( void *opaque, libvlc_media_t *p_md,
+                                     unsigned i_index, libvlc_time_t i_time,
+                                     const void *p_data, size_t i_size,
+                                     unsigned i_width, unsigned i_height );
+
+/**
+ * Create a media thumbnailer.
+ *
+ * \param p_instance libvlc instance
+ * \param i_threads maximum number of media processed concurrently,
+ *                  0 for the number of CPUs
+ * \return a new thumbnailer or NULL on error
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API libvlc_media_thumbnailer_t *
+libvlc_media_thumbnailer_new( libvlc_instance_t *p_instance,
+                              unsigned i_threads );
+
+/**
+ * Release a media thumbnailer.
+ *
+ * Pending requests are cancelled: their callbacks are called, with no data,
+ * before this function returns.
+ *
+ * \param p_thumbnailer thumbnailer to release
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API void
+libvlc_media_thumbnailer_release( libvlc_media_thumbnailer_t *p_thumbnailer );
+
+/**
+ * Request thumbnails of a media.
+ *
+ * If i_width XOR i_height is 0, original aspect-ratio is preserved.
+ * If i_width AND i_height is 0, original size is used.
+ * Otherwise the picture fits in the given box.
+ *
+ * \param p_thumbnailer thumbnailer
+ * \param p_md media (retained until the last callback)
+ * \param p_times times of the thumbnails in ms, or NULL for i_count
+ *                thumbnails spread evenly over the media
+ * \param i_count number of thumbnails
+ * \param i_width maximum width of the thumbnails
+ * \param i_height maximum height of the thumbnails
+ * \param i_type format of the thumbnails
+ * \param cb callback
+ * \param opaque private pointer for the callback
+ * \return 0 on success, -1 on error (the callback is not called then)
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API int
+libvlc_media_thumbnailer_request( libvlc_media_thumbnailer_t *p_thumbnailer,
+                                  libvlc_media_t *p_md,
+                                  const libvlc_time_t *p_times,
+                                  unsigned i_count,
+                                  unsigned i_width, unsigned i_height,
+                                  libvlc_thumbnail_type_t i_type,
+                                  libvlc_thumbnail_cb cb, void *opaque );
+
+/**
+ * Cancel the requests of a media.
+ *
+ * This does not wait: the callbacks of the cancelled thumbnails are called
+ * later, with no data.
+ *
+ * \param p_thumbnailer thumbnailer
+ * \param p_md media, or NULL for all requests
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API void
+libvlc_media_thumbnailer_cancel( libvlc_media_thumbnailer_t *p_thumbnailer,
+                                 libvlc_media_t *p_md );
+
+/** @} */
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif /* VLC_LIBVLC_MEDIA_THUMBNAILER_H */
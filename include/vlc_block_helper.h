@@ -274,6 +274,8 @@ static inline int block_PeekOffsetBytes( block_bytestream_t *p_bytestream,
 }
 
 typedef const uint8_t * (*block_startcode_helper_t)( const uint8_t *, const uint8_t * );
+typedef size_t (*block_startcodes_helper_t)( const uint8_t *, const uint8_t *,
+                                            const uint8_t **, size_t );
 typedef bool (*block_startcode_matcher_t)( uint8_t, size_t, const uint8_t * );
 
 static inline int block_FindStartcodeFromOffset(
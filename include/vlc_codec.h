@@ -221,6 +221,14 @@ struct encoder_t
     int i_bframes;               /* One B frame per i_bframes */
     int i_tolerance;             /* Bitrate tolerance */
 
+    /**
+     * Number of input pictures the encoder may keep referenced after
+     * pf_encode_video() returns (reordering, lookahead), rather than copying
+     * them. Set by the encoder module when it opens. Owners size their
+     * picture pools accordingly.
+     */
+    int i_lookahead;
+
     /* Encoder config */
     config_chain_t *p_cfg;
 };
@@ -257,6 +265,38 @@ static inline int decoder_UpdateVideoFormat( decoder_t *dec )
         return -1;
 }
 
+/**
+ * Number of pictures the video decoder may hold at once.
+ *
+ * This is the size of its decoded picture buffer, the extra picture buffers
+ * it requested and the picture being decoded. A picture pool of this size
+ * never runs out because of the decoder alone.
+ */
+VLC_USED
+static inline unsigned decoder_GetPoolSize( const decoder_t *dec )
+{
+    unsigned dpb_size;
+
+    switch( dec->fmt_in.i_codec )
+    {
+    case VLC_CODEC_HEVC:
+    case VLC_CODEC_H264:
+    case VLC_CODEC_DIRAC: /* FIXME valid ? */
+        dpb_size = 18;
+        break;
+    case VLC_CODEC_VP5:
+    case VLC_CODEC_VP6:
+    case VLC_CODEC_VP6F:
+    case VLC_CODEC_VP8:
+        dpb_size = 3;
+        break;
+    default:
+        dpb_size = 2;
+        break;
+    }
+    return dpb_size + dec->i_extra_picture_buffers + 1;
+}
+
 /**
  * Allocates an output picture buffer.
  *
@@ -113,6 +113,7 @@ enum es_out_policy_e
 struct es_out_t
 {
     es_out_id_t *(*pf_add)    ( es_out_t *, const es_format_t * );
+    /* The block may be a chain of blocks of the same ES (see es_out_SendChain) */
     int          (*pf_send)   ( es_out_t *, es_out_id_t *, block_t * );
     void         (*pf_del)    ( es_out_t *, es_out_id_t * );
     int          (*pf_control)( es_out_t *, int i_query, va_list );
@@ -138,6 +139,18 @@ static inline int es_out_Send( es_out_t *out, es_out_id_t *id,
     return out->pf_send( out, id, p_block );
 }
 
+/**
+ * Sends a chain of blocks of the same ES.
+ *
+ * This is equivalent to sending each block in turn, but the decoder fifo is
+ * locked and the decoder woken up only once for the whole chain.
+ */
+static inline int es_out_SendChain( es_out_t *out, es_out_id_t *id,
+                                    block_t *p_chain )
+{
+    return out->pf_send( out, id, p_chain );
+}
+
 static inline int es_out_vaControl( es_out_t *out, int i_query, va_list args )
 {
     return out->pf_control( out, i_query, args );
@@ -0,0 +1,120 @@
+/*****************************************************************************
+ * vlc_seekindex.h: persistent demuxer seek index
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SEEKINDEX_H
+#define VLC_SEEKINDEX_H 1
+
+/**
+ * \defgroup seekindex Seek index
+ * \ingroup input
+ * Persistent demuxer seek points
+ *
+ * Demuxers publish the seek points they come across (while indexing or
+ * playing), and get them back the next time the same file is opened.
+ * The index is stored in the user cache directory, keyed by the demuxer
+ * name and the file path, size and modification time.
+ *
+ * A seek index is owned by a single demuxer and is not thread-safe.
+ * @{
+ * \file
+ * Seek index functions
+ */
+
+/** The entry is a random access point */
+#define SEEKINDEX_KEYFRAME  0x01
+
+typedef struct
+{
+    mtime_t  i_time;   /**< demuxer time, or VLC_TS_INVALID */
+    uint64_t i_offset; /**< byte offset in the stream */
+    uint32_t i_size;   /**< size of the data at i_offset, 0 if unknown */
+    uint32_t i_track;  /**< demuxer defined track identifier */
+    uint32_t i_flags;  /**< SEEKINDEX_* flags */
+} vlc_seekindex_entry_t;
+
+typedef struct
+{
+    uint64_t i_start;
+    uint64_t i_end;
+} vlc_seekindex_range_t;
+
+typedef struct vlc_seekindex_t vlc_seekindex_t;
+
+/**
+ * Creates the seek index of a local file, loading the previously
+ * stored entries if the file did not change since.
+ *
+ * \param psz_name demuxer name, so that different demuxers don't share
+ * their entries
+ * \param psz_path local file path (demux_t.psz_file)
+ * \return a seek index or NULL if disabled, not a local file or on error
+ */
+VLC_API vlc_seekindex_t *vlc_seekindex_New( vlc_object_t *, const char *psz_name,
+                                            const char *psz_path ) VLC_USED;
+#define vlc_seekindex_New(a, b, c) vlc_seekindex_New(VLC_OBJECT(a), b, c)
+
+/**
+ * Stores the index if entries or ranges were added, and releases it.
+ */
+VLC_API void vlc_seekindex_Delete( vlc_seekindex_t * );
+
+/**
+ * Adds an entry. Entries with the same track and offset are merged.
+ */
+VLC_API int vlc_seekindex_Add( vlc_seekindex_t *, const vlc_seekindex_entry_t * );
+
+/**
+ * Marks a byte range as fully indexed: all its entries have been added.
+ */
+VLC_API int vlc_seekindex_AddRange( vlc_seekindex_t *, uint64_t i_start, uint64_t i_end );
+
+/**
+ * Tells if a byte range was fully indexed, in this or a previous session.
+ */
+VLC_API bool vlc_seekindex_IsIndexed( vlc_seekindex_t *, uint64_t i_start, uint64_t i_end );
+
+/**
+ * Finds the latest entry of a track at or before a time.
+ *
+ * \param i_flags flags the entry must have (e.g. SEEKINDEX_KEYFRAME)
+ * \return the entry or NULL. It is valid until the index is modified.
+ */
+VLC_API const vlc_seekindex_entry_t *vlc_seekindex_Lookup( vlc_seekindex_t *,
+                                                           uint32_t i_track,
+                                                           mtime_t i_time,
+                                                           uint32_t i_flags );
+
+/**
+ * Gets the entries of a track, by increasing offset.
+ *
+ * \return the number of entries. They are valid until the index is modified.
+ */
+VLC_API size_t vlc_seekindex_GetEntries( vlc_seekindex_t *, uint32_t i_track,
+                                         const vlc_seekindex_entry_t ** );
+
+/**
+ * Gets the fully indexed ranges, by increasing offset.
+ */
+VLC_API size_t vlc_seekindex_GetRanges( vlc_seekindex_t *,
+                                        const vlc_seekindex_range_t ** );
+
+/** @} */
+
+#endif
@@ -0,0 +1,147 @@
+/*****************************************************************************
+ * vlc_threadpool.h: shared worker thread pool
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_THREADPOOL_H
+#define VLC_THREADPOOL_H 1
+
+/**
+ * \defgroup threadpool Thread pool
+ * \ingroup thread
+ * Shared worker threads for short CPU-bound tasks
+ *
+ * A single pool serves a whole LibVLC instance, with one worker per CPU
+ * by default, so that modules running in parallel (video filters, chroma
+ * converters, SPU rendering, muxers...) do not oversubscribe the CPUs
+ * however many inputs are running.
+ *
+ * Each worker has its own queue of tasks per priority. Idle workers steal
+ * tasks from the queues of the others, and a thread waiting for a group
+ * of tasks runs the queued tasks of that group itself.
+ *
+ * Tasks should be short and must not block: they share the workers with
+ * all the other users of the pool.
+ * @{
+ * \file
+ * Thread pool functions
+ */
+
+typedef struct vlc_threadpool_t vlc_threadpool_t;
+typedef struct vlc_threadpool_group_t vlc_threadpool_group_t;
+
+enum vlc_threadpool_priority
+{
+    VLC_THREADPOOL_PRIORITY_LOW,    /**< Background work */
+    VLC_THREADPOOL_PRIORITY_NORMAL, /**< Muxing, encoding... */
+    VLC_THREADPOOL_PRIORITY_HIGH,   /**< Work a display deadline waits for */
+};
+#define VLC_THREADPOOL_PRIORITIES (VLC_THREADPOOL_PRIORITY_HIGH + 1)
+
+/** No affinity: the task may be queued on any worker */
+#define VLC_THREADPOOL_ANY (-1)
+
+/**
+ * Gets the thread pool of the LibVLC instance, starting it on first use.
+ *
+ * The pool lives as long as the instance; it is not reference counted.
+ *
+ * \return the pool, or NULL on error
+ */
+VLC_API vlc_threadpool_t *vlc_threadpool_Get( vlc_object_t * ) VLC_USED;
+#define vlc_threadpool_Get(o) vlc_threadpool_Get(VLC_OBJECT(o))
+
+/**
+ * Tells the number of worker threads of the pool.
+ */
+VLC_API unsigned vlc_threadpool_GetSize( const vlc_threadpool_t * );
+
+/**
+ * Creates a group of tasks, which are waited for or cancelled together.
+ *
+ * \param i_priority priority of all the tasks of the group
+ * (see \ref vlc_threadpool_priority)
+ */
+VLC_API vlc_threadpool_group_t *vlc_threadpool_group_New( vlc_threadpool_t *,
+                                                          int i_priority ) VLC_USED;
+
+/**
+ * Cancels the tasks of the group which are still queued, waits for the
+ * running ones and deletes the group.
+ */
+VLC_API void vlc_threadpool_group_Delete( vlc_threadpool_group_t * );
+
+/**
+ * Queues a task.
+ *
+ * \param pf_run task function, called from a worker or from a thread
+ * waiting for the group
+ * \param i_affinity affinity hint: tasks with the same hint are queued on
+ * the same worker, to keep their data in the same CPU caches across calls
+ * (e.g. the same picture band from frame to frame); or VLC_THREADPOOL_ANY
+ * \return VLC_SUCCESS, or VLC_ENOMEM
+ */
+VLC_API int vlc_threadpool_group_Submit( vlc_threadpool_group_t *,
+                                         void (*pf_run)( void * ), void *data,
+                                         int i_affinity );
+
+/**
+ * Waits until all the tasks of the group are done, running the queued ones
+ * from the calling thread meanwhile.
+ *
+ * This function is interruptible (see vlc_interrupt_set()): when
+ * interrupted, the group is cancelled as with vlc_threadpool_group_Cancel(),
+ * and the running tasks are still waited for.
+ *
+ * \return VLC_SUCCESS, or VLC_EGENERIC if the group was cancelled, in which
+ * case some tasks may not have run
+ */
+VLC_API int vlc_threadpool_group_Wait( vlc_threadpool_group_t * );
+
+/**
+ * Cancels the tasks of the group which are not started yet.
+ *
+ * Running tasks can poll vlc_threadpool_group_IsCancelled() to stop early.
+ * The group can be reused for new tasks once vlc_threadpool_group_Wait()
+ * has returned.
+ */
+VLC_API void vlc_threadpool_group_Cancel( vlc_threadpool_group_t * );
+
+/**
+ * Tells whether the group was cancelled since it was last waited for.
+ */
+VLC_API bool vlc_threadpool_group_IsCancelled( vlc_threadpool_group_t * ) VLC_USED;
+
+/**
+ * Runs pf_run( opaque, i, i_count ) for i from 0 to i_count - 1 on the
+ * pool, and waits for all of them. The calling thread runs its share.
+ *
+ * The task index is used as affinity hint. This does not allocate memory
+ * for up to 64 tasks, so that it can be used on each picture.
+ *
+ * \return VLC_SUCCESS, or VLC_EGENERIC if interrupted before all the
+ * tasks were run
+ */
+VLC_API int vlc_threadpool_Run( vlc_threadpool_t *, unsigned i_count,
+                                void (*pf_run)( void *opaque, unsigned i,
+                                                unsigned i_count ),
+                                void *opaque, int i_priority );
+
+/** @} */
+
+#endif
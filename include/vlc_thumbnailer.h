@@ -0,0 +1,110 @@
+/*****************************************************************************
+ * vlc_thumbnailer.h: batch picture extraction
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_THUMBNAILER_H
+#define VLC_THUMBNAILER_H 1
+
+#include <vlc_block.h>
+#include <vlc_es.h>
+
+/**
+ * \defgroup thumbnailer Thumbnailer
+ * \ingroup input
+ * Batch picture extraction
+ *
+ * The thumbnailer extracts pictures from many media concurrently, with a
+ * bounded number of worker threads. Each worker processes one media at a
+ * time, without input thread, clock nor video output: it demuxes the video
+ * track only, seeks to each requested time, decodes from the preceding
+ * random access point and keeps the first picture. Non-key frames are
+ * skipped wherever the demuxer or the decoder can tell them apart.
+ * @{
+ * \file
+ * Thumbnailer functions
+ */
+
+typedef struct vlc_thumbnailer_t vlc_thumbnailer_t;
+
+typedef struct
+{
+    input_item_t  *p_item;  /**< Requested media */
+    size_t         i_index; /**< Index of the requested picture */
+    mtime_t        i_time;  /**< Time of the picture, or VLC_TS_INVALID */
+    video_format_t fmt;     /**< Format of the picture */
+    /** Encoded image, or packed raw picture (planes and lines without
+     * padding), or NULL on error. Valid during the callback only. */
+    block_t       *p_block;
+} vlc_thumbnail_t;
+
+/**
+ * Receives a picture. This is called from a worker thread.
+ */
+typedef void (*vlc_thumbnailer_cb)( void *opaque, const vlc_thumbnail_t * );
+
+/**
+ * Creates a thumbnailer.
+ *
+ * \param i_threads maximum number of media processed at once, 0 for the
+ * number of CPUs
+ * \return a thumbnailer or NULL on error
+ */
+VLC_API vlc_thumbnailer_t *vlc_thumbnailer_New( vlc_object_t *,
+                                                unsigned i_threads ) VLC_USED;
+#define vlc_thumbnailer_New(a, b) vlc_thumbnailer_New(VLC_OBJECT(a), b)
+
+/**
+ * Cancels all the requests and deletes the thumbnailer.
+ *
+ * The callbacks of the cancelled requests are called before this returns.
+ */
+VLC_API void vlc_thumbnailer_Delete( vlc_thumbnailer_t * );
+
+/**
+ * Queues the extraction of pictures from a media.
+ *
+ * The callback is called exactly once per requested picture, with the
+ * picture or with a NULL block on error or cancellation, in increasing
+ * time order.
+ *
+ * \param pi_times times of the pictures, or NULL for i_count pictures
+ * spread evenly over the media
+ * \param i_width maximum width of the pictures, 0 for no limit
+ * \param i_height maximum height of the pictures, 0 for no limit
+ * \param i_codec image codec (e.g. VLC_CODEC_PNG, VLC_CODEC_JPEG), or raw
+ * picture chroma (e.g. VLC_CODEC_RGB32)
+ * \return VLC_SUCCESS, or an error code (the callback is not called then)
+ */
+VLC_API int vlc_thumbnailer_Request( vlc_thumbnailer_t *, input_item_t *,
+                                     const mtime_t *pi_times, size_t i_count,
+                                     unsigned i_width, unsigned i_height,
+                                     vlc_fourcc_t i_codec,
+                                     vlc_thumbnailer_cb pf_cb, void *opaque );
+
+/**
+ * Cancels the requests of a media, or all of them if p_item is NULL.
+ *
+ * This does not wait: the callbacks of the cancelled requests are called
+ * later, from a worker thread or from this function.
+ */
+VLC_API void vlc_thumbnailer_Cancel( vlc_thumbnailer_t *, input_item_t *p_item );
+
+/** @} */
+
+#endif
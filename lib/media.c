@@ -783,6 +783,8 @@ static int media_parse(libvlc_media_t *media, bool b_async,
         if (parse_flag & libvlc_media_fetch_network)
             art_scope |= META_REQUEST_OPTION_SCOPE_NETWORK;
         if (art_scope != META_REQUEST_OPTION_NONE) {
+            if (parse_flag & libvlc_media_parse_priority)
+                art_scope |= META_REQUEST_OPTION_PRIORITY;
             ret = libvlc_ArtRequest(libvlc, item, art_scope);
             if (ret != VLC_SUCCESS)
                 return ret;
@@ -792,6 +794,8 @@ static int media_parse(libvlc_media_t *media, bool b_async,
             parse_scope |= META_REQUEST_OPTION_SCOPE_NETWORK;
         if (parse_flag & libvlc_media_do_interact)
             parse_scope |= META_REQUEST_OPTION_DO_INTERACT;
+        if (parse_flag & libvlc_media_parse_priority)
+            parse_scope |= META_REQUEST_OPTION_PRIORITY;
         ret = libvlc_MetadataRequest(libvlc, item, parse_scope, timeout, media);
         if (ret != VLC_SUCCESS)
             return ret;
@@ -0,0 +1,187 @@
+/*****************************************************************************
+ * media_thumbnailer.c: libvlc batch thumbnailer
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc/libvlc.h>
+#include <vlc/libvlc_media.h>
+#include <vlc/libvlc_media_thumbnailer.h>
+
+#include <vlc_common.h>
+#include <vlc_thumbnailer.h>
+
+#include "libvlc_internal.h"
+#include "media_internal.h"
+
+struct libvlc_media_thumbnailer_t
+{
+    libvlc_instance_t *p_libvlc_instance;
+    vlc_thumbnailer_t *p_thumb;
+};
+
+typedef struct
+{
+    libvlc_media_t     *p_md;
+    libvlc_thumbnail_cb cb;
+    void               *opaque;
+    unsigned            i_remaining;
+} request_t;
+
+/* Callbacks of a request are serialized: no locking needed */
+static void on_thumbnail( void *data, const vlc_thumbnail_t *p_thumb )
+{
+    request_t *req = data;
+    const void *p_data = NULL;
+    size_t i_size = 0;
+
+    if( p_thumb->p_block != NULL )
+    {
+        p_data = p_thumb->p_block->p_buffer;
+        i_size = p_thumb->p_block->i_buffer;
+    }
+
+    req->cb( req->opaque, req->p_md, p_thumb->i_index,
+             p_thumb->i_time > VLC_TS_INVALID
+                 ? from_mtime( p_thumb->i_time - VLC_TS_0 ) : -1,
+             p_data, i_size,
+             p_thumb->fmt.i_visible_width, p_thumb->fmt.i_visible_height );
+
+    assert( req->i_remaining > 0 );
+    if( --req->i_remaining == 0 )
+    {
+        libvlc_media_release( req->p_md );
+        free( req );
+    }
+}
+
+libvlc_media_thumbnailer_t *
+libvlc_media_thumbnailer_new( libvlc_instance_t *p_instance,
+                              unsigned i_threads )
+{
+    libvlc_media_thumbnailer_t *p_mt = malloc( sizeof( *p_mt ) );
+    if( unlikely(p_mt == NULL) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return NULL;
+    }
+
+    p_mt->p_thumb = vlc_thumbnailer_New( p_instance->p_libvlc_int, i_threads );
+    if( p_mt->p_thumb == NULL )
+    {
+        libvlc_printerr( "Cannot start thumbnailer" );
+        free( p_mt );
+        return NULL;
+    }
+
+    p_mt->p_libvlc_instance = p_instance;
+    libvlc_retain( p_instance );
+    return p_mt;
+}
+
+void libvlc_media_thumbnailer_release( libvlc_media_thumbnailer_t *p_mt )
+{
+    vlc_thumbnailer_Delete( p_mt->p_thumb );
+    libvlc_release( p_mt->p_libvlc_instance );
+    free( p_mt );
+}
+
+int libvlc_media_thumbnailer_request( libvlc_media_thumbnailer_t *p_mt,
+                                      libvlc_media_t *p_md,
+                                      const libvlc_time_t *p_times,
+                                      unsigned i_count,
+                                      unsigned i_width, unsigned i_height,
+                                      libvlc_thumbnail_type_t i_type,
+                                      libvlc_thumbnail_cb cb, void *opaque )
+{
+    vlc_fourcc_t i_codec;
+
+    switch( i_type )
+    {
+        case libvlc_thumbnail_png:
+            i_codec = VLC_CODEC_PNG;
+            break;
+        case libvlc_thumbnail_jpg:
+            i_codec = VLC_CODEC_JPEG;
+            break;
+        case libvlc_thumbnail_rgba:
+            i_codec = VLC_CODEC_RGBA;
+            break;
+        default:
+            libvlc_printerr( "Unknown thumbnail type" );
+            return -1;
+    }
+
+    if( i_count == 0 )
+    {
+        libvlc_printerr( "No thumbnail requested" );
+        return -1;
+    }
+
+    mtime_t *pi_times = NULL;
+    if( p_times != NULL )
+    {
+        pi_times = malloc( i_count * sizeof( *pi_times ) );
+        if( unlikely(pi_times == NULL) )
+        {
+            libvlc_printerr( "Not enough memory" );
+            return -1;
+        }
+        for( unsigned i = 0; i < i_count; i++ )
+            pi_times[i] = to_mtime( p_times[i] );
+    }
+
+    request_t *req = malloc( sizeof( *req ) );
+    if( unlikely(req == NULL) )
+    {
+        free( pi_times );
+        libvlc_printerr( "Not enough memory" );
+        return -1;
+    }
+
+    req->p_md = p_md;
+    req->cb = cb;
+    req->opaque = opaque;
+    req->i_remaining = i_count;
+    libvlc_media_retain( p_md );
+
+    int ret = vlc_thumbnailer_Request( p_mt->p_thumb, p_md->p_input_item,
+                                       pi_times, i_count, i_width, i_height,
+                                       i_codec, on_thumbnail, req );
+    free( pi_times );
+    if( ret != VLC_SUCCESS )
+    {
+        libvlc_media_release( p_md );
+        free( req );
+        libvlc_printerr( "Cannot request thumbnails" );
+        return -1;
+    }
+    return 0;
+}
+
+void libvlc_media_thumbnailer_cancel( libvlc_media_thumbnailer_t *p_mt,
+                                      libvlc_media_t *p_md )
+{
+    vlc_thumbnailer_Cancel( p_mt->p_thumb,
+                            p_md != NULL ? p_md->p_input_item : NULL );
+}
@@ -70,6 +70,11 @@
 #define FPS_TEXT N_( "Frame rate" )
 #define FPS_LONGTEXT N_( "Maximum frame rate to use (0 = no limits)." )
 
+#define ZERO_COPY_TEXT N_( "Zero-copy capture" )
+#define ZERO_COPY_LONGTEXT N_( \
+    "Pass memory-mapped capture buffers downstream instead of copying " \
+    "each frame. More buffers are allocated as needed." )
+
 #define RADIO_DEVICE_TEXT N_( "Radio device" )
 #define RADIO_DEVICE_LONGTEXT N_("Radio tuner device node." )
 #define FREQUENCY_TEXT N_("Frequency")
@@ -312,6 +317,8 @@ vlc_module_begin ()
         change_safe()
     add_string( CFG_PREFIX "fps", "60", FPS_TEXT, FPS_LONGTEXT, false )
         change_safe()
+    add_bool( CFG_PREFIX "zero-copy", true, ZERO_COPY_TEXT,
+              ZERO_COPY_LONGTEXT, true )
     add_obsolete_bool( CFG_PREFIX "use-libv4l2" ) /* since 2.1.0 */
 
     set_section( N_( "Tuner" ), NULL )
@@ -579,11 +579,190 @@ mtime_t GetBufferPTS (const struct v4l2_buffer *buf)
     return pts;
 }
 
+struct buffer_t
+{
+    void *  start;
+    size_t  length;
+    bool    lent;
+};
+
+/**
+ * Memory-mapped buffers.
+ *
+ * Captured frames are lent downstream rather than copied: the block wraps the
+ * dequeued buffer and its release queues it back. The driver must always keep
+ * a few buffers to capture into though. If downstream holds too many of them,
+ * more buffers are created, and failing that, frames are copied.
+ *
+ * The pool outlives StopMmap() until the last lent buffer is released.
+ */
+struct vlc_v4l2_pool
+{
+    int fd;
+    vlc_mutex_t lock;
+    bool streaming; /**< Whether buffers are queued back when released */
+    bool lend;
+    bool grow; /**< Whether more buffers can be created */
+    uint32_t count; /**< Allocated buffers */
+    uint32_t queued; /**< Buffers owned by the driver */
+    uint32_t lent; /**< Buffers held downstream */
+    uint32_t max_lent;
+    unsigned long lends;
+    unsigned long copies;
+    struct buffer_t bufv[VIDEO_MAX_FRAME];
+};
+
+/* Buffers left to the driver while one is being dequeued */
+#define POOL_MIN_QUEUED 2
+
+typedef struct
+{
+    block_t self;
+    vlc_v4l2_pool_t *pool;
+    uint32_t index;
+} lent_block_t;
+
+static void PoolDestroy (vlc_v4l2_pool_t *pool)
+{
+    vlc_mutex_destroy (&pool->lock);
+    free (pool);
+}
+
+static void LentBlockRelease (block_t *block)
+{
+    lent_block_t *lb = (lent_block_t *)block;
+    vlc_v4l2_pool_t *pool = lb->pool;
+    struct buffer_t *buffer = &pool->bufv[lb->index];
+
+    vlc_mutex_lock (&pool->lock);
+    assert (buffer->lent);
+    buffer->lent = false;
+    pool->lent--;
+
+    if (pool->streaming)
+    {
+        struct v4l2_buffer buf = {
+            .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+            .memory = V4L2_MEMORY_MMAP,
+            .index = lb->index,
+        };
+
+        if (v4l2_ioctl (pool->fd, VIDIOC_QBUF, &buf) == 0)
+            pool->queued++;
+    }
+    else
+        v4l2_munmap (buffer->start, buffer->length);
+
+    bool last = !pool->streaming && pool->lent == 0;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (last)
+        PoolDestroy (pool);
+    free (lb);
+}
+
+/** Maps and queues the next buffer of the pool. */
+static int PoolMapBuffer (vlc_object_t *obj, vlc_v4l2_pool_t *pool)
+{
+    uint32_t index = pool->count;
+    struct v4l2_buffer buf = {
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .memory = V4L2_MEMORY_MMAP,
+        .index = index,
+    };
+
+    if (v4l2_ioctl (pool->fd, VIDIOC_QUERYBUF, &buf) < 0)
+    {
+        msg_Err (obj, "cannot query buffer %"PRIu32": %s", index,
+                 vlc_strerror_c(errno));
+        return -1;
+    }
+
+    struct buffer_t *buffer = &pool->bufv[index];
+
+    buffer->start = v4l2_mmap (NULL, buf.length, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, pool->fd, buf.m.offset);
+    if (buffer->start == MAP_FAILED)
+    {
+        msg_Err (obj, "cannot map buffer %"PRIu32": %s", index,
+                 vlc_strerror_c(errno));
+        return -1;
+    }
+    buffer->length = buf.length;
+    buffer->lent = false;
+    pool->count++;
+
+    /* Some drivers refuse to queue buffers before they are mapped. Bug? */
+    if (v4l2_ioctl (pool->fd, VIDIOC_QBUF, &buf) < 0)
+    {
+        msg_Err (obj, "cannot queue buffer %"PRIu32": %s", index,
+                 vlc_strerror_c(errno));
+        return -1;
+    }
+    pool->queued++;
+    return 0;
+}
+
+/** Adds one buffer to a streaming pool. Called with the pool lock held. */
+static bool PoolGrow (vlc_object_t *obj, vlc_v4l2_pool_t *pool)
+{
+    if (!pool->grow || pool->count >= VIDEO_MAX_FRAME)
+        return false;
+
+    struct v4l2_create_buffers create = {
+        .count = 1,
+        .memory = V4L2_MEMORY_MMAP,
+        .format = {
+            .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        },
+    };
+
+    if (v4l2_ioctl (pool->fd, VIDIOC_G_FMT, &create.format) < 0
+     || v4l2_ioctl (pool->fd, VIDIOC_CREATE_BUFS, &create) < 0
+     || create.count == 0)
+    {
+        msg_Dbg (obj, "cannot add buffers: %s", vlc_strerror_c(errno));
+        pool->grow = false;
+        return false;
+    }
+
+    if (create.index != pool->count || PoolMapBuffer (obj, pool))
+    {
+        pool->grow = false;
+        return false;
+    }
+    msg_Dbg (obj, "%"PRIu32" buffers held downstream, now %"PRIu32
+             " memory-mapped buffers", pool->lent, pool->count);
+    return true;
+}
+
+static block_t *PoolLend (vlc_v4l2_pool_t *pool,
+                          const struct v4l2_buffer *restrict buf)
+{
+    lent_block_t *lb = malloc (sizeof (*lb));
+    if (unlikely(lb == NULL))
+        return NULL;
+
+    struct buffer_t *buffer = &pool->bufv[buf->index];
+
+    block_Init (&lb->self, buffer->start, buffer->length);
+    lb->self.i_buffer = buf->bytesused;
+    lb->self.pf_release = LentBlockRelease;
+    lb->pool = pool;
+    lb->index = buf->index;
+
+    buffer->lent = true;
+    pool->lent++;
+    if (pool->lent > pool->max_lent)
+        pool->max_lent = pool->lent;
+    pool->lends++;
+    return &lb->self;
+}
+
 /*****************************************************************************
  * GrabVideo: Grab a video frame
  *****************************************************************************/
-block_t *GrabVideo (vlc_object_t *demux, int fd,
-                    const struct buffer_t *restrict bufv)
+block_t *GrabVideo (vlc_object_t *demux, vlc_v4l2_pool_t *pool)
 {
     struct v4l2_buffer buf = {
         .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
@@ -591,7 +770,7 @@ block_t *GrabVideo (vlc_object_t *demux, int fd,
     };
 
     /* Wait for next frame */
-    if (v4l2_ioctl (fd, VIDIOC_DQBUF, &buf) < 0)
+    if (v4l2_ioctl (pool->fd, VIDIOC_DQBUF, &buf) < 0)
     {
         switch (errno)
         {
@@ -606,20 +785,49 @@ block_t *GrabVideo (vlc_object_t *demux, int fd,
         }
     }
 
-    /* Copy frame */
-    block_t *block = block_Alloc (buf.bytesused);
-    if (unlikely(block == NULL))
-        return NULL;
-    block->i_pts = block->i_dts = GetBufferPTS (&buf);
-    memcpy (block->p_buffer, bufv[buf.index].start, buf.bytesused);
+    block_t *block = NULL;
 
-    /* Unlock */
-    if (v4l2_ioctl (fd, VIDIOC_QBUF, &buf) < 0)
+    vlc_mutex_lock (&pool->lock);
+    assert (buf.index < pool->count && pool->queued > 0);
+    pool->queued--;
+    if (pool->lend)
     {
-        msg_Err (demux, "queue error: %s", vlc_strerror_c(errno));
-        block_Release (block);
-        return NULL;
+        if (pool->queued < POOL_MIN_QUEUED)
+            PoolGrow (demux, pool);
+        if (pool->queued >= POOL_MIN_QUEUED)
+            block = PoolLend (pool, &buf);
+    }
+    vlc_mutex_unlock (&pool->lock);
+
+    if (block == NULL)
+    {
+        /* Copy frame */
+        block = block_Alloc (buf.bytesused);
+        if (likely(block != NULL))
+            memcpy (block->p_buffer, pool->bufv[buf.index].start,
+                    buf.bytesused);
+
+        /* Unlock */
+        vlc_mutex_lock (&pool->lock);
+        if (v4l2_ioctl (pool->fd, VIDIOC_QBUF, &buf) == 0)
+            pool->queued++;
+        else
+        {
+            msg_Err (demux, "queue error: %s", vlc_strerror_c(errno));
+            if (block != NULL)
+            {
+                block_Release (block);
+                block = NULL;
+            }
+        }
+        pool->copies++;
+        vlc_mutex_unlock (&pool->lock);
+
+        if (block == NULL)
+            return NULL;
     }
+
+    block->i_pts = block->i_dts = GetBufferPTS (&buf);
     return block;
 }
 
@@ -651,9 +859,9 @@ int StartUserPtr (vlc_object_t *obj, int fd)
 /**
  * Allocates memory-mapped buffers, queues them and start streaming.
  * @param n requested buffers count [IN], allocated buffers count [OUT]
- * @return array of allocated buffers (use free()), or NULL on error.
+ * @return buffers pool (use StopMmap()), or NULL on error.
  */
-struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
+vlc_v4l2_pool_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
 {
     struct v4l2_requestbuffers req = {
         .count = *n,
@@ -673,45 +881,27 @@ struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
         return NULL;
     }
 
-    struct buffer_t *bufv = malloc (req.count * sizeof (*bufv));
-    if (unlikely(bufv == NULL))
+    vlc_v4l2_pool_t *pool = malloc (sizeof (*pool));
+    if (unlikely(pool == NULL))
         return NULL;
 
-    uint32_t bufc = 0;
-    while (bufc < req.count)
-    {
-        struct v4l2_buffer buf = {
-            .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-            .memory = V4L2_MEMORY_MMAP,
-            .index = bufc,
-        };
-
-        if (v4l2_ioctl (fd, VIDIOC_QUERYBUF, &buf) < 0)
-        {
-            msg_Err (obj, "cannot query buffer %"PRIu32": %s", bufc,
-                     vlc_strerror_c(errno));
+    pool->fd = fd;
+    vlc_mutex_init (&pool->lock);
+    pool->streaming = true;
+    pool->lend = var_InheritBool (obj, CFG_PREFIX"zero-copy");
+    pool->grow = true;
+    pool->count = 0;
+    pool->queued = 0;
+    pool->lent = 0;
+    pool->max_lent = 0;
+    pool->lends = 0;
+    pool->copies = 0;
+
+    if (req.count > VIDEO_MAX_FRAME)
+        req.count = VIDEO_MAX_FRAME;
+    while (pool->count < req.count)
+        if (PoolMapBuffer (obj, pool))
             goto error;
-        }
-
-        bufv[bufc].start = v4l2_mmap (NULL, buf.length, PROT_READ | PROT_WRITE,
-                                      MAP_SHARED, fd, buf.m.offset);
-        if (bufv[bufc].start == MAP_FAILED)
-        {
-            msg_Err (obj, "cannot map buffer %"PRIu32": %s", bufc,
-                     vlc_strerror_c(errno));
-            goto error;
-        }
-        bufv[bufc].length = buf.length;
-        bufc++;
-
-        /* Some drivers refuse to queue buffers before they are mapped. Bug? */
-        if (v4l2_ioctl (fd, VIDIOC_QBUF, &buf) < 0)
-        {
-            msg_Err (obj, "cannot queue buffer %"PRIu32": %s", bufc,
-                     vlc_strerror_c(errno));
-            goto error;
-        }
-    }
 
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     if (v4l2_ioctl (fd, VIDIOC_STREAMON, &type) < 0)
@@ -719,20 +909,34 @@ struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
         msg_Err (obj, "cannot start streaming: %s", vlc_strerror_c(errno));
         goto error;
     }
-    *n = bufc;
-    return bufv;
+    *n = pool->count;
+    return pool;
 error:
-    StopMmap (fd, bufv, bufc);
+    StopMmap (obj, pool);
     return NULL;
 }
 
-void StopMmap (int fd, struct buffer_t *bufv, uint32_t bufc)
+void StopMmap (vlc_object_t *obj, vlc_v4l2_pool_t *pool)
 {
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
+    vlc_mutex_lock (&pool->lock);
     /* STREAMOFF implicitly dequeues all buffers */
-    v4l2_ioctl (fd, VIDIOC_STREAMOFF, &type);
-    for (uint32_t i = 0; i < bufc; i++)
-        v4l2_munmap (bufv[i].start, bufv[i].length);
-    free (bufv);
+    v4l2_ioctl (pool->fd, VIDIOC_STREAMOFF, &type);
+    pool->streaming = false;
+
+    /* Lent buffers are unmapped when released */
+    for (uint32_t i = 0; i < pool->count; i++)
+        if (!pool->bufv[i].lent)
+            v4l2_munmap (pool->bufv[i].start, pool->bufv[i].length);
+
+    msg_Dbg (obj, "%lu frames lent, %lu copied, up to %"PRIu32" of %"PRIu32
+             " buffers held downstream", pool->lends, pool->copies,
+             pool->max_lent, pool->count);
+
+    bool last = pool->lent == 0;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (last)
+        PoolDestroy (pool);
 }
@@ -35,6 +35,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
+#include <limits.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -43,6 +44,8 @@
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_charset.h>
+#include <vlc_memstream.h>
+#include <vlc_httpd.h>
 
 #include <gcrypt.h>
 #include <vlc_gcrypt.h>
@@ -57,6 +60,9 @@
 
 #define MAX_RENAME_RETRIES        10
 
+/* Partial segments are listed for the last complete segments only */
+#define PART_SEGMENTS             3
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -105,6 +111,23 @@ static void Close( vlc_object_t * );
 #define INTITIAL_SEG_TEXT N_("Number of first segment")
 #define INITIAL_SEG_LONGTEXT N_("The number of the first segment generated")
 
+#define PARTDURATION_TEXT N_("Partial segment duration")
+#define PARTDURATION_LONGTEXT N_("Duration in seconds of the low-latency "\
+                                 "partial segments (EXT-X-PART) announced in "\
+                                 "the index while a segment is being written. "\
+                                 "0 disables them. Encrypted segments have no "\
+                                 "partial segments.")
+
+#define QUEUESIZE_TEXT N_("Writer queue size (MiB)")
+#define QUEUESIZE_LONGTEXT N_("Amount of data waiting to be encrypted and "\
+                              "written before the stream output is held back")
+
+#define HTTPPATH_TEXT N_("HTTP path")
+#define HTTPPATH_LONGTEXT N_("Also serve the index and the segments from "\
+                             "memory with the HTTP server (http-host and "\
+                             "http-port) under this path. Requires a "\
+                             "number of segments.")
+
 vlc_module_begin ()
     set_description( N_("HTTP Live streaming output") )
     set_shortname( N_("LiveHTTP" ))
@@ -135,6 +158,12 @@ vlc_module_begin ()
                 KEYFILE_TEXT, KEYFILE_LONGTEXT, true )
     add_loadfile( SOUT_CFG_PREFIX "key-loadfile", NULL,
                 KEYLOADFILE_TEXT, KEYLOADFILE_LONGTEXT, true )
+    add_float( SOUT_CFG_PREFIX "part-duration", 0.,
+               PARTDURATION_TEXT, PARTDURATION_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "queue-size", 32,
+                 QUEUESIZE_TEXT, QUEUESIZE_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "http-path", NULL,
+                HTTPPATH_TEXT, HTTPPATH_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -156,12 +185,33 @@ static const char *const ppsz_sout_options[] = {
     "key-loadfile",
     "generate-iv",
     "initial-segment-number",
+    "part-duration",
+    "queue-size",
+    "http-path",
     NULL
 };
 
 static ssize_t Write( sout_access_out_t *, block_t * );
 static int Control( sout_access_out_t *, int, va_list );
 
+/* In-memory copy of a file served by the HTTP server */
+struct httpd_file_sys_t
+{
+    vlc_mutex_t *p_lock;
+    httpd_file_t *p_file;
+    uint8_t *p_data;
+    size_t i_data;
+    size_t i_alloc;
+};
+
+typedef struct
+{
+    uint64_t i_offset;
+    size_t i_size;
+    mtime_t i_duration;
+    bool b_independent;
+} output_part_t;
+
 typedef struct output_segment
 {
     char *psz_filename;
@@ -171,28 +221,53 @@ typedef struct output_segment
     float f_seglength;
     uint32_t i_segment_number;
     uint8_t aes_ivs[16];
+    output_part_t *p_parts;
+    size_t i_parts;
+    httpd_file_sys_t *p_mem;
 } output_segment_t;
 
+enum
+{
+    JOB_OPEN,   /* open the segment file and set up its encryption */
+    JOB_DATA,   /* encrypt and write blocks to the current segment */
+    JOB_CLOSE,  /* write the encryption padding and close the segment */
+    JOB_INDEX,  /* publish the index */
+    JOB_DROP,   /* the segment left the index, delete it */
+};
+
+typedef struct writer_job
+{
+    struct writer_job *p_next;
+    int i_type;
+    output_segment_t *segment;
+    block_t *p_data;
+    size_t i_size;
+    char *psz_index;
+    char *psz_mem_index;
+    bool b_unlink;
+    uint8_t aes_key[16];
+    uint8_t aes_ivs[16];
+} writer_job_t;
+
 struct sout_access_out_sys_t
 {
-    char *psz_cursegPath;
     char *psz_indexPath;
     char *psz_indexUrl;
     char *psz_keyfile;
     mtime_t i_keyfile_modification;
     mtime_t i_opendts;
+    mtime_t i_enddts;
     mtime_t i_dts_offset;
     mtime_t  i_seglenm;
     uint32_t i_segment;
     size_t  i_seglen;
     float   f_seglen;
-    block_t *full_segments;
-    block_t **full_segments_end;
-    block_t *ongoing_segment;
-    block_t **ongoing_segment_end;
-    int i_handle;
+    output_segment_t *p_cursegment;
+    uint64_t i_segoffset;
     unsigned i_numsegs;
     unsigned i_initial_segment;
+    uint32_t i_firstseg;
+    unsigned i_index_offset;
     bool b_delsegs;
     bool b_ratecontrol;
     bool b_splitanywhere;
@@ -200,18 +275,155 @@ struct sout_access_out_sys_t
     bool b_generate_iv;
     bool b_segment_has_data;
     uint8_t aes_ivs[16];
-    gcry_cipher_hd_t aes_ctx;
+    uint8_t aes_key[16];
     char *key_uri;
+    vlc_array_t segments_t;
+
+    /* partial segments */
+    mtime_t i_partlenm;
+    mtime_t i_partdts;
+    uint64_t i_partoffset;
+    bool b_part_independent;
+
+    /* blocks not yet handed to the writer */
+    block_t *p_pending;
+    block_t **pp_pending_last;
+    size_t i_pending;
+
+    /* in-memory publication */
+    char *psz_httpPath;
+    httpd_host_t *p_httpd_host;
+    httpd_file_sys_t *p_index_mem;
+    vlc_mutex_t http_lock;
+
+    /* writer thread queue */
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait_job;
+    vlc_cond_t wait_space;
+    writer_job_t *p_jobs;
+    writer_job_t **pp_jobs_last;
+    size_t i_queued;
+    size_t i_queue_max;
+    bool b_exit;
+    bool b_error;
+
+    /* writer thread state */
+    int i_handle;
+    httpd_file_sys_t *p_curmem;
+    gcry_cipher_hd_t aes_ctx;
+    bool b_crypt;
     uint8_t stuffing_bytes[16];
     ssize_t stuffing_size;
-    vlc_array_t segments_t;
 };
 
 static int LoadCryptFile( sout_access_out_t *p_access);
 static int CryptSetup( sout_access_out_t *p_access, char *keyfile );
-static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer );
-static ssize_t writeSegment( sout_access_out_t *p_access );
-static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys );
+static void *WriterThread( void * );
+static void destroySegment( output_segment_t *segment );
+static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend );
+
+/*****************************************************************************
+ * In-memory files
+ *****************************************************************************/
+static int memFileFill( httpd_file_sys_t *p_mem, httpd_file_t *p_file,
+                        uint8_t *psz_request, uint8_t **pp_data, int *pi_data )
+{
+    VLC_UNUSED(p_file);
+    uint64_t i_offset = 0;
+    size_t i_size = SIZE_MAX;
+
+    /* partial segments are requested as ?offset=X&size=Y */
+    if( psz_request && *psz_request &&
+        sscanf( (const char *)psz_request, "offset=%"SCNu64"&size=%zu",
+                &i_offset, &i_size ) != 2 )
+    {
+        i_offset = 0;
+        i_size = SIZE_MAX;
+    }
+
+    *pp_data = NULL;
+    *pi_data = 0;
+
+    vlc_mutex_lock( p_mem->p_lock );
+    if( i_offset < p_mem->i_data )
+    {
+        i_size = __MIN( i_size, p_mem->i_data - i_offset );
+        if( i_size <= INT_MAX && ( *pp_data = malloc( i_size ) ) )
+        {
+            memcpy( *pp_data, &p_mem->p_data[i_offset], i_size );
+            *pi_data = i_size;
+        }
+    }
+    vlc_mutex_unlock( p_mem->p_lock );
+    return VLC_SUCCESS;
+}
+
+static httpd_file_sys_t *memFileNew( sout_access_out_sys_t *p_sys,
+                                     const char *psz_path, const char *psz_mime )
+{
+    const char *psz_name = strrchr( psz_path, DIR_SEP_CHAR );
+    psz_name = psz_name ? psz_name + 1 : psz_path;
+
+    httpd_file_sys_t *p_mem = calloc( 1, sizeof( *p_mem ) );
+    if( unlikely( !p_mem ) )
+        return NULL;
+
+    char *psz_url;
+    if( asprintf( &psz_url, "%s/%s", p_sys->psz_httpPath, psz_name ) < 0 )
+    {
+        free( p_mem );
+        return NULL;
+    }
+
+    p_mem->p_lock = &p_sys->http_lock;
+    p_mem->p_file = httpd_FileNew( p_sys->p_httpd_host, psz_url, psz_mime,
+                                   NULL, NULL, memFileFill, p_mem );
+    free( psz_url );
+    if( !p_mem->p_file )
+    {
+        free( p_mem );
+        return NULL;
+    }
+    return p_mem;
+}
+
+static void memFileDelete( httpd_file_sys_t *p_mem )
+{
+    httpd_FileDelete( p_mem->p_file );
+    free( p_mem->p_data );
+    free( p_mem );
+}
+
+static void memFileAppend( httpd_file_sys_t *p_mem, const uint8_t *p_data, size_t i_data )
+{
+    vlc_mutex_lock( p_mem->p_lock );
+    if( p_mem->i_data + i_data > p_mem->i_alloc )
+    {
+        size_t i_alloc = __MAX( 2 * p_mem->i_alloc, p_mem->i_data + i_data );
+        uint8_t *p_realloc = realloc( p_mem->p_data, i_alloc );
+        if( unlikely( !p_realloc ) )
+        {
+            vlc_mutex_unlock( p_mem->p_lock );
+            return;
+        }
+        p_mem->p_data = p_realloc;
+        p_mem->i_alloc = i_alloc;
+    }
+    memcpy( &p_mem->p_data[p_mem->i_data], p_data, i_data );
+    p_mem->i_data += i_data;
+    vlc_mutex_unlock( p_mem->p_lock );
+}
+
+static void memFileReplace( httpd_file_sys_t *p_mem, char *psz_data )
+{
+    vlc_mutex_lock( p_mem->p_lock );
+    free( p_mem->p_data );
+    p_mem->p_data = (uint8_t *)psz_data;
+    p_mem->i_data = p_mem->i_alloc = strlen( psz_data );
+    vlc_mutex_unlock( p_mem->p_lock );
+}
+
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -236,11 +448,6 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_seglen = var_GetInteger( p_access, SOUT_CFG_PREFIX "seglen" );
 
     p_sys->i_seglenm = CLOCK_FREQ * p_sys->i_seglen;
-    p_sys->full_segments = NULL;
-    p_sys->full_segments_end = &p_sys->full_segments;
-
-    p_sys->ongoing_segment = NULL;
-    p_sys->ongoing_segment_end = &p_sys->ongoing_segment;
 
     p_sys->i_numsegs = var_GetInteger( p_access, SOUT_CFG_PREFIX "numsegs" );
     p_sys->i_initial_segment = var_GetInteger( p_access, SOUT_CFG_PREFIX "initial-segment-number" );
@@ -251,11 +458,19 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_generate_iv = var_GetBool( p_access, SOUT_CFG_PREFIX "generate-iv") ;
     p_sys->b_segment_has_data = false;
 
+    float f_partlen = var_GetFloat( p_access, SOUT_CFG_PREFIX "part-duration" );
+    if( f_partlen > 0.f && f_partlen < p_sys->i_seglen )
+        p_sys->i_partlenm = f_partlen * CLOCK_FREQ;
+
+    int64_t i_queue = var_GetInteger( p_access, SOUT_CFG_PREFIX "queue-size" );
+    p_sys->i_queue_max = __MAX( i_queue, 1 ) << 20;
+
     vlc_array_init( &p_sys->segments_t );
 
     p_sys->stuffing_size = 0;
     p_sys->i_opendts = VLC_TS_INVALID;
     p_sys->i_dts_offset  = 0;
+    p_sys->pp_pending_last = &p_sys->p_pending;
 
     p_sys->psz_indexPath = NULL;
     psz_idx = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "index" );
@@ -282,29 +497,85 @@ static int Open( vlc_object_t *p_this )
 
     if( p_sys->psz_keyfile && ( LoadCryptFile( p_access ) < 0 ) )
     {
-        free( p_sys->psz_indexUrl );
-        free( p_sys->psz_indexPath );
-        free( p_sys );
         msg_Err( p_access, "Encryption init failed" );
-        return VLC_EGENERIC;
+        goto error;
     }
     else if( !p_sys->psz_keyfile && ( CryptSetup( p_access, NULL ) < 0 ) )
     {
-        free( p_sys->psz_indexUrl );
-        free( p_sys->psz_indexPath );
-        free( p_sys );
         msg_Err( p_access, "Encryption init failed" );
-        return VLC_EGENERIC;
+        goto error;
+    }
+
+    vlc_mutex_init( &p_sys->http_lock );
+    p_sys->psz_httpPath = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "http-path" );
+    if( p_sys->psz_httpPath )
+    {
+        if( p_sys->i_numsegs == 0 )
+        {
+            msg_Err( p_access, "serving from memory requires a number of segments" );
+            goto error_http;
+        }
+
+        size_t i_len = strlen( p_sys->psz_httpPath );
+        while( i_len > 0 && p_sys->psz_httpPath[i_len - 1] == '/' )
+            p_sys->psz_httpPath[--i_len] = '\0';
+
+        p_sys->p_httpd_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+        if( !p_sys->p_httpd_host )
+        {
+            msg_Err( p_access, "cannot start HTTP server" );
+            goto error_http;
+        }
+
+        p_sys->p_index_mem = memFileNew( p_sys, p_sys->psz_indexPath ?
+                                         p_sys->psz_indexPath : "index.m3u8",
+                                         "application/vnd.apple.mpegurl" );
+        if( !p_sys->p_index_mem )
+        {
+            msg_Err( p_access, "cannot serve the index under %s", p_sys->psz_httpPath );
+            httpd_HostDelete( p_sys->p_httpd_host );
+            goto error_http;
+        }
     }
 
     p_sys->i_handle = -1;
     p_sys->i_segment = p_sys->i_initial_segment-1;
-    p_sys->psz_cursegPath = NULL;
+    p_sys->i_firstseg = p_sys->i_initial_segment;
+
+    vlc_mutex_init( &p_sys->lock );
+    vlc_cond_init( &p_sys->wait_job );
+    vlc_cond_init( &p_sys->wait_space );
+    p_sys->pp_jobs_last = &p_sys->p_jobs;
+
+    if( vlc_clone( &p_sys->thread, WriterThread, p_access,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_cond_destroy( &p_sys->wait_space );
+        vlc_cond_destroy( &p_sys->wait_job );
+        vlc_mutex_destroy( &p_sys->lock );
+        if( p_sys->p_httpd_host )
+        {
+            memFileDelete( p_sys->p_index_mem );
+            httpd_HostDelete( p_sys->p_httpd_host );
+        }
+        goto error_http;
+    }
 
     p_access->pf_write = Write;
     p_access->pf_control = Control;
 
     return VLC_SUCCESS;
+
+error_http:
+    vlc_mutex_destroy( &p_sys->http_lock );
+    free( p_sys->psz_httpPath );
+error:
+    free( p_sys->key_uri );
+    free( p_sys->psz_keyfile );
+    free( p_sys->psz_indexUrl );
+    free( p_sys->psz_indexPath );
+    free( p_sys );
+    return VLC_EGENERIC;
 }
 
 /************************************************************************
@@ -313,7 +584,6 @@ static int Open( vlc_object_t *p_this )
 static int CryptSetup( sout_access_out_t *p_access, char *key_file )
 {
     sout_access_out_sys_t *p_sys = p_access->p_sys;
-    uint8_t key[16];
     char *keyfile = NULL;
 
     if( !p_sys->key_uri ) /*No key uri, assume no encryption wanted*/
@@ -335,42 +605,23 @@ static int CryptSetup( sout_access_out_t *p_access, char *key_file )
 
     vlc_gcrypt_init();
 
-    /*Setup encryption cipher*/
-    gcry_error_t err = gcry_cipher_open( &p_sys->aes_ctx, GCRY_CIPHER_AES,
-                                         GCRY_CIPHER_MODE_CBC, 0 );
-    if( err )
-    {
-        msg_Err( p_access, "Openin AES Cipher failed: %s", gpg_strerror(err));
-        free( keyfile );
-        return VLC_EGENERIC;
-    }
-
     int keyfd = vlc_open( keyfile, O_RDONLY | O_NONBLOCK );
     if( unlikely( keyfd == -1 ) )
     {
         msg_Err( p_access, "Unable to open keyfile %s: %s", keyfile,
                  vlc_strerror_c(errno) );
         free( keyfile );
-        gcry_cipher_close( p_sys->aes_ctx );
         return VLC_EGENERIC;
     }
     free( keyfile );
 
-    ssize_t keylen = read( keyfd, key, 16 );
+    /* The key is set on the cipher by the writer, on segment opening */
+    ssize_t keylen = read( keyfd, p_sys->aes_key, 16 );
 
     vlc_close( keyfd );
     if( keylen < 16 )
     {
         msg_Err( p_access, "No key at least 16 octects (you provided %zd), no encryption", keylen );
-        gcry_cipher_close( p_sys->aes_ctx );
-        return VLC_EGENERIC;
-    }
-
-    err = gcry_cipher_setkey( p_sys->aes_ctx, key, 16 );
-    if(err)
-    {
-        msg_Err(p_access, "Setting AES key failed: %s", gpg_strerror(err));
-        gcry_cipher_close( p_sys->aes_ctx );
         return VLC_EGENERIC;
     }
 
@@ -448,7 +699,7 @@ static int LoadCryptFile( sout_access_out_t *p_access )
 /************************************************************************
  * CryptKey: Set encryption IV to current segment number
  ************************************************************************/
-static int CryptKey( sout_access_out_t *p_access, uint32_t i_segment )
+static void CryptKey( sout_access_out_t *p_access, uint32_t i_segment )
 {
     sout_access_out_sys_t *p_sys = p_access->p_sys;
 
@@ -461,15 +712,341 @@ static int CryptKey( sout_access_out_t *p_access, uint32_t i_segment )
         p_sys->aes_ivs[13] = (i_segment >> 16 ) & 0xff;
         p_sys->aes_ivs[12] = (i_segment >> 24 ) & 0xff;
     }
+}
+
+/*****************************************************************************
+ * Writer thread: everything touching the disk or the cipher happens here,
+ * in the order the jobs were queued
+ *****************************************************************************/
+static void writerFail( sout_access_out_sys_t *p_sys )
+{
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_error = true;
+    vlc_mutex_unlock( &p_sys->lock );
+}
+
+static void writerOpen( sout_access_out_t *p_access, writer_job_t *job )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    output_segment_t *segment = job->segment;
+
+    p_sys->p_curmem = segment->p_mem;
+    p_sys->b_crypt = false;
+    p_sys->stuffing_size = 0;
+
+    p_sys->i_handle = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT |
+                                O_LARGEFILE | O_TRUNC, 0666 );
+    if( p_sys->i_handle == -1 )
+    {
+        msg_Err( p_access, "cannot open `%s' (%s)", segment->psz_filename,
+                 vlc_strerror_c(errno) );
+        writerFail( p_sys );
+    }
+
+    if( !segment->psz_key_uri )
+        return;
 
-    gcry_error_t err = gcry_cipher_setiv( p_sys->aes_ctx,
-                                          p_sys->aes_ivs, 16);
+    gcry_error_t err = 0;
+    if( !p_sys->aes_ctx )
+        err = gcry_cipher_open( &p_sys->aes_ctx, GCRY_CIPHER_AES,
+                                GCRY_CIPHER_MODE_CBC, 0 );
     if( err )
     {
-        msg_Err(p_access, "Setting AES IVs failed: %s", gpg_strerror(err) );
-        gcry_cipher_close( p_sys->aes_ctx);
-        return VLC_EGENERIC;
+        msg_Err( p_access, "Openin AES Cipher failed: %s", gpg_strerror(err));
+        p_sys->aes_ctx = NULL;
+    }
+    else if( ( err = gcry_cipher_setkey( p_sys->aes_ctx, job->aes_key, 16 ) ) )
+        msg_Err( p_access, "Setting AES key failed: %s", gpg_strerror(err) );
+    else if( ( err = gcry_cipher_setiv( p_sys->aes_ctx, job->aes_ivs, 16 ) ) )
+        msg_Err( p_access, "Setting AES IVs failed: %s", gpg_strerror(err) );
+
+    if( err )
+    {
+        /* never write the segment in clear while the index tells otherwise */
+        if( p_sys->i_handle != -1 )
+            vlc_close( p_sys->i_handle );
+        p_sys->i_handle = -1;
+        p_sys->p_curmem = NULL;
+        writerFail( p_sys );
+        return;
+    }
+    p_sys->b_crypt = true;
+}
+
+static void writerOutput( sout_access_out_t *p_access, const uint8_t *p_data, size_t i_data )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->p_curmem )
+        memFileAppend( p_sys->p_curmem, p_data, i_data );
+
+    while( i_data > 0 && p_sys->i_handle != -1 )
+    {
+        ssize_t val = vlc_write( p_sys->i_handle, p_data, i_data );
+        if( val == -1 )
+        {
+            if( errno == EINTR )
+                continue;
+            msg_Err( p_access, "cannot write segment: %s", vlc_strerror_c(errno) );
+            vlc_close( p_sys->i_handle );
+            p_sys->i_handle = -1;
+            writerFail( p_sys );
+            break;
+        }
+        p_data += val;
+        i_data -= val;
+    }
+}
+
+static void writerData( sout_access_out_t *p_access, block_t *output )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    while( output )
+    {
+        block_t *p_next = output->p_next;
+        output->p_next = NULL;
+
+        if( p_sys->b_crypt )
+        {
+            if( p_sys->stuffing_size )
+            {
+                output = block_Realloc( output, p_sys->stuffing_size, output->i_buffer );
+                if( unlikely(!output ) )
+                {
+                    writerFail( p_sys );
+                    block_ChainRelease( p_next );
+                    return;
+                }
+                memcpy( output->p_buffer, p_sys->stuffing_bytes, p_sys->stuffing_size );
+                p_sys->stuffing_size = 0;
+            }
+            size_t original = output->i_buffer;
+            size_t padded = (output->i_buffer + 15 ) & ~15;
+            size_t pad = padded - original;
+            if( pad )
+            {
+                p_sys->stuffing_size = 16-pad;
+                output->i_buffer -= p_sys->stuffing_size;
+                memcpy(p_sys->stuffing_bytes, &output->p_buffer[output->i_buffer], p_sys->stuffing_size);
+            }
+
+            gcry_error_t err = gcry_cipher_encrypt( p_sys->aes_ctx,
+                                output->p_buffer, output->i_buffer, NULL, 0 );
+            if( err )
+            {
+                msg_Err( p_access, "Encryption failure: %s ", gpg_strerror(err) );
+                writerFail( p_sys );
+                block_Release( output );
+                output = p_next;
+                continue;
+            }
+        }
+
+        writerOutput( p_access, output->p_buffer, output->i_buffer );
+        block_Release( output );
+        output = p_next;
+    }
+}
+
+static void writerClose( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->b_crypt )
+    {
+        size_t pad = 16 - p_sys->stuffing_size;
+        memset(&p_sys->stuffing_bytes[p_sys->stuffing_size], pad, pad);
+        gcry_error_t err = gcry_cipher_encrypt( p_sys->aes_ctx, p_sys->stuffing_bytes, 16, NULL, 0 );
+
+        if( err )
+            msg_Err( p_access, "Couldn't encrypt 16 bytes: %s", gpg_strerror(err) );
+        else
+            writerOutput( p_access, p_sys->stuffing_bytes, 16 );
+        p_sys->stuffing_size = 0;
+        p_sys->b_crypt = false;
+    }
+
+    if( p_sys->i_handle != -1 )
+        vlc_close( p_sys->i_handle );
+    p_sys->i_handle = -1;
+    p_sys->p_curmem = NULL;
+}
+
+static void writerIndex( sout_access_out_t *p_access, writer_job_t *job )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( job->psz_mem_index )
+    {
+        memFileReplace( p_sys->p_index_mem, job->psz_mem_index );
+        job->psz_mem_index = NULL;
+    }
+
+    if( !job->psz_index )
+        return;
+
+    char *psz_idxTmp;
+    if ( asprintf( &psz_idxTmp, "%s.tmp", p_sys->psz_indexPath ) < 0)
+        return;
+
+    FILE *fp = vlc_fopen( psz_idxTmp, "wt");
+    if ( !fp )
+    {
+        msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
+        free( psz_idxTmp );
+        return;
+    }
+
+    size_t i_len = strlen( job->psz_index );
+    bool b_ok = fwrite( job->psz_index, 1, i_len, fp ) == i_len;
+    if( fclose( fp ) )
+        b_ok = false;
+
+    if ( !b_ok || vlc_rename ( psz_idxTmp, p_sys->psz_indexPath ) < 0 )
+    {
+        vlc_unlink( psz_idxTmp );
+        msg_Err( p_access, "Error moving LiveHttp index file" );
+    }
+    else
+        msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
+
+    free( psz_idxTmp );
+}
+
+static void writerDrop( sout_access_out_t *p_access, writer_job_t *job )
+{
+    output_segment_t *segment = job->segment;
+
+    msg_Dbg( p_access, "Removing segment number %d", segment->i_segment_number );
+    if ( job->b_unlink && segment->psz_filename )
+        vlc_unlink( segment->psz_filename );
+    destroySegment( segment );
+}
+
+static void *WriterThread( void *data )
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    for( ;; )
+    {
+        while( !p_sys->p_jobs && !p_sys->b_exit )
+            vlc_cond_wait( &p_sys->wait_job, &p_sys->lock );
+
+        writer_job_t *job = p_sys->p_jobs;
+        if( !job )
+            break;
+        p_sys->p_jobs = job->p_next;
+        if( !p_sys->p_jobs )
+            p_sys->pp_jobs_last = &p_sys->p_jobs;
+        vlc_mutex_unlock( &p_sys->lock );
+
+        int canc = vlc_savecancel();
+        switch( job->i_type )
+        {
+            case JOB_OPEN:
+                writerOpen( p_access, job );
+                break;
+            case JOB_DATA:
+                writerData( p_access, job->p_data );
+                break;
+            case JOB_CLOSE:
+                writerClose( p_access );
+                break;
+            case JOB_INDEX:
+                writerIndex( p_access, job );
+                break;
+            case JOB_DROP:
+                writerDrop( p_access, job );
+                break;
+        }
+        vlc_restorecancel( canc );
+
+        free( job->psz_index );
+        free( job->psz_mem_index );
+
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->i_queued -= job->i_size;
+        vlc_cond_signal( &p_sys->wait_space );
+        free( job );
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+    return NULL;
+}
+
+/*****************************************************************************
+ * writerPush: queue a job, waiting for room if too much data is queued
+ *****************************************************************************/
+static void writerPush( sout_access_out_t *p_access, writer_job_t *job )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    while( job->i_size > 0 && p_sys->i_queued > 0 &&
+           p_sys->i_queued + job->i_size > p_sys->i_queue_max )
+        vlc_cond_wait( &p_sys->wait_space, &p_sys->lock );
+
+    job->p_next = NULL;
+    *p_sys->pp_jobs_last = job;
+    p_sys->pp_jobs_last = &job->p_next;
+    p_sys->i_queued += job->i_size;
+    vlc_cond_signal( &p_sys->wait_job );
+    vlc_mutex_unlock( &p_sys->lock );
+}
+
+/*****************************************************************************
+ * writerError: tell if the writer failed since the last call
+ *****************************************************************************/
+static bool writerError( sout_access_out_sys_t *p_sys )
+{
+    vlc_mutex_lock( &p_sys->lock );
+    bool b_error = p_sys->b_error;
+    p_sys->b_error = false;
+    vlc_mutex_unlock( &p_sys->lock );
+    return b_error;
+}
+
+static int writerPushType( sout_access_out_t *p_access, int i_type,
+                           output_segment_t *segment )
+{
+    writer_job_t *job = calloc( 1, sizeof( *job ) );
+    if( unlikely( !job ) )
+        return VLC_ENOMEM;
+    job->i_type = i_type;
+    job->segment = segment;
+    writerPush( p_access, job );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * flushPending: hand the blocks of the current segment to the writer
+ *****************************************************************************/
+static int flushPending( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys )
+{
+    if( !p_sys->p_pending )
+        return VLC_SUCCESS;
+
+    writer_job_t *job = calloc( 1, sizeof( *job ) );
+    if( unlikely( !job ) )
+    {
+        block_ChainRelease( p_sys->p_pending );
     }
+    else
+    {
+        job->i_type = JOB_DATA;
+        job->p_data = p_sys->p_pending;
+        job->i_size = p_sys->i_pending;
+    }
+
+    p_sys->p_pending = NULL;
+    p_sys->pp_pending_last = &p_sys->p_pending;
+    p_sys->i_pending = 0;
+
+    if( unlikely( !job ) )
+        return VLC_ENOMEM;
+    writerPush( p_access, job );
     return VLC_SUCCESS;
 }
 
@@ -506,6 +1083,9 @@ static char *formatSegmentPath( char *psz_path, uint32_t i_seg )
 
 static void destroySegment( output_segment_t *segment )
 {
+    if( segment->p_mem )
+        memFileDelete( segment->p_mem );
+    free( segment->p_parts );
     free( segment->psz_filename );
     free( segment->psz_duration );
     free( segment->psz_uri );
@@ -555,203 +1135,246 @@ static bool isFirstItemRemovable( sout_access_out_sys_t *p_sys, uint32_t i_first
     return duration >= (first->f_seglength + (float)(p_sys->i_numsegs * p_sys->i_seglen));
 }
 
+/* Locale independent %.3f */
+static void printDuration( struct vlc_memstream *ms, mtime_t i_duration )
+{
+    i_duration = ( i_duration + 500 ) / 1000;
+    vlc_memstream_printf( ms, "%"PRId64".%03u", i_duration / 1000,
+                          (unsigned)( i_duration % 1000 ) );
+}
+
+static void printPart( struct vlc_memstream *ms, const output_part_t *part,
+                       const char *psz_uri, bool b_mem )
+{
+    vlc_memstream_puts( ms, "#EXT-X-PART:DURATION=" );
+    printDuration( ms, part->i_duration );
+    /* the HTTP server ignores Range requests */
+    if( b_mem )
+        vlc_memstream_printf( ms, ",URI=\"%s?offset=%"PRIu64"&size=%zu\"",
+                              psz_uri, part->i_offset, part->i_size );
+    else
+        vlc_memstream_printf( ms, ",URI=\"%s\",BYTERANGE=%zu@%"PRIu64,
+                              psz_uri, part->i_size, part->i_offset );
+    vlc_memstream_puts( ms, part->b_independent ? ",INDEPENDENT=YES\n" : "\n" );
+}
+
+static const char *segmentUri( const output_segment_t *segment, bool b_mem )
+{
+    if( !b_mem )
+        return segment->psz_uri;
+
+    /* served next to the index */
+    const char *psz_name = strrchr( segment->psz_filename, DIR_SEP_CHAR );
+    return psz_name ? psz_name + 1 : segment->psz_filename;
+}
+
 /************************************************************************
- * updateIndexAndDel: If necessary, update index file & delete old segments
+ * buildIndex: generate the index of the current segments
  ************************************************************************/
-static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+static char *buildIndex( sout_access_out_sys_t *p_sys, bool b_isend, bool b_mem )
 {
+    struct vlc_memstream ms;
+    uint32_t i_firstseg = p_sys->i_firstseg;
+    uint32_t i_lastseg = p_sys->i_segment - ( p_sys->p_cursegment ? 1 : 0 );
 
-    uint32_t i_firstseg;
-    unsigned i_index_offset = 0;
+    if( vlc_memstream_open( &ms ) )
+        return NULL;
 
-    if ( p_sys->i_numsegs == 0 ||
-         p_sys->i_segment < ( p_sys->i_numsegs + p_sys->i_initial_segment ) )
+    vlc_memstream_printf( &ms, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:%d\n",
+                          p_sys->i_seglen, p_sys->i_partlenm ? 6 : 3 );
+    if( p_sys->i_partlenm )
     {
-        i_firstseg = p_sys->i_initial_segment;
-    }
-    else
-    {
-        unsigned numsegs = segmentAmountNeeded( p_sys );
-        i_firstseg = ( p_sys->i_segment - numsegs ) + 1;
-        i_index_offset = vlc_array_count( &p_sys->segments_t ) - numsegs;
+        vlc_memstream_puts( &ms, "#EXT-X-PART-INF:PART-TARGET=" );
+        printDuration( &ms, p_sys->i_partlenm );
+        vlc_memstream_puts( &ms, "\n#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=" );
+        printDuration( &ms, 3 * p_sys->i_partlenm );
+        vlc_memstream_putc( &ms, '\n' );
     }
-
-    // First update index
-    if ( p_sys->psz_indexPath )
-    {
-        int val;
-        FILE *fp;
-        char *psz_idxTmp;
-        if ( asprintf( &psz_idxTmp, "%s.tmp", p_sys->psz_indexPath ) < 0)
-            return -1;
-
-        fp = vlc_fopen( psz_idxTmp, "wt");
-        if ( !fp )
-        {
-            msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
-            free( psz_idxTmp );
-            return -1;
-        }
-
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
-                          "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
+    vlc_memstream_printf( &ms, "#EXT-X-ALLOW-CACHE:%s"
+                          "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s",
                           p_sys->b_caching ? "YES" : "NO",
                           p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
-                          i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
-                          ) < 0 )
-        {
-            free( psz_idxTmp );
-            fclose( fp );
-            return -1;
-        }
-        char *psz_current_uri=NULL;
+                          i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : "" );
 
+    const char *psz_current_uri = NULL;
+    for ( uint32_t i = i_firstseg; i <= i_lastseg + 1; i++ )
+    {
+        //scale to i_index_offset..numsegs + i_index_offset
+        uint32_t index = i - i_firstseg + p_sys->i_index_offset;
+        if( index >= vlc_array_count( &p_sys->segments_t ) )
+            break;
 
-        for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
-        {
-            //scale to i_index_offset..numsegs + i_index_offset
-            uint32_t index = i - i_firstseg + i_index_offset;
+        output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, index );
+        /* the ongoing segment only has its parts listed */
+        if( i > i_lastseg && !segment->i_parts )
+            break;
 
-            output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, index );
-            if( p_sys->key_uri &&
-                ( !psz_current_uri ||  strcmp( psz_current_uri, segment->psz_key_uri ) )
-              )
+        if( segment->psz_key_uri &&
+            ( !psz_current_uri || strcmp( psz_current_uri, segment->psz_key_uri ) ) )
+        {
+            psz_current_uri = segment->psz_key_uri;
+            if( p_sys->b_generate_iv )
             {
-                int ret = 0;
-                free( psz_current_uri );
-                psz_current_uri = strdup( segment->psz_key_uri );
-                if( p_sys->b_generate_iv )
+                unsigned long long iv_hi = segment->aes_ivs[0];
+                unsigned long long iv_lo = segment->aes_ivs[8];
+                for( unsigned short j = 1; j < 8; j++ )
                 {
-                    unsigned long long iv_hi = segment->aes_ivs[0];
-                    unsigned long long iv_lo = segment->aes_ivs[8];
-                    for( unsigned short j = 1; j < 8; j++ )
-                    {
-                        iv_hi <<= 8;
-                        iv_hi |= segment->aes_ivs[j] & 0xff;
-                        iv_lo <<= 8;
-                        iv_lo |= segment->aes_ivs[8+j] & 0xff;
-                    }
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
-                                   segment->psz_key_uri, iv_hi, iv_lo );
-
-                } else {
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
+                    iv_hi <<= 8;
+                    iv_hi |= segment->aes_ivs[j] & 0xff;
+                    iv_lo <<= 8;
+                    iv_lo |= segment->aes_ivs[8+j] & 0xff;
                 }
-                if( ret < 0 )
-                {
-                    free( psz_current_uri );
-                    free( psz_idxTmp );
-                    fclose( fp );
-                    return -1;
-                }
-            }
+                vlc_memstream_printf( &ms, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
+                                      segment->psz_key_uri, iv_hi, iv_lo );
 
-            val = fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
-            if ( val < 0 )
-            {
-                free( psz_current_uri );
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
+            } else {
+                vlc_memstream_printf( &ms, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
             }
         }
-        free( psz_current_uri );
 
-        if ( b_isend )
-        {
-            if ( fputs ( STR_ENDLIST, fp ) < 0)
-            {
-                free( psz_idxTmp );
-                fclose( fp ) ;
-                return -1;
-            }
+        const char *psz_uri = segmentUri( segment, b_mem );
+        if( i + PART_SEGMENTS > i_lastseg )
+            for( size_t j = 0; j < segment->i_parts; j++ )
+                printPart( &ms, &segment->p_parts[j], psz_uri, b_mem );
 
-        }
-        fclose( fp );
+        if( i <= i_lastseg )
+            vlc_memstream_printf( &ms, "#EXTINF:%s,\n%s\n", segment->psz_duration, psz_uri );
+    }
 
-        val = vlc_rename ( psz_idxTmp, p_sys->psz_indexPath);
+    if ( b_isend )
+        vlc_memstream_puts( &ms, STR_ENDLIST );
 
-        if ( val < 0 )
-        {
-            vlc_unlink( psz_idxTmp );
-            msg_Err( p_access, "Error moving LiveHttp index file" );
-        }
-        else
-            msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
+    if( vlc_memstream_close( &ms ) )
+        return NULL;
+    return ms.ptr;
+}
 
-        free( psz_idxTmp );
+/************************************************************************
+ * publishIndex: hand the new index over to the writer
+ ************************************************************************/
+static int publishIndex( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+{
+    if( !p_sys->psz_indexPath && !p_sys->p_index_mem )
+        return VLC_SUCCESS;
+
+    writer_job_t *job = calloc( 1, sizeof( *job ) );
+    if( unlikely( !job ) )
+        return VLC_ENOMEM;
+
+    job->i_type = JOB_INDEX;
+    if( p_sys->psz_indexPath )
+        job->psz_index = buildIndex( p_sys, b_isend, false );
+    if( p_sys->p_index_mem )
+        job->psz_mem_index = buildIndex( p_sys, b_isend, true );
+
+    writerPush( p_access, job );
+    return VLC_SUCCESS;
+}
+
+/************************************************************************
+ * updateIndexAndDel: If necessary, update index file & delete old segments
+ ************************************************************************/
+static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+{
+
+    uint32_t i_firstseg;
+    unsigned i_index_offset = 0;
+
+    if ( p_sys->i_numsegs == 0 ||
+         p_sys->i_segment < ( p_sys->i_numsegs + p_sys->i_initial_segment ) )
+    {
+        i_firstseg = p_sys->i_initial_segment;
+    }
+    else
+    {
+        unsigned numsegs = segmentAmountNeeded( p_sys );
+        i_firstseg = ( p_sys->i_segment - numsegs ) + 1;
+        i_index_offset = vlc_array_count( &p_sys->segments_t ) - numsegs;
     }
 
+    p_sys->i_firstseg = i_firstseg;
+    p_sys->i_index_offset = i_index_offset;
+
+    // First update index
+    int ret = publishIndex( p_access, p_sys, b_isend );
+
     // Then take care of deletion
     // Try to follow pantos draft 11 section 6.2.2
-    while( p_sys->b_delsegs && p_sys->i_numsegs &&
-           isFirstItemRemovable( p_sys, i_firstseg, i_index_offset )
+    // Segments served from memory are released even when kept on disk
+    // The writer may still use them, it deletes them after its pending jobs
+    while( ( p_sys->b_delsegs || p_sys->p_httpd_host ) && p_sys->i_numsegs &&
+           isFirstItemRemovable( p_sys, i_firstseg, p_sys->i_index_offset )
          )
     {
+         writer_job_t *job = calloc( 1, sizeof( *job ) );
+         if( unlikely( !job ) )
+             break; /* kept out of the index, retried on the next update */
+
          output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, 0 );
-         msg_Dbg( p_access, "Removing segment number %d", segment->i_segment_number );
          vlc_array_remove( &p_sys->segments_t, 0 );
 
-         if ( segment->psz_filename )
-         {
-             vlc_unlink( segment->psz_filename );
-         }
-
-         destroySegment( segment );
-         i_index_offset -=1;
+         job->i_type = JOB_DROP;
+         job->segment = segment;
+         job->b_unlink = p_sys->b_delsegs;
+         writerPush( p_access, job );
+         p_sys->i_index_offset -= 1;
     }
 
-
-    return 0;
+    return ret;
 }
 
 /*****************************************************************************
- * closeCurrentSegment: Close the segment file
+ * closeCurrentPart: Add the data since the last part as a partial segment
  *****************************************************************************/
-static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+static bool closeCurrentPart( sout_access_out_sys_t *p_sys, mtime_t i_enddts )
 {
-    if ( p_sys->i_handle >= 0 )
-    {
-        output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, vlc_array_count( &p_sys->segments_t ) - 1 );
-
-        if( p_sys->key_uri )
-        {
-            size_t pad = 16 - p_sys->stuffing_size;
-            memset(&p_sys->stuffing_bytes[p_sys->stuffing_size], pad, pad);
-            gcry_error_t err = gcry_cipher_encrypt( p_sys->aes_ctx, p_sys->stuffing_bytes, 16, NULL, 0 );
+    output_segment_t *segment = p_sys->p_cursegment;
 
-            if( err ) {
-               msg_Err( p_access, "Couldn't encrypt 16 bytes: %s", gpg_strerror(err) );
-            } else {
+    if( !p_sys->i_partlenm || p_sys->i_segoffset == p_sys->i_partoffset )
+        return false;
 
-            int ret = vlc_write( p_sys->i_handle, p_sys->stuffing_bytes, 16 );
-            if( ret != 16 )
-                msg_Err( p_access, "Couldn't write 16 bytes" );
-            }
-            p_sys->stuffing_size = 0;
-        }
+    bool b_added = false;
+    output_part_t *p_parts = NULL;
+    if( !segment->psz_key_uri &&
+        ( p_parts = realloc( segment->p_parts, ( segment->i_parts + 1 ) * sizeof( *p_parts ) ) ) )
+    {
+        output_part_t *part = &p_parts[segment->i_parts++];
+        part->i_offset = p_sys->i_partoffset;
+        part->i_size = p_sys->i_segoffset - p_sys->i_partoffset;
+        part->i_duration = i_enddts - p_sys->i_partdts;
+        part->b_independent = p_sys->b_part_independent;
+        segment->p_parts = p_parts;
+        b_added = true;
+    }
+    p_sys->i_partoffset = p_sys->i_segoffset;
+    return b_added;
+}
 
+/*****************************************************************************
+ * closeCurrentSegment: Close the segment file
+ *****************************************************************************/
+static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+{
+    output_segment_t *segment = p_sys->p_cursegment;
+    if ( !segment )
+        return;
 
-        vlc_close( p_sys->i_handle );
-        p_sys->i_handle = -1;
+    closeCurrentPart( p_sys, p_sys->i_enddts );
+    flushPending( p_access, p_sys );
+    writerPushType( p_access, JOB_CLOSE, segment );
+    p_sys->p_cursegment = NULL;
 
-        if( ! ( us_asprintf( &segment->psz_duration, "%.2f", p_sys->f_seglen ) ) )
-        {
-            msg_Err( p_access, "Couldn't set duration on closed segment");
-            return;
-        }
-        segment->f_seglength = p_sys->f_seglen;
+    if( ! ( us_asprintf( &segment->psz_duration, "%.2f", p_sys->f_seglen ) ) )
+    {
+        msg_Err( p_access, "Couldn't set duration on closed segment");
+        return;
+    }
+    segment->f_seglength = p_sys->f_seglen;
 
-        segment->i_segment_number = p_sys->i_segment;
+    segment->i_segment_number = p_sys->i_segment;
 
-        if ( p_sys->psz_cursegPath )
-        {
-            msg_Dbg( p_access, "LiveHttpSegmentComplete: %s (%"PRIu32")" , p_sys->psz_cursegPath, p_sys->i_segment );
-            free( p_sys->psz_cursegPath );
-            p_sys->psz_cursegPath = 0;
-            updateIndexAndDel( p_access, p_sys, b_isend );
-        }
-    }
+    msg_Dbg( p_access, "LiveHttpSegmentComplete: %s (%"PRIu32")" , segment->psz_filename, p_sys->i_segment );
+    updateIndexAndDel( p_access, p_sys, b_isend );
 }
 
 /*****************************************************************************
@@ -762,47 +1385,17 @@ static void Close( vlc_object_t * p_this )
     sout_access_out_t *p_access = (sout_access_out_t*)p_this;
     sout_access_out_sys_t *p_sys = p_access->p_sys;
 
-    if( p_sys->ongoing_segment )
-        block_ChainLastAppend( &p_sys->full_segments_end, p_sys->ongoing_segment );
-    p_sys->ongoing_segment = NULL;
-    p_sys->ongoing_segment_end = &p_sys->ongoing_segment;
-
-    block_t *output_block = p_sys->full_segments;
-    p_sys->full_segments = NULL;
-    p_sys->full_segments_end = &p_sys->full_segments;
-
-    while( output_block )
-    {
-        block_t *p_next = output_block->p_next;
-        output_block->p_next = NULL;
-
-        Write( p_access, output_block );
-        output_block = p_next;
-    }
-    if( p_sys->ongoing_segment )
-    {
-        block_ChainLastAppend( &p_sys->full_segments_end, p_sys->ongoing_segment );
-        p_sys->ongoing_segment = NULL;
-        p_sys->ongoing_segment_end = &p_sys->ongoing_segment;
-    }
-
-    ssize_t writevalue = writeSegment( p_access );
-    msg_Dbg( p_access, "Writing.. %zd", writevalue );
-    if( unlikely( writevalue < 0 ) )
-    {
-        if( p_sys->full_segments )
-            block_ChainRelease( p_sys->full_segments );
-        if( p_sys->ongoing_segment )
-            block_ChainRelease( p_sys->ongoing_segment );
-    }
-
     closeCurrentSegment( p_access, p_sys, true );
 
-    if( p_sys->key_uri )
-    {
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_exit = true;
+    vlc_cond_signal( &p_sys->wait_job );
+    vlc_mutex_unlock( &p_sys->lock );
+    vlc_join( p_sys->thread, NULL );
+
+    if( p_sys->aes_ctx )
         gcry_cipher_close( p_sys->aes_ctx );
-        free( p_sys->key_uri );
-    }
+    free( p_sys->key_uri );
 
     while( vlc_array_count( &p_sys->segments_t ) > 0 )
     {
@@ -817,6 +1410,19 @@ static void Close( vlc_object_t * p_this )
         destroySegment( segment );
     }
 
+    if( p_sys->p_httpd_host )
+    {
+        memFileDelete( p_sys->p_index_mem );
+        httpd_HostDelete( p_sys->p_httpd_host );
+    }
+
+    vlc_cond_destroy( &p_sys->wait_space );
+    vlc_cond_destroy( &p_sys->wait_job );
+    vlc_mutex_destroy( &p_sys->lock );
+    vlc_mutex_destroy( &p_sys->http_lock );
+
+    free( p_sys->psz_httpPath );
+    free( p_sys->psz_keyfile );
     free( p_sys->psz_indexUrl );
     free( p_sys->psz_indexPath );
     free( p_sys );
@@ -845,12 +1451,10 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
 }
 
 /*****************************************************************************
- * openNextFile: Open the segment file
+ * openNextFile: Create the next segment, the writer opens its file
  *****************************************************************************/
-static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys )
+static int openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys )
 {
-    int fd;
-
     uint32_t i_newseg = p_sys->i_segment + 1;
 
     /* Create segment and fill it info that we can (everything excluding duration */
@@ -863,19 +1467,20 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
     char *psz_idxFormat = p_sys->psz_indexUrl ? p_sys->psz_indexUrl : p_access->psz_path;
     segment->psz_uri = formatSegmentPath( psz_idxFormat , i_newseg );
 
-    if ( unlikely( !segment->psz_filename ) )
+    if ( unlikely( !segment->psz_filename || !segment->psz_uri ) )
     {
         msg_Err( p_access, "Format segmentpath failed");
         destroySegment( segment );
         return -1;
     }
 
-    fd = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT | O_LARGEFILE |
-                     O_TRUNC, 0666 );
-    if ( fd == -1 )
+    if( p_sys->p_httpd_host &&
+        !( segment->p_mem = memFileNew( p_sys, segment->psz_filename, NULL ) ) )
+        msg_Warn( p_access, "cannot serve %s from memory", segment->psz_filename );
+
+    writer_job_t *job = calloc( 1, sizeof( *job ) );
+    if( unlikely( !job ) )
     {
-        msg_Err( p_access, "cannot open `%s' (%s)", segment->psz_filename,
-                 vlc_strerror_c(errno) );
         destroySegment( segment );
         return -1;
     }
@@ -893,165 +1498,96 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
         CryptKey( p_access, i_newseg );
         if( p_sys->b_generate_iv )
             memcpy( segment->aes_ivs, p_sys->aes_ivs, sizeof(uint8_t)*16 );
+        memcpy( job->aes_key, p_sys->aes_key, 16 );
+        memcpy( job->aes_ivs, p_sys->aes_ivs, 16 );
     }
+
+    job->i_type = JOB_OPEN;
+    job->segment = segment;
+    writerPush( p_access, job );
+
     msg_Dbg( p_access, "Successfully opened livehttp file: %s (%"PRIu32")" , segment->psz_filename, i_newseg );
 
-    p_sys->psz_cursegPath = strdup(segment->psz_filename);
-    p_sys->i_handle = fd;
+    p_sys->p_cursegment = segment;
     p_sys->i_segment = i_newseg;
+    p_sys->i_segoffset = 0;
+    p_sys->i_partoffset = 0;
     p_sys->b_segment_has_data = false;
-    return fd;
+    return 0;
 }
+
 /*****************************************************************************
- * CheckSegmentChange: Check if segment needs to be closed and new opened
+ * Write: queue the blocks to the writer, closing the segments and the
+ * partial segments on the way
  *****************************************************************************/
-static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
+static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 {
+    size_t i_write = 0;
     sout_access_out_sys_t *p_sys = p_access->p_sys;
-    ssize_t writevalue = 0;
-
-    if( p_sys->i_handle > 0 && p_sys->b_segment_has_data &&
-       (( p_buffer->i_length + p_buffer->i_dts - p_sys->i_opendts ) >= p_sys->i_seglenm ) )
+    while( p_buffer )
     {
-        writevalue = writeSegment( p_access );
-        if( unlikely( writevalue < 0 ) )
+        block_t *p_temp = p_buffer->p_next;
+        p_buffer->p_next = NULL;
+
+        /* Check if current block is already past segment-length
+            and we want to close the segment and update playlist.
+            Segments only split before keyframes, so that the data
+            before one always belongs to the open segment and can be
+            written right away. */
+        if( p_sys->p_cursegment && p_sys->b_segment_has_data &&
+            ( p_sys->b_splitanywhere || ( p_buffer->i_flags & BLOCK_FLAG_HEADER ) ) &&
+            ( p_buffer->i_length + p_buffer->i_dts - p_sys->i_opendts ) >= p_sys->i_seglenm )
         {
-            block_ChainRelease ( p_buffer );
-            return -1;
+            closeCurrentSegment( p_access, p_sys, false );
+        }
+        else if( p_sys->p_cursegment && p_sys->i_partlenm &&
+                 p_sys->i_segoffset > p_sys->i_partoffset &&
+                 p_buffer->i_dts - p_sys->i_partdts >= p_sys->i_partlenm &&
+                 closeCurrentPart( p_sys, p_buffer->i_dts ) )
+        {
+            flushPending( p_access, p_sys );
+            publishIndex( p_access, p_sys, false );
         }
-        closeCurrentSegment( p_access, p_sys, false );
-        return writevalue;
-    }
-
-    if ( unlikely( p_sys->i_handle < 0 ) )
-    {
-        p_sys->i_opendts = p_buffer->i_dts;
-
-        if( p_sys->ongoing_segment && ( p_sys->ongoing_segment->i_dts < p_sys->i_opendts) )
-            p_sys->i_opendts = p_sys->ongoing_segment->i_dts;
-
-        if( p_sys->full_segments && ( p_sys->full_segments->i_dts < p_sys->i_opendts) )
-            p_sys->i_opendts = p_sys->full_segments->i_dts;
-
-        msg_Dbg( p_access, "Setting new opendts %"PRId64, p_sys->i_opendts );
-
-        if ( openNextFile( p_access, p_sys ) < 0 )
-           return -1;
-    }
-    return writevalue;
-}
 
-static ssize_t writeSegment( sout_access_out_t *p_access )
-{
-    sout_access_out_sys_t *p_sys = p_access->p_sys;
-    msg_Dbg( p_access, "Writing all full segments" );
-
-    block_t *output = p_sys->full_segments;
-    mtime_t output_last_length = 0;
-    if( output )
-        output_last_length = output->i_length;
-    if( *p_sys->full_segments_end )
-        output_last_length = (*p_sys->full_segments_end)->i_length;
-    p_sys->full_segments = NULL;
-    p_sys->full_segments_end = &p_sys->full_segments;
-
-    ssize_t i_write=0;
-    bool crypted = false;
-    while( output )
-    {
-        if( p_sys->key_uri && !crypted )
+        if ( unlikely( !p_sys->p_cursegment ) )
         {
-            if( p_sys->stuffing_size )
-            {
-                output = block_Realloc( output, p_sys->stuffing_size, output->i_buffer );
-                if( unlikely(!output ) )
-                    return VLC_ENOMEM;
-                memcpy( output->p_buffer, p_sys->stuffing_bytes, p_sys->stuffing_size );
-                p_sys->stuffing_size = 0;
-            }
-            size_t original = output->i_buffer;
-            size_t padded = (output->i_buffer + 15 ) & ~15;
-            size_t pad = padded - original;
-            if( pad )
-            {
-                p_sys->stuffing_size = 16-pad;
-                output->i_buffer -= p_sys->stuffing_size;
-                memcpy(p_sys->stuffing_bytes, &output->p_buffer[output->i_buffer], p_sys->stuffing_size);
-            }
+            p_sys->i_opendts = p_buffer->i_dts;
+            msg_Dbg( p_access, "Setting new opendts %"PRId64, p_sys->i_opendts );
 
-            gcry_error_t err = gcry_cipher_encrypt( p_sys->aes_ctx,
-                                output->p_buffer, output->i_buffer, NULL, 0 );
-            if( err )
+            if ( openNextFile( p_access, p_sys ) < 0 )
             {
-                msg_Err( p_access, "Encryption failure: %s ", gpg_strerror(err) );
+                msg_Err( p_access, "Error in write loop");
+                block_Release( p_buffer );
+                block_ChainRelease( p_temp );
                 return -1;
             }
-            crypted=true;
-
         }
 
-        ssize_t val = vlc_write( p_sys->i_handle, output->p_buffer, output->i_buffer );
-        if ( val == -1 )
+        if( p_sys->i_segoffset == p_sys->i_partoffset )
         {
-           if ( errno == EINTR )
-              continue;
-           return -1;
+            p_sys->i_partdts = p_buffer->i_dts;
+            p_sys->b_part_independent = p_buffer->i_flags & BLOCK_FLAG_HEADER;
         }
 
-        p_sys->f_seglen =
-            (float)(output_last_length +
-                    output->i_dts - p_sys->i_opendts) / CLOCK_FREQ;
-
-        if ( (size_t)val >= output->i_buffer )
+        /* some muxers output trailers without timestamps */
+        if( p_buffer->i_dts > VLC_TS_INVALID )
         {
-           block_t *p_next = output->p_next;
-           block_Release (output);
-           output = p_next;
-           crypted=false;
+            p_sys->i_enddts = p_buffer->i_dts + p_buffer->i_length;
+            p_sys->f_seglen = (float)( p_sys->i_enddts - p_sys->i_opendts ) / CLOCK_FREQ;
         }
-        else
-        {
-           output->p_buffer += val;
-           output->i_buffer -= val;
-        }
-        i_write += val;
+        p_sys->i_segoffset += p_buffer->i_buffer;
+        p_sys->b_segment_has_data = true;
+
+        i_write += p_buffer->i_buffer;
+        p_sys->i_pending += p_buffer->i_buffer;
+        block_ChainLastAppend( &p_sys->pp_pending_last, p_buffer );
+        p_buffer = p_temp;
     }
-    return i_write;
-}
 
-/*****************************************************************************
- * Write: standard write on a file descriptor.
- *****************************************************************************/
-static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
-{
-    size_t i_write = 0;
-    sout_access_out_sys_t *p_sys = p_access->p_sys;
-    while( p_buffer )
+    if( flushPending( p_access, p_sys ) || writerError( p_sys ) )
     {
-        /* Check if current block is already past segment-length
-            and we want to write gathered blocks into segment
-            and update playlist */
-        if( p_sys->ongoing_segment && ( p_sys->b_splitanywhere  || ( p_buffer->i_flags & BLOCK_FLAG_HEADER ) ) )
-        {
-            msg_Dbg( p_access, "Moving ongoing segment to full segments-queue" );
-            block_ChainLastAppend( &p_sys->full_segments_end, p_sys->ongoing_segment );
-            p_sys->ongoing_segment = NULL;
-            p_sys->ongoing_segment_end = &p_sys->ongoing_segment;
-            p_sys->b_segment_has_data = true;
-        }
-
-        ssize_t ret = CheckSegmentChange( p_access, p_buffer );
-        if( ret < 0 )
-        {
-            msg_Err( p_access, "Error in write loop");
-            return ret;
-        }
-        i_write += ret;
-
-        block_t *p_temp = p_buffer->p_next;
-        p_buffer->p_next = NULL;
-        block_ChainLastAppend( &p_sys->ongoing_segment_end, p_buffer );
-        p_buffer = p_temp;
+        msg_Err( p_access, "Error in write loop");
+        return -1;
     }
 
     return i_write;
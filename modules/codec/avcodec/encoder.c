@@ -984,6 +984,15 @@ errmsg:
 
     p_context->flags &= ~AV_CODEC_FLAG_GLOBAL_HEADER;
 
+    if( p_enc->fmt_in.i_cat == VIDEO_ES )
+    {
+        /* The input pictures are referenced by libavcodec, not copied: they
+         * are held for reordering and by the frame threads */
+        p_enc->i_lookahead = __MAX( p_context->delay, p_context->max_b_frames ) + 1;
+        if( p_context->active_thread_type & FF_THREAD_FRAME )
+            p_enc->i_lookahead += p_context->thread_count;
+    }
+
     if( p_enc->fmt_in.i_cat == AUDIO_ES )
     {
         p_enc->fmt_in.i_codec = GetVlcAudioFormat( p_sys->p_context->sample_fmt );
@@ -1151,6 +1160,12 @@ static block_t *encode_avframe( encoder_t *p_enc, encoder_sys_t *p_sys, AVFrame
     return p_block;
 }
 
+static void PictureBufferRelease( void *opaque, uint8_t *data )
+{
+    VLC_UNUSED(data);
+    picture_Release( opaque );
+}
+
 /****************************************************************************
  * EncodeVideo: the whole thing
  ****************************************************************************/
@@ -1170,6 +1185,28 @@ static block_t *EncodeVideo( encoder_t *p_enc, picture_t *p_pict )
             p_sys->frame->linesize[i_plane] = p_pict->p[i_plane].i_pitch;
         }
 
+        /* Let libavcodec keep a reference to the picture instead of copying
+         * it when it delays the frame. Each plane gets its own buffer, each
+         * holding the picture. */
+        for( i_plane = 0; i_plane < p_pict->i_planes; i_plane++ )
+        {
+            const plane_t *p = &p_pict->p[i_plane];
+
+            frame->buf[i_plane] = av_buffer_create( p->p_pixels,
+                                    p->i_pitch * p->i_lines,
+                                    PictureBufferRelease,
+                                    picture_Hold( p_pict ),
+                                    AV_BUFFER_FLAG_READONLY );
+            if( unlikely(frame->buf[i_plane] == NULL) )
+            {
+                /* libavcodec will copy the frame */
+                picture_Release( p_pict );
+                while( i_plane > 0 )
+                    av_buffer_unref( &frame->buf[--i_plane] );
+                break;
+            }
+        }
+
         /* Let libavcodec select the frame type */
         frame->pict_type = 0;
 
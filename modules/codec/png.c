@@ -335,8 +335,11 @@ static int OpenEncoder(vlc_object_t *p_this)
 
     p_enc->p_sys->p_obj = p_this;
 
+    /* Raw size, plus room for the headers and the zlib overhead of
+     * incompressible (e.g. tiny) pictures */
     p_enc->p_sys->i_blocksize = 3 * p_enc->fmt_in.video.i_visible_width *
         p_enc->fmt_in.video.i_visible_height;
+    p_enc->p_sys->i_blocksize += p_enc->p_sys->i_blocksize / 100 + 1024;
 
     p_enc->fmt_in.i_codec = VLC_CODEC_RGB24;
     p_enc->pf_encode_video = EncodeBlock;
@@ -270,6 +270,10 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         notify(SegmentTrackerEvent(chunk));
     }
 
+    if(chunk && switch_allowed &&
+       rep->getSwitchPolicy() != SegmentInformation::SWITCH_UNAVAILABLE)
+        prefetchSwitchCandidate(rep, next + 1, connManager);
+
     if(chunk)
     {
         curNumber = next;
@@ -279,6 +283,27 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     return chunk;
 }
 
+void SegmentTracker::prefetchSwitchCandidate(BaseRepresentation *rep, uint64_t number,
+                                             AbstractConnectionManager *connManager)
+{
+    /* Warm the segment cache with what a switch would request next.
+       Only when numbering can't change across representations. */
+    BaseRepresentation *candidate = logic->getNextRepresentation(adaptationSet, rep);
+    if(!candidate || candidate == rep || candidate->needsUpdate() ||
+       !candidate->consistentSegmentNumber() ||
+       candidate->getStreamFormat() != rep->getStreamFormat())
+        return;
+
+    ISegment *segment = candidate->getSegment(BaseRepresentation::INFOTYPE_INIT);
+    if(segment)
+        segment->prefetch(number, candidate, connManager);
+
+    bool b_gap = false;
+    segment = candidate->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA, number, &number, &b_gap);
+    if(segment && !b_gap)
+        segment->prefetch(number, candidate, connManager);
+}
+
 bool SegmentTracker::setPositionByTime(mtime_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
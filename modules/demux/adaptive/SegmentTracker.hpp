@@ -130,6 +130,8 @@ namespace adaptive
 
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
+            void prefetchSwitchCandidate(BaseRepresentation *, uint64_t,
+                                         AbstractConnectionManager *);
             void notify(const SegmentTrackerEvent &) const;
             bool first;
             bool initializing;
@@ -37,7 +37,7 @@
 
 #include "../dash/DASHManager.h"
 #include "../dash/DASHStream.hpp"
-#include "../dash/mpd/IsoffMainParser.h"
+#include "../dash/mpd/IsoffStreamParser.h"
 
 #include "../hls/HLSManager.hpp"
 #include "../hls/HLSStreams.hpp"
@@ -74,6 +74,14 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using http access instead of custom http code")
 
+#define ADAPT_CACHE_TEXT N_("Segment cache size in KiB")
+#define ADAPT_CACHE_LONGTEXT N_("Memory used to keep downloaded segments for " \
+                                "seeking back and switching. 0 disables caching")
+
+#define ADAPT_PREFETCH_TEXT N_("Prefetch segments on expected switch")
+#define ADAPT_PREFETCH_LONGTEXT N_("Speculatively download the next segment of the " \
+                                   "representation the adaptation logic would switch to")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
@@ -120,13 +128,15 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer( "adaptive-cache-size", 8192, ADAPT_CACHE_TEXT, ADAPT_CACHE_LONGTEXT, true )
+        add_bool   ( "adaptive-prefetch", false, ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
-static PlaylistManager * HandleDash(demux_t *, DOMParser &,
+static PlaylistManager * HandleDash(demux_t *,
                                     const std::string &, AbstractAdaptationLogic::LogicType);
 static PlaylistManager * HandleSmooth(demux_t *, DOMParser &,
                                       const std::string &, AbstractAdaptationLogic::LogicType);
@@ -191,7 +201,7 @@ static int Open(vlc_object_t *p_obj)
         DOMParser xmlParser; /* Share that xml reader */
         if(dashmime)
         {
-            p_manager = HandleDash(p_demux, xmlParser, playlisturl, logic);
+            p_manager = HandleDash(p_demux, playlisturl, logic);
         }
         else if(smoothmime)
         {
@@ -211,7 +221,7 @@ static int Open(vlc_object_t *p_obj)
                     {
                         if(DASHManager::isDASH(xmlParser.getRootNode()))
                         {
-                            p_manager = HandleDash(p_demux, xmlParser, playlisturl, logic);
+                            p_manager = HandleDash(p_demux, playlisturl, logic);
                         }
                         else if(SmoothManager::isSmoothStreaming(xmlParser.getRootNode()))
                         {
@@ -254,21 +264,15 @@ static void Close(vlc_object_t *p_obj)
 /*****************************************************************************
  *
  *****************************************************************************/
-static PlaylistManager * HandleDash(demux_t *p_demux, DOMParser &xmlParser,
+static PlaylistManager * HandleDash(demux_t *p_demux,
                                     const std::string & playlisturl,
                                     AbstractAdaptationLogic::LogicType logic)
 {
-    if(!xmlParser.reset(p_demux->s) || !xmlParser.parse(true))
-    {
-        msg_Err(p_demux, "Cannot parse MPD");
-        return NULL;
-    }
-    IsoffMainParser mpdparser(xmlParser.getRootNode(), VLC_OBJECT(p_demux),
-                              p_demux->s, playlisturl);
+    IsoffStreamParser mpdparser(VLC_OBJECT(p_demux), p_demux->s, playlisturl);
     MPD *p_playlist = mpdparser.parse();
     if(p_playlist == NULL)
     {
-        msg_Err( p_demux, "Cannot create/unknown MPD for profile");
+        msg_Err( p_demux, "Cannot parse MPD");
         return NULL;
     }
 
@@ -28,6 +28,7 @@
 #include "Chunk.h"
 #include "HTTPConnection.hpp"
 #include "HTTPConnectionManager.h"
+#include "ChunkCache.hpp"
 #include "Downloader.hpp"
 
 #include <vlc_common.h>
@@ -149,6 +150,11 @@ bool HTTPChunkSource::init(const std::string &url)
     return true;
 }
 
+const std::string & HTTPChunkSource::getUrl() const
+{
+    return params.getUrl();
+}
+
 bool HTTPChunkSource::hasMoreData() const
 {
     if(eof)
@@ -243,13 +249,19 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     HTTPChunkSource(url, manager, sourceid),
     p_head     (NULL),
     pp_tail    (&p_head),
-    buffered     (0)
+    buffered     (0),
+    p_cachehead  (NULL),
+    pp_cachetail (&p_cachehead),
+    cachesize    (0)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&avail);
     done = false;
     eof = false;
     held = false;
+    cacheable = false;
+    initsegment = false;
+    prefetched = false;
     downloadstart = 0;
 }
 
@@ -270,6 +282,8 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
         pp_tail = &p_head;
     }
     buffered = 0;
+    if(p_cachehead)
+        block_ChainRelease(p_cachehead);
     vlc_mutex_unlock(&lock);
 
     vlc_cond_destroy(&avail);
@@ -295,9 +309,75 @@ void HTTPChunkBufferedSource::release()
     vlc_cond_signal(&avail);
 }
 
+void HTTPChunkBufferedSource::setCacheable(bool b, bool b_init)
+{
+    vlc_mutex_locker locker( &lock );
+    cacheable = b;
+    initsegment = b_init;
+}
+
+bool HTTPChunkBufferedSource::restoreFromCache()
+{
+    ChunkCache *cache = connManager ? connManager->getCache() : NULL;
+    if(!cache)
+        return false;
+
+    vlc_mutex_locker locker( &lock );
+    if(!cacheable || prepared || done)
+        return false;
+
+    block_t *p_data = cache->get(getUrl(), bytesRange);
+    if(!p_data)
+        return false;
+
+    size_t size;
+    block_ChainProperties(p_data, NULL, &size, NULL);
+    block_ChainLastAppend(&pp_tail, p_data);
+    buffered += size;
+    contentLength = size;
+    prepared = true; /* no connection will ever be requested */
+    done = true;
+    vlc_cond_signal(&avail);
+    return true;
+}
+
+void HTTPChunkBufferedSource::keepCopy(const block_t *p_block)
+{
+    ChunkCache *cache = connManager->getCache();
+    block_t *p_copy = NULL;
+    /* stop copying once too large to be cached */
+    if(cache && cachesize + p_block->i_buffer <= cache->getMaxEntrySize())
+        p_copy = block_Alloc(p_block->i_buffer);
+    if(!p_copy)
+    {
+        storeToCache(false);
+        return;
+    }
+    memcpy(p_copy->p_buffer, p_block->p_buffer, p_block->i_buffer);
+    block_ChainLastAppend(&pp_cachetail, p_copy);
+    cachesize += p_copy->i_buffer;
+}
+
+void HTTPChunkBufferedSource::storeToCache(bool b_complete)
+{
+    ChunkCache *cache = connManager->getCache();
+    if(cacheable && b_complete && cache && p_cachehead)
+        cache->put(getUrl(), bytesRange, p_cachehead, initsegment, prefetched);
+    else if(p_cachehead)
+        block_ChainRelease(p_cachehead);
+    p_cachehead = NULL;
+    pp_cachetail = &p_cachehead;
+    cachesize = 0;
+    cacheable = false;
+}
+
 void HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
+    if(cacheable && restoreFromCache())
+        return;
+
     vlc_mutex_lock(&lock);
+    const bool b_request = !prepared;
     if(!prepare())
     {
         done = true;
@@ -307,6 +387,10 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         return;
     }
 
+    ChunkCache *cache = connManager->getCache();
+    if(b_request && cacheable && !prefetched && cache)
+        cache->missed();
+
     if(readsize < HTTPChunkSource::CHUNK_SIZE)
         readsize = HTTPChunkSource::CHUNK_SIZE;
 
@@ -338,11 +422,15 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         rate.size = buffered + consumed;
         rate.time = mdate() - downloadstart;
         downloadstart = 0;
+        if(cacheable)
+            storeToCache((contentLength) ? rate.size == contentLength : ret == 0);
     }
     else
     {
         p_block->i_buffer = (size_t) ret;
         vlc_mutex_locker locker( &lock );
+        if(cacheable)
+            keepCopy(p_block);
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
         if((size_t) ret < readsize)
@@ -351,6 +439,8 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
             rate.size = buffered + consumed;
             rate.time = mdate() - downloadstart;
             downloadstart = 0;
+            if(cacheable)
+                storeToCache(!contentLength || rate.size == contentLength);
         }
     }
 
@@ -95,6 +95,7 @@ namespace adaptive
 
             protected:
                 virtual bool      prepare(int = 0);
+                const std::string & getUrl() const;
                 AbstractConnection    *connection;
                 AbstractConnectionManager *connManager;
                 size_t              consumed; /* read pointer */
@@ -110,6 +111,7 @@ namespace adaptive
         class HTTPChunkBufferedSource : public HTTPChunkSource
         {
             friend class Downloader;
+            friend class HTTPConnectionManager;
 
             public:
                 HTTPChunkBufferedSource(const std::string &url, AbstractConnectionManager *,
@@ -120,11 +122,15 @@ namespace adaptive
                 virtual bool       hasMoreData     () const; /* impl */
                 void               hold();
                 void               release();
+                void               setCacheable(bool, bool = false);
 
             protected:
                 virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                bool               restoreFromCache();
+                void               keepCopy(const block_t *);
+                void               storeToCache(bool);
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -136,6 +142,12 @@ namespace adaptive
                 mutable vlc_mutex_t lock;
                 vlc_cond_t          avail;
                 bool                held;
+                bool                cacheable;
+                bool                initsegment;
+                bool                prefetched;
+                block_t            *p_cachehead; /* copy kept for the segment cache */
+                block_t           **pp_cachetail;
+                size_t              cachesize;
         };
 
         class HTTPChunk : public AbstractChunk
@@ -0,0 +1,196 @@
+/*
+ * ChunkCache.cpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "ChunkCache.hpp"
+
+#include <vlc_block.h>
+
+using namespace adaptive::http;
+
+static bool SameRange(const BytesRange &a, const BytesRange &b)
+{
+    if(a.isValid() != b.isValid())
+        return false;
+    if(!a.isValid())
+        return true;
+    return a.getStartByte() == b.getStartByte() &&
+           a.getEndByte() == b.getEndByte();
+}
+
+ChunkCache::ChunkCache(size_t maxsize_)
+{
+    vlc_mutex_init(&lock);
+    maxsize = maxsize_;
+    cursize = 0;
+    stats.hits = 0;
+    stats.misses = 0;
+    stats.evictions = 0;
+    stats.prefetched = 0;
+    stats.prefetchhits = 0;
+}
+
+ChunkCache::~ChunkCache()
+{
+    std::list<Entry>::iterator it;
+    for(it = entries.begin(); it != entries.end(); ++it)
+        block_ChainRelease((*it).p_data);
+    vlc_mutex_destroy(&lock);
+}
+
+std::list<ChunkCache::Entry>::iterator ChunkCache::find(const std::string &url,
+                                                        const BytesRange &range)
+{
+    std::list<Entry>::iterator it;
+    for(it = entries.begin(); it != entries.end(); ++it)
+    {
+        if((*it).url == url && SameRange((*it).range, range))
+            break;
+    }
+    return it;
+}
+
+std::list<ChunkCache::Entry>::const_iterator ChunkCache::find(const std::string &url,
+                                                              const BytesRange &range) const
+{
+    std::list<Entry>::const_iterator it;
+    for(it = entries.begin(); it != entries.end(); ++it)
+    {
+        if((*it).url == url && SameRange((*it).range, range))
+            break;
+    }
+    return it;
+}
+
+size_t ChunkCache::getMaxEntrySize() const
+{
+    /* don't let a single large segment flush everything else */
+    return maxsize / 4;
+}
+
+bool ChunkCache::contains(const std::string &url, const BytesRange &range) const
+{
+    vlc_mutex_locker locker(&lock);
+    return find(url, range) != entries.end();
+}
+
+block_t * ChunkCache::get(const std::string &url, const BytesRange &range)
+{
+    vlc_mutex_locker locker(&lock);
+
+    std::list<Entry>::iterator it = find(url, range);
+    if(it == entries.end())
+        return NULL;
+
+    /* hand out a copy, the consumer will modify blocks in place */
+    block_t *p_head = NULL;
+    block_t **pp_tail = &p_head;
+    for(const block_t *p = (*it).p_data; p; p = p->p_next)
+    {
+        block_t *p_dup = block_Alloc(p->i_buffer);
+        if(!p_dup)
+        {
+            block_ChainRelease(p_head);
+            return NULL;
+        }
+        memcpy(p_dup->p_buffer, p->p_buffer, p->i_buffer);
+        block_ChainLastAppend(&pp_tail, p_dup);
+    }
+
+    stats.hits++;
+    if((*it).b_prefetched)
+    {
+        stats.prefetchhits++;
+        (*it).b_prefetched = false;
+    }
+
+    /* move to front */
+    entries.splice(entries.begin(), entries, it);
+
+    return p_head;
+}
+
+void ChunkCache::missed()
+{
+    /* lookups can be repeated for a same segment,
+     * only its download counts as a miss */
+    vlc_mutex_locker locker(&lock);
+    stats.misses++;
+}
+
+void ChunkCache::evict(size_t needed)
+{
+    /* media segments first, least recently used first */
+    for(int pass = 0; pass < 2 && cursize + needed > maxsize; pass++)
+    {
+        std::list<Entry>::iterator it = entries.end();
+        while(it != entries.begin() && cursize + needed > maxsize)
+        {
+            --it;
+            if(pass == 0 && (*it).b_init)
+                continue;
+            cursize -= (*it).size;
+            block_ChainRelease((*it).p_data);
+            it = entries.erase(it);
+            stats.evictions++;
+        }
+    }
+}
+
+void ChunkCache::put(const std::string &url, const BytesRange &range,
+                     block_t *p_data, bool b_init, bool b_prefetched)
+{
+    size_t size;
+    block_ChainProperties(p_data, NULL, &size, NULL);
+
+    vlc_mutex_locker locker(&lock);
+
+    if(size == 0 || size > getMaxEntrySize() || find(url, range) != entries.end())
+    {
+        block_ChainRelease(p_data);
+        return;
+    }
+
+    evict(size);
+
+    Entry entry;
+    entry.url = url;
+    entry.range = range;
+    entry.p_data = p_data;
+    entry.size = size;
+    entry.b_init = b_init;
+    entry.b_prefetched = b_prefetched;
+    entries.push_front(entry);
+    cursize += size;
+
+    if(b_prefetched)
+        stats.prefetched++;
+}
+
+void ChunkCache::dumpStats(vlc_object_t *p_obj) const
+{
+    vlc_mutex_locker locker(&lock);
+    msg_Dbg(p_obj, "segment cache: %u hits, %u misses, %u evictions, "
+                   "%u/%u prefetched segments used, %zu/%zu bytes in use",
+            stats.hits, stats.misses, stats.evictions,
+            stats.prefetchhits, stats.prefetched, cursize, maxsize);
+}
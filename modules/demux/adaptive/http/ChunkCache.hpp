@@ -0,0 +1,82 @@
+/*
+ * ChunkCache.hpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef CHUNKCACHE_HPP
+#define CHUNKCACHE_HPP
+
+#include "BytesRange.hpp"
+
+#include <vlc_common.h>
+#include <list>
+#include <string>
+
+namespace adaptive
+{
+    namespace http
+    {
+        /* Memory bounded LRU store of completed segment downloads,
+         * keyed by url and byte range. Initialization segments are
+         * only evicted once no media segment remains. */
+        class ChunkCache
+        {
+            public:
+                ChunkCache(size_t);
+                ~ChunkCache();
+
+                block_t *   get         (const std::string &, const BytesRange &);
+                void        missed      ();
+                bool        contains    (const std::string &, const BytesRange &) const;
+                void        put         (const std::string &, const BytesRange &,
+                                         block_t *, bool, bool = false);
+                size_t      getMaxEntrySize () const;
+                void        dumpStats   (vlc_object_t *) const;
+
+            private:
+                class Entry
+                {
+                    public:
+                        std::string url;
+                        BytesRange  range;
+                        block_t    *p_data;
+                        size_t      size;
+                        bool        b_init;
+                        bool        b_prefetched;
+                };
+
+                std::list<Entry>::iterator find(const std::string &, const BytesRange &);
+                std::list<Entry>::const_iterator find(const std::string &, const BytesRange &) const;
+                void        evict       (size_t);
+
+                mutable vlc_mutex_t lock;
+                std::list<Entry> entries; /* most recently used first */
+                size_t      maxsize;
+                size_t      cursize;
+                struct
+                {
+                    unsigned hits;
+                    unsigned misses;
+                    unsigned evictions;
+                    unsigned prefetched;
+                    unsigned prefetchhits;
+                } stats;
+        };
+    }
+}
+
+#endif // CHUNKCACHE_HPP
@@ -26,6 +26,8 @@
 #include <vlc_threads.h>
 #include <vlc_atomic.h>
 
+#include <algorithm>
+
 using namespace adaptive::http;
 
 Downloader::Downloader()
@@ -69,11 +71,34 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
     vlc_mutex_unlock(&lock);
 }
 
+void Downloader::prefetch(HTTPChunkBufferedSource *source)
+{
+    vlc_mutex_lock(&lock);
+    source->hold();
+    prefetches.push_back(source);
+    vlc_cond_signal(&waitcond);
+    vlc_mutex_unlock(&lock);
+}
+
+void Downloader::promote(HTTPChunkBufferedSource *source)
+{
+    vlc_mutex_lock(&lock);
+    std::list<HTTPChunkBufferedSource *>::iterator it =
+            std::find(prefetches.begin(), prefetches.end(), source);
+    if(it != prefetches.end())
+    {
+        prefetches.erase(it);
+        chunks.push_back(source);
+    }
+    vlc_mutex_unlock(&lock);
+}
+
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     source->release();
     chunks.remove(source);
+    prefetches.remove(source);
     vlc_mutex_unlock(&lock);
 }
 
@@ -97,21 +122,22 @@ void Downloader::Run()
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        while(chunks.empty() && prefetches.empty() && !killed)
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        if(!chunks.empty())
+        /* speculative downloads only run when nothing else is
+           pending, and yield after each read */
+        std::list<HTTPChunkBufferedSource *> &queue = (!chunks.empty()) ? chunks
+                                                                        : prefetches;
+        HTTPChunkBufferedSource *source = queue.front();
+        DownloadSource(source);
+        if(source->isDone())
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-            {
-                chunks.pop_front();
-                source->release();
-            }
+            queue.pop_front();
+            source->release();
         }
     }
     vlc_mutex_unlock(&lock);
@@ -38,6 +38,8 @@ namespace adaptive
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
+                void prefetch(HTTPChunkBufferedSource *);
+                void promote(HTTPChunkBufferedSource *);
                 void cancel(HTTPChunkBufferedSource *);
 
             private:
@@ -50,6 +52,7 @@ namespace adaptive
                 bool         thread_handle_valid;
                 bool         killed;
                 std::list<HTTPChunkBufferedSource *> chunks;
+                std::list<HTTPChunkBufferedSource *> prefetches; /* only when idle */
         };
 
     }
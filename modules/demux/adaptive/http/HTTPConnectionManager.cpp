@@ -30,6 +30,7 @@
 #include "ConnectionParams.hpp"
 #include "Sockets.hpp"
 #include "Downloader.hpp"
+#include "ChunkCache.hpp"
 #include <vlc_url.h>
 
 using namespace adaptive::http;
@@ -39,6 +40,7 @@ AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
 {
     p_object = p_object_;
     rateObserver = NULL;
+    cache = NULL;
 }
 
 AbstractConnectionManager::~AbstractConnectionManager()
@@ -57,6 +59,11 @@ void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *o
     rateObserver = obs;
 }
 
+ChunkCache * AbstractConnectionManager::getCache() const
+{
+    return cache;
+}
+
 HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, ConnectionFactory *factory_)
     : AbstractConnectionManager( p_object_ )
 {
@@ -72,9 +79,23 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Connec
     }
     else
         factory = factory_;
+
+    vlc_mutex_init(&prefetchlock);
+    int64_t i_cachesize = var_InheritInteger(p_object, "adaptive-cache-size");
+    if(i_cachesize > 0)
+        cache = new (std::nothrow) ChunkCache(i_cachesize * 1024);
+    b_prefetch = cache && var_InheritBool(p_object, "adaptive-prefetch");
 }
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
+    /* must be gone before the downloader */
+    vlc_delete_all(prefetches);
+    vlc_mutex_destroy(&prefetchlock);
+    if(cache)
+    {
+        cache->dumpStats(p_object);
+        delete cache;
+    }
     delete downloader;
     delete factory;
     this->closeAllConnections();
@@ -138,11 +159,90 @@ AbstractConnection * HTTPConnectionManager::getConnection(ConnectionParams &para
     return conn;
 }
 
+HTTPChunkBufferedSource * HTTPConnectionManager::findPrefetch(const HTTPChunkBufferedSource *src)
+{
+    const BytesRange &range = src->getBytesRange();
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = prefetches.begin(); it != prefetches.end(); ++it)
+    {
+        const BytesRange &other = (*it)->getBytesRange();
+        if((*it)->getUrl() == src->getUrl() &&
+           other.getStartByte() == range.getStartByte() &&
+           other.getEndByte() == range.getEndByte())
+            return *it;
+    }
+    return NULL;
+}
+
+void HTTPConnectionManager::releaseCompletedPrefetches()
+{
+    std::list<HTTPChunkBufferedSource *> completed;
+
+    vlc_mutex_lock(&prefetchlock);
+    std::list<HTTPChunkBufferedSource *>::iterator it = prefetches.begin();
+    while(it != prefetches.end())
+    {
+        if((*it)->isDone())
+        {
+            completed.push_back(*it);
+            it = prefetches.erase(it);
+        }
+        else ++it;
+    }
+    vlc_mutex_unlock(&prefetchlock);
+
+    /* releases connections, data is already in cache */
+    vlc_delete_all(completed);
+}
+
 void HTTPConnectionManager::start(AbstractChunkSource *source)
 {
     HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
-    if(src)
-        downloader->schedule(src);
+    if(!src)
+        return;
+
+    if(cache)
+    {
+        releaseCompletedPrefetches();
+
+        if(src->restoreFromCache())
+            return;
+
+        /* Already being fetched speculatively: move it ahead of us so
+           we can pick its data from cache once it completes */
+        vlc_mutex_lock(&prefetchlock);
+        HTTPChunkBufferedSource *pending = findPrefetch(src);
+        if(pending)
+            downloader->promote(pending);
+        vlc_mutex_unlock(&prefetchlock);
+    }
+
+    downloader->schedule(src);
+}
+
+void HTTPConnectionManager::prefetch(AbstractChunkSource *source)
+{
+    HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
+    if(!src || !b_prefetch || !src->cacheable ||
+       cache->contains(src->getUrl(), src->getBytesRange()))
+    {
+        delete source;
+        return;
+    }
+
+    releaseCompletedPrefetches();
+
+    vlc_mutex_lock(&prefetchlock);
+    if(prefetches.size() >= MAX_PREFETCH || findPrefetch(src))
+    {
+        vlc_mutex_unlock(&prefetchlock);
+        delete source;
+        return;
+    }
+    src->prefetched = true;
+    prefetches.push_back(src);
+    downloader->prefetch(src);
+    vlc_mutex_unlock(&prefetchlock);
 }
 
 void HTTPConnectionManager::cancel(AbstractChunkSource *source)
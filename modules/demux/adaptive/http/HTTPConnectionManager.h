@@ -29,6 +29,7 @@
 
 #include <vlc_common.h>
 #include <vector>
+#include <list>
 #include <string>
 
 namespace adaptive
@@ -40,6 +41,8 @@ namespace adaptive
         class AbstractConnection;
         class Downloader;
         class AbstractChunkSource;
+        class HTTPChunkBufferedSource;
+        class ChunkCache;
 
         class AbstractConnectionManager : public IDownloadRateObserver
         {
@@ -50,12 +53,15 @@ namespace adaptive
                 virtual AbstractConnection * getConnection(ConnectionParams &) = 0;
                 virtual void start(AbstractChunkSource *) = 0;
                 virtual void cancel(AbstractChunkSource *) = 0;
+                virtual void prefetch(AbstractChunkSource *) = 0;
 
                 virtual void updateDownloadRate(const ID &, size_t, mtime_t); /* impl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
+                ChunkCache * getCache() const;
 
             protected:
                 vlc_object_t                                       *p_object;
+                ChunkCache                                         *cache;
 
             private:
                 IDownloadRateObserver                              *rateObserver;
@@ -72,9 +78,17 @@ namespace adaptive
 
                 virtual void start(AbstractChunkSource *) /* impl */;
                 virtual void cancel(AbstractChunkSource *) /* impl */;
+                virtual void prefetch(AbstractChunkSource *) /* impl */;
+
+                static const unsigned MAX_PREFETCH = 2;
 
             private:
                 void    releaseAllConnections ();
+                void    releaseCompletedPrefetches ();
+                HTTPChunkBufferedSource * findPrefetch(const HTTPChunkBufferedSource *);
+                std::list<HTTPChunkBufferedSource *>                prefetches;
+                vlc_mutex_t                                         prefetchlock;
+                bool                                                b_prefetch;
                 Downloader                                         *downloader;
                 vlc_mutex_t                                         lock;
                 std::vector<AbstractConnection *>                   connectionPool;
@@ -67,7 +67,8 @@ void ISegment::onChunkDownload(block_t **, SegmentChunk *, BaseRepresentation *)
 
 }
 
-SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractConnectionManager *connManager)
+HTTPChunkBufferedSource * ISegment::createSource(size_t index, BaseRepresentation *rep,
+                                                  AbstractConnectionManager *connManager) const
 {
     const std::string url = getUrlSegment().toString(index, rep);
     HTTPChunkBufferedSource *source = new (std::nothrow) HTTPChunkBufferedSource(url, connManager,
@@ -76,7 +77,16 @@ SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractC
     {
         if(startByte != endByte)
             source->setBytesRange(BytesRange(startByte, endByte));
+        source->setCacheable(true, classId == InitSegment::CLASSID_INITSEGMENT);
+    }
+    return source;
+}
 
+SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    HTTPChunkBufferedSource *source = createSource(index, rep, connManager);
+    if( source )
+    {
         SegmentChunk *chunk = new (std::nothrow) SegmentChunk(this, source, rep);
         if( chunk )
         {
@@ -91,6 +101,13 @@ SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractC
     return NULL;
 }
 
+void ISegment::prefetch(size_t index, BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    HTTPChunkBufferedSource *source = createSource(index, rep, connManager);
+    if( source )
+        connManager->prefetch(source); /* takes ownership */
+}
+
 bool ISegment::isTemplate() const
 {
     return templated;
@@ -38,6 +38,7 @@ namespace adaptive
     namespace http
     {
         class AbstractConnectionManager;
+        class HTTPChunkBufferedSource;
     }
 
     namespace playlist
@@ -59,6 +60,7 @@ namespace adaptive
                  *          when using an UrlTemplate
                  */
                 virtual SegmentChunk*                   toChunk         (size_t, BaseRepresentation *, AbstractConnectionManager *);
+                virtual void                            prefetch        (size_t, BaseRepresentation *, AbstractConnectionManager *);
                 virtual void                            setByteRange    (size_t start, size_t end);
                 virtual void                            setSequenceNumber(uint64_t);
                 virtual uint64_t                        getSequenceNumber() const;
@@ -76,10 +78,12 @@ namespace adaptive
                 bool                    discontinuity;
 
                 static const int CLASSID_ISEGMENT = 0;
+                static const int SEQUENCE_FIRST;
                 /* callbacks */
                 virtual void                            onChunkDownload (block_t **, SegmentChunk *, BaseRepresentation *);
 
             protected:
+                HTTPChunkBufferedSource *               createSource    (size_t, BaseRepresentation *, AbstractConnectionManager *) const;
                 size_t                  startByte;
                 size_t                  endByte;
                 std::string             debugName;
@@ -87,7 +91,6 @@ namespace adaptive
                 bool                    templated;
                 uint64_t                sequence;
                 static const int        SEQUENCE_INVALID;
-                static const int        SEQUENCE_FIRST;
         };
 
         class Segment : public ISegment
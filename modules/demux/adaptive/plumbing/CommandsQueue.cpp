@@ -69,13 +69,26 @@ AbstractFakeEsCommand::AbstractFakeEsCommand( int type, FakeESOutID *p_es ) :
 EsOutSendCommand::EsOutSendCommand( FakeESOutID *p_es, block_t *p_block_ ) :
     AbstractFakeEsCommand( ES_OUT_PRIVATE_COMMAND_SEND, p_es )
 {
-    p_block = p_block_;
+    p_block = NULL;
+    pp_last = &p_block;
+    block_ChainLastAppend( &pp_last, p_block_ );
 }
 
 EsOutSendCommand::~EsOutSendCommand()
 {
     if( p_block )
-        block_Release( p_block );
+        block_ChainRelease( p_block );
+}
+
+bool EsOutSendCommand::merge( EsOutSendCommand *other )
+{
+    /* Only data of the same ES can be sent as a single chain */
+    if( other->p_fakeid != p_fakeid || !p_block || !other->p_block )
+        return false;
+    block_ChainLastAppend( &pp_last, other->p_block );
+    other->p_block = NULL;
+    other->pp_last = &other->p_block;
+    return true;
 }
 
 void EsOutSendCommand::Execute( es_out_t *out )
@@ -325,8 +338,24 @@ mtime_t CommandsQueue::Process( es_out_t *out, mtime_t barrier )
         output.pop_front();
 
         if( command->getType() == ES_OUT_PRIVATE_COMMAND_SEND )
+        {
             lastdts = command->getTime();
 
+            /* Batch consecutive data of the same ES into one send */
+            EsOutSendCommand *send = static_cast<EsOutSendCommand *>( command );
+            while( !output.empty() &&
+                   output.front()->getType() == ES_OUT_PRIVATE_COMMAND_SEND )
+            {
+                EsOutSendCommand *next = static_cast<EsOutSendCommand *>( output.front() );
+                mtime_t nextdts = next->getTime();
+                if( !send->merge( next ) )
+                    break;
+                lastdts = nextdts;
+                output.pop_front();
+                delete next;
+            }
+        }
+
         command->Execute( out );
         delete command;
     }
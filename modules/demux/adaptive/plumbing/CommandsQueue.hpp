@@ -59,10 +59,12 @@ namespace adaptive
             virtual ~EsOutSendCommand();
             virtual void Execute( es_out_t *out );
             virtual mtime_t getTime() const;
+            bool merge( EsOutSendCommand * );
 
         protected:
             EsOutSendCommand( FakeESOutID *, block_t * );
             block_t *p_block;
+            block_t **pp_last;
     };
 
     class EsOutDelCommand : public AbstractFakeEsCommand
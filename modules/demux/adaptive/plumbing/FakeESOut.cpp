@@ -324,19 +324,30 @@ int FakeESOut::esOutSend_Callback(es_out_t *fakees, es_out_id_t *p_es, block_t *
     me->checkTimestampsStart( p_block->i_dts );
 
     mtime_t offset = me->getTimestampOffset();
-    if( p_block->i_dts > VLC_TS_INVALID )
-    {
-        p_block->i_dts += offset;
-        if( p_block->i_pts > VLC_TS_INVALID )
-                p_block->i_pts += offset;
-    }
-    AbstractCommand *command = me->commandsqueue->factory()->createEsOutSendCommand( es_id, p_block );
-    if( likely(command) )
+
+    /* Commands are sorted per block, chains are rebuilt on dequeue */
+    while( p_block )
     {
+        block_t *p_next = p_block->p_next;
+        p_block->p_next = NULL;
+
+        if( p_block->i_dts > VLC_TS_INVALID )
+        {
+            p_block->i_dts += offset;
+            if( p_block->i_pts > VLC_TS_INVALID )
+                    p_block->i_pts += offset;
+        }
+        AbstractCommand *command = me->commandsqueue->factory()->createEsOutSendCommand( es_id, p_block );
+        if( unlikely(!command) )
+        {
+            block_Release( p_block );
+            block_ChainRelease( p_next );
+            return VLC_EGENERIC;
+        }
         me->commandsqueue->Schedule( command );
-        return VLC_SUCCESS;
+        p_block = p_next;
     }
-    return VLC_EGENERIC;
+    return VLC_SUCCESS;
 }
 
 void FakeESOut::esOutDel_Callback(es_out_t *fakees, es_out_id_t *p_es)
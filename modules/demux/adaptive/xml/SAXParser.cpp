@@ -0,0 +1,100 @@
+/*
+ * SAXParser.cpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SAXParser.h"
+
+#include <vlc_xml.h>
+
+using namespace adaptive::xml;
+
+SAXParser::SAXParser(stream_t *stream_) :
+    stream( stream_ ),
+    vlc_reader( NULL )
+{
+}
+
+SAXParser::~SAXParser()
+{
+    if(vlc_reader)
+        xml_ReaderDelete(vlc_reader);
+}
+
+bool SAXParser::parse(SAXHandler *handler, bool b_strict)
+{
+    if(!stream)
+        return false;
+
+    if(!vlc_reader && !(vlc_reader = xml_ReaderCreate(stream, stream)))
+        return false;
+
+    const int i_flags = vlc_reader->obj.flags;
+    if(!b_strict)
+        vlc_reader->obj.flags |= OBJECT_FLAGS_QUIET;
+
+    const char *data;
+    int type;
+    unsigned depth = 0;
+    bool b_done = false;
+
+    while( !b_done && (type = xml_ReaderNextNode(vlc_reader, &data)) > 0 )
+    {
+        switch(type)
+        {
+            case XML_READER_STARTELEM:
+            {
+                /* must be queried before moving to attributes */
+                const bool b_empty = xml_ReaderIsEmptyElement(vlc_reader);
+                depth++;
+                handler->startElement(data, vlc_reader);
+                if(b_empty)
+                {
+                    handler->endElement(data);
+                    b_done = (--depth == 0);
+                }
+                break;
+            }
+
+            case XML_READER_TEXT:
+                if(depth)
+                    handler->characters(data);
+                break;
+
+            case XML_READER_ENDELEM:
+                if(depth == 0)
+                {
+                    b_done = true;
+                    break;
+                }
+                handler->endElement(data);
+                b_done = (--depth == 0);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    vlc_reader->obj.flags = i_flags;
+
+    return !b_strict || (b_done && depth == 0);
+}
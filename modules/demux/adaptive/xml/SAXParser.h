@@ -0,0 +1,58 @@
+/*
+ * SAXParser.h
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef SAXPARSER_H_
+#define SAXPARSER_H_
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+
+namespace adaptive
+{
+    namespace xml
+    {
+        /* Receives the document events, in order. Attributes of a starting
+         * element are read from the reader with xml_ReaderNextAttr() */
+        class SAXHandler
+        {
+            public:
+                virtual ~SAXHandler() {}
+                virtual void startElement   (const char *, xml_reader_t *) = 0;
+                virtual void endElement     (const char *) = 0;
+                virtual void characters     (const char *) = 0;
+        };
+
+        /* Streams the document to a handler, without building any tree */
+        class SAXParser
+        {
+            public:
+                SAXParser           (stream_t *stream);
+                virtual ~SAXParser  ();
+
+                bool                parse       (SAXHandler *, bool);
+
+            private:
+                stream_t            *stream;
+                xml_reader_t        *vlc_reader;
+        };
+    }
+}
+
+#endif /* SAXPARSER_H_ */
@@ -43,6 +43,7 @@
 #include <vlc_codecs.h>
 #include <vlc_charset.h>
 #include <vlc_memory.h>
+#include <vlc_seekindex.h>
 
 #include "libavi.h"
 #include "../rawdv.h"
@@ -198,6 +199,9 @@ struct demux_sys_t
 
     unsigned int       i_attachment;
     input_attachment_t **attachment;
+
+    /* index created by a previous session */
+    vlc_seekindex_t *p_seekidx;
 };
 
 static inline off_t __EVEN( off_t i )
@@ -226,6 +230,8 @@ static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static void AVI_IndexStore   ( demux_t *, off_t, off_t );
+static void AVI_IndexRestore ( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -861,6 +867,9 @@ error:
     if( p_sys->meta )
         vlc_meta_Delete( p_sys->meta );
 
+    if( p_sys->p_seekidx )
+        vlc_seekindex_Delete( p_sys->p_seekidx );
+
     AVI_ChunkFreeRoot( p_demux->s, &p_sys->ck_root );
     free( p_sys );
     return b_aborted ? VLC_ETIMEOUT : VLC_EGENERIC;
@@ -885,6 +894,9 @@ static void Close ( vlc_object_t * p_this )
     }
     free( p_sys->track );
 
+    if( p_sys->p_seekidx )
+        vlc_seekindex_Delete( p_sys->p_seekidx );
+
     AVI_ChunkFreeRoot( p_demux->s, &p_sys->ck_root );
     vlc_meta_Delete( p_sys->meta );
 
@@ -2631,6 +2643,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     mtime_t i_dialog_update;
     vlc_dialog_id *p_dialog_id = NULL;
+    bool b_complete = true;
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
@@ -2647,6 +2660,15 @@ static void AVI_IndexCreate( demux_t *p_demux )
     i_movi_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
                         stream_Size( p_demux->s ) );
 
+    if( p_sys->p_seekidx == NULL )
+        p_sys->p_seekidx = vlc_seekindex_New( p_demux, "avi", p_demux->psz_file );
+    if( p_sys->p_seekidx &&
+        vlc_seekindex_IsIndexed( p_sys->p_seekidx, p_movi->i_chunk_pos, i_movi_end ) )
+    {
+        AVI_IndexRestore( p_demux );
+        return;
+    }
+
     vlc_stream_Seek( p_demux->s, p_movi->i_chunk_pos + 12 );
     msg_Warn( p_demux, "creating index from LIST-movi, will take time !" );
 
@@ -2669,7 +2691,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( p_dialog_id != NULL && mdate() - i_dialog_update > 100000 )
         {
             if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            {
+                b_complete = false;
                 break;
+            }
 
             double f_current = vlc_stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2727,6 +2752,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
                 if( AVI_PacketSearch( p_demux ) )
                 {
                     msg_Warn( p_demux, "lost sync, abord index creation" );
+                    b_complete = false;
                     goto print_stat;
                 }
             }
@@ -2748,6 +2774,62 @@ print_stat:
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
     }
+
+    if( p_sys->p_seekidx && b_complete )
+        AVI_IndexStore( p_demux, p_movi->i_chunk_pos, i_movi_end );
+}
+
+/* Saves the created index, so that the next opening doesn't scan the
+ * whole file again */
+static void AVI_IndexStore( demux_t *p_demux, off_t i_start, off_t i_end )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i_stream]->idx;
+
+        for( unsigned i = 0; i < p_index->i_size; i++ )
+        {
+            const avi_entry_t *p_entry = &p_index->p_entry[i];
+            vlc_seekindex_entry_t entry = {
+                .i_time = VLC_TS_INVALID,
+                .i_offset = p_entry->i_pos,
+                .i_size = p_entry->i_length,
+                .i_track = i_stream,
+                .i_flags = (p_entry->i_flags & AVIIF_KEYFRAME) ? SEEKINDEX_KEYFRAME : 0,
+            };
+            if( vlc_seekindex_Add( p_sys->p_seekidx, &entry ) )
+                return; /* partial, don't mark it as indexed */
+        }
+    }
+    vlc_seekindex_AddRange( p_sys->p_seekidx, i_start, i_end );
+}
+
+static void AVI_IndexRestore( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+    {
+        avi_track_t *tk = p_sys->track[i_stream];
+        const vlc_seekindex_entry_t *p_entries;
+        size_t i_count = vlc_seekindex_GetEntries( p_sys->p_seekidx, i_stream,
+                                                   &p_entries );
+
+        for( size_t i = 0; i < i_count; i++ )
+        {
+            avi_entry_t index;
+            index.i_id      = 0;
+            index.i_flags   = (p_entries[i].i_flags & SEEKINDEX_KEYFRAME) ? AVIIF_KEYFRAME : 0;
+            index.i_pos     = p_entries[i].i_offset;
+            index.i_length  = p_entries[i].i_size;
+            index.i_lengthtotal = p_entries[i].i_size;
+            avi_index_Append( &tk->idx, &p_sys->i_movi_lastchunk_pos, &index );
+        }
+        msg_Dbg( p_demux, "stream[%u] restored %u index entries",
+                 i_stream, tk->idx.i_size );
+    }
 }
 
 /* */
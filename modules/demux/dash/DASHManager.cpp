@@ -31,8 +31,7 @@
 
 #include "DASHManager.h"
 #include "mpd/ProgramInformation.h"
-#include "mpd/IsoffMainParser.h"
-#include "xml/DOMParser.h"
+#include "mpd/IsoffStreamParser.h"
 #include "xml/Node.h"
 #include "../adaptive/tools/Helper.h"
 #include "../adaptive/http/HTTPConnectionManager.h"
@@ -114,14 +113,6 @@ bool DASHManager::updatePlaylist()
             return false;
         }
 
-        xml::DOMParser parser(mpdstream);
-        if(!parser.parse(true))
-        {
-            vlc_stream_Delete(mpdstream);
-            block_Release(p_block);
-            return false;
-        }
-
         mtime_t minsegmentTime = 0;
         std::vector<AbstractStream *>::iterator it;
         for(it=streams.begin(); it!=streams.end(); it++)
@@ -131,8 +122,8 @@ bool DASHManager::updatePlaylist()
                 minsegmentTime = segmentTime;
         }
 
-        IsoffMainParser mpdparser(parser.getRootNode(), VLC_OBJECT(p_demux),
-                                  mpdstream, Helper::getDirectoryPath(url).append("/"));
+        IsoffStreamParser mpdparser(VLC_OBJECT(p_demux), mpdstream,
+                                    Helper::getDirectoryPath(url).append("/"));
         MPD *newmpd = mpdparser.parse();
         if(newmpd)
         {
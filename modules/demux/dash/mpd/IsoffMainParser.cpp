@@ -142,10 +142,7 @@ void IsoffMainParser::parsePeriods(MPD *mpd, Node *root)
         if (!period)
             continue;
         parseSegmentInformation(*it, period, &nextid);
-        if((*it)->hasAttribute("start"))
-            period->startTime.Set(IsoTime((*it)->getAttributeValue("start")) * CLOCK_FREQ);
-        if((*it)->hasAttribute("duration"))
-            period->duration.Set(IsoTime((*it)->getAttributeValue("duration")) * CLOCK_FREQ);
+        parsePeriodAttributes(*it, period);
         std::vector<Node *> baseUrls = DOMHelper::getChildElementByTagName(*it, "BaseURL");
         if(!baseUrls.empty())
             period->baseUrl.Set( new Url( baseUrls.front()->getText() ) );
@@ -155,16 +152,36 @@ void IsoffMainParser::parsePeriods(MPD *mpd, Node *root)
     }
 }
 
+void IsoffMainParser::parsePeriodAttributes(Node *node, Period *period)
+{
+    if(node->hasAttribute("start"))
+        period->startTime.Set(IsoTime(node->getAttributeValue("start")) * CLOCK_FREQ);
+    if(node->hasAttribute("duration"))
+        period->duration.Set(IsoTime(node->getAttributeValue("duration")) * CLOCK_FREQ);
+}
+
 size_t IsoffMainParser::parseSegmentTemplate(Node *templateNode, SegmentInformation *info)
 {
-    size_t total = 0;
+    MediaSegmentTemplate *mediaTemplate = createSegmentTemplate(templateNode, info);
+    if(!mediaTemplate)
+        return 0;
+
+    parseTimeline(DOMHelper::getFirstChildElementByName(templateNode, "SegmentTimeline"), mediaTemplate);
+
+    info->setSegmentTemplate(mediaTemplate);
+
+    return 1;
+}
+
+MediaSegmentTemplate * IsoffMainParser::createSegmentTemplate(Node *templateNode, SegmentInformation *info)
+{
     if (templateNode == NULL || !templateNode->hasAttribute("media"))
-        return total;
+        return NULL;
 
     std::string mediaurl = templateNode->getAttributeValue("media");
     MediaSegmentTemplate *mediaTemplate = NULL;
     if(mediaurl.empty() || !(mediaTemplate = new (std::nothrow) MediaSegmentTemplate(info)) )
-        return total;
+        return NULL;
     mediaTemplate->setSourceUrl(mediaurl);
 
     if(templateNode->hasAttribute("startNumber"))
@@ -186,11 +203,7 @@ size_t IsoffMainParser::parseSegmentTemplate(Node *templateNode, SegmentInformat
     }
     mediaTemplate->initialisationSegment.Set(initTemplate);
 
-    parseTimeline(DOMHelper::getFirstChildElementByName(templateNode, "SegmentTimeline"), mediaTemplate);
-
-    info->setSegmentTemplate(mediaTemplate);
-
-    return ++total;
+    return mediaTemplate;
 }
 
 size_t IsoffMainParser::parseSegmentInformation(Node *node, SegmentInformation *info, uint64_t *nextid)
@@ -199,6 +212,12 @@ size_t IsoffMainParser::parseSegmentInformation(Node *node, SegmentInformation *
     total += parseSegmentBase(DOMHelper::getFirstChildElementByName(node, "SegmentBase"), info);
     total += parseSegmentList(DOMHelper::getFirstChildElementByName(node, "SegmentList"), info);
     total += parseSegmentTemplate(DOMHelper::getFirstChildElementByName(node, "SegmentTemplate" ), info);
+    parseSegmentInformationAttributes(node, info, nextid);
+    return total;
+}
+
+void IsoffMainParser::parseSegmentInformationAttributes(Node *node, SegmentInformation *info, uint64_t *nextid)
+{
     if(node->hasAttribute("bitstreamSwitching") && node->getAttributeValue("bitstreamSwitching") == "true")
     {
         info->setSwitchPolicy(SegmentInformation::SWITCH_BITSWITCHEABLE);
@@ -217,8 +236,6 @@ size_t IsoffMainParser::parseSegmentInformation(Node *node, SegmentInformation *
         info->setID(ID(node->getAttributeValue("id")));
     else
         info->setID(ID((*nextid)++));
-
-    return total;
 }
 
 void    IsoffMainParser::parseAdaptationSets  (Node *periodNode, Period *period)
@@ -232,34 +249,13 @@ void    IsoffMainParser::parseAdaptationSets  (Node *periodNode, Period *period)
         AdaptationSet *adaptationSet = new AdaptationSet(period);
         if(!adaptationSet)
             continue;
-        if((*it)->hasAttribute("mimeType"))
-            adaptationSet->setMimeType((*it)->getAttributeValue("mimeType"));
-
-        if((*it)->hasAttribute("lang"))
-        {
-            std::string lang = (*it)->getAttributeValue("lang");
-            std::size_t pos = lang.find_first_of('-');
-            if(pos != std::string::npos && pos > 0)
-                adaptationSet->addLang(lang.substr(0, pos));
-            else if (lang.size() < 4)
-                adaptationSet->addLang(lang);
-        }
+        parseAdaptationSetAttributes(*it, adaptationSet);
 
         Node *baseUrl = DOMHelper::getFirstChildElementByName((*it), "BaseURL");
         if(baseUrl)
             adaptationSet->baseUrl.Set(new Url(baseUrl->getText()));
 
-        Node *role = DOMHelper::getFirstChildElementByName((*it), "Role");
-        if(role && role->hasAttribute("schemeIdUri") && role->hasAttribute("value"))
-        {
-            std::string uri = role->getAttributeValue("schemeIdUri");
-            if(uri == "urn:mpeg:dash:role:2011")
-                adaptationSet->description.Set(role->getAttributeValue("value"));
-        }
-#ifdef ADAPTATIVE_ADVANCED_DEBUG
-        if(adaptationSet->description.Get().empty())
-            adaptationSet->description.Set(adaptationSet->getMimeType());
-#endif
+        parseRole(DOMHelper::getFirstChildElementByName((*it), "Role"), adaptationSet);
 
         parseSegmentInformation(*it, adaptationSet, &nextid);
 
@@ -267,6 +263,37 @@ void    IsoffMainParser::parseAdaptationSets  (Node *periodNode, Period *period)
         period->addAdaptationSet(adaptationSet);
     }
 }
+
+void IsoffMainParser::parseAdaptationSetAttributes(Node *node, AdaptationSet *adaptationSet)
+{
+    if(node->hasAttribute("mimeType"))
+        adaptationSet->setMimeType(node->getAttributeValue("mimeType"));
+
+    if(node->hasAttribute("lang"))
+    {
+        std::string lang = node->getAttributeValue("lang");
+        std::size_t pos = lang.find_first_of('-');
+        if(pos != std::string::npos && pos > 0)
+            adaptationSet->addLang(lang.substr(0, pos));
+        else if (lang.size() < 4)
+            adaptationSet->addLang(lang);
+    }
+}
+
+void IsoffMainParser::parseRole(Node *role, AdaptationSet *adaptationSet)
+{
+    if(role && role->hasAttribute("schemeIdUri") && role->hasAttribute("value"))
+    {
+        std::string uri = role->getAttributeValue("schemeIdUri");
+        if(uri == "urn:mpeg:dash:role:2011")
+            adaptationSet->description.Set(role->getAttributeValue("value"));
+    }
+#ifdef ADAPTATIVE_ADVANCED_DEBUG
+    if(adaptationSet->description.Get().empty())
+        adaptationSet->description.Set(adaptationSet->getMimeType());
+#endif
+}
+
 void    IsoffMainParser::parseRepresentations (Node *adaptationSetNode, AdaptationSet *adaptationSet)
 {
     std::vector<Node *> representations = DOMHelper::getElementByTagName(adaptationSetNode, "Representation", false);
@@ -281,48 +308,59 @@ void    IsoffMainParser::parseRepresentations (Node *adaptationSetNode, Adaptati
         if(!baseUrls.empty())
             currentRepresentation->baseUrl.Set(new Url(baseUrls.front()->getText()));
 
-        if(repNode->hasAttribute("id"))
-            currentRepresentation->setID(ID(repNode->getAttributeValue("id")));
+        parseRepresentationAttributes(repNode, currentRepresentation);
 
-        if(repNode->hasAttribute("width"))
-            currentRepresentation->setWidth(atoi(repNode->getAttributeValue("width").c_str()));
+        size_t i_total = parseSegmentInformation(repNode, currentRepresentation, &nextid);
+        addRepresentation(adaptationSet, currentRepresentation, i_total);
+    }
+}
 
-        if(repNode->hasAttribute("height"))
-            currentRepresentation->setHeight(atoi(repNode->getAttributeValue("height").c_str()));
+void IsoffMainParser::parseRepresentationAttributes(Node *repNode, Representation *currentRepresentation)
+{
+    if(repNode->hasAttribute("id"))
+        currentRepresentation->setID(ID(repNode->getAttributeValue("id")));
 
-        if(repNode->hasAttribute("bandwidth"))
-            currentRepresentation->setBandwidth(atoi(repNode->getAttributeValue("bandwidth").c_str()));
+    if(repNode->hasAttribute("width"))
+        currentRepresentation->setWidth(atoi(repNode->getAttributeValue("width").c_str()));
 
-        if(repNode->hasAttribute("mimeType"))
-            currentRepresentation->setMimeType(repNode->getAttributeValue("mimeType"));
+    if(repNode->hasAttribute("height"))
+        currentRepresentation->setHeight(atoi(repNode->getAttributeValue("height").c_str()));
 
-        if(repNode->hasAttribute("codecs"))
-        {
-            std::list<std::string> list = Helper::tokenize(repNode->getAttributeValue("codecs"), ',');
-            std::list<std::string>::const_iterator it;
-            for(it=list.begin(); it!=list.end(); ++it)
-            {
-                std::size_t pos = (*it).find_first_of('.', 0);
-                if(pos != std::string::npos)
-                    currentRepresentation->addCodec((*it).substr(0, pos));
-                else
-                    currentRepresentation->addCodec(*it);
-            }
-        }
+    if(repNode->hasAttribute("bandwidth"))
+        currentRepresentation->setBandwidth(atoi(repNode->getAttributeValue("bandwidth").c_str()));
 
-        size_t i_total = parseSegmentInformation(repNode, currentRepresentation, &nextid);
-        /* Empty Representation with just baseurl (ex: subtitles) */
-        if(i_total == 0 &&
-           (currentRepresentation->baseUrl.Get() && !currentRepresentation->baseUrl.Get()->empty()) &&
-            adaptationSet->getSegment(SegmentInformation::INFOTYPE_MEDIA, 0) == NULL)
+    if(repNode->hasAttribute("mimeType"))
+        currentRepresentation->setMimeType(repNode->getAttributeValue("mimeType"));
+
+    if(repNode->hasAttribute("codecs"))
+    {
+        std::list<std::string> list = Helper::tokenize(repNode->getAttributeValue("codecs"), ',');
+        std::list<std::string>::const_iterator it;
+        for(it=list.begin(); it!=list.end(); ++it)
         {
-            SegmentBase *base = new (std::nothrow) SegmentBase(currentRepresentation);
-            if(base)
-                currentRepresentation->setSegmentBase(base);
+            std::size_t pos = (*it).find_first_of('.', 0);
+            if(pos != std::string::npos)
+                currentRepresentation->addCodec((*it).substr(0, pos));
+            else
+                currentRepresentation->addCodec(*it);
         }
+    }
+}
 
-        adaptationSet->addRepresentation(currentRepresentation);
+void IsoffMainParser::addRepresentation(AdaptationSet *adaptationSet,
+                                        Representation *currentRepresentation, size_t i_total)
+{
+    /* Empty Representation with just baseurl (ex: subtitles) */
+    if(i_total == 0 &&
+       (currentRepresentation->baseUrl.Get() && !currentRepresentation->baseUrl.Get()->empty()) &&
+        adaptationSet->getSegment(SegmentInformation::INFOTYPE_MEDIA, 0) == NULL)
+    {
+        SegmentBase *base = new (std::nothrow) SegmentBase(currentRepresentation);
+        if(base)
+            currentRepresentation->setSegmentBase(base);
     }
+
+    adaptationSet->addRepresentation(currentRepresentation);
 }
 size_t IsoffMainParser::parseSegmentBase(Node * segmentBaseNode, SegmentInformation *info)
 {
@@ -365,58 +403,72 @@ size_t IsoffMainParser::parseSegmentBase(Node * segmentBaseNode, SegmentInformat
 size_t IsoffMainParser::parseSegmentList(Node * segListNode, SegmentInformation *info)
 {
     size_t total = 0;
-    if(segListNode)
+    SegmentList *list;
+    if(segListNode && (list = createSegmentList(segListNode, info)))
     {
+        parseInitSegment(DOMHelper::getFirstChildElementByName(segListNode, "Initialization"), list, info);
+
         std::vector<Node *> segments = DOMHelper::getElementByTagName(segListNode, "SegmentURL", false);
-        SegmentList *list;
-        if((list = new (std::nothrow) SegmentList(info)))
+        uint64_t nzStartTime = 0;
+        std::vector<Node *>::const_iterator it;
+        for(it = segments.begin(); it != segments.end(); ++it)
         {
-            parseInitSegment(DOMHelper::getFirstChildElementByName(segListNode, "Initialization"), list, info);
-
-            if(segListNode->hasAttribute("duration"))
-                list->duration.Set(Integer<stime_t>(segListNode->getAttributeValue("duration")));
+            Node *segmentURL = *it;
+            const char *mediaRange = NULL;
+            if(segmentURL->hasAttribute("mediaRange"))
+                mediaRange = segmentURL->getAttributeValue("mediaRange").c_str();
+            if(addSegmentURL(list, info, segmentURL->getAttributeValue("media").c_str(),
+                             mediaRange, total, &nzStartTime))
+                total++;
+        }
 
-            if(segListNode->hasAttribute("timescale"))
-                list->setTimescale(Integer<uint64_t>(segListNode->getAttributeValue("timescale")));
+        info->appendSegmentList(list, true);
+    }
+    return total;
+}
 
-            uint64_t nzStartTime = 0;
-            std::vector<Node *>::const_iterator it;
-            for(it = segments.begin(); it != segments.end(); ++it)
-            {
-                Node *segmentURL = *it;
+SegmentList * IsoffMainParser::createSegmentList(Node *segListNode, SegmentInformation *info)
+{
+    SegmentList *list = new (std::nothrow) SegmentList(info);
+    if(list)
+    {
+        if(segListNode->hasAttribute("duration"))
+            list->duration.Set(Integer<stime_t>(segListNode->getAttributeValue("duration")));
 
-                Segment *seg = new (std::nothrow) Segment(info);
-                if(!seg)
-                    continue;
+        if(segListNode->hasAttribute("timescale"))
+            list->setTimescale(Integer<uint64_t>(segListNode->getAttributeValue("timescale")));
+    }
+    return list;
+}
 
-                std::string mediaUrl = segmentURL->getAttributeValue("media");
-                if(!mediaUrl.empty())
-                    seg->setSourceUrl(mediaUrl);
+bool IsoffMainParser::addSegmentURL(SegmentList *list, SegmentInformation *info,
+                                    const char *mediaUrl, const char *mediaRange,
+                                    uint64_t number, uint64_t *nzStartTime)
+{
+    Segment *seg = new (std::nothrow) Segment(info);
+    if(!seg)
+        return false;
 
-                if(segmentURL->hasAttribute("mediaRange"))
-                {
-                    std::string range = segmentURL->getAttributeValue("mediaRange");
-                    size_t pos = range.find("-");
-                    seg->setByteRange(atoi(range.substr(0, pos).c_str()), atoi(range.substr(pos + 1, range.size()).c_str()));
-                }
+    if(mediaUrl && *mediaUrl)
+        seg->setSourceUrl(mediaUrl);
 
-                if(list->duration.Get())
-                {
-                    seg->startTime.Set(nzStartTime);
-                    seg->duration.Set(list->duration.Get());
-                    nzStartTime += list->duration.Get();
-                }
+    if(mediaRange)
+    {
+        const char *sep = strchr(mediaRange, '-');
+        seg->setByteRange(atoi(mediaRange), atoi(sep ? sep + 1 : mediaRange));
+    }
 
-                seg->setSequenceNumber(total);
+    if(list->duration.Get())
+    {
+        seg->startTime.Set(*nzStartTime);
+        seg->duration.Set(list->duration.Get());
+        *nzStartTime += list->duration.Get();
+    }
 
-                list->addSegment(seg);
-                total++;
-            }
+    seg->setSequenceNumber(number);
 
-            info->appendSegmentList(list, true);
-        }
-    }
-    return total;
+    list->addSegment(seg);
+    return true;
 }
 
 void IsoffMainParser::parseInitSegment(Node *initNode, Initializable<Segment> *init, SegmentInformation *parent)
@@ -442,11 +494,7 @@ void IsoffMainParser::parseTimeline(Node *node, MediaSegmentTemplate *templ)
     if(!node)
         return;
 
-    uint64_t number = 0;
-    if(node->hasAttribute("startNumber"))
-        number = Integer<uint64_t>(node->getAttributeValue("startNumber"));
-    else if(templ->startNumber.Get())
-        number = templ->startNumber.Get();
+    uint64_t number = getTimelineStartNumber(node, templ);
 
     SegmentTimeline *timeline = new (std::nothrow) SegmentTimeline(templ);
     if(timeline)
@@ -464,18 +512,34 @@ void IsoffMainParser::parseTimeline(Node *node, MediaSegmentTemplate *templ)
                 r = Integer<uint64_t>(s->getAttributeValue("r"));
 
             if(s->hasAttribute("t"))
-            {
-                stime_t t = Integer<stime_t>(s->getAttributeValue("t"));
-                timeline->addElement(number, d, r, t);
-            }
-            else timeline->addElement(number, d, r);
-
-            number += (1 + r);
+                addTimelineElement(timeline, &number, d, r, Integer<stime_t>(s->getAttributeValue("t")));
+            else
+                addTimelineElement(timeline, &number, d, r);
         }
         templ->segmentTimeline.Set(timeline);
     }
 }
 
+uint64_t IsoffMainParser::getTimelineStartNumber(Node *node, const MediaSegmentTemplate *templ)
+{
+    if(node->hasAttribute("startNumber"))
+        return Integer<uint64_t>(node->getAttributeValue("startNumber"));
+    else if(templ->startNumber.Get())
+        return templ->startNumber.Get();
+    return 0;
+}
+
+void IsoffMainParser::addTimelineElement(SegmentTimeline *timeline, uint64_t *number,
+                                         stime_t d, uint64_t r, stime_t t)
+{
+    if(t >= 0)
+        timeline->addElement(*number, d, r, t);
+    else
+        timeline->addElement(*number, d, r);
+
+    *number += (1 + r);
+}
+
 void IsoffMainParser::parseProgramInformation(Node * node, MPD *mpd)
 {
     if(!node)
@@ -504,9 +568,14 @@ void IsoffMainParser::parseProgramInformation(Node * node, MPD *mpd)
 }
 
 Profile IsoffMainParser::getProfile() const
+{
+    return getProfile(root);
+}
+
+Profile IsoffMainParser::getProfile(Node *root)
 {
     Profile res(Profile::Unknown);
-    if(this->root == NULL)
+    if(root == NULL)
         return res;
 
     std::string urn = root->getAttributeValue("profiles");
@@ -42,6 +42,8 @@ namespace adaptive
     {
         class SegmentInformation;
         class MediaSegmentTemplate;
+        class SegmentList;
+        class SegmentTimeline;
     }
     namespace xml
     {
@@ -55,6 +57,7 @@ namespace dash
     {
         class Period;
         class AdaptationSet;
+        class Representation;
         class MPD;
 
         using namespace adaptive::playlist;
@@ -68,19 +71,33 @@ namespace dash
                 virtual ~IsoffMainParser    ();
                 MPD *   parse();
 
-            private:
+            protected:
                 mpd::Profile getProfile     () const;
+                static mpd::Profile getProfile(xml::Node *);
                 void    parseMPDBaseUrl     (MPD *, xml::Node *);
                 void    parseMPDAttributes  (MPD *, xml::Node *);
                 void    parseAdaptationSets (xml::Node *periodNode, Period *period);
+                void    parseAdaptationSetAttributes(xml::Node *, AdaptationSet *);
+                void    parseRole           (xml::Node *, AdaptationSet *);
                 void    parseRepresentations(xml::Node *adaptationSetNode, AdaptationSet *adaptationSet);
+                void    parseRepresentationAttributes(xml::Node *, Representation *);
+                void    addRepresentation   (AdaptationSet *, Representation *, size_t);
                 void    parseInitSegment    (xml::Node *, Initializable<Segment> *, SegmentInformation *);
                 void    parseTimeline       (xml::Node *, MediaSegmentTemplate *);
+                uint64_t getTimelineStartNumber(xml::Node *, const MediaSegmentTemplate *);
+                void    addTimelineElement  (SegmentTimeline *, uint64_t *,
+                                             stime_t, uint64_t, stime_t = -1);
                 void    parsePeriods        (MPD *, xml::Node *);
+                void    parsePeriodAttributes(xml::Node *, Period *);
                 size_t  parseSegmentInformation(xml::Node *, SegmentInformation *, uint64_t *);
+                void    parseSegmentInformationAttributes(xml::Node *, SegmentInformation *, uint64_t *);
                 size_t  parseSegmentBase    (xml::Node *, SegmentInformation *);
                 size_t  parseSegmentList    (xml::Node *, SegmentInformation *);
+                SegmentList * createSegmentList(xml::Node *, SegmentInformation *);
+                bool    addSegmentURL       (SegmentList *, SegmentInformation *,
+                                             const char *, const char *, uint64_t, uint64_t *);
                 size_t  parseSegmentTemplate(xml::Node *, SegmentInformation *);
+                MediaSegmentTemplate * createSegmentTemplate(xml::Node *, SegmentInformation *);
                 void    parseProgramInformation(xml::Node *, MPD *);
 
                 xml::Node       *root;
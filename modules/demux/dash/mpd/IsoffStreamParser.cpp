@@ -0,0 +1,449 @@
+/*
+ * IsoffStreamParser.cpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "IsoffStreamParser.h"
+#include "../adaptive/playlist/SegmentTemplate.h"
+#include "../adaptive/playlist/SegmentList.h"
+#include "../adaptive/playlist/SegmentTimeline.h"
+#include "../adaptive/tools/Helper.h"
+#include "../adaptive/xml/Node.h"
+#include "MPD.h"
+#include "Representation.h"
+#include "Period.h"
+#include "AdaptationSet.h"
+
+#include <vlc_xml.h>
+#include <cstring>
+
+using namespace dash::mpd;
+using namespace adaptive::xml;
+using namespace adaptive::playlist;
+
+IsoffStreamParser::IsoffStreamParser(vlc_object_t *p_object_, stream_t *stream,
+                                     const std::string &streambaseurl_) :
+    IsoffMainParser(NULL, p_object_, stream, streambaseurl_)
+{
+    mpd = NULL;
+    period = NULL;
+    adaptationSet = NULL;
+    representation = NULL;
+    segmentList = NULL;
+    segmentTemplate = NULL;
+    segmentTimeline = NULL;
+    periodNextId = 0;
+    adaptationSetNextId = 0;
+    representationNextId = 0;
+    representationSegmentInfos = 0;
+    segmentNumber = 0;
+    segmentStartTime = 0;
+    b_programInfo = false;
+    b_role = false;
+}
+
+IsoffStreamParser::~IsoffStreamParser()
+{
+    release();
+}
+
+void IsoffStreamParser::release()
+{
+    /* drop everything not yet attached to its parent */
+    delete segmentTimeline;
+    segmentTimeline = NULL;
+    delete segmentTemplate;
+    segmentTemplate = NULL;
+    delete segmentList;
+    segmentList = NULL;
+    delete representation;
+    representation = NULL;
+    delete adaptationSet;
+    adaptationSet = NULL;
+    delete period;
+    period = NULL;
+    delete mpd;
+    mpd = NULL;
+    while(!captured.empty())
+    {
+        if(captured.size() == 1)
+            delete captured.top();
+        captured.pop();
+    }
+    elements.clear();
+}
+
+MPD * IsoffStreamParser::parse()
+{
+    xml::SAXParser parser(p_stream);
+    if(!parser.parse(this, true) || !mpd || !elements.empty())
+    {
+        release();
+        return NULL;
+    }
+
+    MPD *ret = mpd;
+    mpd = NULL;
+    ret->debug();
+    return ret;
+}
+
+Node * IsoffStreamParser::readAttributes(xml_reader_t *reader) const
+{
+    Node *node = new (std::nothrow) Node();
+    if(node)
+    {
+        const char *name, *value;
+        while((name = xml_ReaderNextAttr(reader, &value)) != NULL)
+            node->addAttribute(name, value);
+    }
+    return node;
+}
+
+SegmentInformation * IsoffStreamParser::currentSegmentInformation() const
+{
+    if(representation)
+        return representation;
+    else if(adaptationSet)
+        return adaptationSet;
+    else
+        return period;
+}
+
+void IsoffStreamParser::startElement(const char *name, xml_reader_t *reader)
+{
+    ElementType type;
+
+    if(!captured.empty())
+    {
+        Node *node = readAttributes(reader);
+        if(node)
+        {
+            node->setName(name);
+            captured.top()->addSubNode(node);
+        }
+        /* always keep the stack balanced */
+        captured.push(node ? node : captured.top());
+        type = ELEMENT_CAPTURED;
+    }
+    else if(elements.empty())
+    {
+        type = ELEMENT_IGNORED;
+        if(!mpd && !strcmp(name, "MPD"))
+        {
+            Node *node = readAttributes(reader);
+            if(node)
+            {
+                mpd = new (std::nothrow) MPD(p_object, getProfile(node));
+                if(mpd)
+                {
+                    parseMPDAttributes(mpd, node);
+                    mpd->setPlaylistUrl( Helper::getDirectoryPath(playlisturl).append("/") );
+                    type = ELEMENT_MPD;
+                }
+                delete node;
+            }
+        }
+    }
+    else
+    {
+        type = startChildElement(elements.back(), name, reader);
+    }
+
+    elements.push_back(type);
+}
+
+IsoffStreamParser::ElementType
+IsoffStreamParser::startChildElement(ElementType parent, const char *name, xml_reader_t *reader)
+{
+    ElementType type = ELEMENT_IGNORED;
+    Node *node = NULL;
+
+    switch(parent)
+    {
+        case ELEMENT_MPD:
+            if(!strcmp(name, "Period"))
+            {
+                if(!(node = readAttributes(reader)) ||
+                   !(period = new (std::nothrow) Period(mpd)))
+                    break;
+                parseSegmentInformationAttributes(node, period, &periodNextId);
+                parsePeriodAttributes(node, period);
+                adaptationSetNextId = 0;
+                type = ELEMENT_PERIOD;
+            }
+            else if(!strcmp(name, "BaseURL") ||
+                    (!strcmp(name, "ProgramInformation") && !b_programInfo))
+            {
+                type = ELEMENT_CAPTURED;
+            }
+            break;
+
+        case ELEMENT_PERIOD:
+            if(!strcmp(name, "AdaptationSet"))
+            {
+                if(!(node = readAttributes(reader)) ||
+                   !(adaptationSet = new (std::nothrow) AdaptationSet(period)))
+                    break;
+                parseAdaptationSetAttributes(node, adaptationSet);
+                parseSegmentInformationAttributes(node, adaptationSet, &adaptationSetNextId);
+                representationNextId = 0;
+                b_role = false;
+                type = ELEMENT_ADAPTATIONSET;
+                break;
+            }
+            /* fallthrough */
+        case ELEMENT_ADAPTATIONSET:
+            if(parent == ELEMENT_ADAPTATIONSET && !strcmp(name, "Representation"))
+            {
+                if(!(node = readAttributes(reader)) ||
+                   !(representation = new (std::nothrow) Representation(adaptationSet)))
+                    break;
+                parseRepresentationAttributes(node, representation);
+                parseSegmentInformationAttributes(node, representation, &representationNextId);
+                representationSegmentInfos = 0;
+                type = ELEMENT_REPRESENTATION;
+                break;
+            }
+            if(parent == ELEMENT_ADAPTATIONSET && !strcmp(name, "Role") && !b_role)
+            {
+                type = ELEMENT_CAPTURED;
+                break;
+            }
+            /* fallthrough */
+        case ELEMENT_REPRESENTATION:
+            if(!strcmp(name, "SegmentList"))
+            {
+                if(!(node = readAttributes(reader)) ||
+                   !(segmentList = createSegmentList(node, currentSegmentInformation())))
+                    break;
+                segmentNumber = 0;
+                segmentStartTime = 0;
+                type = ELEMENT_SEGMENTLIST;
+            }
+            else if(!strcmp(name, "SegmentTemplate"))
+            {
+                if(!(node = readAttributes(reader)))
+                    break;
+                segmentTemplate = createSegmentTemplate(node, currentSegmentInformation());
+                if(segmentTemplate)
+                    type = ELEMENT_SEGMENTTEMPLATE;
+            }
+            else if(!strcmp(name, "BaseURL") || !strcmp(name, "SegmentBase"))
+            {
+                type = ELEMENT_CAPTURED;
+            }
+            break;
+
+        case ELEMENT_SEGMENTLIST:
+            if(!strcmp(name, "SegmentURL"))
+            {
+                /* attribute values are only valid until the next one is read */
+                std::string media, mediaRange;
+                bool b_range = false;
+                const char *attr, *value;
+                while((attr = xml_ReaderNextAttr(reader, &value)) != NULL)
+                {
+                    if(!strcmp(attr, "media"))
+                        media = value;
+                    else if(!strcmp(attr, "mediaRange"))
+                    {
+                        mediaRange = value;
+                        b_range = true;
+                    }
+                }
+                if(addSegmentURL(segmentList, currentSegmentInformation(), media.c_str(),
+                                 b_range ? mediaRange.c_str() : NULL,
+                                 segmentNumber, &segmentStartTime))
+                    segmentNumber++;
+                type = ELEMENT_SEGMENTURL;
+            }
+            else if(!strcmp(name, "Initialization"))
+            {
+                type = ELEMENT_CAPTURED;
+            }
+            break;
+
+        case ELEMENT_SEGMENTTEMPLATE:
+            if(!strcmp(name, "SegmentTimeline") && !segmentTemplate->segmentTimeline.Get())
+            {
+                if(!(node = readAttributes(reader)) ||
+                   !(segmentTimeline = new (std::nothrow) SegmentTimeline(segmentTemplate)))
+                    break;
+                segmentNumber = getTimelineStartNumber(node, segmentTemplate);
+                type = ELEMENT_SEGMENTTIMELINE;
+            }
+            break;
+
+        case ELEMENT_SEGMENTTIMELINE:
+            if(!strcmp(name, "S"))
+            {
+                stime_t t = -1, d = -1;
+                uint64_t r = 0; // never repeats by default
+                const char *attr, *value;
+                while((attr = xml_ReaderNextAttr(reader, &value)) != NULL)
+                {
+                    if(attr[0] == '\0' || attr[1] != '\0')
+                        continue;
+                    switch(attr[0])
+                    {
+                        case 't': t = strtoll(value, NULL, 10); break;
+                        case 'd': d = strtoll(value, NULL, 10); break;
+                        case 'r': r = strtoull(value, NULL, 10); break;
+                        default: break;
+                    }
+                }
+                if(d >= 0) /* Mandatory */
+                    addTimelineElement(segmentTimeline, &segmentNumber, d, r, t);
+                type = ELEMENT_S;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    delete node;
+
+    if(type == ELEMENT_CAPTURED)
+    {
+        if((node = readAttributes(reader)))
+        {
+            node->setName(name);
+            captured.push(node);
+        }
+        else type = ELEMENT_IGNORED;
+    }
+
+    return type;
+}
+
+void IsoffStreamParser::characters(const char *text)
+{
+    if(!captured.empty())
+        captured.top()->setText(text);
+}
+
+void IsoffStreamParser::endElement(const char *)
+{
+    if(elements.empty())
+        return;
+
+    const ElementType type = elements.back();
+    elements.pop_back();
+
+    switch(type)
+    {
+        case ELEMENT_CAPTURED:
+        {
+            Node *node = captured.top();
+            captured.pop();
+            if(captured.empty())
+            {
+                endCapturedNode(elements.back(), node);
+                delete node;
+            }
+            break;
+        }
+
+        case ELEMENT_SEGMENTTIMELINE:
+            segmentTemplate->segmentTimeline.Set(segmentTimeline);
+            segmentTimeline = NULL;
+            break;
+
+        case ELEMENT_SEGMENTTEMPLATE:
+            currentSegmentInformation()->setSegmentTemplate(segmentTemplate);
+            segmentTemplate = NULL;
+            representationSegmentInfos++;
+            break;
+
+        case ELEMENT_SEGMENTLIST:
+            currentSegmentInformation()->appendSegmentList(segmentList, true);
+            segmentList = NULL;
+            representationSegmentInfos += segmentNumber;
+            break;
+
+        case ELEMENT_REPRESENTATION:
+            addRepresentation(adaptationSet, representation, representationSegmentInfos);
+            representation = NULL;
+            break;
+
+        case ELEMENT_ADAPTATIONSET:
+            if(!b_role)
+                parseRole(NULL, adaptationSet);
+            period->addAdaptationSet(adaptationSet);
+            adaptationSet = NULL;
+            break;
+
+        case ELEMENT_PERIOD:
+            mpd->addPeriod(period);
+            period = NULL;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void IsoffStreamParser::endCapturedNode(ElementType parent, Node *node)
+{
+    const std::string &name = node->getName();
+
+    if(name == "BaseURL")
+    {
+        switch(parent)
+        {
+            case ELEMENT_MPD:
+                mpd->addBaseUrl(node->getText());
+                break;
+            case ELEMENT_PERIOD:
+            case ELEMENT_ADAPTATIONSET:
+            case ELEMENT_REPRESENTATION:
+            {
+                SegmentInformation *info = currentSegmentInformation();
+                if(!info->baseUrl.Get())
+                    info->baseUrl.Set(new Url(node->getText()));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    else if(name == "SegmentBase")
+    {
+        representationSegmentInfos += parseSegmentBase(node, currentSegmentInformation());
+    }
+    else if(name == "Initialization")
+    {
+        parseInitSegment(node, segmentList, currentSegmentInformation());
+    }
+    else if(name == "Role")
+    {
+        parseRole(node, adaptationSet);
+        b_role = true;
+    }
+    else if(name == "ProgramInformation")
+    {
+        parseProgramInformation(node, mpd);
+        b_programInfo = true;
+    }
+}
@@ -0,0 +1,95 @@
+/*
+ * IsoffStreamParser.h
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef ISOFFSTREAMPARSER_H_
+#define ISOFFSTREAMPARSER_H_
+
+#include "IsoffMainParser.h"
+#include "../adaptive/xml/SAXParser.h"
+
+#include <vector>
+#include <stack>
+
+namespace dash
+{
+    namespace mpd
+    {
+        /* Builds the MPD directly from the xml reader events, without
+         * building the document tree. Only the small leaf elements
+         * (BaseURL, Role, SegmentBase, ...) are collected as nodes. */
+        class IsoffStreamParser : public IsoffMainParser,
+                                  public xml::SAXHandler
+        {
+            public:
+                IsoffStreamParser           (vlc_object_t *p_object,
+                                             stream_t *p_stream, const std::string &);
+                virtual ~IsoffStreamParser  ();
+                MPD *   parse();
+
+                virtual void startElement   (const char *, xml_reader_t *); /* impl */
+                virtual void endElement     (const char *); /* impl */
+                virtual void characters     (const char *); /* impl */
+
+            private:
+                enum ElementType
+                {
+                    ELEMENT_MPD,
+                    ELEMENT_PERIOD,
+                    ELEMENT_ADAPTATIONSET,
+                    ELEMENT_REPRESENTATION,
+                    ELEMENT_SEGMENTLIST,
+                    ELEMENT_SEGMENTURL,
+                    ELEMENT_SEGMENTTEMPLATE,
+                    ELEMENT_SEGMENTTIMELINE,
+                    ELEMENT_S,
+                    ELEMENT_CAPTURED,
+                    ELEMENT_IGNORED,
+                };
+
+                ElementType startChildElement(ElementType, const char *, xml_reader_t *);
+                void    endCapturedNode     (ElementType, xml::Node *);
+                SegmentInformation * currentSegmentInformation() const;
+                xml::Node * readAttributes  (xml_reader_t *) const;
+                void    release             ();
+
+                std::vector<ElementType>    elements;
+                std::stack<xml::Node *>     captured;
+
+                MPD                     *mpd;
+                Period                  *period;
+                AdaptationSet           *adaptationSet;
+                Representation          *representation;
+                SegmentList             *segmentList;
+                MediaSegmentTemplate    *segmentTemplate;
+                SegmentTimeline         *segmentTimeline;
+
+                uint64_t    periodNextId;
+                uint64_t    adaptationSetNextId;
+                uint64_t    representationNextId;
+                size_t      representationSegmentInfos;
+                uint64_t    segmentNumber;
+                uint64_t    segmentStartTime;
+                bool        b_programInfo;
+                bool        b_role;
+        };
+    }
+}
+
+#endif /* ISOFFSTREAMPARSER_H_ */
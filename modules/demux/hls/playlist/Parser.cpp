@@ -40,6 +40,7 @@
 #include <map>
 #include <cctype>
 #include <algorithm>
+#include <ctime>
 
 using namespace adaptive;
 using namespace adaptive::playlist;
@@ -160,7 +161,26 @@ void M3U8Parser::createAndFillRepresentation(vlc_object_t *p_obj, BaseAdaptation
 
 bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representation *rep)
 {
-    block_t *p_block = Retrieve::HTTP(p_obj, rep->getPlaylistUrl().toString());
+    const std::string url = rep->getPlaylistUrl().toString();
+    if(rep->canRequestDelta())
+    {
+        /* Ask for a Playlist Delta Update, falls back to the full
+         * playlist if we can't reconstruct the skipped part */
+        std::string deltaurl(url);
+        deltaurl.append((url.find('?') == std::string::npos) ? "?" : "&");
+        deltaurl.append("_HLS_skip=YES");
+        if(appendSegmentsFromURL(p_obj, rep, deltaurl))
+            return true;
+        msg_Dbg(p_obj, "playlist delta update failed for %s, reloading", url.c_str());
+    }
+    return appendSegmentsFromURL(p_obj, rep, url);
+}
+
+bool M3U8Parser::appendSegmentsFromURL(vlc_object_t *p_obj, Representation *rep,
+                                       const std::string &url)
+{
+    bool b_ret = false;
+    block_t *p_block = Retrieve::HTTP(p_obj, url);
     if(p_block)
     {
         stream_t *substream = vlc_stream_MemoryNew(p_obj, p_block->p_buffer, p_block->i_buffer, true);
@@ -169,22 +189,34 @@ bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representati
             std::list<Tag *> tagslist = parseEntries(substream);
             vlc_stream_Delete(substream);
 
-            parseSegments(p_obj, rep, tagslist);
+            b_ret = parseSegments(p_obj, rep, tagslist);
 
             releaseTagsList(tagslist);
         }
         block_Release(p_block);
-        return true;
     }
-    return false;
+    return b_ret;
 }
 
-void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::list<Tag *> &tagslist)
+bool M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::list<Tag *> &tagslist)
 {
+    /* On reload, segments we already hold are only accounted for:
+     * only the appended ones are created and merged */
+    std::vector<ISegment *> knownsegments;
+    if(rep->b_loaded)
+        rep->getSegments(SegmentInformation::INFOTYPE_MEDIA, knownsegments);
+    const bool b_hasknown = !knownsegments.empty();
+    /* as media sequence numbers, segments are numbered from SEQUENCE_FIRST */
+    const uint64_t lastknownnumber = b_hasknown ? knownsegments.back()->getSequenceNumber()
+                                                  - ISegment::SEQUENCE_FIRST : 0;
+
     SegmentList *segmentList = new (std::nothrow) SegmentList(rep);
+    if(!segmentList)
+        return false;
 
     rep->setTimescale(100);
     rep->b_loaded = true;
+    rep->lastUpdateTime = time(NULL);
 
     mtime_t totalduration = 0;
     mtime_t nzStartTime = 0;
@@ -225,9 +257,43 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
                     break;
                 }
 
-                HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber++);
-                if(!segment)
+                mtime_t nzDuration = 0;
+                double duration = 0.0;
+                if(ctx_extinf)
+                {
+                    const Attribute *attribute = ctx_extinf->getAttributeByName("DURATION");
+                    if(attribute)
+                    {
+                        duration = attribute->floatingPoint();
+                        nzDuration = CLOCK_FREQ * duration;
+                    }
+                }
+
+                std::pair<std::size_t,std::size_t> range(0, 0);
+                if(ctx_byterange)
+                {
+                    range = ctx_byterange->getValue().getByteRange();
+                    if(range.first == 0) /* first == size, second = offset */
+                        range.first = prevbyterangeoffset;
+                    prevbyterangeoffset = range.first + range.second;
+                }
+
+                HLSSegment *segment = NULL;
+                if(!b_hasknown || sequenceNumber > lastknownnumber)
+                    segment = new (std::nothrow) HLSSegment(rep, sequenceNumber);
+                sequenceNumber++;
+
+                if(!segment) /* already known, only keep context */
+                {
+                    nzStartTime += nzDuration;
+                    totalduration += nzDuration;
+                    if(absReferenceTime > VLC_TS_INVALID)
+                        absReferenceTime += nzDuration;
+                    ctx_extinf = NULL;
+                    ctx_byterange = NULL;
+                    discontinuity = false;
                     break;
+                }
 
                 segment->setSourceUrl(uritag->getValue().value);
                 if((unsigned)rep->getStreamFormat() == StreamFormat::UNKNOWN)
@@ -235,11 +301,8 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
 
                 if(ctx_extinf)
                 {
-                    const Attribute *attribute = ctx_extinf->getAttributeByName("DURATION");
-                    if(attribute)
+                    if(ctx_extinf->getAttributeByName("DURATION"))
                     {
-                        const double duration = attribute->floatingPoint();
-                        const mtime_t nzDuration = CLOCK_FREQ * duration;
                         segment->duration.Set(duration * (uint64_t) rep->getTimescale());
                         segment->startTime.Set(rep->getTimescale().ToScaled(nzStartTime));
                         nzStartTime += nzDuration;
@@ -258,10 +321,6 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
 
                 if(ctx_byterange)
                 {
-                    std::pair<std::size_t,std::size_t> range = ctx_byterange->getValue().getByteRange();
-                    if(range.first == 0) /* first == size, second = offset */
-                        range.first = prevbyterangeoffset;
-                    prevbyterangeoffset = range.first + range.second;
                     segment->setByteRange(range.first, prevbyterangeoffset - 1);
                     ctx_byterange = NULL;
                 }
@@ -277,6 +336,65 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
             }
             break;
 
+            case AttributesTag::EXTXSKIP:
+            {
+                /* Playlist Delta Update: the skipped segments must all be known */
+                const Attribute *skippedAttr =
+                        static_cast<const AttributesTag *>(tag)->getAttributeByName("SKIPPED-SEGMENTS");
+                if(!skippedAttr || !b_hasknown)
+                {
+                    delete segmentList;
+                    return false;
+                }
+
+                /* skipped segments still span the playlist timeline */
+                const uint64_t skipped = skippedAttr->decimal();
+                uint64_t accounted = 0;
+                std::vector<ISegment *>::const_iterator kit;
+                for(kit = knownsegments.begin(); kit != knownsegments.end() &&
+                                                 accounted < skipped; ++kit)
+                {
+                    const ISegment *knownSeg = *kit;
+                    const uint64_t knownnumber = knownSeg->getSequenceNumber() - ISegment::SEQUENCE_FIRST;
+                    if(knownnumber < sequenceNumber + accounted)
+                        continue;
+                    if(knownnumber != sequenceNumber + accounted)
+                        break;
+                    const mtime_t nzDuration =
+                            rep->getTimescale().ToTime(knownSeg->duration.Get());
+                    nzStartTime += nzDuration;
+                    totalduration += nzDuration;
+                    accounted++;
+                }
+                if(accounted != skipped)
+                {
+                    delete segmentList;
+                    return false;
+                }
+                sequenceNumber += skipped;
+
+                /* restore the state the skipped tags did set */
+                const HLSSegment *prevSeg =
+                        dynamic_cast<HLSSegment *>(rep->getSegment(SegmentInformation::INFOTYPE_MEDIA,
+                                                                   sequenceNumber - 1 + ISegment::SEQUENCE_FIRST));
+                if(prevSeg)
+                {
+                    encryption = prevSeg->encryption;
+                    if(prevSeg->utcTime > VLC_TS_INVALID)
+                        absReferenceTime = prevSeg->utcTime +
+                                           rep->getTimescale().ToTime(prevSeg->duration.Get());
+                }
+            }
+            break;
+
+            case AttributesTag::EXTXSERVERCONTROL:
+            {
+                const Attribute *skipAttr =
+                        static_cast<const AttributesTag *>(tag)->getAttributeByName("CAN-SKIP-UNTIL");
+                rep->canSkipUntil = skipAttr ? CLOCK_FREQ * skipAttr->floatingPoint() : 0;
+            }
+            break;
+
             case SingleValueTag::EXTXTARGETDURATION:
                 rep->targetDuration = static_cast<const SingleValueTag *>(tag)->getValue().decimal();
                 break;
@@ -373,6 +491,8 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
     }
 
     rep->appendSegmentList(segmentList, true);
+
+    return true;
 }
 M3U8 * M3U8Parser::parse(vlc_object_t *p_object, stream_t *p_stream, const std::string &playlisturl)
 {
@@ -62,8 +62,9 @@ namespace hls
                 Representation * createRepresentation(BaseAdaptationSet *, const AttributesTag *);
                 void createAndFillRepresentation(vlc_object_t *, BaseAdaptationSet *,
                                                  const AttributesTag *, const std::list<Tag *>&);
-                void parseSegments(vlc_object_t *, Representation *, const std::list<Tag *>&);
+                bool parseSegments(vlc_object_t *, Representation *, const std::list<Tag *>&);
                 void setFormatFromExtension(Representation *rep, const std::string &);
+                bool appendSegmentsFromURL(vlc_object_t *, Representation *, const std::string &);
                 std::list<Tag *> parseEntries(stream_t *);
         };
     }
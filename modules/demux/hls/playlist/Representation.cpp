@@ -45,6 +45,8 @@ Representation::Representation  ( BaseAdaptationSet *set ) :
     switchpolicy = SegmentInformation::SWITCH_SEGMENT_ALIGNED; /* FIXME: based on streamformat */
     nextUpdateTime = 0;
     targetDuration = 0;
+    lastUpdateTime = 0;
+    canSkipUntil = 0;
     streamFormat = StreamFormat::UNKNOWN;
 }
 
@@ -67,6 +69,15 @@ bool Representation::initialized() const
     return b_loaded;
 }
 
+bool Representation::canRequestDelta() const
+{
+    /* Playlist Delta Updates are only valid if we hold a playlist
+     * refreshed less than half the skip boundary ago */
+    if(!b_loaded || !isLive() || canSkipUntil == 0)
+        return false;
+    return (mtime_t)(time(NULL) - lastUpdateTime) * CLOCK_FREQ < canSkipUntil / 2;
+}
+
 void Representation::setPlaylistUrl(const std::string &uri)
 {
     playlistUrl = Url(uri);
@@ -47,6 +47,7 @@ namespace hls
                 Url getPlaylistUrl() const;
                 bool isLive() const;
                 bool initialized() const;
+                bool canRequestDelta() const;
                 virtual void scheduleNextUpdate(uint64_t); /* reimpl */
                 virtual bool needsUpdate() const;  /* reimpl */
                 virtual void debug(vlc_object_t *, int) const;  /* reimpl */
@@ -59,6 +60,8 @@ namespace hls
                 bool b_loaded;
                 time_t nextUpdateTime;
                 time_t targetDuration;
+                time_t lastUpdateTime;
+                mtime_t canSkipUntil;
                 Url playlistUrl;
         };
     }
@@ -441,6 +441,7 @@ demux_sys_t::~demux_sys_t()
     for ( i=0; i<stored_attachments.size(); i++ )
         delete stored_attachments[i];
     if( meta ) vlc_meta_Delete( meta );
+    if( p_seekidx ) vlc_seekindex_Delete( p_seekidx );
 
     while( titles.size() )
     { vlc_input_title_Delete( titles.back() ); titles.pop_back();}
@@ -342,6 +342,7 @@ public:
         ,f_duration(-1.0)
         ,p_input(NULL)
         ,p_ev(NULL)
+        ,p_seekidx(NULL)
     {
         vlc_mutex_init( &lock_demuxer );
     }
@@ -397,6 +398,9 @@ public:
 
     /* event */
     event_thread_t *p_ev;
+
+    /* seek points of the segments of the opened file */
+    vlc_seekindex_t *p_seekidx;
 };
 
 
@@ -575,6 +575,26 @@ bool matroska_segment_c::SameFamily( const matroska_segment_c & of_segment ) con
     return false;
 }
 
+/* The seek points found while playing a segment without cues are kept
+ * for the next sessions */
+void matroska_segment_c::SeekIndexStore( vlc_seekindex_t *p_idx, uint32_t i_segment ) const
+{
+    if( !b_cues )
+        _seeker.store( p_idx, i_segment );
+}
+
+void matroska_segment_c::SeekIndexRestore( vlc_seekindex_t *p_idx, uint32_t i_segment )
+{
+    if( b_cues )
+        return;
+
+    SegmentSeeker::track_ids_t track_ids;
+    for( tracks_map_t::const_iterator it = tracks.begin(); it != tracks.end(); ++it )
+        track_ids.push_back( it->first );
+
+    _seeker.restore( p_idx, i_segment, track_ids );
+}
+
 bool matroska_segment_c::Preload( )
 {
     if ( b_preloaded )
@@ -153,6 +153,9 @@ public:
 
     bool SameFamily( const matroska_segment_c & of_segment ) const;
 
+    void SeekIndexStore( vlc_seekindex_t *, uint32_t i_segment ) const;
+    void SeekIndexRestore( vlc_seekindex_t *, uint32_t i_segment );
+
 private:
     void LoadCues( KaxCues *cues );
     void LoadTags( KaxTags *tags );
@@ -432,6 +432,64 @@ SegmentSeeker::get_search_areas( fptr_t start, fptr_t end ) const
     return areas_to_search;
 }
 
+/* Index tracks are ( segment << 16 | track number ), cluster positions
+ * use the track number 0 that is never valid in Matroska */
+void
+SegmentSeeker::store( vlc_seekindex_t *p_idx, uint32_t segment_id ) const
+{
+    for( cluster_positions_t::const_iterator it = _cluster_positions.begin(); it != _cluster_positions.end(); ++it )
+    {
+        vlc_seekindex_entry_t entry = { VLC_TS_INVALID, *it, 0, segment_id << 16, 0 };
+        if( vlc_seekindex_Add( p_idx, &entry ) )
+            return;
+    }
+
+    for( tracks_seekpoints_t::const_iterator it = _tracks_seekpoints.begin(); it != _tracks_seekpoints.end(); ++it )
+    {
+        for( seekpoints_t::const_iterator sp = it->second.begin(); sp != it->second.end(); ++sp )
+        {
+            if( sp->trust_level == Seekpoint::DISABLED || it->first == 0 || it->first > 0xFFFF )
+                continue;
+
+            vlc_seekindex_entry_t entry = { sp->pts, sp->fpos, 0, segment_id << 16 | it->first,
+                sp->trust_level == Seekpoint::TRUSTED ? SEEKINDEX_KEYFRAME : 0u };
+            if( vlc_seekindex_Add( p_idx, &entry ) )
+                return;
+        }
+    }
+
+    /* only the complete ranges, the index is shared by the segments of the file */
+    for( ranges_t::const_iterator it = _ranges_searched.begin(); it != _ranges_searched.end(); ++it )
+        vlc_seekindex_AddRange( p_idx, it->start, it->end );
+}
+
+void
+SegmentSeeker::restore( vlc_seekindex_t *p_idx, uint32_t segment_id, track_ids_t const& track_ids )
+{
+    vlc_seekindex_entry_t const* p_entries;
+    size_t count = vlc_seekindex_GetEntries( p_idx, segment_id << 16, &p_entries );
+
+    for( size_t i = 0; i < count; ++i )
+        add_cluster_position( p_entries[i].i_offset );
+
+    for( track_ids_t::const_iterator it = track_ids.begin(); it != track_ids.end(); ++it )
+    {
+        if( *it == 0 || *it > 0xFFFF )
+            continue;
+
+        count = vlc_seekindex_GetEntries( p_idx, segment_id << 16 | *it, &p_entries );
+        for( size_t i = 0; i < count; ++i )
+            add_seekpoint( *it, Seekpoint( p_entries[i].i_offset, p_entries[i].i_time,
+                ( p_entries[i].i_flags & SEEKINDEX_KEYFRAME ) ? Seekpoint::TRUSTED
+                                                              : Seekpoint::QUESTIONABLE ) );
+    }
+
+    vlc_seekindex_range_t const* p_ranges;
+    count = vlc_seekindex_GetRanges( p_idx, &p_ranges );
+    for( size_t i = 0; i < count; ++i )
+        mark_range_as_searched( Range( p_ranges[i].i_start, p_ranges[i].i_end ) );
+}
+
 void
 SegmentSeeker::mkv_jump_to( matroska_segment_c& ms, fptr_t fpos )
 {
@@ -26,6 +26,8 @@
 
 #include "mkv.hpp"
 
+#include <vlc_seekindex.h>
+
 #include <algorithm>
 #include <vector>
 #include <map>
@@ -118,6 +120,9 @@ class SegmentSeeker
         void mark_range_as_searched( Range );
         ranges_t get_search_areas( fptr_t start, fptr_t end ) const;
 
+        void store( vlc_seekindex_t *, uint32_t segment_id ) const;
+        void restore( vlc_seekindex_t *, uint32_t segment_id, track_ids_t const& );
+
     public:
         ranges_t            _ranges_searched;
         tracks_seekpoints_t _tracks_seekpoints;
@@ -134,9 +134,13 @@ static int Open( vlc_object_t * p_this )
     p_stream->p_io_callback = p_io_callback;
     p_stream->p_estream = p_io_stream;
 
+    p_sys->p_seekidx = vlc_seekindex_New( p_demux, "mkv", p_demux->psz_file );
+
     for (size_t i=0; i<p_stream->segments.size(); i++)
     {
         p_stream->segments[i]->Preload();
+        if( p_sys->p_seekidx )
+            p_stream->segments[i]->SeekIndexRestore( p_sys->p_seekidx, i );
         b_need_preload |= p_stream->segments[i]->b_ref_external_segments;
         if ( p_stream->segments[i]->translations.size() &&
              p_stream->segments[i]->translations[0]->codec_id == MATROSKA_CHAPTER_CODEC_DVD &&
@@ -281,6 +285,18 @@ static void Close( vlc_object_t *p_this )
             p_segment->ESDestroy();
     }
 
+    if( p_sys->p_seekidx && !p_sys->streams.empty() )
+    {
+        /* segments that failed to preload are already gone */
+        const std::vector<matroska_segment_c*> & opened = p_sys->opened_segments;
+        matroska_stream_c *p_stream = p_sys->streams[0];
+        for( size_t i = 0; i < p_stream->segments.size(); i++ )
+        {
+            if( std::find( opened.begin(), opened.end(), p_stream->segments[i] ) != opened.end() )
+                p_stream->segments[i]->SeekIndexStore( p_sys->p_seekidx, i );
+        }
+    }
+
     delete p_sys;
 }
 
@@ -36,6 +36,7 @@
 #include <vlc_codec.h>
 #include <vlc_codecs.h>
 #include <vlc_input.h>
+#include <vlc_seekindex.h>
 
 #include "../../packetizer/a52.h"
 #include "../../packetizer/dts_header.h"
@@ -171,6 +172,22 @@ struct demux_sys_t
     float rgf_replay_peak[AUDIO_REPLAY_GAIN_MAX];
 
     sync_table_t mllt;
+
+    /* Seek points, while the time is exact (not estimated from the bitrate) */
+    vlc_seekindex_t *p_seekidx;
+    mtime_t i_seekidx_last;
+    bool    b_exact_time;
+    mtime_t i_resume_pts; /* date of the first block read after a seek */
+
+    /* Bytes read and not yet packetized, to find where the units start */
+    struct
+    {
+        uint8_t *p_data;
+        size_t   i_size;
+        int64_t  i_pos;      /* stream position of p_data, -1: next block */
+        int64_t  i_unit_pos; /* the next unit starts at or after this */
+        bool     b_lost;     /* the units cannot be located anymore */
+    } window;
 };
 
 static int MpgaProbe( demux_t *p_demux, int64_t *pi_offset );
@@ -191,6 +208,10 @@ static int ThdProbe( demux_t *p_demux, int64_t *pi_offset );
 static int MlpInit( demux_t *p_demux );
 
 static bool Parse( demux_t *p_demux, block_t **pp_output );
+static void SeekIndexAppend( demux_sys_t *p_sys, int64_t i_pos,
+                             const block_t *p_block );
+static void SeekIndexAdd( demux_t *p_demux, const block_t *p_block );
+static int SeekIndexSeek( demux_t *p_demux, mtime_t i_time );
 static uint64_t SeekByMlltTable( demux_t *p_demux, mtime_t *pi_time );
 
 static const codec_t p_codecs[] = {
@@ -272,6 +293,25 @@ static int OpenCommon( demux_t *p_demux,
         }
     }
 
+    /* Only where the packetizer outputs the frames as they are stored */
+    switch( p_sys->codec.i_codec )
+    {
+        case VLC_CODEC_MPGA:
+        case VLC_CODEC_A52:
+        case VLC_CODEC_EAC3:
+        case VLC_CODEC_MLP:
+        case VLC_CODEC_TRUEHD:
+            p_sys->p_seekidx = vlc_seekindex_New( p_demux, "es", p_demux->psz_file );
+            break;
+        default:
+            p_sys->p_seekidx = NULL;
+            break;
+    }
+    p_sys->i_seekidx_last = VLC_TS_INVALID;
+    p_sys->b_exact_time = true;
+    p_sys->i_resume_pts = VLC_TS_INVALID;
+    p_sys->window.i_pos = -1;
+
     for( ;; )
     {
         if( Parse( p_demux, &p_sys->p_packetized_data ) )
@@ -359,6 +399,9 @@ static int Demux( demux_t *p_demux )
             p_block_out->i_dts += p_sys->i_time_offset;
             es_out_SetPCR( p_demux->out, p_block_out->i_dts );
         }
+        if( p_sys->p_seekidx && p_sys->b_exact_time )
+            SeekIndexAdd( p_demux, p_block_out );
+
         /* Re-estimate bitrate */
         if( p_sys->b_estimate_bitrate && p_sys->i_pts > INT64_C(500000) )
             p_sys->i_bitrate_avg = 8*INT64_C(1000000)*p_sys->i_bytes/(p_sys->i_pts-1);
@@ -394,7 +437,10 @@ static void Close( vlc_object_t * p_this )
     }
     if( p_sys->i_seekpoints > 0)
         free ( p_sys->pp_byte_seekpoints );
-    
+    if( p_sys->p_seekidx )
+        vlc_seekindex_Delete( p_sys->p_seekidx );
+    free( p_sys->window.p_data );
+
     free( p_sys );
 }
 
@@ -530,6 +576,16 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                 p_sys->p_packetized_data = NULL;
                 return VLC_SUCCESS;
             }
+            if( p_sys->p_seekidx )
+            {
+                va_list ap;
+
+                va_copy( ap, args );
+                int64_t i_time = va_arg( ap, int64_t );
+                va_end( ap );
+                if( SeekIndexSeek( p_demux, i_time ) == VLC_SUCCESS )
+                    return VLC_SUCCESS;
+            }
             /* FIXME TODO: implement a high precision seek (with mp3 parsing)
              * needed for multi-input */
         }
@@ -546,6 +602,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                 /* Fix time_offset */
                 if( i_time >= 0 )
                     p_sys->i_time_offset = i_time - p_sys->i_pts;
+                p_sys->b_exact_time = false;
+                p_sys->window.b_lost = true;
                 /* And reset buffered data */
                 if( p_sys->p_packetized_data )
                     block_ChainRelease( p_sys->p_packetized_data );
@@ -555,6 +613,139 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 }
 
+/*****************************************************************************
+ * Seek index: about one entry per second, at the start of the unit. The
+ * units are found back in a copy of the bytes read, as the packetizer may
+ * skip garbage between them.
+ *****************************************************************************/
+#define SEEKINDEX_MATCH      16         /* bytes compared to find a unit */
+#define SEEKINDEX_WINDOW_MAX (1 << 20)
+
+static void SeekIndexLost( demux_sys_t *p_sys )
+{
+    p_sys->window.b_lost = true;
+    free( p_sys->window.p_data );
+    p_sys->window.p_data = NULL;
+    p_sys->window.i_size = 0;
+}
+
+/* Copies a block read from the stream at i_pos */
+static void SeekIndexAppend( demux_sys_t *p_sys, int64_t i_pos,
+                             const block_t *p_block )
+{
+    if( p_sys->window.b_lost )
+        return;
+
+    if( p_sys->window.i_pos < 0 )
+        p_sys->window.i_pos = p_sys->window.i_unit_pos = i_pos;
+    else if( p_sys->window.i_pos + (int64_t)p_sys->window.i_size != i_pos ||
+             p_sys->window.i_size + p_block->i_buffer > SEEKINDEX_WINDOW_MAX )
+    {
+        SeekIndexLost( p_sys );
+        return;
+    }
+
+    uint8_t *p_data = realloc( p_sys->window.p_data,
+                               p_sys->window.i_size + p_block->i_buffer );
+    if( unlikely(p_data == NULL) )
+    {
+        SeekIndexLost( p_sys );
+        return;
+    }
+    memcpy( &p_data[p_sys->window.i_size], p_block->p_buffer, p_block->i_buffer );
+    p_sys->window.p_data = p_data;
+    p_sys->window.i_size += p_block->i_buffer;
+}
+
+/* Stream position of a packetized unit, -1 if unknown */
+static int64_t SeekIndexLocate( demux_sys_t *p_sys, const block_t *p_block )
+{
+    const size_t i_match = __MIN( p_block->i_buffer, SEEKINDEX_MATCH );
+
+    if( p_sys->window.b_lost || p_sys->window.i_pos < 0 )
+        return -1;
+
+    for( size_t i = p_sys->window.i_unit_pos - p_sys->window.i_pos;
+         i_match > 0 && i + i_match <= p_sys->window.i_size; i++ )
+    {
+        if( memcmp( &p_sys->window.p_data[i], p_block->p_buffer, i_match ) )
+            continue;
+
+        const int64_t i_pos = p_sys->window.i_pos + i;
+        p_sys->window.i_unit_pos = i_pos + p_block->i_buffer;
+
+        /* forget the bytes up to the next unit */
+        size_t i_drop = __MIN( i + p_block->i_buffer, p_sys->window.i_size );
+        memmove( p_sys->window.p_data, &p_sys->window.p_data[i_drop],
+                 p_sys->window.i_size - i_drop );
+        p_sys->window.i_size -= i_drop;
+        p_sys->window.i_pos += i_drop;
+        return i_pos;
+    }
+
+    SeekIndexLost( p_sys );
+    return -1;
+}
+
+static void SeekIndexAdd( demux_t *p_demux, const block_t *p_block )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const mtime_t i_time = p_sys->i_pts + p_sys->i_time_offset;
+    const int64_t i_pos = SeekIndexLocate( p_sys, p_block );
+
+    if( i_pos < 0 )
+        return;
+    if( p_sys->i_seekidx_last != VLC_TS_INVALID &&
+        i_time >= p_sys->i_seekidx_last &&
+        i_time < p_sys->i_seekidx_last + CLOCK_FREQ )
+        return;
+
+    vlc_seekindex_entry_t entry = {
+        .i_time = i_time,
+        .i_offset = i_pos,
+        .i_size = p_block->i_buffer,
+        .i_flags = SEEKINDEX_KEYFRAME,
+    };
+    if( vlc_seekindex_Add( p_sys->p_seekidx, &entry ) == VLC_SUCCESS )
+        p_sys->i_seekidx_last = i_time;
+}
+
+static int SeekIndexSeek( demux_t *p_demux, mtime_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const vlc_seekindex_entry_t *p_entry =
+        vlc_seekindex_Lookup( p_sys->p_seekidx, 0, i_time, SEEKINDEX_KEYFRAME );
+
+    /* the index may only cover what was played */
+    if( p_entry == NULL || i_time - p_entry->i_time > 2 * CLOCK_FREQ )
+        return VLC_EGENERIC;
+
+    const mtime_t i_entry_time = p_entry->i_time;
+    if( vlc_stream_Seek( p_demux->s, p_entry->i_offset ) )
+        return VLC_EGENERIC;
+
+    /* The packetizer restarts on the indexed unit, dated from the current
+     * time so that the bitrate estimation is not disturbed */
+    if( p_sys->p_packetizer->pf_flush )
+        p_sys->p_packetizer->pf_flush( p_sys->p_packetizer );
+    p_sys->i_resume_pts = VLC_TS_0 + p_sys->i_pts;
+    p_sys->i_time_offset = i_entry_time - p_sys->i_pts;
+    p_sys->i_seekidx_last = VLC_TS_INVALID;
+    p_sys->b_exact_time = true;
+
+    free( p_sys->window.p_data );
+    p_sys->window.p_data = NULL;
+    p_sys->window.i_size = 0;
+    p_sys->window.i_pos = -1;
+    p_sys->window.b_lost = false;
+
+    /* And reset buffered data */
+    if( p_sys->p_packetized_data )
+        block_ChainRelease( p_sys->p_packetized_data );
+    p_sys->p_packetized_data = NULL;
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * Makes a link list of buffer of parsed data
  * Returns true if EOF
@@ -574,6 +765,7 @@ static bool Parse( demux_t *p_demux, block_t **pp_output )
             return true;
     }
 
+    const int64_t i_block_pos = vlc_stream_Tell( p_demux->s );
     p_block_in = vlc_stream_Block( p_demux->s, p_sys->i_packet_size );
     bool b_eof = p_block_in == NULL;
 
@@ -586,6 +778,14 @@ static bool Parse( demux_t *p_demux, block_t **pp_output )
         }
 
         p_block_in->i_pts = p_block_in->i_dts = p_sys->b_start || p_sys->b_initial_sync_failed ? VLC_TS_0 : VLC_TS_INVALID;
+        if( p_sys->i_resume_pts > VLC_TS_INVALID )
+        {
+            p_block_in->i_pts = p_block_in->i_dts = p_sys->i_resume_pts;
+            p_sys->i_resume_pts = VLC_TS_INVALID;
+        }
+
+        if( p_sys->p_seekidx && p_sys->b_exact_time )
+            SeekIndexAppend( p_sys, i_block_pos, p_block_in );
     }
     p_sys->b_initial_sync_failed = p_sys->b_start; /* Only try to resync once */
 
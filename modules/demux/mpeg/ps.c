@@ -100,6 +100,15 @@ struct demux_sys_t
 
     int         i_aob_mlp_count;
 
+    /* Consecutive PES of a track, sent as a single chain */
+    struct
+    {
+        ps_track_t *tk;
+        block_t    *p_chain;
+        block_t   **pp_last;
+        unsigned    i_count;
+    } batch;
+
     bool  b_lost_sync;
     bool  b_have_pack;
     bool  b_bad_scr;
@@ -118,6 +127,48 @@ static int Control( demux_t *p_demux, int i_query, va_list args );
 static int      ps_pkt_resynch( stream_t *, int, bool );
 static block_t *ps_pkt_read   ( stream_t * );
 
+#define PS_BATCH_MAX 16
+
+static void BatchReset( demux_sys_t *p_sys )
+{
+    p_sys->batch.tk = NULL;
+    p_sys->batch.p_chain = NULL;
+    p_sys->batch.pp_last = &p_sys->batch.p_chain;
+    p_sys->batch.i_count = 0;
+}
+
+/* Sends the pending PES. Must be done before anything that could reorder
+ * them with other es_out calls (PCR, ES creation or deletion). */
+static void BatchFlush( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->batch.p_chain )
+        es_out_SendChain( p_demux->out, p_sys->batch.tk->es, p_sys->batch.p_chain );
+    BatchReset( p_sys );
+}
+
+/* Discards the pending PES, they belong to before a seek or title change */
+static void BatchDrop( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    block_ChainRelease( p_sys->batch.p_chain );
+    BatchReset( p_sys );
+}
+
+static void BatchSend( demux_t *p_demux, ps_track_t *tk, block_t *p_pkt )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->batch.tk != tk )
+        BatchFlush( p_demux );
+    p_sys->batch.tk = tk;
+    block_ChainLastAppend( &p_sys->batch.pp_last, p_pkt );
+    if( ++p_sys->batch.i_count >= PS_BATCH_MAX )
+        BatchFlush( p_demux );
+}
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -217,6 +268,7 @@ static int OpenCommon( vlc_object_t *p_this, bool b_force )
     p_sys->i_aob_mlp_count = 0;
     p_sys->i_start_byte = i_skip;
     p_sys->i_lastpack_byte = i_skip;
+    BatchReset( p_sys );
 
     p_sys->b_lost_sync = false;
     p_sys->b_have_pack = false;
@@ -253,6 +305,8 @@ static void Close( vlc_object_t *p_this )
     demux_sys_t *p_sys = p_demux->p_sys;
     int i;
 
+    block_ChainRelease( p_sys->batch.p_chain );
+
     for( i = 0; i < PS_TK_COUNT; i++ )
     {
         ps_track_t *tk = &p_sys->tk[i];
@@ -404,6 +458,7 @@ static int Demux( demux_t *p_demux )
     i_ret = ps_pkt_resynch( p_demux->s, p_sys->format, p_sys->b_have_pack );
     if( i_ret < 0 )
     {
+        BatchFlush( p_demux );
         return VLC_DEMUXER_EOF;
     }
     else if( i_ret == 0 )
@@ -425,17 +480,22 @@ static int Demux( demux_t *p_demux )
     if( p_sys->i_length < 0 && p_sys->b_seekable )
     {
         if( !FindLength( p_demux ) )
+        {
+            BatchFlush( p_demux );
             return VLC_DEMUXER_EGENERIC;
+        }
     }
 
     if( ( p_pkt = ps_pkt_read( p_demux->s ) ) == NULL )
     {
+        BatchFlush( p_demux );
         return VLC_DEMUXER_EOF;
     }
 
     if( p_pkt->i_buffer < 4 )
     {
         block_Release( p_pkt );
+        BatchFlush( p_demux );
         return VLC_DEMUXER_EGENERIC;
     }
 
@@ -472,7 +532,10 @@ static int Demux( demux_t *p_demux )
                 if( !tk->b_configured && tk->fmt.i_cat != UNKNOWN_ES )
                 {
                     if( tk->b_seen )
+                    {
+                        BatchFlush( p_demux );
                         tk->es = es_out_Add( p_demux->out, &tk->fmt );
+                    }
                      /* else create when seeing packet */
                     tk->b_configured = true;
                 }
@@ -485,6 +548,7 @@ static int Demux( demux_t *p_demux )
         if( p_sys->psm.i_version == 0xFFFF )
             msg_Dbg( p_demux, "contains a PSM");
 
+        BatchFlush( p_demux );
         ps_psm_fill( &p_sys->psm, p_pkt, p_sys->tk, p_demux->out );
         block_Release( p_pkt );
         break;
@@ -537,6 +601,7 @@ static int Demux( demux_t *p_demux )
 #endif
                     }
 
+                    BatchFlush( p_demux );
                     tk->es = es_out_Add( p_demux->out, &tk->fmt );
                     b_new = true;
                     tk->b_configured = true;
@@ -549,7 +614,10 @@ static int Demux( demux_t *p_demux )
 
             /* Late creation from system header */
             if( !tk->b_seen && tk->b_configured && !tk->es && tk->fmt.i_cat != UNKNOWN_ES )
+            {
+                BatchFlush( p_demux );
                 tk->es = es_out_Add( p_demux->out, &tk->fmt );
+            }
 
             tk->b_seen = true;
 
@@ -574,7 +642,10 @@ static int Demux( demux_t *p_demux )
                     p_sys->i_first_scr = -1;
                 }
                 else
+                {
+                    BatchFlush( p_demux );
                     es_out_SetPCR( p_demux->out, VLC_TS_0 + p_sys->i_pack_scr );
+                }
             }
 
             if( tk->b_configured && tk->es &&
@@ -606,6 +677,7 @@ static int Demux( demux_t *p_demux )
                     p_sys->i_scr = p_pkt->i_pts;
                     if( p_sys->i_first_scr == -1 )
                         p_sys->i_first_scr = p_sys->i_scr;
+                    BatchFlush( p_demux );
                     es_out_SetPCR( p_demux->out, p_pkt->i_pts );
                 }
 
@@ -634,7 +706,7 @@ static int Demux( demux_t *p_demux )
                     p_pkt->i_buffer -= 14;
                 }
 #endif
-                es_out_Send( p_demux->out, tk->es, p_pkt );
+                BatchSend( p_demux, tk, p_pkt );
             }
             else
             {
@@ -699,6 +771,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             i_ret = vlc_stream_Seek( p_demux->s, i64 );
             if( i_ret == VLC_SUCCESS )
             {
+                BatchDrop( p_demux );
                 NotifyDiscontinuity( p_sys->tk, p_demux->out );
                 return i_ret;
             }
@@ -762,11 +835,17 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         }
 
         case DEMUX_SET_TITLE:
-            return vlc_stream_vaControl( p_demux->s, STREAM_SET_TITLE, args );
+            i_ret = vlc_stream_vaControl( p_demux->s, STREAM_SET_TITLE, args );
+            if( i_ret == VLC_SUCCESS )
+                BatchDrop( p_demux );
+            return i_ret;
 
         case DEMUX_SET_SEEKPOINT:
-            return vlc_stream_vaControl( p_demux->s, STREAM_SET_SEEKPOINT,
-                                         args );
+            i_ret = vlc_stream_vaControl( p_demux->s, STREAM_SET_SEEKPOINT,
+                                          args );
+            if( i_ret == VLC_SUCCESS )
+                BatchDrop( p_demux );
+            return i_ret;
 
         case DEMUX_GET_META:
             return vlc_stream_vaControl( p_demux->s, STREAM_GET_META, args );
@@ -35,6 +35,7 @@
 #include <vlc_access.h>    /* DVB-specific things */
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_seekindex.h>
 
 #include "ts_pid.h"
 #include "ts_streams.h"
@@ -388,6 +389,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_ts_read = 50;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
+    p_sys->p_seekidx = NULL;
 
     vlc_dictionary_init( &p_sys->attachments, 0 );
 
@@ -509,6 +511,8 @@ static int Open( vlc_object_t *p_this )
     vlc_stream_Control( p_sys->stream, STREAM_CAN_SEEK, &p_sys->b_canseek );
     vlc_stream_Control( p_sys->stream, STREAM_CAN_FASTSEEK,
                         &p_sys->b_canfastseek );
+    if( p_sys->b_canfastseek )
+        p_sys->p_seekidx = vlc_seekindex_New( p_demux, "ts", p_demux->psz_file );
 
     /* Preparse time */
     if( p_sys->b_canseek )
@@ -552,6 +556,9 @@ static void Close( vlc_object_t *p_this )
 
     ARRAY_RESET( p_sys->programs );
 
+    if( p_sys->p_seekidx )
+        vlc_seekindex_Delete( p_sys->p_seekidx );
+
 #ifdef HAVE_ARIBB24
     if ( p_sys->arib.p_instance )
         arib_instance_destroy( p_sys->arib.p_instance );
@@ -1356,65 +1363,74 @@ static block_t * ConvertPESBlock( demux_t *p_demux, ts_es_t *p_es,
     return p_block;
 }
 
+static block_t * ChainDuplicate( block_t *p_chain )
+{
+    block_t *p_dups = NULL, **pp_last = &p_dups;
+    for( ; p_chain; p_chain = p_chain->p_next )
+    {
+        block_t *p_dup = block_Duplicate( p_chain );
+        if( p_dup )
+            block_ChainLastAppend( &pp_last, p_dup );
+    }
+    return p_dups;
+}
+
 /****************************************************************************
- * fanouts current block to all subdecoders / shared pid es
+ * fanouts current chain to all subdecoders / shared pid es
+ * The whole chain is sent at once to each es (single decoder fifo lock)
  ****************************************************************************/
 static void SendDataChain( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain )
 {
-    while( p_chain )
-    {
-        block_t *p_block = p_chain;
-        p_chain = p_block->p_next;
-        p_block->p_next = NULL;
+    if( !p_chain )
+        return;
 
-        ts_es_t *p_es_send = p_es;
-        if( p_es_send->i_next_block_flags )
-        {
-            p_block->i_flags |= p_es_send->i_next_block_flags;
-            p_es_send->i_next_block_flags = 0;
-        }
+    ts_es_t *p_es_send = p_es;
+    if( p_es_send->i_next_block_flags )
+    {
+        p_chain->i_flags |= p_es_send->i_next_block_flags;
+        p_es_send->i_next_block_flags = 0;
+    }
 
-        while( p_es_send )
+    while( p_es_send )
+    {
+        if( p_es_send->p_program->b_selected )
         {
-            if( p_es_send->p_program->b_selected )
+            /* Send a copy to each extra es */
+            ts_es_t *p_extra_es = p_es_send->p_extraes;
+            while( p_extra_es )
             {
-                /* Send a copy to each extra es */
-                ts_es_t *p_extra_es = p_es_send->p_extraes;
-                while( p_extra_es )
+                if( p_extra_es->id )
                 {
-                    if( p_extra_es->id )
-                    {
-                        block_t *p_dup = block_Duplicate( p_block );
-                        if( p_dup )
-                            es_out_Send( p_demux->out, p_extra_es->id, p_dup );
-                    }
-                    p_extra_es = p_extra_es->p_next;
+                    block_t *p_dups = ChainDuplicate( p_chain );
+                    if( p_dups )
+                        es_out_SendChain( p_demux->out, p_extra_es->id, p_dups );
                 }
+                p_extra_es = p_extra_es->p_next;
+            }
 
-                if( p_es_send->p_next )
+            if( p_es_send->p_next )
+            {
+                if( p_es_send->id )
                 {
-                    if( p_es_send->id )
-                    {
-                        block_t *p_dup = block_Duplicate( p_block );
-                        if( p_dup )
-                            es_out_Send( p_demux->out, p_es_send->id, p_dup );
-                    }
+                    block_t *p_dups = ChainDuplicate( p_chain );
+                    if( p_dups )
+                        es_out_SendChain( p_demux->out, p_es_send->id, p_dups );
                 }
-                else
+            }
+            else
+            {
+                if( p_es_send->id )
                 {
-                    if( p_es_send->id )
-                    {
-                        es_out_Send( p_demux->out, p_es_send->id, p_block );
-                        p_block = NULL;
-                    }
+                    es_out_SendChain( p_demux->out, p_es_send->id, p_chain );
+                    p_chain = NULL;
                 }
             }
-            p_es_send = p_es_send->p_next;
         }
-
-        if( p_block )
-            block_Release( p_block );
+        p_es_send = p_es_send->p_next;
     }
+
+    if( p_chain )
+        block_ChainRelease( p_chain );
 }
 
 /****************************************************************************
@@ -1547,6 +1563,11 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
 
         p_pes->i_length = FROM_SCALE_NZ(i_length);
 
+        /* Output is gathered and sent as a single chain, unless the
+         * program clock or the es setup changes in between */
+        block_t *p_out = NULL;
+        block_t **pp_out = &p_out;
+
         /* Can become a chain on next call due to prepcr */
         block_t *p_chain = block_ChainGather( p_pes );
         while ( p_chain ) {
@@ -1555,7 +1576,12 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
             p_block->p_next = NULL;
 
             if( !p_pmt->pcr.b_fix_done ) /* Not seen yet */
+            {
+                SendDataChain( p_demux, p_es, p_out );
+                p_out = NULL;
+                pp_out = &p_out;
                 PCRFixHandle( p_demux, p_pmt, p_block );
+            }
 
             if( p_es->id && (p_pmt->pcr.i_current > -1 || p_pmt->pcr.b_disable) )
             {
@@ -1575,6 +1601,9 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
                 if ( p_pmt->pcr.b_disable && p_block->i_dts > VLC_TS_INVALID &&
                      ( p_pmt->i_pid_pcr == pid->i_pid || p_pmt->i_pid_pcr == 0x1FFF ) )
                 {
+                    SendDataChain( p_demux, p_es, p_out );
+                    p_out = NULL;
+                    pp_out = &p_out;
                     ProgramSetPCR( p_demux, p_pmt, TO_SCALE(p_block->i_dts) - 120000 );
                 }
 
@@ -1618,7 +1647,7 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
                     p_block = ConvertPESBlock( p_demux, p_es, i_pes_size, i_stream_id, p_block );
                 }
 
-                SendDataChain( p_demux, p_es, p_block );
+                block_ChainLastAppend( &pp_out, p_block );
             }
             else
             {
@@ -1636,6 +1665,8 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
                 }
             }
         }
+
+        SendDataChain( p_demux, p_es, p_out );
     }
     else
     {
@@ -1860,6 +1891,67 @@ static void ReadyQueuesPostSeek( demux_t *p_demux )
     }
 }
 
+/* PCR positions seen while playing, about one per second */
+static void SeekIndexAdd( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_pmt->pcr.i_indexed != -1 && i_pcr >= p_pmt->pcr.i_indexed &&
+        i_pcr - p_pmt->pcr.i_indexed < TO_SCALE_NZ(CLOCK_FREQ) )
+        return;
+
+    /* the PCR packet was just read */
+    const uint64_t i_pos = vlc_stream_Tell( p_sys->stream );
+    if( i_pos < p_sys->i_packet_size )
+        return;
+
+    vlc_seekindex_entry_t entry = {
+        .i_time = i_pcr,
+        .i_offset = i_pos - p_sys->i_packet_size,
+        .i_track = p_pmt->i_number,
+    };
+    if( vlc_seekindex_Add( p_sys->p_seekidx, &entry ) == VLC_SUCCESS )
+        p_pmt->pcr.i_indexed = i_pcr;
+}
+
+/* Narrows the search with the indexed PCR positions.
+ * Returns true if the head position is close enough to be used as is */
+static bool SeekIndexBounds( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaledtime,
+                             uint64_t *pi_head_pos, uint64_t *pi_tail_pos )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const vlc_seekindex_entry_t *p_entries;
+    size_t i_count = vlc_seekindex_GetEntries( p_sys->p_seekidx, p_pmt->i_number,
+                                               &p_entries );
+
+    uint64_t i_head_pos = *pi_head_pos, i_tail_pos = *pi_tail_pos;
+    int64_t i_head_time = -1;
+    for( size_t i = 0; i < i_count; i++ )
+    {
+        const vlc_seekindex_entry_t *p_entry = &p_entries[i];
+        if( p_entry->i_offset >= *pi_tail_pos )
+            break;
+        if( p_entry->i_time <= i_scaledtime )
+        {
+            if( p_entry->i_offset >= i_head_pos )
+            {
+                i_head_pos = p_entry->i_offset;
+                i_head_time = p_entry->i_time;
+            }
+        }
+        else if( p_entry->i_offset < i_tail_pos )
+            i_tail_pos = p_entry->i_offset;
+    }
+
+    /* PCR discontinuities, don't trust it */
+    if( i_head_pos >= i_tail_pos )
+        return false;
+
+    *pi_head_pos = i_head_pos;
+    *pi_tail_pos = i_tail_pos;
+    return i_head_time != -1 && i_scaledtime - i_head_time < TO_SCALE_NZ(CLOCK_FREQ / 2);
+}
+
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaledtime )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -1880,6 +1972,10 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
     if( i_head_pos >= i_tail_pos )
         return VLC_EGENERIC;
 
+    if( p_sys->p_seekidx &&
+        SeekIndexBounds( p_demux, p_pmt, i_scaledtime, &i_head_pos, &i_tail_pos ) )
+        return vlc_stream_Seek( p_sys->stream, i_head_pos );
+
     bool b_found = false;
     while( (i_head_pos + p_sys->i_packet_size) <= i_tail_pos && !b_found )
     {
@@ -2167,6 +2263,9 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
         p_pmt->pcr.i_first = i_pcr; // now seen
     }
 
+    if( p_sys->p_seekidx )
+        SeekIndexAdd( p_demux, p_pmt, i_pcr );
+
     if ( p_sys->i_pmt_es )
     {
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
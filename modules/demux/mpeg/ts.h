@@ -125,6 +125,9 @@ struct demux_sys_t
 
     /* */
     bool        b_start_record;
+
+    /* PCR positions, by program number */
+    struct vlc_seekindex_t *p_seekidx;
 };
 
 void TsChangeStandard( demux_sys_t *, ts_standards_e );
@@ -63,6 +63,7 @@ struct ts_pmt_t
         mtime_t i_pcroffset;
         bool    b_disable; /* ignore PCR field, use dts */
         bool    b_fix_done;
+        mtime_t i_indexed; /* last seek index entry */
     } pcr;
 
     struct
@@ -35,6 +35,7 @@
 #include <vlc_demux.h>
 #include <vlc_meta.h>
 #include <vlc_input.h>
+#include <vlc_seekindex.h>
 
 #include <ogg/ogg.h>
 
@@ -245,6 +246,7 @@ static int Open( vlc_object_t * p_this )
     /* */
     TAB_INIT( p_sys->i_seekpoints, p_sys->pp_seekpoints );
 
+    p_sys->p_seekidx = vlc_seekindex_New( p_demux, "ogg", p_demux->psz_file );
 
     while ( !p_sys->b_preparsing_done && p_demux->pf_demux( p_demux ) > 0 )
     {}
@@ -270,6 +272,9 @@ static void Close( vlc_object_t *p_this )
     if( p_sys->p_old_stream )
         Ogg_LogicalStreamDelete( p_demux, p_sys->p_old_stream );
 
+    if( p_sys->p_seekidx )
+        vlc_seekindex_Delete( p_sys->p_seekidx );
+
     free( p_sys );
 }
 
@@ -2193,6 +2198,8 @@ static int Ogg_BeginningOfStream( demux_t *p_demux )
 
         /* initialise kframe index */
         p_stream->idx=NULL;
+        if( p_ogg->p_seekidx )
+            OggSeek_IndexRestore( p_ogg->p_seekidx, p_stream );
 
         if ( p_stream->fmt.i_bitrate == 0  &&
              ( p_stream->fmt.i_cat == VIDEO_ES ||
@@ -2286,6 +2293,8 @@ static void Ogg_LogicalStreamDelete( demux_t *p_demux, logical_stream_t *p_strea
 
     if ( p_stream->idx != NULL)
     {
+        if( p_demux->p_sys->p_seekidx )
+            OggSeek_IndexStore( p_demux->p_sys->p_seekidx, p_stream );
         oggseek_index_entries_free( p_stream->idx );
     }
 
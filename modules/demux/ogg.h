@@ -232,6 +232,8 @@ struct demux_sys_t
     /* Length, if available. */
     int64_t i_length;
 
+    /* keyframes found by previous sessions, by stream serial number */
+    vlc_seekindex_t *p_seekidx;
 };
 
 
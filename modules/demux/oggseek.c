@@ -32,6 +32,7 @@
 
 #include <vlc_common.h>
 #include <vlc_demux.h>
+#include <vlc_seekindex.h>
 
 #include <ogg/ogg.h>
 #include <limits.h>
@@ -151,6 +152,33 @@ const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *p_stream,
     return idx;
 }
 
+/* Keyframes are kept across sessions, by stream serial number */
+void OggSeek_IndexStore ( vlc_seekindex_t *p_seekidx, const logical_stream_t *p_stream )
+{
+    for ( const demux_index_entry_t *idx = p_stream->idx; idx != NULL; idx = idx->p_next )
+    {
+        vlc_seekindex_entry_t entry = {
+            .i_time = idx->i_value,
+            .i_offset = idx->i_pagepos,
+            .i_track = p_stream->i_serial_no,
+            .i_flags = SEEKINDEX_KEYFRAME,
+        };
+        if ( vlc_seekindex_Add( p_seekidx, &entry ) )
+            break;
+    }
+}
+
+void OggSeek_IndexRestore ( vlc_seekindex_t *p_seekidx, logical_stream_t *p_stream )
+{
+    const vlc_seekindex_entry_t *p_entries;
+    size_t i_count = vlc_seekindex_GetEntries( p_seekidx, p_stream->i_serial_no,
+                                               &p_entries );
+
+    /* entries are sorted by offset, as the index */
+    for ( size_t i = 0; i < i_count; i++ )
+        OggSeek_IndexAdd( p_stream, p_entries[i].i_time, p_entries[i].i_offset );
+}
+
 static bool OggSeekIndexFind ( logical_stream_t *p_stream, int64_t i_timestamp,
                                int64_t *pi_pos_lower, int64_t *pi_pos_upper )
 {
@@ -408,6 +408,327 @@ static int vlclua_playlist_status( lua_State *L )
     return 1;
 }
 
+typedef struct
+{
+    int i_skip;   /**< leaves to skip before the page */
+    int i_left;   /**< leaves still to push */
+    int i_pushed;
+    int i_total;
+} playlist_page_t;
+
+static void push_playlist_page( lua_State *L, playlist_item_t *p_node,
+                                playlist_page_t *p_page )
+{
+    for( int i = 0; i < p_node->i_children; i++ )
+    {
+        playlist_item_t *p_item = p_node->pp_children[i];
+
+        if( p_item->i_flags & PLAYLIST_DBL_FLAG )
+            continue;
+        if( p_item->i_children >= 0 )
+        {
+            push_playlist_page( L, p_item, p_page );
+            continue;
+        }
+
+        p_page->i_total++;
+        if( p_page->i_skip > 0 )
+            p_page->i_skip--;
+        else if( p_page->i_left > 0 )
+        {
+            p_page->i_left--;
+            push_playlist_item( L, p_item );
+            lua_rawseti( L, -2, ++p_page->i_pushed );
+        }
+    }
+}
+
+/* Leaves of the playlist, depth first, from offset (0-based). The total
+ * is counted so that the caller can page through without getting the tree */
+static int vlclua_playlist_page( lua_State *L )
+{
+    playlist_t *p_playlist = vlclua_get_playlist_internal( L );
+    int i_offset = luaL_optinteger( L, 1, 0 );
+    int i_count = luaL_optinteger( L, 2, 100 );
+    playlist_page_t page = {
+        .i_skip = __MAX( i_offset, 0 ),
+        .i_left = __MAX( i_count, 0 ),
+    };
+
+    lua_newtable( L );
+    lua_newtable( L );
+    PL_LOCK;
+    push_playlist_page( L, p_playlist->p_playing, &page );
+    PL_UNLOCK;
+    lua_setfield( L, -2, "items" );
+    lua_pushinteger( L, page.i_total );
+    lua_setfield( L, -2, "total" );
+    return 1;
+}
+
+/*****************************************************************************
+ * Change journal
+ *****************************************************************************/
+/* The journal records the playlist changes from the core callbacks with
+ * increasing sequence numbers, so that a client can ask only for what changed
+ * since the last sequence number it saw. */
+#define JOURNAL_SIZE 512
+
+enum
+{
+    JOURNAL_ADDED,
+    JOURNAL_REMOVED,
+    JOURNAL_CHANGED,
+};
+
+typedef struct
+{
+    uint64_t      i_seq;
+    int           i_type;
+    int           i_id;         /* ADDED, REMOVED */
+    input_item_t *p_input;      /* CHANGED */
+} journal_entry_t;
+
+typedef struct
+{
+    playlist_t     *p_playlist;
+    vlc_mutex_t     lock;
+    uint64_t        i_seq;      /**< last given sequence number */
+    uint64_t        i_lost;     /**< last overwritten sequence number */
+    unsigned        i_first;
+    unsigned        i_count;
+    journal_entry_t entries[JOURNAL_SIZE];
+} vlclua_journal_t;
+
+static const char *const ppsz_journal_vars[] = {
+    "playlist-item-append", "playlist-item-deleted", "item-change",
+};
+
+static void JournalAppend( vlclua_journal_t *p_journal, int i_type, int i_id,
+                           input_item_t *p_input )
+{
+    vlc_mutex_lock( &p_journal->lock );
+    if( p_journal->i_count > 0 )
+    {
+        journal_entry_t *p_last = &p_journal->entries[(p_journal->i_first +
+                                  p_journal->i_count - 1) % JOURNAL_SIZE];
+
+        /* Coalesce repeated changes of the same item (meta, info) */
+        if( i_type == JOURNAL_CHANGED && p_last->i_type == JOURNAL_CHANGED
+         && p_last->p_input == p_input )
+        {
+            p_last->i_seq = ++p_journal->i_seq;
+            vlc_mutex_unlock( &p_journal->lock );
+            return;
+        }
+    }
+
+    if( p_journal->i_count == JOURNAL_SIZE )
+    {
+        journal_entry_t *p_old = &p_journal->entries[p_journal->i_first];
+
+        p_journal->i_lost = p_old->i_seq;
+        if( p_old->p_input != NULL )
+            input_item_Release( p_old->p_input );
+        p_journal->i_first = (p_journal->i_first + 1) % JOURNAL_SIZE;
+        p_journal->i_count--;
+    }
+
+    journal_entry_t *p_entry = &p_journal->entries[(p_journal->i_first +
+                               p_journal->i_count++) % JOURNAL_SIZE];
+    p_entry->i_seq = ++p_journal->i_seq;
+    p_entry->i_type = i_type;
+    p_entry->i_id = i_id;
+    p_entry->p_input = p_input != NULL ? input_item_Hold( p_input ) : NULL;
+    vlc_mutex_unlock( &p_journal->lock );
+}
+
+static int JournalCallback( vlc_object_t *p_this, const char *psz_var,
+                            vlc_value_t oldval, vlc_value_t newval,
+                            void *p_data )
+{
+    vlclua_journal_t *p_journal = p_data;
+    VLC_UNUSED(p_this); VLC_UNUSED(oldval);
+
+    /* The playlist items are locked by the playlist, which is held here */
+    if( !strcmp( psz_var, "playlist-item-append" ) )
+    {
+        playlist_item_t *p_item = newval.p_address;
+        JournalAppend( p_journal, JOURNAL_ADDED, p_item->i_id, NULL );
+    }
+    else if( !strcmp( psz_var, "playlist-item-deleted" ) )
+    {
+        playlist_item_t *p_item = newval.p_address;
+        JournalAppend( p_journal, JOURNAL_REMOVED, p_item->i_id, NULL );
+    }
+    else if( newval.p_address != NULL )
+        JournalAppend( p_journal, JOURNAL_CHANGED, -1, newval.p_address );
+    return VLC_SUCCESS;
+}
+
+static int vlclua_journal_delete( lua_State *L )
+{
+    vlclua_journal_t **pp_journal = luaL_checkudata( L, 1, "playlist_journal" );
+    vlclua_journal_t *p_journal = *pp_journal;
+
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_journal_vars); i++ )
+        var_DelCallback( p_journal->p_playlist, ppsz_journal_vars[i],
+                         JournalCallback, p_journal );
+
+    for( unsigned i = 0; i < p_journal->i_count; i++ )
+    {
+        journal_entry_t *p_entry =
+            &p_journal->entries[(p_journal->i_first + i) % JOURNAL_SIZE];
+        if( p_entry->p_input != NULL )
+            input_item_Release( p_entry->p_input );
+    }
+    vlc_mutex_destroy( &p_journal->lock );
+    free( p_journal );
+    return 0;
+}
+
+/* Marks a change that the caller detected by itself (e.g. in the status) */
+static int vlclua_journal_mark( lua_State *L )
+{
+    vlclua_journal_t **pp_journal = luaL_checkudata( L, 1, "playlist_journal" );
+    vlclua_journal_t *p_journal = *pp_journal;
+
+    vlc_mutex_lock( &p_journal->lock );
+    uint64_t i_seq = ++p_journal->i_seq;
+    vlc_mutex_unlock( &p_journal->lock );
+    lua_pushnumber( L, i_seq );
+    return 1;
+}
+
+static int vlclua_journal_seq( lua_State *L )
+{
+    vlclua_journal_t **pp_journal = luaL_checkudata( L, 1, "playlist_journal" );
+    vlclua_journal_t *p_journal = *pp_journal;
+
+    vlc_mutex_lock( &p_journal->lock );
+    uint64_t i_seq = p_journal->i_seq;
+    vlc_mutex_unlock( &p_journal->lock );
+    lua_pushnumber( L, i_seq );
+    return 1;
+}
+
+/* Returns the current sequence number and the changes after the given one,
+ * or only the sequence number if they are not all recorded anymore. */
+static int vlclua_journal_since( lua_State *L )
+{
+    vlclua_journal_t **pp_journal = luaL_checkudata( L, 1, "playlist_journal" );
+    vlclua_journal_t *p_journal = *pp_journal;
+    playlist_t *p_playlist = p_journal->p_playlist;
+    uint64_t i_since = luaL_checknumber( L, 2 );
+    int i_changes = 0;
+
+    /* Lock order: playlist, then journal (the callbacks run under the
+     * playlist lock) */
+    PL_LOCK;
+    vlc_mutex_lock( &p_journal->lock );
+    lua_pushnumber( L, p_journal->i_seq );
+    if( i_since < p_journal->i_lost || i_since > p_journal->i_seq )
+    {
+        vlc_mutex_unlock( &p_journal->lock );
+        PL_UNLOCK;
+        return 1;
+    }
+
+    lua_newtable( L );
+    for( unsigned i = 0; i < p_journal->i_count; i++ )
+    {
+        const journal_entry_t *p_entry =
+            &p_journal->entries[(p_journal->i_first + i) % JOURNAL_SIZE];
+        if( p_entry->i_seq <= i_since )
+            continue;
+
+        playlist_item_t *p_item = NULL;
+        lua_newtable( L );
+        lua_pushnumber( L, p_entry->i_seq );
+        lua_setfield( L, -2, "seq" );
+        switch( p_entry->i_type )
+        {
+            case JOURNAL_ADDED:
+                lua_pushliteral( L, "added" );
+                p_item = playlist_ItemGetById( p_playlist, p_entry->i_id );
+                break;
+            case JOURNAL_REMOVED:
+                lua_pushliteral( L, "removed" );
+                lua_pushinteger( L, p_entry->i_id );
+                lua_setfield( L, -3, "id" );
+                break;
+            default:
+                lua_pushliteral( L, "changed" );
+                p_item = playlist_ItemGetByInput( p_playlist,
+                                                  p_entry->p_input );
+                break;
+        }
+        lua_setfield( L, -2, "type" );
+
+        if( p_entry->i_type != JOURNAL_REMOVED )
+        {
+            if( p_item == NULL )
+            {   /* Gone meanwhile, or not in the playlist */
+                lua_pop( L, 1 );
+                continue;
+            }
+            lua_pushinteger( L, p_item->i_id );
+            lua_setfield( L, -2, "id" );
+            if( p_item->p_parent != NULL )
+            {
+                lua_pushinteger( L, p_item->p_parent->i_id );
+                lua_setfield( L, -2, "parent" );
+            }
+            push_playlist_item( L, p_item );
+            lua_setfield( L, -2, "item" );
+        }
+        lua_rawseti( L, -2, ++i_changes );
+    }
+    vlc_mutex_unlock( &p_journal->lock );
+    PL_UNLOCK;
+    return 2;
+}
+
+static const luaL_Reg vlclua_journal_reg[] = {
+    { "seq", vlclua_journal_seq },
+    { "since", vlclua_journal_since },
+    { "mark", vlclua_journal_mark },
+    { NULL, NULL }
+};
+
+static int vlclua_playlist_journal( lua_State *L )
+{
+    playlist_t *p_playlist = vlclua_get_playlist_internal( L );
+    vlclua_journal_t *p_journal = malloc( sizeof( *p_journal ) );
+    if( unlikely(p_journal == NULL) )
+        return luaL_error( L, "Failed to allocate the playlist journal." );
+
+    p_journal->p_playlist = p_playlist;
+    vlc_mutex_init( &p_journal->lock );
+    p_journal->i_seq = 0;
+    p_journal->i_lost = 0;
+    p_journal->i_first = 0;
+    p_journal->i_count = 0;
+
+    vlclua_journal_t **pp_journal = lua_newuserdata( L, sizeof( *pp_journal ) );
+    *pp_journal = p_journal;
+
+    if( luaL_newmetatable( L, "playlist_journal" ) )
+    {
+        lua_newtable( L );
+        luaL_register( L, NULL, vlclua_journal_reg );
+        lua_setfield( L, -2, "__index" );
+        lua_pushcfunction( L, vlclua_journal_delete );
+        lua_setfield( L, -2, "__gc" );
+    }
+    lua_setmetatable( L, -2 );
+
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_journal_vars); i++ )
+        var_AddCallback( p_playlist, ppsz_journal_vars[i],
+                         JournalCallback, p_journal );
+    return 1;
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -436,6 +757,8 @@ static const luaL_Reg vlclua_playlist_reg[] = {
     { "status", vlclua_playlist_status },
     { "delete", vlclua_playlist_delete },
     { "move", vlclua_playlist_move },
+    { "page", vlclua_playlist_page },
+    { "journal", vlclua_playlist_journal },
     { NULL, NULL }
 };
 
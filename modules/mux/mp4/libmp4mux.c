@@ -31,10 +31,21 @@
 #include "../packetizer/hxxx_nal.h"
 
 #include <vlc_es.h>
+#include <vlc_fs.h>
 #include <vlc_iso_lang.h>
 #include <vlc_bits.h>
 #include <assert.h>
 #include <time.h>
+#include <unistd.h>
+
+/* Index entries kept in memory before older ones are moved to disk */
+#ifndef ENTRY_SPILL_THRESHOLD
+# define ENTRY_SPILL_THRESHOLD 65536
+#endif
+/* Spilled entries read back at once when building the index */
+#ifndef ENTRY_WINDOW_SIZE
+# define ENTRY_WINDOW_SIZE 4096
+#endif
 
 bool mp4mux_trackinfo_Init(mp4mux_trackinfo_t *p_stream, unsigned i_id,
                            uint32_t i_timescale)
@@ -45,6 +56,7 @@ bool mp4mux_trackinfo_Init(mp4mux_trackinfo_t *p_stream, unsigned i_id,
     p_stream->i_timescale   = i_timescale;
     p_stream->i_entry_count = 0;
     p_stream->i_entry_max   = 1000;
+    p_stream->i_spill_fd    = -1;
 
     p_stream->entry         = calloc(p_stream->i_entry_max, sizeof(mp4mux_entry_t));
     if(!p_stream->entry)
@@ -59,9 +71,105 @@ void mp4mux_trackinfo_Clear(mp4mux_trackinfo_t *p_stream)
     if (p_stream->a52_frame)
         block_Release(p_stream->a52_frame);
     free(p_stream->entry);
+    if (p_stream->i_spill_fd != -1)
+        vlc_close(p_stream->i_spill_fd);
+    free(p_stream->p_window);
     free(p_stream->p_edits);
 }
 
+static int SpillEntries(mp4mux_trackinfo_t *p_stream, unsigned i_count)
+{
+    const size_t i_size = i_count * sizeof(mp4mux_entry_t);
+
+    if (p_stream->i_spill_fd == -1)
+    {
+        p_stream->i_spill_fd = vlc_memfd();
+        if (p_stream->i_spill_fd == -1)
+            return -1;
+    }
+
+    /* Seek explicitly, so that a failed write can be overwritten */
+    if (lseek(p_stream->i_spill_fd, (off_t)p_stream->i_spilled *
+              sizeof(mp4mux_entry_t), SEEK_SET) == -1 ||
+        write(p_stream->i_spill_fd, p_stream->entry, i_size) != (ssize_t)i_size)
+        return -1;
+
+    p_stream->i_spilled += i_count;
+    return 0;
+}
+
+/* Appends an index entry. Once many entries are held, all but the last
+ * one (which may still be fixed up) are moved to a temporary file. */
+mp4mux_entry_t *mp4mux_track_AddEntry(mp4mux_trackinfo_t *p_stream)
+{
+    unsigned i_memory = p_stream->i_entry_count - p_stream->i_spilled;
+
+    if (i_memory >= p_stream->i_entry_max)
+    {
+        if (i_memory >= ENTRY_SPILL_THRESHOLD &&
+            SpillEntries(p_stream, i_memory - 1) == 0)
+        {
+            p_stream->entry[0] = p_stream->entry[i_memory - 1];
+        }
+        else
+        {
+            mp4mux_entry_t *p_realloc =
+                realloc(p_stream->entry, (p_stream->i_entry_max + 1000) *
+                                         sizeof(mp4mux_entry_t));
+            if (!p_realloc)
+                return NULL;
+            p_stream->entry = p_realloc;
+            p_stream->i_entry_max += 1000;
+        }
+    }
+
+    return &p_stream->entry[p_stream->i_entry_count++ - p_stream->i_spilled];
+}
+
+mp4mux_entry_t *mp4mux_track_LastEntry(mp4mux_trackinfo_t *p_stream)
+{
+    if (p_stream->i_entry_count == 0)
+        return NULL;
+    return &p_stream->entry[p_stream->i_entry_count - 1 - p_stream->i_spilled];
+}
+
+/* Reads an index entry, from memory or through a window on the disk */
+int mp4mux_track_GetEntry(mp4mux_trackinfo_t *p_stream, unsigned i,
+                          mp4mux_entry_t *p_entry)
+{
+    assert(i < p_stream->i_entry_count);
+
+    if (i >= p_stream->i_spilled)
+    {
+        *p_entry = p_stream->entry[i - p_stream->i_spilled];
+        return VLC_SUCCESS;
+    }
+
+    if (i < p_stream->i_window_start ||
+        i >= p_stream->i_window_start + p_stream->i_window_count)
+    {
+        unsigned i_count = __MIN(ENTRY_WINDOW_SIZE, p_stream->i_spilled - i);
+
+        p_stream->i_window_count = 0;
+        if (!p_stream->p_window)
+            p_stream->p_window = malloc(ENTRY_WINDOW_SIZE *
+                                        sizeof(mp4mux_entry_t));
+        if (!p_stream->p_window ||
+            lseek(p_stream->i_spill_fd, (off_t)i * sizeof(mp4mux_entry_t),
+                  SEEK_SET) == -1 ||
+            read(p_stream->i_spill_fd, p_stream->p_window,
+                 i_count * sizeof(mp4mux_entry_t)) !=
+                (ssize_t)(i_count * sizeof(mp4mux_entry_t)))
+            return VLC_EGENERIC;
+
+        p_stream->i_window_start = i;
+        p_stream->i_window_count = i_count;
+    }
+
+    *p_entry = p_stream->p_window[i - p_stream->i_window_start];
+    return VLC_SUCCESS;
+}
+
 
 bo_t *box_new(const char *fcc)
 {
@@ -229,25 +337,9 @@ static bo_t *GetESDS(mp4mux_trackinfo_t *p_track)
     if(!esds)
         return NULL;
 
-    /* Compute Max bitrate */
-    int64_t i_bitrate_avg = 0;
-    int64_t i_bitrate_max = 0;
-    /* Compute avg/max bitrate */
-    for (unsigned i = 0; i < p_track->i_entry_count; i++) {
-        i_bitrate_avg += p_track->entry[i].i_size;
-        if (p_track->entry[i].i_length > 0) {
-            int64_t i_bitrate = INT64_C(8000000) * p_track->entry[i].i_size / p_track->entry[i].i_length;
-            if (i_bitrate > i_bitrate_max)
-                i_bitrate_max = i_bitrate;
-        }
-    }
-
-    if (p_track->i_read_duration > 0)
-        i_bitrate_avg = INT64_C(8000000) * i_bitrate_avg / p_track->i_read_duration;
-    else
-        i_bitrate_avg = 0;
-    if (i_bitrate_max <= 1)
-        i_bitrate_max = 0x7fffffff;
+    /* Computed from the index by GetStblBox() */
+    const int64_t i_bitrate_avg = p_track->i_bitrate_avg;
+    const int64_t i_bitrate_max = p_track->i_bitrate_max;
 
     /* ES_Descr */
     bo_add_mp4_tag_descr(esds, 0x03, 3 + 5 + 13 + i_decoder_specific_info_size + 5 + 1);
@@ -1248,10 +1340,47 @@ static int64_t GetScaledEntryDuration( const mp4mux_entry_t *p_entry, uint32_t i
     return i_scaled;
 }
 
+/* Computes the average and max bitrates of the elementary stream descriptor */
+static int GetBitrates(mp4mux_trackinfo_t *p_track)
+{
+    int64_t i_bitrate_avg = 0;
+    int64_t i_bitrate_max = 0;
+
+    for (unsigned i = 0; i < p_track->i_entry_count; i++) {
+        mp4mux_entry_t entry;
+        if (mp4mux_track_GetEntry(p_track, i, &entry))
+            return VLC_EGENERIC;
+        i_bitrate_avg += entry.i_size;
+        if (entry.i_length > 0) {
+            int64_t i_bitrate = INT64_C(8000000) * entry.i_size / entry.i_length;
+            if (i_bitrate > i_bitrate_max)
+                i_bitrate_max = i_bitrate;
+        }
+    }
+
+    if (p_track->i_read_duration > 0)
+        i_bitrate_avg = INT64_C(8000000) * i_bitrate_avg / p_track->i_read_duration;
+    else
+        i_bitrate_avg = 0;
+    if (i_bitrate_max <= 1)
+        i_bitrate_max = 0x7fffffff;
+
+    p_track->i_bitrate_avg = i_bitrate_avg;
+    p_track->i_bitrate_max = i_bitrate_max;
+    return VLC_SUCCESS;
+}
+
 static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b_mov, bool b_stco64)
 {
+    bo_t *stsd = NULL, *stco = NULL, *stsc = NULL, *stts = NULL;
+    bo_t *ctts = NULL, *stsz = NULL, *stss = NULL;
+    mp4mux_entry_t entry, next;
+
+    if (GetBitrates(p_track))
+        goto read_error;
+
     /* sample description */
-    bo_t *stsd = box_full_new("stsd", 0, 0);
+    stsd = box_full_new("stsd", 0, 0);
     if(!stsd)
         return NULL;
     bo_add_32be(stsd, 1);
@@ -1263,8 +1392,6 @@ static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b
         box_gather(stsd, GetTextBox());
 
     /* chunk offset table */
-    bo_t *stco;
-
     if (b_stco64) {
         /* 64 bits version */
         stco = box_full_new("co64", 0, 0);
@@ -1273,39 +1400,41 @@ static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b
         stco = box_full_new("stco", 0, 0);
     }
     if(!stco)
-    {
-        bo_free(stsd);
-        return NULL;
-    }
+        goto error;
     bo_add_32be(stco, 0);     // entry-count (fixed latter)
 
     /* sample to chunk table */
-    bo_t *stsc = box_full_new("stsc", 0, 0);
+    stsc = box_full_new("stsc", 0, 0);
     if(!stsc)
-    {
-        bo_free(stco);
-        bo_free(stsd);
-        return NULL;
-    }
+        goto error;
     bo_add_32be(stsc, 0);     // entry-count (fixed latter)
 
     unsigned i_chunk = 0;
     unsigned i_stsc_last_val = 0, i_stsc_entries = 0;
     for (unsigned i = 0; i < p_track->i_entry_count; i_chunk++) {
-        mp4mux_entry_t *entry = p_track->entry;
         int i_first = i;
 
+        if (mp4mux_track_GetEntry(p_track, i, &entry))
+            goto read_error;
+
         if (b_stco64)
-            bo_add_64be(stco, entry[i].i_pos);
+            bo_add_64be(stco, entry.i_pos);
         else
-            bo_add_32be(stco, entry[i].i_pos);
+            bo_add_32be(stco, entry.i_pos);
 
-        for (; i < p_track->i_entry_count; i++)
-            if (i >= p_track->i_entry_count - 1 ||
-                    entry[i].i_pos + entry[i].i_size != entry[i+1].i_pos) {
+        for (; i < p_track->i_entry_count; i++) {
+            if (i >= p_track->i_entry_count - 1) {
                 i++;
                 break;
             }
+            if (mp4mux_track_GetEntry(p_track, i + 1, &next))
+                goto read_error;
+            if (entry.i_pos + entry.i_size != next.i_pos) {
+                i++;
+                break;
+            }
+            entry = next;
+        }
 
         /* Add entry to the stsc table */
         if (i_stsc_last_val != i - i_first) {
@@ -1326,14 +1455,9 @@ static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b
     bo_swap_32be(stsc, 12, i_stsc_entries );
 
     /* add stts */
-    bo_t *stts = box_full_new("stts", 0, 0);
+    stts = box_full_new("stts", 0, 0);
     if(!stts)
-    {
-        bo_free(stsd);
-        bo_free(stco);
-        bo_free(stsc);
-        return NULL;
-    }
+        goto error;
     bo_add_32be(stts, 0);     // entry-count (fixed latter)
 
     mtime_t i_total_mtime = 0;
@@ -1342,13 +1466,17 @@ static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b
     for (unsigned i = 0; i < p_track->i_entry_count; i_index++) {
         int     i_first = i;
 
-        int64_t i_scaled = GetScaledEntryDuration(&p_track->entry[i], p_track->i_timescale,
+        if (mp4mux_track_GetEntry(p_track, i, &entry))
+            goto read_error;
+        int64_t i_scaled = GetScaledEntryDuration(&entry, p_track->i_timescale,
                                                   &i_total_mtime, &i_total_scaled);
         for (unsigned j=i+1; j < p_track->i_entry_count; j++)
         {
             mtime_t i_total_mtime_next = i_total_mtime;
             int64_t i_total_scaled_next = i_total_scaled;
-            int64_t i_scalednext = GetScaledEntryDuration(&p_track->entry[j], p_track->i_timescale,
+            if (mp4mux_track_GetEntry(p_track, j, &next))
+                goto read_error;
+            int64_t i_scalednext = GetScaledEntryDuration(&next, p_track->i_timescale,
                                                           &i_total_mtime_next, &i_total_scaled_next);
             if( i_scalednext != i_scaled )
                 break;
@@ -1367,7 +1495,6 @@ static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b
     //                i_total_mtime, i_total_scaled * CLOCK_FREQ / p_track->i_timescale );
 
     /* composition time handling */
-    bo_t *ctts = NULL;
     if ( p_track->b_hasbframes && (ctts = box_full_new("ctts", 0, 0)) )
     {
         bo_add_32be(ctts, 0);
@@ -1375,11 +1502,18 @@ static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b
         for (unsigned i = 0; i < p_track->i_entry_count; i_index++)
         {
             int     i_first = i;
-            mtime_t i_offset = p_track->entry[i].i_pts_dts;
+
+            if (mp4mux_track_GetEntry(p_track, i, &entry))
+                goto read_error;
+            mtime_t i_offset = entry.i_pts_dts;
 
             for (; i < p_track->i_entry_count; ++i)
-                if (i == p_track->i_entry_count || p_track->entry[i].i_pts_dts != i_offset)
+            {
+                if (mp4mux_track_GetEntry(p_track, i, &next))
+                    goto read_error;
+                if (next.i_pts_dts != i_offset)
                     break;
+            }
 
             bo_add_32be(ctts, i - i_first); // sample-count
             bo_add_32be(ctts, i_offset * p_track->i_timescale / CLOCK_FREQ ); // sample-offset
@@ -1387,20 +1521,17 @@ static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b
         bo_swap_32be(ctts, 12, i_index);
     }
 
-    bo_t *stsz = box_full_new("stsz", 0, 0);
+    stsz = box_full_new("stsz", 0, 0);
     if(!stsz)
-    {
-        bo_free(stsd);
-        bo_free(stco);
-        bo_free(stts);
-        return NULL;
-    }
+        goto error;
     int i_size = 0;
     for (unsigned i = 0; i < p_track->i_entry_count; i++)
     {
+        if (mp4mux_track_GetEntry(p_track, i, &entry))
+            goto read_error;
         if ( i == 0 )
-            i_size = p_track->entry[i].i_size;
-        else if ( p_track->entry[i].i_size != i_size )
+            i_size = entry.i_size;
+        else if ( entry.i_size != i_size )
         {
             i_size = 0;
             break;
@@ -1411,25 +1542,30 @@ static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b
     if ( i_size == 0 ) // all samples have different size
     {
         for (unsigned i = 0; i < p_track->i_entry_count; i++)
-            bo_add_32be(stsz, p_track->entry[i].i_size); // sample-size
+        {
+            if (mp4mux_track_GetEntry(p_track, i, &entry))
+                goto read_error;
+            bo_add_32be(stsz, entry.i_size); // sample-size
+        }
     }
 
     /* create stss table */
-    bo_t *stss = NULL;
     i_index = 0;
     if ( p_track->fmt.i_cat == VIDEO_ES || p_track->fmt.i_cat == AUDIO_ES )
     {
         mtime_t i_interval = -1;
         for (unsigned i = 0; i < p_track->i_entry_count; i++)
         {
+            if (mp4mux_track_GetEntry(p_track, i, &entry))
+                goto read_error;
             if ( i_interval != -1 )
             {
-                i_interval += p_track->entry[i].i_length + p_track->entry[i].i_pts_dts;
+                i_interval += entry.i_length + entry.i_pts_dts;
                 if ( i_interval < CLOCK_FREQ * 2 )
                     continue;
             }
 
-            if (p_track->entry[i].i_flags & BLOCK_FLAG_TYPE_I) {
+            if (entry.i_flags & BLOCK_FLAG_TYPE_I) {
                 if (stss == NULL) {
                     stss = box_full_new("stss", 0, 0);
                     if(!stss)
@@ -1449,15 +1585,7 @@ static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b
     /* Now gather all boxes into stbl */
     bo_t *stbl = box_new("stbl");
     if(!stbl)
-    {
-        bo_free(stsd);
-        bo_free(stco);
-        bo_free(stts);
-        bo_free(stsz);
-        bo_free(stss);
-        bo_free(ctts);
-        return NULL;
-    }
+        goto error;
     box_gather(stbl, stsd);
     box_gather(stbl, stts);
     if (stss)
@@ -1470,6 +1598,19 @@ static bo_t *GetStblBox(vlc_object_t *p_obj, mp4mux_trackinfo_t *p_track, bool b
     box_gather(stbl, stco);
 
     return stbl;
+
+read_error:
+    if(p_obj)
+        msg_Err(p_obj, "cannot read the index of track %u", p_track->i_track_id);
+error:
+    bo_free(stsd);
+    bo_free(stco);
+    bo_free(stsc);
+    bo_free(stts);
+    bo_free(ctts);
+    bo_free(stsz);
+    bo_free(stss);
+    return NULL;
 }
 
 bo_t * mp4mux_GetMoovBox(vlc_object_t *p_obj, mp4mux_trackinfo_t **pp_tracks, unsigned int i_tracks,
@@ -1823,6 +1964,14 @@ bo_t * mp4mux_GetMoovBox(vlc_object_t *p_obj, mp4mux_trackinfo_t **pp_tracks, un
         }
         else
             stbl = GetStblBox(p_obj, p_stream, b_mov, b_stco64);
+        if(!stbl)
+        {
+            bo_free(minf);
+            bo_free(mdia);
+            bo_free(trak);
+            bo_free(moov);
+            return NULL;
+        }
 
         /* append stbl to minf */
         p_stream->i_stco_pos += minf->b->i_buffer;
@@ -1869,8 +2018,12 @@ bo_t * mp4mux_GetMoovBox(vlc_object_t *p_obj, mp4mux_trackinfo_t **pp_tracks, un
                 if ( p_stream->i_entry_count )
                 {
                     // FIXME: find highest occurence
-                    p_stream->i_trex_default_length = p_stream->entry[0].i_length;
-                    p_stream->i_trex_default_size = p_stream->entry[0].i_size;
+                    mp4mux_entry_t entry;
+                    if (mp4mux_track_GetEntry(p_stream, 0, &entry) == VLC_SUCCESS)
+                    {
+                        p_stream->i_trex_default_length = entry.i_length;
+                        p_stream->i_trex_default_size = entry.i_size;
+                    }
                 }
 
                 /* *** add /mvex/trex *** */
@@ -49,7 +49,14 @@ typedef struct
     /* index */
     unsigned int i_entry_count;
     unsigned int i_entry_max;
-    mp4mux_entry_t *entry;
+    mp4mux_entry_t *entry; /* entries from i_spilled on */
+
+    /* older index entries, moved to disk for long recordings */
+    int          i_spill_fd;
+    unsigned int i_spilled;
+    mp4mux_entry_t *p_window; /* cache of spilled entries */
+    unsigned int i_window_start;
+    unsigned int i_window_count;
 
     /* XXX: needed for other codecs too, see lavf */
     block_t      *a52_frame;
@@ -63,6 +70,9 @@ typedef struct
     /* temp stuff */
     /* for later stco fix-up (fast start files) */
     uint64_t     i_stco_pos;
+    /* for the esds, from the index */
+    int64_t      i_bitrate_avg;
+    int64_t      i_bitrate_max;
 
     /* frags */
     uint32_t     i_trex_default_length;
@@ -77,6 +87,10 @@ typedef struct
 bool mp4mux_trackinfo_Init( mp4mux_trackinfo_t *, unsigned, uint32_t );
 void mp4mux_trackinfo_Clear( mp4mux_trackinfo_t * );
 
+mp4mux_entry_t *mp4mux_track_AddEntry( mp4mux_trackinfo_t * );
+mp4mux_entry_t *mp4mux_track_LastEntry( mp4mux_trackinfo_t * );
+int mp4mux_track_GetEntry( mp4mux_trackinfo_t *, unsigned, mp4mux_entry_t * );
+
 bo_t *box_new     (const char *fcc);
 bo_t *box_full_new(const char *fcc, uint8_t v, uint32_t f);
 void  box_fix     (bo_t *box, uint32_t);
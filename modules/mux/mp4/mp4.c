@@ -53,6 +53,14 @@
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
 
+#define CHUNK_TEXT N_("Chunk duration (ms)")
+#define CHUNK_LONGTEXT N_(\
+    "Write small fragments (moof and mdat pairs) of this duration as " \
+    "soon as their samples are available, for low latency live " \
+    "streaming. Only the chunks starting with a key frame can be joined " \
+    "by new clients. 0 writes fragments of about 1.5 seconds, aligned " \
+    "on key frames.")
+
 static int  Open   (vlc_object_t *);
 static void Close  (vlc_object_t *);
 static int  OpenFrag   (vlc_object_t *);
@@ -79,6 +87,8 @@ add_submodule ()
     set_subcategory(SUBCAT_SOUT_MUX)
     set_shortname("MP4 Frag")
     add_shortcut("mp4frag", "mp4stream")
+    add_integer(SOUT_CFG_PREFIX "chunk", 0, CHUNK_TEXT, CHUNK_LONGTEXT, true)
+        change_integer_range(0, 60000)
     set_capability("sout mux", 0)
     set_callbacks(OpenFrag, CloseFrag)
 
@@ -91,6 +101,10 @@ static const char *const ppsz_sout_options[] = {
     "faststart", NULL
 };
 
+static const char *const ppsz_sout_frag_options[] = {
+    "chunk", NULL
+};
+
 static int Control(sout_mux_t *, int, va_list);
 static int AddStream(sout_mux_t *, sout_input_t *);
 static void DelStream(sout_mux_t *, sout_input_t *);
@@ -171,6 +185,8 @@ struct sout_mux_sys_t
     bool           b_header_sent;
     mtime_t        i_written_duration;
     uint32_t       i_mfhd_sequence;
+    mtime_t        i_fragment_length;
+    bool           b_chunked;
 };
 
 static void box_send(sout_mux_t *p_mux,  bo_t *box);
@@ -254,6 +270,40 @@ static int Open(vlc_object_t *p_this)
     return VLC_SUCCESS;
 }
 
+/* Moves the chunk offsets of the moov header by the size of the header */
+static int FixupChunkOffsets(sout_mux_sys_t *p_sys, bo_t *moov, bool b_stco64,
+                             int64_t i_shift)
+{
+    for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++) {
+        mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
+        unsigned i_written = 0;
+        for (unsigned i = 0; i < p_stream->mux.i_entry_count; ) {
+            mp4mux_entry_t entry, next;
+            if (mp4mux_track_GetEntry(&p_stream->mux, i, &entry))
+                return VLC_EGENERIC;
+            if (b_stco64)
+                bo_set_64be(moov, p_stream->mux.i_stco_pos + i_written++ * 8, entry.i_pos + i_shift);
+            else
+                bo_set_32be(moov, p_stream->mux.i_stco_pos + i_written++ * 4, entry.i_pos + i_shift);
+
+            for (; i < p_stream->mux.i_entry_count; i++) {
+                if (i >= p_stream->mux.i_entry_count - 1) {
+                    i++;
+                    break;
+                }
+                if (mp4mux_track_GetEntry(&p_stream->mux, i + 1, &next))
+                    return VLC_EGENERIC;
+                if (entry.i_pos + entry.i_size != next.i_pos) {
+                    i++;
+                    break;
+                }
+                entry = next;
+            }
+        }
+    }
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * Close:
  *****************************************************************************/
@@ -287,6 +337,8 @@ static void Close(vlc_object_t *p_this)
     const bool b_stco64 = (p_sys->i_pos >= (((uint64_t)0x1) << 32));
     uint64_t i_moov_pos = p_sys->i_pos;
     bo_t *moov = BuildMoov(p_mux);
+    if (!moov)
+        msg_Err(p_mux, "cannot create the moov header, the file is unusable");
 
     /* Check we need to create "fast start" files */
     p_sys->b_fast_start = var_GetBool(p_this, SOUT_CFG_PREFIX "faststart");
@@ -322,23 +374,12 @@ static void Close(vlc_object_t *p_this)
         p_sys->i_mdat_pos += moov->b->i_buffer;
 
         /* Fix-up samples to chunks table in MOOV header */
-        for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++) {
-            mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
-            unsigned i_written = 0;
-            for (unsigned i = 0; i < p_stream->mux.i_entry_count; ) {
-                mp4mux_entry_t *entry = p_stream->mux.entry;
-                if (b_stco64)
-                    bo_set_64be(moov, p_stream->mux.i_stco_pos + i_written++ * 8, entry[i].i_pos + p_sys->i_mdat_pos - i_moov_pos);
-                else
-                    bo_set_32be(moov, p_stream->mux.i_stco_pos + i_written++ * 4, entry[i].i_pos + p_sys->i_mdat_pos - i_moov_pos);
-
-                for (; i < p_stream->mux.i_entry_count; i++)
-                    if (i >= p_stream->mux.i_entry_count - 1 ||
-                        entry[i].i_pos + entry[i].i_size != entry[i+1].i_pos) {
-                        i++;
-                        break;
-                    }
-            }
+        if (FixupChunkOffsets(p_sys, moov, b_stco64,
+                              p_sys->i_mdat_pos - i_moov_pos))
+        {
+            msg_Err(p_mux, "cannot read the index, the file is unusable");
+            bo_free(moov);
+            moov = NULL;
         }
 
         p_sys->b_fast_start = false;
@@ -542,7 +583,7 @@ static bool CreateCurrentEdit(mp4_stream_t *p_stream, mtime_t i_mux_start_dts,
         else
             p_newedit->i_duration = p_stream->i_last_dts - p_stream->i_first_dts;
         if(p_stream->mux.i_entry_count)
-            p_newedit->i_duration += p_stream->mux.entry[p_stream->mux.i_entry_count - 1].i_length;
+            p_newedit->i_duration += mp4mux_track_LastEntry(&p_stream->mux)->i_length;
     }
 
     p_stream->mux.p_edits = p_realloc;
@@ -614,13 +655,6 @@ static int Mux(sout_mux_t *p_mux)
             p_stream->i_last_pts = VLC_TS_INVALID;
         }
 
-        /* XXX: -1 to always have 2 entry for easy adding of empty SPU */
-        if (p_stream->mux.i_entry_count >= p_stream->mux.i_entry_max - 2) {
-            p_stream->mux.i_entry_max += 1000;
-            p_stream->mux.entry = xrealloc(p_stream->mux.entry,
-                         p_stream->mux.i_entry_max * sizeof(mp4mux_entry_t));
-        }
-
         /* Set current segment ranges */
         if( p_stream->i_first_dts == VLC_TS_INVALID )
         {
@@ -686,10 +720,11 @@ static int Mux(sout_mux_t *p_mux)
             int64_t i_length = dts_fb_pts( p_data ) - p_stream->i_last_dts;
             if(i_length < 0)
                 i_length = 0;
-            assert( p_stream->mux.entry[p_stream->mux.i_entry_count-1].i_length == 0 );
-            assert( p_stream->mux.entry[p_stream->mux.i_entry_count-1].i_size == 3 );
+            mp4mux_entry_t *e_empty = mp4mux_track_LastEntry(&p_stream->mux);
+            assert( e_empty->i_length == 0 );
+            assert( e_empty->i_size == 3 );
             /* Fix entry */
-            p_stream->mux.entry[p_stream->mux.i_entry_count-1].i_length = i_length;
+            e_empty->i_length = i_length;
             p_stream->mux.i_read_duration += i_length;
         }
 
@@ -699,7 +734,12 @@ static int Mux(sout_mux_t *p_mux)
             p_stream->i_last_pts = p_data->i_pts;
 
         /* add index entry */
-        mp4mux_entry_t *e = &p_stream->mux.entry[p_stream->mux.i_entry_count++];
+        mp4mux_entry_t *e = mp4mux_track_AddEntry(&p_stream->mux);
+        if (unlikely(!e))
+        {
+            block_Release(p_data);
+            return VLC_ENOMEM;
+        }
         e->i_pos    = p_sys->i_pos;
         e->i_size   = p_data->i_buffer;
 
@@ -725,11 +765,14 @@ static int Mux(sout_mux_t *p_mux)
         /* Add SPU clearing tag (duration tb fixed on next SPU or stream end )*/
         if (p_stream->mux.fmt.i_cat == SPU_ES)
         {
+            const mtime_t i_length = e->i_length;
             block_t *p_empty = block_Alloc(3);
-            if (p_empty)
+            mp4mux_entry_t *e_empty = p_empty ? mp4mux_track_AddEntry(&p_stream->mux)
+                                              : NULL;
+            if (e_empty)
             {
                 /* point to start of our empty */
-                p_stream->i_last_dts += e->i_length;
+                p_stream->i_last_dts += i_length;
 
                 /* Write a " " */
                 p_empty->p_buffer[0] = 0;
@@ -737,8 +780,6 @@ static int Mux(sout_mux_t *p_mux)
                 p_empty->p_buffer[2] = ' ';
 
                 /* Append a idx entry */
-                /* XXX: No need to grow the entry here */
-                mp4mux_entry_t *e_empty = &p_stream->mux.entry[p_stream->mux.i_entry_count++];
                 e_empty->i_pos    = p_sys->i_pos;
                 e_empty->i_size   = 3;
                 e_empty->i_pts_dts= 0;
@@ -748,6 +789,8 @@ static int Mux(sout_mux_t *p_mux)
                 p_sys->i_pos += p_empty->i_buffer;
                 sout_AccessOutWrite(p_mux->p_access, p_empty);
             }
+            else if (p_empty)
+                block_Release(p_empty);
         }
 
         /* Update the global segment/media duration */
@@ -856,6 +899,16 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
 
     *pi_mdat_total_size = 0;
 
+    /* Chunks not starting with a key frame cannot be decoded on their own */
+    bool b_sync = true;
+    for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++)
+    {
+        const mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
+        if (p_stream->b_hasiframes && p_stream->read.p_first &&
+            !(p_stream->read.p_first->p_block->i_flags & BLOCK_FLAG_TYPE_I))
+            b_sync = false;
+    }
+
     moof = box_new("moof");
     if(!moof)
         return NULL;
@@ -1057,7 +1110,8 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
     }
 
     /* set iframe flag, so the streaming server always starts from moof */
-    moof->b->i_flags |= BLOCK_FLAG_TYPE_I;
+    if (b_sync || !p_sys->b_chunked)
+        moof->b->i_flags |= BLOCK_FLAG_TYPE_I;
 
     return moof;
 }
@@ -1210,6 +1264,11 @@ static int OpenFrag(vlc_object_t *p_this)
     p_sys->i_start_dts = VLC_TS_INVALID;
     p_sys->i_mfhd_sequence = 1;
 
+    config_ChainParse(p_mux, SOUT_CFG_PREFIX, ppsz_sout_frag_options, p_mux->p_cfg);
+    int64_t i_chunk = var_GetInteger(p_mux, SOUT_CFG_PREFIX "chunk");
+    p_sys->b_chunked = i_chunk > 0;
+    p_sys->i_fragment_length = p_sys->b_chunked ? i_chunk * (CLOCK_FREQ / 1000) : FRAGMENT_LENGTH;
+
     return VLC_SUCCESS;
 }
 
@@ -1217,7 +1276,7 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
     bo_t *moof = NULL;
-    mtime_t i_barrier_time = p_sys->i_written_duration + FRAGMENT_LENGTH;
+    mtime_t i_barrier_time = p_sys->i_written_duration + p_sys->i_fragment_length;
     size_t i_mdat_size = 0;
     bool b_has_samples = false;
 
@@ -1265,7 +1324,7 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
     {
         msg_Dbg(p_mux, "writing moof @ %"PRId64, p_sys->i_pos);
         p_sys->i_pos += moof->b->i_buffer;
-        assert(moof->b->i_flags & BLOCK_FLAG_TYPE_I); /* http sout */
+        assert(p_sys->b_chunked || (moof->b->i_flags & BLOCK_FLAG_TYPE_I)); /* http sout */
         box_send(p_mux, moof);
         msg_Dbg(p_mux, "writing mdat @ %"PRId64, p_sys->i_pos);
         WriteFragmentMDAT(p_mux, i_mdat_size);
@@ -1426,7 +1485,7 @@ static int MuxFrag(sout_mux_t *p_mux)
         p_stream->p_held_entry = NULL;
 
         if (p_stream->b_hasiframes && (p_heldblock->i_flags & BLOCK_FLAG_TYPE_I) &&
-            p_stream->mux.i_read_duration - p_sys->i_written_duration < FRAGMENT_LENGTH)
+            p_stream->mux.i_read_duration - p_sys->i_written_duration < p_sys->i_fragment_length)
         {
             /* Flag the last iframe time, we'll use it as boundary so it will start
                next fragment */
@@ -1475,7 +1534,7 @@ static int MuxFrag(sout_mux_t *p_mux)
     p_sys->i_written_duration = i_min_written_duration;
 
     /* we have prerolled enough to know all streams, and have enough date to create a fragment */
-    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= FRAGMENT_LENGTH)
+    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= p_sys->i_fragment_length)
         WriteFragments(p_mux, false);
 
     return VLC_SUCCESS;
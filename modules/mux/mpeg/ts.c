@@ -153,6 +153,13 @@ static const char *const ts_standards_list_text[] =
   "PCRs (Program Clock Reference) will be sent (in milliseconds). " \
   "This value should be below 100ms. (default is 70ms).")
 
+#define MUXRATE_TEXT N_("Constant mux rate (bits/s)")
+#define MUXRATE_LONGTEXT N_("If non-zero, the transport stream is padded " \
+  "with null packets to this constant bitrate, as required by broadcast " \
+  "modulators, and the PCRs are derived from the position of the packets " \
+  "in the stream. The bitrate must be above the total bitrate of the " \
+  "streams.")
+
 #define BMIN_TEXT N_( "Minimum B (deprecated)")
 #define BMIN_LONGTEXT N_( "This setting is deprecated and not used anymore" )
 
@@ -226,6 +233,8 @@ vlc_module_begin ()
     add_bool(SOUT_CFG_PREFIX "use-key-frames", false, KEYF_TEXT, KEYF_LONGTEXT, true)
 
     add_integer( SOUT_CFG_PREFIX "pcr", 70, PCR_TEXT, PCR_LONGTEXT, true)
+    add_integer( SOUT_CFG_PREFIX "muxrate", 0, MUXRATE_TEXT, MUXRATE_LONGTEXT, true)
+        change_integer_range( 0, 200000000 )
     add_integer( SOUT_CFG_PREFIX "bmin", 0, BMIN_TEXT, BMIN_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmax", 0, BMAX_TEXT, BMAX_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "dts-delay", 400, DTS_TEXT, DTS_LONGTEXT, true)
@@ -247,7 +256,7 @@ static const char *const ppsz_sout_options[] = {
     "standard",
     "pid-video", "pid-audio", "pid-spu", "pid-pmt", "tsid",
     "netid", "sdtdesc",
-    "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
+    "es-id-pid", "shaping", "pcr", "muxrate", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
     "muxpmt", "program-pmt", "alignment",
     NULL
@@ -305,13 +314,6 @@ static inline block_t *BufferChainGet( sout_buffer_chain_t *c )
     return b;
 }
 
-static inline block_t *BufferChainPeek( sout_buffer_chain_t *c )
-{
-    block_t *b = c->p_first;
-
-    return b;
-}
-
 static inline void BufferChainClean( sout_buffer_chain_t *c )
 {
     block_t *b;
@@ -323,6 +325,55 @@ static inline void BufferChainClean( sout_buffer_chain_t *c )
     BufferChainInit( c );
 }
 
+/* TS packets built by one muxing pass, before they are dated */
+typedef struct
+{
+    mtime_t  i_dts;   /* dts of the payload */
+    uint32_t i_flags; /* BLOCK_FLAG_* of the packet */
+} ts_packet_info_t;
+
+typedef struct
+{
+    uint8_t          *p_data; /* i_max packets of 188 bytes */
+    ts_packet_info_t *p_info;
+    int              i_count;
+    int              i_max;
+} ts_packet_buffer_t;
+
+static uint8_t *TSBufferNew( ts_packet_buffer_t *b, mtime_t i_dts,
+                             uint32_t i_flags )
+{
+    if( b->i_count >= b->i_max )
+    {
+        int i_max = b->i_max ? b->i_max * 2 : 256;
+
+        uint8_t *p_data = realloc( b->p_data, (size_t)i_max * 188 );
+        if( unlikely(p_data == NULL) )
+            return NULL;
+        b->p_data = p_data;
+
+        ts_packet_info_t *p_info = realloc( b->p_info,
+                                            i_max * sizeof(*p_info) );
+        if( unlikely(p_info == NULL) )
+            return NULL;
+        b->p_info = p_info;
+        b->i_max = i_max;
+    }
+
+    b->p_info[b->i_count].i_dts = i_dts;
+    b->p_info[b->i_count].i_flags = i_flags;
+    return &b->p_data[188 * b->i_count++];
+}
+
+static void TSBufferAppendBlock( void *p_opaque, block_t *p_ts )
+{
+    uint8_t *p_packet = TSBufferNew( p_opaque, p_ts->i_dts, p_ts->i_flags );
+
+    if( likely(p_packet != NULL) )
+        memcpy( p_packet, p_ts->p_buffer, 188 );
+    block_Release( p_ts );
+}
+
 typedef struct
 {
     sout_buffer_chain_t chain_pes;
@@ -381,6 +432,36 @@ struct sout_mux_sys_t
 
     mtime_t         i_pcr;  /* last PCR emited */
 
+    ts_packet_buffer_t packets; /* packets of the current muxing pass */
+    block_t         *p_out; /* output block being filled */
+    int             i_packets_per_block;
+
+    /* constant bitrate */
+    int64_t         i_muxrate;
+    struct
+    {
+        mtime_t     i_origin; /* date of the slot i_origin_slot */
+        uint64_t    i_origin_slot;
+        uint64_t    i_slot; /* next packet slot */
+        mtime_t     i_last_pcr;
+        uint8_t     i_pcr_cc; /* continuity counter of the PCR PID */
+        bool        b_discontinuity;
+    } cbr;
+
+    /* timing statistics, reported on close */
+    struct
+    {
+        uint64_t    i_packets;
+        uint64_t    i_null_packets;
+        unsigned    i_overflows; /* passes exceeding the mux rate */
+        unsigned    i_pcrs;
+        unsigned    i_late_pcrs; /* PCR intervals over 100 ms */
+        mtime_t     i_max_pcr_interval;
+        int64_t     i_max_pcr_drift; /* in 27 MHz ticks */
+        uint64_t    pcr_pos[2]; /* packet positions of the last PCRs */
+        int64_t     pcr[2]; /* values of the last PCRs */
+    } stats;
+
     csa_t           *csa;
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
@@ -473,15 +554,20 @@ static int Mux      ( sout_mux_t * );
 
 static block_t *FixPES( sout_mux_t *p_mux, block_fifo_t *p_fifo );
 static block_t *Add_ADTS( block_t *, const es_format_t * );
-static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSSchedule  ( sout_mux_t *p_mux, int i_first, int i_packet_count,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
-static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSDate      ( sout_mux_t *p_mux, int i_first, int i_packet_count,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
-static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
-static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
+static void TSDateCBR   ( sout_mux_t *p_mux, mtime_t i_pcr_length,
+                          mtime_t i_pcr_dts );
+static void TSOutput    ( sout_mux_t *p_mux, const uint8_t *p_ts,
+                          mtime_t i_dts, mtime_t i_length, uint32_t i_flags );
+static void TSFlush     ( sout_mux_t *p_mux );
+static void GetPAT( sout_mux_t *p_mux, ts_packet_buffer_t *c );
+static void GetPMT( sout_mux_t *p_mux, ts_packet_buffer_t *c );
 
-static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
-static void TSSetPCR( block_t *p_ts, mtime_t i_dts );
+static bool TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
+static void TSSetPCR( sout_mux_t *p_mux, uint8_t *p_ts, int64_t i_pcr );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -730,8 +816,16 @@ static int Open( vlc_object_t *p_this )
     var_Get( p_mux, SOUT_CFG_PREFIX "dts-delay", &val );
     p_sys->i_dts_delay = val.i_int * 1000;
 
-    msg_Dbg( p_mux, "shaping=%"PRId64" pcr=%"PRId64" dts_delay=%"PRId64,
-             p_sys->i_shaping_delay, p_sys->i_pcr_delay, p_sys->i_dts_delay );
+    p_sys->i_muxrate = var_GetInteger( p_mux, SOUT_CFG_PREFIX "muxrate" );
+    p_sys->cbr.i_origin = VLC_TS_INVALID;
+
+    /* Output the packets by blocks fitting in an RTP payload */
+    p_sys->i_packets_per_block =
+        VLC_CLIP( (var_InheritInteger( p_mux, "mtu" ) - 12) / 188, 1, 7 );
+
+    msg_Dbg( p_mux, "shaping=%"PRId64" pcr=%"PRId64" dts_delay=%"PRId64
+             " muxrate=%"PRId64, p_sys->i_shaping_delay, p_sys->i_pcr_delay,
+             p_sys->i_dts_delay, p_sys->i_muxrate );
 
     p_sys->b_use_key_frames = var_GetBool( p_mux, SOUT_CFG_PREFIX "use-key-frames" );
 
@@ -758,6 +852,19 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->p_dvbpsi )
         dvbpsi_delete( p_sys->p_dvbpsi );
 
+    msg_Dbg( p_mux, "%"PRIu64" packets (%"PRIu64" null), %u passes over "
+             "the mux rate, %u PCRs, max interval %"PRId64" ms (%u over "
+             "100 ms), max drift %"PRId64" ns", p_sys->stats.i_packets,
+             p_sys->stats.i_null_packets, p_sys->stats.i_overflows,
+             p_sys->stats.i_pcrs, p_sys->stats.i_max_pcr_interval / 1000,
+             p_sys->stats.i_late_pcrs,
+             p_sys->stats.i_max_pcr_drift * 1000 / 27 );
+
+    if( p_sys->p_out )
+        block_Release( p_sys->p_out );
+    free( p_sys->packets.p_data );
+    free( p_sys->packets.p_info );
+
     if( p_sys->csa )
     {
         var_DelCallback( p_mux, SOUT_CFG_PREFIX "csa-ck", ChangeKeyCallback, NULL );
@@ -1037,16 +1144,11 @@ static void DelStream( sout_mux_t *p_mux, sout_input_t *p_input )
     p_sys->i_pmt_version_number %= 32;
 }
 
-static void SetHeader( sout_buffer_chain_t *c,
+static void SetHeader( ts_packet_buffer_t *c,
                         int depth )
 {
-    block_t *p_ts = BufferChainPeek( c );
-    while( depth > 0 )
-    {
-        p_ts = p_ts->p_next;
-        depth--;
-    }
-    p_ts->i_flags |= BLOCK_FLAG_HEADER;
+    if( depth < c->i_count )
+        c->p_info[depth].i_flags |= BLOCK_FLAG_HEADER;
 }
 
 static block_t *Pack_Opus(block_t *p_data)
@@ -1191,13 +1293,44 @@ static block_t *Encap_J2K( block_t *p_data, const es_format_t *p_fmt )
     return p_data;
 }
 
+/* Orders the inputs by dts of their next TS packet, then by index */
+static bool StreamBefore( sout_mux_t *p_mux, int a, int b )
+{
+    const sout_input_sys_t *p_a = (sout_input_sys_t*)p_mux->pp_inputs[a]->p_sys;
+    const sout_input_sys_t *p_b = (sout_input_sys_t*)p_mux->pp_inputs[b]->p_sys;
+
+    if( p_a->state.i_pes_dts != p_b->state.i_pes_dts )
+        return p_a->state.i_pes_dts < p_b->state.i_pes_dts;
+    return a < b;
+}
+
+static void StreamHeapDown( sout_mux_t *p_mux, int *heap, int i_heap, int i )
+{
+    for (;;)
+    {
+        int i_min = i;
+        int i_child = 2 * i + 1;
+
+        if( i_child < i_heap && StreamBefore( p_mux, heap[i_child], heap[i_min] ) )
+            i_min = i_child;
+        if( i_child + 1 < i_heap && StreamBefore( p_mux, heap[i_child + 1], heap[i_min] ) )
+            i_min = i_child + 1;
+        if( i_min == i )
+            break;
+
+        int i_tmp = heap[i];
+        heap[i] = heap[i_min];
+        heap[i_min] = i_tmp;
+        i = i_min;
+    }
+}
+
 /* returns true if needs more data */
 static bool MuxStreams(sout_mux_t *p_mux )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
     sout_input_sys_t *p_pcr_stream = (sout_input_sys_t*)p_sys->p_pcr_input->p_sys;
 
-    sout_buffer_chain_t chain_ts;
     mtime_t i_shaping_delay = p_pcr_stream->state.b_key_frame
         ? p_pcr_stream->state.i_pes_length
         : p_sys->i_shaping_delay;
@@ -1478,48 +1611,49 @@ static bool MuxStreams(sout_mux_t *p_mux )
     i_packet_count += (8 * i_pcr_length / p_sys->i_pcr_delay + 175) / 176;
 
     /* 3: mux PES into TS */
-    BufferChainInit( &chain_ts );
+    ts_packet_buffer_t *p_packets = &p_sys->packets;
+    p_packets->i_count = 0;
     /* append PAT/PMT  -> FIXME with big pcr delay it won't have enough pat/pmt */
     bool pat_was_previous = true; //This is to prevent unnecessary double PAT/PMT insertions
-    GetPAT( p_mux, &chain_ts );
-    GetPMT( p_mux, &chain_ts );
+    GetPAT( p_mux, p_packets );
+    GetPMT( p_mux, p_packets );
     int i_packet_pos = 0;
-    i_packet_count += chain_ts.i_depth;
+    i_packet_count += p_packets->i_count;
     /* msg_Dbg( p_mux, "estimated pck=%d", i_packet_count ); */
 
-    const mtime_t i_pcr_dts = p_pcr_stream->state.i_pes_dts;
-    for (;;)
+    /* PCR only packets do not increment the continuity counter */
+    p_sys->cbr.i_pcr_cc = (p_pcr_stream->ts.i_continuity_counter + 15) % 16;
+
+    /* Streams with pending PES, ordered by dts of their next TS packet */
+    int heap[p_mux->i_nb_inputs];
+    int i_heap = 0;
+    for (int i = 0; i < p_mux->i_nb_inputs; i++ )
     {
-        int          i_stream = -1;
-        mtime_t      i_dts = 0;
-        sout_input_sys_t *p_stream;
+        sout_input_sys_t *p_stream = (sout_input_sys_t*)p_mux->pp_inputs[i]->p_sys;
 
-        /* Select stream (lowest dts) */
-        for (int i = 0; i < p_mux->i_nb_inputs; i++ )
-        {
-            p_stream = (sout_input_sys_t*)p_mux->pp_inputs[i]->p_sys;
+        if( p_stream->state.i_pes_dts != 0 )
+            heap[i_heap++] = i;
+    }
+    for (int i = i_heap / 2 - 1; i >= 0; i-- )
+        StreamHeapDown( p_mux, heap, i_heap, i );
 
-            if( p_stream->state.i_pes_dts == 0 )
-            {
-                continue;
-            }
+    const mtime_t i_pcr_dts = p_pcr_stream->state.i_pes_dts;
+    while( i_heap > 0 )
+    {
+        /* Select stream (lowest dts) */
+        const int i_stream = heap[0];
+        sout_input_t *p_input = p_mux->pp_inputs[i_stream];
+        sout_input_sys_t *p_stream = (sout_input_sys_t*)p_input->p_sys;
 
-            if( i_stream == -1 || p_stream->state.i_pes_dts < i_dts )
-            {
-                i_stream = i;
-                i_dts = p_stream->state.i_pes_dts;
-            }
-        }
-        if( i_stream == -1 || i_dts > i_pcr_dts + i_pcr_length )
+        if( p_stream->state.i_pes_dts > i_pcr_dts + i_pcr_length )
         {
             break;
         }
-        p_stream = (sout_input_sys_t*)p_mux->pp_inputs[i_stream]->p_sys;
-        sout_input_t *p_input = p_mux->pp_inputs[i_stream];
 
-        /* do we need to issue pcr */
+        /* do we need to issue pcr (with a constant bitrate, they are
+         * inserted when the packets are dated) */
         bool b_pcr = false;
-        if( p_stream == p_pcr_stream &&
+        if( p_sys->i_muxrate == 0 && p_stream == p_pcr_stream &&
             i_pcr_dts + i_packet_pos * i_pcr_length / i_packet_count >=
             p_sys->i_pcr + p_sys->i_pcr_delay )
         {
@@ -1529,12 +1663,14 @@ static bool MuxStreams(sout_mux_t *p_mux )
         }
 
         /* Build the TS packet */
-        block_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
+        if( !TSNew( p_mux, p_stream, b_pcr ) )
+            break;
+        ts_packet_info_t *p_info = &p_packets->p_info[p_packets->i_count - 1];
         if( p_sys->csa != NULL &&
              (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
              (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
         {
-            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
+            p_info->i_flags |= BLOCK_FLAG_SCRAMBLED;
         }
         i_packet_pos++;
 
@@ -1543,27 +1679,53 @@ static bool MuxStreams(sout_mux_t *p_mux )
          * and start new one with pat,pmt,keyframe*/
         if( ( p_sys->b_use_key_frames ) &&
             ( p_input->p_fmt->i_cat == VIDEO_ES ) &&
-            ( p_ts->i_flags & BLOCK_FLAG_TYPE_I ) )
+            ( p_info->i_flags & BLOCK_FLAG_TYPE_I ) )
         {
             if( likely( !pat_was_previous ) )
             {
-                int startcount = chain_ts.i_depth;
-                GetPAT( p_mux, &chain_ts );
-                GetPMT( p_mux, &chain_ts );
-                SetHeader( &chain_ts, startcount );
-                i_packet_count += (chain_ts.i_depth - startcount );
+                /* append the tables, then move the key frame packet after
+                 * them: it keeps its slot, so it cannot be lost */
+                const int i_key = p_packets->i_count - 1;
+                const ts_packet_info_t info = *p_info;
+                uint8_t p_ts[188];
+
+                GetPAT( p_mux, p_packets );
+                GetPMT( p_mux, p_packets );
+
+                const int i_tables = p_packets->i_count - i_key - 1;
+                if( i_tables > 0 )
+                {
+                    memcpy( p_ts, &p_packets->p_data[188 * i_key], 188 );
+                    memmove( &p_packets->p_data[188 * i_key],
+                             &p_packets->p_data[188 * (i_key + 1)],
+                             188 * i_tables );
+                    memmove( &p_packets->p_info[i_key],
+                             &p_packets->p_info[i_key + 1],
+                             i_tables * sizeof(info) );
+                    memcpy( &p_packets->p_data[188 * (i_key + i_tables)],
+                            p_ts, 188 );
+                    p_packets->p_info[i_key + i_tables] = info;
+                    SetHeader( p_packets, i_key );
+                    i_packet_count += i_tables;
+                }
             } else {
-                SetHeader( &chain_ts, 0); //We just inserted pat/pmt,so just flag it instead of adding new one
+                SetHeader( p_packets, 0); //We just inserted pat/pmt,so just flag it instead of adding new one
             }
         }
         pat_was_previous = false;
 
-        /* */
-        BufferChainAppend( &chain_ts, p_ts );
+        /* Only the selected stream has moved */
+        if( p_stream->state.i_pes_dts == 0 )
+            heap[0] = heap[--i_heap];
+        StreamHeapDown( p_mux, heap, i_heap, 0 );
     }
 
     /* 4: date and send */
-    TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    if( p_sys->i_muxrate > 0 )
+        TSDateCBR( p_mux, i_pcr_length, i_pcr_dts );
+    else
+        TSSchedule( p_mux, 0, p_packets->i_count, i_pcr_length, i_pcr_dts );
+    TSFlush( p_mux );
     return false;
 }
 
@@ -1695,14 +1857,11 @@ static block_t *Add_ADTS( block_t *p_data, const es_format_t *p_fmt )
     return p_new_block;
 }
 
-static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSSchedule( sout_mux_t *p_mux, int i_first, int i_packet_count,
                         mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
-    sout_buffer_chain_t new_chain;
-    int i_packet_count = p_chain_ts->i_depth;
-
-    BufferChainInit( &new_chain );
+    const ts_packet_info_t *p_info = &p_sys->packets.p_info[i_first];
 
     if ( i_pcr_length <= 0 )
     {
@@ -1711,51 +1870,42 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
 
     for (int i = 0; i < i_packet_count; i++ )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
         mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
 
-        BufferChainAppend( &new_chain, p_ts );
-
-        if (!p_ts->i_dts || p_ts->i_dts + p_sys->i_dts_delay * 2/3 >= i_new_dts)
+        if (!p_info[i].i_dts || p_info[i].i_dts + p_sys->i_dts_delay * 2/3 >= i_new_dts)
             continue;
 
-        mtime_t i_max_diff = i_new_dts - p_ts->i_dts;
-        mtime_t i_cut_dts = p_ts->i_dts;
+        mtime_t i_max_diff = i_new_dts - p_info[i].i_dts;
+        mtime_t i_cut_dts = p_info[i].i_dts;
 
-        p_ts = BufferChainPeek( p_chain_ts );
         i++;
         i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
-        while ( p_ts != NULL && i_new_dts - p_ts->i_dts >= i_max_diff )
+        while ( i < i_packet_count && i_new_dts - p_info[i].i_dts >= i_max_diff )
         {
-            p_ts = BufferChainGet( p_chain_ts );
-            i_max_diff = i_new_dts - p_ts->i_dts;
-            i_cut_dts = p_ts->i_dts;
-            BufferChainAppend( &new_chain, p_ts );
+            i_max_diff = i_new_dts - p_info[i].i_dts;
+            i_cut_dts = p_info[i].i_dts;
 
-            p_ts = BufferChainPeek( p_chain_ts );
             i++;
             i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
         }
         msg_Dbg( p_mux, "adjusting rate at %"PRId64"/%"PRId64" (%d/%d)",
-                 i_cut_dts - i_pcr_dts, i_pcr_length, new_chain.i_depth,
-                 p_chain_ts->i_depth );
-        if ( new_chain.i_depth )
-            TSDate( p_mux, &new_chain, i_cut_dts - i_pcr_dts, i_pcr_dts );
-        if ( p_chain_ts->i_depth )
-            TSSchedule( p_mux, p_chain_ts, i_pcr_dts + i_pcr_length - i_cut_dts,
-                        i_cut_dts );
+                 i_cut_dts - i_pcr_dts, i_pcr_length, i,
+                 i_packet_count - i );
+        TSDate( p_mux, i_first, i, i_cut_dts - i_pcr_dts, i_pcr_dts );
+        if ( i < i_packet_count )
+            TSSchedule( p_mux, i_first + i, i_packet_count - i,
+                        i_pcr_dts + i_pcr_length - i_cut_dts, i_cut_dts );
         return;
     }
 
-    if ( new_chain.i_depth )
-        TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
+    if ( i_packet_count )
+        TSDate( p_mux, i_first, i_packet_count, i_pcr_length, i_pcr_dts );
 }
 
-static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSDate( sout_mux_t *p_mux, int i_first, int i_packet_count,
                     mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
-    int i_packet_count = p_chain_ts->i_depth;
 
     if ( i_pcr_length / 1000 > 0 )
     {
@@ -1779,35 +1929,224 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
     for (int i = 0; i < i_packet_count; i++ )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
+        uint8_t *p_ts = &p_sys->packets.p_data[188 * (i_first + i)];
+        const ts_packet_info_t *p_info = &p_sys->packets.p_info[i_first + i];
         mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
 
-        p_ts->i_dts    = i_new_dts;
-        p_ts->i_length = i_pcr_length / i_packet_count;
-
-        if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
+        if( p_info->i_flags & BLOCK_FLAG_CLOCK )
         {
-            /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
-            TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
+            /* msg_Dbg( p_mux, "pcr=%lld ms", i_new_dts / 1000 ); */
+            TSSetPCR( p_mux, p_ts, (i_new_dts - p_sys->first_dts) * 27 );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
+        if( p_info->i_flags & BLOCK_FLAG_SCRAMBLED )
         {
             vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
+            csa_Encrypt( p_sys->csa, p_ts, p_sys->i_csa_pkt_size );
             vlc_mutex_unlock( &p_sys->csa_lock );
         }
 
+        TSOutput( p_mux, p_ts, i_new_dts, i_pcr_length / i_packet_count,
+                  p_info->i_flags );
+    }
+}
+
+/* Date of a packet slot of the constant bitrate stream */
+static mtime_t CBRDate( const sout_mux_sys_t *p_sys, uint64_t i_slot )
+{
+    lldiv_t d = lldiv( i_slot - p_sys->cbr.i_origin_slot, p_sys->i_muxrate );
+
+    return p_sys->cbr.i_origin + d.quot * 188 * 8 * CLOCK_FREQ +
+           d.rem * 188 * 8 * CLOCK_FREQ / p_sys->i_muxrate;
+}
+
+/* First packet slot at or after a date */
+static uint64_t CBRSlot( const sout_mux_sys_t *p_sys, mtime_t i_date )
+{
+    if( i_date <= p_sys->cbr.i_origin )
+        return p_sys->cbr.i_origin_slot;
+
+    lldiv_t d = lldiv( i_date - p_sys->cbr.i_origin, 188 * 8 * CLOCK_FREQ );
+
+    return p_sys->cbr.i_origin_slot + d.quot * p_sys->i_muxrate +
+           (d.rem * p_sys->i_muxrate + 188 * 8 * CLOCK_FREQ - 1) /
+           (188 * 8 * CLOCK_FREQ);
+}
+
+/* PCR of a packet slot, in 27 MHz units */
+static int64_t CBRPCR( const sout_mux_sys_t *p_sys, uint64_t i_slot )
+{
+    lldiv_t d = lldiv( i_slot - p_sys->cbr.i_origin_slot, p_sys->i_muxrate );
+
+    return (p_sys->cbr.i_origin - p_sys->first_dts) * 27 +
+           d.quot * 188 * 8 * 27000000 +
+           (int64_t)((uint64_t)d.rem * 188 * 8 * 27000000 / p_sys->i_muxrate);
+}
+
+/*
+ * Sends the packets of a muxing pass in the slots of a constant bitrate
+ * stream. The packets are spread over the slots of the pass, the free slots
+ * are filled with null packets, and adaptation field only packets carry the
+ * PCR at the exact date of their slot.
+ */
+static void TSDateCBR( sout_mux_t *p_mux, mtime_t i_pcr_length,
+                       mtime_t i_pcr_dts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    sout_input_sys_t *p_pcr_stream = (sout_input_sys_t*)p_sys->p_pcr_input->p_sys;
+    const int i_packet_count = p_sys->packets.i_count;
+
+    if( p_sys->cbr.i_origin == VLC_TS_INVALID ||
+        llabs( i_pcr_dts - CBRDate( p_sys, p_sys->cbr.i_slot ) ) > CLOCK_FREQ )
+    {
+        if( p_sys->cbr.i_origin != VLC_TS_INVALID )
+        {
+            msg_Warn( p_mux, "restarting the constant bitrate clock "
+                      "(%"PRId64" ms off)",
+                      (i_pcr_dts - CBRDate( p_sys, p_sys->cbr.i_slot )) / 1000 );
+            p_sys->cbr.b_discontinuity = true;
+        }
+        p_sys->cbr.i_origin = i_pcr_dts;
+        p_sys->cbr.i_origin_slot = p_sys->cbr.i_slot;
+        p_sys->cbr.i_last_pcr = VLC_TS_INVALID;
+    }
+
+    const uint64_t i_start = __MAX( CBRSlot( p_sys, i_pcr_dts ),
+                                    p_sys->cbr.i_slot );
+    const uint64_t i_stop = __MAX( CBRSlot( p_sys, i_pcr_dts + i_pcr_length ),
+                                   i_start );
+    const uint64_t i_span = i_stop - i_start;
+
+    if( (uint64_t)i_packet_count > i_span )
+    {
+        msg_Warn( p_mux, "mux rate exceeded (%d pkt in %"PRIu64" slots)",
+                  i_packet_count, i_span );
+        p_sys->stats.i_overflows++;
+    }
+
+    int i = 0;
+    bool b_pcr = false;
+    while( i < i_packet_count || p_sys->cbr.i_slot < i_stop )
+    {
+        const uint64_t i_slot = p_sys->cbr.i_slot;
+        const mtime_t i_date = CBRDate( p_sys, i_slot );
+        uint8_t p_stuffing[188];
+        uint8_t *p_ts = p_stuffing;
+        uint32_t i_flags = 0;
+
+        /* (never twice in a row, for very low rates) */
+        b_pcr = !b_pcr &&
+            ( p_sys->cbr.i_last_pcr == VLC_TS_INVALID ||
+              i_date >= p_sys->cbr.i_last_pcr + p_sys->i_pcr_delay );
+        if( b_pcr )
+        {
+            /* PCR only packet */
+            p_ts[0] = 0x47;
+            p_ts[1] = ( p_pcr_stream->ts.i_pid >> 8 )&0x1f;
+            p_ts[2] = p_pcr_stream->ts.i_pid & 0xff;
+            p_ts[3] = 0x20 | p_sys->cbr.i_pcr_cc;
+            p_ts[4] = 183;
+            p_ts[5] = 1 << 4; /* PCR_flag */
+            if( p_sys->cbr.b_discontinuity )
+            {
+                p_ts[5] |= 0x80;
+                p_sys->cbr.b_discontinuity = false;
+            }
+            memset( &p_ts[12], 0xff, 188 - 12 );
+            TSSetPCR( p_mux, p_ts, CBRPCR( p_sys, i_slot ) );
+
+            i_flags = BLOCK_FLAG_CLOCK;
+            p_sys->cbr.i_last_pcr = i_date;
+        }
+        else if( i < i_packet_count &&
+                 ( i_slot >= i_stop ||
+                   ( i_slot >= i_start &&
+                     (uint64_t)i * i_span <= (i_slot - i_start) * i_packet_count ) ) )
+        {
+            const ts_packet_info_t *p_info = &p_sys->packets.p_info[i];
+
+            p_ts = &p_sys->packets.p_data[188 * i++];
+            i_flags = p_info->i_flags;
+
+            if( ( ( p_ts[1] & 0x1f ) << 8 | p_ts[2] ) == p_pcr_stream->ts.i_pid )
+                p_sys->cbr.i_pcr_cc = p_ts[3] & 0x0f;
+
+            if( i_flags & BLOCK_FLAG_SCRAMBLED )
+            {
+                vlc_mutex_lock( &p_sys->csa_lock );
+                csa_Encrypt( p_sys->csa, p_ts, p_sys->i_csa_pkt_size );
+                vlc_mutex_unlock( &p_sys->csa_lock );
+            }
+        }
+        else
+        {
+            /* null packet */
+            p_ts[0] = 0x47;
+            p_ts[1] = 0x1f;
+            p_ts[2] = 0xff;
+            p_ts[3] = 0x10;
+            memset( &p_ts[4], 0xff, 188 - 4 );
+            p_sys->stats.i_null_packets++;
+        }
+
+        TSOutput( p_mux, p_ts, i_date, CBRDate( p_sys, i_slot + 1 ) - i_date,
+                  i_flags );
+        p_sys->cbr.i_slot++;
+    }
+}
+
+/* Appends a dated packet to the output block */
+static void TSOutput( sout_mux_t *p_mux, const uint8_t *p_ts,
+                      mtime_t i_dts, mtime_t i_length, uint32_t i_flags )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    /* Key frames and PAT/PMT must start a block, as access outputs look at
+     * the flags of the blocks to start segments and gather headers */
+    i_flags &= BLOCK_FLAG_TYPE_I | BLOCK_FLAG_HEADER | BLOCK_FLAG_CLOCK;
+    if( p_sys->p_out != NULL &&
+        ( ( i_flags & (BLOCK_FLAG_TYPE_I | BLOCK_FLAG_HEADER) ) ||
+          ( p_sys->p_out->i_flags & BLOCK_FLAG_HEADER ) ) )
+        TSFlush( p_mux );
+
+    block_t *p_out = p_sys->p_out;
+    if( p_out == NULL )
+    {
+        p_out = block_Alloc( 188 * p_sys->i_packets_per_block );
+        if( unlikely(p_out == NULL) )
+            return;
+
+        p_out->i_buffer = 0;
+        p_out->i_length = 0;
         /* latency */
-        p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
+        p_out->i_dts = i_dts + p_sys->i_shaping_delay * 3 / 2;
+        p_sys->p_out = p_out;
+    }
+
+    memcpy( &p_out->p_buffer[p_out->i_buffer], p_ts, 188 );
+    p_out->i_buffer += 188;
+    p_out->i_length += i_length;
+    p_out->i_flags |= i_flags;
+    p_sys->stats.i_packets++;
+
+    if( p_out->i_buffer >= (size_t)188 * p_sys->i_packets_per_block )
+        TSFlush( p_mux );
+}
 
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
+static void TSFlush( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    if( p_sys->p_out != NULL )
+    {
+        sout_AccessOutWrite( p_mux->p_access, p_sys->p_out );
+        p_sys->p_out = NULL;
     }
 }
 
-static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
-                       bool b_pcr )
+static bool TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
+                   bool b_pcr )
 {
-    VLC_UNUSED(p_mux);
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
     block_t *p_pes = p_stream->state.chain_pes.p_first;
 
     bool b_new_pes = false;
@@ -1827,20 +2166,25 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         b_adaptation_field = true;
     }
 
-    block_t *p_ts = block_Alloc( 188 );
-
+    uint32_t i_flags = 0;
     if (b_new_pes && !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) && p_pes->i_flags & BLOCK_FLAG_TYPE_I)
     {
-        p_ts->i_flags |= BLOCK_FLAG_TYPE_I;
+        i_flags |= BLOCK_FLAG_TYPE_I;
+    }
+    if( b_pcr )
+    {
+        i_flags |= BLOCK_FLAG_CLOCK;
     }
 
-    p_ts->i_dts = p_pes->i_dts;
+    uint8_t *p_ts = TSBufferNew( &p_sys->packets, p_pes->i_dts, i_flags );
+    if( unlikely(p_ts == NULL) )
+        return false;
 
-    p_ts->p_buffer[0] = 0x47;
-    p_ts->p_buffer[1] = ( b_new_pes ? 0x40 : 0x00 ) |
+    p_ts[0] = 0x47;
+    p_ts[1] = ( b_new_pes ? 0x40 : 0x00 ) |
         ( ( p_stream->ts.i_pid >> 8 )&0x1f );
-    p_ts->p_buffer[2] = p_stream->ts.i_pid & 0xff;
-    p_ts->p_buffer[3] = ( b_adaptation_field ? 0x30 : 0x10 ) |
+    p_ts[2] = p_stream->ts.i_pid & 0xff;
+    p_ts[3] = ( b_adaptation_field ? 0x30 : 0x10 ) |
         p_stream->ts.i_continuity_counter;
 
     p_stream->ts.i_continuity_counter = (p_stream->ts.i_continuity_counter+1)%16;
@@ -1851,30 +2195,28 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         int i_stuffing = i_payload_max - i_payload;
         if( b_pcr )
         {
-            p_ts->i_flags |= BLOCK_FLAG_CLOCK;
-
-            p_ts->p_buffer[4] = 7 + i_stuffing;
-            p_ts->p_buffer[5] = 1 << 4; /* PCR_flag */
+            p_ts[4] = 7 + i_stuffing;
+            p_ts[5] = 1 << 4; /* PCR_flag */
             if( p_stream->ts.b_discontinuity )
             {
-                p_ts->p_buffer[5] |= 0x80; /* flag TS dicontinuity */
+                p_ts[5] |= 0x80; /* flag TS dicontinuity */
                 p_stream->ts.b_discontinuity = false;
             }
-            memset(&p_ts->p_buffer[12], 0xff, i_stuffing);
+            memset(&p_ts[12], 0xff, i_stuffing);
         }
         else
         {
-            p_ts->p_buffer[4] = --i_stuffing;
+            p_ts[4] = --i_stuffing;
             if( i_stuffing-- )
             {
-                p_ts->p_buffer[5] = 0;
-                memset(&p_ts->p_buffer[6], 0xff, i_stuffing);
+                p_ts[5] = 0;
+                memset(&p_ts[6], 0xff, i_stuffing);
             }
         }
     }
 
     /* copy payload */
-    memcpy( &p_ts->p_buffer[188 - i_payload],
+    memcpy( &p_ts[188 - i_payload],
             &p_pes->p_buffer[p_stream->state.i_pes_used], i_payload );
 
     p_stream->state.i_pes_used += i_payload;
@@ -1904,34 +2246,72 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         p_stream->state.i_pes_used = 0;
     }
 
-    return p_ts;
+    return true;
 }
 
-static void TSSetPCR( block_t *p_ts, mtime_t i_dts )
+/* Writes a 27 MHz PCR, at the current output position */
+static void TSSetPCR( sout_mux_t *p_mux, uint8_t *p_ts, int64_t i_pcr )
 {
-    mtime_t i_pcr = 9 * i_dts / 100;
-
-    p_ts->p_buffer[6]  = ( i_pcr >> 25 )&0xff;
-    p_ts->p_buffer[7]  = ( i_pcr >> 17 )&0xff;
-    p_ts->p_buffer[8]  = ( i_pcr >> 9  )&0xff;
-    p_ts->p_buffer[9]  = ( i_pcr >> 1  )&0xff;
-    p_ts->p_buffer[10] = ( i_pcr << 7  )&0x80;
-    p_ts->p_buffer[10] |= 0x7e;
-    p_ts->p_buffer[11] = 0; /* we don't set PCR extension */
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    int64_t i_base = i_pcr / 300;
+    int i_ext = i_pcr % 300;
+
+    if( i_ext < 0 )
+    {
+        i_base--;
+        i_ext += 300;
+    }
+
+    p_ts[6]  = ( i_base >> 25 )&0xff;
+    p_ts[7]  = ( i_base >> 17 )&0xff;
+    p_ts[8]  = ( i_base >> 9  )&0xff;
+    p_ts[9]  = ( i_base >> 1  )&0xff;
+    p_ts[10] = ( ( i_base << 7 )&0x80 ) | 0x7e | ( i_ext >> 8 );
+    p_ts[11] = i_ext & 0xff;
+
+    /* Interval, and deviation from the bitrate given by the two previous
+     * PCRs (which is the constant bitrate if there is one) */
+    const uint64_t i_pos = p_sys->stats.i_packets;
+    if( p_sys->stats.i_pcrs > 0 )
+    {
+        mtime_t i_interval = ( i_pcr - p_sys->stats.pcr[1] ) / 27;
+
+        if( i_interval > p_sys->stats.i_max_pcr_interval )
+            p_sys->stats.i_max_pcr_interval = i_interval;
+        if( i_interval > CLOCK_FREQ / 10 )
+            p_sys->stats.i_late_pcrs++;
+    }
+    if( p_sys->stats.i_pcrs > 1 &&
+        p_sys->stats.pcr_pos[1] > p_sys->stats.pcr_pos[0] )
+    {
+        int64_t i_expected = p_sys->stats.pcr[1] +
+            (int64_t)( i_pos - p_sys->stats.pcr_pos[1] ) *
+            ( p_sys->stats.pcr[1] - p_sys->stats.pcr[0] ) /
+            (int64_t)( p_sys->stats.pcr_pos[1] - p_sys->stats.pcr_pos[0] );
+        int64_t i_drift = llabs( i_pcr - i_expected );
+
+        if( i_drift > p_sys->stats.i_max_pcr_drift )
+            p_sys->stats.i_max_pcr_drift = i_drift;
+    }
+    p_sys->stats.pcr[0] = p_sys->stats.pcr[1];
+    p_sys->stats.pcr_pos[0] = p_sys->stats.pcr_pos[1];
+    p_sys->stats.pcr[1] = i_pcr;
+    p_sys->stats.pcr_pos[1] = i_pos;
+    p_sys->stats.i_pcrs++;
 }
 
-void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
+void GetPAT( sout_mux_t *p_mux, ts_packet_buffer_t *c )
 {
     sout_mux_sys_t       *p_sys = p_mux->p_sys;
 
     BuildPAT( p_sys->p_dvbpsi,
-              c, (PEStoTSCallback)BufferChainAppend,
+              c, TSBufferAppendBlock,
               p_sys->i_tsid, p_sys->i_pat_version_number,
               &p_sys->pat,
               p_sys->i_num_pmt, p_sys->pmt, p_sys->i_pmt_program_number );
 }
 
-static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
+static void GetPMT( sout_mux_t *p_mux, ts_packet_buffer_t *c )
 {
     sout_mux_sys_t *p_sys = p_mux->p_sys;
     pes_mapped_stream_t mappeds[p_mux->i_nb_inputs];
@@ -1953,7 +2333,7 @@ static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
     }
 
     BuildPMT( p_sys->p_dvbpsi, VLC_OBJECT(p_mux), p_sys->standard,
-              c, (PEStoTSCallback)BufferChainAppend,
+              c, TSBufferAppendBlock,
               p_sys->i_tsid, p_sys->i_pmt_version_number,
               ((sout_input_sys_t *)p_sys->p_pcr_input->p_sys)->ts.i_pid,
               &p_sys->sdt,
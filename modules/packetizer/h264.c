@@ -148,6 +148,7 @@ static block_t *OutputPicture( decoder_t *p_dec );
 static void PutSPS( decoder_t *p_dec, block_t *p_frag );
 static void PutPPS( decoder_t *p_dec, block_t *p_frag );
 static bool ParseSliceHeader( decoder_t *p_dec, const block_t *p_frag, h264_slice_t *p_slice );
+static bool ParseSliceContinuation( decoder_t *p_dec, const block_t *p_frag, h264_slice_t *p_slice );
 static bool ParseSeiCallback( const hxxx_sei_data_t *, void * );
 
 
@@ -302,6 +303,7 @@ static int Open( vlc_object_t *p_this )
 
     packetizer_Init( &p_sys->packetizer,
                      p_h264_startcode, sizeof(p_h264_startcode), startcode_FindAnnexB,
+                     startcode_FindAllAnnexB,
                      p_h264_startcode, 1, 5,
                      PacketizeReset, PacketizeParse, PacketizeValidate, p_dec );
 
@@ -579,7 +581,13 @@ static block_t *ParseNALBlock( decoder_t *p_dec, bool *pb_ts_used, block_t *p_fr
             p_sys->i_recoveryfnum = UINT_MAX;
         }
 
-        if( ParseSliceHeader( p_dec, p_frag, &newslice ) )
+        if( ParseSliceContinuation( p_dec, p_frag, &newslice ) )
+        {
+            /* Another slice of the current picture: nothing below the
+             * picture boundary fields of its header matters to us */
+            p_sys->slice = newslice;
+        }
+        else if( ParseSliceHeader( p_dec, p_frag, &newslice ) )
         {
             /* Only IDR carries the id, to be propagated */
             if( newslice.i_idr_pic_id == -1 )
@@ -1053,6 +1061,42 @@ static bool ParseSliceHeader( decoder_t *p_dec, const block_t *p_frag, h264_slic
     return true;
 }
 
+/* Fast path for slices following the first one of a picture: only the
+ * header prefix is decoded and the active sets are left untouched.
+ * Returns false if the slice could start a new picture. */
+static bool ParseSliceContinuation( decoder_t *p_dec, const block_t *p_frag, h264_slice_t *p_slice )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    if( !p_sys->b_slice || !p_sys->p_active_pps ||
+        p_sys->slice.type == H264_SLICE_TYPE_UNKNOWN )
+        return false;
+
+    const uint8_t *p_stripped = p_frag->p_buffer;
+    size_t i_stripped = p_frag->i_buffer;
+
+    if( !hxxx_strip_AnnexB_startcode( &p_stripped, &i_stripped ) || i_stripped < 2 )
+        return false;
+
+    if( !h264_decode_slice_prefix( p_stripped, i_stripped, GetSPSPPS, p_sys, p_slice ) )
+        return false;
+
+    if( p_slice->i_idr_pic_id == -1 )
+        p_slice->i_idr_pic_id = p_sys->slice.i_idr_pic_id;
+
+    const h264_sequence_parameter_set_t *p_sps;
+    const h264_picture_parameter_set_t *p_pps;
+    GetSPSPPS( p_slice->i_pic_parameter_set_id, p_sys, &p_sps, &p_pps );
+    if( p_pps != p_sys->p_active_pps || p_sps != p_sys->p_active_sps ||
+        IsFirstVCLNALUnit( &p_sys->slice, p_slice ) )
+        return false;
+
+    /* dec_ref_pic_marking() is the same for all slices of a picture */
+    p_slice->has_mmco5 = p_sys->slice.has_mmco5;
+
+    return true;
+}
+
 static bool ParseSeiCallback( const hxxx_sei_data_t *p_sei_data, void *cbdata )
 {
     decoder_t *p_dec = (decoder_t *) cbdata;
@@ -28,11 +28,11 @@
 #include "h264_slice.h"
 #include "hxxx_nal.h"
 
-bool h264_decode_slice( const uint8_t *p_buffer, size_t i_buffer,
-                        void (* get_sps_pps)(uint8_t, void *,
-                                             const h264_sequence_parameter_set_t **,
-                                             const h264_picture_parameter_set_t ** ),
-                        void *priv, h264_slice_t *p_slice )
+static bool h264_decode_slice_internal( const uint8_t *p_buffer, size_t i_buffer,
+                                        void (* get_sps_pps)(uint8_t, void *,
+                                                             const h264_sequence_parameter_set_t **,
+                                                             const h264_picture_parameter_set_t ** ),
+                                        void *priv, h264_slice_t *p_slice, bool b_full )
 {
     int i_slice_type;
     h264_slice_init( p_slice );
@@ -118,7 +118,7 @@ bool h264_decode_slice( const uint8_t *p_buffer, size_t i_buffer,
     }
 
     /* BELOW, Further processing up to assert MMCO 5 presence for POC */
-    if( p_slice->i_nal_type == 5 || p_slice->i_nal_ref_idc == 0 )
+    if( p_slice->i_nal_type == 5 || p_slice->i_nal_ref_idc == 0 || !b_full )
     {
         /* Early END, don't waste parsing below */
         p_slice->has_mmco5 = false;
@@ -213,6 +213,26 @@ bool h264_decode_slice( const uint8_t *p_buffer, size_t i_buffer,
     return true;
 }
 
+bool h264_decode_slice( const uint8_t *p_buffer, size_t i_buffer,
+                        void (* get_sps_pps)(uint8_t, void *,
+                                             const h264_sequence_parameter_set_t **,
+                                             const h264_picture_parameter_set_t ** ),
+                        void *priv, h264_slice_t *p_slice )
+{
+    return h264_decode_slice_internal( p_buffer, i_buffer, get_sps_pps,
+                                       priv, p_slice, true );
+}
+
+bool h264_decode_slice_prefix( const uint8_t *p_buffer, size_t i_buffer,
+                               void (* get_sps_pps)(uint8_t, void *,
+                                                    const h264_sequence_parameter_set_t **,
+                                                    const h264_picture_parameter_set_t ** ),
+                               void *priv, h264_slice_t *p_slice )
+{
+    return h264_decode_slice_internal( p_buffer, i_buffer, get_sps_pps,
+                                       priv, p_slice, false );
+}
+
 
 void h264_compute_poc( const h264_sequence_parameter_set_t *p_sps,
                        const h264_slice_t *p_slice, h264_poc_context_t *p_ctx,
@@ -78,6 +78,14 @@ bool h264_decode_slice( const uint8_t *p_buffer, size_t i_buffer,
                                              const h264_picture_parameter_set_t ** ),
                         void *, h264_slice_t *p_slice );
 
+/* Only decodes the fields needed to detect the first VCL NAL unit of a
+ * picture (7.4.1.2.4). has_mmco5 is not decoded. */
+bool h264_decode_slice_prefix( const uint8_t *p_buffer, size_t i_buffer,
+                               void (* get_sps_pps)(uint8_t pps_id, void *,
+                                                    const h264_sequence_parameter_set_t **,
+                                                    const h264_picture_parameter_set_t ** ),
+                               void *, h264_slice_t *p_slice );
+
 typedef struct
 {
     struct
@@ -40,6 +40,9 @@ typedef void (*packetizer_reset_t)( void *p_private, bool b_broken );
 typedef block_t *(*packetizer_parse_t)( void *p_private, bool *pb_ts_used, block_t * );
 typedef int (*packetizer_validate_t)( void *p_private, block_t * );
 
+#define PACKETIZER_STARTCODES_MAX 32
+#define PACKETIZER_LOOKAHEAD_SIZE 4096
+
 typedef struct
 {
     int i_state;
@@ -49,6 +52,17 @@ typedef struct
     int i_startcode;
     const uint8_t *p_startcode;
     block_startcode_helper_t pf_startcode_helper;
+    block_startcodes_helper_t pf_startcodes_helper;
+
+    /* Startcodes found by the last batched lookup, as absolute positions */
+    struct
+    {
+        uint64_t i_stream_pos; /* bytes read from the bytestream so far */
+        uint64_t i_end; /* all startcodes before that position are known */
+        unsigned i_next;
+        unsigned i_count;
+        uint64_t pi_pos[PACKETIZER_STARTCODES_MAX];
+    } lookahead;
 
     int i_au_prepend;
     const uint8_t *p_au_prepend;
@@ -65,6 +79,7 @@ typedef struct
 static inline void packetizer_Init( packetizer_t *p_pack,
                                     const uint8_t *p_startcode, int i_startcode,
                                     block_startcode_helper_t pf_start_helper,
+                                    block_startcodes_helper_t pf_starts_helper,
                                     const uint8_t *p_au_prepend, int i_au_prepend,
                                     unsigned i_au_min_size,
                                     packetizer_reset_t pf_reset,
@@ -83,12 +98,118 @@ static inline void packetizer_Init( packetizer_t *p_pack,
     p_pack->i_startcode = i_startcode;
     p_pack->p_startcode = p_startcode;
     p_pack->pf_startcode_helper = pf_start_helper;
+    p_pack->pf_startcodes_helper = pf_starts_helper;
+    p_pack->lookahead.i_stream_pos = 0;
+    p_pack->lookahead.i_end = 0;
+    p_pack->lookahead.i_next = 0;
+    p_pack->lookahead.i_count = 0;
     p_pack->pf_reset = pf_reset;
     p_pack->pf_parse = pf_parse;
     p_pack->pf_validate = pf_validate;
     p_pack->p_private = p_private;
 }
 
+static inline void packetizer_ResetLookahead( packetizer_t *p_pack )
+{
+    p_pack->lookahead.i_end = p_pack->lookahead.i_stream_pos;
+    p_pack->lookahead.i_next = 0;
+    p_pack->lookahead.i_count = 0;
+}
+
+/* Finds the next startcode from i_offset. With a batched helper, the
+ * startcodes of a window ahead of the read position are collected in one
+ * pass and handed out by the following calls. The window is kept small
+ * so that the data is still in cache when the unit gets copied. */
+static inline int packetizer_FindStartcode( packetizer_t *p_pack )
+{
+    if( p_pack->pf_startcodes_helper == NULL )
+        return block_FindStartcodeFromOffset( &p_pack->bytestream, &p_pack->i_offset,
+                                              p_pack->p_startcode, p_pack->i_startcode,
+                                              p_pack->pf_startcode_helper, NULL );
+
+    uint64_t i_target = p_pack->lookahead.i_stream_pos + p_pack->i_offset;
+
+    for( ;; )
+    {
+        while( p_pack->lookahead.i_next < p_pack->lookahead.i_count )
+        {
+            const uint64_t i_pos = p_pack->lookahead.pi_pos[p_pack->lookahead.i_next];
+            if( i_pos >= i_target )
+            {
+                p_pack->i_offset = i_pos - p_pack->lookahead.i_stream_pos;
+                return VLC_SUCCESS;
+            }
+            p_pack->lookahead.i_next++;
+        }
+
+        /* Nothing left before the end of the scanned range */
+        if( i_target < p_pack->lookahead.i_end )
+            i_target = p_pack->lookahead.i_end;
+        p_pack->i_offset = i_target - p_pack->lookahead.i_stream_pos;
+
+        size_t i_pos = p_pack->bytestream.i_block_offset + p_pack->i_offset;
+        block_t *p_block;
+        for( p_block = p_pack->bytestream.p_block; p_block; p_block = p_block->p_next )
+        {
+            if( i_pos < p_block->i_buffer )
+                break;
+            i_pos -= p_block->i_buffer;
+        }
+        if( p_block == NULL )
+            return VLC_EGENERIC; /* Need more data */
+
+        const size_t i_avail = p_block->i_buffer - i_pos;
+        if( i_avail < (size_t)p_pack->i_startcode )
+        {
+            /* Startcode spanning the next block */
+            int i_match = 0;
+            for( ; i_match < p_pack->i_startcode; i_match++ )
+            {
+                uint8_t i_byte = 0;
+                if( block_PeekOffsetBytes( &p_pack->bytestream, p_pack->i_offset + i_match,
+                                           &i_byte, 1 ) )
+                    return VLC_EGENERIC; /* Need more data */
+                if( i_byte != p_pack->p_startcode[i_match] )
+                    break;
+            }
+            if( i_match == p_pack->i_startcode )
+                return VLC_SUCCESS;
+            p_pack->lookahead.i_next = p_pack->lookahead.i_count = 0;
+            p_pack->lookahead.i_end = ++i_target;
+            continue;
+        }
+
+        const uint8_t *p_start = &p_block->p_buffer[i_pos];
+        const size_t i_window = __MIN( i_avail, PACKETIZER_LOOKAHEAD_SIZE );
+        const uint8_t *pp_found[PACKETIZER_STARTCODES_MAX];
+        size_t i_found = p_pack->pf_startcodes_helper( p_start, p_start + i_window,
+                                                       pp_found, PACKETIZER_STARTCODES_MAX );
+        for( size_t i = 0; i < i_found; i++ )
+            p_pack->lookahead.pi_pos[i] = i_target + (pp_found[i] - p_start);
+        p_pack->lookahead.i_next = 0;
+        p_pack->lookahead.i_count = i_found;
+
+        if( i_found == PACKETIZER_STARTCODES_MAX )
+            p_pack->lookahead.i_end = p_pack->lookahead.pi_pos[i_found - 1] + 1;
+        else if( i_found == 0 && i_window < i_avail )
+        {
+            /* Sparse startcodes, look for the first one in the rest of the block */
+            const uint8_t *p_next = p_start + i_window - (p_pack->i_startcode - 1);
+            const uint8_t *p_res = p_pack->pf_startcode_helper( p_next, p_start + i_avail );
+            if( p_res )
+            {
+                p_pack->lookahead.pi_pos[0] = i_target + (p_res - p_start);
+                p_pack->lookahead.i_count = 1;
+                p_pack->lookahead.i_end = p_pack->lookahead.pi_pos[0] + 1;
+            }
+            else
+                p_pack->lookahead.i_end = i_target + i_avail - (p_pack->i_startcode - 1);
+        }
+        else
+            p_pack->lookahead.i_end = i_target + i_window - (p_pack->i_startcode - 1);
+    }
+}
+
 static inline void packetizer_Clean( packetizer_t *p_pack )
 {
     block_BytestreamRelease( &p_pack->bytestream );
@@ -99,6 +220,7 @@ static inline void packetizer_Flush( packetizer_t *p_pack )
     p_pack->i_state = STATE_NOSYNC;
     block_BytestreamEmpty( &p_pack->bytestream );
     p_pack->i_offset = 0;
+    packetizer_ResetLookahead( p_pack );
     p_pack->pf_reset( p_pack->p_private, true );
 }
 
@@ -119,6 +241,7 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
         p_pack->i_state = STATE_NOSYNC;
         block_BytestreamEmpty( &p_pack->bytestream );
         p_pack->i_offset = 0;
+        packetizer_ResetLookahead( p_pack );
         p_pack->pf_reset( p_pack->p_private, b_broken );
         if( b_broken )
         {
@@ -133,20 +256,20 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
     for( ;; )
     {
         bool b_used_ts;
+        bool b_synced;
         block_t *p_pic;
 
         switch( p_pack->i_state )
         {
         case STATE_NOSYNC:
             /* Find a startcode */
-            if( !block_FindStartcodeFromOffset( &p_pack->bytestream, &p_pack->i_offset,
-                                                p_pack->p_startcode, p_pack->i_startcode,
-                                                p_pack->pf_startcode_helper, NULL ) )
+            if( !packetizer_FindStartcode( p_pack ) )
                 p_pack->i_state = STATE_NEXT_SYNC;
 
             if( p_pack->i_offset )
             {
                 block_SkipBytes( &p_pack->bytestream, p_pack->i_offset );
+                p_pack->lookahead.i_stream_pos += p_pack->i_offset;
                 p_pack->i_offset = 0;
                 block_BytestreamFlush( &p_pack->bytestream );
             }
@@ -158,18 +281,16 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
 
         case STATE_NEXT_SYNC:
             /* Find the next startcode */
-            if( block_FindStartcodeFromOffset( &p_pack->bytestream, &p_pack->i_offset,
-                                               p_pack->p_startcode, p_pack->i_startcode,
-                                               p_pack->pf_startcode_helper, NULL ) )
+            b_synced = true;
+            if( packetizer_FindStartcode( p_pack ) )
             {
+                b_synced = false;
                 if( pp_block /* not flushing */ || !p_pack->bytestream.p_chain )
                     return NULL; /* Need more data */
 
                 /* When flusing and we don't find a startcode, suppose that
                  * the data extend up to the end */
-                block_ChainProperties( p_pack->bytestream.p_chain,
-                                       NULL, &p_pack->i_offset, NULL );
-                p_pack->i_offset -= p_pack->bytestream.i_block_offset;
+                p_pack->i_offset = block_BytestreamRemaining( &p_pack->bytestream );
 
                 if( p_pack->i_offset <= (size_t)p_pack->i_startcode )
                     return NULL;
@@ -186,6 +307,7 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
 
             block_GetBytes( &p_pack->bytestream, &p_pic->p_buffer[p_pack->i_au_prepend],
                             p_pic->i_buffer - p_pack->i_au_prepend );
+            p_pack->lookahead.i_stream_pos += p_pack->i_offset;
             if( p_pack->i_au_prepend > 0 )
                 memcpy( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
 
@@ -207,23 +329,31 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
                 }
             }
 
-            if( !p_pic )
+            /* The bytestream now starts with the startcode we just found,
+             * no need to search it again from STATE_NOSYNC */
+            if( b_synced )
             {
+                p_pack->i_state = STATE_NEXT_SYNC;
+                p_pack->i_offset = 1;
+            }
+            else
                 p_pack->i_state = STATE_NOSYNC;
+
+            if( !p_pic )
                 break;
-            }
             if( p_pack->pf_validate( p_pack->p_private, p_pic ) )
             {
-                p_pack->i_state = STATE_NOSYNC;
                 block_Release( p_pic );
                 break;
             }
 
             /* So p_block doesn't get re-added several times */
             if( pp_block )
+            {
                 *pp_block = block_BytestreamPop( &p_pack->bytestream );
-
-            p_pack->i_state = STATE_NOSYNC;
+                /* The remaining data will come back as a new block */
+                packetizer_ResetLookahead( p_pack );
+            }
 
             return p_pic;
         }
@@ -248,6 +378,7 @@ static inline void packetizer_Header( packetizer_t *p_pack,
     p_pack->i_state = STATE_NOSYNC;
     block_BytestreamEmpty( &p_pack->bytestream );
     p_pack->i_offset = 0;
+    packetizer_ResetLookahead( p_pack );
 }
 
 #endif
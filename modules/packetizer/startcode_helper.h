@@ -26,6 +26,15 @@
    #include <emmintrin.h>
 #endif
 
+#ifdef HAVE_AVX2_INTRINSICS
+   #include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+   #include <arm_neon.h>
+   #define STARTCODE_NEON 1
+#endif
+
 /* Looks up efficiently for an AnnexB startcode 0x00 0x00 0x01
  * by using a 4 times faster trick than single byte lookup. */
 
@@ -52,7 +61,7 @@ static inline const uint8_t * startcode_FindAnnexB_SSE2( const uint8_t *p, const
     /* First align to 16 */
     /* Skipping this step and doing unaligned loads isn't faster */
     const uint8_t *alignedend = p + 16 - ((intptr_t)p & 15);
-    for (end -= 3; p < alignedend && p < end; p++) {
+    for (end -= 2; p < alignedend && p < end; p++) {
         if (p[0] == 0 && p[1] == 0 && p[2] == 1)
             return p;
     }
@@ -109,24 +118,153 @@ static inline const uint8_t * startcode_FindAnnexB_SSE2( const uint8_t *p, const
 
 #endif
 
+/* The vector versions below compare 3 shifted loads at once, so that
+ * each bit of the resulting mask tells a full 0x00 0x00 0x01 match.
+ * Lookups stop 2 bytes before the end of the vector range. */
+
+#ifdef HAVE_AVX2_INTRINSICS
+
+__attribute__ ((__target__ ("avx2")))
+static inline uint32_t startcode_MatchAVX2( const uint8_t *p )
+{
+    const __m256i zeros = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8( 0x01 );
+    __m256i v0 = _mm256_loadu_si256( (const __m256i *) &p[0] );
+    __m256i v1 = _mm256_loadu_si256( (const __m256i *) &p[1] );
+    __m256i v2 = _mm256_loadu_si256( (const __m256i *) &p[2] );
+    __m256i m = _mm256_and_si256( _mm256_cmpeq_epi8( v0, zeros ),
+                                  _mm256_cmpeq_epi8( v1, zeros ) );
+    m = _mm256_and_si256( m, _mm256_cmpeq_epi8( v2, ones ) );
+    return _mm256_movemask_epi8( m );
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline const uint8_t * startcode_FindAnnexB_AVX2( const uint8_t *p, const uint8_t *end )
+{
+    for( ; end - p >= 32 + 2; p += 32 )
+    {
+        uint32_t match = startcode_MatchAVX2( p );
+        if( match )
+            return p + ctz( match );
+    }
+
+    for( end -= 2; p < end; p++ )
+    {
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    }
+
+    return NULL;
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline size_t startcode_FindAllAnnexB_AVX2( const uint8_t *p, const uint8_t *end,
+                                                    const uint8_t **pp_found, size_t i_max )
+{
+    size_t i_found = 0;
+
+    for( ; end - p >= 32 + 2; p += 32 )
+    {
+        for( uint32_t match = startcode_MatchAVX2( p ); match; match &= match - 1 )
+        {
+            pp_found[i_found++] = p + ctz( match );
+            if( i_found == i_max )
+                return i_found;
+        }
+    }
+
+    for( end -= 2; p < end; p++ )
+    {
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+        {
+            pp_found[i_found++] = p;
+            if( i_found == i_max )
+                break;
+        }
+    }
+
+    return i_found;
+}
+
+#endif
+
+#ifdef STARTCODE_NEON
+
+/* Returns 4 bits per matching byte, NEON has no movemask */
+static inline uint64_t startcode_MatchNEON( const uint8_t *p )
+{
+    uint8x16_t m = vandq_u8( vceqq_u8( vld1q_u8( &p[0] ), vdupq_n_u8( 0 ) ),
+                             vceqq_u8( vld1q_u8( &p[1] ), vdupq_n_u8( 0 ) ) );
+    m = vandq_u8( m, vceqq_u8( vld1q_u8( &p[2] ), vdupq_n_u8( 1 ) ) );
+    uint8x8_t n = vshrn_n_u16( vreinterpretq_u16_u8( m ), 4 );
+    return vget_lane_u64( vreinterpret_u64_u8( n ), 0 );
+}
+
+static inline const uint8_t * startcode_FindAnnexB_NEON( const uint8_t *p, const uint8_t *end )
+{
+    for( ; end - p >= 16 + 2; p += 16 )
+    {
+        uint64_t match = startcode_MatchNEON( p );
+        if( match )
+            return p + __builtin_ctzll( match ) / 4;
+    }
+
+    for( end -= 2; p < end; p++ )
+    {
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    }
+
+    return NULL;
+}
+
+static inline size_t startcode_FindAllAnnexB_NEON( const uint8_t *p, const uint8_t *end,
+                                                    const uint8_t **pp_found, size_t i_max )
+{
+    size_t i_found = 0;
+
+    for( ; end - p >= 16 + 2; p += 16 )
+    {
+        uint64_t match = startcode_MatchNEON( p );
+        while( match )
+        {
+            const unsigned i_bit = __builtin_ctzll( match );
+            pp_found[i_found++] = p + i_bit / 4;
+            if( i_found == i_max )
+                return i_found;
+            match &= ~(UINT64_C(0xF) << (i_bit & ~3U));
+        }
+    }
+
+    for( end -= 2; p < end; p++ )
+    {
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+        {
+            pp_found[i_found++] = p;
+            if( i_found == i_max )
+                break;
+        }
+    }
+
+    return i_found;
+}
+
+#endif
+
 /* That code is adapted from libav's ff_avc_find_startcode_internal
  * and i believe the trick originated from
  * https://graphics.stanford.edu/~seander/bithacks.html#ZeroInWord
  */
-static inline const uint8_t * startcode_FindAnnexB( const uint8_t *p, const uint8_t *end )
+static inline const uint8_t * startcode_FindAnnexB_C( const uint8_t *p, const uint8_t *end )
 {
-#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
-    if (vlc_CPU_SSE2())
-        return startcode_FindAnnexB_SSE2(p, end);
-#endif
     const uint8_t *a = p + 4 - ((intptr_t)p & 3);
 
-    for (end -= 3; p < a && p < end; p++) {
+    for (end -= 2; p < a && p < end; p++) {
         if (p[0] == 0 && p[1] == 0 && p[2] == 1)
             return p;
     }
 
-    for (end -= 3; p < end; p += 4) {
+    for (end -= 4; p < end; p += 4) {
         uint32_t x = *(const uint32_t*)p;
         if ((x - 0x01010101) & (~x) & 0x80808080)
         {
@@ -135,7 +273,7 @@ static inline const uint8_t * startcode_FindAnnexB( const uint8_t *p, const uint
         }
     }
 
-    for (end += 3; p < end; p++) {
+    for (end += 4; p < end; p++) {
         if (p[0] == 0 && p[1] == 0 && p[2] == 1)
             return p;
     }
@@ -143,6 +281,48 @@ static inline const uint8_t * startcode_FindAnnexB( const uint8_t *p, const uint
     return NULL;
 }
 
+static inline const uint8_t * startcode_FindAnnexB( const uint8_t *p, const uint8_t *end )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return startcode_FindAnnexB_AVX2(p, end);
+#endif
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    if (vlc_CPU_SSE2())
+        return startcode_FindAnnexB_SSE2(p, end);
+#endif
+#ifdef STARTCODE_NEON
+    return startcode_FindAnnexB_NEON(p, end);
+#else
+    return startcode_FindAnnexB_C(p, end);
+#endif
+}
+
+/* Stores the positions of all the AnnexB startcodes in [p, end), up to
+ * i_max of them, in a single pass. Returns the number found. */
+static inline size_t startcode_FindAllAnnexB( const uint8_t *p, const uint8_t *end,
+                                              const uint8_t **pp_found, size_t i_max )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return startcode_FindAllAnnexB_AVX2(p, end, pp_found, i_max);
+#endif
+#ifdef STARTCODE_NEON
+    return startcode_FindAllAnnexB_NEON(p, end, pp_found, i_max);
+#else
+    size_t i_found = 0;
+    while( i_found < i_max && end - p >= 3 )
+    {
+        p = startcode_FindAnnexB(p, end);
+        if( !p )
+            break;
+        pp_found[i_found++] = p;
+        p += 3; /* 00 00 01 can't overlap itself */
+    }
+    return i_found;
+#endif
+}
+
 /* Special variation to return on prefix only and no data */
 static inline const uint8_t * startcode_FindAnyAnnexB( const uint8_t *p, const uint8_t *end )
 {
@@ -161,5 +341,6 @@ static inline const uint8_t * startcode_FindAnyAnnexB( const uint8_t *p, const u
 }
 
 #undef TRY_MATCH
+#undef STARTCODE_NEON
 
 #endif
@@ -36,7 +36,9 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_image.h>
+#include <vlc_interrupt.h>
 #include <vlc_subpicture.h>
+#include <vlc_threadpool.h>
 
 #include "mosaic.h"
 
@@ -52,6 +54,31 @@ static subpicture_t *Filter ( filter_t *, mtime_t );
 static int MosaicCallback   ( vlc_object_t *, char const *, vlc_value_t,
                               vlc_value_t, void * );
 
+/*****************************************************************************
+ * mosaic_tile_t : a scaled substream, composited into the canvas
+ *****************************************************************************/
+typedef struct
+{
+    const bridged_es_t *p_es; /* Substream, only compared */
+    image_handler_t *p_image;
+    picture_t *p_source;      /* Last scaled picture */
+    picture_t *p_scaled;      /* Scaled picture, I420 or YUVA */
+
+    int i_x, i_y;             /* Position in the canvas */
+    unsigned i_width, i_height;
+    int i_alpha;
+
+    /* Requested for the current frame */
+    bool b_seen;
+    picture_t *p_next;        /* New picture, or NULL if unchanged */
+    int i_next_x, i_next_y;   /* Top left corner in the mosaic */
+    unsigned i_next_width, i_next_height;
+    int i_next_alpha;
+
+    bool b_scale;
+    bool b_blit;
+} mosaic_tile_t;
+
 /*****************************************************************************
  * filter_sys_t : filter descriptor
  *****************************************************************************/
@@ -59,7 +86,19 @@ struct filter_sys_t
 {
     vlc_mutex_t lock;         /* Internal filter lock */
 
-    image_handler_t *p_image;
+    /* Compositor: tiles are scaled in parallel straight into a single
+     * canvas, which is kept from frame to frame. Only the tiles with a new
+     * picture are scaled and redrawn. */
+    vlc_threadpool_t *p_pool;
+    mosaic_tile_t *p_tiles;
+    int i_tiles;
+    picture_t *p_canvas;
+    picture_t *p_output;      /* Last published copy of the canvas */
+    int i_canvas_x, i_canvas_y;
+
+    unsigned i_frames;
+    mtime_t i_compose_time, i_compose_max;
+    unsigned long i_scaled, i_reused;
 
     int i_position;           /* Mosaic positioning method */
     bool b_ar;          /* Do we keep the aspect ratio ? */
@@ -81,6 +120,9 @@ struct filter_sys_t
     mtime_t i_delay;
 };
 
+static void TileClean( mosaic_tile_t * );
+static void CompositorReset( filter_sys_t * );
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -328,10 +370,18 @@ static int CreateFilter( vlc_object_t *p_this )
 
     p_sys->b_keep = var_CreateGetBoolCommand( p_filter,
                                               CFG_PREFIX "keep-picture" );
-    if ( !p_sys->b_keep )
-    {
-        p_sys->p_image = image_HandlerCreate( p_filter );
-    }
+    var_AddCallback( p_filter, CFG_PREFIX "keep-picture", MosaicCallback,
+                     p_sys );
+
+    p_sys->p_pool = vlc_threadpool_Get( p_filter );
+    p_sys->p_tiles = NULL;
+    p_sys->i_tiles = 0;
+    p_sys->p_canvas = NULL;
+    p_sys->p_output = NULL;
+    p_sys->i_canvas_x = p_sys->i_canvas_y = 0;
+    p_sys->i_frames = 0;
+    p_sys->i_compose_time = p_sys->i_compose_max = 0;
+    p_sys->i_scaled = p_sys->i_reused = 0;
 
     p_sys->i_order_length = 0;
     p_sys->ppsz_order = NULL;
@@ -398,13 +448,19 @@ static void DestroyFilter( vlc_object_t *p_this )
     DEL_CB( delay );
 
     DEL_CB( keep-aspect-ratio );
+    DEL_CB( keep-picture );
     DEL_CB( order );
 #undef DEL_CB
 
-    if( !p_sys->b_keep )
-    {
-        image_HandlerDelete( p_sys->p_image );
-    }
+    if( p_sys->i_frames > 0 )
+        msg_Dbg( p_filter, "composited %u frames in %.3f ms on average, "
+                 "%.3f ms at most, %lu tiles scaled, %lu reused",
+                 p_sys->i_frames,
+                 p_sys->i_compose_time / (1000. * p_sys->i_frames),
+                 p_sys->i_compose_max / 1000., p_sys->i_scaled,
+                 p_sys->i_reused );
+
+    CompositorReset( p_sys );
 
     if( p_sys->i_order_length )
     {
@@ -425,6 +481,449 @@ static void DestroyFilter( vlc_object_t *p_this )
     free( p_sys );
 }
 
+/*****************************************************************************
+ * Compositor
+ *****************************************************************************/
+static void TileClean( mosaic_tile_t *p_tile )
+{
+    if( p_tile->p_next )
+        picture_Release( p_tile->p_next );
+    if( p_tile->p_source )
+        picture_Release( p_tile->p_source );
+    if( p_tile->p_scaled )
+        picture_Release( p_tile->p_scaled );
+    image_HandlerDelete( p_tile->p_image );
+}
+
+/* Releases the tiles, the canvas and its last copy */
+static void CompositorReset( filter_sys_t *p_sys )
+{
+    for( int i = 0; i < p_sys->i_tiles; i++ )
+        TileClean( &p_sys->p_tiles[i] );
+    free( p_sys->p_tiles );
+    p_sys->p_tiles = NULL;
+    p_sys->i_tiles = 0;
+
+    if( p_sys->p_canvas )
+        picture_Release( p_sys->p_canvas );
+    if( p_sys->p_output )
+        picture_Release( p_sys->p_output );
+    p_sys->p_canvas = p_sys->p_output = NULL;
+}
+
+/* Records a tile of the current frame. Called with the bridge locked. */
+static void TileUpdate( filter_t *p_filter, const bridged_es_t *p_es,
+                        const video_format_t *p_fmt, int i_x, int i_y )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    mosaic_tile_t *p_tile = NULL;
+
+    for( int i = 0; i < p_sys->i_tiles; i++ )
+        if( p_sys->p_tiles[i].p_es == p_es && !p_sys->p_tiles[i].b_seen )
+        {
+            p_tile = &p_sys->p_tiles[i];
+            break;
+        }
+
+    if( p_tile == NULL )
+    {
+        mosaic_tile_t *p_tiles = realloc( p_sys->p_tiles,
+                            ( p_sys->i_tiles + 1 ) * sizeof( *p_tiles ) );
+        if( unlikely(p_tiles == NULL) )
+            return;
+        p_sys->p_tiles = p_tiles;
+
+        p_tile = &p_tiles[p_sys->i_tiles];
+        memset( p_tile, 0, sizeof( *p_tile ) );
+        p_tile->p_image = image_HandlerCreate( p_filter );
+        if( unlikely(p_tile->p_image == NULL) )
+            return;
+        p_tile->p_es = p_es;
+        p_sys->i_tiles++;
+    }
+
+    p_tile->b_seen = true;
+    if( p_tile->p_next )
+        picture_Release( p_tile->p_next );
+    /* The last picture is held, so its address identifies it */
+    p_tile->p_next = p_es->p_picture != p_tile->p_source
+                   ? picture_Hold( p_es->p_picture ) : NULL;
+    /* The offsets are relative to the aligned edges, as for a region of
+     * the tile size: the canvas region is placed from the top left */
+    if( p_sys->i_align & SUBPICTURE_ALIGN_BOTTOM )
+        i_y = p_sys->i_height - (int)p_fmt->i_height - i_y;
+    else if( !( p_sys->i_align & SUBPICTURE_ALIGN_TOP ) )
+        i_y = p_sys->i_height / 2 - (int)p_fmt->i_height / 2;
+    if( p_sys->i_align & SUBPICTURE_ALIGN_RIGHT )
+        i_x = p_sys->i_width - (int)p_fmt->i_width - i_x;
+    else if( !( p_sys->i_align & SUBPICTURE_ALIGN_LEFT ) )
+        i_x = p_sys->i_width / 2 - (int)p_fmt->i_width / 2;
+
+    p_tile->i_next_x = i_x;
+    p_tile->i_next_y = i_y;
+    p_tile->i_next_width = p_fmt->i_width;
+    p_tile->i_next_height = p_fmt->i_height;
+    p_tile->i_next_alpha = p_es->i_alpha;
+}
+
+static void TileScale( filter_t *p_filter, mosaic_tile_t *p_tile )
+{
+    picture_t *p_source = p_tile->p_next ? p_tile->p_next : p_tile->p_source;
+    video_format_t fmt_in, fmt_out;
+
+    video_format_Init( &fmt_in, 0 );
+    video_format_Init( &fmt_out, 0 );
+    fmt_in.i_chroma = p_source->format.i_chroma;
+    fmt_in.i_width = p_source->format.i_width;
+    fmt_in.i_height = p_source->format.i_height;
+    if( fmt_in.i_chroma == VLC_CODEC_YUVA || fmt_in.i_chroma == VLC_CODEC_RGBA )
+        fmt_out.i_chroma = VLC_CODEC_YUVA;
+    else
+        fmt_out.i_chroma = VLC_CODEC_I420;
+    fmt_out.i_width = fmt_out.i_visible_width = p_tile->i_width;
+    fmt_out.i_height = fmt_out.i_visible_height = p_tile->i_height;
+
+    picture_t *p_scaled = image_Convert( p_tile->p_image, p_source,
+                                         &fmt_in, &fmt_out );
+    video_format_Clean( &fmt_in );
+    video_format_Clean( &fmt_out );
+
+    if( p_scaled == NULL )
+    {
+        msg_Warn( p_filter, "image resizing and chroma conversion failed" );
+        return;
+    }
+
+    if( p_tile->p_scaled )
+        picture_Release( p_tile->p_scaled );
+    p_tile->p_scaled = p_scaled;
+
+    if( p_tile->p_next )
+    {
+        if( p_tile->p_source )
+            picture_Release( p_tile->p_source );
+        p_tile->p_source = p_tile->p_next;
+        p_tile->p_next = NULL;
+    }
+}
+
+/* Composites a tile over what is already drawn, i.e. over the tiles which
+ * come before it, as the SPU blender would do with one region per tile */
+static void TileBlend( picture_t *p_canvas, const mosaic_tile_t *p_tile,
+                       unsigned i_width, unsigned i_height )
+{
+    const picture_t *p_scaled = p_tile->p_scaled;
+    const bool b_yuva = p_scaled->format.i_chroma == VLC_CODEC_YUVA;
+
+    for( unsigned y = 0; y < i_height; y++ )
+    {
+        const uint8_t *pp_in[4] = { NULL, NULL, NULL, NULL };
+        uint8_t *pp_out[4];
+
+        for( int i = 0; i < 4; i++ )
+        {
+            plane_t *p_dst = &p_canvas->p[i];
+            pp_out[i] = &p_dst->p_pixels[( p_tile->i_y + y ) * p_dst->i_pitch
+                                         + p_tile->i_x];
+            if( i < p_scaled->i_planes )
+            {
+                const plane_t *p_src = &p_scaled->p[i];
+                const unsigned i_line = !b_yuva && i != Y_PLANE ? y / 2 : y;
+                pp_in[i] = &p_src->p_pixels[i_line * p_src->i_pitch];
+            }
+        }
+
+        for( unsigned x = 0; x < i_width; x++ )
+        {
+            unsigned i_src_a = p_tile->i_alpha;
+            if( b_yuva )
+                i_src_a = i_src_a * pp_in[A_PLANE][x] / 255;
+            if( i_src_a == 0 )
+                continue;
+
+            const unsigned i_dst_a = pp_out[A_PLANE][x] * ( 255 - i_src_a ) / 255;
+            const unsigned i_out_a = i_src_a + i_dst_a;
+
+            for( int i = 0; i < A_PLANE; i++ )
+            {
+                const unsigned i_src = pp_in[i][b_yuva || i == Y_PLANE ? x : x / 2];
+                pp_out[i][x] = ( i_src * i_src_a + pp_out[i][x] * i_dst_a
+                                 + i_out_a / 2 ) / i_out_a;
+            }
+            pp_out[A_PLANE][x] = i_out_a;
+        }
+    }
+}
+
+static void TileBlit( picture_t *p_canvas, const mosaic_tile_t *p_tile,
+                      bool b_blend )
+{
+    const picture_t *p_scaled = p_tile->p_scaled;
+
+    if( p_scaled == NULL )
+        return;
+
+    /* Opaque pictures are scaled to I420, others to YUVA */
+    const bool b_yuva = p_scaled->format.i_chroma == VLC_CODEC_YUVA;
+    const unsigned i_width = __MIN( p_tile->i_width,
+                                    p_scaled->format.i_visible_width );
+    const unsigned i_height = __MIN( p_tile->i_height,
+                                     p_scaled->format.i_visible_height );
+
+    if( b_blend )
+    {
+        TileBlend( p_canvas, p_tile, i_width, i_height );
+        return;
+    }
+
+    for( int i = 0; i < p_canvas->i_planes; i++ )
+    {
+        plane_t *p_dst = &p_canvas->p[i];
+        uint8_t *p_out = &p_dst->p_pixels[p_tile->i_y * p_dst->i_pitch
+                                          + p_tile->i_x];
+
+        if( !b_yuva && i == A_PLANE )
+        {
+            for( unsigned y = 0; y < i_height; y++, p_out += p_dst->i_pitch )
+                memset( p_out, p_tile->i_alpha, i_width );
+            continue;
+        }
+
+        const plane_t *p_src = &p_scaled->p[i];
+        const bool b_sub = !b_yuva && i != Y_PLANE;
+
+        for( unsigned y = 0; y < i_height; y++, p_out += p_dst->i_pitch )
+        {
+            const uint8_t *p_in =
+                &p_src->p_pixels[( b_sub ? y / 2 : y ) * p_src->i_pitch];
+
+            if( b_sub )
+                for( unsigned x = 0; x < i_width; x++ )
+                    p_out[x] = p_in[x / 2];
+            else if( i == A_PLANE && p_tile->i_alpha != 255 )
+                for( unsigned x = 0; x < i_width; x++ )
+                    p_out[x] = p_in[x] * p_tile->i_alpha / 255;
+            else
+                memcpy( p_out, p_in, i_width );
+        }
+    }
+}
+
+typedef struct
+{
+    filter_t *p_filter;
+    mosaic_tile_t **pp_tiles;
+    bool b_blit;
+} compose_t;
+
+static void ComposeTile( void *opaque, unsigned i, unsigned i_count )
+{
+    compose_t *p_ctx = opaque;
+    mosaic_tile_t *p_tile = p_ctx->pp_tiles[i];
+
+    if( p_tile->b_scale )
+        TileScale( p_ctx->p_filter, p_tile );
+    /* Tiles do not overlap: they can be drawn concurrently */
+    if( p_tile->b_blit && p_ctx->b_blit )
+        TileBlit( p_ctx->p_filter->p_sys->p_canvas, p_tile, false );
+    (void) i_count;
+}
+
+static bool TilesOverlap( const mosaic_tile_t *p_a, const mosaic_tile_t *p_b )
+{
+    return p_a->i_x < p_b->i_x + (int)p_b->i_width
+        && p_b->i_x < p_a->i_x + (int)p_a->i_width
+        && p_a->i_y < p_b->i_y + (int)p_b->i_height
+        && p_b->i_y < p_a->i_y + (int)p_a->i_height;
+}
+
+static void CanvasClear( picture_t *p_canvas )
+{
+    static const uint8_t blank[] = { 0x10, 0x80, 0x80, 0x00 };
+
+    for( int i = 0; i < p_canvas->i_planes; i++ )
+        memset( p_canvas->p[i].p_pixels, blank[i],
+                p_canvas->p[i].i_pitch * p_canvas->p[i].i_lines );
+}
+
+/*****************************************************************************
+ * Compose: scales the new pictures and draws them into the canvas
+ *****************************************************************************
+ * The canvas becomes the single region of the subpicture, placed from the
+ * top left corner as the tiles are. Tiles without a new picture are neither
+ * scaled nor drawn again, unless the layout changed.
+ *****************************************************************************/
+static void Compose( filter_t *p_filter, subpicture_t *p_spu )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const mtime_t i_start = mdate();
+    bool b_full = false;
+
+    /* Forget the substreams which went away */
+    for( int i = 0; i < p_sys->i_tiles; )
+    {
+        mosaic_tile_t *p_tile = &p_sys->p_tiles[i];
+        if( p_tile->b_seen )
+        {
+            i++;
+            continue;
+        }
+        TileClean( p_tile );
+        memmove( p_tile, p_tile + 1,
+                 ( --p_sys->i_tiles - i ) * sizeof( *p_tile ) );
+        b_full = true;
+    }
+
+    if( p_sys->i_tiles == 0 )
+    {
+        CompositorReset( p_sys );
+        return;
+    }
+
+    /* Bounding box of the tiles */
+    int i_x0 = INT_MAX, i_y0 = INT_MAX, i_x1 = INT_MIN, i_y1 = INT_MIN;
+    for( int i = 0; i < p_sys->i_tiles; i++ )
+    {
+        const mosaic_tile_t *p_tile = &p_sys->p_tiles[i];
+        i_x0 = __MIN( i_x0, p_tile->i_next_x );
+        i_y0 = __MIN( i_y0, p_tile->i_next_y );
+        i_x1 = __MAX( i_x1, p_tile->i_next_x + (int)p_tile->i_next_width );
+        i_y1 = __MAX( i_y1, p_tile->i_next_y + (int)p_tile->i_next_height );
+    }
+    if( i_x1 <= i_x0 || i_y1 <= i_y0 )
+        return;
+
+    picture_t *p_canvas = p_sys->p_canvas;
+    if( p_canvas == NULL
+     || p_canvas->format.i_width != (unsigned)( i_x1 - i_x0 )
+     || p_canvas->format.i_height != (unsigned)( i_y1 - i_y0 ) )
+    {
+        video_format_t fmt;
+
+        video_format_Init( &fmt, VLC_CODEC_YUVA );
+        fmt.i_width = fmt.i_visible_width = i_x1 - i_x0;
+        fmt.i_height = fmt.i_visible_height = i_y1 - i_y0;
+        fmt.i_sar_num = fmt.i_sar_den = 1;
+
+        if( p_canvas )
+            picture_Release( p_canvas );
+        p_canvas = p_sys->p_canvas = picture_NewFromFormat( &fmt );
+        video_format_Clean( &fmt );
+        if( p_canvas == NULL )
+            return;
+        b_full = true;
+    }
+    if( i_x0 != p_sys->i_canvas_x || i_y0 != p_sys->i_canvas_y )
+        b_full = true;
+    p_sys->i_canvas_x = i_x0;
+    p_sys->i_canvas_y = i_y0;
+
+    /* Any moved tile uncovers part of the canvas: redraw all */
+    for( int i = 0; i < p_sys->i_tiles; i++ )
+    {
+        mosaic_tile_t *p_tile = &p_sys->p_tiles[i];
+
+        p_tile->b_scale = p_tile->p_next != NULL || p_tile->p_scaled == NULL
+                       || p_tile->i_width != p_tile->i_next_width
+                       || p_tile->i_height != p_tile->i_next_height;
+        if( p_tile->i_x != p_tile->i_next_x - i_x0
+         || p_tile->i_y != p_tile->i_next_y - i_y0
+         || p_tile->i_width != p_tile->i_next_width
+         || p_tile->i_height != p_tile->i_next_height
+         || p_tile->i_alpha != p_tile->i_next_alpha )
+            b_full = true;
+
+        p_tile->i_x = p_tile->i_next_x - i_x0;
+        p_tile->i_y = p_tile->i_next_y - i_y0;
+        p_tile->i_width = p_tile->i_next_width;
+        p_tile->i_height = p_tile->i_next_height;
+        p_tile->i_alpha = p_tile->i_next_alpha;
+    }
+
+    bool b_overlap = false;
+    for( int i = 0; i < p_sys->i_tiles && !b_overlap; i++ )
+        for( int j = i + 1; j < p_sys->i_tiles && !b_overlap; j++ )
+            b_overlap = TilesOverlap( &p_sys->p_tiles[i],
+                                      &p_sys->p_tiles[j] );
+
+    mosaic_tile_t *pp_tiles[p_sys->i_tiles];
+    unsigned i_count = 0, i_blits = 0;
+
+    for( int i = 0; i < p_sys->i_tiles; i++ )
+    {
+        mosaic_tile_t *p_tile = &p_sys->p_tiles[i];
+
+        p_tile->b_blit = b_full || b_overlap || p_tile->b_scale;
+        if( p_tile->b_scale || p_tile->b_blit )
+            pp_tiles[i_count++] = p_tile;
+        if( p_tile->b_scale )
+            p_sys->i_scaled++;
+        else
+            p_sys->i_reused++;
+        if( p_tile->b_blit )
+            i_blits++;
+    }
+
+    if( b_full || b_overlap )
+        CanvasClear( p_canvas );
+
+    compose_t ctx = {
+        .p_filter = p_filter,
+        .pp_tiles = pp_tiles,
+        .b_blit = !b_overlap,
+    };
+
+    if( p_sys->p_pool != NULL && i_count > 1 )
+    {
+        /* Never leave tiles undrawn, even if the calling thread
+         * gets interrupted */
+        vlc_interrupt_t *p_ctx = vlc_interrupt_set( NULL );
+        vlc_threadpool_Run( p_sys->p_pool, i_count, ComposeTile, &ctx,
+                            VLC_THREADPOOL_PRIORITY_HIGH );
+        vlc_interrupt_set( p_ctx );
+    }
+    else
+        for( unsigned i = 0; i < i_count; i++ )
+            ComposeTile( &ctx, i, i_count );
+
+    /* Overlapping tiles are blended in order */
+    if( b_overlap )
+        for( unsigned i = 0; i < i_count; i++ )
+            TileBlit( p_canvas, pp_tiles[i], true );
+
+    /* The renderer may still use the previous output */
+    subpicture_region_t *p_region = subpicture_region_New( &p_canvas->format );
+    if( p_region == NULL )
+        return;
+
+    if( i_blits > 0 || p_sys->p_output == NULL )
+    {
+        picture_CopyPixels( p_region->p_picture, p_canvas );
+        if( p_sys->p_output )
+            picture_Release( p_sys->p_output );
+        p_sys->p_output = picture_Hold( p_region->p_picture );
+    }
+    else
+    {
+        picture_Release( p_region->p_picture );
+        p_region->p_picture = picture_Hold( p_sys->p_output );
+    }
+
+    p_region->i_x = i_x0;
+    p_region->i_y = i_y0;
+    p_region->i_align = SUBPICTURE_ALIGN_TOP | SUBPICTURE_ALIGN_LEFT;
+    p_region->i_alpha = 255;
+    p_spu->p_region = p_region;
+
+    const mtime_t i_time = mdate() - i_start;
+    msg_Dbg( p_filter, "composited %d tiles in %.3f ms (%u drawn)",
+             p_sys->i_tiles, i_time / 1000., i_blits );
+    p_sys->i_frames++;
+    p_sys->i_compose_time += i_time;
+    if( i_time > p_sys->i_compose_max )
+        p_sys->i_compose_max = i_time;
+}
+
 /*****************************************************************************
  * Filter
  *****************************************************************************/
@@ -468,6 +967,9 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
         return p_spu;
     }
 
+    for( int i = 0; i < p_sys->i_tiles; i++ )
+        p_sys->p_tiles[i].b_seen = false;
+
     if ( p_sys->i_position == position_offsets )
     {
         /* If we have either too much or not enough offsets, fall-back
@@ -525,7 +1027,8 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
     {
         bridged_es_t *p_es = p_bridge->pp_es[i_index];
         video_format_t fmt_in, fmt_out;
-        picture_t *p_converted;
+        picture_t *p_converted = NULL;
+        int i_x, i_y;
 
         if ( p_es->b_empty )
             continue;
@@ -617,17 +1120,6 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
 
             fmt_out.i_visible_width = fmt_out.i_width;
             fmt_out.i_visible_height = fmt_out.i_height;
-
-            p_converted = image_Convert( p_sys->p_image, p_es->p_picture,
-                                         &fmt_in, &fmt_out );
-            if( !p_converted )
-            {
-                msg_Warn( p_filter,
-                           "image resizing and chroma conversion failed" );
-                video_format_Clean( &fmt_in );
-                video_format_Clean( &fmt_out );
-                continue;
-            }
         }
         else
         {
@@ -639,33 +1131,15 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             fmt_out.i_visible_height = fmt_out.i_height;
         }
 
-        p_region = subpicture_region_New( &fmt_out );
-        /* FIXME the copy is probably not needed anymore */
-        if( p_region )
-            picture_Copy( p_region->p_picture, p_converted );
-        if( !p_sys->b_keep )
-            picture_Release( p_converted );
-
-        if( !p_region )
-        {
-            video_format_Clean( &fmt_in );
-            video_format_Clean( &fmt_out );
-            msg_Err( p_filter, "cannot allocate SPU region" );
-            subpicture_Delete( p_spu );
-            vlc_global_unlock( VLC_MOSAIC_MUTEX );
-            vlc_mutex_unlock( &p_sys->lock );
-            return NULL;
-        }
-
         if( p_es->i_x >= 0 && p_es->i_y >= 0 )
         {
-            p_region->i_x = p_es->i_x;
-            p_region->i_y = p_es->i_y;
+            i_x = p_es->i_x;
+            i_y = p_es->i_y;
         }
         else if( p_sys->i_position == position_offsets )
         {
-            p_region->i_x = p_sys->pi_x_offsets[i_real_index];
-            p_region->i_y = p_sys->pi_y_offsets[i_real_index];
+            i_x = p_sys->pi_x_offsets[i_real_index];
+            i_y = p_sys->pi_y_offsets[i_real_index];
         }
         else
         {
@@ -674,14 +1148,14 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             {
                 /* we don't have to center the video since it takes the
                 whole rectangle area or it's larger than the rectangle */
-                p_region->i_x = p_sys->i_xoffset
+                i_x = p_sys->i_xoffset
                             + i_col * ( p_sys->i_width / p_sys->i_cols )
                             + ( i_col * p_sys->i_borderw ) / p_sys->i_cols;
             }
             else
             {
                 /* center the video in the dedicated rectangle */
-                p_region->i_x = p_sys->i_xoffset
+                i_x = p_sys->i_xoffset
                         + i_col * ( p_sys->i_width / p_sys->i_cols )
                         + ( i_col * p_sys->i_borderw ) / p_sys->i_cols
                         + ( col_inner_width - fmt_out.i_width ) / 2;
@@ -692,19 +1166,47 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             {
                 /* we don't have to center the video since it takes the
                 whole rectangle area or it's taller than the rectangle */
-                p_region->i_y = p_sys->i_yoffset
+                i_y = p_sys->i_yoffset
                         + i_row * ( p_sys->i_height / p_sys->i_rows )
                         + ( i_row * p_sys->i_borderh ) / p_sys->i_rows;
             }
             else
             {
                 /* center the video in the dedicated rectangle */
-                p_region->i_y = p_sys->i_yoffset
+                i_y = p_sys->i_yoffset
                         + i_row * ( p_sys->i_height / p_sys->i_rows )
                         + ( i_row * p_sys->i_borderh ) / p_sys->i_rows
                         + ( row_inner_height - fmt_out.i_height ) / 2;
             }
         }
+
+        if( !p_sys->b_keep )
+        {
+            /* Scaled and composited once all tiles are known */
+            TileUpdate( p_filter, p_es, &fmt_out, i_x, i_y );
+            video_format_Clean( &fmt_in );
+            video_format_Clean( &fmt_out );
+            continue;
+        }
+
+        p_region = subpicture_region_New( &fmt_out );
+        /* FIXME the copy is probably not needed anymore */
+        if( p_region )
+            picture_Copy( p_region->p_picture, p_converted );
+
+        if( !p_region )
+        {
+            video_format_Clean( &fmt_in );
+            video_format_Clean( &fmt_out );
+            msg_Err( p_filter, "cannot allocate SPU region" );
+            subpicture_Delete( p_spu );
+            vlc_global_unlock( VLC_MOSAIC_MUTEX );
+            vlc_mutex_unlock( &p_sys->lock );
+            return NULL;
+        }
+
+        p_region->i_x = i_x;
+        p_region->i_y = i_y;
         p_region->i_align = p_sys->i_align;
         p_region->i_alpha = p_es->i_alpha;
 
@@ -723,7 +1225,11 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
         p_region_prev = p_region;
     }
 
+    /* The pictures are held: scale them without blocking the bridge */
     vlc_global_unlock( VLC_MOSAIC_MUTEX );
+
+    if( !p_sys->b_keep )
+        Compose( p_filter, p_spu );
     vlc_mutex_unlock( &p_sys->lock );
 
     return p_spu;
@@ -918,11 +1424,14 @@ static int MosaicCallback( vlc_object_t *p_this, char const *psz_var,
     else if( VAR_IS( "keep-picture" ) )
     {
         vlc_mutex_lock( &p_sys->lock );
-        p_sys->b_keep = newval.b_bool;
-        if ( !p_sys->b_keep && !p_sys->p_image )
+        if( p_sys->b_keep != newval.b_bool )
         {
-            p_sys->p_image = image_HandlerCreate( p_this );
+            msg_Dbg( p_this, newval.b_bool ? "keeping original pictures"
+                                           : "scaling pictures" );
+            /* Not needed anymore, or out of date when resuming */
+            CompositorReset( p_sys );
         }
+        p_sys->b_keep = newval.b_bool;
         vlc_mutex_unlock( &p_sys->lock );
     }
 
@@ -42,6 +42,7 @@
 #include <vlc_fs.h>
 #include <vlc_rand.h>
 #include <vlc_memstream.h>
+#include <vlc_threadpool.h>
 #ifdef HAVE_SRTP
 # include <srtp.h>
 # include <gcrypt.h>
@@ -385,6 +386,7 @@ struct sout_stream_id_sys_t
 
     block_fifo_t     *p_fifo;
     int64_t           i_caching;
+    vlc_threadpool_t *pool;
 };
 
 /*****************************************************************************
@@ -978,6 +980,7 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
     id->rtsp_id = NULL;
     id->p_fifo = NULL;
     id->listen.fd = NULL;
+    id->pool = vlc_threadpool_Get( p_stream );
 
     id->b_first_packet = true;
     id->i_caching =
@@ -1392,88 +1395,120 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
-static void* ThreadSend( void *data )
+#ifdef HAVE_SRTP
+static block_t *rtp_protect( sout_stream_id_sys_t *id, block_t *out )
 {
-#ifdef _WIN32
-# define ENOBUFS      WSAENOBUFS
-# define EAGAIN       WSAEWOULDBLOCK
-# define EWOULDBLOCK  WSAEWOULDBLOCK
+    if( id->srtp == NULL )
+        return out;
+
+    /* FIXME: this is awfully inefficient */
+    size_t len = out->i_buffer;
+    out = block_Realloc( out, 0, len + 10 );
+    out->i_buffer = len;
+
+    int canc = vlc_savecancel ();
+    int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
+    vlc_restorecancel (canc);
+    if( val )
+    {
+        msg_Dbg( id->p_stream, "SRTP sending error: %s",
+                 vlc_strerror_c(val) );
+        block_Release( out );
+        return NULL;
+    }
+    out->i_buffer = len;
+    return out;
+}
+#else
+# define rtp_protect( id, out ) (out)
 #endif
+
+/* Waits until the packet is due. The cleanup scope is kept in its own
+ * function, so that no local of the sending loop lives across it. */
+static void rtp_wait( block_t *out, mtime_t i_caching )
+{
+    block_cleanup_push( out );
+    mwait( out->i_dts + i_caching );
+    vlc_cleanup_pop();
+}
+
+static void* ThreadSend( void *data )
+{
     sout_stream_id_sys_t *id = data;
     unsigned i_caching = id->i_caching;
 
+    block_t *next = NULL; /* Dequeued but not due yet */
+
     for (;;)
     {
-        block_t *out = block_FifoGet( id->p_fifo );
-        block_cleanup_push (out);
+        block_t *pktv[RTP_BATCH_MAX];
+        unsigned pktc = 0;
 
-#ifdef HAVE_SRTP
-        if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
-
-            int canc = vlc_savecancel ();
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            vlc_restorecancel (canc);
-            if( val )
-            {
-                msg_Dbg( id->p_stream, "SRTP sending error: %s",
-                         vlc_strerror_c(val) );
-                block_Release( out );
-                out = NULL;
-            }
-            else
-                out->i_buffer = len;
-        }
-        if (out)
-            mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
+        block_t *out = (next != NULL) ? next : block_FifoGet( id->p_fifo );
+        next = NULL;
+        out = rtp_protect( id, out );
         if (out == NULL)
             continue;
-#else
-        mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
-#endif
+        rtp_wait( out, i_caching );
 
-        ssize_t len = out->i_buffer;
         int canc = vlc_savecancel ();
+        pktv[pktc++] = out;
+
+        /* Send the packets which are due already along */
+        vlc_fifo_Lock( id->p_fifo );
+        while( pktc < RTP_BATCH_MAX && !vlc_fifo_IsEmpty( id->p_fifo ) )
+        {
+            out = vlc_fifo_DequeueUnlocked( id->p_fifo );
+            if( out->i_dts + i_caching > mdate() )
+            {
+                next = out;
+                break;
+            }
+            pktv[pktc++] = out;
+        }
+        vlc_fifo_Unlock( id->p_fifo );
+
+        unsigned j = 1;
+        for( unsigned i = 1; i < pktc; i++ )
+        {
+            out = rtp_protect( id, pktv[i] );
+            if( out != NULL )
+                pktv[j++] = out;
+        }
+        pktc = j;
 
         vlc_mutex_lock( &id->lock_sink );
         unsigned deadc = 0; /* How many dead sockets? */
-        int deadv[id->sinkc ? id->sinkc : 1]; /* Dead sockets list */
+        int fdv[id->sinkc ? id->sinkc : 1];
+        bool deadv[id->sinkc ? id->sinkc : 1]; /* Dead sockets list */
 
         for( int i = 0; i < id->sinkc; i++ )
         {
+            fdv[i] = id->sinkv[i].rtp_fd;
 #ifdef HAVE_SRTP
             if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
-
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
-             && net_errno != EAGAIN && net_errno != EWOULDBLOCK
-             && net_errno != ENOBUFS && net_errno != ENOMEM )
-            {
-                int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
-                            &type, &(socklen_t){ sizeof(type) });
-                if( type == SOCK_DGRAM )
-                    /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
-                else
-                    /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
-            }
+                for( unsigned k = 0; k < pktc; k++ )
+                    SendRTCP( id->sinkv[i].rtcp, pktv[k] );
         }
-        id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
+
+        rtp_fanout_send( id->pool, fdv, id->sinkc, pktv, pktc, deadv );
+
+        for( int i = 0; i < id->sinkc; i++ )
+            if( deadv[i] )
+                fdv[deadc++] = fdv[i];
+
+        id->i_seq_sent_next =
+            ntohs(((uint16_t *) pktv[pktc - 1]->p_buffer)[1]) + 1;
         vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
+
+        for( unsigned i = 0; i < pktc; i++ )
+            block_Release( pktv[i] );
 
         for( unsigned i = 0; i < deadc; i++ )
         {
-            msg_Dbg( id->p_stream, "removing socket %d", deadv[i] );
-            rtp_del_sink( id, deadv[i] );
+            msg_Dbg( id->p_stream, "removing socket %d", fdv[i] );
+            rtp_del_sink( id, fdv[i] );
         }
         vlc_restorecancel (canc);
     }
@@ -62,6 +62,13 @@ size_t rtp_mtu (const sout_stream_id_sys_t *id);
 int rtp_packetize_xiph_config( sout_stream_id_sys_t *id, const char *fmtp,
                                int64_t i_pts );
 
+/* Fan-out */
+#define RTP_BATCH_MAX 32
+struct vlc_threadpool_t;
+void rtp_fanout_send( struct vlc_threadpool_t *pool,
+                      const int *fdv, unsigned fdc,
+                      block_t *const *pktv, unsigned pktc, bool *deadv );
+
 /* RTCP */
 typedef struct rtcp_sender_t rtcp_sender_t;
 rtcp_sender_t *OpenRTCP (vlc_object_t *obj, int rtp_fd, int proto,
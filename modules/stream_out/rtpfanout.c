@@ -0,0 +1,187 @@
+/*****************************************************************************
+ * rtpfanout.c: RTP packets fan-out to many sinks
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_network.h>
+#include <vlc_sout.h>
+#include <vlc_threadpool.h>
+
+#include "rtp.h"
+
+#ifdef _WIN32
+# define ENOBUFS      WSAENOBUFS
+# define EAGAIN       WSAEWOULDBLOCK
+# define EWOULDBLOCK  WSAEWOULDBLOCK
+#endif
+#ifndef MSG_DONTWAIT
+# define MSG_DONTWAIT 0 /* sockets are blocking then */
+#endif
+
+/* Sinks per task: below this, sending is cheaper than waking a worker up */
+#define RTP_FANOUT_SINKS 32
+
+typedef struct
+{
+    const int    *fdv;
+    unsigned      fdc;
+    struct iovec *iov;
+    unsigned      pktc;
+    bool         *deadv;
+} rtp_fanout_t;
+
+static bool IsTransient( int err )
+{
+#if EWOULDBLOCK != EAGAIN
+    if( err == EWOULDBLOCK )
+        return true;
+#endif
+    return err == EAGAIN || err == ENOBUFS || err == ENOMEM;
+}
+
+static bool IsDatagram( int fd )
+{
+    int type;
+
+    getsockopt( fd, SOL_SOCKET, SO_TYPE, &type,
+                &(socklen_t){ sizeof (type) } );
+    return type == SOCK_DGRAM;
+}
+
+/**
+ * Sends a batch of packets to one sink.
+ * This never blocks: the fan-out runs on the shared thread pool, where a
+ * slow stream receiver would hold a worker up. Packets which do not fit
+ * in the socket buffer are dropped, as are those failing with transient
+ * errors. Datagram sockets retry once on other errors (ICMP soft errors).
+ * @return false if the connection is broken, or a stream connection took
+ * part of a packet only (the framing is lost then)
+ */
+static bool SendSink( int fd, struct iovec *iov, unsigned pktc )
+{
+    bool retried = false;
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgv[pktc];
+
+    for( unsigned i = 0; i < pktc; i++ )
+    {
+        memset( &msgv[i], 0, sizeof (msgv[i]) );
+        msgv[i].msg_hdr.msg_iov = &iov[i];
+        msgv[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+
+    for( unsigned i = 0; i < pktc; )
+    {
+#ifdef HAVE_SENDMMSG
+        int val = sendmmsg( fd, msgv + i, pktc - i, MSG_DONTWAIT );
+        if( val > 0 )
+        {
+            i += val;
+            if( msgv[i - 1].msg_len < iov[i - 1].iov_len )
+                return false;
+            retried = false;
+            continue;
+        }
+#else
+        ssize_t val = send( fd, iov[i].iov_base, iov[i].iov_len,
+                            MSG_DONTWAIT );
+        if( val != -1 )
+        {
+            if( (size_t)val < iov[i].iov_len )
+                return false;
+            i++;
+            retried = false;
+            continue;
+        }
+#endif
+        if( !IsTransient( net_errno ) && !retried )
+        {
+            if( !IsDatagram( fd ) )
+                return false;
+            retried = true;
+            continue;
+        }
+        i++;
+        retried = false;
+    }
+    return true;
+}
+
+static void SendSinks( void *opaque, unsigned i, unsigned i_count )
+{
+    const rtp_fanout_t *f = opaque;
+    unsigned start = (uint64_t)f->fdc * i / i_count;
+    unsigned end = (uint64_t)f->fdc * (i + 1) / i_count;
+
+    for( unsigned j = start; j < end; j++ )
+        f->deadv[j] = !SendSink( f->fdv[j], f->iov, f->pktc );
+}
+
+/**
+ * Sends the same packets to all the sinks.
+ *
+ * The payloads are shared: each sink gets the whole batch with one system
+ * call where possible. With many sinks, they are split across the threads
+ * of the pool.
+ *
+ * @param pool thread pool, or NULL to send from the calling thread only
+ * @param deadv [OUT] whether each sink connection is broken
+ */
+void rtp_fanout_send( vlc_threadpool_t *pool, const int *fdv, unsigned fdc,
+                      block_t *const *pktv, unsigned pktc, bool *deadv )
+{
+    struct iovec iov[pktc];
+
+    assert( pktc <= RTP_BATCH_MAX );
+    for( unsigned i = 0; i < pktc; i++ )
+    {
+        iov[i].iov_base = pktv[i]->p_buffer;
+        iov[i].iov_len = pktv[i]->i_buffer;
+    }
+
+    rtp_fanout_t f = {
+        .fdv = fdv,
+        .fdc = fdc,
+        .iov = iov,
+        .pktc = pktc,
+        .deadv = deadv,
+    };
+
+    unsigned i_tasks = ( fdc + RTP_FANOUT_SINKS - 1 ) / RTP_FANOUT_SINKS;
+    if( pool != NULL )
+        /* vlc_threadpool_Run() does not allocate for up to 64 tasks */
+        i_tasks = __MIN( i_tasks, __MIN( vlc_threadpool_GetSize( pool ), 64 ) );
+
+    /* The sending threads have no interruption context: this cannot fail */
+    if( pool != NULL && i_tasks > 1 )
+        vlc_threadpool_Run( pool, i_tasks, SendSinks, &f,
+                            VLC_THREADPOOL_PRIORITY_HIGH );
+    else
+        SendSinks( &f, 0, 1 );
+}
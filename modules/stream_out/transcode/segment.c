@@ -0,0 +1,573 @@
+/*****************************************************************************
+ * segment.c: transcoding stream output module (segmented video encoding)
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#include "transcode.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <vlc_modules.h>
+
+/*
+ * The pictures are split into segments of consecutive frames. Each segment is
+ * encoded from scratch by its own encoder instance, so that it starts with a
+ * key frame and refers to no other segment (closed GOP). Up to i_workers
+ * segments are encoded concurrently, each by a worker thread. The packets are
+ * output in segment order.
+ */
+
+/* Mean absolute luma difference (0-255) between two frames for a scene cut */
+#define SCENE_CUT_THRESHOLD 30
+/* Luma sampling step for scene cut detection, in pixels and lines */
+#define SCENE_CUT_STEP 8
+/* Decoded pictures buffered for all the instances, at most */
+#define SEGMENT_MAX_PICTURES 1024
+
+typedef struct segment_t segment_t;
+
+struct segment_t
+{
+    segment_t   *p_next;
+    unsigned     i_index;
+
+    /* Encoder formats, as of the segment start */
+    es_format_t  fmt_in;
+    es_format_t  fmt_out;
+
+    picture_t   *p_pics;        /* pictures not encoded yet */
+    picture_t  **pp_pics_last;
+    unsigned     i_frames;
+    mtime_t     *pi_dates;      /* dates of the pictures, in display order */
+    unsigned     i_stamped;     /* packets given a decoding timestamp */
+
+    block_t     *p_blocks;      /* encoded packets not output yet */
+    block_t    **pp_blocks_last;
+
+    bool         b_assigned;    /* a worker encodes this segment */
+    bool         b_closed;      /* no more pictures */
+    bool         b_done;        /* encoder flushed */
+};
+
+struct transcode_segments_t
+{
+    sout_stream_t *p_stream;
+    const char    *psz_venc;
+    config_chain_t *p_cfg;
+    const es_format_t *p_fmt_ref; /* headers of the output stream */
+    unsigned       i_threads;     /* threads per encoder instance */
+    unsigned       i_length;      /* maximum frames per segment */
+
+    vlc_mutex_t    lock;
+    vlc_cond_t     wait_work;     /* new segment, new picture or abort */
+    vlc_cond_t     wait_done;     /* a segment was encoded */
+    segment_t     *p_first;       /* oldest segment not output yet */
+    segment_t    **pp_last;
+    segment_t     *p_current;     /* open segment */
+    unsigned       i_pending;     /* segments not encoded yet */
+    bool           b_abort;
+    bool           b_warned;
+    bool           b_warned_delay;
+
+    picture_t     *p_prev;        /* last picture, for scene cuts */
+    mtime_t        i_delay;       /* reordering delay, or -1 if not known */
+    mtime_t        i_last_dts;
+
+    /* Statistics */
+    unsigned       i_segments;
+    unsigned       i_scene_cuts;
+    unsigned       i_frames;
+
+    unsigned       i_workers;
+    vlc_thread_t   threads[];
+};
+
+static void SegmentDelete( segment_t *p_seg )
+{
+    picture_t *p_pic = p_seg->p_pics;
+    while( p_pic != NULL )
+    {
+        picture_t *p_next = p_pic->p_next;
+        picture_Release( p_pic );
+        p_pic = p_next;
+    }
+    block_ChainRelease( p_seg->p_blocks );
+    free( p_seg->pi_dates );
+    es_format_Clean( &p_seg->fmt_in );
+    es_format_Clean( &p_seg->fmt_out );
+    free( p_seg );
+}
+
+static encoder_t *SegmentOpenEncoder( transcode_segments_t *p_segs,
+                                      segment_t *p_seg )
+{
+    encoder_t *p_enc = sout_EncoderCreate( p_segs->p_stream );
+    if( unlikely(p_enc == NULL) )
+        return NULL;
+
+    p_enc->p_module = NULL;
+    es_format_Copy( &p_enc->fmt_in, &p_seg->fmt_in );
+    es_format_Copy( &p_enc->fmt_out, &p_seg->fmt_out );
+    free( p_enc->fmt_out.p_extra );
+    p_enc->fmt_out.p_extra = NULL;
+    p_enc->fmt_out.i_extra = 0;
+    p_enc->i_threads = p_segs->i_threads;
+    p_enc->p_cfg = p_segs->p_cfg;
+
+    p_enc->p_module = module_need( p_enc, "encoder", p_segs->psz_venc, true );
+    if( p_enc->p_module == NULL )
+    {
+        es_format_Clean( &p_enc->fmt_in );
+        es_format_Clean( &p_enc->fmt_out );
+        vlc_object_release( p_enc );
+        return NULL;
+    }
+    p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+    return p_enc;
+}
+
+static void SegmentCloseEncoder( encoder_t *p_enc )
+{
+    module_unneed( p_enc, p_enc->p_module );
+    es_format_Clean( &p_enc->fmt_in );
+    es_format_Clean( &p_enc->fmt_out );
+    vlc_object_release( p_enc );
+}
+
+/* The headers of all instances must match those given to the muxer */
+static void SegmentCheckHeaders( transcode_segments_t *p_segs,
+                                 const es_format_t *p_fmt )
+{
+    const es_format_t *p_ref = p_segs->p_fmt_ref;
+
+    if( p_fmt->i_extra == p_ref->i_extra
+     && ( p_fmt->i_extra == 0
+       || !memcmp( p_fmt->p_extra, p_ref->p_extra, p_fmt->i_extra ) ) )
+        return;
+
+    vlc_mutex_lock( &p_segs->lock );
+    if( !p_segs->b_warned )
+        msg_Warn( p_segs->p_stream, "segment encoder headers differ from "
+                  "the stream headers" );
+    p_segs->b_warned = true;
+    vlc_mutex_unlock( &p_segs->lock );
+}
+
+static void SegmentOutput( transcode_segments_t *p_segs, segment_t *p_seg,
+                           block_t *p_block )
+{
+    if( p_block == NULL )
+        return;
+
+    vlc_mutex_lock( &p_segs->lock );
+    block_ChainLastAppend( &p_seg->pp_blocks_last, p_block );
+    vlc_mutex_unlock( &p_segs->lock );
+}
+
+static void SegmentEncode( transcode_segments_t *p_segs, segment_t *p_seg )
+{
+    encoder_t *p_enc = SegmentOpenEncoder( p_segs, p_seg );
+    if( p_enc == NULL )
+        msg_Err( p_segs->p_stream, "cannot open encoder for segment %u",
+                 p_seg->i_index );
+    else
+        SegmentCheckHeaders( p_segs, &p_enc->fmt_out );
+
+    vlc_mutex_lock( &p_segs->lock );
+    for( ;; )
+    {
+        while( p_seg->p_pics == NULL && !p_seg->b_closed && !p_segs->b_abort )
+            vlc_cond_wait( &p_segs->wait_work, &p_segs->lock );
+
+        picture_t *p_pic = p_seg->p_pics;
+        if( p_pic == NULL )
+            break;
+        p_seg->p_pics = p_pic->p_next;
+        if( p_seg->p_pics == NULL )
+            p_seg->pp_pics_last = &p_seg->p_pics;
+        p_pic->p_next = NULL;
+        bool b_abort = p_segs->b_abort;
+        vlc_mutex_unlock( &p_segs->lock );
+
+        if( p_enc != NULL && !b_abort )
+            SegmentOutput( p_segs, p_seg,
+                           p_enc->pf_encode_video( p_enc, p_pic ) );
+        picture_Release( p_pic );
+        vlc_mutex_lock( &p_segs->lock );
+    }
+    vlc_mutex_unlock( &p_segs->lock );
+
+    if( p_enc != NULL )
+    {
+        /* Flush the delayed frames */
+        block_t *p_block;
+        while( (p_block = p_enc->pf_encode_video( p_enc, NULL )) != NULL )
+            SegmentOutput( p_segs, p_seg, p_block );
+        SegmentCloseEncoder( p_enc );
+    }
+
+    vlc_mutex_lock( &p_segs->lock );
+    p_seg->b_done = true;
+    assert( p_segs->i_pending > 0 );
+    p_segs->i_pending--;
+    vlc_cond_broadcast( &p_segs->wait_done );
+    vlc_mutex_unlock( &p_segs->lock );
+}
+
+static void *SegmentThread( void *data )
+{
+    transcode_segments_t *p_segs = data;
+
+    vlc_mutex_lock( &p_segs->lock );
+    for( ;; )
+    {
+        segment_t *p_seg = p_segs->p_first;
+        while( p_seg != NULL && p_seg->b_assigned )
+            p_seg = p_seg->p_next;
+
+        if( p_seg == NULL )
+        {
+            if( p_segs->b_abort )
+                break;
+            vlc_cond_wait( &p_segs->wait_work, &p_segs->lock );
+            continue;
+        }
+
+        p_seg->b_assigned = true;
+        vlc_mutex_unlock( &p_segs->lock );
+        SegmentEncode( p_segs, p_seg );
+        vlc_mutex_lock( &p_segs->lock );
+    }
+    vlc_mutex_unlock( &p_segs->lock );
+    return NULL;
+}
+
+/* Mean absolute difference of the (first plane) samples of two pictures */
+static unsigned PictureDiff( const picture_t *a, const picture_t *b )
+{
+    const plane_t *pa = &a->p[0], *pb = &b->p[0];
+    int i_lines = __MIN( pa->i_visible_lines, pb->i_visible_lines );
+    int i_pitch = __MIN( pa->i_visible_pitch, pb->i_visible_pitch );
+    uint64_t i_sum = 0, i_count = 0;
+
+    for( int y = 0; y < i_lines; y += SCENE_CUT_STEP )
+    {
+        const uint8_t *la = &pa->p_pixels[y * pa->i_pitch];
+        const uint8_t *lb = &pb->p_pixels[y * pb->i_pitch];
+
+        for( int x = 0; x < i_pitch; x += SCENE_CUT_STEP )
+            i_sum += abs( la[x] - lb[x] );
+        i_count += ( i_pitch + SCENE_CUT_STEP - 1 ) / SCENE_CUT_STEP;
+    }
+    return i_count ? i_sum / i_count : 0;
+}
+
+/* Whether to start a new segment with this picture */
+static bool SegmentCut( transcode_segments_t *p_segs, picture_t *p_pic )
+{
+    const segment_t *p_seg = p_segs->p_current;
+
+    if( p_seg == NULL || p_seg->i_frames >= p_segs->i_length )
+        return true;
+
+    /* Cut early at a scene change, where the encoder would have inserted a
+     * key frame anyway, but keep the segments long enough to scale. */
+    if( p_seg->i_frames >= p_segs->i_length / 2 && p_segs->p_prev != NULL
+     && PictureDiff( p_segs->p_prev, p_pic ) >= SCENE_CUT_THRESHOLD )
+    {
+        p_segs->i_scene_cuts++;
+        return true;
+    }
+    return false;
+}
+
+static void SegmentClose( transcode_segments_t *p_segs )
+{
+    if( p_segs->p_current == NULL )
+        return;
+
+    vlc_mutex_lock( &p_segs->lock );
+    p_segs->p_current->b_closed = true;
+    p_segs->p_current = NULL;
+    vlc_cond_broadcast( &p_segs->wait_work );
+    vlc_mutex_unlock( &p_segs->lock );
+}
+
+static int SegmentStart( transcode_segments_t *p_segs,
+                         const encoder_t *p_tmpl )
+{
+    segment_t *p_seg = malloc( sizeof( *p_seg ) );
+    if( unlikely(p_seg == NULL) )
+        return VLC_ENOMEM;
+    p_seg->pi_dates = malloc( p_segs->i_length * sizeof( *p_seg->pi_dates ) );
+    if( unlikely(p_seg->pi_dates == NULL) )
+    {
+        free( p_seg );
+        return VLC_ENOMEM;
+    }
+
+    p_seg->p_next = NULL;
+    p_seg->i_index = p_segs->i_segments++;
+    es_format_Copy( &p_seg->fmt_in, &p_tmpl->fmt_in );
+    es_format_Copy( &p_seg->fmt_out, &p_tmpl->fmt_out );
+    p_seg->p_pics = NULL;
+    p_seg->pp_pics_last = &p_seg->p_pics;
+    p_seg->i_frames = 0;
+    p_seg->i_stamped = 0;
+    p_seg->p_blocks = NULL;
+    p_seg->pp_blocks_last = &p_seg->p_blocks;
+    p_seg->b_assigned = false;
+    p_seg->b_closed = false;
+    p_seg->b_done = false;
+
+    /* Bound the decoded pictures in memory to one segment per worker */
+    vlc_mutex_lock( &p_segs->lock );
+    while( p_segs->i_pending >= p_segs->i_workers )
+        vlc_cond_wait( &p_segs->wait_done, &p_segs->lock );
+
+    *p_segs->pp_last = p_seg;
+    p_segs->pp_last = &p_seg->p_next;
+    p_segs->p_current = p_seg;
+    p_segs->i_pending++;
+    vlc_cond_broadcast( &p_segs->wait_work );
+    vlc_mutex_unlock( &p_segs->lock );
+    return VLC_SUCCESS;
+}
+
+transcode_segments_t *transcode_segments_new( sout_stream_t *p_stream,
+                                              const encoder_t *p_enc,
+                                              unsigned i_workers,
+                                              unsigned i_length )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    transcode_segments_t *p_segs =
+        malloc( sizeof( *p_segs ) + i_workers * sizeof( vlc_thread_t ) );
+    if( unlikely(p_segs == NULL) )
+        return NULL;
+
+    p_segs->p_stream = p_stream;
+    p_segs->psz_venc = p_sys->psz_venc;
+    p_segs->p_cfg = p_sys->p_video_cfg;
+    p_segs->p_fmt_ref = &p_enc->fmt_out;
+    /* Share the CPUs between the instances */
+    p_segs->i_threads = __MAX( 1, vlc_GetCPUCount() / i_workers );
+    /* Each instance holds up to one segment of decoded pictures */
+    p_segs->i_length = __MAX( __MIN( i_length,
+                                     SEGMENT_MAX_PICTURES / i_workers ), 2 );
+    if( p_segs->i_length < i_length )
+        msg_Dbg( p_stream, "segments shortened to %u frames to buffer %u "
+                 "pictures at most", p_segs->i_length, SEGMENT_MAX_PICTURES );
+
+    vlc_mutex_init( &p_segs->lock );
+    vlc_cond_init( &p_segs->wait_work );
+    vlc_cond_init( &p_segs->wait_done );
+    p_segs->p_first = NULL;
+    p_segs->pp_last = &p_segs->p_first;
+    p_segs->p_current = NULL;
+    p_segs->i_pending = 0;
+    p_segs->b_abort = false;
+    p_segs->b_warned = false;
+    p_segs->b_warned_delay = false;
+    p_segs->p_prev = NULL;
+    p_segs->i_delay = -1;
+    p_segs->i_last_dts = VLC_TS_INVALID;
+    p_segs->i_segments = 0;
+    p_segs->i_scene_cuts = 0;
+    p_segs->i_frames = 0;
+
+    for( p_segs->i_workers = 0; p_segs->i_workers < i_workers;
+         p_segs->i_workers++ )
+        if( vlc_clone( &p_segs->threads[p_segs->i_workers], SegmentThread,
+                       p_segs, VLC_THREAD_PRIORITY_LOW ) )
+            break;
+
+    if( p_segs->i_workers == 0 )
+    {
+        msg_Err( p_stream, "cannot spawn segment encoder threads" );
+        vlc_cond_destroy( &p_segs->wait_done );
+        vlc_cond_destroy( &p_segs->wait_work );
+        vlc_mutex_destroy( &p_segs->lock );
+        free( p_segs );
+        return NULL;
+    }
+
+    msg_Dbg( p_stream, "segmented encoding: %u instances of %u threads, "
+             "up to %u frames per segment", p_segs->i_workers,
+             p_segs->i_threads, p_segs->i_length );
+    return p_segs;
+}
+
+void transcode_segments_push( transcode_segments_t *p_segs,
+                              const encoder_t *p_enc, picture_t *p_pic )
+{
+    if( SegmentCut( p_segs, p_pic ) )
+    {
+        SegmentClose( p_segs );
+        if( SegmentStart( p_segs, p_enc ) )
+        {
+            picture_Release( p_pic );
+            return;
+        }
+    }
+
+    if( p_segs->p_prev != NULL )
+        picture_Release( p_segs->p_prev );
+    p_segs->p_prev = picture_Hold( p_pic );
+    p_segs->i_frames++;
+
+    segment_t *p_seg = p_segs->p_current;
+
+    vlc_mutex_lock( &p_segs->lock );
+    *p_seg->pp_pics_last = p_pic;
+    p_seg->pp_pics_last = &p_pic->p_next;
+    p_seg->pi_dates[p_seg->i_frames++] = p_pic->date;
+    vlc_cond_broadcast( &p_segs->wait_work );
+    vlc_mutex_unlock( &p_segs->lock );
+}
+
+/* Maximum delay of the presentation after the decoding of the packets of
+ * a segment, if each packet is decoded at the date of the picture in the
+ * same position in display order. Called with the lock held. */
+static mtime_t SegmentDelay( const segment_t *p_seg )
+{
+    mtime_t i_delay = 0;
+    unsigned i = 0;
+
+    for( const block_t *p_block = p_seg->p_blocks;
+         p_block != NULL && i < p_seg->i_frames; p_block = p_block->p_next, i++ )
+        if( p_block->i_pts > VLC_TS_INVALID
+         && p_seg->pi_dates[i] - p_block->i_pts > i_delay )
+            i_delay = p_seg->pi_dates[i] - p_block->i_pts;
+    return i_delay;
+}
+
+/* Each instance restarts its own decoding timestamps. They are replaced
+ * with the dates of the pictures, in display order, all delayed by the same
+ * reordering delay: they increase across the segments, and the presentation
+ * timestamps are left as they are. Called with the lock held. */
+static void SegmentStamp( transcode_segments_t *p_segs, segment_t *p_seg,
+                          block_t *p_block )
+{
+    for( ; p_block != NULL; p_block = p_block->p_next )
+    {
+        /* More packets than pictures: right after the previous one */
+        if( p_seg->i_stamped < p_seg->i_frames )
+            p_block->i_dts = p_seg->pi_dates[p_seg->i_stamped++]
+                           - p_segs->i_delay;
+        else
+            p_block->i_dts = p_segs->i_last_dts + 1;
+        p_segs->i_last_dts = p_block->i_dts;
+
+        if( p_block->i_pts > VLC_TS_INVALID && p_block->i_dts > p_block->i_pts
+         && !p_segs->b_warned_delay )
+        {
+            msg_Warn( p_segs->p_stream, "segment %u reorders more than the "
+                      "first one", p_seg->i_index );
+            p_segs->b_warned_delay = true;
+        }
+    }
+}
+
+block_t *transcode_segments_pull( transcode_segments_t *p_segs )
+{
+    block_t *p_out = NULL, **pp_out = &p_out;
+
+    vlc_mutex_lock( &p_segs->lock );
+    /* The delay is that of the first segment, output once it is known */
+    if( p_segs->i_delay < 0 )
+    {
+        if( p_segs->p_first == NULL || !p_segs->p_first->b_done )
+        {
+            vlc_mutex_unlock( &p_segs->lock );
+            return NULL;
+        }
+        p_segs->i_delay = SegmentDelay( p_segs->p_first );
+        msg_Dbg( p_segs->p_stream, "segmented encoding: reordering delay of "
+                 "%"PRId64" us", p_segs->i_delay );
+    }
+
+    for( segment_t *p_seg = p_segs->p_first; p_seg != NULL; )
+    {
+        if( p_seg->p_blocks != NULL )
+        {
+            SegmentStamp( p_segs, p_seg, p_seg->p_blocks );
+            block_ChainLastAppend( &pp_out, p_seg->p_blocks );
+            p_seg->p_blocks = NULL;
+            p_seg->pp_blocks_last = &p_seg->p_blocks;
+        }
+
+        if( !p_seg->b_done )
+            break;
+
+        segment_t *p_next = p_seg->p_next;
+        p_segs->p_first = p_next;
+        if( p_next == NULL )
+            p_segs->pp_last = &p_segs->p_first;
+        SegmentDelete( p_seg );
+        p_seg = p_next;
+    }
+    vlc_mutex_unlock( &p_segs->lock );
+    return p_out;
+}
+
+block_t *transcode_segments_drain( transcode_segments_t *p_segs )
+{
+    SegmentClose( p_segs );
+
+    vlc_mutex_lock( &p_segs->lock );
+    while( p_segs->i_pending > 0 )
+        vlc_cond_wait( &p_segs->wait_done, &p_segs->lock );
+    vlc_mutex_unlock( &p_segs->lock );
+
+    return transcode_segments_pull( p_segs );
+}
+
+void transcode_segments_delete( transcode_segments_t *p_segs )
+{
+    SegmentClose( p_segs );
+
+    vlc_mutex_lock( &p_segs->lock );
+    p_segs->b_abort = true;
+    vlc_cond_broadcast( &p_segs->wait_work );
+    vlc_mutex_unlock( &p_segs->lock );
+
+    for( unsigned i = 0; i < p_segs->i_workers; i++ )
+        vlc_join( p_segs->threads[i], NULL );
+
+    while( p_segs->p_first != NULL )
+    {
+        segment_t *p_seg = p_segs->p_first;
+        p_segs->p_first = p_seg->p_next;
+        SegmentDelete( p_seg );
+    }
+    if( p_segs->p_prev != NULL )
+        picture_Release( p_segs->p_prev );
+
+    msg_Dbg( p_segs->p_stream, "segmented encoding: %u frames in %u "
+             "segments, %u cut at scene changes", p_segs->i_frames,
+             p_segs->i_segments, p_segs->i_scene_cuts );
+
+    vlc_cond_destroy( &p_segs->wait_done );
+    vlc_cond_destroy( &p_segs->wait_work );
+    vlc_mutex_destroy( &p_segs->lock );
+    free( p_segs );
+}
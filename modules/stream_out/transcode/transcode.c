@@ -130,6 +130,15 @@
 #define POOL_TEXT N_("Picture pool size")
 #define POOL_LONGTEXT N_( "Defines how many pictures we allow to be in pool "\
     "between decoder/encoder threads when threads > 0" )
+#define SEGMENTS_TEXT N_("Parallel video segments")
+#define SEGMENTS_LONGTEXT N_( \
+    "In offline mode, splits the video into closed-GOP segments, encoded " \
+    "concurrently by this many encoder instances (0 disables)." )
+#define SEGMENT_LENGTH_TEXT N_("Video segment length")
+#define SEGMENT_LENGTH_LONGTEXT N_( \
+    "Maximum number of frames per video segment. Segments are cut earlier " \
+    "at scene changes, once they reach half this length. It is reduced so " \
+    "that at most 1024 decoded pictures are buffered for all the instances." )
 
 
 static const char *const ppsz_deinterlace_type[] =
@@ -215,6 +224,12 @@ vlc_module_begin ()
         change_integer_range( 1, 1000 )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
+    add_integer( SOUT_CFG_PREFIX "segments", 0, SEGMENTS_TEXT,
+                 SEGMENTS_LONGTEXT, true )
+        change_integer_range( 0, 256 )
+    add_integer( SOUT_CFG_PREFIX "segment-length", 250, SEGMENT_LENGTH_TEXT,
+                 SEGMENT_LENGTH_LONGTEXT, true )
+        change_integer_range( 2, 100000 )
 
 vlc_module_end ()
 
@@ -224,6 +239,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
+    "segments", "segment-length",
     NULL
 };
 
@@ -369,6 +385,25 @@ static int Open( vlc_object_t *p_this )
     p_sys->pool_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "pool-size" );
     p_sys->b_high_priority = var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" );
 
+    p_sys->i_segments = var_GetInteger( p_stream, SOUT_CFG_PREFIX "segments" );
+    p_sys->i_segment_length = var_GetInteger( p_stream,
+                                              SOUT_CFG_PREFIX "segment-length" );
+    if( p_sys->i_segments > 0 )
+    {
+        /* Segments add latency and buffer many pictures: batch jobs only */
+        if( !var_InheritBool( p_stream, "sout-offline" ) )
+        {
+            msg_Warn( p_stream, "segmented encoding needs offline mode, "
+                      "ignoring" );
+            p_sys->i_segments = 0;
+        }
+        else if( p_sys->i_threads > 0 )
+        {
+            msg_Dbg( p_stream, "no encoder thread with segmented encoding" );
+            p_sys->i_threads = 0;
+        }
+    }
+
     if( p_sys->i_vcodec )
     {
         msg_Dbg( p_stream, "codec video=%4.4s %dx%d scaling: %f %dkb/s",
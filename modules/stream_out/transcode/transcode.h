@@ -10,6 +10,7 @@
 #include <vlc_codec.h>
 
 #include <vlc_picture_fifo.h>
+#include <vlc_picture_pool.h>
 
 /*100ms is around the limit where people are noticing lipsync issues*/
 #define MASTER_SYNC_MAX_DRIFT 100000
@@ -51,6 +52,8 @@ struct sout_stream_sys_t
     bool            b_high_priority;
     bool            b_hurry_up;
     unsigned int    fps_num,fps_den;
+    unsigned int    i_segments;       /* parallel encoder instances */
+    unsigned int    i_segment_length; /* maximum frames per segment */
 
     char            *psz_vf2;
 
@@ -107,6 +110,13 @@ struct sout_stream_id_sys_t
              filter_chain_t  *p_f_chain; /**< Video filters */
              filter_chain_t  *p_uf_chain; /**< User-specified video filters */
              video_format_t  fmt_input_video;
+
+             /* Decoded pictures, sized for the decoder references, the
+              * encoder queue and the encoder lookahead */
+             picture_pool_t  *p_dec_pool;
+             video_format_t  dec_pool_fmt;
+             unsigned        i_dec_pool_misses; /**< Pictures allocated
+                                                     outside the pool */
          };
          struct
          {
@@ -118,6 +128,7 @@ struct sout_stream_id_sys_t
 
     /* Encoder */
     encoder_t       *p_encoder;
+    struct transcode_segments_t *p_segments; /**< Segmented video encoding */
 
     /* Sync */
     date_t          next_input_pts; /**< Incoming calculated PTS */
@@ -147,3 +158,17 @@ int  transcode_video_process( sout_stream_t *, sout_stream_id_sys_t *,
                                      block_t *, block_t ** );
 bool transcode_video_add    ( sout_stream_t *, const es_format_t *,
                                 sout_stream_id_sys_t *);
+
+/* Segmented video encoding */
+
+typedef struct transcode_segments_t transcode_segments_t;
+
+transcode_segments_t *transcode_segments_new( sout_stream_t *,
+                                              const encoder_t *,
+                                              unsigned i_workers,
+                                              unsigned i_length );
+void     transcode_segments_delete( transcode_segments_t * );
+void     transcode_segments_push  ( transcode_segments_t *, const encoder_t *,
+                                    picture_t * );
+block_t *transcode_segments_pull  ( transcode_segments_t * );
+block_t *transcode_segments_drain ( transcode_segments_t * );
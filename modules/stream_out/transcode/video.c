@@ -80,8 +80,52 @@ static int video_update_format_decoder( decoder_t *p_dec )
     return chain_works;
 }
 
+static unsigned video_dec_pool_size( sout_stream_t *p_stream,
+                                     sout_stream_id_sys_t *id )
+{
+    /* Pictures referenced by the decoder, as in the video output case */
+    unsigned i_size = decoder_GetPoolSize( id->p_decoder );
+
+    /* Pictures waiting for the encoder thread */
+    if( p_stream->p_sys->i_threads >= 1 )
+        i_size += p_stream->p_sys->pool_size;
+
+    /* Pictures kept by the encoder after encoding them */
+    return i_size + __MAX( id->p_encoder->i_lookahead, 0 );
+}
+
 static picture_t *video_new_buffer_decoder( decoder_t *p_dec )
 {
+    sout_stream_t        *p_stream = (sout_stream_t*) p_dec->p_owner;
+    sout_stream_id_sys_t *id       = p_dec->p_queue_ctx;
+    picture_t            *p_pic;
+
+    if( id->p_dec_pool == NULL ||
+        !video_format_IsSimilar( &id->dec_pool_fmt, &p_dec->fmt_out.video ) )
+    {
+        /* Pictures still in flight keep the old pool alive */
+        if( id->p_dec_pool != NULL )
+            picture_pool_Release( id->p_dec_pool );
+
+        unsigned i_size = video_dec_pool_size( p_stream, id );
+        id->p_dec_pool = picture_pool_NewFromFormat( &p_dec->fmt_out.video,
+                                                     i_size );
+        if( id->p_dec_pool == NULL )
+            return NULL;
+        video_format_Clean( &id->dec_pool_fmt );
+        video_format_Copy( &id->dec_pool_fmt, &p_dec->fmt_out.video );
+        msg_Dbg( p_stream, "decoder picture pool: %u pictures of %ux%u %4.4s",
+                 i_size, p_dec->fmt_out.video.i_width,
+                 p_dec->fmt_out.video.i_height,
+                 (const char *)&p_dec->fmt_out.video.i_chroma );
+    }
+
+    p_pic = picture_pool_Get( id->p_dec_pool );
+    if( p_pic != NULL )
+        return p_pic;
+
+    /* The decoder must never wait for the encoder: allocate one more */
+    id->i_dec_pool_misses++;
     return picture_NewFromFormat( &p_dec->fmt_out.video );
 }
 
@@ -154,6 +198,9 @@ static void* EncoderThread( void *obj )
 static int decoder_queue_video( decoder_t *p_dec, picture_t *p_pic )
 {
     sout_stream_id_sys_t *id = p_dec->p_queue_ctx;
+    sout_stream_t *p_stream = (sout_stream_t *)p_dec->p_owner;
+
+    var_IncInteger( p_stream->p_sout, "sout-decoded-video" );
 
     vlc_mutex_lock(&id->fifo.lock);
     *id->fifo.pic.last = p_pic;
@@ -642,6 +689,15 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
         return VLC_EGENERIC;
     }
 
+    if( p_sys->i_segments > 0 )
+    {
+        id->p_segments = transcode_segments_new( p_stream, id->p_encoder,
+                                                 p_sys->i_segments,
+                                                 p_sys->i_segment_length );
+        if( id->p_segments == NULL )
+            msg_Warn( p_stream, "encoding without segments" );
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -672,8 +728,21 @@ void transcode_video_close( sout_stream_t *p_stream,
         module_unneed( id->p_decoder, id->p_decoder->p_module );
     if( id->p_decoder->p_description )
         vlc_meta_Delete( id->p_decoder->p_description );
+    if( id->p_dec_pool )
+    {
+        msg_Dbg( p_stream, "decoder picture pool: %u pictures, %u misses",
+                 picture_pool_GetSize( id->p_dec_pool ), id->i_dec_pool_misses );
+        picture_pool_Release( id->p_dec_pool );
+        id->p_dec_pool = NULL;
+    }
+    video_format_Clean( &id->dec_pool_fmt );
 
     /* Close encoder */
+    if( id->p_segments )
+    {
+        transcode_segments_delete( id->p_segments );
+        id->p_segments = NULL;
+    }
     if( id->p_encoder->p_module )
         module_unneed( id->p_encoder, id->p_encoder->p_module );
 
@@ -730,6 +799,13 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
         }
     }
 
+    if( id->p_segments )
+    {
+        transcode_segments_push( id->p_segments, id->p_encoder, p_pic );
+        block_ChainAppend( out, transcode_segments_pull( id->p_segments ) );
+        return;
+    }
+
     if( p_sys->i_threads == 0 )
     {
         block_t *p_block;
@@ -876,7 +952,10 @@ end:
     {
         if( p_sys->i_threads == 0 )
         {
-            if( id->p_encoder->p_module )
+            if( id->p_segments )
+                block_ChainAppend( out,
+                                   transcode_segments_drain( id->p_segments ) );
+            else if( id->p_encoder->p_module )
             {
                 block_t *p_block;
                 do {
@@ -130,57 +130,80 @@ int RenderBob( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic,
  * RenderLinear: BOB with linear interpolation
  *****************************************************************************/
 
-int RenderLinear( filter_t *p_filter,
-                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+typedef struct
 {
-    VLC_UNUSED(p_filter);
-    VLC_UNUSED(order);
-    int i_plane;
+    filter_t *p_filter;
+    picture_t *p_outpic;
+    const picture_t *p_pic;
+    int i_field;
+} linear_slice_t;
+
+/* Renders the line pairs of one band of each plane */
+static void LinearSlice( void *opaque, unsigned i_slice, unsigned i_slices )
+{
+    const linear_slice_t *sl = opaque;
+    filter_t *p_filter = sl->p_filter; /* for Merge() */
+    const int i_field = sl->i_field;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < sl->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        const int i_in_pitch = sl->p_pic->p[i_plane].i_pitch;
+        const int i_out_pitch = sl->p_outpic->p[i_plane].i_pitch;
+        const int i_lines = sl->p_outpic->p[i_plane].i_visible_lines;
+
+        /* Each pair starts with a line of the kept field, followed by
+           the line interpolated from it and the next one. The last
+           two lines are copied. */
+        const int i_pairs = i_lines - 2 > i_field
+                          ? (i_lines - 2 - i_field + 1) / 2 : 0;
+        int i_start, i_end;
+        SliceRange( 0, i_pairs, i_slice, i_slices, &i_start, &i_end );
+
+        const int i_line = 2 * i_start + i_field;
+        uint8_t *p_in = &sl->p_pic->p[i_plane].p_pixels[i_line * i_in_pitch];
+        uint8_t *p_out = &sl->p_outpic->p[i_plane].p_pixels[i_line * i_out_pitch];
 
         /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
+        if( i_field == 1 && i_slice == 0 )
+            memcpy( p_out - i_out_pitch, p_in - i_in_pitch, i_in_pitch );
 
-        for( ; p_out < p_out_end ; )
+        for( int i = i_start; i < i_end; i++ )
         {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+            memcpy( p_out, p_in, i_in_pitch );
 
-            p_out += p_outpic->p[i_plane].i_pitch;
+            p_out += i_out_pitch;
 
-            Merge( p_out, p_in, p_in + 2 * p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
+            Merge( p_out, p_in, p_in + 2 * i_in_pitch, i_in_pitch );
 
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
+            p_in += 2 * i_in_pitch;
+            p_out += i_out_pitch;
         }
 
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
+        if( i_slice == i_slices - 1 )
         {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+            memcpy( p_out, p_in, i_in_pitch );
+
+            /* For TOP field we need to add the last line */
+            if( i_field == 0 )
+                memcpy( p_out + i_out_pitch, p_in + i_in_pitch, i_in_pitch );
         }
     }
     EndMerge();
+}
+
+int RenderLinear( filter_t *p_filter,
+                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+{
+    VLC_UNUSED(order);
+
+    linear_slice_t slice = {
+        .p_filter = p_filter,
+        .p_outpic = p_outpic,
+        .p_pic = p_pic,
+        .i_field = i_field,
+    };
+
+    RenderSlices( p_filter, LinearSlice, &slice );
     return VLC_SUCCESS;
 }
 
@@ -402,6 +402,61 @@ static void IVTCFrameInit( filter_t *p_filter )
  * @see RenderIVTC()
  * @see IVTCFrameInit()
  */
+typedef struct
+{
+    const picture_t *p_curr;
+    const picture_t *p_next;
+
+    vlc_mutex_t lock;
+    int pi_scores[IVTC_NUM_FIELD_PAIRS];
+    int i_motion;
+    int i_top;
+    int i_bot;
+} ivtc_detect_slice_t;
+
+/* Adds up the partial results of the slices, -1 meaning an error */
+static inline void IVTCAddPartial( int *pi_total, int i_partial )
+{
+    if( *pi_total < 0 || i_partial < 0 )
+        *pi_total = -1;
+    else
+        *pi_total += i_partial;
+}
+
+static void IVTCLowLevelDetectSlice( void *opaque, unsigned i_slice,
+                                     unsigned i_slices )
+{
+    ivtc_detect_slice_t *p_detect = opaque;
+    const picture_t *p_curr = p_detect->p_curr;
+    const picture_t *p_next = p_detect->p_next;
+
+    const int i_tnbn = CalculateInterlaceScoreSlice( p_next, p_next,
+                                                     i_slice, i_slices );
+    const int i_tnbc = CalculateInterlaceScoreSlice( p_next, p_curr,
+                                                     i_slice, i_slices );
+    const int i_tcbn = CalculateInterlaceScoreSlice( p_curr, p_next,
+                                                     i_slice, i_slices );
+    int i_top = 0, i_bot = 0;
+    const int i_motion = EstimateNumBlocksWithMotionSlice( p_curr, p_next,
+                                                           &i_top, &i_bot,
+                                                           i_slice, i_slices );
+
+    vlc_mutex_lock( &p_detect->lock );
+    IVTCAddPartial( &p_detect->pi_scores[FIELD_PAIR_TNBN], i_tnbn );
+    IVTCAddPartial( &p_detect->pi_scores[FIELD_PAIR_TNBC], i_tnbc );
+    IVTCAddPartial( &p_detect->pi_scores[FIELD_PAIR_TCBN], i_tcbn );
+    IVTCAddPartial( &p_detect->i_motion, i_motion );
+    /* Field motion is left at 0 for incompatible pictures */
+    if( p_detect->i_motion >= 0 )
+    {
+        p_detect->i_top += i_top;
+        p_detect->i_bot += i_bot;
+    }
+    else
+        p_detect->i_top = p_detect->i_bot = 0;
+    vlc_mutex_unlock( &p_detect->lock );
+}
+
 static void IVTCLowLevelDetect( filter_t *p_filter )
 {
     assert( p_filter != NULL );
@@ -416,16 +471,22 @@ static void IVTCLowLevelDetect( filter_t *p_filter )
 
     /* Compute interlace scores for TNBN, TNBC and TCBN.
         Note that p_next contains TNBN. */
-    p_ivtc->pi_scores[FIELD_PAIR_TNBN] = CalculateInterlaceScore( p_next,
-                                                                  p_next );
-    p_ivtc->pi_scores[FIELD_PAIR_TNBC] = CalculateInterlaceScore( p_next,
-                                                                  p_curr );
-    p_ivtc->pi_scores[FIELD_PAIR_TCBN] = CalculateInterlaceScore( p_curr,
-                                                                  p_next );
+    ivtc_detect_slice_t detect = {
+        .p_curr = p_curr,
+        .p_next = p_next,
+    };
+    vlc_mutex_init( &detect.lock );
 
-    int i_top = 0, i_bot = 0;
-    int i_motion = EstimateNumBlocksWithMotion(p_curr, p_next, &i_top, &i_bot);
-    p_ivtc->pi_motion[IVTC_LATEST] = i_motion;
+    RenderSlices( p_filter, IVTCLowLevelDetectSlice, &detect );
+
+    vlc_mutex_destroy( &detect.lock );
+
+    p_ivtc->pi_scores[FIELD_PAIR_TNBN] = detect.pi_scores[FIELD_PAIR_TNBN];
+    p_ivtc->pi_scores[FIELD_PAIR_TNBC] = detect.pi_scores[FIELD_PAIR_TNBC];
+    p_ivtc->pi_scores[FIELD_PAIR_TCBN] = detect.pi_scores[FIELD_PAIR_TCBN];
+
+    int i_top = detect.i_top, i_bot = detect.i_bot;
+    p_ivtc->pi_motion[IVTC_LATEST] = detect.i_motion;
 
     /* If one field changes "clearly more" than the other, we know the
        less changed one is a likely duplicate.
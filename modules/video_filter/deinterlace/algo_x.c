@@ -512,9 +512,18 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
  * Public functions
  *****************************************************************************/
 
-int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+typedef struct
+{
+    picture_t *p_outpic;
+    const picture_t *p_pic;
+} x_slice_t;
+
+/* Renders the block rows of one band of each plane */
+static void XSlice( void *opaque, unsigned i_slice, unsigned i_slices )
 {
-    VLC_UNUSED(p_filter);
+    const x_slice_t *sl = opaque;
+    picture_t *p_outpic = sl->p_outpic;
+    const picture_t *p_pic = sl->p_pic;
     int i_plane;
 #if defined (CAN_COMPILE_MMXEXT)
     const bool mmxext = vlc_CPU_MMXEXT();
@@ -532,9 +541,11 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         const int i_dst = p_outpic->p[i_plane].i_pitch;
         const int i_src = p_pic->p[i_plane].i_pitch;
 
-        int y, x;
+        int y, x, i_start, i_end;
 
-        for( y = 0; y < i_mby; y++ )
+        SliceRange( 0, i_mby, i_slice, i_slices, &i_start, &i_end );
+
+        for( y = i_start; y < i_end; y++ )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -548,10 +559,10 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         }
 
         /* Last line (C only)*/
-        if( i_mody )
+        if( i_mody && i_slice == i_slices - 1 )
         {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
+            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*i_mby*i_dst];
+            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*i_mby*i_src];
 
             for( x = 0; x < i_mbx; x++ )
             {
@@ -570,5 +581,15 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
     if( mmxext )
         emms();
 #endif
+}
+
+int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    x_slice_t slice = {
+        .p_outpic = p_outpic,
+        .p_pic = p_pic,
+    };
+
+    RenderSlices( p_filter, XSlice, &slice );
     return VLC_SUCCESS;
 }
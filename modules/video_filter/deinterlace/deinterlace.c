@@ -86,6 +86,12 @@
                                     "Best simulation, but requires more CPU "\
                                     "and memory bandwidth.")
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Maximum number of threads rendering each " \
+                            "picture in horizontal bands, for the Linear, " \
+                            "X, Yadif and IVTC modes " \
+                            "(0 = automatic, 1 = no threading).")
+
 #define PHOSPHOR_DIMMER_TEXT N_("Phosphor old field dimmer strength")
 #define PHOSPHOR_DIMMER_LONGTEXT N_("This controls the strength of the "\
                                     "darkening filter that simulates CRT TV "\
@@ -112,6 +118,9 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT, true )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_integer( FILTER_CFG_PREFIX "threads", 0, THREADS_TEXT,
+                 THREADS_LONGTEXT, true )
+        change_integer_range( 0, 64 )
     add_shortcut( "deinterlace" )
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -127,7 +136,7 @@ vlc_module_end ()
  * and reading logic for them implemented in Open().
  */
 static const char *const ppsz_filter_options[] = {
-    "mode", "phosphor-chroma", "phosphor-dimmer",
+    "mode", "phosphor-chroma", "phosphor-dimmer", "threads",
     NULL
 };
 
@@ -327,6 +336,9 @@ notsupp:
 
     IVTCClearState( p_filter );
 
+    SlicesInit( p_filter, var_GetInteger( p_filter,
+                                          FILTER_CFG_PREFIX "threads" ) );
+
 #if defined(CAN_COMPILE_C_ALTIVEC)
     if( pixel_size == 1 && vlc_CPU_ALTIVEC() )
         p_sys->pf_merge = MergeAltivec;
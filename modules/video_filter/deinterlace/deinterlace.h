@@ -35,6 +35,7 @@ struct vlc_object_t;
 
 #include <vlc_common.h>
 #include <vlc_mouse.h>
+#include <vlc_threadpool.h>
 
 /* Local algorithm headers */
 #include "algo_basic.h"
@@ -43,6 +44,7 @@ struct vlc_object_t;
 #include "algo_phosphor.h"
 #include "algo_ivtc.h"
 #include "common.h"
+#include "slices.h"
 
 /*****************************************************************************
  * Local data
@@ -78,6 +80,10 @@ struct filter_sys_t
 
     struct deinterlace_ctx   context;
 
+    /** Band-parallel rendering (see slices.h) */
+    vlc_threadpool_t *p_pool;
+    unsigned          i_slices;
+
     /* Algorithm-specific substructures */
     union {
         phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
@@ -383,6 +383,16 @@ void ComposeFrame( filter_t *p_filter,
 int EstimateNumBlocksWithMotion( const picture_t* p_prev,
                                  const picture_t* p_curr,
                                  int *pi_top, int *pi_bot)
+{
+    return EstimateNumBlocksWithMotionSlice( p_prev, p_curr, pi_top, pi_bot,
+                                             0, 1 );
+}
+
+/* See header for function doc. */
+int EstimateNumBlocksWithMotionSlice( const picture_t* p_prev,
+                                      const picture_t* p_curr,
+                                      int *pi_top, int *pi_bot,
+                                      unsigned i_slice, unsigned i_slices )
 {
     assert( p_prev != NULL );
     assert( p_curr != NULL );
@@ -419,7 +429,10 @@ int EstimateNumBlocksWithMotion( const picture_t* p_prev,
                              p_curr->p[i_plane].i_visible_pitch );
         const int i_mbx = w / 8;
 
-        for( int by = 0; by < i_mby; ++by )
+        int i_start, i_end;
+        SliceRange( 0, i_mby, i_slice, i_slices, &i_start, &i_end );
+
+        for( int by = i_start; by < i_end; ++by )
         {
             uint8_t *p_pix_p = &p_prev->p[i_plane].p_pixels[i_pitch_prev*8*by];
             uint8_t *p_pix_c = &p_curr->p[i_plane].p_pixels[i_pitch_curr*8*by];
@@ -453,7 +466,8 @@ int EstimateNumBlocksWithMotion( const picture_t* p_prev,
 #ifdef CAN_COMPILE_MMXEXT
 VLC_MMX
 static int CalculateInterlaceScoreMMX( const picture_t* p_pic_top,
-                                       const picture_t* p_pic_bot )
+                                       const picture_t* p_pic_bot,
+                                       unsigned i_slice, unsigned i_slices )
 {
     assert( p_pic_top->i_planes == p_pic_bot->i_planes );
 
@@ -477,9 +491,12 @@ static int CalculateInterlaceScoreMMX( const picture_t* p_pic_top,
         const int wm8 = w % 8;   /* remainder */
         const int w8  = w - wm8; /* part of width that is divisible by 8 */
 
+        int i_start, i_end;
+        SliceRange( 1, i_lasty, i_slice, i_slices, &i_start, &i_end );
+
         /* Current line / neighbouring lines picture pointers */
-        const picture_t *cur = p_pic_bot;
-        const picture_t *ngh = p_pic_top;
+        const picture_t *cur = (i_start & 1) ? p_pic_bot : p_pic_top;
+        const picture_t *ngh = (i_start & 1) ? p_pic_top : p_pic_bot;
         int wc = cur->p[i_plane].i_pitch;
         int wn = ngh->p[i_plane].i_pitch;
 
@@ -487,7 +504,7 @@ static int CalculateInterlaceScoreMMX( const picture_t* p_pic_top,
            works better for anime, which may contain horizontal,
            one pixel thick cartoon outlines.
         */
-        for( int y = 1; y < i_lasty; ++y )
+        for( int y = i_start; y < i_end; ++y )
         {
             uint8_t *p_c = &cur->p[i_plane].p_pixels[y*wc];     /* this line */
             uint8_t *p_p = &ngh->p[i_plane].p_pixels[(y-1)*wn]; /* prev line */
@@ -589,6 +606,14 @@ static int CalculateInterlaceScoreMMX( const picture_t* p_pic_top,
 /* See header for function doc. */
 int CalculateInterlaceScore( const picture_t* p_pic_top,
                              const picture_t* p_pic_bot )
+{
+    return CalculateInterlaceScoreSlice( p_pic_top, p_pic_bot, 0, 1 );
+}
+
+/* See header for function doc. */
+int CalculateInterlaceScoreSlice( const picture_t* p_pic_top,
+                                  const picture_t* p_pic_bot,
+                                  unsigned i_slice, unsigned i_slices )
 {
     /*
         We use the comb metric from the IVTC filter of Transcode 1.1.5.
@@ -608,7 +633,8 @@ int CalculateInterlaceScore( const picture_t* p_pic_top,
 
 #ifdef CAN_COMPILE_MMXEXT
     if (vlc_CPU_MMXEXT())
-        return CalculateInterlaceScoreMMX( p_pic_top, p_pic_bot );
+        return CalculateInterlaceScoreMMX( p_pic_top, p_pic_bot,
+                                           i_slice, i_slices );
 #endif
 
     int32_t i_score = 0;
@@ -624,9 +650,12 @@ int CalculateInterlaceScore( const picture_t* p_pic_top,
         const int w = FFMIN( p_pic_top->p[i_plane].i_visible_pitch,
                              p_pic_bot->p[i_plane].i_visible_pitch );
 
+        int i_start, i_end;
+        SliceRange( 1, i_lasty, i_slice, i_slices, &i_start, &i_end );
+
         /* Current line / neighbouring lines picture pointers */
-        const picture_t *cur = p_pic_bot;
-        const picture_t *ngh = p_pic_top;
+        const picture_t *cur = (i_start & 1) ? p_pic_bot : p_pic_top;
+        const picture_t *ngh = (i_start & 1) ? p_pic_top : p_pic_bot;
         int wc = cur->p[i_plane].i_pitch;
         int wn = ngh->p[i_plane].i_pitch;
 
@@ -634,7 +663,7 @@ int CalculateInterlaceScore( const picture_t* p_pic_top,
            works better for anime, which may contain horizontal,
            one pixel thick cartoon outlines.
         */
-        for( int y = 1; y < i_lasty; ++y )
+        for( int y = i_start; y < i_end; ++y )
         {
             uint8_t *p_c = &cur->p[i_plane].p_pixels[y*wc];     /* this line */
             uint8_t *p_p = &ngh->p[i_plane].p_pixels[(y-1)*wn]; /* prev line */
@@ -134,6 +134,19 @@ int EstimateNumBlocksWithMotion( const picture_t* p_prev,
                                  const picture_t* p_curr,
                                  int *pi_top, int *pi_bot);
 
+/**
+ * Same as EstimateNumBlocksWithMotion(), on one horizontal band of
+ * block rows of each plane. The results of all the bands add up to
+ * the result for the whole picture.
+ *
+ * @see EstimateNumBlocksWithMotion()
+ * @see SliceRange()
+ */
+int EstimateNumBlocksWithMotionSlice( const picture_t* p_prev,
+                                      const picture_t* p_curr,
+                                      int *pi_top, int *pi_bot,
+                                      unsigned i_slice, unsigned i_slices );
+
 /**
  * Helper function: estimates "how much interlaced" the given field pair is.
  *
@@ -166,4 +179,16 @@ int EstimateNumBlocksWithMotion( const picture_t* p_prev,
 int CalculateInterlaceScore( const picture_t* p_pic_top,
                              const picture_t* p_pic_bot );
 
+/**
+ * Same as CalculateInterlaceScore(), on one horizontal band of lines of
+ * each plane. The scores of all the bands add up to the score of the
+ * whole picture.
+ *
+ * @see CalculateInterlaceScore()
+ * @see SliceRange()
+ */
+int CalculateInterlaceScoreSlice( const picture_t* p_pic_top,
+                                  const picture_t* p_pic_bot,
+                                  unsigned i_slice, unsigned i_slices );
+
 #endif
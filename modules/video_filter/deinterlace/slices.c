@@ -0,0 +1,79 @@
+/*****************************************************************************
+ * slices.c : Band-parallel rendering for the VLC deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_interrupt.h>
+#include <vlc_threadpool.h>
+
+#include "deinterlace.h"
+#include "slices.h"
+
+void SlicesInit( filter_t *p_filter, int i_threads )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    p_sys->p_pool = NULL;
+    p_sys->i_slices = 1;
+
+    /* Do not bother with too thin bands */
+    unsigned i_slices = p_filter->fmt_in.video.i_visible_height / SLICE_MIN_LINES;
+    if( i_threads == 1 || i_slices <= 1 )
+        return;
+
+    vlc_threadpool_t *p_pool = vlc_threadpool_Get( p_filter );
+    if( p_pool == NULL )
+        return;
+
+    /* vlc_threadpool_Run() cannot fail for up to 64 tasks */
+    const unsigned i_max = __MIN( vlc_threadpool_GetSize( p_pool ), 64 );
+    if( i_threads <= 0 || (unsigned)i_threads > i_max )
+        i_threads = i_max;
+    if( i_slices > (unsigned)i_threads )
+        i_slices = i_threads;
+
+    if( i_slices > 1 )
+    {
+        p_sys->p_pool = p_pool;
+        p_sys->i_slices = i_slices;
+    }
+    msg_Dbg( p_filter, "rendering in %u slice(s)", p_sys->i_slices );
+}
+
+void RenderSlices( filter_t *p_filter, slice_render_t pf_render, void *opaque )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_pool != NULL )
+    {
+        /* Never leave bands unrendered, even if the calling thread
+         * (e.g. a transcoding input thread) gets interrupted */
+        vlc_interrupt_t *p_ctx = vlc_interrupt_set( NULL );
+        vlc_threadpool_Run( p_sys->p_pool, p_sys->i_slices, pf_render, opaque,
+                            VLC_THREADPOOL_PRIORITY_HIGH );
+        vlc_interrupt_set( p_ctx );
+    }
+    else
+        pf_render( opaque, 0, 1 );
+}
@@ -0,0 +1,81 @@
+/*****************************************************************************
+ * slices.h : Band-parallel rendering for the VLC deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEINTERLACE_SLICES_H
+#define VLC_DEINTERLACE_SLICES_H 1
+
+/**
+ * \file
+ * Band-parallel rendering for the VLC deinterlacer.
+ *
+ * The algorithms split their pictures into horizontal bands ("slices"),
+ * which are rendered concurrently on the LibVLC thread pool.
+ *
+ * A slice only writes its own lines, and reductions (IVTC detectors) are
+ * integer sums, so that the output does not depend on the slice count.
+ */
+
+/* Forward declarations */
+struct filter_t;
+
+/** Smallest band height worth dispatching to another thread */
+#define SLICE_MIN_LINES 32
+
+/**
+ * Renders one band out of i_slices.
+ *
+ * @param opaque Algorithm-specific data
+ * @param i_slice Band index, from 0 to i_slices - 1
+ * @param i_slices Number of bands
+ */
+typedef void (*slice_render_t)( void *opaque, unsigned i_slice,
+                                unsigned i_slices );
+
+/**
+ * Sets up band-parallel rendering for a filter instance.
+ *
+ * @param i_threads Maximum number of threads rendering a picture,
+ *                  0 for as many as the thread pool has
+ */
+void SlicesInit( struct filter_t *p_filter, int i_threads );
+
+/**
+ * Renders all the bands of a picture, in parallel if enabled.
+ *
+ * pf_render may be called from any thread, concurrently for
+ * different slices.
+ */
+void RenderSlices( struct filter_t *p_filter, slice_render_t pf_render,
+                   void *opaque );
+
+/**
+ * Computes the [start, end) range of a band within [i_begin, i_end).
+ */
+static inline void SliceRange( int i_begin, int i_end,
+                               unsigned i_slice, unsigned i_slices,
+                               int *pi_start, int *pi_end )
+{
+    const int i_count = i_end > i_begin ? i_end - i_begin : 0;
+
+    *pi_start = i_begin + (int)( (int64_t)i_count * i_slice / i_slices );
+    *pi_end   = i_begin + (int)( (int64_t)i_count * (i_slice + 1) / i_slices );
+}
+
+#endif
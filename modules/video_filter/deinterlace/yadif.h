@@ -33,10 +33,10 @@
 typedef intptr_t x86_reg;
 typedef struct { uint64_t a, b; } xmm_reg;
 
-const ATTR_USED alignas (16) xmm_reg pb_1 = {
+static const ATTR_USED alignas (16) xmm_reg pb_1 = {
     0x0101010101010101ULL, 0x0101010101010101ULL
 };
-const ATTR_USED alignas (16) xmm_reg pw_1 = {
+static const ATTR_USED alignas (16) xmm_reg pw_1 = {
     0x0001000100010001ULL, 0x0001000100010001ULL
 };
 
@@ -147,3 +147,110 @@ static void yadif_filter_line_c_16bit(uint16_t *dst, uint16_t *prev, uint16_t *c
     prefs /= 2;
     FILTER
 }
+
+#ifdef HAVE_AVX2_INTRINSICS
+// ================= AVX2 =================
+/* Same computations as FILTER, on 16 pixels widened to 16 bits at once.
+   All the intermediate values fit in int16_t, so this is bit-exact. */
+#include <immintrin.h>
+#define HAVE_YADIF_AVX2
+
+#define LOAD16(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define ABSDIFF16(a, b) _mm256_abs_epi16(_mm256_sub_epi16(a, b))
+#define AVG16(a, b) _mm256_srli_epi16(_mm256_add_epi16(a, b), 1)
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i yadif_check_avx2(const uint8_t *cur, int prefs, int mrefs, int j, __m256i *pred)
+{
+    *pred = AVG16(LOAD16(&cur[mrefs+j]), LOAD16(&cur[prefs-j]));
+    return _mm256_add_epi16(_mm256_add_epi16(
+               ABSDIFF16(LOAD16(&cur[mrefs-1+j]), LOAD16(&cur[prefs-1-j])),
+               ABSDIFF16(LOAD16(&cur[mrefs  +j]), LOAD16(&cur[prefs  -j]))),
+               ABSDIFF16(LOAD16(&cur[mrefs+1+j]), LOAD16(&cur[prefs+1-j])));
+}
+
+/* Takes the score and prediction of a CHECK(j) where the score is lower,
+   and only where "mask" is set. Returns where it did. */
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i yadif_update_avx2(const uint8_t *cur, int prefs, int mrefs, int j,
+                                        __m256i mask, __m256i *spatial_score,
+                                        __m256i *spatial_pred)
+{
+    __m256i pred;
+    __m256i score = yadif_check_avx2(cur, prefs, mrefs, j, &pred);
+    mask = _mm256_and_si256(mask, _mm256_cmpgt_epi16(*spatial_score, score));
+    *spatial_score = _mm256_blendv_epi8(*spatial_score, score, mask);
+    *spatial_pred = _mm256_blendv_epi8(*spatial_pred, pred, mask);
+    return mask;
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void yadif_filter_line_avx2(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int prefs, int mrefs, int parity, int mode) {
+    uint8_t *prev2= parity ? prev : cur ;
+    uint8_t *next2= parity ? cur  : next;
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i all = _mm256_cmpeq_epi16(ones, ones);
+    int x;
+
+    for (x = 0; x + 16 <= w; x += 16) {
+        __m256i c = LOAD16(&cur[x+mrefs]);
+        __m256i e = LOAD16(&cur[x+prefs]);
+        __m256i p2 = LOAD16(&prev2[x]);
+        __m256i n2 = LOAD16(&next2[x]);
+        __m256i d = AVG16(p2, n2);
+        __m256i temporal_diff0 = ABSDIFF16(p2, n2);
+        __m256i temporal_diff1 = _mm256_srli_epi16(_mm256_add_epi16(
+                                     ABSDIFF16(LOAD16(&prev[x+mrefs]), c),
+                                     ABSDIFF16(LOAD16(&prev[x+prefs]), e)), 1);
+        __m256i temporal_diff2 = _mm256_srli_epi16(_mm256_add_epi16(
+                                     ABSDIFF16(LOAD16(&next[x+mrefs]), c),
+                                     ABSDIFF16(LOAD16(&next[x+prefs]), e)), 1);
+        __m256i diff = _mm256_max_epi16(_mm256_max_epi16(
+                           _mm256_srli_epi16(temporal_diff0, 1), temporal_diff1),
+                           temporal_diff2);
+        __m256i spatial_pred = AVG16(c, e);
+        __m256i spatial_score = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(
+                                    ABSDIFF16(LOAD16(&cur[x+mrefs-1]), LOAD16(&cur[x+prefs-1])),
+                                    ABSDIFF16(c, e)),
+                                    ABSDIFF16(LOAD16(&cur[x+mrefs+1]), LOAD16(&cur[x+prefs+1]))),
+                                    ones);
+        __m256i mask;
+
+        /* CHECK(-1) CHECK(-2), then CHECK(1) CHECK(2) */
+        mask = yadif_update_avx2(&cur[x], prefs, mrefs, -1, all, &spatial_score, &spatial_pred);
+        yadif_update_avx2(&cur[x], prefs, mrefs, -2, mask, &spatial_score, &spatial_pred);
+        mask = yadif_update_avx2(&cur[x], prefs, mrefs, 1, all, &spatial_score, &spatial_pred);
+        yadif_update_avx2(&cur[x], prefs, mrefs, 2, mask, &spatial_score, &spatial_pred);
+
+        if (mode < 2) {
+            __m256i b = AVG16(LOAD16(&prev2[x+2*mrefs]), LOAD16(&next2[x+2*mrefs]));
+            __m256i f = AVG16(LOAD16(&prev2[x+2*prefs]), LOAD16(&next2[x+2*prefs]));
+            __m256i de = _mm256_sub_epi16(d, e);
+            __m256i dc = _mm256_sub_epi16(d, c);
+            __m256i bc = _mm256_sub_epi16(b, c);
+            __m256i fe = _mm256_sub_epi16(f, e);
+            __m256i max = _mm256_max_epi16(_mm256_max_epi16(de, dc), _mm256_min_epi16(bc, fe));
+            __m256i min = _mm256_min_epi16(_mm256_min_epi16(de, dc), _mm256_max_epi16(bc, fe));
+
+            diff = _mm256_max_epi16(_mm256_max_epi16(diff, min),
+                                    _mm256_sub_epi16(_mm256_setzero_si256(), max));
+        }
+
+        /* diff is never negative, so this is the same as the C branches */
+        spatial_pred = _mm256_min_epi16(_mm256_max_epi16(spatial_pred, _mm256_sub_epi16(d, diff)),
+                                        _mm256_add_epi16(d, diff));
+
+        _mm_storeu_si128((__m128i *)&dst[x],
+                         _mm_packus_epi16(_mm256_castsi256_si128(spatial_pred),
+                                          _mm256_extracti128_si256(spatial_pred, 1)));
+    }
+
+    if (x < w)
+        yadif_filter_line_c(&dst[x], &prev[x], &cur[x], &next[x], w - x,
+                            prefs, mrefs, parity, mode);
+}
+
+#undef AVG16
+#undef ABSDIFF16
+#undef LOAD16
+#endif
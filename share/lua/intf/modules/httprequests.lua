@@ -366,6 +366,126 @@ playlisttable = function ()
     return parseplaylist(basePlaylist)
 end
 
+--the journal records the changes from the core, see events.json
+local journal = nil
+
+getjournal = function ()
+    if not journal then
+        journal = vlc.playlist.journal()
+    end
+    return journal
+end
+
+--a page of the playlist leaves, with the journal sequence number to follow
+--the changes from
+playlistpagetable = function ()
+    local offset = math.max(tonumber(_GET["offset"]) or 0, 0)
+    local count = math.max(tonumber(_GET["count"]) or 100, 0)
+    local seq = getjournal():seq()
+    local page = vlc.playlist.page(offset, count)
+
+    local result={}
+    result.seq=seq
+    result.total=page.total
+    result.offset=offset
+    result.children={}
+    result.children._array={}
+
+    for _, item in ipairs(page.items) do
+        table.insert(result.children._array,parseplaylist(item))
+    end
+
+    return result
+end
+
+--status fields which change all the time while playing: they are sent with
+--every reply, but they are not journaled, so that the changes of an idle
+--player are empty
+local volatilestatus = { time=true, position=true }
+
+--sequence number of the last change of each status field
+local statusseen = {}
+
+local getstatuschanges = function (s, since)
+    local j = getjournal()
+    local changes = {}
+
+    for k, v in pairs(s) do
+        if not volatilestatus[k] then
+            local value = v
+            if type(v) == "table" then
+                value = dkjson.encode(v)
+            end
+            local seen = statusseen[k]
+            if not seen or seen.value ~= value then
+                seen = { value = value, seq = j:mark() }
+                statusseen[k] = seen
+            end
+            if seen.seq > since then
+                changes[k] = v
+            end
+        end
+    end
+
+    --fields that went away (no input, no video output...)
+    for k, seen in pairs(statusseen) do
+        if s[k] == nil then
+            if seen.value ~= dkjson.null then
+                seen.value = dkjson.null
+                seen.seq = j:mark()
+            end
+            if seen.seq > since then
+                changes[k] = dkjson.null
+            end
+        end
+    end
+
+    return changes
+end
+
+--what changed since the sequence number given by the client: the status
+--fields and the playlist items. If the changes are not all known anymore,
+--reset is set and the status is complete: the playlist must be reloaded.
+geteventstable = function ()
+    local j = getjournal()
+    local since = tonumber(_GET["since"]) or 0
+
+    local result={}
+    local s = getstatus(false)
+    local status = getstatuschanges(s, since)
+    local seq, changes = j:since(since)
+
+    result.seq=seq
+    for k in pairs(volatilestatus) do
+        result[k]=s[k]
+    end
+    if since == 0 or not changes then
+        result.reset=true
+        result.status=getstatuschanges(s, 0)
+        return result
+    end
+
+    result.status=status
+    result.playlist={}
+    result.playlist._array={}
+
+    for _, c in ipairs(changes) do
+        local e={}
+        e.seq=c.seq
+        e["type"]=c.type
+        e.id=tostring(c.id)
+        if c.parent then
+            e.parent=tostring(c.parent)
+        end
+        if c.item then
+            e.item=parseplaylist(c.item)
+        end
+        table.insert(result.playlist._array,e)
+    end
+
+    return result
+end
+
 getbrowsetable = function ()
 
     local dir = nil
@@ -42,6 +42,7 @@
 #include <vlc_spu.h>
 #include <vlc_meta.h>
 #include <vlc_dialog.h>
+#include <vlc_interrupt.h>
 #include <vlc_modules.h>
 
 #include "audio_output/aout_internal.h"
@@ -97,6 +98,23 @@ struct decoder_owner_sys_t
     /* fifo */
     block_fifo_t *p_fifo;
 
+    /* fifo budget and statistics (protected by the fifo lock) */
+    struct
+    {
+        size_t   i_max_bytes;    /* 0 if unlimited */
+        mtime_t  i_max_duration; /* 0 if unlimited */
+        int      i_policy;
+        mtime_t  i_in_ts;        /* latest queued timestamp */
+        mtime_t  i_out_ts;       /* latest dequeued timestamp */
+
+        size_t   i_hw_bytes;     /* high-water marks */
+        mtime_t  i_hw_duration;
+        size_t   i_hw_count;
+        unsigned i_stalls;       /* blocking back-pressure */
+        mtime_t  i_stalled;
+        uint64_t i_dropped;      /* bytes */
+    } budget;
+
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
     vlc_cond_t  wait_request;
@@ -126,6 +144,7 @@ struct decoder_owner_sys_t
 
     /* Flushing */
     bool flushing;
+    bool aborting; /* being deleted, nothing dequeues anymore */
     bool b_draining;
     atomic_bool drained;
     bool b_idle;
@@ -147,6 +166,14 @@ struct decoder_owner_sys_t
  * a bogus PTS and won't be displayed */
 #define DECODER_BOGUS_VIDEO_DELAY                ((mtime_t)(DEFAULT_PTS_DELAY * 30))
 
+/* Decoder fifo budget policies */
+enum
+{
+    DECODER_FIFO_DROP,  /* reset the fifo */
+    DECODER_FIFO_BLOCK, /* block the demuxer */
+    DECODER_FIFO_DELAY, /* postpone demuxing (and reset at twice the budget) */
+};
+
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
@@ -488,28 +515,9 @@ static int vout_update_format( decoder_t *p_dec )
         p_owner->p_vout = NULL;
         vlc_mutex_unlock( &p_owner->lock );
 
-        unsigned dpb_size;
-        switch( p_dec->fmt_in.i_codec )
-        {
-        case VLC_CODEC_HEVC:
-        case VLC_CODEC_H264:
-        case VLC_CODEC_DIRAC: /* FIXME valid ? */
-            dpb_size = 18;
-            break;
-        case VLC_CODEC_VP5:
-        case VLC_CODEC_VP6:
-        case VLC_CODEC_VP6F:
-        case VLC_CODEC_VP8:
-            dpb_size = 3;
-            break;
-        default:
-            dpb_size = 2;
-            break;
-        }
         p_vout = input_resource_RequestVout( p_owner->p_resource,
                                              p_vout, &fmt,
-                                             dpb_size +
-                                             p_dec->i_extra_picture_buffers + 1,
+                                             decoder_GetPoolSize( p_dec ),
                                              true );
         vlc_mutex_lock( &p_owner->lock );
         p_owner->p_vout = p_vout;
@@ -771,7 +779,13 @@ static void DecoderFixTs( decoder_t *p_dec, mtime_t *pi_ts0, mtime_t *pi_ts1,
     const mtime_t i_es_delay = p_owner->i_ts_delay;
 
     if( !p_clock )
+    {   /* Offline: keep the stream timestamps */
+        if( *pi_ts0 > VLC_TS_INVALID )
+            *pi_ts0 += i_es_delay;
+        if( pi_ts1 && *pi_ts1 > VLC_TS_INVALID )
+            *pi_ts1 += i_es_delay;
         return;
+    }
 
     const bool b_ephemere = pi_ts1 && *pi_ts0 == *pi_ts1;
     int i_rate;
@@ -815,7 +829,6 @@ static int DecoderPlaySout( decoder_t *p_dec, block_t *p_sout_block )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-    assert( p_owner->p_clock );
     assert( !p_sout_block->p_next );
 
     vlc_mutex_lock( &p_owner->lock );
@@ -832,6 +845,11 @@ static int DecoderPlaySout( decoder_t *p_dec, block_t *p_sout_block )
 
     vlc_mutex_unlock( &p_owner->lock );
 
+    if( p_owner->p_input != NULL && p_owner->fmt.i_cat == VIDEO_ES
+     && input_priv(p_owner->p_input)->b_out_offline )
+        atomic_fetch_add( &input_priv(p_owner->p_input)->i_out_offline_frames,
+                          1 );
+
     /* FIXME --VLC_TS_INVALID inspect stream_output*/
     return sout_InputSendBuffer( p_owner->p_sout_input, p_sout_block );
 }
@@ -1580,7 +1598,14 @@ static void *DecoderThread( void *p_data )
         vlc_testcancel(); /* forced expedited cancellation in case of stop */
 
         block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
-        if( p_block == NULL )
+        if( p_block != NULL )
+        {
+            const mtime_t i_ts = p_block->i_dts > VLC_TS_INVALID
+                               ? p_block->i_dts : p_block->i_pts;
+            if( i_ts > VLC_TS_INVALID )
+                p_owner->budget.i_out_ts = i_ts;
+        }
+        else
         {
             if( likely(!p_owner->b_draining) )
             {   /* Wait for a block to decode (or a request to drain) */
@@ -1676,6 +1701,7 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->error = false;
 
     p_owner->flushing = false;
+    p_owner->aborting = false;
     p_owner->b_draining = false;
     p_owner->drained = false;
     atomic_init( &p_owner->reload, RELOAD_NO_REQUEST );
@@ -1692,6 +1718,14 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         return NULL;
     }
 
+    memset( &p_owner->budget, 0, sizeof( p_owner->budget ) );
+    p_owner->budget.i_max_bytes =
+        __MAX( var_InheritInteger( p_dec, "decoder-fifo-size" ), 0 ) * 1024;
+    p_owner->budget.i_max_duration =
+        __MAX( var_InheritInteger( p_dec, "decoder-fifo-duration" ), 0 ) * 1000;
+    p_owner->budget.i_policy = var_InheritInteger( p_dec, "decoder-fifo-policy" );
+    p_owner->budget.i_in_ts = p_owner->budget.i_out_ts = VLC_TS_INVALID;
+
     vlc_mutex_init( &p_owner->lock );
     vlc_cond_init( &p_owner->wait_request );
     vlc_cond_init( &p_owner->wait_acknowledge );
@@ -1799,6 +1833,13 @@ static void DeleteDecoder( decoder_t * p_dec )
     const bool b_flush_spu = p_dec->fmt_out.i_cat == SPU_ES;
     UnloadDecoder( p_dec );
 
+    msg_Dbg( p_dec, "fifo high-water mark: %zu KiB, %zu blocks, %"PRId64" ms; "
+             "blocked %u times (%"PRId64" ms), dropped %"PRIu64" KiB",
+             p_owner->budget.i_hw_bytes / 1024, p_owner->budget.i_hw_count,
+             p_owner->budget.i_hw_duration / 1000, p_owner->budget.i_stalls,
+             p_owner->budget.i_stalled / 1000,
+             p_owner->budget.i_dropped / 1024 );
+
     /* Free all packets still in the decoder fifo. */
     block_FifoRelease( p_owner->p_fifo );
 
@@ -1968,9 +2009,11 @@ void input_DecoderDelete( decoder_t *p_dec )
     vlc_cancel( p_owner->thread );
 
     vlc_fifo_Lock( p_owner->p_fifo );
-    /* Signal DecoderTimedWait */
+    /* Signal DecoderTimedWait and DecoderFifoWait */
     p_owner->flushing = true;
+    p_owner->aborting = true;
     vlc_cond_signal( &p_owner->wait_timed );
+    vlc_cond_signal( &p_owner->wait_fifo );
     vlc_fifo_Unlock( p_owner->p_fifo );
 
     /* Make sure we aren't waiting/decoding anymore */
@@ -2002,40 +2045,155 @@ void input_DecoderDelete( decoder_t *p_dec )
     DeleteDecoder( p_dec );
 }
 
+static mtime_t DecoderFifoDuration( const decoder_owner_sys_t *p_owner )
+{
+    if( p_owner->budget.i_in_ts <= VLC_TS_INVALID
+     || p_owner->budget.i_out_ts <= VLC_TS_INVALID )
+        return 0;
+    return __MAX( p_owner->budget.i_in_ts - p_owner->budget.i_out_ts, 0 );
+}
+
+/* Checks the fifo against a multiple of its budget (fifo locked) */
+static bool DecoderFifoIsOver( decoder_owner_sys_t *p_owner, unsigned i_scale )
+{
+    if( p_owner->budget.i_max_bytes > 0
+     && vlc_fifo_GetBytes( p_owner->p_fifo )
+            > p_owner->budget.i_max_bytes * i_scale )
+        return true;
+    return p_owner->budget.i_max_duration > 0
+        && DecoderFifoDuration( p_owner )
+            > p_owner->budget.i_max_duration * i_scale;
+}
+
+static void DecoderFifoQueue( decoder_owner_sys_t *p_owner, block_t *p_block )
+{
+    for( block_t *p = p_block; p != NULL; p = p->p_next )
+    {
+        const mtime_t i_ts = p->i_dts > VLC_TS_INVALID ? p->i_dts : p->i_pts;
+
+        if( p->i_flags & BLOCK_FLAG_DISCONTINUITY )
+            p_owner->budget.i_out_ts = VLC_TS_INVALID;
+        if( i_ts > VLC_TS_INVALID )
+            p_owner->budget.i_in_ts = i_ts;
+    }
+
+    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+
+    const size_t i_bytes = vlc_fifo_GetBytes( p_owner->p_fifo );
+    const size_t i_count = vlc_fifo_GetCount( p_owner->p_fifo );
+    const mtime_t i_duration = DecoderFifoDuration( p_owner );
+
+    if( i_bytes > p_owner->budget.i_hw_bytes )
+        p_owner->budget.i_hw_bytes = i_bytes;
+    if( i_count > p_owner->budget.i_hw_count )
+        p_owner->budget.i_hw_count = i_count;
+    if( i_duration > p_owner->budget.i_hw_duration )
+        p_owner->budget.i_hw_duration = i_duration;
+}
+
+static void DecoderFifoReset( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
+              "consumed quickly enough), resetting fifo!" );
+    p_owner->budget.i_dropped += vlc_fifo_GetBytes( p_owner->p_fifo );
+    block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    p_owner->budget.i_in_ts = p_owner->budget.i_out_ts = VLC_TS_INVALID;
+}
+
+/* Wakes DecoderFifoWait up when the input thread is interrupted */
+static void DecoderFifoWake( void *data )
+{
+    decoder_owner_sys_t *p_owner = data;
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    vlc_cond_signal( &p_owner->wait_fifo );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
+/* The decoder thread does not consume the fifo when waiting nor when paused,
+ * and does not need to once flushed or deleted (fifo locked) */
+static bool DecoderFifoCanWait( decoder_owner_sys_t *p_owner )
+{
+    return !p_owner->b_waiting && !p_owner->paused && !p_owner->flushing
+        && !p_owner->aborting && !vlc_killed();
+}
+
+static bool DecoderFifoIsFull( decoder_owner_sys_t *p_owner,
+                               size_t i_max_count )
+{
+    return vlc_fifo_GetCount( p_owner->p_fifo ) >= i_max_count
+        || DecoderFifoIsOver( p_owner, 1 );
+}
+
+/* Blocks until the decoder thread consumed enough data, or until it stops
+ * consuming it: pause, wait, flush, deletion or interruption of the calling
+ * thread (fifo locked) */
+static void DecoderFifoWait( decoder_owner_sys_t *p_owner, size_t i_max_count )
+{
+    if( !DecoderFifoIsFull( p_owner, i_max_count )
+     || !DecoderFifoCanWait( p_owner ) )
+        return;
+
+    const mtime_t i_start = mdate();
+    bool b_stalled = false;
+
+    /* The interrupt callback locks the fifo: register it unlocked */
+    vlc_fifo_Unlock( p_owner->p_fifo );
+    vlc_interrupt_register( DecoderFifoWake, p_owner );
+    vlc_fifo_Lock( p_owner->p_fifo );
+
+    while( DecoderFifoIsFull( p_owner, i_max_count )
+        && DecoderFifoCanWait( p_owner ) )
+    {
+        if( DecoderFifoIsOver( p_owner, 1 ) )
+            b_stalled = true;
+        vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
+    }
+
+    vlc_fifo_Unlock( p_owner->p_fifo );
+    vlc_interrupt_unregister();
+    vlc_fifo_Lock( p_owner->p_fifo );
+
+    if( b_stalled )
+    {
+        p_owner->budget.i_stalls++;
+        p_owner->budget.i_stalled += mdate() - i_start;
+    }
+}
+
 /**
  * Put a block_t in the decoder's fifo.
  * Thread-safe w.r.t. the decoder. May be a cancellation point.
  *
  * \param p_dec the decoder object
- * \param p_block the data block
+ * \param p_block the data block, or a chain of blocks queued at once (the
+ * fifo is locked and the decoder thread woken up only once)
  */
 void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
     vlc_fifo_Lock( p_owner->p_fifo );
+    /* The FIFO is not consumed when waiting nor when paused, so pacing would
+     * deadlock VLC. Locking is not necessary for b_waiting as it is only
+     * read, not written by the decoder thread. */
+    const bool b_can_block = !p_owner->b_waiting && !p_owner->paused;
+
     if( !b_do_pace )
     {
-        /* FIXME: ideally we would check the time amount of data
-         * in the FIFO instead of its size. */
-        /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
-        {
-            msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
-                      "consumed quickly enough), resetting fifo!" );
-            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
-        }
+        if( p_owner->budget.i_policy == DECODER_FIFO_BLOCK && b_can_block )
+            DecoderFifoWait( p_owner, SIZE_MAX );
+        else if( DecoderFifoIsOver( p_owner,
+                     p_owner->budget.i_policy == DECODER_FIFO_DELAY ? 2 : 1 ) )
+            DecoderFifoReset( p_dec );
     }
     else
     if( !p_owner->b_waiting )
-    {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
-         * Locking is not necessary as b_waiting is only read, not written by
-         * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
-            vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
-    }
+        DecoderFifoWait( p_owner, 10 );
 
-    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+    DecoderFifoQueue( p_owner, p_block );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2072,6 +2230,19 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
     return b_empty;
 }
 
+bool input_DecoderIsFull( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->budget.i_policy != DECODER_FIFO_DELAY || p_owner->b_waiting )
+        return false;
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    const bool b_full = !p_owner->paused && DecoderFifoIsOver( p_owner, 1 );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+    return b_full;
+}
+
 /**
  * Signals that there are no further blocks to decode, and requests that the
  * decoder drain all pending buffers. This is used to ensure that all
@@ -2102,6 +2273,7 @@ void input_DecoderFlush( decoder_t *p_dec )
 
     /* Empty the fifo */
     block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    p_owner->budget.i_in_ts = p_owner->budget.i_out_ts = VLC_TS_INVALID;
 
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
@@ -2117,6 +2289,7 @@ void input_DecoderFlush( decoder_t *p_dec )
 
     vlc_fifo_Signal( p_owner->p_fifo );
     vlc_cond_signal( &p_owner->wait_timed );
+    vlc_cond_signal( &p_owner->wait_fifo );
 
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
@@ -2211,6 +2384,7 @@ void input_DecoderChangePause( decoder_t *p_dec, bool b_paused, mtime_t i_date )
     p_owner->pause_date = i_date;
     p_owner->frames_countdown = 0;
     vlc_fifo_Signal( p_owner->p_fifo );
+    vlc_cond_signal( &p_owner->wait_fifo );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
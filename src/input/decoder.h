@@ -63,6 +63,12 @@ void input_DecoderStopWait( decoder_t * );
  */
 bool input_DecoderIsEmpty( decoder_t * );
 
+/**
+ * This function returns true if the decoder fifo exceeds its budget and
+ * demuxing should be postponed (--decoder-fifo-policy=2 only).
+ */
+bool input_DecoderIsFull( decoder_t * );
+
 /**
  * This function activates the request closed caption channel.
  */
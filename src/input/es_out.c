@@ -71,6 +71,12 @@ typedef struct
     /* Clock for this program */
     input_clock_t *p_clock;
 
+    /* Offline: shift of the timestamps, so that they keep increasing
+     * across the stream discontinuities */
+    mtime_t i_offline_shift;
+    mtime_t i_offline_pcr;      /* last PCR, or VLC_TS_INVALID */
+    mtime_t i_offline_ts_max;   /* last shifted timestamp sent */
+
     vlc_meta_t *p_meta;
 } es_out_pgrm_t;
 
@@ -162,6 +168,7 @@ struct es_out_sys_t
 
     /* Used for buffering */
     bool        b_buffering;
+    bool        b_offline;  /* no clock, no buffering */
     mtime_t     i_buffering_extra_initial;
     mtime_t     i_buffering_extra_stream;
     mtime_t     i_buffering_extra_system;
@@ -385,11 +392,30 @@ static void EsOutTerminate( es_out_t *out )
     input_SendEventMetaEpg( p_sys->p_input );
 }
 
+static bool EsOutDecodersIsFull( es_out_t *out )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    for( int i = 0; i < p_sys->i_es; i++ )
+    {
+        es_out_id_t *es = p_sys->es[i];
+
+        if( ( es->p_dec && input_DecoderIsFull( es->p_dec ) )
+         || ( es->p_dec_record && input_DecoderIsFull( es->p_dec_record ) ) )
+            return true;
+    }
+    return false;
+}
+
 static mtime_t EsOutGetWakeup( es_out_t *out )
 {
     es_out_sys_t   *p_sys = out->p_sys;
     input_thread_t *p_input = p_sys->p_input;
 
+    /* Give the decoders some time to drain their fifos */
+    if( EsOutDecodersIsFull( out ) )
+        return mdate() + INPUT_IDLE_SLEEP / 10;
+
     if( !p_sys->p_pgrm )
         return 0;
 
@@ -460,6 +486,57 @@ static void EsOutSetDelay( es_out_t *out, int i_cat, int64_t i_delay )
         EsOutDecoderChangeDelay( out, p_sys->es[i] );
 }
 
+/* In offline mode, decoders have no clock: the stream timestamps are kept */
+static input_clock_t *EsOutDecoderClock( es_out_t *out, es_out_id_t *p_es )
+{
+    if( out->p_sys->b_offline )
+        return NULL;
+    return p_es->p_pgrm->p_clock;
+}
+
+/* Without clock, the stream discontinuities are not absorbed by the clock
+ * reference: a PCR going back, or jumping too far (as the clock detects
+ * it), restarts the timestamps after the last ones sent */
+#define OFFLINE_MAX_GAP (60 * CLOCK_FREQ)
+#define OFFLINE_PTS_GAP (300 * 1000) /* as the clock reference restart */
+
+static void EsOutOfflineUpdatePcr( es_out_t *out, es_out_pgrm_t *p_pgrm,
+                                   mtime_t i_pcr )
+{
+    const mtime_t i_last = p_pgrm->i_offline_pcr;
+
+    p_pgrm->i_offline_pcr = i_pcr;
+    if( i_last <= VLC_TS_INVALID ||
+        ( i_pcr >= i_last - CLOCK_FREQ && i_pcr - i_last <= OFFLINE_MAX_GAP ) )
+        return;
+
+    const mtime_t i_from = __MAX( i_last + p_pgrm->i_offline_shift,
+                                  p_pgrm->i_offline_ts_max ) + OFFLINE_PTS_GAP;
+    p_pgrm->i_offline_shift = i_from - i_pcr;
+    msg_Warn( out->p_sys->p_input, "stream discontinuity (PCR %"PRId64
+              " after %"PRId64"), timestamps shifted by %"PRId64,
+              i_pcr, i_last, p_pgrm->i_offline_shift );
+}
+
+static void EsOutOfflineShift( es_out_pgrm_t *p_pgrm, block_t *p_block )
+{
+    for( block_t *p = p_block; p != NULL; p = p->p_next )
+    {
+        if( p->i_dts > VLC_TS_INVALID )
+        {
+            p->i_dts += p_pgrm->i_offline_shift;
+            p_pgrm->i_offline_ts_max = __MAX( p_pgrm->i_offline_ts_max,
+                                              p->i_dts );
+        }
+        if( p->i_pts > VLC_TS_INVALID )
+        {
+            p->i_pts += p_pgrm->i_offline_shift;
+            p_pgrm->i_offline_ts_max = __MAX( p_pgrm->i_offline_ts_max,
+                                              p->i_pts );
+        }
+    }
+}
+
 static int EsOutSetRecord(  es_out_t *out, bool b_record )
 {
     es_out_sys_t   *p_sys = out->p_sys;
@@ -512,7 +589,7 @@ static int EsOutSetRecord(  es_out_t *out, bool b_record )
             if( !p_es->p_dec || p_es->p_master )
                 continue;
 
-            p_es->p_dec_record = input_DecoderNew( p_input, &p_es->fmt, p_es->p_pgrm->p_clock, p_sys->p_sout_record );
+            p_es->p_dec_record = input_DecoderNew( p_input, &p_es->fmt, EsOutDecoderClock( out, p_es ), p_sys->p_sout_record );
             if( p_es->p_dec_record && p_sys->b_buffering )
                 input_DecoderStartWait( p_es->p_dec_record );
         }
@@ -589,6 +666,7 @@ static void EsOutChangeRate( es_out_t *out, int i_rate )
 static void EsOutChangePosition( es_out_t *out )
 {
     es_out_sys_t      *p_sys = out->p_sys;
+    const bool b_offline = p_sys->b_offline;
 
     input_SendEventCache( p_sys->p_input, 0.0 );
 
@@ -599,7 +677,7 @@ static void EsOutChangePosition( es_out_t *out )
         if( p_es->p_dec != NULL )
         {
             input_DecoderFlush( p_es->p_dec );
-            if( !p_sys->b_buffering )
+            if( !p_sys->b_buffering && !b_offline )
             {
                 input_DecoderStartWait( p_es->p_dec );
                 if( p_es->p_dec_record != NULL )
@@ -609,9 +687,14 @@ static void EsOutChangePosition( es_out_t *out )
     }
 
     for( int i = 0; i < p_sys->i_pgrm; i++ )
+    {
         input_clock_Reset( p_sys->pgrm[i]->p_clock );
+        /* a seek is not a discontinuity */
+        p_sys->pgrm[i]->i_offline_pcr = VLC_TS_INVALID;
+    }
 
-    p_sys->b_buffering = true;
+    /* Offline, nothing waits for the clock: there is no buffering */
+    p_sys->b_buffering = !b_offline;
     p_sys->i_buffering_extra_initial = 0;
     p_sys->i_buffering_extra_stream = 0;
     p_sys->i_buffering_extra_system = 0;
@@ -1085,6 +1168,9 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
     p_pgrm->b_selected = false;
     p_pgrm->b_scrambled = false;
     p_pgrm->p_meta = NULL;
+    p_pgrm->i_offline_shift = 0;
+    p_pgrm->i_offline_pcr = VLC_TS_INVALID;
+    p_pgrm->i_offline_ts_max = VLC_TS_INVALID;
     p_pgrm->p_clock = input_clock_New( p_sys->i_rate );
     if( !p_pgrm->p_clock )
     {
@@ -1675,7 +1761,7 @@ static void EsCreateDecoder( es_out_t *out, es_out_id_t *p_es )
     es_out_sys_t   *p_sys = out->p_sys;
     input_thread_t *p_input = p_sys->p_input;
 
-    p_es->p_dec = input_DecoderNew( p_input, &p_es->fmt, p_es->p_pgrm->p_clock, input_priv(p_input)->p_sout );
+    p_es->p_dec = input_DecoderNew( p_input, &p_es->fmt, EsOutDecoderClock( out, p_es ), input_priv(p_input)->p_sout );
     if( p_es->p_dec )
     {
         if( p_sys->b_buffering )
@@ -1683,7 +1769,7 @@ static void EsCreateDecoder( es_out_t *out, es_out_id_t *p_es )
 
         if( !p_es->p_master && p_sys->p_sout_record )
         {
-            p_es->p_dec_record = input_DecoderNew( p_input, &p_es->fmt, p_es->p_pgrm->p_clock, p_sys->p_sout_record );
+            p_es->p_dec_record = input_DecoderNew( p_input, &p_es->fmt, EsOutDecoderClock( out, p_es ), p_sys->p_sout_record );
             if( p_es->p_dec_record && p_sys->b_buffering )
                 input_DecoderStartWait( p_es->p_dec_record );
         }
@@ -1970,7 +2056,7 @@ static void EsOutSelect( es_out_t *out, es_out_id_t *es, bool b_force )
  *
  * \param out the es_out to send from
  * \param es the es_out_id
- * \param p_block the data block to send
+ * \param p_block the data block to send, or a chain of blocks of that es
  */
 static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
 {
@@ -1982,19 +2068,22 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
         uint64_t i_total;
 
         vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock );
-        stats_Update( input_priv(p_input)->counters.p_demux_read,
-                      p_block->i_buffer, &i_total );
-        stats_Update( input_priv(p_input)->counters.p_demux_bitrate, i_total, NULL );
-
-        /* Update number of corrupted data packats */
-        if( p_block->i_flags & BLOCK_FLAG_CORRUPTED )
-        {
-            stats_Update( input_priv(p_input)->counters.p_demux_corrupted, 1, NULL );
-        }
-        /* Update number of discontinuities */
-        if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
+        for( block_t *p = p_block; p != NULL; p = p->p_next )
         {
-            stats_Update( input_priv(p_input)->counters.p_demux_discontinuity, 1, NULL );
+            stats_Update( input_priv(p_input)->counters.p_demux_read,
+                          p->i_buffer, &i_total );
+            stats_Update( input_priv(p_input)->counters.p_demux_bitrate, i_total, NULL );
+
+            /* Update number of corrupted data packats */
+            if( p->i_flags & BLOCK_FLAG_CORRUPTED )
+            {
+                stats_Update( input_priv(p_input)->counters.p_demux_corrupted, 1, NULL );
+            }
+            /* Update number of discontinuities */
+            if( p->i_flags & BLOCK_FLAG_DISCONTINUITY )
+            {
+                stats_Update( input_priv(p_input)->counters.p_demux_discontinuity, 1, NULL );
+            }
         }
         vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
     }
@@ -2004,21 +2093,27 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     /* Mark preroll blocks */
     if( p_sys->i_preroll_end >= 0 )
     {
-        int64_t i_date = p_block->i_pts;
-        if( p_block->i_pts <= VLC_TS_INVALID )
-            i_date = p_block->i_dts;
+        for( block_t *p = p_block; p != NULL; p = p->p_next )
+        {
+            int64_t i_date = p->i_pts;
+            if( p->i_pts <= VLC_TS_INVALID )
+                i_date = p->i_dts;
 
-        if( i_date < p_sys->i_preroll_end )
-            p_block->i_flags |= BLOCK_FLAG_PREROLL;
+            if( i_date < p_sys->i_preroll_end )
+                p->i_flags |= BLOCK_FLAG_PREROLL;
+        }
     }
 
     if( !es->p_dec )
     {
-        block_Release( p_block );
+        block_ChainRelease( p_block );
         vlc_mutex_unlock( &p_sys->lock );
         return VLC_SUCCESS;
     }
 
+    if( p_sys->b_offline )
+        EsOutOfflineShift( es->p_pgrm, p_block );
+
     /* Check for sout mode */
     if( input_priv(p_input)->p_sout )
     {
@@ -2040,9 +2135,15 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     /* Decode */
     if( es->p_dec_record )
     {
-        block_t *p_dup = block_Duplicate( p_block );
-        if( p_dup )
-            input_DecoderDecode( es->p_dec_record, p_dup,
+        block_t *p_dups = NULL, **pp_last = &p_dups;
+        for( block_t *p = p_block; p != NULL; p = p->p_next )
+        {
+            block_t *p_dup = block_Duplicate( p );
+            if( p_dup )
+                block_ChainLastAppend( &pp_last, p_dup );
+        }
+        if( p_dups )
+            input_DecoderDecode( es->p_dec_record, p_dups,
                                  input_priv(p_input)->b_out_pace_control );
     }
     input_DecoderDecode( es->p_dec, p_block,
@@ -2412,6 +2513,9 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
             return VLC_EGENERIC;
         }
 
+        if( p_sys->b_offline )
+            EsOutOfflineUpdatePcr( out, p_pgrm, i_pcr );
+
         /* TODO do not use mdate() but proper stream acquisition date */
         bool b_late;
         input_clock_Update( p_pgrm->p_clock, VLC_OBJECT(p_sys->p_input),
@@ -2788,6 +2892,17 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         input_clock_ChangeSystemOrigin( p_pgrm->p_clock, b_absolute, i_system );
         return VLC_SUCCESS;
     }
+    case ES_OUT_SET_OFFLINE:
+    {
+        const bool b_offline = va_arg( args, int );
+
+        /* Only before the decoders are created, as they keep their clock */
+        assert( p_sys->i_es == 0 );
+        p_sys->b_offline = b_offline;
+        p_sys->b_buffering = !b_offline;
+        return VLC_SUCCESS;
+    }
+
     case ES_OUT_SET_EOS:
     {
         for (int i = 0; i < p_sys->i_es; i++) {
@@ -465,11 +465,24 @@ static int Send( es_out_t *p_out, es_out_id_t *p_es, block_t *p_block )
 
     TsAutoStop( p_out );
 
-    CmdInitSend( &cmd, p_es, p_block );
     if( p_sys->b_delayed )
-        TsPushCmd( p_sys->p_ts, &cmd );
+    {
+        /* The storage works block per block */
+        while( p_block )
+        {
+            block_t *p_next = p_block->p_next;
+
+            p_block->p_next = NULL;
+            CmdInitSend( &cmd, p_es, p_block );
+            TsPushCmd( p_sys->p_ts, &cmd );
+            p_block = p_next;
+        }
+    }
     else
+    {
+        CmdInitSend( &cmd, p_es, p_block );
         i_ret = CmdExecuteSend( p_sys->p_out, &cmd) ;
+    }
 
     vlc_mutex_unlock( &p_sys->lock );
 
@@ -1346,14 +1359,14 @@ static int CmdExecuteSend( es_out_t *p_out, ts_cmd_t *p_cmd )
     {
         if( p_cmd->u.send.p_es->p_es )
             return es_out_Send( p_out, p_cmd->u.send.p_es->p_es, p_block );
-        block_Release( p_block );
+        block_ChainRelease( p_block );
     }
     return VLC_EGENERIC;
 }
 static void CmdCleanSend( ts_cmd_t *p_cmd )
 {
     if( p_cmd->u.send.p_block )
-        block_Release( p_cmd->u.send.p_block );
+        block_ChainRelease( p_cmd->u.send.p_block );
 }
 
 static int CmdInitDel( ts_cmd_t *p_cmd, es_out_id_t *p_es )
@@ -326,6 +326,10 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
     priv->attachment_demux = NULL;
     priv->p_sout   = NULL;
     priv->b_out_pace_control = false;
+    priv->b_out_offline = false;
+    priv->i_out_offline_start = 0;
+    priv->i_out_offline_decoded = 0;
+    atomic_init( &priv->i_out_offline_frames, 0 );
     /* The renderer is passed after its refcount was incremented.
      * The input thread is now responsible for releasing it */
     priv->p_renderer = p_renderer;
@@ -725,7 +729,10 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
             else if( !es_out_GetEmpty( input_priv(p_input)->p_es_out ) )
             {
                 msg_Dbg( p_input, "waiting decoder fifos to empty" );
-                i_wakeup = mdate() + INPUT_IDLE_SLEEP;
+                /* Do not idle at the end of each file in offline mode */
+                i_wakeup = mdate() + ( input_priv(p_input)->b_out_offline
+                                       ? INPUT_IDLE_SLEEP / 20
+                                       : INPUT_IDLE_SLEEP );
             }
             /* Pause after eof only if the input is pausable.
              * This way we won't trigger timeshifting for nothing */
@@ -881,6 +888,34 @@ static int InitSout( input_thread_t * p_input )
 
     return VLC_SUCCESS;
 }
+
+static void InitOffline( input_thread_t *p_input )
+{
+    input_thread_private_t *priv = input_priv(p_input);
+
+    if( priv->p_sout == NULL || !var_GetBool( p_input, "sout-offline" ) )
+        return;
+
+    /* Outputs that cannot control their pace (network, display...) need
+     * the clock */
+    if( priv->p_sout->i_out_pace_nocontrol > 0 )
+    {
+        msg_Warn( p_input, "stream output needs real-time pacing, "
+                  "ignoring offline mode" );
+        return;
+    }
+
+    /* Decoders are not created yet: they will use the stream timestamps
+     * and never wait for buffering. The demux is only throttled by the
+     * decoder fifos. */
+    msg_Dbg( p_input, "starting in offline mode" );
+    priv->b_out_offline = true;
+    priv->b_out_pace_control = true;
+    priv->i_out_offline_start = mdate();
+    priv->i_out_offline_decoded = var_GetInteger( priv->p_sout,
+                                                  "sout-decoded-video" );
+    es_out_SetOffline( priv->p_es_out_display, true );
+}
 #endif
 
 static void InitTitle( input_thread_t * p_input )
@@ -1312,6 +1347,7 @@ static int Init( input_thread_t * p_input )
 #ifdef ENABLE_SOUT
     if( InitSout( p_input ) )
         goto error;
+    InitOffline( p_input );
 #endif
 
     /* Create es out */
@@ -1358,7 +1394,7 @@ static int Init( input_thread_t * p_input )
         }
     }
 
-    if( !priv->b_preparsing && priv->p_sout )
+    if( !priv->b_preparsing && priv->p_sout && !priv->b_out_offline )
     {
         priv->b_out_pace_control = priv->p_sout->i_out_pace_nocontrol > 0;
 
@@ -1476,6 +1512,22 @@ static void End( input_thread_t * p_input )
         es_out_Delete( priv->p_es_out );
     es_out_SetMode( priv->p_es_out_display, ES_OUT_MODE_END );
 
+    if( priv->b_out_offline )
+    {
+        const mtime_t i_elapsed = mdate() - priv->i_out_offline_start;
+        const unsigned i_sent = atomic_load( &priv->i_out_offline_frames );
+        /* the stream output decodes the frames it transcodes */
+        const int64_t i_decoded = var_GetInteger( priv->p_sout,
+                                                  "sout-decoded-video" )
+                                - priv->i_out_offline_decoded;
+
+        msg_Info( p_input, "offline output: %"PRId64" video frames decoded "
+                  "in %.3f s (%.2f frames/s), %u sent", i_decoded,
+                  (double)i_elapsed / CLOCK_FREQ,
+                  i_elapsed > 0 ? (double)i_decoded * CLOCK_FREQ / i_elapsed
+                                : 0., i_sent );
+    }
+
     if( !priv->b_preparsing )
     {
 #define CL_CO( c ) \
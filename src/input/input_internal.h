@@ -27,6 +27,7 @@
 #include <stddef.h>
 
 #include <vlc_access.h>
+#include <vlc_atomic.h>
 #include <vlc_demux.h>
 #include <vlc_input.h>
 #include <vlc_viewpoint.h>
@@ -108,6 +109,10 @@ typedef struct input_thread_private_t
     /* Output */
     bool            b_out_pace_control; /* XXX Move it ot es_sout ? */
     sout_instance_t *p_sout;            /* Idem ? */
+    bool            b_out_offline;      /* :sout-offline, no clock */
+    mtime_t         i_out_offline_start;
+    int64_t         i_out_offline_decoded; /* sout-decoded-video at start */
+    atomic_uint     i_out_offline_frames; /* video frames sent to sout */
     es_out_t        *p_es_out;
     es_out_t        *p_es_out_display;
     vlc_viewpoint_t viewpoint;
@@ -0,0 +1,567 @@
+/*****************************************************************************
+ * seekindex.c: persistent demuxer seek index
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_configuration.h>
+#include <vlc_seekindex.h>
+
+#include "../config/configuration.h"
+
+/* File layout, little endian:
+ *   "VLCSIDX1", key size (4), key, entries count (8), ranges count (8),
+ *   entries (time 8, offset 8, size 4, track 4, flags 4),
+ *   ranges (start 8, end 8) */
+#define SEEKINDEX_MAGIC       "VLCSIDX1"
+#define SEEKINDEX_ENTRY_SIZE  28
+#define SEEKINDEX_RANGE_SIZE  16
+#define SEEKINDEX_MAX_ENTRIES (1 << 20)
+#define SEEKINDEX_MAX_RANGES  4096
+#define SEEKINDEX_NAME_LEN    32        /* MD5 of the key, in hexadecimal */
+#define SEEKINDEX_SIZE_MAX    (32 << 20) /* for all the cached indexes */
+
+struct vlc_seekindex_t
+{
+    vlc_object_t *p_obj;
+    char *psz_key;  /* file identity, checked on load */
+    char *psz_file; /* cache file */
+
+    vlc_seekindex_entry_t *p_entries;
+    size_t i_entries;
+    size_t i_max;
+    bool b_sorted;
+
+    vlc_seekindex_range_t *p_ranges;
+    size_t i_ranges;
+
+    bool b_dirty;
+    bool b_loaded;
+    uint8_t p_digest[16]; /* of the loaded entries and ranges */
+};
+
+static int EntryCmp( const void *a, const void *b )
+{
+    const vlc_seekindex_entry_t *ea = a, *eb = b;
+    if( ea->i_track != eb->i_track )
+        return ea->i_track < eb->i_track ? -1 : 1;
+    if( ea->i_offset != eb->i_offset )
+        return ea->i_offset < eb->i_offset ? -1 : 1;
+    return 0;
+}
+
+static void Sort( vlc_seekindex_t *p_idx )
+{
+    if( p_idx->b_sorted )
+        return;
+
+    qsort( p_idx->p_entries, p_idx->i_entries, sizeof(*p_idx->p_entries), EntryCmp );
+
+    /* merge duplicates */
+    size_t j = 0;
+    for( size_t i = 0; i < p_idx->i_entries; i++ )
+    {
+        const vlc_seekindex_entry_t *p_entry = &p_idx->p_entries[i];
+        if( j > 0 && !EntryCmp( &p_idx->p_entries[j - 1], p_entry ) )
+        {
+            vlc_seekindex_entry_t *p_prev = &p_idx->p_entries[j - 1];
+            p_prev->i_flags |= p_entry->i_flags;
+            if( p_prev->i_time <= VLC_TS_INVALID )
+                p_prev->i_time = p_entry->i_time;
+            if( p_prev->i_size == 0 )
+                p_prev->i_size = p_entry->i_size;
+        }
+        else
+            p_idx->p_entries[j++] = *p_entry;
+    }
+    p_idx->i_entries = j;
+    p_idx->b_sorted = true;
+}
+
+/* first entry of a track */
+static size_t LowerBound( const vlc_seekindex_t *p_idx, uint32_t i_track )
+{
+    size_t i_low = 0, i_high = p_idx->i_entries;
+    while( i_low < i_high )
+    {
+        size_t i_mid = (i_low + i_high) / 2;
+        if( p_idx->p_entries[i_mid].i_track < i_track )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+static int Reserve( vlc_seekindex_t *p_idx, size_t i_count )
+{
+    if( i_count <= p_idx->i_max )
+        return VLC_SUCCESS;
+
+    size_t i_max = __MAX( i_count, p_idx->i_max * 2 );
+    if( i_max < 256 )
+        i_max = 256;
+    vlc_seekindex_entry_t *p_entries = realloc( p_idx->p_entries,
+                                                i_max * sizeof(*p_entries) );
+    if( unlikely(p_entries == NULL) )
+        return VLC_ENOMEM;
+    p_idx->p_entries = p_entries;
+    p_idx->i_max = i_max;
+    return VLC_SUCCESS;
+}
+
+static int InsertRange( vlc_seekindex_t *p_idx, uint64_t i_start, uint64_t i_end )
+{
+    size_t i = 0;
+    while( i < p_idx->i_ranges && p_idx->p_ranges[i].i_end < i_start )
+        i++;
+
+    /* merge with all the overlapping or adjacent ranges */
+    size_t j = i;
+    while( j < p_idx->i_ranges && p_idx->p_ranges[j].i_start <= i_end )
+    {
+        i_start = __MIN( i_start, p_idx->p_ranges[j].i_start );
+        i_end = __MAX( i_end, p_idx->p_ranges[j].i_end );
+        j++;
+    }
+
+    if( i == j )
+    {
+        if( p_idx->i_ranges >= SEEKINDEX_MAX_RANGES )
+            return VLC_EGENERIC;
+        vlc_seekindex_range_t *p_ranges = realloc( p_idx->p_ranges,
+                                (p_idx->i_ranges + 1) * sizeof(*p_ranges) );
+        if( unlikely(p_ranges == NULL) )
+            return VLC_ENOMEM;
+        p_idx->p_ranges = p_ranges;
+        memmove( &p_ranges[i + 1], &p_ranges[i],
+                 (p_idx->i_ranges - i) * sizeof(*p_ranges) );
+        p_idx->i_ranges++;
+    }
+    else
+    {
+        memmove( &p_idx->p_ranges[i + 1], &p_idx->p_ranges[j],
+                 (p_idx->i_ranges - j) * sizeof(*p_idx->p_ranges) );
+        p_idx->i_ranges -= j - i - 1;
+    }
+
+    p_idx->p_ranges[i].i_start = i_start;
+    p_idx->p_ranges[i].i_end = i_end;
+    return VLC_SUCCESS;
+}
+
+/* MD5 of the sorted entries and ranges, to detect an unchanged index */
+static void Digest( vlc_seekindex_t *p_idx, uint8_t *p_digest )
+{
+    struct md5_s md5;
+    uint8_t p_buf[SEEKINDEX_ENTRY_SIZE];
+
+    Sort( p_idx );
+    InitMD5( &md5 );
+    for( size_t i = 0; i < p_idx->i_entries; i++ )
+    {
+        const vlc_seekindex_entry_t *p_entry = &p_idx->p_entries[i];
+        SetQWLE( &p_buf[0], p_entry->i_time );
+        SetQWLE( &p_buf[8], p_entry->i_offset );
+        SetDWLE( &p_buf[16], p_entry->i_size );
+        SetDWLE( &p_buf[20], p_entry->i_track );
+        SetDWLE( &p_buf[24], p_entry->i_flags );
+        AddMD5( &md5, p_buf, SEEKINDEX_ENTRY_SIZE );
+    }
+    for( size_t i = 0; i < p_idx->i_ranges; i++ )
+    {
+        SetQWLE( &p_buf[0], p_idx->p_ranges[i].i_start );
+        SetQWLE( &p_buf[8], p_idx->p_ranges[i].i_end );
+        AddMD5( &md5, p_buf, SEEKINDEX_RANGE_SIZE );
+    }
+    EndMD5( &md5 );
+    memcpy( p_digest, md5.buf, 16 );
+}
+
+static void Load( vlc_seekindex_t *p_idx )
+{
+    FILE *p_file = vlc_fopen( p_idx->psz_file, "rb" );
+    if( p_file == NULL )
+        return;
+
+    const size_t i_key = strlen( p_idx->psz_key );
+    uint8_t p_header[sizeof(SEEKINDEX_MAGIC) - 1 + 4];
+    uint8_t p_buf[SEEKINDEX_ENTRY_SIZE];
+    char *psz_key = NULL;
+
+    if( fread( p_header, sizeof(p_header), 1, p_file ) != 1 ||
+        memcmp( p_header, SEEKINDEX_MAGIC, sizeof(SEEKINDEX_MAGIC) - 1 ) ||
+        GetDWLE( &p_header[sizeof(SEEKINDEX_MAGIC) - 1] ) != i_key )
+        goto end;
+
+    psz_key = malloc( i_key );
+    if( unlikely(psz_key == NULL) ||
+        fread( psz_key, i_key, 1, p_file ) != 1 ||
+        memcmp( psz_key, p_idx->psz_key, i_key ) ||
+        fread( p_buf, 16, 1, p_file ) != 1 )
+        goto end;
+
+    const uint64_t i_entries = GetQWLE( &p_buf[0] );
+    const uint64_t i_ranges = GetQWLE( &p_buf[8] );
+    if( i_entries > SEEKINDEX_MAX_ENTRIES || i_ranges > SEEKINDEX_MAX_RANGES ||
+        Reserve( p_idx, i_entries ) )
+        goto end;
+
+    for( uint64_t i = 0; i < i_entries; i++ )
+    {
+        if( fread( p_buf, SEEKINDEX_ENTRY_SIZE, 1, p_file ) != 1 )
+            goto error;
+        vlc_seekindex_entry_t *p_entry = &p_idx->p_entries[i];
+        p_entry->i_time = (int64_t) GetQWLE( &p_buf[0] );
+        p_entry->i_offset = GetQWLE( &p_buf[8] );
+        p_entry->i_size = GetDWLE( &p_buf[16] );
+        p_entry->i_track = GetDWLE( &p_buf[20] );
+        p_entry->i_flags = GetDWLE( &p_buf[24] );
+    }
+    p_idx->i_entries = i_entries;
+    p_idx->b_sorted = false;
+
+    for( uint64_t i = 0; i < i_ranges; i++ )
+    {
+        if( fread( p_buf, SEEKINDEX_RANGE_SIZE, 1, p_file ) != 1 ||
+            InsertRange( p_idx, GetQWLE( &p_buf[0] ), GetQWLE( &p_buf[8] ) ) )
+            goto error;
+    }
+
+    msg_Dbg( p_idx->p_obj, "loaded %zu seek index entries, %zu ranges",
+             p_idx->i_entries, p_idx->i_ranges );
+    Digest( p_idx, p_idx->p_digest );
+    p_idx->b_loaded = true;
+    goto end;
+
+error:
+    msg_Warn( p_idx->p_obj, "corrupted seek index %s", p_idx->psz_file );
+    p_idx->i_entries = 0;
+    p_idx->i_ranges = 0;
+end:
+    free( psz_key );
+    fclose( p_file );
+}
+
+struct index_file
+{
+    char *psz_path;
+    time_t i_mtime;
+    size_t i_size;
+};
+
+static int IndexFileCmp( const void *a, const void *b )
+{
+    const struct index_file *fa = a, *fb = b;
+
+    return ( fa->i_mtime > fb->i_mtime ) - ( fa->i_mtime < fb->i_mtime );
+}
+
+/* Removes the least recently stored indexes above SEEKINDEX_SIZE_MAX */
+static void Prune( vlc_object_t *p_obj, const char *psz_dir )
+{
+    DIR *dir = vlc_opendir( psz_dir );
+    if( dir == NULL )
+        return;
+
+    struct index_file *p_files = NULL;
+    size_t i_count = 0, i_alloc = 0, i_total = 0;
+    const char *psz_name;
+
+    while( ( psz_name = vlc_readdir( dir ) ) != NULL )
+    {
+        struct index_file file;
+        struct stat st;
+
+        /* Indexes only, not the ones being written */
+        if( strlen( psz_name ) != SEEKINDEX_NAME_LEN || strchr( psz_name, '.' ) )
+            continue;
+        if( asprintf( &file.psz_path, "%s"DIR_SEP"%s", psz_dir, psz_name ) == -1 )
+            break;
+        if( vlc_stat( file.psz_path, &st ) || !S_ISREG( st.st_mode ) )
+        {
+            free( file.psz_path );
+            continue;
+        }
+        file.i_mtime = st.st_mtime;
+        file.i_size = st.st_size;
+
+        if( i_count == i_alloc )
+        {
+            size_t n = i_alloc ? 2 * i_alloc : 64;
+            struct index_file *p_grown = realloc( p_files, n * sizeof(*p_files) );
+            if( unlikely(p_grown == NULL) )
+            {
+                free( file.psz_path );
+                break;
+            }
+            p_files = p_grown;
+            i_alloc = n;
+        }
+        p_files[i_count++] = file;
+        i_total += file.i_size;
+    }
+    closedir( dir );
+
+    if( i_total > SEEKINDEX_SIZE_MAX )
+    {
+        unsigned i_removed = 0;
+
+        /* Oldest first, with some margin not to rescan after each store */
+        qsort( p_files, i_count, sizeof(*p_files), IndexFileCmp );
+        for( size_t i = 0;
+             i < i_count && i_total > SEEKINDEX_SIZE_MAX / 4 * 3; i++ )
+            if( vlc_unlink( p_files[i].psz_path ) == 0 )
+            {
+                i_total -= p_files[i].i_size;
+                i_removed++;
+            }
+        msg_Dbg( p_obj, "removed %u seek indexes", i_removed );
+    }
+
+    for( size_t i = 0; i < i_count; i++ )
+        free( p_files[i].psz_path );
+    free( p_files );
+}
+
+static void Store( vlc_seekindex_t *p_idx )
+{
+    char *psz_tmp;
+    if( asprintf( &psz_tmp, "%s.tmp", p_idx->psz_file ) == -1 )
+        return;
+
+    /* the seekindex directory, and the cache directory if needed */
+    char *psz_sep = strrchr( psz_tmp, DIR_SEP_CHAR );
+    *psz_sep = '\0';
+    config_CreateDir( p_idx->p_obj, psz_tmp );
+    *psz_sep = DIR_SEP_CHAR;
+
+    FILE *p_file = vlc_fopen( psz_tmp, "wb" );
+    if( p_file == NULL )
+    {
+        msg_Warn( p_idx->p_obj, "cannot write seek index %s: %s", psz_tmp,
+                  vlc_strerror_c(errno) );
+        free( psz_tmp );
+        return;
+    }
+
+    const size_t i_key = strlen( p_idx->psz_key );
+    uint8_t p_buf[SEEKINDEX_ENTRY_SIZE];
+    bool b_error = false;
+
+    memcpy( p_buf, SEEKINDEX_MAGIC, sizeof(SEEKINDEX_MAGIC) - 1 );
+    SetDWLE( &p_buf[sizeof(SEEKINDEX_MAGIC) - 1], i_key );
+    b_error |= fwrite( p_buf, sizeof(SEEKINDEX_MAGIC) - 1 + 4, 1, p_file ) != 1;
+    b_error |= fwrite( p_idx->psz_key, i_key, 1, p_file ) != 1;
+    SetQWLE( &p_buf[0], p_idx->i_entries );
+    SetQWLE( &p_buf[8], p_idx->i_ranges );
+    b_error |= fwrite( p_buf, 16, 1, p_file ) != 1;
+
+    for( size_t i = 0; i < p_idx->i_entries && !b_error; i++ )
+    {
+        const vlc_seekindex_entry_t *p_entry = &p_idx->p_entries[i];
+        SetQWLE( &p_buf[0], p_entry->i_time );
+        SetQWLE( &p_buf[8], p_entry->i_offset );
+        SetDWLE( &p_buf[16], p_entry->i_size );
+        SetDWLE( &p_buf[20], p_entry->i_track );
+        SetDWLE( &p_buf[24], p_entry->i_flags );
+        b_error |= fwrite( p_buf, SEEKINDEX_ENTRY_SIZE, 1, p_file ) != 1;
+    }
+
+    for( size_t i = 0; i < p_idx->i_ranges && !b_error; i++ )
+    {
+        SetQWLE( &p_buf[0], p_idx->p_ranges[i].i_start );
+        SetQWLE( &p_buf[8], p_idx->p_ranges[i].i_end );
+        b_error |= fwrite( p_buf, SEEKINDEX_RANGE_SIZE, 1, p_file ) != 1;
+    }
+
+    b_error |= fclose( p_file ) != 0;
+
+    if( b_error || vlc_rename( psz_tmp, p_idx->psz_file ) )
+    {
+        msg_Warn( p_idx->p_obj, "cannot write seek index %s", p_idx->psz_file );
+        vlc_unlink( psz_tmp );
+    }
+    else
+    {
+        msg_Dbg( p_idx->p_obj, "stored %zu seek index entries, %zu ranges",
+                 p_idx->i_entries, p_idx->i_ranges );
+        *psz_sep = '\0';
+        Prune( p_idx->p_obj, psz_tmp );
+    }
+    free( psz_tmp );
+}
+
+#undef vlc_seekindex_New
+vlc_seekindex_t *vlc_seekindex_New( vlc_object_t *p_obj, const char *psz_name,
+                                    const char *psz_path )
+{
+    struct stat st;
+
+    if( psz_path == NULL || !var_InheritBool( p_obj, "input-seekindex" ) ||
+        vlc_stat( psz_path, &st ) || !S_ISREG(st.st_mode) )
+        return NULL;
+
+    vlc_seekindex_t *p_idx = calloc( 1, sizeof(*p_idx) );
+    if( unlikely(p_idx == NULL) )
+        return NULL;
+    p_idx->p_obj = p_obj;
+    p_idx->b_sorted = true;
+
+    if( asprintf( &p_idx->psz_key, "%s\n%s\n%"PRIu64"\n%"PRId64, psz_name,
+                  psz_path, (uint64_t) st.st_size, (int64_t) st.st_mtime ) == -1 )
+    {
+        free( p_idx );
+        return NULL;
+    }
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, p_idx->psz_key, strlen( p_idx->psz_key ) );
+    EndMD5( &md5 );
+    char *psz_md5 = psz_md5_hash( &md5 );
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+
+    if( psz_md5 == NULL || psz_cachedir == NULL ||
+        asprintf( &p_idx->psz_file, "%s" DIR_SEP "seekindex" DIR_SEP "%s",
+                  psz_cachedir, psz_md5 ) == -1 )
+        p_idx->psz_file = NULL;
+    free( psz_cachedir );
+    free( psz_md5 );
+
+    if( p_idx->psz_file == NULL )
+    {
+        free( p_idx->psz_key );
+        free( p_idx );
+        return NULL;
+    }
+
+    Load( p_idx );
+    return p_idx;
+}
+
+void vlc_seekindex_Delete( vlc_seekindex_t *p_idx )
+{
+    if( p_idx->b_dirty )
+    {
+        uint8_t p_digest[16];
+
+        /* the same entries may be added again on each playback */
+        Digest( p_idx, p_digest );
+        if( !p_idx->b_loaded || memcmp( p_digest, p_idx->p_digest, 16 ) )
+            Store( p_idx );
+    }
+
+    free( p_idx->p_ranges );
+    free( p_idx->p_entries );
+    free( p_idx->psz_file );
+    free( p_idx->psz_key );
+    free( p_idx );
+}
+
+int vlc_seekindex_Add( vlc_seekindex_t *p_idx, const vlc_seekindex_entry_t *p_entry )
+{
+    if( p_idx->i_entries >= SEEKINDEX_MAX_ENTRIES )
+        return VLC_EGENERIC;
+    if( Reserve( p_idx, p_idx->i_entries + 1 ) )
+        return VLC_ENOMEM;
+
+    if( p_idx->i_entries > 0 &&
+        EntryCmp( &p_idx->p_entries[p_idx->i_entries - 1], p_entry ) >= 0 )
+        p_idx->b_sorted = false;
+    p_idx->p_entries[p_idx->i_entries++] = *p_entry;
+    p_idx->b_dirty = true;
+    return VLC_SUCCESS;
+}
+
+int vlc_seekindex_AddRange( vlc_seekindex_t *p_idx, uint64_t i_start, uint64_t i_end )
+{
+    if( i_start >= i_end || vlc_seekindex_IsIndexed( p_idx, i_start, i_end ) )
+        return VLC_SUCCESS;
+
+    int i_ret = InsertRange( p_idx, i_start, i_end );
+    if( i_ret == VLC_SUCCESS )
+        p_idx->b_dirty = true;
+    return i_ret;
+}
+
+bool vlc_seekindex_IsIndexed( vlc_seekindex_t *p_idx, uint64_t i_start, uint64_t i_end )
+{
+    for( size_t i = 0; i < p_idx->i_ranges; i++ )
+    {
+        if( p_idx->p_ranges[i].i_start > i_start )
+            break;
+        if( p_idx->p_ranges[i].i_end >= i_end )
+            return true;
+    }
+    return false;
+}
+
+const vlc_seekindex_entry_t *vlc_seekindex_Lookup( vlc_seekindex_t *p_idx,
+                                                   uint32_t i_track,
+                                                   mtime_t i_time,
+                                                   uint32_t i_flags )
+{
+    Sort( p_idx );
+
+    const vlc_seekindex_entry_t *p_best = NULL;
+    for( size_t i = LowerBound( p_idx, i_track );
+         i < p_idx->i_entries && p_idx->p_entries[i].i_track == i_track; i++ )
+    {
+        const vlc_seekindex_entry_t *p_entry = &p_idx->p_entries[i];
+        if( p_entry->i_time <= VLC_TS_INVALID || p_entry->i_time > i_time ||
+            (p_entry->i_flags & i_flags) != i_flags )
+            continue;
+        if( p_best == NULL || p_entry->i_time > p_best->i_time )
+            p_best = p_entry;
+    }
+    return p_best;
+}
+
+size_t vlc_seekindex_GetEntries( vlc_seekindex_t *p_idx, uint32_t i_track,
+                                 const vlc_seekindex_entry_t **pp_entries )
+{
+    Sort( p_idx );
+
+    size_t i_first = LowerBound( p_idx, i_track );
+    size_t i_last = i_first;
+    while( i_last < p_idx->i_entries && p_idx->p_entries[i_last].i_track == i_track )
+        i_last++;
+
+    *pp_entries = &p_idx->p_entries[i_first];
+    return i_last - i_first;
+}
+
+size_t vlc_seekindex_GetRanges( vlc_seekindex_t *p_idx,
+                                const vlc_seekindex_range_t **pp_ranges )
+{
+    *pp_ranges = p_idx->p_ranges;
+    return p_idx->i_ranges;
+}
@@ -0,0 +1,998 @@
+/*****************************************************************************
+ * thumbnailer.c: batch picture extraction
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_codec.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_image.h>
+#include <vlc_input_item.h>
+#include <vlc_interrupt.h>
+#include <vlc_modules.h>
+#include <vlc_picture.h>
+#include <vlc_thumbnailer.h>
+
+#include "../libvlc.h"
+#include "demux.h"
+#include "input_internal.h"
+#include "stream.h"
+
+/* Demux calls without any video ES before giving up on a media */
+#define THUMBNAILER_PROBE_DEMUX 256
+
+typedef struct
+{
+    mtime_t i_time;
+    size_t  i_index;
+} target_t;
+
+typedef struct request_t request_t;
+
+struct request_t
+{
+    request_t         *p_next;
+    input_item_t      *p_item;
+    target_t          *p_targets; /**< By increasing time, or NULL */
+    size_t             i_count;
+    unsigned           i_width;
+    unsigned           i_height;
+    vlc_fourcc_t       i_codec;
+    vlc_thumbnailer_cb pf_cb;
+    void              *opaque;
+    atomic_bool        b_cancelled;
+};
+
+typedef struct
+{
+    vlc_thumbnailer_t *p_thumb;
+    vlc_thread_t       thread;
+    request_t         *p_request;   /**< Running request, or NULL */
+    vlc_interrupt_t   *p_interrupt; /**< Interrupt context of the request */
+} worker_t;
+
+struct vlc_thumbnailer_t
+{
+    vlc_object_t *p_parent;
+
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;
+    request_t    *p_first;
+    request_t   **pp_last;
+    bool          b_exit;
+
+    unsigned      i_decoder_threads;
+    unsigned      i_workers;
+    worker_t      workers[];
+};
+
+/*****************************************************************************
+ * Decoding
+ *****************************************************************************/
+
+struct es_out_id_t
+{
+    es_out_id_t *p_next;
+    es_format_t  fmt;
+};
+
+typedef struct
+{
+    es_out_t      out;
+    vlc_object_t *p_obj;
+    es_out_id_t  *p_ids;
+    es_out_id_t  *p_video;      /**< Decoded ES */
+    decoder_t    *p_packetizer;
+    decoder_t    *p_decoder;
+    picture_t    *p_picture;    /**< First picture since the last seek */
+    bool          b_error;
+    bool          b_key_flags;  /**< Key frames are flagged in this ES */
+    bool          b_wait_key;
+    mtime_t       i_pcr;        /**< Last PCR, or VLC_TS_INVALID */
+    mtime_t       i_start;      /**< Timestamp of the media time 0 */
+} job_t;
+
+static int VoutFormatUpdate( decoder_t *p_dec )
+{
+    p_dec->fmt_out.video.i_chroma = p_dec->fmt_out.i_codec;
+    return 0;
+}
+
+static picture_t *VoutBufferNew( decoder_t *p_dec )
+{
+    return picture_NewFromFormat( &p_dec->fmt_out.video );
+}
+
+static int QueueVideo( decoder_t *p_dec, picture_t *p_pic )
+{
+    job_t *job = p_dec->p_queue_ctx;
+
+    if( job->p_picture == NULL )
+        job->p_picture = p_pic;
+    else
+        picture_Release( p_pic );
+    return 0;
+}
+
+static decoder_t *DecoderNew( job_t *job, const es_format_t *fmt,
+                              bool b_packetizer )
+{
+    decoder_t *p_dec = vlc_custom_create( job->p_obj, sizeof( *p_dec ),
+                                          b_packetizer ? "packetizer"
+                                                       : "decoder" );
+    if( unlikely(p_dec == NULL) )
+        return NULL;
+
+    es_format_Copy( &p_dec->fmt_in, fmt );
+    es_format_Init( &p_dec->fmt_out, fmt->i_cat, 0 );
+    p_dec->b_frame_drop_allowed = false;
+
+    if( b_packetizer )
+        p_dec->p_module = module_need( p_dec, "packetizer", "$packetizer",
+                                       false );
+    else
+    {
+        p_dec->pf_vout_format_update = VoutFormatUpdate;
+        p_dec->pf_vout_buffer_new = VoutBufferNew;
+        p_dec->pf_queue_video = QueueVideo;
+        p_dec->p_queue_ctx = job;
+        p_dec->p_module = module_need( p_dec, "video decoder", "$codec",
+                                       false );
+    }
+
+    if( p_dec->p_module == NULL )
+    {
+        msg_Dbg( job->p_obj, "no %s for `%4.4s'",
+                 b_packetizer ? "packetizer" : "decoder",
+                 (const char *)&fmt->i_codec );
+        es_format_Clean( &p_dec->fmt_in );
+        es_format_Clean( &p_dec->fmt_out );
+        vlc_object_release( p_dec );
+        return NULL;
+    }
+
+    if( b_packetizer )
+        p_dec->fmt_out.b_packetized = true;
+    return p_dec;
+}
+
+static void DecoderDelete( decoder_t *p_dec )
+{
+    module_unneed( p_dec, p_dec->p_module );
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+    if( p_dec->p_description != NULL )
+        vlc_meta_Delete( p_dec->p_description );
+    vlc_object_release( p_dec );
+}
+
+static void DecodersStop( job_t *job )
+{
+    if( job->p_decoder != NULL )
+        DecoderDelete( job->p_decoder );
+    if( job->p_packetizer != NULL )
+        DecoderDelete( job->p_packetizer );
+    job->p_decoder = job->p_packetizer = NULL;
+
+    if( job->p_picture != NULL )
+        picture_Release( job->p_picture );
+    job->p_picture = NULL;
+}
+
+static int DecodersStart( job_t *job, const es_format_t *fmt )
+{
+    if( !fmt->b_packetized )
+    {
+        job->p_packetizer = DecoderNew( job, fmt, true );
+        if( job->p_packetizer == NULL )
+            return VLC_EGENERIC;
+        fmt = &job->p_packetizer->fmt_out;
+    }
+
+    job->p_decoder = DecoderNew( job, fmt, false );
+    if( job->p_decoder == NULL )
+    {
+        DecodersStop( job );
+        return VLC_EGENERIC;
+    }
+
+    job->b_key_flags = false;
+    job->b_wait_key = false;
+    return VLC_SUCCESS;
+}
+
+static void DecodersFlush( job_t *job )
+{
+    if( job->p_packetizer != NULL && job->p_packetizer->pf_flush != NULL )
+        job->p_packetizer->pf_flush( job->p_packetizer );
+    if( job->p_decoder != NULL && job->p_decoder->pf_flush != NULL )
+        job->p_decoder->pf_flush( job->p_decoder );
+
+    /* Skip to the next key frame, if they can be told apart */
+    job->b_wait_key = job->b_key_flags;
+}
+
+static void DecodeBlock( job_t *job, block_t *p_block )
+{
+    if( job->b_error || job->p_picture != NULL )
+    {
+        /* Done until the next seek */
+        block_Release( p_block );
+        return;
+    }
+
+    if( p_block->i_flags & BLOCK_FLAG_TYPE_I )
+    {
+        job->b_key_flags = true;
+        job->b_wait_key = false;
+    }
+    else if( job->b_wait_key
+          && (p_block->i_flags & (BLOCK_FLAG_TYPE_P | BLOCK_FLAG_TYPE_B
+                                                    | BLOCK_FLAG_TYPE_PB)) )
+    {
+        block_Release( p_block );
+        return;
+    }
+
+    if( job->p_decoder->pf_decode( job->p_decoder, p_block ) != VLCDEC_SUCCESS )
+        job->b_error = true;
+}
+
+static void Decode( job_t *job, block_t *p_chain )
+{
+    while( p_chain != NULL )
+    {
+        block_t *p_block = p_chain;
+
+        p_chain = p_chain->p_next;
+        p_block->p_next = NULL;
+
+        decoder_t *p_pack = job->p_packetizer;
+        if( p_pack == NULL )
+        {
+            DecodeBlock( job, p_block );
+            continue;
+        }
+
+        block_t *p_out;
+        while( (p_out = p_pack->pf_packetize( p_pack, &p_block )) != NULL )
+        {
+            if( job->p_decoder != NULL
+             && !es_format_IsSimilar( &job->p_decoder->fmt_in,
+                                      &p_pack->fmt_out ) )
+            {
+                msg_Dbg( job->p_obj, "restarting decoder" );
+                DecoderDelete( job->p_decoder );
+                job->p_decoder = DecoderNew( job, &p_pack->fmt_out, false );
+                if( job->p_decoder == NULL )
+                    job->b_error = true;
+            }
+
+            while( p_out != NULL )
+            {
+                block_t *p_next = p_out->p_next;
+
+                p_out->p_next = NULL;
+                if( job->p_decoder != NULL )
+                    DecodeBlock( job, p_out );
+                else
+                    block_Release( p_out );
+                p_out = p_next;
+            }
+        }
+    }
+}
+
+static void Drain( job_t *job )
+{
+    if( job->p_decoder != NULL && !job->b_error && job->p_picture == NULL )
+        job->p_decoder->pf_decode( job->p_decoder, NULL );
+}
+
+/*****************************************************************************
+ * ES output: only the first video ES is selected and decoded
+ *****************************************************************************/
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *fmt )
+{
+    job_t *job = (job_t *)out;
+    es_out_id_t *id = malloc( sizeof( *id ) );
+    if( unlikely(id == NULL) )
+        return NULL;
+
+    es_format_Copy( &id->fmt, fmt );
+    id->p_next = job->p_ids;
+    job->p_ids = id;
+
+    if( job->p_video == NULL && fmt->i_cat == VIDEO_ES
+     && fmt->i_priority >= ES_PRIORITY_SELECTABLE_MIN
+     && DecodersStart( job, fmt ) == VLC_SUCCESS )
+        job->p_video = id;
+    return id;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *p_block )
+{
+    job_t *job = (job_t *)out;
+
+    if( id == job->p_video )
+        Decode( job, p_block );
+    else
+        block_ChainRelease( p_block );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    job_t *job = (job_t *)out;
+
+    if( id == job->p_video )
+    {
+        DecodersStop( job );
+        job->p_video = NULL;
+    }
+
+    for( es_out_id_t **pp = &job->p_ids; *pp != NULL; pp = &(*pp)->p_next )
+        if( *pp == id )
+        {
+            *pp = id->p_next;
+            break;
+        }
+    es_format_Clean( &id->fmt );
+    free( id );
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    job_t *job = (job_t *)out;
+
+    switch( i_query )
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            es_out_id_t *id = va_arg( args, es_out_id_t * );
+            *va_arg( args, bool * ) = id == job->p_video;
+            return VLC_SUCCESS;
+        }
+
+        case ES_OUT_SET_ES_FMT:
+        {
+            es_out_id_t *id = va_arg( args, es_out_id_t * );
+            const es_format_t *fmt = va_arg( args, const es_format_t * );
+
+            es_format_Clean( &id->fmt );
+            es_format_Copy( &id->fmt, fmt );
+            if( id == job->p_video )
+            {
+                DecodersStop( job );
+                if( DecodersStart( job, &id->fmt ) != VLC_SUCCESS )
+                    job->p_video = NULL;
+            }
+            return VLC_SUCCESS;
+        }
+
+        case ES_OUT_GET_EMPTY:
+            *va_arg( args, bool * ) = true;
+            return VLC_SUCCESS;
+
+        case ES_OUT_POST_SUBNODE:
+            input_item_node_Delete( va_arg( args, input_item_node_t * ) );
+            return VLC_SUCCESS;
+
+        case ES_OUT_SET_PCR:
+            job->i_pcr = va_arg( args, mtime_t );
+            return VLC_SUCCESS;
+
+        case ES_OUT_SET_GROUP_PCR:
+            (void) va_arg( args, int );
+            job->i_pcr = va_arg( args, mtime_t );
+            return VLC_SUCCESS;
+
+        case ES_OUT_SET_ES:
+        case ES_OUT_RESTART_ES:
+        case ES_OUT_RESTART_ALL_ES:
+        case ES_OUT_SET_ES_DEFAULT:
+        case ES_OUT_SET_ES_STATE:
+        case ES_OUT_SET_ES_CAT_POLICY:
+        case ES_OUT_SET_GROUP:
+        case ES_OUT_RESET_PCR:
+        case ES_OUT_SET_NEXT_DISPLAY_TIME:
+        case ES_OUT_SET_GROUP_META:
+        case ES_OUT_SET_GROUP_EPG:
+        case ES_OUT_SET_GROUP_EPG_EVENT:
+        case ES_OUT_SET_EPG_TIME:
+        case ES_OUT_DEL_GROUP:
+        case ES_OUT_SET_ES_SCRAMBLED_STATE:
+        case ES_OUT_SET_META:
+            return VLC_SUCCESS;
+
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static void EsOutDestroy( es_out_t *out )
+{
+    job_t *job = (job_t *)out;
+
+    DecodersStop( job );
+    job->p_video = NULL;
+
+    while( job->p_ids != NULL )
+    {
+        es_out_id_t *id = job->p_ids;
+
+        job->p_ids = id->p_next;
+        es_format_Clean( &id->fmt );
+        free( id );
+    }
+}
+
+/*****************************************************************************
+ * Output pictures
+ *****************************************************************************/
+
+/* Fits a size in a bounding box (0 meaning unconstrained) */
+static void FitSize( unsigned *pi_width, unsigned *pi_height,
+                     unsigned i_max_width, unsigned i_max_height )
+{
+    uint64_t w = *pi_width, h = *pi_height;
+
+    if( w == 0 || h == 0 )
+        return;
+
+    if( i_max_width > 0
+     && (i_max_height == 0 || w * i_max_height >= h * i_max_width) )
+    {
+        h = h * i_max_width / w;
+        w = i_max_width;
+    }
+    else if( i_max_height > 0 )
+    {
+        w = w * i_max_height / h;
+        h = i_max_height;
+    }
+    *pi_width = __MAX( w, 1 );
+    *pi_height = __MAX( h, 1 );
+}
+
+/* Copies the visible lines of all the planes back to back */
+static block_t *PicturePack( const picture_t *p_pic )
+{
+    size_t i_size = 0;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        i_size += (size_t)p_pic->p[i].i_visible_pitch
+                * p_pic->p[i].i_visible_lines;
+
+    block_t *p_block = block_Alloc( i_size );
+    if( unlikely(p_block == NULL) )
+        return NULL;
+
+    uint8_t *p_dst = p_block->p_buffer;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+        {
+            memcpy( p_dst, &p->p_pixels[y * p->i_pitch], p->i_visible_pitch );
+            p_dst += p->i_visible_pitch;
+        }
+    }
+    return p_block;
+}
+
+static block_t *Convert( image_handler_t *p_image, picture_t *p_pic,
+                         const request_t *req, video_format_t *p_fmt_out )
+{
+    video_format_t fmt_in = p_pic->format;
+
+    /* Drop the decoder padding */
+    fmt_in.i_width = fmt_in.i_visible_width;
+    fmt_in.i_height = fmt_in.i_visible_height;
+    fmt_in.i_x_offset = fmt_in.i_y_offset = 0;
+
+    unsigned i_width = fmt_in.i_visible_width;
+    unsigned i_height = fmt_in.i_visible_height;
+    if( fmt_in.i_sar_num > 0 && fmt_in.i_sar_den > 0 )
+        i_width = (uint64_t)i_width * fmt_in.i_sar_num / fmt_in.i_sar_den;
+    FitSize( &i_width, &i_height, req->i_width, req->i_height );
+
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( req->i_codec );
+    if( p_dsc != NULL && p_dsc->plane_count > 1 )
+    {   /* Keep subsampled planes aligned */
+        i_width = __MAX( i_width & ~1u, 2 );
+        i_height = __MAX( i_height & ~1u, 2 );
+    }
+
+    video_format_Init( p_fmt_out, req->i_codec );
+    p_fmt_out->i_width = p_fmt_out->i_visible_width = i_width;
+    p_fmt_out->i_height = p_fmt_out->i_visible_height = i_height;
+    p_fmt_out->i_sar_num = p_fmt_out->i_sar_den = 1;
+
+    if( p_dsc == NULL ) /* Image codec */
+        return image_Write( p_image, p_pic, &fmt_in, p_fmt_out );
+
+    picture_t *p_out = image_Convert( p_image, p_pic, &fmt_in, p_fmt_out );
+    if( p_out == NULL )
+        return NULL;
+
+    block_t *p_block = PicturePack( p_out );
+    picture_Release( p_out );
+    return p_block;
+}
+
+/* i_start is the timestamp of the media time 0 */
+static void Emit( const request_t *req, image_handler_t *p_image,
+                  size_t i_index, picture_t *p_pic, mtime_t i_start )
+{
+    vlc_thumbnail_t thumb = {
+        .p_item = req->p_item,
+        .i_index = i_index,
+        .i_time = VLC_TS_INVALID,
+        .p_block = NULL,
+    };
+
+    video_format_Init( &thumb.fmt, 0 );
+    if( p_pic != NULL && p_image != NULL )
+    {
+        thumb.i_time = p_pic->date > VLC_TS_INVALID
+                     ? __MAX( VLC_TS_0 + p_pic->date - i_start, VLC_TS_0 )
+                     : VLC_TS_INVALID;
+        thumb.p_block = Convert( p_image, p_pic, req, &thumb.fmt );
+    }
+
+    req->pf_cb( req->opaque, &thumb );
+
+    if( thumb.p_block != NULL )
+        block_Release( thumb.p_block );
+    video_format_Clean( &thumb.fmt );
+}
+
+static size_t TargetIndex( const request_t *req, size_t k )
+{
+    return req->p_targets != NULL ? req->p_targets[k].i_index : k;
+}
+
+/*****************************************************************************
+ * Requests
+ *****************************************************************************/
+
+/* Decodes until the first picture */
+static picture_t *DecodeNext( job_t *job, demux_t *p_demux,
+                              const request_t *req )
+{
+    unsigned i_probe = 0;
+
+    while( job->p_picture == NULL && !job->b_error
+        && !atomic_load( &req->b_cancelled ) )
+    {
+        const mtime_t i_pcr = job->i_pcr;
+        if( demux_Demux( p_demux ) != VLC_DEMUXER_SUCCESS )
+        {
+            Drain( job );
+            break;
+        }
+
+        /* The timestamps start anywhere (TS), and may jump: map them to
+         * the time of the demuxer each time the clock moves */
+        mtime_t i_time;
+        if( job->i_pcr != i_pcr && job->i_pcr > VLC_TS_INVALID &&
+            demux_Control( p_demux, DEMUX_GET_TIME, &i_time ) == VLC_SUCCESS )
+            job->i_start = job->i_pcr - i_time;
+        if( job->p_video == NULL && ++i_probe >= THUMBNAILER_PROBE_DEMUX )
+            break;
+    }
+
+    picture_t *p_pic = job->p_picture;
+    job->p_picture = NULL;
+    return p_pic;
+}
+
+static int Seek( demux_t *p_demux, const request_t *req, size_t k,
+                 mtime_t i_length )
+{
+    if( req->p_targets == NULL )
+        return demux_Control( p_demux, DEMUX_SET_POSITION,
+                              (k + .5) / req->i_count, false );
+
+    const mtime_t i_time = req->p_targets[k].i_time;
+    if( demux_Control( p_demux, DEMUX_SET_TIME, i_time, false ) == VLC_SUCCESS )
+        return VLC_SUCCESS;
+    if( i_length <= 0 )
+        return VLC_EGENERIC;
+    return demux_Control( p_demux, DEMUX_SET_POSITION,
+                          (double)i_time / i_length, false );
+}
+
+/* Returns the number of pictures processed */
+static size_t Extract( vlc_object_t *p_obj, request_t *req )
+{
+    job_t job = {
+        .out = {
+            .pf_add = EsOutAdd,
+            .pf_send = EsOutSend,
+            .pf_del = EsOutDel,
+            .pf_control = EsOutControl,
+            .pf_destroy = EsOutDestroy,
+        },
+        .p_obj = p_obj,
+        .i_pcr = VLC_TS_INVALID,
+        .i_start = VLC_TS_0,
+    };
+    size_t k = 0;
+
+    char *psz_mrl = input_item_GetURI( req->p_item );
+    if( psz_mrl == NULL )
+        return 0;
+
+    const char *psz_access, *psz_demux, *psz_path, *psz_anchor;
+    input_SplitMRL( &psz_access, &psz_demux, &psz_path, &psz_anchor, psz_mrl );
+
+    char *psz_url;
+    if( asprintf( &psz_url, "%s://%s", psz_access, psz_path ) < 0 )
+    {
+        free( psz_mrl );
+        return 0;
+    }
+
+    stream_t *s = stream_AccessNew( p_obj, NULL, false, psz_url );
+    free( psz_url );
+    if( s == NULL )
+    {
+        free( psz_mrl );
+        return 0;
+    }
+
+    demux_t *p_demux = demux_NewAdvanced( p_obj, NULL, psz_access, psz_demux,
+                                          psz_path, s, &job.out, false );
+    free( psz_mrl );
+    if( p_demux == NULL )
+    {
+        vlc_stream_Delete( s );
+        EsOutDestroy( &job.out );
+        return 0;
+    }
+
+    image_handler_t *p_image = image_HandlerCreate( p_obj );
+
+    mtime_t i_length;
+    if( demux_Control( p_demux, DEMUX_GET_LENGTH, &i_length ) != VLC_SUCCESS )
+        i_length = 0;
+
+    for( ; k < req->i_count && !atomic_load( &req->b_cancelled ); k++ )
+    {
+        /* No need to seek for a picture at the start */
+        if( req->p_targets == NULL || k > 0 || req->p_targets[k].i_time > 0 )
+        {
+            if( Seek( p_demux, req, k, i_length ) != VLC_SUCCESS )
+            {
+                msg_Dbg( p_obj, "cannot seek for picture %zu",
+                         TargetIndex( req, k ) );
+                Emit( req, NULL, TargetIndex( req, k ), NULL, VLC_TS_0 );
+                continue;
+            }
+            DecodersFlush( &job );
+        }
+
+        picture_t *p_pic = DecodeNext( &job, p_demux, req );
+        if( atomic_load( &req->b_cancelled ) )
+        {
+            if( p_pic != NULL )
+                picture_Release( p_pic );
+            break;
+        }
+
+        Emit( req, p_image, TargetIndex( req, k ), p_pic, job.i_start );
+        if( p_pic != NULL )
+            picture_Release( p_pic );
+
+        if( job.b_error )
+        {
+            msg_Warn( p_obj, "decoding error" );
+            k++;
+            break;
+        }
+    }
+
+    if( p_image != NULL )
+        image_HandlerDelete( p_image );
+    demux_Delete( p_demux );
+    EsOutDestroy( &job.out );
+    return k;
+}
+
+static void RequestDelete( request_t *req )
+{
+    input_item_Release( req->p_item );
+    free( req->p_targets );
+    free( req );
+}
+
+/* Reports the pictures not extracted */
+static void RequestFail( request_t *req, size_t i_from )
+{
+    for( size_t k = i_from; k < req->i_count; k++ )
+        Emit( req, NULL, TargetIndex( req, k ), NULL, VLC_TS_0 );
+}
+
+static void Process( vlc_thumbnailer_t *p_thumb, request_t *req )
+{
+    vlc_object_t *p_obj = vlc_custom_create( p_thumb->p_parent,
+                                             sizeof( *p_obj ), "thumbnailer" );
+    size_t i_done = 0;
+
+    if( likely(p_obj != NULL) )
+    {
+        /* Only key frames are needed, decoded in software and in a single
+         * thread, as many media are decoded in parallel */
+        var_Create( p_obj, "avcodec-skip-frame", VLC_VAR_INTEGER );
+        var_SetInteger( p_obj, "avcodec-skip-frame", 3 /* non-key */ );
+        var_Create( p_obj, "avcodec-hurry-up", VLC_VAR_BOOL );
+        var_Create( p_obj, "avcodec-hw", VLC_VAR_STRING );
+        var_SetString( p_obj, "avcodec-hw", "none" );
+        var_Create( p_obj, "avcodec-threads", VLC_VAR_INTEGER );
+        var_SetInteger( p_obj, "avcodec-threads", p_thumb->i_decoder_threads );
+        input_item_ApplyOptions( p_obj, req->p_item );
+
+        i_done = Extract( p_obj, req );
+        vlc_object_release( p_obj );
+    }
+    RequestFail( req, i_done );
+}
+
+static int CompareTargets( const void *a, const void *b )
+{
+    const target_t *ta = a, *tb = b;
+
+    if( ta->i_time != tb->i_time )
+        return ta->i_time < tb->i_time ? -1 : 1;
+    return ta->i_index < tb->i_index ? -1 : ta->i_index > tb->i_index;
+}
+
+int vlc_thumbnailer_Request( vlc_thumbnailer_t *p_thumb, input_item_t *p_item,
+                             const mtime_t *pi_times, size_t i_count,
+                             unsigned i_width, unsigned i_height,
+                             vlc_fourcc_t i_codec,
+                             vlc_thumbnailer_cb pf_cb, void *opaque )
+{
+    if( i_count == 0 )
+        return VLC_EGENERIC;
+
+    request_t *req = malloc( sizeof( *req ) );
+    if( unlikely(req == NULL) )
+        return VLC_ENOMEM;
+
+    req->p_targets = NULL;
+    if( pi_times != NULL )
+    {
+        if( unlikely(i_count > SIZE_MAX / sizeof( *req->p_targets )) )
+        {
+            free( req );
+            return VLC_ENOMEM;
+        }
+        req->p_targets = malloc( i_count * sizeof( *req->p_targets ) );
+        if( unlikely(req->p_targets == NULL) )
+        {
+            free( req );
+            return VLC_ENOMEM;
+        }
+        for( size_t i = 0; i < i_count; i++ )
+            req->p_targets[i] = (target_t){ pi_times[i], i };
+        qsort( req->p_targets, i_count, sizeof( *req->p_targets ),
+               CompareTargets );
+    }
+
+    req->p_next = NULL;
+    req->p_item = input_item_Hold( p_item );
+    req->i_count = i_count;
+    req->i_width = i_width;
+    req->i_height = i_height;
+    req->i_codec = i_codec;
+    req->pf_cb = pf_cb;
+    req->opaque = opaque;
+    atomic_init( &req->b_cancelled, false );
+
+    vlc_mutex_lock( &p_thumb->lock );
+    *p_thumb->pp_last = req;
+    p_thumb->pp_last = &req->p_next;
+    vlc_cond_signal( &p_thumb->wait );
+    vlc_mutex_unlock( &p_thumb->lock );
+    return VLC_SUCCESS;
+}
+
+void vlc_thumbnailer_Cancel( vlc_thumbnailer_t *p_thumb, input_item_t *p_item )
+{
+    request_t *p_cancelled = NULL;
+
+    vlc_mutex_lock( &p_thumb->lock );
+    /* Queued requests */
+    request_t **pp = &p_thumb->p_first;
+    while( *pp != NULL )
+    {
+        request_t *req = *pp;
+
+        if( p_item == NULL || req->p_item == p_item )
+        {
+            *pp = req->p_next;
+            req->p_next = p_cancelled;
+            p_cancelled = req;
+        }
+        else
+            pp = &req->p_next;
+    }
+    p_thumb->pp_last = pp;
+
+    /* Running requests */
+    for( unsigned i = 0; i < p_thumb->i_workers; i++ )
+    {
+        worker_t *w = &p_thumb->workers[i];
+
+        if( w->p_request != NULL
+         && (p_item == NULL || w->p_request->p_item == p_item) )
+        {
+            atomic_store( &w->p_request->b_cancelled, true );
+            if( w->p_interrupt != NULL )
+                vlc_interrupt_raise( w->p_interrupt );
+        }
+    }
+    vlc_mutex_unlock( &p_thumb->lock );
+
+    while( p_cancelled != NULL )
+    {
+        request_t *req = p_cancelled;
+
+        p_cancelled = req->p_next;
+        RequestFail( req, 0 );
+        RequestDelete( req );
+    }
+}
+
+/*****************************************************************************
+ * Workers
+ *****************************************************************************/
+
+static void *Worker( void *data )
+{
+    worker_t *w = data;
+    vlc_thumbnailer_t *p_thumb = w->p_thumb;
+
+    vlc_mutex_lock( &p_thumb->lock );
+    for( ;; )
+    {
+        while( p_thumb->p_first == NULL && !p_thumb->b_exit )
+            vlc_cond_wait( &p_thumb->wait, &p_thumb->lock );
+        if( p_thumb->b_exit )
+            break;
+
+        request_t *req = p_thumb->p_first;
+        p_thumb->p_first = req->p_next;
+        if( p_thumb->p_first == NULL )
+            p_thumb->pp_last = &p_thumb->p_first;
+
+        /* A fresh context, so that a late cancellation of the previous
+         * request does not interrupt this one */
+        vlc_interrupt_t *p_interrupt = vlc_interrupt_create();
+        w->p_request = req;
+        w->p_interrupt = p_interrupt;
+        vlc_mutex_unlock( &p_thumb->lock );
+
+        vlc_interrupt_set( p_interrupt );
+        Process( p_thumb, req );
+        vlc_interrupt_set( NULL );
+
+        vlc_mutex_lock( &p_thumb->lock );
+        w->p_request = NULL;
+        w->p_interrupt = NULL;
+        vlc_mutex_unlock( &p_thumb->lock );
+
+        if( p_interrupt != NULL )
+            vlc_interrupt_destroy( p_interrupt );
+        RequestDelete( req );
+
+        vlc_mutex_lock( &p_thumb->lock );
+    }
+    vlc_mutex_unlock( &p_thumb->lock );
+    return NULL;
+}
+
+static void Stop( vlc_thumbnailer_t *p_thumb, unsigned i_workers )
+{
+    vlc_mutex_lock( &p_thumb->lock );
+    p_thumb->b_exit = true;
+    vlc_cond_broadcast( &p_thumb->wait );
+    vlc_mutex_unlock( &p_thumb->lock );
+
+    for( unsigned i = 0; i < i_workers; i++ )
+        vlc_join( p_thumb->workers[i].thread, NULL );
+
+    /* The workers left without taking the requests queued meanwhile */
+    while( p_thumb->p_first != NULL )
+    {
+        request_t *req = p_thumb->p_first;
+
+        p_thumb->p_first = req->p_next;
+        RequestFail( req, 0 );
+        RequestDelete( req );
+    }
+    p_thumb->pp_last = &p_thumb->p_first;
+
+    vlc_cond_destroy( &p_thumb->wait );
+    vlc_mutex_destroy( &p_thumb->lock );
+    vlc_object_release( p_thumb->p_parent );
+    free( p_thumb );
+}
+
+#undef vlc_thumbnailer_New
+vlc_thumbnailer_t *vlc_thumbnailer_New( vlc_object_t *p_parent,
+                                        unsigned i_threads )
+{
+    const unsigned i_cpus = __MAX( vlc_GetCPUCount(), 1 );
+
+    if( i_threads == 0 )
+        i_threads = i_cpus;
+
+    vlc_thumbnailer_t *p_thumb = malloc( sizeof( *p_thumb )
+                                         + i_threads * sizeof( worker_t ) );
+    if( unlikely(p_thumb == NULL) )
+        return NULL;
+
+    p_thumb->p_parent = vlc_object_hold( p_parent );
+    vlc_mutex_init( &p_thumb->lock );
+    vlc_cond_init( &p_thumb->wait );
+    p_thumb->p_first = NULL;
+    p_thumb->pp_last = &p_thumb->p_first;
+    p_thumb->b_exit = false;
+    p_thumb->i_decoder_threads = __MAX( i_cpus / i_threads, 1 );
+    p_thumb->i_workers = i_threads;
+
+    for( unsigned i = 0; i < i_threads; i++ )
+    {
+        worker_t *w = &p_thumb->workers[i];
+
+        w->p_thumb = p_thumb;
+        w->p_request = NULL;
+        w->p_interrupt = NULL;
+        if( vlc_clone( &w->thread, Worker, w, VLC_THREAD_PRIORITY_LOW ) )
+        {
+            Stop( p_thumb, i );
+            return NULL;
+        }
+    }
+
+    msg_Dbg( p_parent, "thumbnailer started with %u workers", i_threads );
+    return p_thumb;
+}
+
+void vlc_thumbnailer_Delete( vlc_thumbnailer_t *p_thumb )
+{
+    vlc_thumbnailer_Cancel( p_thumb, NULL );
+    Stop( p_thumb, p_thumb->i_workers );
+}
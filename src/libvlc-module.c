@@ -532,6 +532,29 @@ static const char *const ppsz_pos_descriptions[] =
     "This defines the maximum input delay jitter that the synchronization " \
     "algorithms should try to compensate (in milliseconds)." )
 
+#define DECODER_FIFO_SIZE_TEXT N_("Decoder input budget (kB)")
+#define DECODER_FIFO_SIZE_LONGTEXT N_( \
+    "Maximum amount of data queued for each decoder, in kilobytes " \
+    "(0 for no limit)." )
+
+#define DECODER_FIFO_DURATION_TEXT N_("Decoder input duration budget (ms)")
+#define DECODER_FIFO_DURATION_LONGTEXT N_( \
+    "Maximum duration of the data queued for each decoder, in " \
+    "milliseconds (0 for no limit)." )
+
+#define DECODER_FIFO_POLICY_TEXT N_("Decoder input overflow")
+#define DECODER_FIFO_POLICY_LONGTEXT N_( \
+    "What to do when a real-time input exceeds the decoder input budget. " \
+    "Blocking the demuxer pushes the back-pressure to the access (e.g. " \
+    "TCP flow control); delaying it keeps the input responsive and only " \
+    "discards data at twice the budget. Inputs that can be paced always " \
+    "block." )
+
+static const int pi_decoder_fifo_policy_values[] = { 0, 1, 2 };
+static const char *const ppsz_decoder_fifo_policy_descriptions[] =
+{ N_("Discard the queued data"), N_("Block the demuxer"),
+  N_("Delay the demuxer") };
+
 #define NETSYNC_TEXT N_("Network synchronisation" )
 #define NETSYNC_LONGTEXT N_( "This allows you to remotely " \
         "synchronise clocks for server and client. The detailed settings " \
@@ -645,6 +668,11 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
 
+#define INPUT_SEEKINDEX_TEXT N_("Seek index cache")
+#define INPUT_SEEKINDEX_LONGTEXT N_( \
+    "Keep the seek points found by the demuxers of local files in the " \
+    "cache directory, so that the files need not be indexed again." )
+
 #define INPUT_RATE_TEXT N_("Playback speed")
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
@@ -947,6 +975,12 @@ static const char *const ppsz_prefres[] = {
     "multiple playlist item (automatically insert the gather stream output " \
     "if not specified)" )
 
+#define SOUT_OFFLINE_TEXT N_("Offline stream output")
+#define SOUT_OFFLINE_LONGTEXT N_( \
+    "Process the input as fast as possible, without clock nor buffering, " \
+    "and keep the stream timestamps. This is only used if all the outputs " \
+    "can control their pace (e.g. files).")
+
 #define SOUT_MUX_CACHING_TEXT N_("Stream output muxer caching (ms)")
 #define SOUT_MUX_CACHING_LONGTEXT N_( \
     "This allow you to configure the initial caching amount for stream output " \
@@ -1082,6 +1116,12 @@ static const char *const ppsz_prefres[] = {
     "all the processor time and render the whole system unresponsive which " \
     "might require a reboot of your machine.")
 
+#define THREADPOOL_TEXT N_("Worker threads")
+#define THREADPOOL_LONGTEXT N_( \
+    "Number of threads shared by the modules that split their work " \
+    "(video filters, muxers...) for all the inputs. " \
+    "0 means one per CPU.")
+
 #define PLAYLISTENQUEUE_TEXT N_( \
     "Enqueue items into playlist in one instance mode")
 #define PLAYLISTENQUEUE_LONGTEXT N_( \
@@ -1110,6 +1150,26 @@ static const char *const ppsz_prefres[] = {
 #define PREPARSE_TIMEOUT_LONGTEXT N_( \
     "Maximum time (in milliseconds) allowed to preparse an item" )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of items preparsed at the same time" )
+
+#define PREPARSE_HOST_THREADS_TEXT N_( "Preparsing threads per host" )
+#define PREPARSE_HOST_THREADS_LONGTEXT N_( \
+    "Maximum number of network items of the same host preparsed, or " \
+    "whose art is downloaded, at the same time (0 for no limit)" )
+
+#define FETCH_ART_THREADS_TEXT N_( "Art fetching threads" )
+#define FETCH_ART_THREADS_LONGTEXT N_( \
+    "Maximum number of items whose meta-data and art are searched, and " \
+    "of art being downloaded, at the same time" )
+
+#define PREPARSE_CACHE_TEXT N_( "Cache preparsing results" )
+#define PREPARSE_CACHE_LONGTEXT N_( \
+    "Store the meta-data and tracks of preparsed local files on disk, " \
+    "and reuse them as long as the file size and modification time " \
+    "are unchanged. The oldest entries are removed beyond 32 MiB." )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
 static const char *const psz_recursive_list[] = {
@@ -1750,6 +1810,8 @@ vlc_module_begin ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT, false )
         change_safe ()
+    add_bool( "input-seekindex", true,
+              INPUT_SEEKINDEX_TEXT, INPUT_SEEKINDEX_LONGTEXT, true )
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT, false )
 
@@ -1885,6 +1947,15 @@ vlc_module_begin ()
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
 
+    add_integer( "decoder-fifo-size", 400 * 1024, DECODER_FIFO_SIZE_TEXT,
+                 DECODER_FIFO_SIZE_LONGTEXT, true )
+    add_integer( "decoder-fifo-duration", 0, DECODER_FIFO_DURATION_TEXT,
+                 DECODER_FIFO_DURATION_LONGTEXT, true )
+    add_integer( "decoder-fifo-policy", 0, DECODER_FIFO_POLICY_TEXT,
+                 DECODER_FIFO_POLICY_LONGTEXT, true )
+        change_integer_list( pi_decoder_fifo_policy_values,
+                             ppsz_decoder_fifo_policy_descriptions )
+
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
 
@@ -1942,6 +2013,8 @@ vlc_module_begin ()
                                 SOUT_VIDEO_LONGTEXT, true )
     add_bool( "sout-spu", 1, SOUT_SPU_TEXT,
                                 SOUT_SPU_LONGTEXT, true )
+    add_bool( "sout-offline", false, SOUT_OFFLINE_TEXT,
+                                SOUT_OFFLINE_LONGTEXT, true )
     add_integer( "sout-mux-caching", 1500, SOUT_MUX_CACHING_TEXT,
                                 SOUT_MUX_CACHING_LONGTEXT, true )
 
@@ -2010,6 +2083,10 @@ vlc_module_begin ()
 
     set_section( N_("Performance options"), NULL )
 
+    add_integer( "threadpool-threads", 0, THREADPOOL_TEXT,
+                 THREADPOOL_LONGTEXT, true )
+        change_integer_range( 0, 1024 )
+
 #if defined (LIBVLC_USE_PTHREAD) && !defined (__APPLE__)
     add_bool( "rt-priority", false, RT_PRIORITY_TEXT,
               RT_PRIORITY_LONGTEXT, true )
@@ -2080,6 +2157,17 @@ vlc_module_begin ()
 
     add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
                  PREPARSE_TIMEOUT_LONGTEXT, false )
+    add_integer_with_range( "preparse-threads", 1, 1, 64,
+                            PREPARSE_THREADS_TEXT, PREPARSE_THREADS_LONGTEXT,
+                            true )
+    add_integer_with_range( "preparse-host-threads", 2, 0, 64,
+                            PREPARSE_HOST_THREADS_TEXT,
+                            PREPARSE_HOST_THREADS_LONGTEXT, true )
+    add_integer_with_range( "fetch-art-threads", 1, 1, 64,
+                            FETCH_ART_THREADS_TEXT, FETCH_ART_THREADS_LONGTEXT,
+                            true )
+    add_bool( "preparse-cache", true, PREPARSE_CACHE_TEXT,
+              PREPARSE_CACHE_LONGTEXT, true )
 
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
@@ -93,6 +93,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv = libvlc_priv (p_libvlc);
     priv->playlist = NULL;
     priv->p_vlm = NULL;
+    priv->threadpool = NULL;
 
     vlc_ExitInit( &priv->exit );
 
@@ -416,6 +417,9 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if (priv->parser != NULL)
         playlist_preparser_Delete(priv->parser);
 
+    if (priv->threadpool != NULL)
+        vlc_threadpool_Destroy(priv->threadpool);
+
     libvlc_InternalActionsClean( p_libvlc );
 
     /* Save the configuration */
@@ -189,6 +189,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     vlc_actions_t *actions; ///< Hotkeys handler
+    struct vlc_threadpool_t *threadpool; ///< Shared worker threads (or NULL)
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -203,6 +204,8 @@ int intf_InsertItem(libvlc_int_t *, const char *mrl, unsigned optc,
                     const char * const *optv, unsigned flags);
 void intf_DestroyAll( libvlc_int_t * );
 
+void vlc_threadpool_Destroy( struct vlc_threadpool_t * );
+
 #define libvlc_stats( o ) (libvlc_priv((VLC_OBJECT(o))->obj.libvlc)->b_stats)
 
 /*
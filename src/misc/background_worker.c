@@ -30,68 +30,130 @@
 struct bg_queued_item {
     void* id; /**< id associated with entity */
     void* entity; /**< the entity to process */
+    char* domain; /**< domain of the entity, or NULL */
     int timeout; /**< timeout duration in microseconds */
 };
 
+struct bg_task {
+    struct bg_queued_item* item; /**< the entity being processed */
+    mtime_t deadline; /**< deadline of the task */
+};
+
 struct background_worker {
     void* owner;
     struct background_worker_config conf;
 
     struct {
-        bool probe_request; /**< true if a probe is requested */
+        unsigned probe_request; /**< incremented when a probe is requested */
         vlc_mutex_t lock; /**< acquire to inspect members that follow */
         vlc_cond_t wait; /**< wait for update in terms of head */
-        mtime_t deadline; /**< deadline of the current task */
-        void* id; /**< id of the current task */
-        bool active; /**< true if there is an active thread */
+        vlc_array_t tasks; /**< running tasks */
+        unsigned threads; /**< number of threads */
+        mtime_t active_since; /**< start of the current busy period */
     } head;
 
     struct {
-        vlc_mutex_t lock; /**< acquire to inspect members that follow */
         vlc_array_t data; /**< queue of pending entities to process */
-    } tail;
+        size_t priority; /**< number of entities pushed with priority */
+    } tail; /**< protected by head.lock */
+
+    struct background_worker_stats stats; /**< protected by head.lock */
 };
 
-static void* Thread( void* data )
+static unsigned DomainTasks( struct background_worker* worker,
+                             const char* domain )
 {
-    struct background_worker* worker = data;
+    unsigned count = 0;
 
-    for( ;; )
+    for( size_t i = 0; i < vlc_array_count( &worker->head.tasks ); i++ )
     {
-        struct bg_queued_item* item = NULL;
-        void* handle;
+        struct bg_task* task = vlc_array_item_at_index( &worker->head.tasks, i );
 
-        vlc_mutex_lock( &worker->tail.lock );
-        {
-            if( vlc_array_count( &worker->tail.data ) )
-            {
-                item = vlc_array_item_at_index( &worker->tail.data, 0 );
-                handle = NULL;
+        if( task->item->domain && !strcmp( task->item->domain, domain ) )
+            count++;
+    }
+    return count;
+}
 
-                vlc_array_remove( &worker->tail.data, 0 );
-            }
+/* Takes the first pending entity whose domain is not busy */
+static struct bg_queued_item* QueuePop( struct background_worker* worker )
+{
+    for( size_t i = 0; i < vlc_array_count( &worker->tail.data ); i++ )
+    {
+        struct bg_queued_item* item =
+            vlc_array_item_at_index( &worker->tail.data, i );
 
-            vlc_mutex_lock( &worker->head.lock );
-            {
-                worker->head.deadline = INT64_MAX;
-                worker->head.active = item != NULL;
-                worker->head.id = item ? item->id : NULL;
+        if( item->domain && worker->conf.max_per_domain > 0 &&
+            DomainTasks( worker, item->domain ) >=
+                (unsigned)worker->conf.max_per_domain )
+            continue;
 
-                if( item && item->timeout > 0 )
-                    worker->head.deadline = mdate() + item->timeout * 1000;
-            }
-            vlc_cond_broadcast( &worker->head.wait );
-            vlc_mutex_unlock( &worker->head.lock );
-        }
-        vlc_mutex_unlock( &worker->tail.lock );
+        vlc_array_remove( &worker->tail.data, i );
+        if( i < worker->tail.priority )
+            worker->tail.priority--;
+        worker->stats.queued--;
+        return item;
+    }
+    return NULL;
+}
+
+static void QueuedItemRelease( struct background_worker* worker,
+                               struct bg_queued_item* item )
+{
+    worker->conf.pf_release( item->entity );
+    free( item->domain );
+    free( item );
+}
+
+static void TaskAdd( struct background_worker* worker, struct bg_task* task )
+{
+    if( vlc_array_count( &worker->head.tasks ) == 0 )
+        worker->head.active_since = mdate();
+
+    vlc_array_append( &worker->head.tasks, task );
+    worker->stats.running++;
+}
+
+static void TaskRemove( struct background_worker* worker, struct bg_task* task )
+{
+    vlc_array_remove( &worker->head.tasks,
+                      vlc_array_index_of_item( &worker->head.tasks, task ) );
+    worker->stats.running--;
+
+    if( vlc_array_count( &worker->head.tasks ) == 0 )
+        worker->stats.active += mdate() - worker->head.active_since;
+
+    vlc_cond_broadcast( &worker->head.wait );
+}
+
+static void* Thread( void* data )
+{
+    struct background_worker* worker = data;
+    struct bg_task task;
+
+    vlc_mutex_lock( &worker->head.lock );
+    for( ;; )
+    {
+        struct bg_queued_item* item = QueuePop( worker );
+        void* handle = NULL;
 
         if( item == NULL )
             break;
 
+        task.item = item;
+        task.deadline = INT64_MAX;
+        if( item->timeout > 0 )
+            task.deadline = mdate() + item->timeout * 1000;
+        TaskAdd( worker, &task );
+        vlc_mutex_unlock( &worker->head.lock );
+
         if( worker->conf.pf_start( worker->owner, item->entity, &handle ) )
         {
-            worker->conf.pf_release( item->entity );
-            free( item );
+            QueuedItemRelease( worker, item );
+
+            vlc_mutex_lock( &worker->head.lock );
+            worker->stats.failed++;
+            TaskRemove( worker, &task );
             continue;
         }
 
@@ -99,8 +161,8 @@ static void* Thread( void* data )
         {
             vlc_mutex_lock( &worker->head.lock );
 
-            bool const b_timeout = worker->head.deadline <= mdate();
-            worker->head.probe_request = false;
+            bool const b_timeout = task.deadline <= mdate();
+            unsigned const probe_request = worker->head.probe_request;
 
             vlc_mutex_unlock( &worker->head.lock );
 
@@ -108,28 +170,40 @@ static void* Thread( void* data )
                 worker->conf.pf_probe( worker->owner, handle ) )
             {
                 worker->conf.pf_stop( worker->owner, handle );
-                worker->conf.pf_release( item->entity );
-                free( item );
+
+                vlc_mutex_lock( &worker->head.lock );
+                if( b_timeout )
+                    worker->stats.stopped++;
+                else
+                    worker->stats.done++;
+                TaskRemove( worker, &task );
+                vlc_mutex_unlock( &worker->head.lock );
+
+                QueuedItemRelease( worker, item );
+                vlc_mutex_lock( &worker->head.lock );
                 break;
             }
 
             vlc_mutex_lock( &worker->head.lock );
-            if( worker->head.probe_request == false &&
-                worker->head.deadline > mdate() )
+            if( worker->head.probe_request == probe_request &&
+                task.deadline > mdate() )
             {
                 vlc_cond_timedwait( &worker->head.wait, &worker->head.lock,
-                                     worker->head.deadline );
+                                     task.deadline );
             }
             vlc_mutex_unlock( &worker->head.lock );
         }
     }
 
+    worker->head.threads--;
+    vlc_cond_broadcast( &worker->head.wait );
+    vlc_mutex_unlock( &worker->head.lock );
     return NULL;
 }
 
 static void BackgroundWorkerCancel( struct background_worker* worker, void* id)
 {
-    vlc_mutex_lock( &worker->tail.lock );
+    vlc_mutex_lock( &worker->head.lock );
     for( size_t i = 0; i < vlc_array_count( &worker->tail.data ); )
     {
         struct bg_queued_item* item =
@@ -138,20 +212,35 @@ static void BackgroundWorkerCancel( struct background_worker* worker, void* id)
         if( id == NULL || item->id == id )
         {
             vlc_array_remove( &worker->tail.data, i );
-            worker->conf.pf_release( item->entity );
-            free( item );
+            if( i < worker->tail.priority )
+                worker->tail.priority--;
+            worker->stats.queued--;
+            QueuedItemRelease( worker, item );
             continue;
         }
 
         ++i;
     }
-    vlc_mutex_unlock( &worker->tail.lock );
 
-    vlc_mutex_lock( &worker->head.lock );
-    while( ( id == NULL && worker->head.active )
-        || ( id != NULL && worker->head.id == id ) )
+    for( ;; )
     {
-        worker->head.deadline = VLC_TS_0;
+        bool found = false;
+
+        for( size_t i = 0; i < vlc_array_count( &worker->head.tasks ); i++ )
+        {
+            struct bg_task* task =
+                vlc_array_item_at_index( &worker->head.tasks, i );
+
+            if( id == NULL || task->item->id == id )
+            {
+                task->deadline = VLC_TS_0;
+                found = true;
+            }
+        }
+
+        if( !found )
+            break;
+
         vlc_cond_broadcast( &worker->head.wait );
         vlc_cond_wait( &worker->head.wait, &worker->head.lock );
     }
@@ -167,22 +256,26 @@ struct background_worker* background_worker_New( void* owner,
         return NULL;
 
     worker->conf = *conf;
+    if( worker->conf.max_threads < 1 )
+        worker->conf.max_threads = 1;
     worker->owner = owner;
-    worker->head.id = NULL;
-    worker->head.active = false;
-    worker->head.deadline = VLC_TS_INVALID;
+    worker->head.probe_request = 0;
+    worker->head.threads = 0;
+    worker->head.active_since = VLC_TS_INVALID;
+    memset( &worker->stats, 0, sizeof( worker->stats ) );
 
     vlc_mutex_init( &worker->head.lock );
     vlc_cond_init( &worker->head.wait );
+    vlc_array_init( &worker->head.tasks );
 
     vlc_array_init( &worker->tail.data );
-    vlc_mutex_init( &worker->tail.lock );
+    worker->tail.priority = 0;
 
     return worker;
 }
 
-int background_worker_Push( struct background_worker* worker, void* entity,
-                        void* id, int timeout )
+static int BackgroundWorkerPush( struct background_worker* worker,
+    void* entity, void* id, int timeout, bool priority )
 {
     struct bg_queued_item* item = malloc( sizeof( *item ) );
 
@@ -191,27 +284,47 @@ int background_worker_Push( struct background_worker* worker, void* entity,
 
     item->id = id;
     item->entity = entity;
+    item->domain = worker->conf.pf_domain
+                 ? worker->conf.pf_domain( worker->owner, entity ) : NULL;
     item->timeout = timeout < 0 ? worker->conf.default_timeout : timeout;
 
-    vlc_mutex_lock( &worker->tail.lock );
-    vlc_array_append( &worker->tail.data, item );
-    vlc_mutex_unlock( &worker->tail.lock );
-
     vlc_mutex_lock( &worker->head.lock );
-    if( worker->head.active == false )
+    if( worker->head.threads < (unsigned)worker->conf.max_threads &&
+        !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW ) )
+        worker->head.threads++;
+
+    if( worker->head.threads == 0 )
     {
-        worker->head.probe_request = false;
-        worker->head.active =
-            !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW );
+        vlc_mutex_unlock( &worker->head.lock );
+        free( item->domain );
+        free( item );
+        return VLC_EGENERIC;
     }
 
-    if( worker->head.active )
-        worker->conf.pf_hold( item->entity );
+    worker->conf.pf_hold( item->entity );
 
-    int ret = worker->head.active ? VLC_SUCCESS : VLC_EGENERIC;
+    if( priority )
+        vlc_array_insert( &worker->tail.data, item, worker->tail.priority++ );
+    else
+        vlc_array_append( &worker->tail.data, item );
+
+    if( ++worker->stats.queued > worker->stats.max_queued )
+        worker->stats.max_queued = worker->stats.queued;
     vlc_mutex_unlock( &worker->head.lock );
 
-    return ret;
+    return VLC_SUCCESS;
+}
+
+int background_worker_Push( struct background_worker* worker, void* entity,
+                        void* id, int timeout )
+{
+    return BackgroundWorkerPush( worker, entity, id, timeout, false );
+}
+
+int background_worker_PushPriority( struct background_worker* worker,
+    void* entity, void* id, int timeout )
+{
+    return BackgroundWorkerPush( worker, entity, id, timeout, true );
 }
 
 void background_worker_Cancel( struct background_worker* worker, void* id )
@@ -222,14 +335,34 @@ void background_worker_Cancel( struct background_worker* worker, void* id )
 void background_worker_RequestProbe( struct background_worker* worker )
 {
     vlc_mutex_lock( &worker->head.lock );
-    worker->head.probe_request = true;
+    worker->head.probe_request++;
     vlc_cond_broadcast( &worker->head.wait );
     vlc_mutex_unlock( &worker->head.lock );
 }
 
+void background_worker_GetStats( struct background_worker* worker,
+    struct background_worker_stats* stats )
+{
+    vlc_mutex_lock( &worker->head.lock );
+    *stats = worker->stats;
+    if( vlc_array_count( &worker->head.tasks ) > 0 )
+        stats->active += mdate() - worker->head.active_since;
+    vlc_mutex_unlock( &worker->head.lock );
+}
+
 void background_worker_Delete( struct background_worker* worker )
 {
     BackgroundWorkerCancel( worker, NULL );
+
+    /* Wait for the threads which are about to find the queue empty */
+    vlc_mutex_lock( &worker->head.lock );
+    while( worker->head.threads > 0 )
+        vlc_cond_wait( &worker->head.wait, &worker->head.lock );
+    vlc_mutex_unlock( &worker->head.lock );
+
+    vlc_array_clear( &worker->head.tasks );
     vlc_array_clear( &worker->tail.data );
+    vlc_cond_destroy( &worker->head.wait );
+    vlc_mutex_destroy( &worker->head.lock );
     free( worker );
 }
@@ -99,6 +99,47 @@ struct background_worker_config {
      * \parma handle the handle associated with the task to be stopped
      **/
     void( *pf_stop )( void* owner, void* handle );
+
+    /**
+     * Maximum number of tasks running at the same time
+     *
+     * Each running task is managed by its own thread. A value less-than 1 is
+     * treated as 1: the entities are then processed one at a time.
+     **/
+    int max_threads;
+
+    /**
+     * Maximum number of tasks of the same domain running at the same time
+     *
+     * This is only used if \ref pf_domain is set. A value less-than 1 denotes
+     * no limit other than \ref max_threads.
+     **/
+    int max_per_domain;
+
+    /**
+     * Get the domain of an entity
+     *
+     * This callback, if not `NULL`, is called when an entity is pushed, in
+     * order to limit the number of concurrent tasks sharing a resource, such
+     * as the network host of a remote item. Entities of a busy domain are
+     * passed over for later ones, without changing their order.
+     *
+     * \param owner the owner of the background-worker
+     * \param entity the entity being pushed
+     * \return a heap-allocated string naming the domain, which will be freed
+     *         by the background-worker, or `NULL` if no limit applies.
+     **/
+    char*( *pf_domain )( void* owner, void* entity );
+};
+
+struct background_worker_stats {
+    size_t queued; /**< number of pending entities */
+    size_t max_queued; /**< highest number of pending entities */
+    unsigned running; /**< number of running tasks */
+    uint64_t done; /**< number of tasks finished on their own */
+    uint64_t stopped; /**< number of tasks stopped on timeout or cancel */
+    uint64_t failed; /**< number of tasks which failed to start */
+    mtime_t active; /**< total time during which tasks were running */
 };
 
 /**
@@ -119,10 +160,10 @@ struct background_worker* background_worker_New( void* owner,
     struct background_worker_config* config );
 
 /**
- * Request the background-worker to probe the current task
+ * Request the background-worker to probe the current tasks
  *
  * This function is used to signal the background-worker that it should do
- * another probe to see whether the current task is still alive.
+ * another probe to see whether the current tasks are still alive.
  *
  * \warning Note that the function will not wait for the probing to finish, it
  *          will simply ask the background worker to recheck it as soon as
@@ -151,6 +192,17 @@ void background_worker_RequestProbe( struct background_worker* worker );
 int background_worker_Push( struct background_worker* worker, void* entity,
     void* id, int timeout );
 
+/**
+ * Push an entity ahead of the others
+ *
+ * This function works like \ref background_worker_Push, except that the
+ * entity is queued before the entities pushed without priority, such as the
+ * items visible in a view before the rest of a library being scanned.
+ * Entities pushed with priority are processed in the order they are received.
+ **/
+int background_worker_PushPriority( struct background_worker* worker,
+    void* entity, void* id, int timeout );
+
 /**
  * Remove entities from the background-worker
  *
@@ -163,19 +215,28 @@ int background_worker_Push( struct background_worker* worker, void* entity,
  *
  * \param worker the background-worker
  * \param id NULL if every entity shall be removed, and the currently running
- *        task (if any) shall be cancelled.
+ *        tasks (if any) shall be cancelled.
  **/
 void background_worker_Cancel( struct background_worker* worker, void* id );
 
+/**
+ * Get statistics of a background-worker
+ *
+ * \param worker the background-worker
+ * \param stats [out] the statistics since the creation of the worker
+ **/
+void background_worker_GetStats( struct background_worker* worker,
+    struct background_worker_stats* stats );
+
 /**
  * Delete a background-worker
  *
  * This function will destroy a background-worker created through \ref
- * background_worker_New. It will effectively stop the currently running task,
+ * background_worker_New. It will effectively stop the currently running tasks,
  * if any, and empty the queue of pending entities.
  *
- * \warning If there is a currently running task, the function will block until
- *          it has been stopped.
+ * \warning If there are currently running tasks, the function will block
+ *          until they have been stopped.
  *
  * \param worker the background-worker
  **/
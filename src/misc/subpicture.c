@@ -151,19 +151,27 @@ void subpicture_Update( subpicture_t *p_subpicture,
                         const video_format_t *p_fmt_src,
                         const video_format_t *p_fmt_dst,
                         mtime_t i_ts )
+{
+    subpicture_UpdateRegions( p_subpicture, p_fmt_src, p_fmt_dst, i_ts );
+}
+
+bool subpicture_UpdateRegions( subpicture_t *p_subpicture,
+                               const video_format_t *p_fmt_src,
+                               const video_format_t *p_fmt_dst,
+                               mtime_t i_ts )
 {
     subpicture_updater_t *p_upd = &p_subpicture->updater;
     subpicture_private_t *p_private = p_subpicture->p_private;
 
     if( !p_upd->pf_validate )
-        return;
+        return false;
     if( !p_upd->pf_validate( p_subpicture,
                           !video_format_IsSimilar( p_fmt_src,
                                                    &p_private->src ), p_fmt_src,
                           !video_format_IsSimilar( p_fmt_dst,
                                                    &p_private->dst ), p_fmt_dst,
                           i_ts ) )
-        return;
+        return false;
 
     subpicture_region_ChainDelete( p_subpicture->p_region );
     p_subpicture->p_region = NULL;
@@ -175,6 +183,7 @@ void subpicture_Update( subpicture_t *p_subpicture,
 
     video_format_Copy( &p_private->src, p_fmt_src );
     video_format_Copy( &p_private->dst, p_fmt_dst );
+    return true;
 }
 
 
@@ -203,7 +212,7 @@ void subpicture_region_private_Delete( subpicture_region_private_t *p_private )
     free( p_private );
 }
 
-subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
+static subpicture_region_t *RegionNew( const video_format_t *p_fmt )
 {
     subpicture_region_t *p_region = calloc( 1, sizeof(*p_region ) );
     if( !p_region )
@@ -232,7 +241,13 @@ subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
     p_region->i_alpha = 0xff;
     p_region->b_balanced_text = true;
 
-    if( p_fmt->i_chroma == VLC_CODEC_TEXT )
+    return p_region;
+}
+
+subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
+{
+    subpicture_region_t *p_region = RegionNew( p_fmt );
+    if( !p_region || p_fmt->i_chroma == VLC_CODEC_TEXT )
         return p_region;
 
     p_region->p_picture = picture_NewFromFormat( p_fmt );
@@ -246,6 +261,15 @@ subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
     return p_region;
 }
 
+subpicture_region_t *subpicture_region_NewPicture( const video_format_t *p_fmt,
+                                                   picture_t *p_picture )
+{
+    subpicture_region_t *p_region = RegionNew( p_fmt );
+    if( p_region )
+        p_region->p_picture = picture_Hold( p_picture );
+    return p_region;
+}
+
 void subpicture_region_Delete( subpicture_region_t *p_region )
 {
     if( !p_region )
@@ -29,3 +29,11 @@ struct subpicture_region_private_t {
 subpicture_region_private_t *subpicture_region_private_New(video_format_t *);
 void subpicture_region_private_Delete(subpicture_region_private_t *);
 
+/* Same as subpicture_Update(), returns true if the regions were recreated */
+bool subpicture_UpdateRegions(subpicture_t *, const video_format_t *src,
+                              const video_format_t *dst, mtime_t);
+
+/* Creates a region showing an already rendered picture (held, not copied) */
+subpicture_region_t *subpicture_region_NewPicture(const video_format_t *,
+                                                  picture_t *);
+
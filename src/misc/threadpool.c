@@ -0,0 +1,538 @@
+/*****************************************************************************
+ * threadpool.c: shared worker thread pool
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_interrupt.h>
+#include <vlc_threadpool.h>
+
+#include "../libvlc.h"
+
+/* Tasks of vlc_threadpool_Run() which do not need an allocation */
+#define RUN_STACK_TASKS 64
+
+typedef struct task_t task_t;
+
+struct task_t
+{
+    void (*pf_run)( void * );
+    void *data;
+
+    /* vlc_threadpool_Run() tasks */
+    void (*pf_run_index)( void *, unsigned, unsigned );
+    unsigned i_index;
+    unsigned i_count;
+
+    vlc_threadpool_group_t *group;
+    bool b_allocated;
+    task_t *p_next;
+};
+
+typedef struct
+{
+    task_t  *p_first;
+    task_t **pp_last;
+} task_queue_t;
+
+typedef struct
+{
+    vlc_threadpool_t *pool;
+    vlc_mutex_t       lock;
+    task_queue_t      queues[VLC_THREADPOOL_PRIORITIES];
+    vlc_thread_t      thread;
+} worker_t;
+
+struct vlc_threadpool_t
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;     /**< Signaled when a task is queued */
+    atomic_uint i_queued; /**< Tasks in all the queues (approximate) */
+    atomic_uint i_serial; /**< Incremented when a task is queued */
+    atomic_uint i_next;   /**< Round-robin queue for tasks without affinity */
+    bool        b_exit;
+
+    unsigned    i_workers;
+    worker_t    workers[];
+};
+
+struct vlc_threadpool_group_t
+{
+    vlc_threadpool_t *pool;
+    int               i_priority;
+
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;      /**< Signaled when no task is left */
+    unsigned    i_pending; /**< Queued and running tasks */
+    bool        b_interrupted;
+    atomic_bool b_cancelled;
+};
+
+static vlc_mutex_t pool_lock = VLC_STATIC_MUTEX;
+
+/*****************************************************************************
+ * Queues
+ *****************************************************************************/
+
+static void QueuePush( worker_t *w, int i_priority, task_t *task )
+{
+    task->p_next = NULL;
+
+    vlc_mutex_lock( &w->lock );
+    task_queue_t *q = &w->queues[i_priority];
+    *q->pp_last = task;
+    q->pp_last = &task->p_next;
+    vlc_mutex_unlock( &w->lock );
+}
+
+/* Removes the first task of a queue, or the first task of a group */
+static task_t *QueuePop( worker_t *w, int i_priority,
+                         const vlc_threadpool_group_t *group )
+{
+    task_queue_t *q = &w->queues[i_priority];
+    task_t *task;
+
+    vlc_mutex_lock( &w->lock );
+    task_t **pp = &q->p_first;
+    while( (task = *pp) != NULL && group != NULL && task->group != group )
+        pp = &task->p_next;
+    if( task != NULL )
+    {
+        *pp = task->p_next;
+        if( q->pp_last == &task->p_next )
+            q->pp_last = pp;
+    }
+    vlc_mutex_unlock( &w->lock );
+
+    if( task != NULL )
+        atomic_fetch_sub( &w->pool->i_queued, 1 );
+    return task;
+}
+
+/* Takes a task from the own queues of a worker first, then steals one from
+ * the other workers, by decreasing priority */
+static task_t *PopAny( vlc_threadpool_t *pool, unsigned i_worker )
+{
+    if( atomic_load( &pool->i_queued ) == 0 )
+        return NULL;
+
+    for( int i_prio = VLC_THREADPOOL_PRIORITIES - 1; i_prio >= 0; i_prio-- )
+        for( unsigned i = 0; i < pool->i_workers; i++ )
+        {
+            worker_t *w = &pool->workers[(i_worker + i) % pool->i_workers];
+            task_t *task = QueuePop( w, i_prio, NULL );
+            if( task != NULL )
+                return task;
+        }
+    return NULL;
+}
+
+static task_t *PopGroup( vlc_threadpool_group_t *group )
+{
+    vlc_threadpool_t *pool = group->pool;
+
+    if( atomic_load( &pool->i_queued ) == 0 )
+        return NULL;
+
+    for( unsigned i = 0; i < pool->i_workers; i++ )
+    {
+        task_t *task = QueuePop( &pool->workers[i], group->i_priority, group );
+        if( task != NULL )
+            return task;
+    }
+    return NULL;
+}
+
+/*****************************************************************************
+ * Tasks
+ *****************************************************************************/
+
+static void TaskDone( task_t *task )
+{
+    vlc_threadpool_group_t *group = task->group;
+
+    if( task->b_allocated )
+        free( task );
+
+    vlc_mutex_lock( &group->lock );
+    assert( group->i_pending > 0 );
+    if( --group->i_pending == 0 )
+        vlc_cond_broadcast( &group->wait );
+    vlc_mutex_unlock( &group->lock );
+}
+
+static void TaskRun( task_t *task )
+{
+    if( task->pf_run_index != NULL )
+        task->pf_run_index( task->data, task->i_index, task->i_count );
+    else
+        task->pf_run( task->data );
+    TaskDone( task );
+}
+
+static void TaskQueue( vlc_threadpool_group_t *group, task_t *task,
+                       int i_affinity )
+{
+    vlc_threadpool_t *pool = group->pool;
+    unsigned i_worker;
+
+    if( i_affinity >= 0 )
+        i_worker = (unsigned)i_affinity % pool->i_workers;
+    else
+        i_worker = atomic_fetch_add( &pool->i_next, 1 ) % pool->i_workers;
+
+    task->group = group;
+
+    vlc_mutex_lock( &group->lock );
+    group->i_pending++;
+    vlc_mutex_unlock( &group->lock );
+
+    QueuePush( &pool->workers[i_worker], group->i_priority, task );
+    atomic_fetch_add( &pool->i_queued, 1 );
+
+    vlc_mutex_lock( &pool->lock );
+    atomic_fetch_add( &pool->i_serial, 1 );
+    vlc_cond_signal( &pool->wait );
+    vlc_mutex_unlock( &pool->lock );
+}
+
+/*****************************************************************************
+ * Workers
+ *****************************************************************************/
+
+static void *Worker( void *data )
+{
+    worker_t *w = data;
+    vlc_threadpool_t *pool = w->pool;
+    const unsigned i_worker = w - pool->workers;
+
+    for( ;; )
+    {
+        /* Sleep only if no task was queued since the queues were scanned:
+         * the queued counter is updated outside of the queue locks, and
+         * must not make idle workers spin */
+        const unsigned i_serial = atomic_load( &pool->i_serial );
+        task_t *task = PopAny( pool, i_worker );
+        if( task != NULL )
+        {
+            TaskRun( task );
+            continue;
+        }
+
+        vlc_mutex_lock( &pool->lock );
+        while( atomic_load( &pool->i_serial ) == i_serial && !pool->b_exit )
+            vlc_cond_wait( &pool->wait, &pool->lock );
+        const bool b_exit = pool->b_exit;
+        vlc_mutex_unlock( &pool->lock );
+
+        if( b_exit )
+            break;
+    }
+    return NULL;
+}
+
+static vlc_threadpool_t *PoolNew( vlc_object_t *obj )
+{
+    int i_workers = var_InheritInteger( obj, "threadpool-threads" );
+    if( i_workers <= 0 )
+        i_workers = vlc_GetCPUCount();
+    if( i_workers <= 0 )
+        i_workers = 1;
+
+    vlc_threadpool_t *pool = malloc( sizeof( *pool )
+                                     + i_workers * sizeof( worker_t ) );
+    if( unlikely(pool == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &pool->lock );
+    vlc_cond_init( &pool->wait );
+    atomic_init( &pool->i_queued, 0 );
+    atomic_init( &pool->i_next, 0 );
+    atomic_init( &pool->i_serial, 0 );
+    pool->b_exit = false;
+    pool->i_workers = i_workers;
+
+    for( int i = 0; i < i_workers; i++ )
+    {
+        worker_t *w = &pool->workers[i];
+
+        w->pool = pool;
+        vlc_mutex_init( &w->lock );
+        for( int j = 0; j < VLC_THREADPOOL_PRIORITIES; j++ )
+        {
+            w->queues[j].p_first = NULL;
+            w->queues[j].pp_last = &w->queues[j].p_first;
+        }
+    }
+
+    for( int i = 0; i < i_workers; i++ )
+    {
+        if( vlc_clone( &pool->workers[i].thread, Worker, &pool->workers[i],
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            /* Stop the workers started so far */
+            vlc_mutex_lock( &pool->lock );
+            pool->b_exit = true;
+            vlc_cond_broadcast( &pool->wait );
+            vlc_mutex_unlock( &pool->lock );
+
+            while( i-- > 0 )
+                vlc_join( pool->workers[i].thread, NULL );
+            for( int j = 0; j < i_workers; j++ )
+                vlc_mutex_destroy( &pool->workers[j].lock );
+            vlc_cond_destroy( &pool->wait );
+            vlc_mutex_destroy( &pool->lock );
+            free( pool );
+            return NULL;
+        }
+    }
+
+    msg_Dbg( obj, "thread pool started with %u workers", pool->i_workers );
+    return pool;
+}
+
+void vlc_threadpool_Destroy( vlc_threadpool_t *pool )
+{
+    vlc_mutex_lock( &pool->lock );
+    pool->b_exit = true;
+    vlc_cond_broadcast( &pool->wait );
+    vlc_mutex_unlock( &pool->lock );
+
+    for( unsigned i = 0; i < pool->i_workers; i++ )
+    {
+        vlc_join( pool->workers[i].thread, NULL );
+        vlc_mutex_destroy( &pool->workers[i].lock );
+    }
+
+    assert( atomic_load( &pool->i_queued ) == 0 );
+    vlc_cond_destroy( &pool->wait );
+    vlc_mutex_destroy( &pool->lock );
+    free( pool );
+}
+
+#undef vlc_threadpool_Get
+vlc_threadpool_t *vlc_threadpool_Get( vlc_object_t *obj )
+{
+    libvlc_priv_t *priv = libvlc_priv( obj->obj.libvlc );
+
+    vlc_mutex_lock( &pool_lock );
+    if( priv->threadpool == NULL )
+        priv->threadpool = PoolNew( VLC_OBJECT(obj->obj.libvlc) );
+    vlc_threadpool_t *pool = priv->threadpool;
+    vlc_mutex_unlock( &pool_lock );
+
+    return pool;
+}
+
+unsigned vlc_threadpool_GetSize( const vlc_threadpool_t *pool )
+{
+    return pool->i_workers;
+}
+
+/*****************************************************************************
+ * Groups
+ *****************************************************************************/
+
+static void GroupInit( vlc_threadpool_group_t *group, vlc_threadpool_t *pool,
+                       int i_priority )
+{
+    assert( i_priority >= 0 && i_priority < VLC_THREADPOOL_PRIORITIES );
+
+    group->pool = pool;
+    group->i_priority = i_priority;
+    vlc_mutex_init( &group->lock );
+    vlc_cond_init( &group->wait );
+    group->i_pending = 0;
+    group->b_interrupted = false;
+    atomic_init( &group->b_cancelled, false );
+}
+
+static void GroupClean( vlc_threadpool_group_t *group )
+{
+    vlc_cond_destroy( &group->wait );
+    vlc_mutex_destroy( &group->lock );
+}
+
+static void GroupCancelQueued( vlc_threadpool_group_t *group )
+{
+    task_t *task;
+
+    atomic_store( &group->b_cancelled, true );
+    while( (task = PopGroup( group )) != NULL )
+        TaskDone( task );
+}
+
+static void GroupWaitRunning( vlc_threadpool_group_t *group )
+{
+    vlc_mutex_lock( &group->lock );
+    while( group->i_pending > 0 )
+        vlc_cond_wait( &group->wait, &group->lock );
+    vlc_mutex_unlock( &group->lock );
+}
+
+static void GroupInterrupt( void *data )
+{
+    vlc_threadpool_group_t *group = data;
+
+    vlc_mutex_lock( &group->lock );
+    group->b_interrupted = true;
+    vlc_cond_broadcast( &group->wait );
+    vlc_mutex_unlock( &group->lock );
+}
+
+vlc_threadpool_group_t *vlc_threadpool_group_New( vlc_threadpool_t *pool,
+                                                  int i_priority )
+{
+    vlc_threadpool_group_t *group = malloc( sizeof( *group ) );
+    if( likely(group != NULL) )
+        GroupInit( group, pool, i_priority );
+    return group;
+}
+
+void vlc_threadpool_group_Delete( vlc_threadpool_group_t *group )
+{
+    GroupCancelQueued( group );
+    GroupWaitRunning( group );
+    GroupClean( group );
+    free( group );
+}
+
+int vlc_threadpool_group_Submit( vlc_threadpool_group_t *group,
+                                 void (*pf_run)( void * ), void *data,
+                                 int i_affinity )
+{
+    task_t *task = malloc( sizeof( *task ) );
+    if( unlikely(task == NULL) )
+        return VLC_ENOMEM;
+
+    task->pf_run = pf_run;
+    task->data = data;
+    task->pf_run_index = NULL;
+    task->b_allocated = true;
+    TaskQueue( group, task, i_affinity );
+    return VLC_SUCCESS;
+}
+
+int vlc_threadpool_group_Wait( vlc_threadpool_group_t *group )
+{
+    vlc_interrupt_register( GroupInterrupt, group );
+
+    for( ;; )
+    {
+        vlc_mutex_lock( &group->lock );
+        const bool b_done = group->i_pending == 0;
+        const bool b_interrupted = group->b_interrupted;
+        vlc_mutex_unlock( &group->lock );
+
+        if( b_done )
+            break;
+        if( b_interrupted )
+        {
+            GroupCancelQueued( group );
+            GroupWaitRunning( group );
+            break;
+        }
+
+        /* Help rather than sleep */
+        task_t *task = PopGroup( group );
+        if( task != NULL )
+        {
+            TaskRun( task );
+            continue;
+        }
+
+        vlc_mutex_lock( &group->lock );
+        if( group->i_pending > 0 && !group->b_interrupted )
+            vlc_cond_wait( &group->wait, &group->lock );
+        vlc_mutex_unlock( &group->lock );
+    }
+
+    vlc_interrupt_unregister();
+
+    /* Ready for reuse */
+    vlc_mutex_lock( &group->lock );
+    group->b_interrupted = false;
+    vlc_mutex_unlock( &group->lock );
+    return atomic_exchange( &group->b_cancelled, false ) ? VLC_EGENERIC
+                                                         : VLC_SUCCESS;
+}
+
+void vlc_threadpool_group_Cancel( vlc_threadpool_group_t *group )
+{
+    GroupCancelQueued( group );
+}
+
+bool vlc_threadpool_group_IsCancelled( vlc_threadpool_group_t *group )
+{
+    return atomic_load( &group->b_cancelled );
+}
+
+int vlc_threadpool_Run( vlc_threadpool_t *pool, unsigned i_count,
+                        void (*pf_run)( void *, unsigned, unsigned ),
+                        void *opaque, int i_priority )
+{
+    if( i_count <= 1 )
+    {
+        for( unsigned i = 0; i < i_count; i++ )
+            pf_run( opaque, i, i_count );
+        return VLC_SUCCESS;
+    }
+
+    task_t stack_tasks[RUN_STACK_TASKS];
+    task_t *tasks = stack_tasks;
+    if( i_count > RUN_STACK_TASKS )
+    {
+        tasks = malloc( i_count * sizeof( *tasks ) );
+        if( unlikely(tasks == NULL) )
+            return VLC_ENOMEM;
+    }
+
+    vlc_threadpool_group_t group;
+    GroupInit( &group, pool, i_priority );
+
+    /* The first task is run by the calling thread right away */
+    for( unsigned i = 1; i < i_count; i++ )
+    {
+        task_t *task = &tasks[i];
+
+        task->pf_run = NULL;
+        task->data = opaque;
+        task->pf_run_index = pf_run;
+        task->i_index = i;
+        task->i_count = i_count;
+        task->b_allocated = false;
+        TaskQueue( &group, task, i );
+    }
+
+    pf_run( opaque, 0, i_count );
+
+    int i_ret = vlc_threadpool_group_Wait( &group );
+    GroupClean( &group );
+
+    if( tasks != stack_tasks )
+        free( tasks );
+    return i_ret;
+}
@@ -32,6 +32,7 @@
 #include <vlc_threads.h>
 #include <vlc_memstream.h>
 #include <vlc_meta_fetcher.h>
+#include <vlc_url.h>
 
 #include "art.h"
 #include "libvlc.h"
@@ -183,6 +184,14 @@ static int CheckArt( input_item_t* item )
     return error;
 }
 
+static int PushRequest( struct background_worker* worker,
+                        struct fetcher_request* req )
+{
+    if( req->options & META_REQUEST_OPTION_PRIORITY )
+        return background_worker_PushPriority( worker, req, NULL, 0 );
+    return background_worker_Push( worker, req, NULL, 0 );
+}
+
 static int SearchArt( playlist_fetcher_t* fetcher, input_item_t* item, int scope)
 {
     InvokeModule( fetcher, item, scope, "art finder" );
@@ -207,7 +216,7 @@ static int SearchByScope( playlist_fetcher_t* fetcher,
         ! SearchArt( fetcher, item, scope ) )
     {
         AddAlbumCache( fetcher, req->item, false );
-        if( !background_worker_Push( fetcher->downloader, req, NULL, 0 ) )
+        if( !PushRequest( fetcher->downloader, req ) )
             return VLC_SUCCESS;
     }
 
@@ -297,7 +306,7 @@ static void SearchLocal( playlist_fetcher_t* fetcher, struct fetcher_request* re
     if( var_InheritBool( fetcher->owner, "metadata-network-access" ) ||
         req->options & META_REQUEST_OPTION_SCOPE_NETWORK )
     {
-        if( background_worker_Push( fetcher->network, req, NULL, 0 ) )
+        if( PushRequest( fetcher->network, req ) )
             SetPreparsed( req );
     }
     else
@@ -399,8 +408,29 @@ DEF_STARTER(  SearchLocal, fetcher->local )
 DEF_STARTER(SearchNetwork, fetcher->network )
 DEF_STARTER(   Downloader, fetcher->downloader )
 
+/* Art downloads are limited per host */
+static char* RequestDomain( void* fetcher_, void* req_ )
+{
+    struct fetcher_request* req = req_;
+    char* psz_arturl = input_item_GetArtURL( req->item );
+    char* domain = NULL;
+    vlc_url_t url;
+    VLC_UNUSED( fetcher_ );
+
+    if( psz_arturl != NULL && vlc_UrlParse( &url, psz_arturl ) == VLC_SUCCESS )
+    {
+        if( url.psz_host != NULL )
+            domain = strdup( url.psz_host );
+        vlc_UrlClean( &url );
+    }
+    free( psz_arturl );
+
+    return domain;
+}
+
 static void WorkerInit( playlist_fetcher_t* fetcher,
-    struct background_worker** worker, int( *starter )( void*, void*, void** ) )
+    struct background_worker** worker, int( *starter )( void*, void*, void** ),
+    char*( *domain )( void*, void* ) )
 {
     struct background_worker_config conf = {
         .default_timeout = 0,
@@ -408,7 +438,11 @@ static void WorkerInit( playlist_fetcher_t* fetcher,
         .pf_probe = ProbeWorker,
         .pf_stop = CloseWorker,
         .pf_release = RequestRelease,
-        .pf_hold = RequestHold };
+        .pf_hold = RequestHold,
+        .max_threads = var_InheritInteger( fetcher->owner, "fetch-art-threads" ),
+        .max_per_domain = var_InheritInteger( fetcher->owner,
+                                              "preparse-host-threads" ),
+        .pf_domain = domain };
 
     *worker = background_worker_New( fetcher, &conf );
 }
@@ -422,9 +456,9 @@ playlist_fetcher_t* playlist_fetcher_New( vlc_object_t* owner )
 
     fetcher->owner = owner;
 
-    WorkerInit( fetcher, &fetcher->local, StartSearchLocal );
-    WorkerInit( fetcher, &fetcher->network, StartSearchNetwork );
-    WorkerInit( fetcher, &fetcher->downloader, StartDownloader );
+    WorkerInit( fetcher, &fetcher->local, StartSearchLocal, NULL );
+    WorkerInit( fetcher, &fetcher->network, StartSearchNetwork, NULL );
+    WorkerInit( fetcher, &fetcher->downloader, StartDownloader, RequestDomain );
 
     if( unlikely( !fetcher->local || !fetcher->network || !fetcher->downloader ) )
     {
@@ -462,7 +496,7 @@ int playlist_fetcher_Push( playlist_fetcher_t* fetcher, input_item_t* item,
     atomic_init( &req->refs, 1 );
     input_item_Hold( item );
 
-    if( background_worker_Push( fetcher->local, req, NULL, 0 ) )
+    if( PushRequest( fetcher->local, req ) )
         SetPreparsed( req );
 
     RequestRelease( req );
@@ -0,0 +1,754 @@
+/*****************************************************************************
+ * preparse_cache.c: on-disk cache of preparsing results
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_memstream.h>
+#include <vlc_meta.h>
+#include <vlc_url.h>
+
+#include "input/info.h"
+#include "input/item.h"
+#include "preparse_cache.h"
+
+/* Sub-directory of the user cache directory */
+#define CACHE_DIR "preparse"
+/* Magic of the cache entries: results may change with the modules */
+#define CACHE_STRING "preparse "PACKAGE_NAME" "PACKAGE_VERSION
+/* Sub-version number, to be bumped when the entry structure changes */
+#define CACHE_SUBVERSION_NUM 1
+/* Longest string of an entry (lyrics and descriptions may be long) */
+#define CACHE_STRING_MAX (1 << 20)
+/* Length of the entry names (hexadecimal MD5 digests) */
+#define CACHE_NAME_LEN 32
+
+static char *CacheDirPath( void )
+{
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_dir;
+
+    if( unlikely( psz_cachedir == NULL ) )
+        return NULL;
+    if( asprintf( &psz_dir, "%s"DIR_SEP CACHE_DIR, psz_cachedir ) == -1 )
+        psz_dir = NULL;
+    free( psz_cachedir );
+    return psz_dir;
+}
+
+int preparse_cache_Open( preparse_cache_entry_t *entry, input_item_t *item )
+{
+    struct md5_s md5;
+    struct stat st;
+    char *psz_file = NULL;
+
+    entry->psz_path = NULL;
+    entry->psz_uri = NULL;
+
+    InitMD5( &md5 );
+
+    vlc_mutex_lock( &item->lock );
+    if( item->i_type == ITEM_TYPE_FILE && !item->b_net
+     && item->psz_uri != NULL )
+    {
+        psz_file = vlc_uri2path( item->psz_uri );
+        entry->psz_uri = strdup( item->psz_uri );
+
+        /* Options may change the demuxer and thus the results */
+        AddMD5( &md5, item->psz_uri, strlen( item->psz_uri ) + 1 );
+        for( int i = 0; i < item->i_options; i++ )
+            AddMD5( &md5, item->ppsz_options[i],
+                    strlen( item->ppsz_options[i] ) + 1 );
+    }
+    vlc_mutex_unlock( &item->lock );
+
+    EndMD5( &md5 );
+
+    if( psz_file == NULL || entry->psz_uri == NULL
+     || vlc_stat( psz_file, &st ) || !S_ISREG( st.st_mode ) )
+        goto error;
+    free( psz_file );
+
+    entry->i_size = st.st_size;
+    entry->i_mtime = st.st_mtime;
+
+    char *psz_dir = CacheDirPath();
+    char *psz_hash = psz_md5_hash( &md5 );
+
+    if( psz_dir == NULL || psz_hash == NULL
+     || asprintf( &entry->psz_path, "%s"DIR_SEP"%s", psz_dir,
+                  psz_hash ) == -1 )
+        entry->psz_path = NULL;
+    free( psz_hash );
+    free( psz_dir );
+
+    if( entry->psz_path == NULL )
+    {
+        free( entry->psz_uri );
+        entry->psz_uri = NULL;
+        return VLC_ENOMEM;
+    }
+    return VLC_SUCCESS;
+
+error:
+    free( psz_file );
+    free( entry->psz_uri );
+    entry->psz_uri = NULL;
+    return VLC_EGENERIC;
+}
+
+void preparse_cache_Clean( preparse_cache_entry_t *entry )
+{
+    free( entry->psz_path );
+    free( entry->psz_uri );
+}
+
+/*****************************************************************************
+ * Loading
+ *****************************************************************************/
+
+static int LoadImmediate( void *out, block_t *in, size_t size )
+{
+    if( in->i_buffer < size )
+        return -1;
+
+    memcpy( out, in->p_buffer, size );
+    in->p_buffer += size;
+    in->i_buffer -= size;
+    return 0;
+}
+
+static int LoadString( const char **restrict p, block_t *in )
+{
+    uint32_t size;
+
+    if( LoadImmediate( &size, in, sizeof (size) ) || size > CACHE_STRING_MAX )
+        return -1;
+
+    if( size == 0 )
+    {
+        *p = NULL;
+        return 0;
+    }
+
+    const char *str = (const char *)in->p_buffer;
+
+    if( in->i_buffer < size || str[size - 1] != '\0' )
+        return -1;
+
+    in->p_buffer += size;
+    in->i_buffer -= size;
+    *p = str;
+    return 0;
+}
+
+#define LOAD_IMMEDIATE( a ) \
+    if( LoadImmediate( &(a), in, sizeof (a) ) ) \
+        goto error
+#define LOAD_STRING( a ) \
+    if( LoadString( &(a), in ) ) \
+        goto error
+
+static char *DupString( const char *str )
+{
+    return str != NULL ? strdup( str ) : NULL;
+}
+
+static int LoadMeta( vlc_meta_t *meta, block_t *in )
+{
+    uint32_t count;
+    const char *name, *value;
+
+    LOAD_IMMEDIATE( count );
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        uint32_t type;
+
+        LOAD_IMMEDIATE( type );
+        LOAD_STRING( value );
+        if( type >= VLC_META_TYPE_COUNT )
+            goto error;
+        if( value != NULL )
+            vlc_meta_Set( meta, type, value );
+    }
+
+    LOAD_IMMEDIATE( count );
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        LOAD_STRING( name );
+        LOAD_STRING( value );
+        if( name == NULL )
+            goto error;
+        vlc_meta_AddExtra( meta, name, value );
+    }
+    return 0;
+
+error:
+    return -1;
+}
+
+static info_category_t *LoadCategory( block_t *in )
+{
+    info_category_t *cat = NULL;
+    const char *name, *value;
+    uint32_t count;
+
+    LOAD_STRING( name );
+    LOAD_IMMEDIATE( count );
+    if( name == NULL || ( cat = info_category_New( name ) ) == NULL )
+        goto error;
+
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        LOAD_STRING( name );
+        LOAD_STRING( value );
+        if( name == NULL
+         || info_category_AddInfo( cat, name, "%s",
+                                   value ? value : "" ) == NULL )
+            goto error;
+    }
+    return cat;
+
+error:
+    if( cat != NULL )
+        info_category_Delete( cat );
+    return NULL;
+}
+
+static es_format_t *LoadEs( block_t *in )
+{
+    es_format_t *fmt = malloc( sizeof (*fmt) );
+    const char *language, *description, *encoding;
+    uint32_t cat;
+
+    if( unlikely( fmt == NULL ) )
+        return NULL;
+    es_format_Init( fmt, UNKNOWN_ES, 0 );
+
+    LOAD_IMMEDIATE( cat );
+    fmt->i_cat = cat;
+    LOAD_IMMEDIATE( fmt->i_codec );
+    LOAD_IMMEDIATE( fmt->i_original_fourcc );
+    LOAD_IMMEDIATE( fmt->i_id );
+    LOAD_IMMEDIATE( fmt->i_group );
+    LOAD_IMMEDIATE( fmt->i_priority );
+    LOAD_IMMEDIATE( fmt->i_bitrate );
+    LOAD_IMMEDIATE( fmt->i_profile );
+    LOAD_IMMEDIATE( fmt->i_level );
+    LOAD_STRING( language );
+    LOAD_STRING( description );
+
+    switch( fmt->i_cat )
+    {
+        case AUDIO_ES:
+            LOAD_IMMEDIATE( fmt->audio );
+            LOAD_IMMEDIATE( fmt->audio_replay_gain );
+            break;
+        case VIDEO_ES:
+            LOAD_IMMEDIATE( fmt->video );
+            fmt->video.p_palette = NULL;
+            break;
+        case SPU_ES:
+            LOAD_STRING( encoding );
+            LOAD_IMMEDIATE( fmt->subs );
+            fmt->subs.psz_encoding = DupString( encoding );
+            fmt->subs.p_style = NULL;
+            break;
+        case UNKNOWN_ES:
+        case DATA_ES:
+            break;
+        default:
+            goto error;
+    }
+
+    fmt->psz_language = DupString( language );
+    fmt->psz_description = DupString( description );
+    return fmt;
+
+error:
+    es_format_Clean( fmt );
+    free( fmt );
+    return NULL;
+}
+
+int preparse_cache_Load( const preparse_cache_entry_t *entry,
+                         input_item_t *item )
+{
+    block_t *file = block_FilePath( entry->psz_path, false );
+    if( file == NULL )
+        return VLC_EGENERIC;
+
+    block_t *in = file;
+    vlc_meta_t *meta = vlc_meta_New();
+    info_category_t **catv = NULL;
+    es_format_t **esv = NULL;
+    uint32_t catc = 0, esc = 0;
+    const char *uri;
+    char magic[sizeof (CACHE_STRING) - 1];
+    uint32_t marker;
+    uint64_t size;
+    int64_t mtime, duration;
+
+    if( unlikely( meta == NULL ) )
+        goto error;
+
+    /* Check the entry is for this version of this file */
+    if( LoadImmediate( magic, in, sizeof (magic) )
+     || memcmp( magic, CACHE_STRING, sizeof (magic) ) )
+        goto error;
+    LOAD_IMMEDIATE( marker );
+    if( marker != CACHE_SUBVERSION_NUM )
+        goto error;
+    LOAD_STRING( uri );
+    LOAD_IMMEDIATE( size );
+    LOAD_IMMEDIATE( mtime );
+    if( uri == NULL || strcmp( uri, entry->psz_uri )
+     || size != entry->i_size || mtime != entry->i_mtime )
+        goto error;
+
+    LOAD_IMMEDIATE( duration );
+    if( LoadMeta( meta, in ) )
+        goto error;
+
+    LOAD_IMMEDIATE( catc );
+    if( catc > in->i_buffer
+     || ( catc > 0 && ( catv = calloc( catc, sizeof (*catv) ) ) == NULL ) )
+        goto error;
+    for( uint32_t i = 0; i < catc; i++ )
+        if( ( catv[i] = LoadCategory( in ) ) == NULL )
+            goto error;
+
+    LOAD_IMMEDIATE( esc );
+    if( esc > in->i_buffer
+     || ( esc > 0 && ( esv = calloc( esc, sizeof (*esv) ) ) == NULL ) )
+        goto error;
+    for( uint32_t i = 0; i < esc; i++ )
+        if( ( esv[i] = LoadEs( in ) ) == NULL )
+            goto error;
+
+    if( in->i_buffer != 0 )
+        goto error;
+    block_Release( file );
+
+    /* The whole entry is valid: apply it */
+    input_item_SetDuration( item, duration );
+
+    for( int i = 0; i < VLC_META_TYPE_COUNT; i++ )
+    {
+        const char *value = vlc_meta_Get( meta, i );
+        if( value != NULL )
+            input_item_SetMeta( item, i, value );
+    }
+
+    char **names = vlc_meta_CopyExtraNames( meta );
+    if( names != NULL )
+    {
+        vlc_mutex_lock( &item->lock );
+        if( item->p_meta == NULL )
+            item->p_meta = vlc_meta_New();
+        for( char **name = names; *name != NULL; name++ )
+        {
+            if( item->p_meta != NULL )
+                vlc_meta_AddExtra( item->p_meta, *name,
+                                   vlc_meta_GetExtra( meta, *name ) );
+            free( *name );
+        }
+        vlc_mutex_unlock( &item->lock );
+        free( names );
+    }
+    vlc_meta_Delete( meta );
+
+    for( uint32_t i = 0; i < catc; i++ )
+        input_item_MergeInfos( item, catv[i] );
+    free( catv );
+
+    for( uint32_t i = 0; i < esc; i++ )
+    {
+        input_item_UpdateTracksInfo( item, esv[i] );
+        es_format_Clean( esv[i] );
+        free( esv[i] );
+    }
+    free( esv );
+    return VLC_SUCCESS;
+
+error:
+    for( uint32_t i = 0; catv != NULL && i < catc; i++ )
+        if( catv[i] != NULL )
+            info_category_Delete( catv[i] );
+    free( catv );
+    for( uint32_t i = 0; esv != NULL && i < esc; i++ )
+        if( esv[i] != NULL )
+        {
+            es_format_Clean( esv[i] );
+            free( esv[i] );
+        }
+    free( esv );
+    if( meta != NULL )
+        vlc_meta_Delete( meta );
+    block_Release( file );
+    /* Stale or corrupted: it would never be used again */
+    vlc_unlink( entry->psz_path );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Storing
+ *****************************************************************************/
+
+#define SAVE_IMMEDIATE( a ) \
+    vlc_memstream_write( ms, &(a), sizeof (a) )
+
+static void SaveString( struct vlc_memstream *ms, const char *str )
+{
+    size_t len = str != NULL ? strlen( str ) + 1 : 0;
+    uint32_t size = len <= CACHE_STRING_MAX ? len : 0;
+
+    SAVE_IMMEDIATE( size );
+    if( size > 0 )
+        vlc_memstream_write( ms, str, size );
+}
+
+#define SAVE_STRING( a ) \
+    SaveString( ms, (a) )
+
+static void SaveMeta( struct vlc_memstream *ms, vlc_meta_t *meta )
+{
+    uint32_t count = 0;
+
+    for( uint32_t i = 0; meta != NULL && i < VLC_META_TYPE_COUNT; i++ )
+        if( vlc_meta_Get( meta, i ) != NULL )
+            count++;
+    SAVE_IMMEDIATE( count );
+    for( uint32_t i = 0; meta != NULL && i < VLC_META_TYPE_COUNT; i++ )
+    {
+        const char *value = vlc_meta_Get( meta, i );
+        if( value != NULL )
+        {
+            SAVE_IMMEDIATE( i );
+            SAVE_STRING( value );
+        }
+    }
+
+    char **names = meta != NULL ? vlc_meta_CopyExtraNames( meta ) : NULL;
+
+    count = 0;
+    for( char **name = names; name != NULL && *name != NULL; name++ )
+        count++;
+    SAVE_IMMEDIATE( count );
+    for( char **name = names; name != NULL && *name != NULL; name++ )
+    {
+        SAVE_STRING( *name );
+        SAVE_STRING( vlc_meta_GetExtra( meta, *name ) );
+        free( *name );
+    }
+    free( names );
+}
+
+static void SaveCategory( struct vlc_memstream *ms,
+                          const info_category_t *cat )
+{
+    uint32_t count = cat->i_infos;
+
+    SAVE_STRING( cat->psz_name );
+    SAVE_IMMEDIATE( count );
+    for( int i = 0; i < cat->i_infos; i++ )
+    {
+        SAVE_STRING( cat->pp_infos[i]->psz_name );
+        SAVE_STRING( cat->pp_infos[i]->psz_value );
+    }
+}
+
+/* Decoder-specific data is not kept: only the description of the tracks */
+static void SaveEs( struct vlc_memstream *ms, const es_format_t *fmt )
+{
+    uint32_t cat = fmt->i_cat;
+
+    SAVE_IMMEDIATE( cat );
+    SAVE_IMMEDIATE( fmt->i_codec );
+    SAVE_IMMEDIATE( fmt->i_original_fourcc );
+    SAVE_IMMEDIATE( fmt->i_id );
+    SAVE_IMMEDIATE( fmt->i_group );
+    SAVE_IMMEDIATE( fmt->i_priority );
+    SAVE_IMMEDIATE( fmt->i_bitrate );
+    SAVE_IMMEDIATE( fmt->i_profile );
+    SAVE_IMMEDIATE( fmt->i_level );
+    SAVE_STRING( fmt->psz_language );
+    SAVE_STRING( fmt->psz_description );
+
+    switch( fmt->i_cat )
+    {
+        case AUDIO_ES:
+            SAVE_IMMEDIATE( fmt->audio );
+            SAVE_IMMEDIATE( fmt->audio_replay_gain );
+            break;
+        case VIDEO_ES:
+        {
+            video_format_t video = fmt->video;
+
+            video.p_palette = NULL;
+            SAVE_IMMEDIATE( video );
+            break;
+        }
+        case SPU_ES:
+        {
+            subs_format_t subs = fmt->subs;
+
+            SAVE_STRING( subs.psz_encoding );
+            subs.psz_encoding = NULL;
+            subs.p_style = NULL;
+            SAVE_IMMEDIATE( subs );
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static int CreateDir( vlc_object_t *obj, const char *psz_path )
+{
+    char *psz_dir = strdup( psz_path );
+    char *psz_sep;
+
+    if( unlikely( psz_dir == NULL ) )
+        return -1;
+
+    /* The user cache directory may not exist yet either */
+    for( psz_sep = strchr( psz_dir + 1, DIR_SEP_CHAR ); psz_sep != NULL;
+         psz_sep = strchr( psz_sep + 1, DIR_SEP_CHAR ) )
+    {
+        *psz_sep = '\0';
+        if( vlc_mkdir( psz_dir, 0700 ) && errno != EEXIST )
+        {
+            msg_Warn( obj, "cannot create %s: %s", psz_dir,
+                      vlc_strerror_c( errno ) );
+            free( psz_dir );
+            return -1;
+        }
+        *psz_sep = DIR_SEP_CHAR;
+    }
+    free( psz_dir );
+    return 0;
+}
+
+size_t preparse_cache_Store( vlc_object_t *obj,
+                             const preparse_cache_entry_t *entry,
+                             input_item_t *item )
+{
+    struct vlc_memstream stream, *ms = &stream;
+    uint32_t marker = CACHE_SUBVERSION_NUM;
+    int64_t duration;
+    size_t stored = 0;
+
+    if( vlc_memstream_open( ms ) )
+        return 0;
+
+    vlc_memstream_write( ms, CACHE_STRING, sizeof (CACHE_STRING) - 1 );
+    SAVE_IMMEDIATE( marker );
+    SAVE_STRING( entry->psz_uri );
+    SAVE_IMMEDIATE( entry->i_size );
+    SAVE_IMMEDIATE( entry->i_mtime );
+
+    vlc_mutex_lock( &item->lock );
+    /* Playlists and directories have no tracks: their sub-items are not
+     * cached */
+    if( item->i_es == 0 )
+    {
+        vlc_mutex_unlock( &item->lock );
+        if( !vlc_memstream_close( ms ) )
+            free( stream.ptr );
+        return 0;
+    }
+    duration = item->i_duration;
+    SAVE_IMMEDIATE( duration );
+    SaveMeta( ms, item->p_meta );
+
+    uint32_t count = item->i_categories;
+    SAVE_IMMEDIATE( count );
+    for( int i = 0; i < item->i_categories; i++ )
+        SaveCategory( ms, item->pp_categories[i] );
+
+    count = item->i_es;
+    SAVE_IMMEDIATE( count );
+    for( int i = 0; i < item->i_es; i++ )
+        SaveEs( ms, item->es[i] );
+    vlc_mutex_unlock( &item->lock );
+
+    if( vlc_memstream_close( ms ) )
+        return 0;
+
+    /* Do not store the results of a file changed while it was parsed */
+    char *psz_file = vlc_uri2path( entry->psz_uri );
+    char *psz_tmp = NULL;
+    struct stat st;
+
+    if( psz_file == NULL || vlc_stat( psz_file, &st )
+     || (uint64_t)st.st_size != entry->i_size
+     || st.st_mtime != entry->i_mtime )
+        goto out;
+
+    if( CreateDir( obj, entry->psz_path ) )
+        goto out;
+
+    /* Several threads may preparse the same file */
+    if( asprintf( &psz_tmp, "%s.%"PRIu32".%lu", entry->psz_path,
+                  (uint32_t)getpid(), vlc_thread_id() ) == -1 )
+    {
+        psz_tmp = NULL;
+        goto out;
+    }
+
+    FILE *file = vlc_fopen( psz_tmp, "wb" );
+    if( file == NULL )
+    {
+        msg_Warn( obj, "cannot create %s: %s", psz_tmp,
+                  vlc_strerror_c( errno ) );
+        goto out;
+    }
+
+    if( fwrite( stream.ptr, 1, stream.length, file ) != stream.length
+     || fflush( file ) )
+    {
+        msg_Warn( obj, "cannot write %s: %s", psz_tmp,
+                  vlc_strerror_c( errno ) );
+        fclose( file );
+        vlc_unlink( psz_tmp );
+        goto out;
+    }
+
+#if !defined( _WIN32 ) && !defined( __OS2__ )
+    /* atomically replace old entry */
+    if( vlc_rename( psz_tmp, entry->psz_path ) == 0 )
+        stored = stream.length;
+    fclose( file );
+#else
+    fclose( file );
+    vlc_unlink( entry->psz_path );
+    if( vlc_rename( psz_tmp, entry->psz_path ) == 0 )
+        stored = stream.length;
+#endif
+out:
+    free( psz_tmp );
+    free( psz_file );
+    free( stream.ptr );
+    return stored;
+}
+
+/*****************************************************************************
+ * Pruning
+ *****************************************************************************/
+
+struct cache_file
+{
+    char *psz_path;
+    time_t i_mtime;
+    size_t i_size;
+};
+
+static int CacheFileCmp( const void *a, const void *b )
+{
+    const struct cache_file *fa = a, *fb = b;
+
+    return ( fa->i_mtime > fb->i_mtime ) - ( fa->i_mtime < fb->i_mtime );
+}
+
+size_t preparse_cache_Prune( vlc_object_t *obj )
+{
+    char *psz_dir = CacheDirPath();
+    if( unlikely( psz_dir == NULL ) )
+        return 0;
+
+    DIR *dir = vlc_opendir( psz_dir );
+    if( dir == NULL )
+    {
+        free( psz_dir );
+        return 0;
+    }
+
+    struct cache_file *files = NULL;
+    size_t count = 0, alloc = 0, total = 0;
+    const char *psz_name;
+
+    while( ( psz_name = vlc_readdir( dir ) ) != NULL )
+    {
+        struct cache_file file;
+        struct stat st;
+
+        /* Entries only, not the ones being written */
+        if( strlen( psz_name ) != CACHE_NAME_LEN || strchr( psz_name, '.' ) )
+            continue;
+        if( asprintf( &file.psz_path, "%s"DIR_SEP"%s", psz_dir,
+                      psz_name ) == -1 )
+            break;
+        if( vlc_stat( file.psz_path, &st ) || !S_ISREG( st.st_mode ) )
+        {
+            free( file.psz_path );
+            continue;
+        }
+        file.i_mtime = st.st_mtime;
+        file.i_size = st.st_size;
+
+        if( count == alloc )
+        {
+            size_t n = alloc ? 2 * alloc : 64;
+            struct cache_file *grown = realloc( files, n * sizeof (*files) );
+            if( unlikely( grown == NULL ) )
+            {
+                free( file.psz_path );
+                break;
+            }
+            files = grown;
+            alloc = n;
+        }
+        files[count++] = file;
+        total += file.i_size;
+    }
+    closedir( dir );
+    free( psz_dir );
+
+    if( total > PREPARSE_CACHE_SIZE_MAX )
+    {
+        unsigned removed = 0;
+
+        /* Oldest first, with some margin not to rescan after each store */
+        qsort( files, count, sizeof (*files), CacheFileCmp );
+        for( size_t i = 0;
+             i < count && total > PREPARSE_CACHE_SIZE_MAX / 4 * 3; i++ )
+            if( vlc_unlink( files[i].psz_path ) == 0 )
+            {
+                total -= files[i].i_size;
+                removed++;
+            }
+        msg_Dbg( obj, "removed %u preparse cache entries", removed );
+    }
+
+    for( size_t i = 0; i < count; i++ )
+        free( files[i].psz_path );
+    free( files );
+    return total;
+}
@@ -0,0 +1,87 @@
+/*****************************************************************************
+ * preparse_cache.h: on-disk cache of preparsing results
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _PLAYLIST_PREPARSE_CACHE_H
+#define _PLAYLIST_PREPARSE_CACHE_H 1
+
+#include <vlc_input_item.h>
+
+/** Total size of the cache entries, beyond which they are pruned */
+#define PREPARSE_CACHE_SIZE_MAX (32 << 20)
+
+/**
+ * Cache entry of a local file.
+ *
+ * An entry records the meta-data, the information categories, the duration
+ * and the elementary streams of a preparsed item. It is only valid as long
+ * as the size and the modification time of the file are unchanged.
+ */
+typedef struct
+{
+    char *psz_path;  /**< path of the cache entry */
+    char *psz_uri;   /**< URI of the item, to detect hash collisions */
+    uint64_t i_size; /**< size of the file when the entry was looked up */
+    int64_t i_mtime; /**< modification time of the file, in seconds */
+} preparse_cache_entry_t;
+
+/**
+ * Looks up the cache entry of an item.
+ *
+ * Only regular local files can be cached. Their identity is taken at this
+ * point, so that a file modified while it is being parsed is not stored.
+ *
+ * @return VLC_SUCCESS if the item can be cached, an error otherwise
+ */
+int preparse_cache_Open( preparse_cache_entry_t *, input_item_t * );
+
+/**
+ * Releases the resources of a cache entry.
+ */
+void preparse_cache_Clean( preparse_cache_entry_t * );
+
+/**
+ * Fills an item from its cache entry.
+ *
+ * The item is left untouched if the entry does not exist, is corrupted or
+ * refers to another version of the file. Such an entry is removed.
+ *
+ * @return VLC_SUCCESS on cache hit, an error otherwise
+ */
+int preparse_cache_Load( const preparse_cache_entry_t *, input_item_t * );
+
+/**
+ * Stores the preparsing results of an item in its cache entry.
+ *
+ * @return the size of the entry, or 0 if it was not stored
+ */
+size_t preparse_cache_Store( vlc_object_t *, const preparse_cache_entry_t *,
+                             input_item_t * );
+
+/**
+ * Bounds the size of the cache.
+ *
+ * If the entries take more than PREPARSE_CACHE_SIZE_MAX bytes, the least
+ * recently stored ones are removed, down to three quarters of that size.
+ *
+ * @return the total size of the remaining entries
+ */
+size_t preparse_cache_Prune( vlc_object_t * );
+
+#endif
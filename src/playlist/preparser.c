@@ -24,11 +24,13 @@
 #endif
 
 #include <vlc_common.h>
+#include <vlc_url.h>
 
 #include "misc/background_worker.h"
 #include "input/input_interface.h"
 #include "input/input_internal.h"
 #include "preparser.h"
+#include "preparse_cache.h"
 #include "fetcher.h"
 
 struct playlist_preparser_t
@@ -37,6 +39,17 @@ struct playlist_preparser_t
     playlist_fetcher_t* fetcher;
     struct background_worker* worker;
     atomic_bool deactivated;
+    bool cache;
+    atomic_uint cache_hits;
+    atomic_size_t cache_size; /**< size of the cache, as last known */
+};
+
+struct preparser_task
+{
+    input_item_t* item;
+    input_thread_t* input; /**< NULL if the results were cached */
+    preparse_cache_entry_t entry;
+    bool cacheable;
 };
 
 static int InputEvent( vlc_object_t* obj, const char* varname,
@@ -53,57 +66,105 @@ static int InputEvent( vlc_object_t* obj, const char* varname,
 static int PreparserOpenInput( void* preparser_, void* item_, void** out )
 {
     playlist_preparser_t* preparser = preparser_;
+    struct preparser_task* task = malloc( sizeof *task );
 
-    input_thread_t* input = input_CreatePreparser( preparser->owner, item_ );
-    if( !input )
+    if( unlikely( !task ) )
     {
         input_item_SignalPreparseEnded( item_, ITEM_PREPARSE_FAILED );
-        return VLC_EGENERIC;
+        return VLC_ENOMEM;
+    }
+
+    task->item = item_;
+    task->input = NULL;
+    task->cacheable = preparser->cache
+        && !preparse_cache_Open( &task->entry, item_ );
+
+    if( task->cacheable && !preparse_cache_Load( &task->entry, item_ ) )
+    {
+        atomic_fetch_add( &preparser->cache_hits, 1 );
+        *out = task;
+        return VLC_SUCCESS;
     }
 
+    input_thread_t* input = input_CreatePreparser( preparser->owner, item_ );
+    if( !input )
+        goto error;
+
     var_AddCallback( input, "intf-event", InputEvent, preparser->worker );
     if( input_Start( input ) )
     {
         input_Close( input );
         var_DelCallback( input, "intf-event", InputEvent, preparser->worker );
-        input_item_SignalPreparseEnded( item_, ITEM_PREPARSE_FAILED );
-        return VLC_EGENERIC;
+        goto error;
     }
 
-    *out = input;
+    task->input = input;
+    *out = task;
     return VLC_SUCCESS;
+
+error:
+    if( task->cacheable )
+        preparse_cache_Clean( &task->entry );
+    free( task );
+    input_item_SignalPreparseEnded( item_, ITEM_PREPARSE_FAILED );
+    return VLC_EGENERIC;
 }
 
-static int PreparserProbeInput( void* preparser_, void* input_ )
+static int PreparserProbeInput( void* preparser_, void* task_ )
 {
-    int state = input_GetState( input_ );
+    struct preparser_task* task = task_;
+
+    if( task->input == NULL )
+        return true;
+
+    int state = input_GetState( task->input );
     return state == END_S || state == ERROR_S;
     VLC_UNUSED( preparser_ );
 }
 
-static void PreparserCloseInput( void* preparser_, void* input_ )
+static void PreparserCloseInput( void* preparser_, void* task_ )
 {
     playlist_preparser_t* preparser = preparser_;
-    input_thread_t* input = input_;
-    input_item_t* item = input_priv(input)->p_item;
+    struct preparser_task* task = task_;
+    input_thread_t* input = task->input;
+    input_item_t* item = task->item;
 
-    var_DelCallback( input, "intf-event", InputEvent, preparser->worker );
-
-    int status;
-    switch( input_GetState( input ) )
+    int status = ITEM_PREPARSE_DONE;
+    if( input != NULL )
     {
-        case END_S:
-            status = ITEM_PREPARSE_DONE;
-            break;
-        case ERROR_S:
-            status = ITEM_PREPARSE_FAILED;
-            break;
-        default:
-            status = ITEM_PREPARSE_TIMEOUT;
+        var_DelCallback( input, "intf-event", InputEvent, preparser->worker );
+
+        switch( input_GetState( input ) )
+        {
+            case END_S:
+                status = ITEM_PREPARSE_DONE;
+                break;
+            case ERROR_S:
+                status = ITEM_PREPARSE_FAILED;
+                break;
+            default:
+                status = ITEM_PREPARSE_TIMEOUT;
+        }
+
+        input_Stop( input );
+        input_Close( input );
+
+        if( task->cacheable && status == ITEM_PREPARSE_DONE )
+        {
+            size_t size = preparse_cache_Store( preparser->owner,
+                                                &task->entry, item );
+
+            /* Only scan the cache when it may be too large */
+            if( size > 0 && atomic_fetch_add( &preparser->cache_size, size )
+                            + size > PREPARSE_CACHE_SIZE_MAX )
+                atomic_store( &preparser->cache_size,
+                              preparse_cache_Prune( preparser->owner ) );
+        }
     }
 
-    input_Stop( input );
-    input_Close( input );
+    if( task->cacheable )
+        preparse_cache_Clean( &task->entry );
+    free( task );
 
     if( preparser->fetcher )
     {
@@ -118,6 +179,27 @@ static void PreparserCloseInput( void* preparser_, void* input_ )
 static void InputItemRelease( void* item ) { input_item_Release( item ); }
 static void InputItemHold( void* item ) { input_item_Hold( item ); }
 
+/* Network items are limited per host, local ones are not */
+static char* InputItemDomain( void* preparser_, void* item_ )
+{
+    input_item_t* item = item_;
+    char* domain = NULL;
+    vlc_url_t url;
+    VLC_UNUSED( preparser_ );
+
+    vlc_mutex_lock( &item->lock );
+    if( item->b_net && item->psz_uri != NULL
+     && vlc_UrlParse( &url, item->psz_uri ) == VLC_SUCCESS )
+    {
+        if( url.psz_host != NULL )
+            domain = strdup( url.psz_host );
+        vlc_UrlClean( &url );
+    }
+    vlc_mutex_unlock( &item->lock );
+
+    return domain;
+}
+
 playlist_preparser_t* playlist_preparser_New( vlc_object_t *parent )
 {
     playlist_preparser_t* preparser = malloc( sizeof *preparser );
@@ -128,7 +210,10 @@ playlist_preparser_t* playlist_preparser_New( vlc_object_t *parent )
         .pf_probe = PreparserProbeInput,
         .pf_stop = PreparserCloseInput,
         .pf_release = InputItemRelease,
-        .pf_hold = InputItemHold };
+        .pf_hold = InputItemHold,
+        .max_threads = var_InheritInteger( parent, "preparse-threads" ),
+        .max_per_domain = var_InheritInteger( parent, "preparse-host-threads" ),
+        .pf_domain = InputItemDomain };
 
 
     if( likely( preparser ) )
@@ -143,6 +228,10 @@ playlist_preparser_t* playlist_preparser_New( vlc_object_t *parent )
     preparser->owner = parent;
     preparser->fetcher = playlist_fetcher_New( parent );
     atomic_init( &preparser->deactivated, false );
+    preparser->cache = var_InheritBool( parent, "preparse-cache" );
+    atomic_init( &preparser->cache_hits, 0 );
+    /* Unknown, scanned on the first store */
+    atomic_init( &preparser->cache_size, PREPARSE_CACHE_SIZE_MAX );
 
     if( unlikely( !preparser->fetcher ) )
         msg_Warn( parent, "unable to create art fetcher" );
@@ -175,7 +264,10 @@ void playlist_preparser_Push( playlist_preparser_t *preparser,
             return;
     }
 
-    if( background_worker_Push( preparser->worker, item, id, timeout ) )
+    int ret = i_options & META_REQUEST_OPTION_PRIORITY
+            ? background_worker_PushPriority( preparser->worker, item, id, timeout )
+            : background_worker_Push( preparser->worker, item, id, timeout );
+    if( ret )
         input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
 }
 
@@ -199,6 +291,18 @@ void playlist_preparser_Deactivate( playlist_preparser_t* preparser )
 
 void playlist_preparser_Delete( playlist_preparser_t *preparser )
 {
+    struct background_worker_stats stats;
+
+    background_worker_GetStats( preparser->worker, &stats );
+    if( stats.done + stats.stopped + stats.failed > 0 )
+        msg_Dbg( preparser->owner, "preparsed %"PRIu64" items (%"PRIu64
+                 " timed out, %"PRIu64" failed) at %.1f items/s, "
+                 "up to %zu queued, %u from the cache", stats.done,
+                 stats.stopped, stats.failed,
+                 stats.active > 0 ? (stats.done + stats.stopped) *
+                     (double)CLOCK_FREQ / stats.active : 0.,
+                 stats.max_queued, atomic_load( &preparser->cache_hits ) );
+
     background_worker_Delete( preparser->worker );
 
     if( preparser->fetcher )
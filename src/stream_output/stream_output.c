@@ -115,6 +115,8 @@ sout_instance_t *sout_NewInstance( vlc_object_t *p_parent, const char *psz_dest
     p_sout->p_stream = NULL;
 
     var_Create( p_sout, "sout-mux-caching", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
+    /* pictures decoded by the stream outputs (transcode) */
+    var_Create( p_sout, "sout-decoded-video", VLC_VAR_INTEGER );
 
     p_sout->p_stream = sout_StreamChainNew( p_sout, psz_chain, NULL, NULL );
     if( p_sout->p_stream )
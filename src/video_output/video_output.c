@@ -1009,25 +1009,35 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
      */
     bool is_direct = vout->p->decoder_pool == vout->p->display_pool;
     picture_t *todisplay = filtered;
+    subpicture_t *subpic_early = NULL;
     if (do_early_spu && subpic) {
-        if (vout->p->spu_blend) {
-            picture_t *blent = picture_pool_Get(vout->p->private_pool);
-            if (blent) {
-                VideoFormatCopyCropAr(&blent->format, &filtered->format);
-                picture_Copy(blent, filtered);
-                if (picture_BlendSubpicture(blent, vout->p->spu_blend, subpic)) {
-                    picture_Release(todisplay);
-                    todisplay = blent;
-                } else
-                    picture_Release(blent);
-            }
-        }
-        subpicture_Delete(subpic);
+        if (vout->p->spu_blend)
+            subpic_early = subpic;
+        else
+            subpicture_Delete(subpic);
         subpic = NULL;
     }
 
+    /* The subpicture is blent in place into a picture nobody else can see
+     * (the output of the interactive filters or the copy to the display
+     * pool). The decoded picture may still be read by the decoder or
+     * displayed again, so it is only blent into a private copy. */
     assert(vout_IsDisplayFiltered(vd) == !sys->display.use_dr);
-    if (sys->display.use_dr && !is_direct) {
+    const bool copy_to_direct = sys->display.use_dr && !is_direct;
+    if (subpic_early && !copy_to_direct && picture_IsReferenced(todisplay)) {
+        picture_t *blent = picture_pool_Get(vout->p->private_pool);
+        if (blent) {
+            VideoFormatCopyCropAr(&blent->format, &filtered->format);
+            picture_Copy(blent, filtered);
+            picture_Release(todisplay);
+            todisplay = blent;
+        } else {
+            subpicture_Delete(subpic_early);
+            subpic_early = NULL;
+        }
+    }
+
+    if (copy_to_direct) {
         picture_t *direct = NULL;
         if (likely(vout->p->display_pool != NULL))
             direct = picture_pool_Get(vout->p->display_pool);
@@ -1035,6 +1045,8 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
             picture_Release(todisplay);
             if (subpic)
                 subpicture_Delete(subpic);
+            if (subpic_early)
+                subpicture_Delete(subpic_early);
             return VLC_EGENERIC;
         }
 
@@ -1048,6 +1060,11 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
         todisplay = direct;
     }
 
+    if (subpic_early) {
+        picture_BlendSubpicture(todisplay, vout->p->spu_blend, subpic_early);
+        subpicture_Delete(subpic_early);
+    }
+
     /*
      * Take a snapshot if requested
      */
@@ -59,8 +59,12 @@ typedef struct {
 
 typedef struct {
     spu_heap_entry_t entry[VOUT_MAX_SUBPICTURES];
+    unsigned         generation;   /**< incremented on subpicture deletion */
 } spu_heap_t;
 
+/* Maximum length of the chroma list of a cached render */
+#define SPU_CACHE_CHROMAS (16)
+
 struct spu_private_t {
     vlc_mutex_t  lock;            /* lock to protect all followings fields */
     vlc_object_t *input;
@@ -93,6 +97,18 @@ struct spu_private_t {
     vlc_mutex_t    filter_chain_lock;
     filter_chain_t *filter_chain;
 
+    /* Last rendered output, reused as long as neither the selected
+     * subpictures nor the output format change */
+    struct {
+        subpicture_t   *output;
+        unsigned       generation;
+        unsigned       count;
+        subpicture_t   *subpicture[VOUT_MAX_SUBPICTURES];
+        video_format_t fmt_dst;
+        video_format_t fmt_src;
+        vlc_fourcc_t   chroma[SPU_CACHE_CHROMAS];
+    } cache;
+
     /* */
     mtime_t             last_sort_date;
     vout_thread_t       *vout;
@@ -109,6 +125,7 @@ static void SpuHeapInit(spu_heap_t *heap)
         e->subpicture = NULL;
         e->reject     = false;
     }
+    heap->generation = 0;
 }
 
 static int SpuHeapPush(spu_heap_t *heap, subpicture_t *subpic)
@@ -130,8 +147,10 @@ static void SpuHeapDeleteAt(spu_heap_t *heap, int index)
 {
     spu_heap_entry_t *e = &heap->entry[index];
 
-    if (e->subpicture)
+    if (e->subpicture) {
         subpicture_Delete(e->subpicture);
+        heap->generation++;
+    }
 
     e->subpicture = NULL;
 }
@@ -956,14 +975,12 @@ static void SpuRenderRegion(spu_t *spu,
         }
     }
 
-    subpicture_region_t *dst = *dst_ptr = subpicture_region_New(&region_fmt);
+    subpicture_region_t *dst = *dst_ptr =
+        subpicture_region_NewPicture(&region_fmt, region_picture);
     if (dst) {
         dst->i_x       = x_offset;
         dst->i_y       = y_offset;
         dst->i_align   = 0;
-        if (dst->p_picture)
-            picture_Release(dst->p_picture);
-        dst->p_picture = picture_Hold(region_picture);
         int fade_alpha = 255;
         if (subpic->b_fade) {
             mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
@@ -1134,6 +1151,143 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
     return output;
 }
 
+/*****************************************************************************
+ * Render cache
+ *****************************************************************************/
+static void SpuCacheReset(spu_private_t *sys)
+{
+    if (sys->cache.output)
+        subpicture_Delete(sys->cache.output);
+    sys->cache.output = NULL;
+    sys->cache.count  = 0;
+}
+
+/**
+ * Tells if rendering a subpicture twice gives the same result.
+ */
+static bool SpuIsStatic(const subpicture_t *subpic, mtime_t render_date)
+{
+    /* Fading changes the alpha on every frame */
+    if (subpic->b_fade) {
+        mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
+
+        if (fade_start <= render_date && fade_start < subpic->i_stop)
+            return false;
+    }
+
+    /* Subtitles are placed on their first rendering */
+    if (subpic->b_subtitle && !subpic->b_absolute)
+        return false;
+
+    /* Text not rendered yet, or rendered on every frame (karaoke) */
+    for (const subpicture_region_t *r = subpic->p_region; r != NULL; r = r->p_next) {
+        if (r->fmt.i_chroma == VLC_CODEC_TEXT)
+            return false;
+    }
+    return true;
+}
+
+static bool SpuFormatIsSame(const video_format_t *a, const video_format_t *b)
+{
+    return a->i_chroma         == b->i_chroma &&
+           a->i_width          == b->i_width &&
+           a->i_height         == b->i_height &&
+           a->i_x_offset       == b->i_x_offset &&
+           a->i_y_offset       == b->i_y_offset &&
+           a->i_visible_width  == b->i_visible_width &&
+           a->i_visible_height == b->i_visible_height &&
+           a->i_sar_num        == b->i_sar_num &&
+           a->i_sar_den        == b->i_sar_den &&
+           a->orientation      == b->orientation;
+}
+
+static bool SpuCacheMatch(spu_private_t *sys,
+                          unsigned int i_subpicture,
+                          subpicture_t **pp_subpicture,
+                          const vlc_fourcc_t *chroma_list,
+                          const video_format_t *fmt_dst,
+                          const video_format_t *fmt_src)
+{
+    if (!sys->cache.output ||
+        sys->cache.generation != sys->heap.generation ||
+        sys->cache.count != i_subpicture)
+        return false;
+
+    for (unsigned i = 0; i < i_subpicture; i++) {
+        if (sys->cache.subpicture[i] != pp_subpicture[i])
+            return false;
+    }
+    for (unsigned i = 0; ; i++) {
+        if (i >= SPU_CACHE_CHROMAS || sys->cache.chroma[i] != chroma_list[i])
+            return false;
+        if (chroma_list[i] == 0)
+            break;
+    }
+    return SpuFormatIsSame(&sys->cache.fmt_dst, fmt_dst) &&
+           SpuFormatIsSame(&sys->cache.fmt_src, fmt_src);
+}
+
+/**
+ * Creates a new output sharing the rendered pictures of another one.
+ */
+static subpicture_t *SpuOutputClone(const subpicture_t *src)
+{
+    subpicture_t *dst = subpicture_New(NULL);
+    if (!dst)
+        return NULL;
+    dst->i_order = src->i_order;
+    dst->i_original_picture_width  = src->i_original_picture_width;
+    dst->i_original_picture_height = src->i_original_picture_height;
+
+    subpicture_region_t **last_ptr = &dst->p_region;
+    for (const subpicture_region_t *r = src->p_region; r != NULL; r = r->p_next) {
+        subpicture_region_t *copy = subpicture_region_NewPicture(&r->fmt, r->p_picture);
+        if (!copy) {
+            subpicture_Delete(dst);
+            return NULL;
+        }
+        copy->i_x     = r->i_x;
+        copy->i_y     = r->i_y;
+        copy->i_align = r->i_align;
+        copy->i_alpha = r->i_alpha;
+
+        *last_ptr = copy;
+        last_ptr  = &copy->p_next;
+    }
+    return dst;
+}
+
+static void SpuCacheStore(spu_private_t *sys,
+                          unsigned int i_subpicture,
+                          subpicture_t **pp_subpicture,
+                          const vlc_fourcc_t *chroma_list,
+                          const video_format_t *fmt_dst,
+                          const video_format_t *fmt_src,
+                          const subpicture_t *output)
+{
+    unsigned i;
+
+    for (i = 0; i < SPU_CACHE_CHROMAS; i++) {
+        sys->cache.chroma[i] = chroma_list[i];
+        if (chroma_list[i] == 0)
+            break;
+    }
+    if (i >= SPU_CACHE_CHROMAS)
+        return;
+
+    sys->cache.output = SpuOutputClone(output);
+    if (!sys->cache.output)
+        return;
+    sys->cache.generation = sys->heap.generation;
+    sys->cache.count      = i_subpicture;
+    memcpy(sys->cache.subpicture, pp_subpicture,
+           i_subpicture * sizeof(*pp_subpicture));
+    sys->cache.fmt_dst = *fmt_dst;
+    sys->cache.fmt_dst.p_palette = NULL;
+    sys->cache.fmt_src = *fmt_src;
+    sys->cache.fmt_src.p_palette = NULL;
+}
+
 /*****************************************************************************
  * Object variables callbacks
  *****************************************************************************/
@@ -1151,6 +1305,7 @@ static void UpdateSPU(spu_t *spu, vlc_object_t *object)
 
     vlc_mutex_lock(&sys->lock);
 
+    SpuCacheReset(sys);
     sys->force_palette = false;
     sys->force_crop = false;
 
@@ -1297,6 +1452,8 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
     vlc_mutex_init(&sys->lock);
 
     SpuHeapInit(&sys->heap);
+    sys->cache.output = NULL;
+    sys->cache.count  = 0;
 
     sys->text = NULL;
     sys->scale = NULL;
@@ -1369,6 +1526,7 @@ void spu_Destroy(spu_t *spu)
     free(sys->filter_chain_update);
 
     /* Destroy all remaining subpictures */
+    SpuCacheReset(sys);
     SpuHeapClean(&sys->heap);
 
     vlc_mutex_destroy(&sys->lock);
@@ -1588,15 +1746,31 @@ subpicture_t *spu_Render(spu_t *spu,
     /* Updates the subpictures */
     for (unsigned i = 0; i < subpicture_count; i++) {
         subpicture_t *subpic = subpicture_array[i];
-        subpicture_Update(subpic,
-                          fmt_src, fmt_dst,
-                          subpic->b_subtitle ? render_subtitle_date : render_osd_date);
+        if (subpicture_UpdateRegions(subpic,
+                                     fmt_src, fmt_dst,
+                                     subpic->b_subtitle ? render_subtitle_date : render_osd_date))
+            sys->heap.generation++;
     }
 
     /* Now order the subpicture array
      * XXX The order is *really* important for overlap subtitles positionning */
     qsort(subpicture_array, subpicture_count, sizeof(*subpicture_array), SubpictureCmp);
 
+    /* Reuse the previous rendering if nothing changed */
+    bool is_static = true;
+    for (unsigned i = 0; i < subpicture_count && is_static; i++) {
+        subpicture_t *subpic = subpicture_array[i];
+        is_static = SpuIsStatic(subpic, subpic->b_subtitle ? render_subtitle_date
+                                                           : render_osd_date);
+    }
+    if (is_static && SpuCacheMatch(sys, subpicture_count, subpicture_array,
+                                   chroma_list, fmt_dst, fmt_src)) {
+        subpicture_t *render = SpuOutputClone(sys->cache.output);
+        vlc_mutex_unlock(&sys->lock);
+        return render;
+    }
+    SpuCacheReset(sys);
+
     /* Render the subpictures */
     subpicture_t *render = SpuRenderSubpictures(spu,
                                                 subpicture_count, subpicture_array,
@@ -1605,6 +1779,16 @@ subpicture_t *spu_Render(spu_t *spu,
                                                 fmt_src,
                                                 render_subtitle_date,
                                                 render_osd_date);
+
+    /* Karaoke text is restored after rendering, to be rendered again */
+    for (unsigned i = 0; i < subpicture_count && is_static; i++) {
+        subpicture_t *subpic = subpicture_array[i];
+        is_static = SpuIsStatic(subpic, subpic->b_subtitle ? render_subtitle_date
+                                                           : render_osd_date);
+    }
+    if (is_static && render)
+        SpuCacheStore(sys, subpicture_count, subpicture_array,
+                      chroma_list, fmt_dst, fmt_src, render);
     vlc_mutex_unlock(&sys->lock);
 
     return render;
@@ -1705,6 +1889,8 @@ void spu_ChangeMargin(spu_t *spu, int margin)
     spu_private_t *sys = spu->p;
 
     vlc_mutex_lock(&sys->lock);
+    if (sys->margin != margin)
+        SpuCacheReset(sys);
     sys->margin = margin;
     vlc_mutex_unlock(&sys->lock);
 }
@@ -27,6 +27,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <utime.h>
 
 #include <vlc_threads.h>
 #include <vlc_fs.h>
@@ -325,10 +326,178 @@ static void test_media_subitems(libvlc_instance_t *vlc)
     libvlc_media_release (media);
 }
 
+static void copy_file(const char *src, const char *dst)
+{
+    FILE *in = vlc_fopen (src, "rb"), *out = vlc_fopen (dst, "wb");
+    char buf[4096];
+    size_t len;
+
+    assert (in != NULL && out != NULL);
+    while ((len = fread (buf, 1, sizeof (buf), in)) > 0)
+        assert (fwrite (buf, 1, len, out) == len);
+    fclose (in);
+    assert (fclose (out) == 0);
+}
+
+static libvlc_track_type_t media_parse_track_type(libvlc_instance_t *vlc,
+                                                  const char *path)
+{
+    libvlc_media_t *media = libvlc_media_new_path (vlc, path);
+    assert (media != NULL);
+
+    vlc_sem_t sem;
+    vlc_sem_init (&sem, 0);
+
+    libvlc_event_manager_t *em = libvlc_media_event_manager (media);
+    libvlc_event_attach (em, libvlc_MediaParsedChanged, media_parse_ended, &sem);
+
+    int i_ret = libvlc_media_parse_with_options(media, libvlc_media_parse_local,
+                                                -1);
+    assert (i_ret == 0);
+    vlc_sem_wait (&sem);
+    vlc_sem_destroy (&sem);
+
+    libvlc_track_type_t type = libvlc_track_unknown;
+    libvlc_media_track_t **pp_tracks;
+    unsigned i_count = libvlc_media_tracks_get (media, &pp_tracks);
+    if (i_count > 0)
+    {
+        type = pp_tracks[0]->i_type;
+        libvlc_media_tracks_release (pp_tracks, i_count);
+    }
+    libvlc_media_release (media);
+    return type;
+}
+
+static unsigned count_cache_entries(const char *tmpdir)
+{
+    char path[strlen (tmpdir) + sizeof ("/vlc/preparse")];
+    unsigned count = 0;
+    const char *name;
+
+    sprintf (path, "%s/vlc/preparse", tmpdir);
+    DIR *dir = vlc_opendir (path);
+    assert (dir != NULL);
+    while ((name = vlc_readdir (dir)) != NULL)
+        if (strlen (name) == 32)
+            count++;
+    closedir (dir);
+    return count;
+}
+
+static void test_media_preparse_cache(libvlc_instance_t *vlc,
+                                      const char *tmpdir)
+{
+    char path[strlen (tmpdir) + sizeof ("/sample")];
+    struct stat st;
+
+    log ("Testing the preparsing cache\n");
+    sprintf (path, "%s/sample", tmpdir);
+
+    /* First parse stores the results, second one reads them */
+    copy_file (test_default_video, path);
+    assert (media_parse_track_type (vlc, path) == libvlc_track_video);
+    assert (media_parse_track_type (vlc, path) == libvlc_track_video);
+
+    /* Same size and time: the cache is trusted, even with other contents */
+    assert (vlc_stat (path, &st) == 0);
+    FILE *file = vlc_fopen (path, "r+b");
+    assert (file != NULL);
+    for (off_t i = 0; i < st.st_size; i++)
+        assert (fputc (0, file) != EOF);
+    assert (fclose (file) == 0);
+    struct utimbuf times = { .actime = st.st_atime, .modtime = st.st_mtime };
+    assert (utime (path, &times) == 0);
+    assert (media_parse_track_type (vlc, path) == libvlc_track_video);
+
+    /* Other size: the entry is out of date, and removed */
+    unsigned count = count_cache_entries (tmpdir);
+    file = vlc_fopen (path, "ab");
+    assert (file != NULL);
+    assert (fputc (0, file) != EOF);
+    assert (fclose (file) == 0);
+    assert (media_parse_track_type (vlc, path) == libvlc_track_unknown);
+    assert (count_cache_entries (tmpdir) == count - 1);
+
+    vlc_unlink (path);
+}
+
+#define PRUNE_ENTRIES 40 /* of 1 MiB, beyond the 32 MiB of the cache */
+
+static void test_media_preparse_cache_prune(const char *tmpdir)
+{
+    char path[strlen (tmpdir) + sizeof ("/vlc/preparse/") + 32];
+    struct stat st;
+
+    log ("Testing the preparsing cache pruning\n");
+
+    /* Entries of files gone, from the oldest to the most recent */
+    for (unsigned i = 0; i < PRUNE_ENTRIES; i++)
+    {
+        sprintf (path, "%s/vlc/preparse/%032x", tmpdir, i);
+        int fd = vlc_open (path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        assert (fd != -1);
+        assert (ftruncate (fd, 1 << 20) == 0);
+        close (fd);
+        struct utimbuf times = { .actime = 1000000 + i,
+                                 .modtime = 1000000 + i };
+        assert (utime (path, &times) == 0);
+    }
+
+    /* The first store of an instance scans the cache */
+    unsigned count = count_cache_entries (tmpdir);
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
+                                         test_defaults_args);
+    assert (vlc != NULL);
+    sprintf (path, "%s/sample", tmpdir);
+    copy_file (test_default_video, path);
+    assert (media_parse_track_type (vlc, path) == libvlc_track_video);
+    libvlc_release (vlc);
+    vlc_unlink (path);
+
+    /* Down to 24 MiB, oldest first */
+    for (unsigned i = 0; i < PRUNE_ENTRIES; i++)
+    {
+        sprintf (path, "%s/vlc/preparse/%032x", tmpdir, i);
+        assert ((vlc_stat (path, &st) == 0) == (i >= PRUNE_ENTRIES - 23));
+    }
+    assert (count_cache_entries (tmpdir) == count - (PRUNE_ENTRIES - 23) + 1);
+}
+
+static void remove_tree(const char *path)
+{
+    DIR *dir = vlc_opendir (path);
+
+    if (dir != NULL)
+    {
+        const char *name;
+
+        while ((name = vlc_readdir (dir)) != NULL)
+        {
+            if (!strcmp (name, ".") || !strcmp (name, ".."))
+                continue;
+
+            char *child;
+            assert (asprintf (&child, "%s/%s", path, name) != -1);
+            remove_tree (child);
+            free (child);
+        }
+        closedir (dir);
+        assert (rmdir (path) == 0);
+    }
+    else
+        assert (vlc_unlink (path) == 0);
+}
+
 int main(int i_argc, char *ppsz_argv[])
 {
     test_init();
 
+    /* Keep the preparsing cache of the tests out of the user directory */
+    char tmpdir[] = "/tmp/libvlc-test-XXXXXX";
+    assert (mkdtemp (tmpdir) != NULL);
+    setenv ("XDG_CACHE_HOME", tmpdir, 1);
+
     libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
                                          test_defaults_args);
     assert (vlc != NULL);
@@ -365,6 +534,8 @@ int main(int i_argc, char *ppsz_argv[])
                           libvlc_media_parse_local,
                           libvlc_media_parsed_status_skipped);
     test_media_subitems (vlc);
+    test_media_preparse_cache (vlc, tmpdir);
+    test_media_preparse_cache_prune (tmpdir);
 
     /* Testing libvlc_MetadataRequest timeout and libvlc_MetadataCancel. For
      * that, we need to create a local input_item_t based on a pipe. There is
@@ -375,6 +546,7 @@ int main(int i_argc, char *ppsz_argv[])
     test_input_metadata_timeout (vlc, 0, 100);
 
     libvlc_release (vlc);
+    remove_tree (tmpdir);
 
     return 0;
 }
@@ -0,0 +1,271 @@
+/*****************************************************************************
+ * thumbnailer.c - libvlc media thumbnailer test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "test.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+#define MAX_THUMBS 16
+
+struct result
+{
+    vlc_sem_t      sem;
+    vlc_mutex_t    lock;
+    libvlc_media_t *p_md;
+    unsigned       i_calls;
+    unsigned       i_data;
+    unsigned       i_order[MAX_THUMBS];
+    libvlc_time_t  i_last;
+};
+
+static void result_init(struct result *r, libvlc_media_t *p_md)
+{
+    vlc_sem_init(&r->sem, 0);
+    vlc_mutex_init(&r->lock);
+    r->p_md = p_md;
+    r->i_calls = r->i_data = 0;
+    r->i_last = -1;
+}
+
+static void result_wait(struct result *r, unsigned i_count)
+{
+    for (unsigned i = 0; i < i_count; i++)
+        vlc_sem_wait(&r->sem);
+
+    vlc_mutex_lock(&r->lock);
+    assert(r->i_calls == i_count);
+    vlc_mutex_unlock(&r->lock);
+}
+
+static void result_clean(struct result *r)
+{
+    vlc_mutex_destroy(&r->lock);
+    vlc_sem_destroy(&r->sem);
+}
+
+static void on_png(void *opaque, libvlc_media_t *p_md, unsigned i_index,
+                   libvlc_time_t i_time, const void *p_data, size_t i_size,
+                   unsigned i_width, unsigned i_height)
+{
+    struct result *r = opaque;
+    static const uint8_t png_sig[] = { 0x89, 'P', 'N', 'G' };
+
+    assert(p_md == r->p_md);
+    assert(i_index < MAX_THUMBS);
+
+    vlc_mutex_lock(&r->lock);
+    r->i_order[r->i_calls++] = i_index;
+    if (p_data != NULL)
+    {
+        assert(i_size > sizeof (png_sig));
+        assert(memcmp(p_data, png_sig, sizeof (png_sig)) == 0);
+        assert(i_width == 1 && i_height == 1);
+        assert(i_time >= r->i_last);
+        r->i_last = i_time;
+        r->i_data++;
+    }
+    vlc_mutex_unlock(&r->lock);
+    vlc_sem_post(&r->sem);
+}
+
+static void test_times(libvlc_instance_t *p_vlc)
+{
+    static const libvlc_time_t times[] = { 5000, 0, 2500 };
+    struct result r;
+
+    log("Testing thumbnails at given times\n");
+
+    libvlc_media_thumbnailer_t *p_mt = libvlc_media_thumbnailer_new(p_vlc, 2);
+    assert(p_mt != NULL);
+    libvlc_media_t *p_md = libvlc_media_new_path(p_vlc, test_default_video);
+    assert(p_md != NULL);
+    result_init(&r, p_md);
+
+    int ret = libvlc_media_thumbnailer_request(p_mt, p_md, times, 3, 0, 0,
+                                               libvlc_thumbnail_png,
+                                               on_png, &r);
+    assert(ret == 0);
+    result_wait(&r, 3);
+
+    /* Increasing time order */
+    assert(r.i_data == 3);
+    assert(r.i_order[0] == 1 && r.i_order[1] == 2 && r.i_order[2] == 0);
+
+    libvlc_media_release(p_md);
+    libvlc_media_thumbnailer_release(p_mt);
+    result_clean(&r);
+}
+
+static void test_concurrent(libvlc_instance_t *p_vlc)
+{
+    struct result r[8];
+
+    log("Testing concurrent spread thumbnails\n");
+
+    libvlc_media_thumbnailer_t *p_mt = libvlc_media_thumbnailer_new(p_vlc, 3);
+    assert(p_mt != NULL);
+
+    for (unsigned i = 0; i < 8; i++)
+    {
+        libvlc_media_t *p_md = libvlc_media_new_path(p_vlc, test_default_video);
+        assert(p_md != NULL);
+        result_init(&r[i], p_md);
+
+        int ret = libvlc_media_thumbnailer_request(p_mt, p_md, NULL, 4, 0, 0,
+                                                   libvlc_thumbnail_png,
+                                                   on_png, &r[i]);
+        assert(ret == 0);
+        /* The thumbnailer retains the media */
+        libvlc_media_release(p_md);
+    }
+
+    for (unsigned i = 0; i < 8; i++)
+    {
+        result_wait(&r[i], 4);
+        assert(r[i].i_data == 4);
+        for (unsigned k = 0; k < 4; k++)
+            assert(r[i].i_order[k] == k);
+        result_clean(&r[i]);
+    }
+
+    libvlc_media_thumbnailer_release(p_mt);
+}
+
+static void test_errors(libvlc_instance_t *p_vlc)
+{
+    struct result r;
+
+    log("Testing thumbnailer errors\n");
+
+    libvlc_media_thumbnailer_t *p_mt = libvlc_media_thumbnailer_new(p_vlc, 1);
+    assert(p_mt != NULL);
+
+    /* Missing media: one empty callback per thumbnail */
+    libvlc_media_t *p_md = libvlc_media_new_path(p_vlc, "/nonexistent.jpg");
+    assert(p_md != NULL);
+    result_init(&r, p_md);
+    int ret = libvlc_media_thumbnailer_request(p_mt, p_md, NULL, 2, 0, 0,
+                                               libvlc_thumbnail_png,
+                                               on_png, &r);
+    assert(ret == 0);
+    result_wait(&r, 2);
+    assert(r.i_data == 0);
+    result_clean(&r);
+
+    /* Nothing requested */
+    ret = libvlc_media_thumbnailer_request(p_mt, p_md, NULL, 0, 0, 0,
+                                           libvlc_thumbnail_png, on_png, &r);
+    assert(ret == -1);
+    libvlc_media_release(p_md);
+
+    libvlc_media_thumbnailer_release(p_mt);
+}
+
+static void test_cancel(libvlc_instance_t *p_vlc)
+{
+    struct result r[4];
+
+    log("Testing thumbnailer cancellation\n");
+
+    libvlc_media_thumbnailer_t *p_mt = libvlc_media_thumbnailer_new(p_vlc, 1);
+    assert(p_mt != NULL);
+
+    for (unsigned i = 0; i < 4; i++)
+    {
+        libvlc_media_t *p_md = libvlc_media_new_path(p_vlc, test_default_video);
+        assert(p_md != NULL);
+        result_init(&r[i], p_md);
+        int ret = libvlc_media_thumbnailer_request(p_mt, p_md, NULL, 3, 0, 0,
+                                                   libvlc_thumbnail_png,
+                                                   on_png, &r[i]);
+        assert(ret == 0);
+    }
+
+    /* Cancelled or not, every thumbnail gets its callback */
+    libvlc_media_thumbnailer_cancel(p_mt, r[3].p_md);
+    result_wait(&r[3], 3);
+
+    libvlc_media_thumbnailer_cancel(p_mt, NULL);
+    for (unsigned i = 0; i < 3; i++)
+        result_wait(&r[i], 3);
+
+    for (unsigned i = 0; i < 4; i++)
+    {
+        libvlc_media_release(r[i].p_md);
+        result_clean(&r[i]);
+    }
+
+    /* Still usable after cancellation */
+    test_times(p_vlc);
+    libvlc_media_thumbnailer_release(p_mt);
+}
+
+static void test_release(libvlc_instance_t *p_vlc)
+{
+    struct result r[4];
+
+    log("Testing thumbnailer release with pending requests\n");
+
+    libvlc_media_thumbnailer_t *p_mt = libvlc_media_thumbnailer_new(p_vlc, 1);
+    assert(p_mt != NULL);
+
+    for (unsigned i = 0; i < 4; i++)
+    {
+        libvlc_media_t *p_md = libvlc_media_new_path(p_vlc, test_default_video);
+        assert(p_md != NULL);
+        result_init(&r[i], p_md);
+        int ret = libvlc_media_thumbnailer_request(p_mt, p_md, NULL, 3, 0, 0,
+                                                   libvlc_thumbnail_png,
+                                                   on_png, &r[i]);
+        assert(ret == 0);
+    }
+
+    /* Every thumbnail got its callback before the release returns */
+    libvlc_media_thumbnailer_release(p_mt);
+    for (unsigned i = 0; i < 4; i++)
+    {
+        vlc_mutex_lock(&r[i].lock);
+        assert(r[i].i_calls == 3);
+        vlc_mutex_unlock(&r[i].lock);
+        libvlc_media_release(r[i].p_md);
+        result_clean(&r[i]);
+    }
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *p_vlc = libvlc_new(test_defaults_nargs,
+                                          test_defaults_args);
+    assert(p_vlc != NULL);
+
+    test_times(p_vlc);
+    test_concurrent(p_vlc);
+    test_errors(p_vlc);
+    test_cancel(p_vlc);
+    test_release(p_vlc);
+
+    libvlc_release(p_vlc);
+    return 0;
+}
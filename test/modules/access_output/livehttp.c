@@ -0,0 +1,219 @@
+/*****************************************************************************
+ * livehttp.c: tests the HTTP Live Streaming segmenter writer
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_sout.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+#define BLOCKS   100
+#define SIZE     (7 * 188)
+#define DURATION 100000 /* 10 blocks per 1 s segment */
+
+static uint8_t Byte( size_t i_pos )
+{
+    return ( i_pos * 31 + ( i_pos >> 8 ) ) & 0xFF;
+}
+
+static ssize_t Write( sout_access_out_t *p_access, unsigned i )
+{
+    block_t *p_block = block_Alloc( SIZE );
+    assert( p_block != NULL );
+    for( size_t j = 0; j < SIZE; j++ )
+        p_block->p_buffer[j] = Byte( i * SIZE + j );
+    p_block->i_dts = VLC_TS_0 + i * DURATION;
+    p_block->i_length = DURATION;
+    if( i % 10 == 0 )
+        p_block->i_flags |= BLOCK_FLAG_HEADER;
+    return sout_AccessOutWrite( p_access, p_block );
+}
+
+static char *Path( const char *psz_dir, const char *psz_name )
+{
+    char *psz_path;
+    assert( asprintf( &psz_path, "%s/%s", psz_dir, psz_name ) != -1 );
+    return psz_path;
+}
+
+static char *ReadFile( const char *psz_path, size_t *pi_size )
+{
+    FILE *p_file = vlc_fopen( psz_path, "rb" );
+    if( p_file == NULL )
+        return NULL;
+
+    char *p_data = NULL;
+    size_t i_size = 0;
+    for( ;; )
+    {
+        p_data = realloc( p_data, i_size + 4096 + 1 );
+        assert( p_data != NULL );
+        size_t i_read = fread( &p_data[i_size], 1, 4096, p_file );
+        i_size += i_read;
+        if( i_read < 4096 )
+            break;
+    }
+    fclose( p_file );
+    p_data[i_size] = '\0';
+    *pi_size = i_size;
+    return p_data;
+}
+
+static sout_access_out_t *Open( vlc_object_t *p_obj, const char *psz_dir,
+                                const char *psz_options )
+{
+    char *psz_access, *psz_path;
+
+    assert( asprintf( &psz_access, "livehttp{seglen=1,index=%s/index.m3u8,"
+                      "index-url=seg-#.ts%s}", psz_dir, psz_options ) != -1 );
+    psz_path = Path( psz_dir, "seg-#.ts" );
+    sout_access_out_t *p_access = sout_AccessOutNew( p_obj, psz_access, psz_path );
+    free( psz_path );
+    free( psz_access );
+    return p_access;
+}
+
+/* All the segments kept, the writer output everything in order */
+static void test_write( vlc_object_t *p_obj, const char *psz_dir )
+{
+    sout_access_out_t *p_access = Open( p_obj, psz_dir, ",numsegs=0" );
+    assert( p_access != NULL );
+    for( unsigned i = 0; i < BLOCKS; i++ )
+        assert( Write( p_access, i ) == SIZE );
+    sout_AccessOutDelete( p_access );
+
+    char *psz_path = Path( psz_dir, "index.m3u8" ), *psz_index;
+    size_t i_size;
+    assert( ( psz_index = ReadFile( psz_path, &i_size ) ) != NULL );
+    assert( strstr( psz_index, "#EXT-X-ENDLIST" ) != NULL );
+    free( psz_path );
+
+    size_t i_pos = 0;
+    unsigned i_segments = 0;
+    for( const char *psz_uri = strstr( psz_index, "seg-" ); psz_uri != NULL;
+         psz_uri = strstr( psz_uri + 1, "seg-" ) )
+    {
+        char psz_name[32];
+        assert( sscanf( psz_uri, "%31[^\n]", psz_name ) == 1 );
+        i_segments++;
+
+        char *p_data;
+        psz_path = Path( psz_dir, psz_name );
+        assert( ( p_data = ReadFile( psz_path, &i_size ) ) != NULL );
+        for( size_t i = 0; i < i_size; i++ )
+            assert( (uint8_t) p_data[i] == Byte( i_pos + i ) );
+        i_pos += i_size;
+        vlc_unlink( psz_path );
+        free( psz_path );
+        free( p_data );
+    }
+    assert( i_segments == BLOCKS / 10 );
+    assert( i_pos == BLOCKS * SIZE );
+    free( psz_index );
+}
+
+/* A window of segments, the old ones deleted by the writer */
+static void test_window( vlc_object_t *p_obj, const char *psz_dir )
+{
+    sout_access_out_t *p_access = Open( p_obj, psz_dir, ",numsegs=2,delsegs" );
+    assert( p_access != NULL );
+    for( unsigned i = 0; i < BLOCKS; i++ )
+        assert( Write( p_access, i ) == SIZE );
+    sout_AccessOutDelete( p_access );
+
+    for( unsigned i = 1; i <= BLOCKS / 10; i++ )
+    {
+        char psz_name[32];
+        struct stat st;
+        snprintf( psz_name, sizeof(psz_name), "seg-%u.ts", i );
+        char *psz_path = Path( psz_dir, psz_name );
+        assert( vlc_stat( psz_path, &st ) != 0 );
+        free( psz_path );
+    }
+
+    char *psz_path = Path( psz_dir, "index.m3u8" ), *psz_index;
+    size_t i_size;
+    assert( ( psz_index = ReadFile( psz_path, &i_size ) ) != NULL );
+    assert( strstr( psz_index, "seg-1.ts" ) == NULL );
+    assert( strstr( psz_index, "seg-10.ts" ) != NULL );
+    free( psz_index );
+    free( psz_path );
+}
+
+/* The writer fails to open the segments, reported by the next writes */
+static void test_error( vlc_object_t *p_obj, const char *psz_dir )
+{
+    char *psz_missing = Path( psz_dir, "missing" );
+    sout_access_out_t *p_access = Open( p_obj, psz_missing, "" );
+    assert( p_access != NULL );
+
+    ssize_t i_ret = 0;
+    for( unsigned i = 0; i < BLOCKS && i_ret >= 0; i++ )
+    {
+        i_ret = Write( p_access, i );
+        /* let the writer run */
+        mwait( mdate() + 10000 );
+    }
+    assert( i_ret < 0 );
+    sout_AccessOutDelete( p_access );
+    free( psz_missing );
+}
+
+int main( void )
+{
+    char psz_dir[] = "/tmp/vlc-livehttp-XXXXXX";
+
+    test_init();
+
+    assert( mkdtemp( psz_dir ) != NULL );
+
+    libvlc_instance_t *p_vlc = libvlc_new( 0, NULL );
+    assert( p_vlc != NULL );
+    vlc_object_t *p_obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+
+    test_write( p_obj, psz_dir );
+    test_window( p_obj, psz_dir );
+    test_error( p_obj, psz_dir );
+
+    libvlc_release( p_vlc );
+
+    char *psz_path = Path( psz_dir, "index.m3u8" );
+    vlc_unlink( psz_path );
+    free( psz_path );
+    assert( rmdir( psz_dir ) == 0 );
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*****************************************************************************
+ * hls.cpp: HLS playlist reload and delta update tests
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <cassert>
+#include <cstring>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_stream.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include "../modules/demux/hls/playlist/Parser.hpp"
+#include "../modules/demux/hls/playlist/M3U8.hpp"
+#include "../modules/demux/hls/playlist/Representation.hpp"
+#include "../modules/demux/adaptive/playlist/BasePeriod.h"
+#include "../modules/demux/adaptive/playlist/BaseAdaptationSet.h"
+#include "../modules/demux/adaptive/playlist/Segment.h"
+#include "../modules/demux/adaptive/tools/Retrieve.hpp"
+
+using namespace hls::playlist;
+
+#define PLAYLIST_HEADER \
+    "#EXTM3U\n" \
+    "#EXT-X-VERSION:9\n" \
+    "#EXT-X-TARGETDURATION:4\n"
+#define PLAYLIST_SERVER_CONTROL \
+    "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=24.0\n"
+#define PLAYLIST_INITIAL_SEGMENTS \
+    "#EXT-X-MEDIA-SEQUENCE:10\n" \
+    "#EXTINF:4.0,\ns10.ts\n" \
+    "#EXTINF:3.0,\ns11.ts\n" \
+    "#EXTINF:4.0,\ns12.ts\n" \
+    "#EXTINF:2.5,\ns13.ts\n" \
+    "#EXTINF:4.0,\ns14.ts\n" \
+    "#EXTINF:3.5,\ns15.ts\n"
+
+/* Initial live playlist, segments 10 to 15 */
+static const char initial_playlist[] =
+    PLAYLIST_HEADER PLAYLIST_SERVER_CONTROL PLAYLIST_INITIAL_SEGMENTS;
+
+/* Same, but not allowing delta updates */
+static const char initial_noskip_playlist[] =
+    PLAYLIST_HEADER PLAYLIST_INITIAL_SEGMENTS;
+
+/* Same playlist window after 2 segments did slide out */
+static const char full_update[] =
+    PLAYLIST_HEADER
+    "#EXT-X-MEDIA-SEQUENCE:12\n"
+    "#EXTINF:4.0,\ns12.ts\n"
+    "#EXTINF:2.5,\ns13.ts\n"
+    "#EXTINF:4.0,\ns14.ts\n"
+    "#EXTINF:3.5,\ns15.ts\n"
+    "#EXT-X-DISCONTINUITY\n"
+    "#EXTINF:4.0,\ns16.ts\n"
+    "#EXTINF:1.5,\ns17.ts\n";
+
+/* Playlist Delta Update of the above */
+static const char delta_update[] =
+    PLAYLIST_HEADER PLAYLIST_SERVER_CONTROL
+    "#EXT-X-MEDIA-SEQUENCE:12\n"
+    "#EXT-X-SKIP:SKIPPED-SEGMENTS=3\n"
+    "#EXTINF:3.5,\ns15.ts\n"
+    "#EXT-X-DISCONTINUITY\n"
+    "#EXTINF:4.0,\ns16.ts\n"
+    "#EXTINF:1.5,\ns17.ts\n";
+
+/* Delta Update skipping past what we hold */
+static const char bad_delta_update[] =
+    PLAYLIST_HEADER PLAYLIST_SERVER_CONTROL
+    "#EXT-X-MEDIA-SEQUENCE:12\n"
+    "#EXT-X-SKIP:SKIPPED-SEGMENTS=5\n"
+    "#EXTINF:1.5,\ns17.ts\n";
+
+static const char *delta_served;
+static unsigned delta_requests;
+static unsigned full_requests;
+
+/* Serves the playlists instead of the network */
+block_t * adaptive::Retrieve::HTTP(vlc_object_t *, const std::string &uri)
+{
+    const char *psz;
+    if(uri.find("_HLS_skip=YES") != std::string::npos)
+    {
+        delta_requests++;
+        psz = delta_served;
+    }
+    else
+    {
+        full_requests++;
+        psz = full_update;
+    }
+
+    block_t *p_block = block_Alloc(strlen(psz));
+    if(p_block)
+        memcpy(p_block->p_buffer, psz, p_block->i_buffer);
+    return p_block;
+}
+
+static M3U8 * ParseInitial(vlc_object_t *obj, M3U8Parser &parser,
+                           const char *psz_playlist, const char *psz_url)
+{
+    stream_t *s = vlc_stream_MemoryNew(obj, (uint8_t *) psz_playlist,
+                                       strlen(psz_playlist), true);
+    assert(s != NULL);
+    M3U8 *playlist = parser.parse(obj, s, psz_url);
+    vlc_stream_Delete(s);
+    assert(playlist != NULL);
+    return playlist;
+}
+
+static Representation * GetRepresentation(M3U8 *playlist)
+{
+    BasePeriod *period = playlist->getFirstPeriod();
+    assert(period != NULL);
+    assert(!period->getAdaptationSets().empty());
+    BaseAdaptationSet *set = period->getAdaptationSets().front();
+    assert(!set->getRepresentations().empty());
+    Representation *rep = dynamic_cast<Representation *>(set->getRepresentations().front());
+    assert(rep != NULL);
+    return rep;
+}
+
+static stime_t StartTime(Representation *rep, uint64_t number)
+{
+    ISegment *seg = rep->getSegment(SegmentInformation::INFOTYPE_MEDIA,
+                                    number + ISegment::SEQUENCE_FIRST);
+    assert(seg != NULL);
+    return seg->startTime.Get();
+}
+
+static void test_delta(vlc_object_t *obj)
+{
+    M3U8Parser parser;
+
+    log("Testing playlist delta update\n");
+
+    /* Reference: full playlist reload */
+    M3U8 *refplaylist = ParseInitial(obj, parser, initial_noskip_playlist,
+                                      "http://host/ref.m3u8");
+    Representation *ref = GetRepresentation(refplaylist);
+    assert(!ref->canRequestDelta());
+    full_requests = delta_requests = 0;
+    assert(parser.appendSegmentsFromPlaylistURI(obj, ref));
+    assert(full_requests == 1 && delta_requests == 0);
+
+    /* Delta update */
+    M3U8 *playlist = ParseInitial(obj, parser, initial_playlist, "http://host/live.m3u8");
+    Representation *rep = GetRepresentation(playlist);
+    assert(rep->canRequestDelta());
+    delta_served = delta_update;
+    full_requests = delta_requests = 0;
+    assert(parser.appendSegmentsFromPlaylistURI(obj, rep));
+    assert(full_requests == 0 && delta_requests == 1);
+
+    /* Both must build the same timeline */
+    for(uint64_t i = 10; i <= 17; i++)
+        assert(StartTime(rep, i) == StartTime(ref, i));
+
+    /* Discontinuity keeps its playlist relative start time:
+     * 4.0 + 2.5 + 4.0 skipped and 3.5 listed before it */
+    assert(StartTime(rep, 16) == 1400);
+    assert(StartTime(rep, 17) == 1800);
+
+    delete playlist;
+    delete refplaylist;
+}
+
+static void test_delta_fallback(vlc_object_t *obj)
+{
+    M3U8Parser parser;
+
+    log("Testing playlist delta update fallback\n");
+
+    M3U8 *playlist = ParseInitial(obj, parser, initial_playlist, "http://host/live.m3u8");
+    Representation *rep = GetRepresentation(playlist);
+    delta_served = bad_delta_update;
+    full_requests = delta_requests = 0;
+    assert(parser.appendSegmentsFromPlaylistURI(obj, rep));
+    assert(full_requests == 1 && delta_requests == 1);
+
+    for(uint64_t i = 10; i <= 17; i++)
+        assert(rep->getSegment(SegmentInformation::INFOTYPE_MEDIA,
+                               i + ISegment::SEQUENCE_FIRST) != NULL);
+    assert(StartTime(rep, 16) == 1400);
+
+    delete playlist;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *p_vlc = libvlc_new(0, NULL);
+    assert(p_vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+
+    test_delta(obj);
+    test_delta_fallback(obj);
+
+    libvlc_release(p_vlc);
+    return 0;
+}
@@ -0,0 +1,298 @@
+/*****************************************************************************
+ * mpd.cpp: measures DASH manifest parsing time and allocations
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Not run by "make check":
+ * $ make test_modules_demux_mpd
+ * $ ./test_modules_demux_mpd [file.mpd|-] [loops]
+ * Without file (or with -), a synthetic live manifest with 4 periods and
+ * 24000 timeline entries is generated.
+ * Both the DOM and the streaming parser are run; C++ heap allocations are
+ * counted by replacing the global operator new/delete.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include "../modules/demux/adaptive/xml/DOMParser.h"
+#include "../modules/demux/dash/mpd/IsoffMainParser.h"
+#include "../modules/demux/dash/mpd/IsoffStreamParser.h"
+#include "../modules/demux/dash/mpd/MPD.h"
+
+#define BENCH_PERIODS   4
+#define BENCH_TIMELINE  3000
+#define BENCH_LOOPS     20
+
+using namespace dash::mpd;
+
+/* Allocation accounting, the parsers are single threaded */
+static struct
+{
+    size_t i_count;
+    size_t i_bytes;
+    size_t i_live;
+    size_t i_peak;
+} heap;
+
+#define HEAP_HEADER 16 /* keeps max_align_t alignment */
+
+static void *HeapAlloc(std::size_t i_size)
+{
+    unsigned char *p = (unsigned char *) malloc(HEAP_HEADER + i_size);
+    if(p == NULL)
+        return NULL;
+    memcpy(p, &i_size, sizeof(i_size));
+    heap.i_count++;
+    heap.i_bytes += i_size;
+    heap.i_live += i_size;
+    if(heap.i_live > heap.i_peak)
+        heap.i_peak = heap.i_live;
+    return p + HEAP_HEADER;
+}
+
+static void HeapFree(void *ptr)
+{
+    if(ptr == NULL)
+        return;
+    unsigned char *p = (unsigned char *) ptr - HEAP_HEADER;
+    std::size_t i_size;
+    memcpy(&i_size, p, sizeof(i_size));
+    heap.i_live -= i_size;
+    free(p);
+}
+
+void *operator new(std::size_t i_size)
+{
+    void *p = HeapAlloc(i_size);
+    if(p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(std::size_t i_size, const std::nothrow_t &) noexcept
+{
+    return HeapAlloc(i_size);
+}
+
+void operator delete(void *p) noexcept
+{
+    HeapFree(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    HeapFree(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    HeapFree(p);
+}
+
+static void Append(std::string &s, const char *psz_fmt, ...)
+{
+    char psz[512];
+    va_list ap;
+    va_start(ap, psz_fmt);
+    vsnprintf(psz, sizeof(psz), psz_fmt, ap);
+    va_end(ap);
+    s.append(psz);
+}
+
+static std::string GenerateMPD()
+{
+    static const struct
+    {
+        const char *psz_kind;
+        const char *psz_mime;
+        const char *psz_codecs;
+    } sets[] = {
+        { "v", "video/mp4", "avc1.4d401f" },
+        { "a", "audio/mp4", "mp4a.40.2" },
+    };
+    std::string s;
+
+    s.append("<?xml version=\"1.0\"?>\n"
+             "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"dynamic\""
+             " profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+             " minimumUpdatePeriod=\"PT2S\""
+             " availabilityStartTime=\"2016-01-01T00:00:00Z\""
+             " timeShiftBufferDepth=\"PT3600S\" minBufferTime=\"PT4S\">\n"
+             "<ProgramInformation moreInformationURL=\"http://example.com\">"
+             "<Title>Benchmark</Title></ProgramInformation>\n"
+             "<BaseURL>http://example.com/</BaseURL>\n");
+
+    for(unsigned p = 0; p < BENCH_PERIODS; p++)
+    {
+        Append(s, "<Period id=\"p%u\" start=\"PT%uS\">\n", p, p * 3600);
+        for(unsigned i = 0; i < ARRAY_SIZE(sets); i++)
+        {
+            Append(s, "<AdaptationSet mimeType=\"%s\" segmentAlignment=\"true\""
+                      " lang=\"en\"><Role schemeIdUri=\"urn:mpeg:dash:role:2011\""
+                      " value=\"main\"/>\n", sets[i].psz_mime);
+            Append(s, "<SegmentTemplate timescale=\"90000\""
+                      " media=\"%s/$RepresentationID$/$Time$.m4s\""
+                      " initialization=\"%s/$RepresentationID$/init.mp4\">"
+                      "<SegmentTimeline>\n", sets[i].psz_kind, sets[i].psz_kind);
+            for(unsigned j = 0; j < BENCH_TIMELINE; j++)
+            {
+                if(j % 7 == 0)
+                    Append(s, "<S t=\"%u\" d=\"180000\" r=\"2\"/>\n",
+                           p * 1000000 + j * 180000);
+                else
+                    s.append("<S d=\"180000\"/>\n");
+            }
+            s.append("</SegmentTimeline></SegmentTemplate>\n");
+            for(unsigned r = 0; r < 4; r++)
+                Append(s, "<Representation id=\"%s%u\" bandwidth=\"%u\""
+                          " codecs=\"%s\" width=\"1280\" height=\"720\">"
+                          "<BaseURL>r%u/</BaseURL></Representation>\n",
+                       sets[i].psz_kind, r, 100000 * (r + 1), sets[i].psz_codecs, r);
+            s.append("</AdaptationSet>\n");
+        }
+
+        s.append("<AdaptationSet mimeType=\"video/mp4\">"
+                 "<Representation id=\"sl\" bandwidth=\"1000\">"
+                 "<SegmentList duration=\"10\" timescale=\"1\">"
+                 "<Initialization sourceURL=\"init.mp4\" range=\"0-99\"/>\n");
+        for(unsigned j = 0; j < BENCH_TIMELINE / 4; j++)
+            Append(s, "<SegmentURL media=\"s%u.m4s\" mediaRange=\"%u-%u\"/>\n",
+                   j, j * 100, j * 100 + 99);
+        s.append("</SegmentList></Representation></AdaptationSet>\n"
+                 "</Period>\n");
+    }
+    s.append("</MPD>\n");
+    return s;
+}
+
+static bool LoadFile(const char *psz_path, std::string &s)
+{
+    FILE *f = fopen(psz_path, "rb");
+    if(f == NULL)
+        return false;
+    char buf[65536];
+    size_t i_read;
+    while((i_read = fread(buf, 1, sizeof(buf), f)) > 0)
+        s.append(buf, i_read);
+    fclose(f);
+    return !s.empty();
+}
+
+static MPD * ParseOnce(vlc_object_t *obj, bool b_dom, const std::string &manifest)
+{
+    stream_t *s = vlc_stream_MemoryNew(obj, (uint8_t *) manifest.data(),
+                                       manifest.size(), true);
+    assert(s != NULL);
+
+    MPD *mpd = NULL;
+    if(b_dom)
+    {
+        adaptive::xml::DOMParser parser(s);
+        if(parser.parse(true))
+        {
+            IsoffMainParser mpdparser(parser.getRootNode(), obj, s,
+                                      "http://example.com/manifest.mpd");
+            mpd = mpdparser.parse();
+        }
+    }
+    else
+    {
+        IsoffStreamParser mpdparser(obj, s, "http://example.com/manifest.mpd");
+        mpd = mpdparser.parse();
+    }
+
+    vlc_stream_Delete(s);
+    return mpd;
+}
+
+static void Bench(vlc_object_t *obj, bool b_dom, const std::string &manifest,
+                  unsigned i_loops)
+{
+    /* Peak is measured over a single parse, the manifest excluded */
+    memset(&heap, 0, sizeof(heap));
+    MPD *mpd = ParseOnce(obj, b_dom, manifest);
+    assert(mpd != NULL);
+    const size_t i_kept = heap.i_live;
+    delete mpd;
+    const size_t i_peak = heap.i_peak;
+
+    memset(&heap, 0, sizeof(heap));
+    mtime_t i_start = mdate();
+    for(unsigned i = 0; i < i_loops; i++)
+        delete ParseOnce(obj, b_dom, manifest);
+    mtime_t i_elapsed = mdate() - i_start;
+
+    printf("%-6s: %.2f ms/parse, %zu allocations/parse, %.2f MiB allocated/parse, "
+           "peak %.2f MiB, playlist %.2f MiB\n",
+           b_dom ? "dom" : "stream",
+           (double) i_elapsed / i_loops / 1000,
+           heap.i_count / i_loops,
+           (double) heap.i_bytes / i_loops / (1 << 20),
+           (double) i_peak / (1 << 20),
+           (double) i_kept / (1 << 20));
+}
+
+int main(int i_argc, char *ppsz_argv[])
+{
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    const char *const args[] = { "--verbose=0" };
+    libvlc_instance_t *p_libvlc = libvlc_new(1, args);
+    assert(p_libvlc != NULL);
+    vlc_object_t *p_obj = VLC_OBJECT(p_libvlc->p_libvlc_int);
+
+    std::string manifest;
+    if(i_argc > 1 && strcmp(ppsz_argv[1], "-"))
+    {
+        if(!LoadFile(ppsz_argv[1], manifest))
+        {
+            fprintf(stderr, "cannot read %s\n", ppsz_argv[1]);
+            libvlc_release(p_libvlc);
+            return 1;
+        }
+    }
+    else manifest = GenerateMPD();
+
+    unsigned i_loops = (i_argc > 2) ? strtoul(ppsz_argv[2], NULL, 10) : 0;
+    if(i_loops == 0)
+        i_loops = BENCH_LOOPS;
+
+    printf("%zu bytes manifest, %u loops\n", manifest.size(), i_loops);
+    Bench(p_obj, true, manifest, i_loops);
+    Bench(p_obj, false, manifest, i_loops);
+
+    libvlc_release(p_libvlc);
+    return 0;
+}
@@ -0,0 +1,244 @@
+/*****************************************************************************
+ * ps.c: MPEG Program Stream demuxer PES batching tests
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#define PES_COUNT    100
+#define PES_PAYLOAD  32
+#define PES_SIZE     (6 + 3 + 5 + PES_PAYLOAD)
+#define PACK_SIZE    12
+#define PES_DURATION 2160 /* 90kHz */
+#define BATCH_MAX    16 /* PS_BATCH_MAX */
+
+/* Single pack followed by PES of a single MPEG audio track, so that
+ * nothing (PCR, ES creation) forces the demuxer to send each of them */
+static uint8_t ps[PACK_SIZE + PES_COUNT * PES_SIZE];
+
+static void SetTimestamp( uint8_t *p, uint8_t i_prefix, uint64_t i_ts )
+{
+    p[0] = (i_prefix << 4) | ((i_ts >> 29) & 0x0E) | 0x01;
+    p[1] = i_ts >> 22;
+    p[2] = ((i_ts >> 14) & 0xFE) | 0x01;
+    p[3] = i_ts >> 7;
+    p[4] = ((i_ts << 1) & 0xFE) | 0x01;
+}
+
+static void GenerateStream( void )
+{
+    const unsigned i_rate = 2000; /* 50 bytes/s units */
+    uint8_t *p = ps;
+
+    /* MPEG-1 pack header */
+    SetDWBE( p, 0x000001BA );
+    SetTimestamp( &p[4], 0x02, 90000 );
+    p[9] = 0x80 | (i_rate >> 15);
+    p[10] = i_rate >> 7;
+    p[11] = (i_rate << 1) | 0x01;
+    p += PACK_SIZE;
+
+    for( unsigned i = 0; i < PES_COUNT; i++ )
+    {
+        SetDWBE( p, 0x000001C0 );
+        SetWBE( &p[4], PES_SIZE - 6 );
+        p[6] = 0x80;
+        p[7] = 0x80; /* PTS only */
+        p[8] = 5;
+        SetTimestamp( &p[9], 0x02, 90000 + i * PES_DURATION );
+        memset( &p[14], 0, PES_PAYLOAD );
+        SetDWBE( &p[14], i );
+        p += PES_SIZE;
+    }
+}
+
+struct es_out_id_t
+{
+    es_format_t fmt;
+};
+
+struct test_es_out_t
+{
+    es_out_t out;
+    es_out_id_t *id;
+    unsigned i_blocks; /* received so far */
+    unsigned i_chains;
+    unsigned i_max_chain;
+    bool b_discontinuity;
+};
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *fmt )
+{
+    struct test_es_out_t *ctx = (struct test_es_out_t *) out;
+
+    assert( ctx->id == NULL );
+    assert( fmt->i_cat == AUDIO_ES );
+    ctx->id = malloc( sizeof(*ctx->id) );
+    assert( ctx->id != NULL );
+    es_format_Copy( &ctx->id->fmt, fmt );
+    return ctx->id;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *p_chain )
+{
+    struct test_es_out_t *ctx = (struct test_es_out_t *) out;
+    unsigned i_count = 0;
+
+    assert( id == ctx->id );
+    for( block_t *p_block = p_chain; p_block != NULL; p_block = p_block->p_next )
+    {
+        assert( p_block->i_buffer == PES_PAYLOAD );
+        /* In order, and never stale data from before a seek */
+        assert( GetDWBE( p_block->p_buffer ) == ctx->i_blocks );
+        assert( p_block->i_pts == VLC_TS_0 + ( CLOCK_FREQ +
+                (int64_t) ctx->i_blocks * PES_DURATION * CLOCK_FREQ / 90000 ) );
+        if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
+        {
+            assert( ctx->i_blocks == 0 );
+            ctx->b_discontinuity = true;
+        }
+        ctx->i_blocks++;
+        i_count++;
+    }
+    ctx->i_chains++;
+    if( i_count > ctx->i_max_chain )
+        ctx->i_max_chain = i_count;
+
+    block_ChainRelease( p_chain );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDelete( es_out_t *out, es_out_id_t *id )
+{
+    struct test_es_out_t *ctx = (struct test_es_out_t *) out;
+
+    assert( id == ctx->id );
+    es_format_Clean( &id->fmt );
+    free( id );
+    ctx->id = NULL;
+}
+
+static int EsOutControl( es_out_t *out, int query, va_list args )
+{
+    struct test_es_out_t *ctx = (struct test_es_out_t *) out;
+
+    switch( query )
+    {
+        case ES_OUT_GET_ES_STATE:
+            assert( va_arg( args, es_out_id_t * ) == ctx->id );
+            *va_arg( args, bool * ) = true;
+            return VLC_SUCCESS;
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_RESET_PCR:
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static demux_t *Create( vlc_object_t *obj, struct test_es_out_t *ctx )
+{
+    memset( ctx, 0, sizeof(*ctx) );
+    ctx->out.pf_add = EsOutAdd;
+    ctx->out.pf_send = EsOutSend;
+    ctx->out.pf_del = EsOutDelete;
+    ctx->out.pf_control = EsOutControl;
+
+    stream_t *s = vlc_stream_MemoryNew( obj, ps, sizeof(ps), true );
+    assert( s != NULL );
+    demux_t *demux = demux_New( obj, "ps", "", s, &ctx->out );
+    assert( demux != NULL );
+    return demux;
+}
+
+static void test_batch( vlc_object_t *obj )
+{
+    struct test_es_out_t ctx;
+
+    log( "Testing batched PES send\n" );
+
+    demux_t *demux = Create( obj, &ctx );
+    while( demux_Demux( demux ) == VLC_DEMUXER_SUCCESS );
+
+    /* Everything is sent, but grouped */
+    assert( ctx.i_blocks == PES_COUNT );
+    assert( ctx.i_max_chain > 1 && ctx.i_max_chain <= BATCH_MAX );
+    assert( ctx.i_chains < PES_COUNT );
+
+    demux_Delete( demux ); /* and the stream */
+}
+
+static void test_seek( vlc_object_t *obj )
+{
+    struct test_es_out_t ctx;
+
+    log( "Testing PES batch drop on seek\n" );
+
+    demux_t *demux = Create( obj, &ctx );
+
+    /* Pack header, then less PES than a batch: nothing sent yet */
+    for( unsigned i = 0; i < 1 + BATCH_MAX / 2; i++ )
+        assert( demux_Demux( demux ) == VLC_DEMUXER_SUCCESS );
+    assert( ctx.i_blocks == 0 );
+
+    /* The pending PES must not reach the flushed decoders */
+    assert( demux_Control( demux, DEMUX_SET_POSITION, 0.0, false ) == VLC_SUCCESS );
+    assert( ctx.i_blocks == 0 );
+
+    /* Restarts from the first PES, flagged as discontinuity */
+    while( demux_Demux( demux ) == VLC_DEMUXER_SUCCESS );
+    assert( ctx.i_blocks == PES_COUNT );
+    assert( ctx.b_discontinuity );
+
+    demux_Delete( demux );
+}
+
+int main( void )
+{
+    test_init();
+
+    GenerateStream();
+
+    libvlc_instance_t *p_vlc = libvlc_new( 0, NULL );
+    assert( p_vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT( p_vlc->p_libvlc_int );
+
+    test_batch( obj );
+    test_seek( obj );
+
+    libvlc_release( p_vlc );
+    return 0;
+}
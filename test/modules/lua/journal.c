@@ -0,0 +1,125 @@
+/*****************************************************************************
+ * journal.c: runs the Lua playlist journal test script
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+/* The script is run as a Lua interface from a data directory made of
+ * links to the test script and to the shared Lua modules */
+static const char *const links[][2] = {
+    { "lua/intf/test_journal.lua", "modules/lua/journal.lua" },
+    { "lua/intf/modules",          "../share/lua/intf/modules" },
+    { "lua/modules",               "../share/lua/modules" },
+};
+
+static char *Path( const char *psz_dir, const char *psz_name )
+{
+    char *psz_path;
+    assert( asprintf( &psz_path, "%s/%s", psz_dir, psz_name ) != -1 );
+    return psz_path;
+}
+
+static void Exit( void *data )
+{
+    vlc_sem_post( data );
+}
+
+int main( void )
+{
+    char psz_dir[] = "/tmp/vlc-lua-XXXXXX";
+
+    test_init();
+
+    assert( mkdtemp( psz_dir ) != NULL );
+    char *psz_lua = Path( psz_dir, "lua" ), *psz_intf = Path( psz_dir, "lua/intf" );
+    assert( vlc_mkdir( psz_lua, 0700 ) == 0 );
+    assert( vlc_mkdir( psz_intf, 0700 ) == 0 );
+
+    for( size_t i = 0; i < ARRAY_SIZE(links); i++ )
+    {
+        char *psz_src = Path( SRCDIR, links[i][1] ), psz_target[PATH_MAX];
+        char *psz_link = Path( psz_dir, links[i][0] );
+
+        assert( realpath( psz_src, psz_target ) != NULL );
+        assert( symlink( psz_target, psz_link ) == 0 );
+        free( psz_link );
+        free( psz_src );
+    }
+
+    /* No user scripts */
+    setenv( "XDG_DATA_HOME", psz_dir, 1 );
+    setenv( "VLC_DATA_PATH", psz_dir, 1 );
+
+    static const char *argv[] = {
+        "-v", "--ignore-config", "--no-auto-preparse",
+        "--lua-intf=test_journal",
+    };
+    libvlc_instance_t *p_vlc = libvlc_new( ARRAY_SIZE(argv), argv );
+    assert( p_vlc != NULL );
+
+    vlc_sem_t done;
+    vlc_sem_init( &done, 0 );
+    libvlc_set_exit_handler( p_vlc, Exit, &done );
+    assert( libvlc_add_intf( p_vlc, "luaintf" ) == 0 );
+    vlc_sem_wait( &done );
+
+    char *psz_result = var_GetString( p_vlc->p_libvlc_int, "test-journal" );
+    assert( psz_result != NULL );
+    if( strcmp( psz_result, "ok" ) )
+    {
+        fprintf( stderr, "journal.lua: %s\n", psz_result );
+        abort();
+    }
+    free( psz_result );
+
+    libvlc_release( p_vlc );
+    vlc_sem_destroy( &done );
+
+    for( size_t i = ARRAY_SIZE(links); i > 0; i-- )
+    {
+        char *psz_link = Path( psz_dir, links[i - 1][0] );
+        unlink( psz_link );
+        free( psz_link );
+    }
+    rmdir( psz_intf );
+    rmdir( psz_lua );
+    rmdir( psz_dir );
+    free( psz_intf );
+    free( psz_lua );
+    return 0;
+}
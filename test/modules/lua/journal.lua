@@ -0,0 +1,137 @@
+--[==========================================================================[
+ journal.lua: tests the playlist change journal and pages, run by journal.c
+--[==========================================================================[
+ Copyright (C) 2017 VLC authors and VideoLAN
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+--]==========================================================================]
+
+local function check(cond, msg)
+    if not cond then
+        error(msg, 2)
+    end
+end
+
+local function enqueue(count, name)
+    local items = {}
+    for i = 1, count do
+        table.insert(items, { path = "vlc://nop", name = name and name..i })
+    end
+    vlc.playlist.enqueue(items)
+end
+
+local function test_journal()
+    local j = vlc.playlist.journal()
+    local seq0 = j:seq()
+
+    enqueue(10, "item ")
+    local seq, changes = j:since(seq0)
+    check(changes ~= nil and #changes == 10, "10 items added")
+    local ids = {}
+    for i, c in ipairs(changes) do
+        check(c.type == "added", "added type")
+        check(c.seq > seq0 and c.seq <= seq, "added sequence number")
+        check(c.item.name == "item "..i, "added item")
+        check(c.parent ~= nil, "added parent")
+        ids[i] = c.id
+    end
+
+    local seq1, none = j:since(seq)
+    check(seq1 == seq and #none == 0, "no change")
+
+    local page = vlc.playlist.page(3, 4)
+    check(page.total == 10, "page total")
+    check(#page.items == 4, "page size")
+    for i, item in ipairs(page.items) do
+        check(item.id == ids[3 + i], "page item")
+    end
+    check(#vlc.playlist.page(8, 4).items == 2, "last page")
+    check(#vlc.playlist.page(10).items == 0, "page after the end")
+
+    vlc.playlist.delete(ids[1])
+    local seq2, removed = j:since(seq)
+    check(#removed == 1, "1 item removed")
+    check(removed[1].type == "removed" and removed[1].id == ids[1],
+          "removed item")
+    check(removed[1].item == nil, "removed item not given")
+    check(vlc.playlist.page().total == 9, "total after removal")
+
+    local mark = j:mark()
+    check(mark == seq2 + 1 and j:seq() == mark, "mark")
+
+    -- more changes than recorded: the old ones are lost
+    enqueue(600)
+    local seq3, lost = j:since(seq2)
+    check(lost == nil and seq3 == j:seq(), "lost changes")
+    local _, recent = j:since(seq3 - 1)
+    check(#recent == 1 and recent[1].seq == seq3, "recent change")
+    check(j:since(seq3 + 1) == seq3, "future sequence number")
+end
+
+local function test_http()
+    require "httprequests"
+
+    -- the time and position of the input change on every poll
+    vlc.playlist.add({ { path = "vlc://pause:30" } })
+    local input
+    for i = 1, 50 do
+        input = vlc.object.input()
+        if input and vlc.playlist.status() == "playing" then
+            break
+        end
+        vlc.misc.mwait(vlc.misc.mdate() + 50000)
+    end
+    check(input ~= nil, "playing")
+
+    _GET = { since = "0" }
+    local r = httprequests.geteventstable()
+    check(r.reset and r.status.state ~= nil, "reset")
+    check(r.time ~= nil and r.position ~= nil, "reset time")
+
+    -- a playing input gives empty deltas, with the same sequence number
+    for i = 1, 3 do
+        vlc.var.set(input, "position", i / 10)
+        _GET = { since = tostring(r.seq) }
+        local delta = httprequests.geteventstable()
+        check(not delta.reset, "no reset")
+        check(delta.seq == r.seq, "idle sequence number")
+        check(next(delta.status) == nil, "idle status")
+        check(#delta.playlist._array == 0, "idle playlist")
+        check(delta.time ~= nil and delta.position ~= nil, "idle time")
+    end
+
+    vlc.playlist.random("on")
+    enqueue(1, "new ")
+    _GET = { since = tostring(r.seq) }
+    local delta = httprequests.geteventstable()
+    check(delta.seq > r.seq, "changed sequence number")
+    check(delta.status.random == true, "changed status")
+    check(#delta.playlist._array == 1, "changed playlist")
+    check(delta.playlist._array[1].type == "added", "added")
+    check(delta.playlist._array[1].item.name == "new 1", "added item")
+
+    _GET = { offset = "2", count = "5" }
+    local page = httprequests.playlistpagetable()
+    check(page.total == 611 and page.offset == 2, "page")
+    check(#page.children._array == 5, "page size")
+    check(page.seq == delta.seq, "page sequence number")
+end
+
+local ok, err = pcall(function ()
+    test_journal()
+    test_http()
+end)
+vlc.var.create(vlc.object.libvlc(), "test-journal", ok and "ok" or err)
+vlc.misc.quit()
@@ -0,0 +1,205 @@
+/*****************************************************************************
+ * mp4.c: MP4 muxer sample index tests
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Built with tiny ENTRY_SPILL_THRESHOLD and ENTRY_WINDOW_SIZE, so that most
+ * of the index is moved to disk and read back through many windows.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include "../modules/mux/mp4/libmp4mux.h"
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#define SAMPLES      3500
+#define CHUNK        10     /* samples per chunk */
+#define DURATION     40000
+#define TIMESCALE    90000
+
+static mp4mux_entry_t Expected( unsigned i )
+{
+    mp4mux_entry_t entry = {
+        .i_size = 100 + i % 7,
+        .i_length = DURATION,
+        .i_pts_dts = ( i % 3 ) * DURATION,
+        .i_flags = ( i % 30 ) ? 0 : BLOCK_FLAG_TYPE_I,
+    };
+    uint64_t i_pos = 48;
+
+    /* Samples are contiguous within a chunk, not across chunks */
+    for( unsigned j = 0; j < i; j++ )
+        i_pos += 100 + j % 7 + ( ( j + 1 ) % CHUNK ? 0 : 1000 );
+    entry.i_pos = i_pos;
+    return entry;
+}
+
+static void Fill( mp4mux_trackinfo_t *p_track )
+{
+    assert( mp4mux_trackinfo_Init( p_track, 1, TIMESCALE ) );
+    es_format_Init( &p_track->fmt, VIDEO_ES, VLC_CODEC_MP4V );
+    p_track->fmt.video.i_width = p_track->fmt.video.i_visible_width = 320;
+    p_track->fmt.video.i_height = p_track->fmt.video.i_visible_height = 240;
+    p_track->b_hasbframes = true;
+
+    for( unsigned i = 0; i < SAMPLES; i++ )
+    {
+        mp4mux_entry_t *p_entry = mp4mux_track_AddEntry( p_track );
+        assert( p_entry != NULL );
+        *p_entry = Expected( i );
+        p_track->i_read_duration += DURATION;
+    }
+    assert( p_track->i_entry_count == SAMPLES );
+}
+
+/* Payload of the first box of this type */
+static const uint8_t *FindBox( const bo_t *box, const char *psz_type )
+{
+    const uint8_t *p = box->b->p_buffer;
+    size_t i = 4;
+
+    for( ; i + 4 <= box->b->i_buffer; i++ )
+        if( !memcmp( &p[i], psz_type, 4 ) )
+            return &p[i + 4];
+    assert( !"box not found" );
+    return NULL;
+}
+
+static void CheckSampleTable( const bo_t *moov )
+{
+    /* Sizes */
+    const uint8_t *p = FindBox( moov, "stsz" );
+    assert( GetDWBE( &p[4] ) == 0 ); /* varying */
+    assert( GetDWBE( &p[8] ) == SAMPLES );
+    for( unsigned i = 0; i < SAMPLES; i++ )
+        assert( GetDWBE( &p[12 + 4 * i] ) == (uint32_t) Expected( i ).i_size );
+
+    /* Chunk offsets */
+    p = FindBox( moov, "stco" );
+    assert( GetDWBE( &p[4] ) == SAMPLES / CHUNK );
+    for( unsigned i = 0; i < SAMPLES / CHUNK; i++ )
+        assert( GetDWBE( &p[8 + 4 * i] ) == Expected( i * CHUNK ).i_pos );
+
+    /* Samples per chunk */
+    p = FindBox( moov, "stsc" );
+    assert( GetDWBE( &p[4] ) == 1 );
+    assert( GetDWBE( &p[8] ) == 1 && GetDWBE( &p[12] ) == CHUNK );
+
+    /* Durations */
+    p = FindBox( moov, "stts" );
+    assert( GetDWBE( &p[4] ) == 1 );
+    assert( GetDWBE( &p[8] ) == SAMPLES );
+    assert( GetDWBE( &p[12] ) == (uint64_t) DURATION * TIMESCALE / CLOCK_FREQ );
+
+    /* Composition offsets, one run per sample */
+    p = FindBox( moov, "ctts" );
+    assert( GetDWBE( &p[4] ) == SAMPLES );
+    for( unsigned i = 0; i < SAMPLES; i++ )
+    {
+        assert( GetDWBE( &p[8 + 8 * i] ) == 1 );
+        assert( GetDWBE( &p[12 + 8 * i] ) ==
+                Expected( i ).i_pts_dts * TIMESCALE / CLOCK_FREQ );
+    }
+}
+
+static void test_spill( vlc_object_t *obj )
+{
+    mp4mux_trackinfo_t track, *p_track = &track;
+
+    log( "Testing spilled sample index\n" );
+
+    Fill( p_track );
+    assert( track.i_spilled > SAMPLES / 2 );
+
+    /* Read back, forwards and backwards */
+    for( unsigned i = 0; i < SAMPLES; i++ )
+    {
+        mp4mux_entry_t entry, expected = Expected( i );
+        assert( mp4mux_track_GetEntry( p_track, i, &entry ) == VLC_SUCCESS );
+        assert( entry.i_pos == expected.i_pos );
+        assert( entry.i_size == expected.i_size );
+        assert( entry.i_length == expected.i_length );
+        assert( entry.i_pts_dts == expected.i_pts_dts );
+        assert( entry.i_flags == expected.i_flags );
+    }
+    for( unsigned i = SAMPLES; i-- > 0; )
+    {
+        mp4mux_entry_t entry;
+        assert( mp4mux_track_GetEntry( p_track, i, &entry ) == VLC_SUCCESS );
+        assert( entry.i_pos == Expected( i ).i_pos );
+    }
+
+    bo_t *moov = mp4mux_GetMoovBox( obj, &p_track, 1, 0,
+                                    false, false, false, false );
+    assert( moov != NULL && moov->b != NULL );
+    CheckSampleTable( moov );
+    bo_free( moov );
+
+    mp4mux_trackinfo_Clear( p_track );
+}
+
+static void test_spill_error( vlc_object_t *obj )
+{
+    mp4mux_trackinfo_t track, *p_track = &track;
+    mp4mux_entry_t entry;
+
+    log( "Testing spilled sample index read error\n" );
+
+    Fill( p_track );
+
+    /* The entries on disk are lost */
+    vlc_close( track.i_spill_fd );
+    track.i_spill_fd = -1;
+    track.i_window_count = 0;
+
+    assert( mp4mux_track_GetEntry( p_track, 0, &entry ) != VLC_SUCCESS );
+    assert( mp4mux_track_GetEntry( p_track, SAMPLES - 1, &entry ) == VLC_SUCCESS );
+    /* No index rather than a wrong one */
+    assert( mp4mux_GetMoovBox( obj, &p_track, 1, 0,
+                               false, false, false, false ) == NULL );
+
+    mp4mux_trackinfo_Clear( p_track );
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *p_vlc = libvlc_new( 0, NULL );
+    assert( p_vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT( p_vlc->p_libvlc_int );
+
+    test_spill( obj );
+    test_spill_error( obj );
+
+    libvlc_release( p_vlc );
+    return 0;
+}
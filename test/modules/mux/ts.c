@@ -0,0 +1,382 @@
+/*****************************************************************************
+ * ts.c: MPEG Transport Stream muxer constant bitrate tests
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#define MODULE_NAME test_capture
+#define MODULE_STRING "test_capture"
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_block.h>
+#include <vlc_sout.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#define MUXRATE      2000000
+#define VIDEO_SIZE   4000   /* 800 kbit/s */
+#define VIDEO_LENGTH 40000
+#define AUDIO_SIZE   384    /* 128 kbit/s */
+#define AUDIO_LENGTH 24000
+#define PCR_DELAY    70000  /* default --sout-ts-pcr */
+
+/* Output of the muxer, and the date of each written block */
+static struct
+{
+    uint8_t  *p_data;
+    size_t    i_size;
+    struct
+    {
+        size_t  i_pos;
+        mtime_t i_dts;
+    }        *p_blocks;
+    unsigned  i_blocks;
+} out;
+
+static ssize_t Write( sout_access_out_t *p_access, block_t *p_block )
+{
+    ssize_t i_total = 0;
+
+    VLC_UNUSED(p_access);
+    while( p_block != NULL )
+    {
+        block_t *p_next = p_block->p_next;
+
+        out.p_data = realloc( out.p_data, out.i_size + p_block->i_buffer );
+        assert( out.p_data != NULL );
+        out.p_blocks = realloc( out.p_blocks,
+                                ( out.i_blocks + 1 ) * sizeof(*out.p_blocks) );
+        assert( out.p_blocks != NULL );
+        out.p_blocks[out.i_blocks].i_pos = out.i_size;
+        out.p_blocks[out.i_blocks++].i_dts = p_block->i_dts;
+
+        memcpy( &out.p_data[out.i_size], p_block->p_buffer, p_block->i_buffer );
+        out.i_size += p_block->i_buffer;
+        i_total += p_block->i_buffer;
+
+        block_Release( p_block );
+        p_block = p_next;
+    }
+    return i_total;
+}
+
+static int OpenAccess( vlc_object_t *obj )
+{
+    sout_access_out_t *p_access = (sout_access_out_t *) obj;
+
+    p_access->pf_write = Write;
+    return VLC_SUCCESS;
+}
+
+vlc_module_begin()
+    set_capability( "sout access", 0 )
+    set_callbacks( OpenAccess, NULL )
+vlc_module_end()
+
+typedef int (*vlc_plugin_cb)(int (*)(void *, void *, int, ...), void *);
+
+__attribute__((visibility("default")))
+vlc_plugin_cb vlc_static_modules[] = { vlc_entry__test_capture, NULL };
+
+static void SendBlock( sout_mux_t *p_mux, sout_input_t *p_input,
+                       size_t i_size, mtime_t i_dts, mtime_t i_length,
+                       uint32_t i_flags )
+{
+    block_t *p_block = block_Alloc( i_size );
+    assert( p_block != NULL );
+    memset( p_block->p_buffer, 0x5a, i_size );
+    p_block->i_dts = p_block->i_pts = i_dts;
+    p_block->i_length = i_length;
+    p_block->i_flags = i_flags;
+    assert( sout_MuxSendBuffer( p_mux, p_input, p_block ) == VLC_SUCCESS );
+}
+
+/* Muxes one video and one audio ES, with a jump of i_gap after half of
+ * i_duration, and leaves the result in out */
+static void Mux( vlc_object_t *obj, const char *psz_options,
+                 mtime_t i_duration, mtime_t i_gap )
+{
+    /* Stand-in for the stream output instance of the sout chain */
+    sout_instance_t *p_sout = vlc_object_create( obj, sizeof(*p_sout) );
+    assert( p_sout != NULL );
+    p_sout->psz_sout = NULL;
+    p_sout->i_out_pace_nocontrol = 0;
+    vlc_mutex_init( &p_sout->lock );
+    p_sout->p_stream = NULL;
+    var_Create( p_sout, "sout-mux-caching", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
+
+    memset( &out, 0, sizeof(out) );
+    sout_access_out_t *p_access = sout_AccessOutNew( p_sout, "test_capture", "" );
+    assert( p_access != NULL );
+    char psz_mux[64];
+    snprintf( psz_mux, sizeof(psz_mux), "ts{%s}", psz_options );
+    sout_mux_t *p_mux = sout_MuxNew( p_sout, psz_mux, p_access );
+    assert( p_mux != NULL );
+
+    es_format_t fmt;
+    es_format_Init( &fmt, VIDEO_ES, VLC_CODEC_MPGV );
+    fmt.video.i_width = fmt.video.i_visible_width = 352;
+    fmt.video.i_height = fmt.video.i_visible_height = 288;
+    sout_input_t *p_video = sout_MuxAddStream( p_mux, &fmt );
+    assert( p_video != NULL );
+    es_format_Clean( &fmt );
+
+    es_format_Init( &fmt, AUDIO_ES, VLC_CODEC_MPGA );
+    fmt.audio.i_rate = 48000;
+    fmt.audio.i_channels = 2;
+    sout_input_t *p_audio = sout_MuxAddStream( p_mux, &fmt );
+    assert( p_audio != NULL );
+    es_format_Clean( &fmt );
+
+    /* Interleaved by dts, as the sout chain would send them */
+    mtime_t i_video = 0, i_audio = 0;
+    while( i_video < i_duration || i_audio < i_duration )
+    {
+        const bool b_video = i_video <= i_audio;
+        const mtime_t i_time = b_video ? i_video : i_audio;
+        const mtime_t i_length = b_video ? VIDEO_LENGTH : AUDIO_LENGTH;
+        mtime_t i_dts = VLC_TS_0 + CLOCK_FREQ + i_time;
+        uint32_t i_flags = 0;
+
+        if( i_gap > 0 && i_time >= i_duration / 2 )
+        {
+            i_dts += i_gap;
+            /* Otherwise the previous block would last over the gap */
+            if( i_time < i_duration / 2 + i_length )
+                i_flags |= BLOCK_FLAG_DISCONTINUITY;
+        }
+
+        if( b_video )
+        {
+            i_flags |= ( i_video % ( 12 * VIDEO_LENGTH ) ) ? BLOCK_FLAG_TYPE_P
+                                                           : BLOCK_FLAG_TYPE_I;
+            SendBlock( p_mux, p_video, VIDEO_SIZE, i_dts, i_length, i_flags );
+            i_video += i_length;
+        }
+        else
+        {
+            SendBlock( p_mux, p_audio, AUDIO_SIZE, i_dts, i_length, i_flags );
+            i_audio += i_length;
+        }
+    }
+
+    sout_MuxDeleteStream( p_mux, p_audio );
+    sout_MuxDeleteStream( p_mux, p_video );
+    sout_MuxDelete( p_mux );
+    sout_AccessOutDelete( p_access );
+    vlc_mutex_destroy( &p_sout->lock );
+    vlc_object_release( p_sout );
+}
+
+static int64_t GetPCR( const uint8_t *p_ts )
+{
+    int64_t i_base = ( (int64_t)GetDWBE( &p_ts[6] ) << 1 ) | ( p_ts[10] >> 7 );
+
+    return i_base * 300 + ( ( p_ts[10] & 0x01 ) << 8 | p_ts[11] );
+}
+
+/* Exact PCR distance of two positions in a stream at MUXRATE */
+static int64_t PCRDistance( size_t i_from, size_t i_to )
+{
+    return (int64_t)( i_to - i_from ) * 8 * 27000000 / MUXRATE;
+}
+
+/* Checks the packets and the PCRs of out, returns the count of PCRs with
+ * the discontinuity indicator */
+static unsigned Check( mtime_t i_duration )
+{
+    int i_cc[0x2000];
+    size_t i_pcr_pos = 0, i_restart_pos = 0;
+    int64_t i_pcr = -1;
+    unsigned i_pcrs = 0, i_nulls = 0, i_discontinuities = 0;
+
+    assert( out.i_size > 0 && out.i_size % 188 == 0 );
+    for( unsigned i = 0; i < 0x2000; i++ )
+        i_cc[i] = -1;
+
+    for( size_t i_pos = 0; i_pos < out.i_size; i_pos += 188 )
+    {
+        const uint8_t *p_ts = &out.p_data[i_pos];
+        const unsigned i_pid = ( p_ts[1] & 0x1f ) << 8 | p_ts[2];
+        const bool b_adaptation = p_ts[3] & 0x20;
+        const bool b_payload = p_ts[3] & 0x10;
+
+        assert( p_ts[0] == 0x47 );
+        if( i_pid == 0x1fff )
+        {
+            i_nulls++;
+            continue;
+        }
+
+        /* No continuity error, adaptation only packets keep the counter */
+        const int i_expected = b_payload ? ( i_cc[i_pid] + 1 ) % 16 : i_cc[i_pid];
+        assert( i_cc[i_pid] < 0 || ( p_ts[3] & 0x0f ) == i_expected );
+        i_cc[i_pid] = p_ts[3] & 0x0f;
+
+        if( !b_adaptation || p_ts[4] < 7 || !( p_ts[5] & 0x10 ) )
+            continue;
+
+        /* The PCR is the date of its own byte position */
+        const int64_t i_new_pcr = GetPCR( p_ts );
+        if( p_ts[5] & 0x80 )
+        {
+            i_restart_pos = i_pos;
+            i_discontinuities++;
+        }
+        else if( i_pcr >= 0 )
+        {
+            int64_t i_drift = i_new_pcr - i_pcr - PCRDistance( i_pcr_pos, i_pos );
+            assert( i_drift >= -1 && i_drift <= 1 );
+            assert( i_new_pcr - i_pcr <= ( PCR_DELAY + 1 ) * 27 +
+                                          PCRDistance( 0, 188 ) );
+        }
+        i_pcr = i_new_pcr;
+        i_pcr_pos = i_pos;
+        i_pcrs++;
+    }
+
+    /* Padded with null packets, and as long as the content */
+    assert( i_pcrs >= ( i_duration - CLOCK_FREQ ) / PCR_DELAY );
+    assert( i_nulls > 0 );
+    assert( llabs( PCRDistance( 0, out.i_size ) / 27 - i_duration ) < CLOCK_FREQ );
+
+    /* Blocks are dated at the position of their first packet */
+    for( unsigned i = 1; i < out.i_blocks; i++ )
+    {
+        if( out.p_blocks[i - 1].i_pos < i_restart_pos &&
+            out.p_blocks[i].i_pos >= i_restart_pos )
+            continue;
+
+        mtime_t i_delta = out.p_blocks[i].i_dts - out.p_blocks[i - 1].i_dts;
+        mtime_t i_expected = PCRDistance( out.p_blocks[i - 1].i_pos,
+                                          out.p_blocks[i].i_pos ) / 27;
+
+        assert( i_delta - i_expected >= -1 && i_delta - i_expected <= 1 );
+    }
+
+    free( out.p_data );
+    free( out.p_blocks );
+    return i_discontinuities;
+}
+
+static void MuxCBR( vlc_object_t *obj, mtime_t i_duration, mtime_t i_gap )
+{
+    char psz_options[32];
+    snprintf( psz_options, sizeof(psz_options), "muxrate=%d", MUXRATE );
+    Mux( obj, psz_options, i_duration, i_gap );
+}
+
+/* Checks that the video frames were muxed in order, the key frames right
+ * after a PAT and a PMT */
+static void CheckKeyFrames( mtime_t i_duration )
+{
+    unsigned i_frames = 0;
+    size_t i_prev[2] = { 0, 0 }; /* previous non null packets */
+    unsigned i_packets = 0;
+
+    assert( out.i_size > 0 && out.i_size % 188 == 0 );
+    for( size_t i_pos = 0; i_pos < out.i_size; i_pos += 188 )
+    {
+        const uint8_t *p_ts = &out.p_data[i_pos];
+        const unsigned i_pid = ( p_ts[1] & 0x1f ) << 8 | p_ts[2];
+        size_t i_payload = 4;
+
+        assert( p_ts[0] == 0x47 );
+        if( i_pid == 0x1fff )
+            continue;
+        if( p_ts[3] & 0x20 )
+            i_payload += 1 + p_ts[4];
+
+        /* Start of a video PES */
+        if( ( p_ts[1] & 0x40 ) && i_payload + 4 <= 188 &&
+            !memcmp( &p_ts[i_payload], "\x00\x00\x01\xe0", 4 ) )
+        {
+            if( i_frames % 12 == 0 )
+            {
+                assert( i_packets >= 2 );
+                const uint8_t *p_pat = &out.p_data[i_prev[0]];
+                const uint8_t *p_pmt = &out.p_data[i_prev[1]];
+                assert( ( p_pat[1] & 0x1f ) == 0 && p_pat[2] == 0 );
+                assert( ( ( p_pmt[1] & 0x1f ) << 8 | p_pmt[2] ) != i_pid );
+            }
+            i_frames++;
+        }
+
+        i_prev[0] = i_prev[1];
+        i_prev[1] = i_pos;
+        i_packets++;
+    }
+    /* The muxer keeps the last frames, none is missing before them */
+    assert( i_frames >= ( i_duration - CLOCK_FREQ ) / VIDEO_LENGTH );
+
+    free( out.p_data );
+    free( out.p_blocks );
+}
+
+static void test_cbr( vlc_object_t *obj )
+{
+    log( "Testing constant bitrate PCR\n" );
+
+    MuxCBR( obj, 10 * CLOCK_FREQ, 0 );
+    assert( Check( 10 * CLOCK_FREQ ) == 0 );
+}
+
+static void test_gap( vlc_object_t *obj )
+{
+    log( "Testing constant bitrate clock restart\n" );
+
+    /* The slot clock restarts once, with the discontinuity indicator */
+    MuxCBR( obj, 6 * CLOCK_FREQ, 3 * CLOCK_FREQ );
+    assert( Check( 6 * CLOCK_FREQ ) == 1 );
+}
+
+static void test_key_frames( vlc_object_t *obj )
+{
+    log( "Testing tables before the key frames\n" );
+
+    Mux( obj, "use-key-frames", 6 * CLOCK_FREQ, 0 );
+    CheckKeyFrames( 6 * CLOCK_FREQ );
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *p_vlc = libvlc_new( 0, NULL );
+    assert( p_vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT( p_vlc->p_libvlc_int );
+
+    test_cbr( obj );
+    test_gap( obj );
+    test_key_frames( obj );
+
+    libvlc_release( p_vlc );
+    return 0;
+}
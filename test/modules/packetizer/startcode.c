@@ -0,0 +1,293 @@
+/*****************************************************************************
+ * startcode.c: tests the AnnexB startcode scanners
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+#include "../modules/packetizer/packetizer_helper.h"
+#include "../modules/packetizer/startcode_helper.h"
+
+#define TEST_SIZE   (1 << 16)
+#define BENCH_SIZE  (1 << 22)
+#define BENCH_LOOPS 50
+
+typedef const uint8_t * (*find_t)( const uint8_t *, const uint8_t * );
+typedef size_t (*find_all_t)( const uint8_t *, const uint8_t *, const uint8_t **, size_t );
+
+static const struct
+{
+    const char *psz_name;
+    find_t pf_find;
+    find_all_t pf_find_all;
+    unsigned i_cpu; /* required CPU flags */
+} impls[] = {
+    { "dispatch", startcode_FindAnnexB, startcode_FindAllAnnexB, 0 },
+    { "C",        startcode_FindAnnexB_C, NULL, 0 },
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    { "SSE2",     startcode_FindAnnexB_SSE2, NULL, VLC_CPU_SSE2 },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "AVX2",     startcode_FindAnnexB_AVX2, startcode_FindAllAnnexB_AVX2, VLC_CPU_AVX2 },
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    { "NEON",     startcode_FindAnnexB_NEON, startcode_FindAllAnnexB_NEON, 0 },
+#endif
+};
+
+static bool Available( size_t i )
+{
+    return (vlc_CPU() & impls[i].i_cpu) == impls[i].i_cpu;
+}
+
+static const uint8_t * FindRef( const uint8_t *p, const uint8_t *end )
+{
+    for( ; end - p >= 3; p++ )
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    return NULL;
+}
+
+static void Generate( uint8_t *p, size_t i_size, unsigned i_density, bool b_zeros )
+{
+    for( size_t i = 0; i < i_size; i++ ) /* zeros for plenty of partial matches */
+        p[i] = (!b_zeros || rand() % 4) ? rand() : 0;
+    for( size_t i = 0; i + 4 < i_size; i++ )
+    {
+        if( (unsigned) rand() % i_density == 0 )
+        {
+            p[i] = p[i + 1] = 0;
+            p[i + 2] = 1;
+        }
+    }
+    /* so that the last unit is never a lone startcode */
+    memset( &p[i_size - 4], 0xFF, 4 );
+}
+
+static void test_find( const uint8_t *p_data, size_t i_data, size_t i_span )
+{
+    const uint8_t *pp_found[PACKETIZER_STARTCODES_MAX];
+
+    for( size_t i = 0; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !Available( i ) )
+            continue;
+
+        /* all alignments and short tails */
+        for( size_t i_start = 0; i_start < i_span; i_start++ )
+        {
+            for( size_t i_end = i_data - i_span; i_end <= i_data; i_end++ )
+            {
+                const uint8_t *end = &p_data[i_end];
+                const uint8_t *p = &p_data[i_start];
+                while( p < end )
+                {
+                    const uint8_t *p_ref = FindRef( p, end );
+                    assert( impls[i].pf_find( p, end ) == p_ref );
+                    if( !p_ref )
+                        break;
+                    p = p_ref + 1;
+                }
+
+                if( impls[i].pf_find_all == NULL )
+                    continue;
+
+                p = &p_data[i_start];
+                for( ;; )
+                {
+                    size_t i_found = impls[i].pf_find_all( p, end, pp_found,
+                                                           PACKETIZER_STARTCODES_MAX );
+                    assert( i_found <= PACKETIZER_STARTCODES_MAX );
+                    for( size_t j = 0; j < i_found; j++ )
+                    {
+                        const uint8_t *p_ref = FindRef( p, end );
+                        assert( pp_found[j] == p_ref );
+                        p = p_ref + 1;
+                    }
+                    if( i_found < PACKETIZER_STARTCODES_MAX )
+                    {
+                        assert( FindRef( p, end ) == NULL );
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Packetizer side: splits on startcodes whatever the block boundaries */
+typedef struct
+{
+    const uint8_t *p_ref;
+    size_t i_pos;
+    unsigned i_units;
+} split_ctx_t;
+
+static void Reset( void *p_private, bool b_broken )
+{
+    VLC_UNUSED(p_private); VLC_UNUSED(b_broken);
+}
+
+static block_t * Parse( void *p_private, bool *pb_ts_used, block_t *p_unit )
+{
+    split_ctx_t *ctx = p_private;
+    *pb_ts_used = false;
+    assert( !memcmp( p_unit->p_buffer, &ctx->p_ref[ctx->i_pos], p_unit->i_buffer ) );
+    assert( p_unit->p_buffer[0] == 0 && p_unit->p_buffer[1] == 0 &&
+            p_unit->p_buffer[2] == 1 );
+    ctx->i_pos += p_unit->i_buffer;
+    ctx->i_units++;
+    /* alternate between returned and dropped units */
+    if( ctx->i_units & 1 )
+    {
+        block_Release( p_unit );
+        return NULL;
+    }
+    return p_unit;
+}
+
+static int Validate( void *p_private, block_t *p_unit )
+{
+    VLC_UNUSED(p_private); VLC_UNUSED(p_unit);
+    return 0;
+}
+
+static void test_packetizer( const uint8_t *p_data, size_t i_data, size_t i_block,
+                             bool b_batched )
+{
+    static const uint8_t p_startcode[3] = { 0x00, 0x00, 0x01 };
+    split_ctx_t ctx = { .p_ref = p_data, .i_pos = 0, .i_units = 0 };
+    packetizer_t pack;
+
+    packetizer_Init( &pack, p_startcode, 3, startcode_FindAnnexB,
+                     b_batched ? startcode_FindAllAnnexB : NULL,
+                     NULL, 0, 0, Reset, Parse, Validate, &ctx );
+
+    /* leading garbage is skipped */
+    ctx.i_pos = FindRef( p_data, &p_data[i_data] ) - p_data;
+
+    for( size_t i_pos = 0; i_pos < i_data; )
+    {
+        size_t i_size = 1 + (size_t) rand() % i_block;
+        if( i_size > i_data - i_pos )
+            i_size = i_data - i_pos;
+        block_t *p_block = block_Alloc( i_size );
+        assert( p_block );
+        memcpy( p_block->p_buffer, &p_data[i_pos], i_size );
+        i_pos += i_size;
+
+        block_t *p_unit;
+        while( (p_unit = packetizer_Packetize( &pack, &p_block )) )
+            block_Release( p_unit );
+    }
+
+    block_t *p_unit;
+    while( (p_unit = packetizer_Packetize( &pack, NULL )) )
+        block_Release( p_unit );
+
+    assert( ctx.i_pos == i_data );
+    packetizer_Clean( &pack );
+}
+
+static void bench( const uint8_t *p_data, size_t i_data )
+{
+    const uint8_t *pp_found[PACKETIZER_STARTCODES_MAX];
+
+    for( size_t i = 0; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !Available( i ) )
+            continue;
+
+        const uint8_t *end = &p_data[i_data];
+        unsigned i_count = 0;
+        mtime_t i_start = mdate();
+        for( unsigned j = 0; j < BENCH_LOOPS; j++ )
+            for( const uint8_t *p = p_data; (p = impls[i].pf_find( p, end )); p++ )
+                i_count++;
+        mtime_t i_elapsed = __MAX( mdate() - i_start, 1 );
+        printf( "%-8s first: %7.1f MiB/s (%u)\n", impls[i].psz_name,
+                (double) i_data * BENCH_LOOPS * CLOCK_FREQ / i_elapsed / (1 << 20),
+                i_count );
+
+        if( impls[i].pf_find_all == NULL )
+            continue;
+
+        i_count = 0;
+        i_start = mdate();
+        for( unsigned j = 0; j < BENCH_LOOPS; j++ )
+        {
+            for( const uint8_t *p = p_data; ; )
+            {
+                size_t i_found = impls[i].pf_find_all( p, end, pp_found,
+                                                       PACKETIZER_STARTCODES_MAX );
+                i_count += i_found;
+                if( i_found < PACKETIZER_STARTCODES_MAX )
+                    break;
+                p = pp_found[i_found - 1] + 1;
+            }
+        }
+        i_elapsed = __MAX( mdate() - i_start, 1 );
+        printf( "%-8s all:   %7.1f MiB/s (%u)\n", impls[i].psz_name,
+                (double) i_data * BENCH_LOOPS * CLOCK_FREQ / i_elapsed / (1 << 20),
+                i_count );
+    }
+}
+
+int main( void )
+{
+    uint8_t *p_data = malloc( BENCH_SIZE );
+    assert( p_data );
+
+    srand( 42 );
+
+    /* sparse and dense startcodes */
+    const unsigned pi_density[] = { 5, 64, 4096, TEST_SIZE * 2 };
+    for( size_t i = 0; i < ARRAY_SIZE(pi_density); i++ )
+    {
+        Generate( p_data, TEST_SIZE, pi_density[i], true );
+        if( FindRef( p_data, &p_data[TEST_SIZE] ) == NULL )
+            continue;
+        test_find( p_data, 4096, 40 );
+        test_find( p_data, TEST_SIZE, 2 );
+        for( size_t i_block = 1; i_block <= 65536; i_block *= 16 )
+        {
+            test_packetizer( p_data, TEST_SIZE, i_block, false );
+            test_packetizer( p_data, TEST_SIZE, i_block, true );
+        }
+    }
+
+    /* video like: sparse startcodes, random payload */
+    Generate( p_data, BENCH_SIZE, 8192, false );
+    bench( p_data, BENCH_SIZE );
+
+    free( p_data );
+    return 0;
+}
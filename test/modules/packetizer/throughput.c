@@ -0,0 +1,307 @@
+/*****************************************************************************
+ * throughput.c: measures H.264/HEVC packetizers parsing speed
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Not run by "make check":
+ * $ make test_modules_packetizer_throughput
+ * $ ./test_modules_packetizer_throughput [file.264|file.hevc|-] [block size]
+ * Without file (or with -), a synthetic 1080p H.264 stream with 8 slices
+ * per picture is generated.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_codec.h>
+#include <vlc_demux.h>
+#include <vlc_modules.h>
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PICTURES      600
+#define BENCH_SLICES        8
+#define BENCH_SLICE_SIZE    6000
+#define BENCH_LOOPS         10
+
+typedef struct
+{
+    uint8_t *p;
+    size_t i_size;
+    size_t i_alloc;
+    uint64_t bits; /* pending bits, MSB first */
+    unsigned i_bits;
+    unsigned i_zeros;
+} bw_t;
+
+static void bw_byte( bw_t *bw, uint8_t v )
+{
+    if( bw->i_size + 2 > bw->i_alloc )
+    {
+        bw->i_alloc = (bw->i_alloc + 2) * 2;
+        bw->p = realloc( bw->p, bw->i_alloc );
+        assert( bw->p );
+    }
+    /* emulation prevention */
+    if( bw->i_zeros >= 2 && v <= 3 )
+    {
+        bw->p[bw->i_size++] = 0x03;
+        bw->i_zeros = 0;
+    }
+    bw->p[bw->i_size++] = v;
+    bw->i_zeros = v ? 0 : bw->i_zeros + 1;
+}
+
+static void bw_write( bw_t *bw, unsigned i_count, uint32_t v )
+{
+    for( unsigned i = i_count; i > 0; i-- )
+    {
+        bw->bits = (bw->bits << 1) | ((v >> (i - 1)) & 1);
+        if( ++bw->i_bits == 8 )
+        {
+            bw_byte( bw, bw->bits & 0xFF );
+            bw->i_bits = 0;
+        }
+    }
+}
+
+static void bw_ue( bw_t *bw, uint32_t v )
+{
+    unsigned i_len = 0;
+    for( uint32_t t = v + 1; t > 1; t >>= 1 )
+        i_len++;
+    bw_write( bw, i_len, 0 );
+    bw_write( bw, i_len + 1, v + 1 );
+}
+
+static void bw_nal( bw_t *bw, uint8_t i_header )
+{
+    static const uint8_t startcode[4] = { 0, 0, 0, 1 };
+    for( int i = 0; i < 4; i++ )
+    {
+        if( bw->i_size + 1 > bw->i_alloc )
+        {
+            bw->i_alloc = (bw->i_alloc + 1) * 2;
+            bw->p = realloc( bw->p, bw->i_alloc );
+            assert( bw->p );
+        }
+        bw->p[bw->i_size++] = startcode[i];
+    }
+    bw->i_zeros = 0;
+    bw_write( bw, 8, i_header );
+}
+
+static void bw_trailing( bw_t *bw )
+{
+    bw_write( bw, 1, 1 );
+    while( bw->i_bits )
+        bw_write( bw, 1, 0 );
+}
+
+static void GenerateH264( bw_t *bw )
+{
+    /* SPS: baseline 1920x1088, 4 bits frame_num and POC lsb */
+    bw_nal( bw, 0x67 );
+    bw_write( bw, 8, 66 );
+    bw_write( bw, 8, 0 );
+    bw_write( bw, 8, 40 );
+    bw_ue( bw, 0 );   /* sps id */
+    bw_ue( bw, 0 );   /* log2_max_frame_num_minus4 */
+    bw_ue( bw, 0 );   /* pic_order_cnt_type */
+    bw_ue( bw, 0 );   /* log2_max_pic_order_cnt_lsb_minus4 */
+    bw_ue( bw, 1 );   /* max_num_ref_frames */
+    bw_write( bw, 1, 0 );
+    bw_ue( bw, 119 ); /* pic_width_in_mbs_minus1 */
+    bw_ue( bw, 67 );  /* pic_height_in_map_units_minus1 */
+    bw_write( bw, 1, 1 ); /* frame_mbs_only_flag */
+    bw_write( bw, 1, 1 ); /* direct_8x8_inference_flag */
+    bw_write( bw, 1, 0 ); /* frame_cropping_flag */
+    bw_write( bw, 1, 0 ); /* vui_parameters_present_flag */
+    bw_trailing( bw );
+
+    /* PPS */
+    bw_nal( bw, 0x68 );
+    bw_ue( bw, 0 );
+    bw_ue( bw, 0 );
+    bw_write( bw, 1, 0 ); /* entropy_coding_mode_flag */
+    bw_write( bw, 1, 0 ); /* bottom_field_pic_order_in_frame_present_flag */
+    bw_ue( bw, 0 );       /* num_slice_groups_minus1 */
+    bw_ue( bw, 0 );
+    bw_ue( bw, 0 );
+    bw_write( bw, 1, 0 ); /* weighted_pred_flag */
+    bw_write( bw, 2, 0 ); /* weighted_bipred_idc */
+    bw_ue( bw, 0 );       /* pic_init_qp_minus26 (se 0) */
+    bw_ue( bw, 0 );
+    bw_ue( bw, 0 );
+    bw_write( bw, 1, 1 ); /* deblocking_filter_control_present_flag */
+    bw_write( bw, 1, 0 );
+    bw_write( bw, 1, 0 );
+    bw_trailing( bw );
+
+    unsigned i_seed = 1;
+    for( unsigned i_pic = 0; i_pic < BENCH_PICTURES; i_pic++ )
+    {
+        const bool b_idr = (i_pic % 60) == 0;
+        for( unsigned i_slice = 0; i_slice < BENCH_SLICES; i_slice++ )
+        {
+            bw_nal( bw, b_idr ? 0x65 : 0x41 );
+            bw_ue( bw, i_slice * 8160 / BENCH_SLICES ); /* first_mb_in_slice */
+            bw_ue( bw, b_idr ? 7 : 5 ); /* slice_type */
+            bw_ue( bw, 0 );             /* pps id */
+            bw_write( bw, 4, b_idr ? 0 : (i_pic % 60) & 15 ); /* frame_num */
+            if( b_idr )
+                bw_ue( bw, i_pic & 1 ); /* idr_pic_id */
+            bw_write( bw, 4, ((i_pic % 60) * 2) & 15 ); /* pic_order_cnt_lsb */
+            if( !b_idr )
+            {
+                bw_write( bw, 1, 0 ); /* num_ref_idx_active_override_flag */
+                bw_write( bw, 1, 0 ); /* ref_pic_list_modification_flag_l0 */
+                bw_write( bw, 1, 0 ); /* adaptive_ref_pic_marking_mode_flag */
+            }
+            else
+            {
+                bw_write( bw, 1, 0 ); /* no_output_of_prior_pics_flag */
+                bw_write( bw, 1, 0 ); /* long_term_reference_flag */
+            }
+            /* fake slice data */
+            for( unsigned i = 0; i < BENCH_SLICE_SIZE; i++ )
+            {
+                i_seed = i_seed * 1103515245 + 12345;
+                bw_write( bw, 8, (i_seed >> 16) & 0xFF );
+            }
+            bw_trailing( bw );
+        }
+    }
+}
+
+static int LoadFile( const char *psz_file, bw_t *bw )
+{
+    FILE *f = fopen( psz_file, "rb" );
+    if( !f )
+        return VLC_EGENERIC;
+    fseek( f, 0, SEEK_END );
+    long i_size = ftell( f );
+    fseek( f, 0, SEEK_SET );
+    bw->p = malloc( i_size );
+    assert( bw->p );
+    bw->i_size = fread( bw->p, 1, i_size, f );
+    fclose( f );
+    return VLC_SUCCESS;
+}
+
+static unsigned RunOnce( vlc_object_t *p_obj, vlc_fourcc_t i_codec,
+                         const uint8_t *p_data, size_t i_data, size_t i_block )
+{
+    decoder_t *p_pack = vlc_object_create( p_obj, sizeof(*p_pack) );
+    assert( p_pack );
+    es_format_Init( &p_pack->fmt_in, VIDEO_ES, i_codec );
+    es_format_Init( &p_pack->fmt_out, VIDEO_ES, 0 );
+    p_pack->p_module = module_need( p_pack, "packetizer", NULL, false );
+    assert( p_pack->p_module );
+
+    unsigned i_out = 0;
+    for( size_t i_pos = 0; i_pos < i_data; i_pos += i_block )
+    {
+        size_t i_size = __MIN( i_block, i_data - i_pos );
+        block_t *p_block = block_Alloc( i_size );
+        assert( p_block );
+        memcpy( p_block->p_buffer, &p_data[i_pos], i_size );
+        p_block->i_dts = p_block->i_pts = (i_pos == 0) ? VLC_TS_0 : VLC_TS_INVALID;
+
+        block_t *p_au;
+        while( (p_au = p_pack->pf_packetize( p_pack, &p_block )) )
+        {
+            while( p_au )
+            {
+                block_t *p_next = p_au->p_next;
+                block_Release( p_au );
+                i_out++;
+                p_au = p_next;
+            }
+        }
+    }
+
+    block_t *p_au;
+    while( (p_au = p_pack->pf_packetize( p_pack, NULL )) )
+    {
+        block_ChainRelease( p_au );
+        i_out++;
+    }
+
+    demux_PacketizerDestroy( p_pack );
+    return i_out;
+}
+
+int main( int i_argc, char *ppsz_argv[] )
+{
+    setenv( "VLC_PLUGIN_PATH", "../modules", 1 );
+
+    const char *const args[] = { "--verbose=0" };
+    libvlc_instance_t *p_libvlc = libvlc_new( 1, args );
+    assert( p_libvlc != NULL );
+    vlc_object_t *p_obj = VLC_OBJECT(p_libvlc->p_libvlc_int);
+
+    bw_t bw = { 0 };
+    vlc_fourcc_t i_codec = VLC_CODEC_H264;
+    if( i_argc > 1 && strcmp( ppsz_argv[1], "-" ) )
+    {
+        if( LoadFile( ppsz_argv[1], &bw ) )
+        {
+            fprintf( stderr, "cannot read %s\n", ppsz_argv[1] );
+            libvlc_release( p_libvlc );
+            return 1;
+        }
+        const char *psz_ext = strrchr( ppsz_argv[1], '.' );
+        if( psz_ext && (!strcasecmp( psz_ext, ".hevc" ) ||
+                        !strcasecmp( psz_ext, ".265" ) ||
+                        !strcasecmp( psz_ext, ".h265" )) )
+            i_codec = VLC_CODEC_HEVC;
+    }
+    else GenerateH264( &bw );
+
+    size_t i_block = (i_argc > 2) ? strtoul( ppsz_argv[2], NULL, 10 ) : 0;
+    if( i_block == 0 )
+        i_block = 65536;
+
+    unsigned i_out = 0;
+    mtime_t i_start = mdate();
+    for( unsigned i = 0; i < BENCH_LOOPS; i++ )
+        i_out = RunOnce( p_obj, i_codec, bw.p, bw.i_size, i_block );
+    mtime_t i_elapsed = mdate() - i_start;
+
+    printf( "%4.4s: %zu bytes in %zu bytes blocks, %u access units, "
+            "%.1f MiB/s, %.0f AU/s\n",
+            (const char *) &i_codec, bw.i_size, i_block, i_out,
+            (double) bw.i_size * BENCH_LOOPS * CLOCK_FREQ / i_elapsed / (1 << 20),
+            (double) i_out * BENCH_LOOPS * CLOCK_FREQ / i_elapsed );
+
+    free( bw.p );
+    libvlc_release( p_libvlc );
+    return 0;
+}
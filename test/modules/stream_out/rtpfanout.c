@@ -0,0 +1,205 @@
+/*****************************************************************************
+ * rtpfanout.c: tests the RTP packets fan-out
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_network.h>
+#include <vlc_sout.h>
+#include <vlc_threadpool.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+#include "../modules/stream_out/rtp.h"
+
+#define SINKS   200
+#define PACKETS RTP_BATCH_MAX
+#define PKT_LEN 172
+
+static int OpenLoopback( int *rfd )
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl( INADDR_LOOPBACK ),
+    };
+    socklen_t addrlen = sizeof (addr);
+
+    *rfd = socket( AF_INET, SOCK_DGRAM, 0 );
+    assert( *rfd != -1 );
+    assert( bind( *rfd, (struct sockaddr *)&addr, addrlen ) == 0 );
+    assert( getsockname( *rfd, (struct sockaddr *)&addr, &addrlen ) == 0 );
+
+    int fd = socket( AF_INET, SOCK_DGRAM, 0 );
+    assert( fd != -1 );
+    assert( connect( fd, (struct sockaddr *)&addr, addrlen ) == 0 );
+    return fd;
+}
+
+static void test_fanout( vlc_threadpool_t *pool, unsigned i_sinks )
+{
+    int fdv[i_sinks], rfdv[i_sinks];
+    bool deadv[i_sinks];
+    block_t *pktv[PACKETS];
+
+    log( "Testing fan-out to %u sinks %s thread pool\n", i_sinks,
+         pool != NULL ? "with" : "without" );
+
+    for( unsigned i = 0; i < i_sinks; i++ )
+        fdv[i] = OpenLoopback( &rfdv[i] );
+
+    for( unsigned i = 0; i < PACKETS; i++ )
+    {
+        pktv[i] = block_Alloc( PKT_LEN );
+        assert( pktv[i] != NULL );
+        memset( pktv[i]->p_buffer, i, PKT_LEN );
+        SetWBE( pktv[i]->p_buffer + 2, i ); /* sequence number */
+    }
+
+    rtp_fanout_send( pool, fdv, i_sinks, pktv, PACKETS, deadv );
+
+    /* Every sink gets every packet, in order */
+    for( unsigned i = 0; i < i_sinks; i++ )
+    {
+        assert( !deadv[i] );
+        for( unsigned j = 0; j < PACKETS; j++ )
+        {
+            uint8_t buf[PKT_LEN + 1];
+
+            ssize_t val = recv( rfdv[i], buf, sizeof (buf), MSG_DONTWAIT );
+            assert( val == PKT_LEN );
+            assert( memcmp( buf, pktv[j]->p_buffer, PKT_LEN ) == 0 );
+        }
+        assert( recv( rfdv[i], &(char){ 0 }, 1, MSG_DONTWAIT ) == -1 );
+        net_Close( fdv[i] );
+        net_Close( rfdv[i] );
+    }
+
+    for( unsigned i = 0; i < PACKETS; i++ )
+        block_Release( pktv[i] );
+}
+
+static void test_dead( vlc_threadpool_t *pool )
+{
+    int fdv[3], pair[2], rfd;
+    bool deadv[3];
+    block_t *pkt = block_Alloc( PKT_LEN );
+
+    log( "Testing broken sinks\n" );
+    assert( pkt != NULL );
+    memset( pkt->p_buffer, 0, PKT_LEN );
+
+    /* Closed stream connection: dead */
+    assert( socketpair( AF_UNIX, SOCK_STREAM, 0, pair ) == 0 );
+    close( pair[1] );
+    fdv[0] = pair[0];
+
+    /* Datagram without receiver (ICMP soft error): not dead */
+    fdv[1] = OpenLoopback( &rfd );
+    net_Close( rfd );
+
+    /* Working sink */
+    fdv[2] = OpenLoopback( &rfd );
+
+    rtp_fanout_send( pool, fdv, 3, &pkt, 1, deadv );
+    assert( deadv[0] && !deadv[1] && !deadv[2] );
+    assert( recv( rfd, &(char){ 0 }, 1, MSG_DONTWAIT ) == 1 );
+
+    for( unsigned i = 0; i < 3; i++ )
+        net_Close( fdv[i] );
+    net_Close( rfd );
+    block_Release( pkt );
+}
+
+static void test_full( vlc_threadpool_t *pool )
+{
+    int fdv[2], pair[2], rfd;
+    bool deadv[2];
+    block_t *pktv[PACKETS];
+
+    log( "Testing full stream sink\n" );
+
+    /* Stream connection whose receiver does not read: never waited for */
+    assert( socketpair( AF_UNIX, SOCK_STREAM, 0, pair ) == 0 );
+    while( send( pair[0], "", 1, MSG_DONTWAIT ) == 1 );
+    assert( errno == EAGAIN || errno == EWOULDBLOCK );
+    fdv[0] = pair[0];
+
+    fdv[1] = OpenLoopback( &rfd );
+
+    for( unsigned i = 0; i < PACKETS; i++ )
+    {
+        pktv[i] = block_Alloc( PKT_LEN );
+        assert( pktv[i] != NULL );
+        memset( pktv[i]->p_buffer, i, PKT_LEN );
+    }
+
+    /* The packets are dropped, the connection is kept */
+    rtp_fanout_send( pool, fdv, 2, pktv, PACKETS, deadv );
+    assert( !deadv[0] && !deadv[1] );
+    for( unsigned i = 0; i < PACKETS; i++ )
+    {
+        uint8_t buf[PKT_LEN + 1];
+
+        assert( recv( rfd, buf, sizeof (buf), MSG_DONTWAIT ) == PKT_LEN );
+        block_Release( pktv[i] );
+    }
+
+    net_Close( fdv[0] );
+    net_Close( pair[1] );
+    net_Close( fdv[1] );
+    net_Close( rfd );
+}
+
+int main( void )
+{
+    test_init();
+    signal( SIGPIPE, SIG_IGN );
+
+    const char *args[] = { "--threadpool-threads=4" };
+    libvlc_instance_t *p_vlc = libvlc_new( 1, args );
+    assert( p_vlc != NULL );
+    vlc_threadpool_t *pool = vlc_threadpool_Get( p_vlc->p_libvlc_int );
+    assert( pool != NULL );
+
+    test_fanout( NULL, 1 );
+    test_fanout( NULL, SINKS );
+    test_fanout( pool, 1 );
+    test_fanout( pool, 33 );
+    test_fanout( pool, SINKS );
+    test_dead( NULL );
+    test_dead( pool );
+    test_full( NULL );
+    test_full( pool );
+
+    libvlc_release( p_vlc );
+    return 0;
+}
@@ -0,0 +1,346 @@
+/*****************************************************************************
+ * segments.c: tests the segmented video encoding reassembly
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#define MODULE_NAME test_reorder
+#define MODULE_STRING "test_reorder"
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_atomic.h>
+#include "../modules/stream_out/transcode/transcode.h"
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#define FRAMES       50
+#define LENGTH       8
+#define WORKERS      3
+#define DURATION     40000
+#define MAX_PICTURES 1024 /* SEGMENT_MAX_PICTURES */
+
+/*
+ * Fake encoder, coding I P B B... with its own decoding timestamps, which
+ * restart with each instance, as those of a real encoder would.
+ */
+struct encoder_sys_t
+{
+    mtime_t  pts[2];  /* B-frames waiting for their reference */
+    unsigned i_pending;
+    unsigned i_frames;
+    mtime_t  i_dts;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    bool        b_stalled;
+} encoders = { VLC_STATIC_MUTEX, VLC_STATIC_COND, false };
+
+static void Stall( bool b_stalled )
+{
+    vlc_mutex_lock( &encoders.lock );
+    encoders.b_stalled = b_stalled;
+    vlc_cond_broadcast( &encoders.wait );
+    vlc_mutex_unlock( &encoders.lock );
+}
+
+static block_t *Packet( encoder_t *p_enc, mtime_t i_pts, bool b_key )
+{
+    block_t *p_block = block_Alloc( 1 );
+    assert( p_block != NULL );
+    p_block->p_buffer[0] = b_key;
+    p_block->i_pts = i_pts;
+    p_block->i_dts = p_enc->p_sys->i_dts++;
+    if( b_key )
+        p_block->i_flags |= BLOCK_FLAG_TYPE_I;
+    return p_block;
+}
+
+static block_t *Encode( encoder_t *p_enc, picture_t *p_pic )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    block_t *p_out = NULL, **pp_out = &p_out;
+
+    vlc_mutex_lock( &encoders.lock );
+    while( encoders.b_stalled )
+        vlc_cond_wait( &encoders.wait, &encoders.lock );
+    vlc_mutex_unlock( &encoders.lock );
+
+    if( p_pic == NULL )
+    {
+        /* The last B-frame becomes the reference of the others */
+        if( p_sys->i_pending > 0 )
+        {
+            block_ChainLastAppend( &pp_out, Packet( p_enc,
+                                   p_sys->pts[--p_sys->i_pending], false ) );
+            for( unsigned i = 0; i < p_sys->i_pending; i++ )
+                block_ChainLastAppend( &pp_out,
+                                       Packet( p_enc, p_sys->pts[i], false ) );
+            p_sys->i_pending = 0;
+        }
+        return p_out;
+    }
+
+    if( p_sys->i_frames++ == 0 )
+        return Packet( p_enc, p_pic->date, true );
+    if( p_sys->i_pending < 2 )
+    {
+        p_sys->pts[p_sys->i_pending++] = p_pic->date;
+        return NULL;
+    }
+
+    block_ChainLastAppend( &pp_out, Packet( p_enc, p_pic->date, false ) );
+    for( unsigned i = 0; i < 2; i++ )
+        block_ChainLastAppend( &pp_out, Packet( p_enc, p_sys->pts[i], false ) );
+    p_sys->i_pending = 0;
+    return p_out;
+}
+
+static int OpenEncoder( vlc_object_t *obj )
+{
+    encoder_t *p_enc = (encoder_t *) obj;
+
+    p_enc->p_sys = calloc( 1, sizeof( *p_enc->p_sys ) );
+    if( p_enc->p_sys == NULL )
+        return VLC_ENOMEM;
+    p_enc->p_sys->i_dts = VLC_TS_0;
+    p_enc->pf_encode_video = Encode;
+    return VLC_SUCCESS;
+}
+
+static void CloseEncoder( vlc_object_t *obj )
+{
+    encoder_t *p_enc = (encoder_t *) obj;
+
+    free( p_enc->p_sys );
+}
+
+vlc_module_begin()
+    set_capability( "encoder", 0 )
+    set_callbacks( OpenEncoder, CloseEncoder )
+vlc_module_end()
+
+typedef int (*vlc_plugin_cb)(int (*)(void *, void *, int, ...), void *);
+
+__attribute__((visibility("default")))
+vlc_plugin_cb vlc_static_modules[] = { vlc_entry__test_reorder, NULL };
+
+/* Decoded pictures, sharing the same (black) planes */
+static uint8_t pixels[16 * 16 * 3 / 2];
+static atomic_uint i_pictures;
+
+static void PictureDestroy( picture_t *p_pic )
+{
+    atomic_fetch_sub( &i_pictures, 1 );
+    free( p_pic );
+}
+
+static picture_t *PictureNew( const video_format_t *p_fmt, unsigned i_frame )
+{
+    picture_resource_t res = {
+        .pf_destroy = PictureDestroy,
+        .p = {
+            { .p_pixels = pixels, .i_lines = 16, .i_pitch = 16 },
+            { .p_pixels = pixels + 256, .i_lines = 8, .i_pitch = 8 },
+            { .p_pixels = pixels + 320, .i_lines = 8, .i_pitch = 8 },
+        },
+    };
+    picture_t *p_pic = picture_NewFromResource( p_fmt, &res );
+    assert( p_pic != NULL );
+    atomic_fetch_add( &i_pictures, 1 );
+    p_pic->date = VLC_TS_0 + i_frame * DURATION;
+    return p_pic;
+}
+
+struct test_ctx_t
+{
+    sout_stream_t      *p_stream;
+    sout_stream_sys_t   sys;
+    encoder_t           enc; /* template */
+    transcode_segments_t *p_segs;
+};
+
+static void Create( vlc_object_t *obj, struct test_ctx_t *ctx,
+                    unsigned i_workers, unsigned i_length )
+{
+    memset( ctx, 0, sizeof( *ctx ) );
+    ctx->p_stream = vlc_object_create( obj, sizeof( *ctx->p_stream ) );
+    assert( ctx->p_stream != NULL );
+    ctx->sys.psz_venc = (char *) "test_reorder";
+    ctx->p_stream->p_sys = &ctx->sys;
+
+    es_format_Init( &ctx->enc.fmt_in, VIDEO_ES, VLC_CODEC_I420 );
+    video_format_Setup( &ctx->enc.fmt_in.video, VLC_CODEC_I420,
+                        16, 16, 16, 16, 1, 1 );
+    es_format_Init( &ctx->enc.fmt_out, VIDEO_ES, VLC_CODEC_H264 );
+
+    ctx->p_segs = transcode_segments_new( ctx->p_stream, &ctx->enc,
+                                          i_workers, i_length );
+    assert( ctx->p_segs != NULL );
+}
+
+static void Delete( struct test_ctx_t *ctx )
+{
+    transcode_segments_delete( ctx->p_segs );
+    es_format_Clean( &ctx->enc.fmt_in );
+    es_format_Clean( &ctx->enc.fmt_out );
+    vlc_object_release( ctx->p_stream );
+}
+
+struct test_out_t
+{
+    unsigned i_blocks;
+    mtime_t  i_last_dts;
+    bool     seen[FRAMES];
+};
+
+static void Check( struct test_out_t *out, block_t *p_chain )
+{
+    for( block_t *p_block = p_chain; p_block != NULL; p_block = p_block->p_next )
+    {
+        unsigned i_frame = ( p_block->i_pts - VLC_TS_0 ) / DURATION;
+
+        /* Timestamps of the frame as pushed */
+        assert( p_block->i_pts == VLC_TS_0 + i_frame * DURATION );
+        assert( i_frame < FRAMES && !out->seen[i_frame] );
+        out->seen[i_frame] = true;
+        /* Segments are output in order */
+        assert( i_frame / LENGTH == out->i_blocks / LENGTH );
+        /* Shifted by the constant reordering delay of a frame */
+        assert( p_block->i_dts == VLC_TS_0 + ( (mtime_t) out->i_blocks - 1 )
+                                             * DURATION );
+        assert( p_block->i_dts <= p_block->i_pts );
+        assert( p_block->i_dts > out->i_last_dts );
+        out->i_last_dts = p_block->i_dts;
+        /* Each segment starts with a key frame */
+        assert( !!p_block->p_buffer[0] == ( out->i_blocks % LENGTH == 0 ) );
+        out->i_blocks++;
+    }
+    block_ChainRelease( p_chain );
+}
+
+static void test_reassembly( vlc_object_t *obj )
+{
+    struct test_ctx_t ctx;
+    struct test_out_t out = { .i_last_dts = INT64_MIN };
+
+    log( "Testing segments reassembly\n" );
+
+    Create( obj, &ctx, WORKERS, LENGTH );
+    for( unsigned i = 0; i < FRAMES; i++ )
+    {
+        transcode_segments_push( ctx.p_segs, &ctx.enc,
+                                 PictureNew( &ctx.enc.fmt_in.video, i ) );
+        Check( &out, transcode_segments_pull( ctx.p_segs ) );
+    }
+    Check( &out, transcode_segments_drain( ctx.p_segs ) );
+    Delete( &ctx );
+
+    assert( out.i_blocks == FRAMES );
+    assert( atomic_load( &i_pictures ) == 0 );
+}
+
+struct test_push_t
+{
+    struct test_ctx_t ctx;
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    i_pushed;
+};
+
+static void *Push( void *data )
+{
+    struct test_push_t *p = data;
+
+    for( unsigned i = 0; i < 3 * MAX_PICTURES; i++ )
+    {
+        /* The previous picture may be held for scene cuts */
+        assert( atomic_load( &i_pictures ) <= MAX_PICTURES + 1 );
+        transcode_segments_push( p->ctx.p_segs, &p->ctx.enc,
+                                 PictureNew( &p->ctx.enc.fmt_in.video, i ) );
+        block_ChainRelease( transcode_segments_pull( p->ctx.p_segs ) );
+
+        vlc_mutex_lock( &p->lock );
+        p->i_pushed = i + 1;
+        vlc_cond_signal( &p->wait );
+        vlc_mutex_unlock( &p->lock );
+    }
+    return NULL;
+}
+
+static void test_bound( vlc_object_t *obj )
+{
+    struct test_push_t p;
+    vlc_thread_t th;
+
+    log( "Testing buffered pictures bound\n" );
+
+    /* Segments too long to fit, none of which gets encoded */
+    Stall( true );
+    Create( obj, &p.ctx, 4, 100000 );
+    vlc_mutex_init( &p.lock );
+    vlc_cond_init( &p.wait );
+    p.i_pushed = 0;
+    assert( vlc_clone( &th, Push, &p, VLC_THREAD_PRIORITY_LOW ) == 0 );
+
+    /* Blocks once all the instances hold a full segment */
+    vlc_mutex_lock( &p.lock );
+    while( p.i_pushed < MAX_PICTURES )
+        vlc_cond_wait( &p.wait, &p.lock );
+    vlc_mutex_unlock( &p.lock );
+    mwait( mdate() + CLOCK_FREQ / 10 );
+    vlc_mutex_lock( &p.lock );
+    assert( p.i_pushed == MAX_PICTURES );
+    vlc_mutex_unlock( &p.lock );
+
+    Stall( false );
+    vlc_join( th, NULL );
+    block_ChainRelease( transcode_segments_drain( p.ctx.p_segs ) );
+    Delete( &p.ctx );
+    vlc_cond_destroy( &p.wait );
+    vlc_mutex_destroy( &p.lock );
+    assert( atomic_load( &i_pictures ) == 0 );
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *p_vlc = libvlc_new( 0, NULL );
+    assert( p_vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT( p_vlc->p_libvlc_int );
+
+    test_reassembly( obj );
+    test_bound( obj );
+
+    libvlc_release( p_vlc );
+    return 0;
+}
@@ -0,0 +1,413 @@
+/*****************************************************************************
+ * deinterlace.c: tests the deinterlacer line kernels and slices
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The benchmarks are not run by "make check":
+ * $ make test_modules_video_filter_deinterlace_bench
+ * $ ./test_modules_video_filter_deinterlace_bench
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+#include <vlc_threadpool.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+#include "../modules/video_filter/deinterlace/deinterlace.h"
+#include "../modules/video_filter/deinterlace/helpers.h"
+#include "../modules/video_filter/deinterlace/merge.h"
+#include "../modules/video_filter/deinterlace/yadif.h"
+
+#define POOL_THREADS 4
+
+static vlc_threadpool_t *p_pool;
+#define LINE_PITCH   2048
+#define BENCH_LINES  1080
+#define BENCH_LOOPS  20
+
+typedef void (*yadif_line_t)( uint8_t *, uint8_t *, uint8_t *, uint8_t *,
+                              int, int, int, int, int );
+
+static const struct
+{
+    const char *psz_name;
+    yadif_line_t pf_filter;
+    unsigned i_cpu; /* required CPU flags */
+} impls[] = {
+    { "C",     yadif_filter_line_c, 0 },
+#ifdef HAVE_YADIF_MMX
+    { "MMX",   yadif_filter_line_mmx, VLC_CPU_MMX },
+#endif
+#ifdef HAVE_YADIF_SSE2
+    { "SSE2",  yadif_filter_line_sse2, VLC_CPU_SSE2 },
+#endif
+#ifdef HAVE_YADIF_SSSE3
+    { "SSSE3", yadif_filter_line_ssse3, VLC_CPU_SSSE3 },
+#endif
+#ifdef HAVE_YADIF_AVX2
+    { "AVX2",  yadif_filter_line_avx2, VLC_CPU_AVX2 },
+#endif
+};
+
+static bool Available( size_t i )
+{
+    return (vlc_CPU() & impls[i].i_cpu) == impls[i].i_cpu;
+}
+
+static void Randomize( uint8_t *p, size_t i_size, unsigned i_range )
+{
+    /* a smooth base with noise, so that all the yadif branches are taken */
+    uint8_t base = rand();
+    for( size_t i = 0; i < i_size; i++ )
+    {
+        if( rand() % 64 == 0 )
+            base = rand();
+        p[i] = base + rand() % i_range;
+    }
+}
+
+/* Five lines per picture, the filtered line being the middle one */
+static void test_lines( void )
+{
+    uint8_t *p_buf[4], *p_ref = malloc( LINE_PITCH );
+    assert( p_ref );
+    for( int i = 0; i < 4; i++ )
+    {
+        p_buf[i] = malloc( 5 * LINE_PITCH );
+        assert( p_buf[i] );
+    }
+    uint8_t *dst = &p_buf[0][2 * LINE_PITCH];
+    uint8_t *prev = &p_buf[1][2 * LINE_PITCH];
+    uint8_t *cur = &p_buf[2][2 * LINE_PITCH];
+    uint8_t *next = &p_buf[3][2 * LINE_PITCH];
+
+    for( unsigned i_run = 0; i_run < 200; i_run++ )
+    {
+        const unsigned i_range = i_run % 2 ? 256 : 16;
+        for( int i = 1; i < 4; i++ )
+            Randomize( p_buf[i], 5 * LINE_PITCH, i_range );
+
+        /* all the widths around the vector sizes, and an HD line */
+        const int w = i_run < 100 ? 1 + (int)i_run : 1920 - (int)i_run % 7;
+        const int parity = i_run & 1;
+        const int mode = i_run & 2 ? 2 : 0;
+
+        yadif_filter_line_c( p_ref, prev, cur, next, w,
+                             LINE_PITCH, -LINE_PITCH, parity, mode );
+
+        for( size_t i = 1; i < ARRAY_SIZE(impls); i++ )
+        {
+            if( !Available( i ) )
+                continue;
+            memset( dst, 0, w );
+            impls[i].pf_filter( dst, prev, cur, next, w,
+                                LINE_PITCH, -LINE_PITCH, parity, mode );
+#if defined(__i386__) || defined(__x86_64__)
+            if( impls[i].i_cpu == VLC_CPU_MMX )
+                __asm__ __volatile__ ( "emms" );
+#endif
+            if( memcmp( dst, p_ref, w ) )
+            {
+                fprintf( stderr, "%s mismatch (width %d, parity %d, "
+                         "mode %d)\n", impls[i].psz_name, w, parity, mode );
+                abort();
+            }
+        }
+    }
+
+    for( int i = 0; i < 4; i++ )
+        free( p_buf[i] );
+    free( p_ref );
+}
+
+#ifdef DEINTERLACE_BENCH
+static void bench_lines( void )
+{
+    uint8_t *p_buf[4];
+    for( int i = 0; i < 4; i++ )
+    {
+        p_buf[i] = malloc( (BENCH_LINES + 4) * LINE_PITCH );
+        assert( p_buf[i] );
+        Randomize( p_buf[i], (BENCH_LINES + 4) * LINE_PITCH, 256 );
+    }
+
+    for( size_t i = 0; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !Available( i ) )
+            continue;
+
+        mtime_t i_start = mdate();
+        for( unsigned j = 0; j < BENCH_LOOPS; j++ )
+            for( int y = 2; y < BENCH_LINES + 2; y++ )
+                impls[i].pf_filter( &p_buf[0][y * LINE_PITCH],
+                                    &p_buf[1][y * LINE_PITCH],
+                                    &p_buf[2][y * LINE_PITCH],
+                                    &p_buf[3][y * LINE_PITCH], 1920,
+                                    LINE_PITCH, -LINE_PITCH, j & 1, 0 );
+#if defined(__i386__) || defined(__x86_64__)
+        if( impls[i].i_cpu == VLC_CPU_MMX )
+            __asm__ __volatile__ ( "emms" );
+#endif
+        mtime_t i_elapsed = __MAX( mdate() - i_start, 1 );
+        printf( "yadif %-6s %7.1f MiB/s\n", impls[i].psz_name,
+                (double) 1920 * BENCH_LINES * BENCH_LOOPS * CLOCK_FREQ
+                / i_elapsed / (1 << 20) );
+    }
+
+    for( int i = 0; i < 4; i++ )
+        free( p_buf[i] );
+}
+#endif
+
+/*****************************************************************************
+ * Whole pictures, serial and in slices
+ *****************************************************************************/
+
+static filter_t *CreateFilter( unsigned i_slices )
+{
+    filter_t *p_filter = calloc( 1, sizeof( *p_filter ) );
+    filter_sys_t *p_sys = calloc( 1, sizeof( *p_sys ) );
+    assert( p_filter && p_sys );
+
+    p_filter->p_sys = p_sys;
+    p_sys->chroma = vlc_fourcc_GetChromaDescription( VLC_CODEC_I420 );
+    p_sys->pf_merge = Merge8BitGeneric;
+    p_sys->i_slices = i_slices;
+    p_sys->p_pool = i_slices > 1 ? p_pool : NULL;
+    return p_filter;
+}
+
+static void DeleteFilter( filter_t *p_filter )
+{
+    free( p_filter->p_sys );
+    free( p_filter );
+}
+
+static picture_t *NewPicture( unsigned i_width, unsigned i_height, bool b_random )
+{
+    video_format_t fmt;
+    video_format_Setup( &fmt, VLC_CODEC_I420, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    assert( p_pic );
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        if( b_random )
+            Randomize( p->p_pixels, p->i_pitch * p->i_lines, 256 );
+        else
+            memset( p->p_pixels, 0, p->i_pitch * p->i_lines );
+    }
+    p_pic->i_nb_fields = 2;
+    return p_pic;
+}
+
+static void CheckSame( const picture_t *p_a, const picture_t *p_b,
+                       const char *psz_algo, unsigned i_slices )
+{
+    for( int i = 0; i < p_a->i_planes; i++ )
+    {
+        const plane_t *a = &p_a->p[i], *b = &p_b->p[i];
+        for( int y = 0; y < a->i_visible_lines; y++ )
+        {
+            if( memcmp( &a->p_pixels[y * a->i_pitch], &b->p_pixels[y * b->i_pitch],
+                        a->i_visible_pitch ) )
+            {
+                fprintf( stderr, "%s differs in %u slices (plane %d, line %d)\n",
+                         psz_algo, i_slices, i, y );
+                abort();
+            }
+        }
+    }
+}
+
+/* Yadif parities 1, 0, 2 (soft field repeat bypass), and 1 again */
+static const struct
+{
+    int i_order;
+    int i_field;
+    int i_nb_fields;
+} passes[] = {
+    { 0, 0, 2 }, { 1, 1, 2 }, { 1, 0, 3 }, { 0, 1, 2 },
+};
+
+static void Render( filter_t *p_filter, picture_t *p_dst, picture_t **pp_hist,
+                    int i_algo, size_t i_pass )
+{
+    const int i_field = passes[i_pass].i_field;
+
+    for( int i = 0; i < HISTORY_SIZE; i++ )
+        p_filter->p_sys->context.pp_history[i] = pp_hist[i];
+    pp_hist[1]->i_nb_fields = passes[i_pass].i_nb_fields;
+
+    switch( i_algo )
+    {
+        case 0:
+            assert( RenderYadif( p_filter, p_dst, pp_hist[2],
+                                 passes[i_pass].i_order, i_field )
+                    == VLC_SUCCESS );
+            break;
+        case 1:
+            assert( RenderLinear( p_filter, p_dst, pp_hist[2], 0, i_field )
+                    == VLC_SUCCESS );
+            break;
+        case 2:
+            assert( RenderX( p_filter, p_dst, pp_hist[2] ) == VLC_SUCCESS );
+            break;
+    }
+}
+
+static void test_pictures( unsigned i_width, unsigned i_height )
+{
+    static const char *const ppsz_algos[] = { "yadif", "linear", "x" };
+    static const unsigned pi_slices[] = { 2, 3, 7, 16 };
+    picture_t *pp_hist[HISTORY_SIZE];
+
+    for( int i = 0; i < HISTORY_SIZE; i++ )
+        pp_hist[i] = NewPicture( i_width, i_height, true );
+    picture_t *p_ref = NewPicture( i_width, i_height, false );
+    picture_t *p_dst = NewPicture( i_width, i_height, false );
+
+    filter_t *p_serial = CreateFilter( 1 );
+
+    for( int i_algo = 0; i_algo < 3; i_algo++ )
+    {
+        for( size_t i_pass = 0; i_pass < ARRAY_SIZE(passes); i_pass++ )
+        {
+            Render( p_serial, p_ref, pp_hist, i_algo, i_pass );
+
+            for( size_t i = 0; i < ARRAY_SIZE(pi_slices); i++ )
+            {
+                filter_t *p_filter = CreateFilter( pi_slices[i] );
+                Render( p_filter, p_dst, pp_hist, i_algo, i_pass );
+                CheckSame( p_ref, p_dst, ppsz_algos[i_algo], pi_slices[i] );
+                DeleteFilter( p_filter );
+            }
+        }
+    }
+
+    /* IVTC detectors: the slices add up to the whole picture */
+    pp_hist[1]->i_nb_fields = 2;
+    const picture_t *p_curr = pp_hist[1], *p_next = pp_hist[2];
+    const int i_score = CalculateInterlaceScore( p_next, p_curr );
+    int i_top, i_bot;
+    const int i_motion = EstimateNumBlocksWithMotion( p_curr, p_next,
+                                                      &i_top, &i_bot );
+    assert( i_score > 0 && i_motion > 0 );
+    for( size_t i = 0; i < ARRAY_SIZE(pi_slices); i++ )
+    {
+        int i_sum_score = 0, i_sum_motion = 0, i_sum_top = 0, i_sum_bot = 0;
+        for( unsigned j = 0; j < pi_slices[i]; j++ )
+        {
+            int i_slice_top, i_slice_bot;
+            i_sum_score += CalculateInterlaceScoreSlice( p_next, p_curr,
+                                                         j, pi_slices[i] );
+            i_sum_motion += EstimateNumBlocksWithMotionSlice( p_curr, p_next,
+                                                              &i_slice_top,
+                                                              &i_slice_bot,
+                                                              j, pi_slices[i] );
+            i_sum_top += i_slice_top;
+            i_sum_bot += i_slice_bot;
+        }
+        assert( i_sum_score == i_score );
+        assert( i_sum_motion == i_motion );
+        assert( i_sum_top == i_top && i_sum_bot == i_bot );
+    }
+
+    DeleteFilter( p_serial );
+    picture_Release( p_dst );
+    picture_Release( p_ref );
+    for( int i = 0; i < HISTORY_SIZE; i++ )
+        picture_Release( pp_hist[i] );
+}
+
+#ifdef DEINTERLACE_BENCH
+static void bench_pictures( void )
+{
+    picture_t *pp_hist[HISTORY_SIZE];
+
+    for( int i = 0; i < HISTORY_SIZE; i++ )
+        pp_hist[i] = NewPicture( 1920, 1080, true );
+    picture_t *p_dst = NewPicture( 1920, 1080, false );
+
+    for( unsigned i_slices = 1; i_slices <= POOL_THREADS; i_slices *= 2 )
+    {
+        filter_t *p_filter = CreateFilter( i_slices );
+
+        mtime_t i_start = mdate();
+        for( unsigned j = 0; j < BENCH_LOOPS; j++ )
+            Render( p_filter, p_dst, pp_hist, 0, j & 1 );
+        mtime_t i_elapsed = __MAX( mdate() - i_start, 1 );
+        printf( "yadif 1080p %u slice(s): %6.1f fps\n", i_slices,
+                (double) BENCH_LOOPS * CLOCK_FREQ / i_elapsed );
+
+        DeleteFilter( p_filter );
+    }
+
+    picture_Release( p_dst );
+    for( int i = 0; i < HISTORY_SIZE; i++ )
+        picture_Release( pp_hist[i] );
+}
+#endif
+
+int main( void )
+{
+    VLC_UNUSED(yadif_filter_line_c_16bit);
+    srand( 42 );
+
+#ifdef DEINTERLACE_BENCH
+    setenv( "VLC_PLUGIN_PATH", "../modules", 1 );
+#else
+    test_init();
+#endif
+
+    const char *args[] = { "--threadpool-threads=4" /* POOL_THREADS */ };
+    libvlc_instance_t *p_vlc = libvlc_new( 1, args );
+    assert( p_vlc != NULL );
+    p_pool = vlc_threadpool_Get( p_vlc->p_libvlc_int );
+    assert( p_pool != NULL );
+    assert( vlc_threadpool_GetSize( p_pool ) == POOL_THREADS );
+
+    test_lines();
+    test_pictures( 1920, 1080 );
+    test_pictures( 720, 576 );
+    test_pictures( 66, 38 );
+
+#ifdef DEINTERLACE_BENCH
+    bench_lines();
+    bench_pictures();
+#endif
+
+    libvlc_release( p_vlc );
+    return 0;
+}
@@ -96,7 +96,7 @@ static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
 {
     //debug("[%p] Sent    ES: %zu\n", (void *)idd, block->i_buffer);
     EsOutCheckId(out, id);
-    block_Release(block);
+    block_ChainRelease(block);
     return VLC_SUCCESS;
 }
 
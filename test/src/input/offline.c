@@ -0,0 +1,244 @@
+/*****************************************************************************
+ * offline.c: tests the offline stream output of the input
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#define MODULE_NAME test_offline
+#define MODULE_STRING "test_offline"
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_demux.h>
+#include <vlc_sout.h>
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+#define FRAMES   200
+#define LENGTH   40000   /* 25 fps, 8 s of real time */
+#define START    (VLC_TS_0 + INT64_C(1000) * CLOCK_FREQ)
+#define JUMP     (INT64_C(500) * CLOCK_FREQ)   /* back, after half */
+
+/* Date of the frames received by the stream output */
+static struct
+{
+    mtime_t  p_dts[FRAMES];
+    unsigned i_frames;
+} out;
+
+/*
+ * Demux: one video frame per call, the timestamps jumping back after half
+ */
+struct demux_sys_t
+{
+    es_out_id_t *p_es;
+    unsigned     i_frame;
+};
+
+static int Demux( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->i_frame >= FRAMES )
+        return VLC_DEMUXER_EOF;
+
+    mtime_t i_dts = START + p_sys->i_frame * LENGTH;
+    if( p_sys->i_frame >= FRAMES / 2 )
+        i_dts -= JUMP;
+
+    block_t *p_block = block_Alloc( 1000 );
+    if( p_block == NULL )
+        return VLC_DEMUXER_EOF;
+    memset( p_block->p_buffer, p_sys->i_frame, p_block->i_buffer );
+    p_block->i_dts = p_block->i_pts = i_dts;
+    p_block->i_length = LENGTH;
+
+    es_out_SetPCR( p_demux->out, i_dts );
+    es_out_Send( p_demux->out, p_sys->p_es, p_block );
+    p_sys->i_frame++;
+    return VLC_DEMUXER_SUCCESS;
+}
+
+static int Control( demux_t *p_demux, int i_query, va_list args )
+{
+    VLC_UNUSED(p_demux);
+    switch( i_query )
+    {
+        case DEMUX_CAN_CONTROL_PACE:
+        case DEMUX_CAN_PAUSE:
+            *va_arg( args, bool * ) = true;
+            return VLC_SUCCESS;
+        case DEMUX_CAN_SEEK:
+            *va_arg( args, bool * ) = false;
+            return VLC_SUCCESS;
+        case DEMUX_GET_PTS_DELAY:
+            *va_arg( args, int64_t * ) = DEFAULT_PTS_DELAY;
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static int OpenDemux( vlc_object_t *p_this )
+{
+    demux_t *p_demux = (demux_t *)p_this;
+    demux_sys_t *p_sys = calloc( 1, sizeof(*p_sys) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    es_format_t fmt;
+    es_format_Init( &fmt, VIDEO_ES, VLC_FOURCC('t','o','f','l') );
+    fmt.video.i_width = fmt.video.i_visible_width = 320;
+    fmt.video.i_height = fmt.video.i_visible_height = 240;
+    p_sys->p_es = es_out_Add( p_demux->out, &fmt );
+    assert( p_sys->p_es != NULL );
+
+    p_demux->p_sys = p_sys;
+    p_demux->pf_demux = Demux;
+    p_demux->pf_control = Control;
+    return VLC_SUCCESS;
+}
+
+static void CloseDemux( vlc_object_t *p_this )
+{
+    demux_t *p_demux = (demux_t *)p_this;
+
+    free( p_demux->p_sys );
+}
+
+/*
+ * Stream output: records the dates of the frames
+ */
+static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
+                                  const es_format_t *p_fmt )
+{
+    VLC_UNUSED(p_stream);
+    assert( p_fmt->i_cat == VIDEO_ES );
+    return (sout_stream_id_sys_t *)&out;
+}
+
+static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    VLC_UNUSED(p_stream); VLC_UNUSED(id);
+}
+
+static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                 block_t *p_block )
+{
+    VLC_UNUSED(p_stream); VLC_UNUSED(id);
+    while( p_block != NULL )
+    {
+        block_t *p_next = p_block->p_next;
+
+        assert( out.i_frames < FRAMES );
+        out.p_dts[out.i_frames++] = p_block->i_dts;
+        block_Release( p_block );
+        p_block = p_next;
+    }
+    return VLC_SUCCESS;
+}
+
+static int OpenStream( vlc_object_t *p_this )
+{
+    sout_stream_t *p_stream = (sout_stream_t *)p_this;
+
+    p_stream->pf_add = Add;
+    p_stream->pf_del = Del;
+    p_stream->pf_send = Send;
+    return VLC_SUCCESS;
+}
+
+vlc_module_begin()
+    set_capability( "demux", 0 )
+    set_callbacks( OpenDemux, CloseDemux )
+    add_submodule()
+    add_shortcut( "test_offline_out" )
+    set_capability( "sout stream", 0 )
+    set_callbacks( OpenStream, NULL )
+vlc_module_end()
+
+typedef int (*vlc_plugin_cb)(int (*)(void *, void *, int, ...), void *);
+
+__attribute__((visibility("default")))
+vlc_plugin_cb vlc_static_modules[] = { vlc_entry__test_offline, NULL };
+
+int main( void )
+{
+    char psz_path[] = "/tmp/vlc-offline-XXXXXX";
+
+    test_init();
+
+    /* the demux does not read anything */
+    int fd = mkstemp( psz_path );
+    assert( fd != -1 );
+    assert( write( fd, "offline", 7 ) == 7 );
+    close( fd );
+
+    libvlc_instance_t *p_vlc = libvlc_new( 0, NULL );
+    assert( p_vlc != NULL );
+
+    libvlc_media_t *p_m = libvlc_media_new_path( p_vlc, psz_path );
+    assert( p_m != NULL );
+    libvlc_media_add_option( p_m, ":demux=test_offline" );
+    libvlc_media_add_option( p_m, ":sout=#test_offline_out" );
+    libvlc_media_add_option( p_m, ":sout-offline" );
+
+    libvlc_media_player_t *p_mp = libvlc_media_player_new_from_media( p_m );
+    assert( p_mp != NULL );
+    libvlc_media_release( p_m );
+
+    /* Without the clock, the 8 s of stream are output as fast as possible */
+    const mtime_t i_start = mdate();
+    assert( libvlc_media_player_play( p_mp ) == 0 );
+    libvlc_state_t i_state;
+    while( ( i_state = libvlc_media_player_get_state( p_mp ) )
+               != libvlc_Ended && i_state != libvlc_Error )
+        mwait( mdate() + 10000 );
+    const mtime_t i_elapsed = mdate() - i_start;
+    libvlc_media_player_stop( p_mp );
+
+    assert( i_state == libvlc_Ended );
+    assert( i_elapsed < FRAMES * LENGTH / 4 );
+
+    /* The packetizer may keep the last frame */
+    assert( out.i_frames >= FRAMES - 1 );
+
+    /* The timestamps keep increasing across the jump back, without the gap */
+    for( unsigned i = 1; i < out.i_frames; i++ )
+        assert( out.p_dts[i] > out.p_dts[i - 1] );
+    assert( out.p_dts[out.i_frames - 1] - out.p_dts[0]
+                < ( out.i_frames - 1 ) * LENGTH + CLOCK_FREQ );
+
+    libvlc_media_player_release( p_mp );
+    libvlc_release( p_vlc );
+    unlink( psz_path );
+    return 0;
+}
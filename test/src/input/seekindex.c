@@ -0,0 +1,267 @@
+/*****************************************************************************
+ * seekindex.c: seek index unit test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_seekindex.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+#define ENTRIES 10000
+#define OLD_INDEXES 40 /* of 1 MiB, above the cache size limit */
+
+static void WriteFile( const char *psz_path, size_t i_size )
+{
+    FILE *p_file = vlc_fopen( psz_path, "wb" );
+    assert( p_file != NULL );
+    for( size_t i = 0; i < i_size; i++ )
+        fputc( i & 0xFF, p_file );
+    fclose( p_file );
+}
+
+static ino_t IndexInode( const char *psz_dir )
+{
+    char *psz_cmd;
+    char psz_name[64];
+
+    /* the only index not planted by the test */
+    assert( asprintf( &psz_cmd, "ls %s/cache/vlc/seekindex | grep -v ^0000",
+                      psz_dir ) != -1 );
+    FILE *p_pipe = popen( psz_cmd, "r" );
+    assert( p_pipe != NULL );
+    assert( fscanf( p_pipe, "%63s", psz_name ) == 1 );
+    pclose( p_pipe );
+    free( psz_cmd );
+
+    struct stat st;
+    assert( asprintf( &psz_cmd, "%s/cache/vlc/seekindex/%s", psz_dir,
+                      psz_name ) != -1 );
+    assert( vlc_stat( psz_cmd, &st ) == 0 );
+    free( psz_cmd );
+    return st.st_ino;
+}
+
+/* Least recently stored indexes, of other media */
+static void PlantOldIndexes( const char *psz_dir )
+{
+    for( unsigned i = 0; i < OLD_INDEXES; i++ )
+    {
+        char *psz_path;
+        assert( asprintf( &psz_path, "%s/cache/vlc/seekindex/%032x",
+                          psz_dir, i ) != -1 );
+        WriteFile( psz_path, 1 << 20 );
+        struct utimbuf times = { 1000000 + i, 1000000 + i };
+        assert( utime( psz_path, &times ) == 0 );
+        free( psz_path );
+    }
+}
+
+static unsigned CountOldIndexes( const char *psz_dir )
+{
+    unsigned i_count = 0;
+    for( unsigned i = 0; i < OLD_INDEXES; i++ )
+    {
+        char *psz_path;
+        struct stat st;
+        assert( asprintf( &psz_path, "%s/cache/vlc/seekindex/%032x",
+                          psz_dir, i ) != -1 );
+        if( vlc_stat( psz_path, &st ) == 0 )
+            i_count++;
+        else /* the oldest ones are gone */
+            assert( i_count == 0 );
+        free( psz_path );
+    }
+    return i_count;
+}
+
+static void Fill( vlc_seekindex_t *p_idx )
+{
+    /* two tracks, interleaved and out of order */
+    for( unsigned i = 0; i < ENTRIES; i++ )
+    {
+        unsigned j = (i * 7919) % ENTRIES;
+        vlc_seekindex_entry_t entry = {
+            .i_time = j * CLOCK_FREQ / 10,
+            .i_offset = j * 1000,
+            .i_size = 100 + j,
+            .i_track = j & 1,
+            .i_flags = (j % 10) < 2 ? SEEKINDEX_KEYFRAME : 0,
+        };
+        assert( vlc_seekindex_Add( p_idx, &entry ) == VLC_SUCCESS );
+    }
+
+    /* duplicates are merged */
+    vlc_seekindex_entry_t dup = { VLC_TS_INVALID, 5000, 0, 1, SEEKINDEX_KEYFRAME };
+    assert( vlc_seekindex_Add( p_idx, &dup ) == VLC_SUCCESS );
+
+    assert( vlc_seekindex_AddRange( p_idx, 2000, 3000 ) == VLC_SUCCESS );
+    assert( vlc_seekindex_AddRange( p_idx, 0, 1000 ) == VLC_SUCCESS );
+    assert( vlc_seekindex_AddRange( p_idx, 1000, 2000 ) == VLC_SUCCESS );
+    assert( vlc_seekindex_AddRange( p_idx, 5000, 6000 ) == VLC_SUCCESS );
+}
+
+static void Check( vlc_seekindex_t *p_idx )
+{
+    const vlc_seekindex_entry_t *p_entries;
+    size_t i_count;
+
+    for( uint32_t i_track = 0; i_track < 2; i_track++ )
+    {
+        i_count = vlc_seekindex_GetEntries( p_idx, i_track, &p_entries );
+        assert( i_count == ENTRIES / 2 );
+        for( size_t i = 0; i < i_count; i++ )
+        {
+            const unsigned j = 2 * i + i_track;
+            assert( p_entries[i].i_track == i_track );
+            assert( p_entries[i].i_offset == j * 1000 );
+            assert( p_entries[i].i_time == (mtime_t) j * CLOCK_FREQ / 10 );
+            assert( p_entries[i].i_size == 100 + j );
+            assert( !!(p_entries[i].i_flags & SEEKINDEX_KEYFRAME) ==
+                    ((j % 10) < 2 || j == 5) );
+        }
+    }
+    assert( vlc_seekindex_GetEntries( p_idx, 2, &p_entries ) == 0 );
+
+    /* keyframes of track 0 are at 0, 1, 2 s... */
+    const vlc_seekindex_entry_t *p_entry =
+        vlc_seekindex_Lookup( p_idx, 0, 25 * CLOCK_FREQ / 10, SEEKINDEX_KEYFRAME );
+    assert( p_entry != NULL && p_entry->i_offset == 20000 );
+    p_entry = vlc_seekindex_Lookup( p_idx, 0, 25 * CLOCK_FREQ / 10, 0 );
+    assert( p_entry != NULL && p_entry->i_offset == 24000 );
+    p_entry = vlc_seekindex_Lookup( p_idx, 1, 0, 0 );
+    assert( p_entry == NULL );
+    p_entry = vlc_seekindex_Lookup( p_idx, 1, CLOCK_FREQ, SEEKINDEX_KEYFRAME );
+    assert( p_entry != NULL && p_entry->i_offset == 5000 );
+
+    const vlc_seekindex_range_t *p_ranges;
+    i_count = vlc_seekindex_GetRanges( p_idx, &p_ranges );
+    assert( i_count == 2 );
+    assert( p_ranges[0].i_start == 0 && p_ranges[0].i_end == 3000 );
+    assert( p_ranges[1].i_start == 5000 && p_ranges[1].i_end == 6000 );
+    assert( vlc_seekindex_IsIndexed( p_idx, 500, 2500 ) );
+    assert( vlc_seekindex_IsIndexed( p_idx, 5000, 6000 ) );
+    assert( !vlc_seekindex_IsIndexed( p_idx, 2500, 5500 ) );
+    assert( !vlc_seekindex_IsIndexed( p_idx, 4000, 4500 ) );
+}
+
+int main( void )
+{
+    char psz_dir[] = "/tmp/vlc-seekindex-XXXXXX";
+    char *psz_file, *psz_cmd;
+
+    test_init();
+
+    assert( mkdtemp( psz_dir ) != NULL );
+    /* the cache directories do not exist yet */
+    assert( asprintf( &psz_file, "%s/cache", psz_dir ) != -1 );
+    setenv( "XDG_CACHE_HOME", psz_file, 1 );
+    free( psz_file );
+    assert( asprintf( &psz_file, "%s/media", psz_dir ) != -1 );
+    WriteFile( psz_file, 4096 );
+
+    libvlc_instance_t *p_vlc = libvlc_new( 0, NULL );
+    assert( p_vlc != NULL );
+    vlc_object_t *p_obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+
+    assert( vlc_seekindex_New( p_obj, "test", NULL ) == NULL );
+
+    /* new index, stored on deletion */
+    vlc_seekindex_t *p_idx = vlc_seekindex_New( p_obj, "test", psz_file );
+    assert( p_idx != NULL );
+    assert( vlc_seekindex_GetRanges( p_idx, &(const vlc_seekindex_range_t *){ NULL } ) == 0 );
+    Fill( p_idx );
+    Check( p_idx );
+    vlc_seekindex_Delete( p_idx );
+
+    /* reloaded */
+    p_idx = vlc_seekindex_New( p_obj, "test", psz_file );
+    assert( p_idx != NULL );
+    Check( p_idx );
+    vlc_seekindex_Delete( p_idx );
+
+    /* the same entries again, not rewritten */
+    const ino_t i_inode = IndexInode( psz_dir );
+    p_idx = vlc_seekindex_New( p_obj, "test", psz_file );
+    assert( p_idx != NULL );
+    Fill( p_idx );
+    Check( p_idx );
+    vlc_seekindex_Delete( p_idx );
+    assert( IndexInode( psz_dir ) == i_inode );
+
+    /* a new entry, stored, and the cache is pruned */
+    PlantOldIndexes( psz_dir );
+    p_idx = vlc_seekindex_New( p_obj, "test", psz_file );
+    assert( p_idx != NULL );
+    vlc_seekindex_entry_t entry = { VLC_TS_INVALID, 1, 0, 2, 0 };
+    assert( vlc_seekindex_Add( p_idx, &entry ) == VLC_SUCCESS );
+    vlc_seekindex_Delete( p_idx );
+    assert( IndexInode( psz_dir ) != i_inode );
+    unsigned i_old = CountOldIndexes( psz_dir );
+    assert( i_old > 0 && i_old <= 24 );
+
+    /* the most recent index is kept */
+    p_idx = vlc_seekindex_New( p_obj, "test", psz_file );
+    assert( p_idx != NULL );
+    assert( vlc_seekindex_GetEntries( p_idx, 2, &(const vlc_seekindex_entry_t *){ NULL } ) == 1 );
+    vlc_seekindex_Delete( p_idx );
+
+    /* not shared with other demuxers */
+    p_idx = vlc_seekindex_New( p_obj, "other", psz_file );
+    assert( p_idx != NULL );
+    assert( vlc_seekindex_GetEntries( p_idx, 0, &(const vlc_seekindex_entry_t *){ NULL } ) == 0 );
+    vlc_seekindex_Delete( p_idx );
+
+    /* the file changed, the index is stale */
+    WriteFile( psz_file, 8192 );
+    p_idx = vlc_seekindex_New( p_obj, "test", psz_file );
+    assert( p_idx != NULL );
+    assert( vlc_seekindex_GetEntries( p_idx, 0, &(const vlc_seekindex_entry_t *){ NULL } ) == 0 );
+    vlc_seekindex_Delete( p_idx );
+
+    libvlc_release( p_vlc );
+
+    /* disabled */
+    const char *args[] = { "--no-input-seekindex" };
+    p_vlc = libvlc_new( 1, args );
+    assert( p_vlc != NULL );
+    assert( vlc_seekindex_New( VLC_OBJECT(p_vlc->p_libvlc_int), "test", psz_file ) == NULL );
+    libvlc_release( p_vlc );
+
+    assert( asprintf( &psz_cmd, "rm -rf %s", psz_dir ) != -1 );
+    assert( system( psz_cmd ) == 0 );
+    free( psz_cmd );
+    free( psz_file );
+    return 0;
+}
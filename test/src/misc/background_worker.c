@@ -0,0 +1,324 @@
+/*****************************************************************************
+ * background_worker.c: tests the order and limits of the background worker
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include "../../../src/libvlc.h"
+#include "../../../src/misc/background_worker.h"
+#include "../../libvlc/test.h"
+
+/* vlc_clone_detach() is internal to libvlccore: the threads of the worker
+ * are joined at the end of each test instead */
+static struct
+{
+    vlc_mutex_t  lock;
+    vlc_thread_t threads[64];
+    unsigned     i_threads;
+} detached = { .lock = VLC_STATIC_MUTEX };
+
+int vlc_clone_detach( vlc_thread_t *p_th, void *(*entry)(void *), void *data,
+                      int i_priority )
+{
+    vlc_thread_t th;
+
+    VLC_UNUSED(p_th);
+    vlc_mutex_lock( &detached.lock );
+    assert( detached.i_threads < ARRAY_SIZE(detached.threads) );
+    int i_ret = vlc_clone( &th, entry, data, i_priority );
+    if( i_ret == 0 )
+        detached.threads[detached.i_threads++] = th;
+    vlc_mutex_unlock( &detached.lock );
+    return i_ret;
+}
+
+static void JoinThreads( void )
+{
+    vlc_mutex_lock( &detached.lock );
+    for( unsigned i = 0; i < detached.i_threads; i++ )
+        vlc_join( detached.threads[i], NULL );
+    detached.i_threads = 0;
+    vlc_mutex_unlock( &detached.lock );
+}
+
+/*
+ * Entities: a task runs until its entity is released by the test
+ */
+struct entity
+{
+    const char *psz_name;
+    const char *psz_domain;
+    atomic_bool released;
+    atomic_int  refs;
+    bool        b_started;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_sem_t   started;
+    vlc_sem_t   stopped;
+    const char *order[16];
+    unsigned    i_started;
+    unsigned    i_domain_running; /* tasks of the "busy" domain */
+} tasks;
+
+static void Hold( void *entity )
+{
+    struct entity *e = entity;
+    atomic_fetch_add( &e->refs, 1 );
+}
+
+static void Release( void *entity )
+{
+    struct entity *e = entity;
+    assert( atomic_fetch_sub( &e->refs, 1 ) > 0 );
+}
+
+static int Start( void *owner, void *entity, void **out )
+{
+    struct entity *e = entity;
+
+    VLC_UNUSED(owner);
+    vlc_mutex_lock( &tasks.lock );
+    assert( !e->b_started );
+    assert( tasks.i_started < ARRAY_SIZE(tasks.order) );
+    e->b_started = true;
+    tasks.order[tasks.i_started++] = e->psz_name;
+    if( e->psz_domain != NULL && !strcmp( e->psz_domain, "busy" ) )
+        assert( ++tasks.i_domain_running <= 1 );
+    vlc_mutex_unlock( &tasks.lock );
+
+    *out = e;
+    vlc_sem_post( &tasks.started );
+    return VLC_SUCCESS;
+}
+
+static int Probe( void *owner, void *handle )
+{
+    struct entity *e = handle;
+
+    VLC_UNUSED(owner);
+    return atomic_load( &e->released );
+}
+
+static void Stop( void *owner, void *handle )
+{
+    struct entity *e = handle;
+
+    VLC_UNUSED(owner);
+    vlc_mutex_lock( &tasks.lock );
+    if( e->psz_domain != NULL && !strcmp( e->psz_domain, "busy" ) )
+        tasks.i_domain_running--;
+    vlc_mutex_unlock( &tasks.lock );
+    vlc_sem_post( &tasks.stopped );
+}
+
+static char *Domain( void *owner, void *entity )
+{
+    struct entity *e = entity;
+
+    VLC_UNUSED(owner);
+    return e->psz_domain != NULL ? strdup( e->psz_domain ) : NULL;
+}
+
+static void InitEntities( struct entity *entities, size_t i_count )
+{
+    for( size_t i = 0; i < i_count; i++ )
+    {
+        atomic_init( &entities[i].released, false );
+        atomic_init( &entities[i].refs, 0 );
+        entities[i].b_started = false;
+    }
+    tasks.i_started = 0;
+    tasks.i_domain_running = 0;
+}
+
+static void ReleaseEntity( struct background_worker *worker,
+                           struct entity *e )
+{
+    atomic_store( &e->released, true );
+    background_worker_RequestProbe( worker );
+    vlc_sem_wait( &tasks.stopped );
+}
+
+static void CheckEntities( struct entity *entities, size_t i_count )
+{
+    for( size_t i = 0; i < i_count; i++ )
+        assert( atomic_load( &entities[i].refs ) == 0 );
+}
+
+static struct background_worker *NewWorker( int i_threads, int i_per_domain )
+{
+    struct background_worker_config conf = {
+        .default_timeout = 0,
+        .pf_release = Release,
+        .pf_hold = Hold,
+        .pf_start = Start,
+        .pf_probe = Probe,
+        .pf_stop = Stop,
+        .max_threads = i_threads,
+        .max_per_domain = i_per_domain,
+        .pf_domain = Domain,
+    };
+    return background_worker_New( NULL, &conf );
+}
+
+/* The entities pushed with priority run first, each kind in its order */
+static void test_priority( void )
+{
+    struct entity entities[] = {
+        { .psz_name = "running" },
+        { .psz_name = "normal 1" },
+        { .psz_name = "normal 2" },
+        { .psz_name = "priority 1" },
+        { .psz_name = "normal 3" },
+        { .psz_name = "priority 2" },
+    };
+    static const char *const order[] = {
+        "running", "priority 1", "priority 2",
+        "normal 1", "normal 2", "normal 3",
+    };
+    InitEntities( entities, ARRAY_SIZE(entities) );
+
+    struct background_worker *worker = NewWorker( 1, 0 );
+    assert( worker != NULL );
+
+    /* The only thread is busy while the others are queued */
+    assert( background_worker_Push( worker, &entities[0], NULL, -1 )
+            == VLC_SUCCESS );
+    vlc_sem_wait( &tasks.started );
+    for( size_t i = 1; i < ARRAY_SIZE(entities); i++ )
+    {
+        int (*push)( struct background_worker *, void *, void *, int ) =
+            strncmp( entities[i].psz_name, "priority", 8 )
+                ? background_worker_Push : background_worker_PushPriority;
+        assert( push( worker, &entities[i], NULL, -1 ) == VLC_SUCCESS );
+    }
+
+    struct background_worker_stats stats;
+    background_worker_GetStats( worker, &stats );
+    assert( stats.queued == ARRAY_SIZE(entities) - 1 );
+    assert( stats.running == 1 );
+
+    for( size_t i = 0; i < ARRAY_SIZE(order); i++ )
+    {
+        if( i > 0 )
+            vlc_sem_wait( &tasks.started );
+        vlc_mutex_lock( &tasks.lock );
+        assert( tasks.i_started == i + 1 );
+        assert( !strcmp( tasks.order[i], order[i] ) );
+        vlc_mutex_unlock( &tasks.lock );
+
+        for( size_t j = 0; j < ARRAY_SIZE(entities); j++ )
+            if( !strcmp( entities[j].psz_name, order[i] ) )
+                ReleaseEntity( worker, &entities[j] );
+    }
+
+    background_worker_Delete( worker );
+    JoinThreads();
+    CheckEntities( entities, ARRAY_SIZE(entities) );
+}
+
+/* A busy domain is passed over for the later entities, then resumed */
+static void test_domain( void )
+{
+    struct entity entities[] = {
+        { .psz_name = "busy 1", .psz_domain = "busy" },
+        { .psz_name = "busy 2", .psz_domain = "busy" },
+        { .psz_name = "other", .psz_domain = "other" },
+        { .psz_name = "none" },
+        { .psz_name = "busy 3", .psz_domain = "busy" },
+    };
+    InitEntities( entities, ARRAY_SIZE(entities) );
+
+    struct background_worker *worker = NewWorker( 3, 1 );
+    assert( worker != NULL );
+
+    for( size_t i = 0; i < ARRAY_SIZE(entities); i++ )
+        assert( background_worker_Push( worker, &entities[i], NULL, -1 )
+                == VLC_SUCCESS );
+
+    /* One entity of the busy domain, and both of the others */
+    for( unsigned i = 0; i < 3; i++ )
+        vlc_sem_wait( &tasks.started );
+    mwait( mdate() + 50000 );
+
+    vlc_mutex_lock( &tasks.lock );
+    assert( tasks.i_started == 3 );
+    assert( tasks.i_domain_running == 1 );
+    assert( entities[0].b_started );
+    assert( !entities[1].b_started && !entities[4].b_started );
+    assert( entities[2].b_started && entities[3].b_started );
+    vlc_mutex_unlock( &tasks.lock );
+
+    struct background_worker_stats stats;
+    background_worker_GetStats( worker, &stats );
+    assert( stats.queued == 2 );
+    assert( stats.running == 3 );
+
+    /* The queued entities of the busy domain run one at a time, in order */
+    ReleaseEntity( worker, &entities[0] );
+    vlc_sem_wait( &tasks.started );
+    vlc_mutex_lock( &tasks.lock );
+    assert( !strcmp( tasks.order[3], "busy 2" ) );
+    vlc_mutex_unlock( &tasks.lock );
+
+    ReleaseEntity( worker, &entities[1] );
+    vlc_sem_wait( &tasks.started );
+    vlc_mutex_lock( &tasks.lock );
+    assert( !strcmp( tasks.order[4], "busy 3" ) );
+    vlc_mutex_unlock( &tasks.lock );
+
+    ReleaseEntity( worker, &entities[2] );
+    ReleaseEntity( worker, &entities[3] );
+    ReleaseEntity( worker, &entities[4] );
+
+    background_worker_Delete( worker );
+    JoinThreads();
+    CheckEntities( entities, ARRAY_SIZE(entities) );
+}
+
+int main( void )
+{
+    test_init();
+
+    vlc_mutex_init( &tasks.lock );
+    vlc_sem_init( &tasks.started, 0 );
+    vlc_sem_init( &tasks.stopped, 0 );
+
+    test_priority();
+    test_domain();
+
+    vlc_sem_destroy( &tasks.stopped );
+    vlc_sem_destroy( &tasks.started );
+    vlc_mutex_destroy( &tasks.lock );
+    return 0;
+}
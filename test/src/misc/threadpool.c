@@ -0,0 +1,410 @@
+/*****************************************************************************
+ * threadpool.c: test for the shared worker thread pool
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#ifdef NDEBUG
+# undef NDEBUG
+#endif
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_interrupt.h>
+#include <vlc_threadpool.h>
+
+#define WORKERS 4
+
+/* vlc_threadpool_Run() */
+
+typedef struct
+{
+    atomic_uint *hits;
+    unsigned     i_count;
+} run_ctx_t;
+
+static void RunIndex( void *opaque, unsigned i, unsigned i_count )
+{
+    run_ctx_t *ctx = opaque;
+
+    assert( i_count == ctx->i_count );
+    assert( i < i_count );
+    atomic_fetch_add( &ctx->hits[i], 1 );
+}
+
+static void test_run( vlc_threadpool_t *pool )
+{
+    static const unsigned counts[] = { 0, 1, 2, 3, WORKERS, 17, 64, 65, 300 };
+
+    for( size_t c = 0; c < ARRAY_SIZE(counts); c++ )
+    {
+        const unsigned i_count = counts[c];
+        atomic_uint hits[300];
+        run_ctx_t ctx = { hits, i_count };
+
+        for( unsigned i = 0; i < i_count; i++ )
+            atomic_init( &hits[i], 0 );
+
+        for( int prio = 0; prio < VLC_THREADPOOL_PRIORITIES; prio++ )
+        {
+            int ret = vlc_threadpool_Run( pool, i_count, RunIndex, &ctx, prio );
+            assert( ret == VLC_SUCCESS );
+        }
+        for( unsigned i = 0; i < i_count; i++ )
+            assert( atomic_load( &hits[i] ) == VLC_THREADPOOL_PRIORITIES );
+    }
+}
+
+/* Groups */
+
+static void Add( void *data )
+{
+    atomic_fetch_add( (atomic_uint *)data, 1 );
+}
+
+static void test_group( vlc_threadpool_t *pool )
+{
+    atomic_uint sum = ATOMIC_VAR_INIT(0);
+
+    vlc_threadpool_group_t *group =
+        vlc_threadpool_group_New( pool, VLC_THREADPOOL_PRIORITY_NORMAL );
+    assert( group != NULL );
+
+    /* The group is reusable once waited for */
+    for( unsigned round = 1; round <= 3; round++ )
+    {
+        for( int i = 0; i < 100; i++ )
+            assert( vlc_threadpool_group_Submit( group, Add, &sum,
+                                                 i % 3 ? i : VLC_THREADPOOL_ANY )
+                    == VLC_SUCCESS );
+        assert( vlc_threadpool_group_Wait( group ) == VLC_SUCCESS );
+        assert( atomic_load( &sum ) == 100 * round );
+        assert( !vlc_threadpool_group_IsCancelled( group ) );
+    }
+
+    /* Nothing to wait for */
+    assert( vlc_threadpool_group_Wait( group ) == VLC_SUCCESS );
+    vlc_threadpool_group_Delete( group );
+}
+
+/* Cancellation: block all the workers, then cancel queued tasks */
+
+typedef struct
+{
+    vlc_sem_t   started;
+    vlc_sem_t   release;
+    atomic_uint ran;
+} gate_t;
+
+static void Block( void *data )
+{
+    gate_t *gate = data;
+
+    vlc_sem_post( &gate->started );
+    vlc_sem_wait( &gate->release );
+}
+
+static void Count( void *data )
+{
+    gate_t *gate = data;
+
+    atomic_fetch_add( &gate->ran, 1 );
+}
+
+static vlc_threadpool_group_t *BlockWorkers( vlc_threadpool_t *pool,
+                                             gate_t *gate )
+{
+    vlc_threadpool_group_t *blockers =
+        vlc_threadpool_group_New( pool, VLC_THREADPOOL_PRIORITY_HIGH );
+    assert( blockers != NULL );
+
+    for( unsigned i = 0; i < vlc_threadpool_GetSize( pool ); i++ )
+        assert( vlc_threadpool_group_Submit( blockers, Block, gate, i )
+                == VLC_SUCCESS );
+    for( unsigned i = 0; i < vlc_threadpool_GetSize( pool ); i++ )
+        vlc_sem_wait( &gate->started );
+    return blockers;
+}
+
+static void UnblockWorkers( vlc_threadpool_t *pool, gate_t *gate,
+                            vlc_threadpool_group_t *blockers )
+{
+    for( unsigned i = 0; i < vlc_threadpool_GetSize( pool ); i++ )
+        vlc_sem_post( &gate->release );
+    assert( vlc_threadpool_group_Wait( blockers ) == VLC_SUCCESS );
+    vlc_threadpool_group_Delete( blockers );
+}
+
+static void test_cancel( vlc_threadpool_t *pool )
+{
+    gate_t gate;
+
+    vlc_sem_init( &gate.started, 0 );
+    vlc_sem_init( &gate.release, 0 );
+    atomic_init( &gate.ran, 0 );
+
+    vlc_threadpool_group_t *blockers = BlockWorkers( pool, &gate );
+
+    vlc_threadpool_group_t *group =
+        vlc_threadpool_group_New( pool, VLC_THREADPOOL_PRIORITY_LOW );
+    assert( group != NULL );
+    for( int i = 0; i < 10; i++ )
+        assert( vlc_threadpool_group_Submit( group, Count, &gate,
+                                             VLC_THREADPOOL_ANY )
+                == VLC_SUCCESS );
+
+    vlc_threadpool_group_Cancel( group );
+    assert( vlc_threadpool_group_IsCancelled( group ) );
+    assert( vlc_threadpool_group_Wait( group ) == VLC_EGENERIC );
+    assert( atomic_load( &gate.ran ) == 0 );
+
+    /* Reusable after cancellation */
+    assert( !vlc_threadpool_group_IsCancelled( group ) );
+    assert( vlc_threadpool_group_Submit( group, Count, &gate, 0 )
+            == VLC_SUCCESS );
+    /* Run by the waiting thread, as the workers are all busy */
+    assert( vlc_threadpool_group_Wait( group ) == VLC_SUCCESS );
+    assert( atomic_load( &gate.ran ) == 1 );
+
+    /* Deletion cancels queued tasks */
+    for( int i = 0; i < 10; i++ )
+        assert( vlc_threadpool_group_Submit( group, Count, &gate,
+                                             VLC_THREADPOOL_ANY )
+                == VLC_SUCCESS );
+    vlc_threadpool_group_Delete( group );
+    assert( atomic_load( &gate.ran ) == 1 );
+
+    UnblockWorkers( pool, &gate, blockers );
+    vlc_sem_destroy( &gate.release );
+    vlc_sem_destroy( &gate.started );
+}
+
+/* Interruption of vlc_threadpool_group_Wait() */
+
+typedef struct
+{
+    vlc_interrupt_t *ctx;
+    vlc_sem_t        started;
+    gate_t           gate;
+} interrupt_test_t;
+
+static void BlockAndInterrupt( void *data )
+{
+    interrupt_test_t *t = data;
+
+    vlc_sem_post( &t->started );
+    /* The waiting thread may be sleeping already or not */
+    vlc_interrupt_raise( t->ctx );
+    vlc_sem_wait( &t->gate.release );
+    atomic_fetch_add( &t->gate.ran, 1 );
+}
+
+static void test_interrupt( vlc_threadpool_t *pool )
+{
+    interrupt_test_t t;
+
+    t.ctx = vlc_interrupt_create();
+    assert( t.ctx != NULL );
+    vlc_sem_init( &t.started, 0 );
+    vlc_sem_init( &t.gate.started, 0 );
+    vlc_sem_init( &t.gate.release, 0 );
+    atomic_init( &t.gate.ran, 0 );
+
+    vlc_interrupt_t *oldctx = vlc_interrupt_set( t.ctx );
+
+    /* Interrupted while a task is running: Wait() still waits for it */
+    vlc_threadpool_group_t *group =
+        vlc_threadpool_group_New( pool, VLC_THREADPOOL_PRIORITY_NORMAL );
+    assert( group != NULL );
+    assert( vlc_threadpool_group_Submit( group, BlockAndInterrupt, &t, 0 )
+            == VLC_SUCCESS );
+    vlc_sem_wait( &t.started );
+    vlc_sem_post( &t.gate.release );
+    /* Depending on timings, the interruption cancels the group or comes
+     * too late, but the running task is always waited for */
+    (void) vlc_threadpool_group_Wait( group );
+    assert( atomic_load( &t.gate.ran ) == 1 );
+    vlc_threadpool_group_Delete( group );
+    atomic_store( &t.gate.ran, 0 );
+
+    /* Interrupted with queued tasks: they are cancelled, not run by the
+     * waiting thread */
+    vlc_threadpool_group_t *blockers = BlockWorkers( pool, &t.gate );
+    group = vlc_threadpool_group_New( pool, VLC_THREADPOOL_PRIORITY_LOW );
+    assert( group != NULL );
+    for( int i = 0; i < 5; i++ )
+        assert( vlc_threadpool_group_Submit( group, Count, &t.gate,
+                                             VLC_THREADPOOL_ANY )
+                == VLC_SUCCESS );
+    vlc_interrupt_raise( t.ctx );
+    assert( vlc_threadpool_group_Wait( group ) == VLC_EGENERIC );
+    assert( atomic_load( &t.gate.ran ) == 0 );
+
+    /* The interruption was consumed */
+    assert( vlc_threadpool_group_Submit( group, Count, &t.gate, 0 )
+            == VLC_SUCCESS );
+    assert( vlc_threadpool_group_Wait( group ) == VLC_SUCCESS );
+    assert( atomic_load( &t.gate.ran ) == 1 );
+    vlc_threadpool_group_Delete( group );
+
+    UnblockWorkers( pool, &t.gate, blockers );
+    vlc_interrupt_set( oldctx );
+
+    vlc_sem_destroy( &t.gate.release );
+    vlc_sem_destroy( &t.gate.started );
+    vlc_sem_destroy( &t.started );
+    vlc_interrupt_destroy( t.ctx );
+}
+
+/* Priorities: queued high priority tasks run before low priority ones */
+
+typedef struct
+{
+    vlc_mutex_t lock;
+    vlc_sem_t   done;
+    int         order[8];
+    unsigned    i_order;
+} order_t;
+
+typedef struct
+{
+    order_t *order;
+    int      i_priority;
+} prio_task_t;
+
+static void Record( void *data )
+{
+    prio_task_t *task = data;
+    order_t *order = task->order;
+
+    vlc_mutex_lock( &order->lock );
+    order->order[order->i_order++] = task->i_priority;
+    vlc_mutex_unlock( &order->lock );
+    vlc_sem_post( &order->done );
+}
+
+static void test_priority( vlc_threadpool_t *pool )
+{
+    gate_t gate;
+    order_t order;
+
+    vlc_sem_init( &gate.started, 0 );
+    vlc_sem_init( &gate.release, 0 );
+    atomic_init( &gate.ran, 0 );
+    vlc_mutex_init( &order.lock );
+    vlc_sem_init( &order.done, 0 );
+    order.i_order = 0;
+
+    vlc_threadpool_group_t *blockers = BlockWorkers( pool, &gate );
+
+    vlc_threadpool_group_t *low =
+        vlc_threadpool_group_New( pool, VLC_THREADPOOL_PRIORITY_LOW );
+    vlc_threadpool_group_t *high =
+        vlc_threadpool_group_New( pool, VLC_THREADPOOL_PRIORITY_HIGH );
+    assert( low != NULL && high != NULL );
+
+    prio_task_t lows[4], highs[4];
+    for( int i = 0; i < 4; i++ )
+    {
+        lows[i] = (prio_task_t){ &order, VLC_THREADPOOL_PRIORITY_LOW };
+        highs[i] = (prio_task_t){ &order, VLC_THREADPOOL_PRIORITY_HIGH };
+        /* Same worker queue for all, so that a single worker runs them */
+        assert( vlc_threadpool_group_Submit( low, Record, &lows[i], 0 )
+                == VLC_SUCCESS );
+    }
+    for( int i = 0; i < 4; i++ )
+        assert( vlc_threadpool_group_Submit( high, Record, &highs[i], 0 )
+                == VLC_SUCCESS );
+
+    /* Release a single worker: it must run the high priority tasks first.
+     * Do not wait for the groups yet, as the waiting thread would help. */
+    vlc_sem_post( &gate.release );
+    for( int i = 0; i < 8; i++ )
+        vlc_sem_wait( &order.done );
+
+    for( unsigned i = 0; i < 4; i++ )
+    {
+        assert( order.order[i] == VLC_THREADPOOL_PRIORITY_HIGH );
+        assert( order.order[4 + i] == VLC_THREADPOOL_PRIORITY_LOW );
+    }
+    assert( vlc_threadpool_group_Wait( low ) == VLC_SUCCESS );
+    assert( vlc_threadpool_group_Wait( high ) == VLC_SUCCESS );
+
+    vlc_threadpool_group_Delete( high );
+    vlc_threadpool_group_Delete( low );
+
+    for( unsigned i = 1; i < vlc_threadpool_GetSize( pool ); i++ )
+        vlc_sem_post( &gate.release );
+    assert( vlc_threadpool_group_Wait( blockers ) == VLC_SUCCESS );
+    vlc_threadpool_group_Delete( blockers );
+    vlc_sem_destroy( &order.done );
+    vlc_mutex_destroy( &order.lock );
+    vlc_sem_destroy( &gate.release );
+    vlc_sem_destroy( &gate.started );
+}
+
+/* Concurrent users of the same pool */
+
+#define CALLERS 8
+
+static void *Caller( void *data )
+{
+    vlc_threadpool_t *pool = data;
+
+    for( int i = 0; i < 50; i++ )
+        test_run( pool );
+    test_group( pool );
+    return NULL;
+}
+
+static void test_concurrency( vlc_threadpool_t *pool )
+{
+    vlc_thread_t th[CALLERS];
+
+    for( int i = 0; i < CALLERS; i++ )
+        assert( !vlc_clone( &th[i], Caller, pool, VLC_THREAD_PRIORITY_LOW ) );
+    for( int i = 0; i < CALLERS; i++ )
+        vlc_join( th[i], NULL );
+}
+
+int main( void )
+{
+    test_init();
+
+    const char *args[] = { "--threadpool-threads=4" /* WORKERS */ };
+    libvlc_instance_t *vlc = libvlc_new( 1, args );
+    assert( vlc != NULL );
+
+    vlc_threadpool_t *pool = vlc_threadpool_Get( vlc->p_libvlc_int );
+    assert( pool != NULL );
+    assert( vlc_threadpool_Get( vlc->p_libvlc_int ) == pool );
+    assert( vlc_threadpool_GetSize( pool ) == WORKERS );
+
+    test_run( pool );
+    test_group( pool );
+    test_cancel( pool );
+    test_interrupt( pool );
+    test_priority( pool );
+    test_concurrency( pool );
+
+    libvlc_release( vlc );
+    return 0;
+}